@@ -23,12 +23,18 @@ else:
             "/GS",  # Buffer security check
         ]
 
+# Optional instrumentation counters read back with pds.stats()
+define_macros = []
+if os.environ.get("PDS_STATS"):
+    define_macros.append(("PDS_ENABLE_STATS", "1"))
+
 # Define the C extension module
 pds_extension = Extension(
     "spork.runtime.pds",
     sources=["spork/runtime/pds.c"],
     include_dirs=[],
     extra_compile_args=extra_compile_args,
+    define_macros=define_macros,
 )
 
 setup(
@@ -14,6 +14,7 @@ try:
         EMPTY_SET,
         # Empty constants
         EMPTY_VECTOR,
+        ChunkedSeq,
         Cons,
         Decorated,
         DoubleVector,
@@ -128,6 +129,7 @@ try:
         take_while,
         # Transients
         transient,
+        update_bang,
         # Constructors
         vec,
         vec_f64,
@@ -174,6 +176,7 @@ __all__ = [
     "DoubleVector",
     "IntVector",
     "Cons",
+    "ChunkedSeq",
     "TransientVector",
     "TransientDoubleVector",
     "TransientIntVector",
@@ -295,6 +298,7 @@ __all__ = [
     "conj_bang",
     "assoc_bang",
     "dissoc_bang",
+    "update_bang",
     "disj_bang",
     "pop_bang",
     # Runtime utilities
@@ -24,8 +24,10 @@ from spork.runtime.core import (
     _PROTOCOLS,
     LazySeq,
     add,
+    add_watch,
     assoc,
     assoc_bang,
+    atom,
     bit_and,
     bit_and_not,
     bit_not,
@@ -33,6 +35,7 @@ from spork.runtime.core import (
     bit_shift_left,
     bit_shift_right,
     bit_xor,
+    compare_and_set_bang,
     concat,
     conj,
     conj_bang,
@@ -41,11 +44,13 @@ from spork.runtime.core import (
     cycle,
     dec,
     dedupe,
+    deref,
     disj,
     disj_bang,
     dissoc,
     dissoc_bang,
     distinct,
+    diff,
     div,
     doall,
     dorun,
@@ -89,6 +94,8 @@ from spork.runtime.core import (
     reduce,
     reductions,
     register_protocol_impl,
+    remove_watch,
+    reset_bang,
     rest,
     reverse,
     runtime_register_protocol,
@@ -107,9 +114,11 @@ from spork.runtime.core import (
     spork_range,
     spork_repeat,
     sub,
+    swap_bang,
     take,
     take_while,
     transient,
+    update_bang,
     zero_q,
     zipmap,
 )
@@ -127,6 +136,9 @@ from spork.runtime.json import (
 from spork.runtime.json import (
     load as json_load,
 )
+from spork.runtime.json import (
+    load_lines_spork as json_load_lines_spork,
+)
 from spork.runtime.json import (
     load_spork as json_load_spork,
 )
@@ -145,23 +157,37 @@ from spork.runtime.pds import (  # pyright: ignore[reportMissingModuleSource]
     EMPTY_SET,
     EMPTY_SORTED_VECTOR,
     EMPTY_VECTOR,
+    Atom,
+    ChunkedSeq,
     Cons,
     DoubleVector,
+    IntMap,
+    IntSet,
     IntVector,
     Map,
     Set,
     SortedVector,
     TransientDoubleVector,
+    TransientIntMap,
+    TransientIntSet,
     TransientIntVector,
     TransientMap,
     TransientSet,
     TransientSortedVector,
     TransientVector,
     Vector,
+    assoc_in,
+    chunked_seq,
     cons,
+    dissoc_in,
+    fold,
+    get_in,
     hash_map,
     hash_set,
+    int_map,
+    int_set,
     sorted_vec,
+    update_in,
     vec,
     vec_f64,
     vec_i64,
@@ -240,6 +266,8 @@ __all__ = [
     "Map",
     "Set",
     "Cons",
+    "ChunkedSeq",
+    "Atom",
     "DoubleVector",
     "IntVector",
     "TransientVector",
@@ -259,9 +287,21 @@ __all__ = [
     "hash_map",
     "hash_set",
     "sorted_vec",
+    "int_map",
+    "int_set",
     "cons",
+    "chunked_seq",
+    "fold",
+    "get_in",
+    "assoc_in",
+    "update_in",
+    "dissoc_in",
     "SortedVector",
     "TransientSortedVector",
+    "IntMap",
+    "IntSet",
+    "TransientIntMap",
+    "TransientIntSet",
     # JSON
     "SporkJSONEncoder",
     "json_dump",
@@ -269,6 +309,7 @@ __all__ = [
     "json_load",
     "json_loads",
     "json_load_spork",
+    "json_load_lines_spork",
     "json_loads_spork",
     # Protocol system
     "_PROTOCOLS",
@@ -299,8 +340,17 @@ __all__ = [
     "conj_bang",
     "assoc_bang",
     "dissoc_bang",
+    "update_bang",
     "disj_bang",
     "pop_bang",
+    # Atoms
+    "atom",
+    "deref",
+    "swap_bang",
+    "reset_bang",
+    "compare_and_set_bang",
+    "add_watch",
+    "remove_watch",
     # Lazy sequences
     "spork_map",
     "spork_filter",
@@ -333,6 +383,7 @@ __all__ = [
     "reductions",
     # Collection utilities
     "zipmap",
+    "diff",
     "group_by",
     "frequencies",
     "reverse",
@@ -17,6 +17,7 @@ Categories:
 """
 
 from abc import ABC
+from itertools import islice
 from typing import Any, Iterator, Optional
 
 from spork.runtime.pds import (
@@ -24,25 +25,51 @@ from spork.runtime.pds import (
     EMPTY_SET,
     EMPTY_SORTED_VECTOR,
     EMPTY_VECTOR,
+    Atom,
+    ChunkedSeq,
     Cons,
     DoubleVector,
+    IntMap,
+    IntSet,
     IntVector,
     Map,
     Set,
     SortedVector,
     TransientDoubleVector,
+    TransientIntMap,
+    TransientIntSet,
     TransientIntVector,
     TransientMap,
     TransientSet,
     TransientSortedVector,
     TransientVector,
     Vector,
+    chunked_seq,
+    chunks,
+    diff,
+    eduction,
+    frequencies,
+    group_by,
     hash_map,
+    into as _into,
+    register_value_hash,
     sorted_vec,
+    transduce,
     vec,
+    xf_filter,
+    xf_map,
+    xf_partition,
+    xf_take,
+    zipmap,
 )
 from spork.runtime.types import _MISSING, Keyword
 
+# Keyword hashes follow from the name, so pickled Maps keep them
+register_value_hash(Keyword)
+
+# Collections the lazy functions walk a chunk (a Vector leaf) at a time
+_CHUNKED = (Vector, ChunkedSeq)
+
 # =============================================================================
 # Protocol System
 # =============================================================================
@@ -330,7 +357,7 @@ def first(coll):
     """Return the first element of a collection."""
     if coll is None:
         return None
-    if isinstance(coll, (Cons, LazySeq)):
+    if isinstance(coll, (Cons, ChunkedSeq, LazySeq)):
         return coll.first
     if isinstance(coll, Vector):
         return coll.nth(0, None) if len(coll) > 0 else None
@@ -362,6 +389,10 @@ def last(coll):
                 curr = curr.rest
             else:
                 break
+        if isinstance(curr, ChunkedSeq):
+            # A Cons list ending in a ChunkedSeq
+            for result in curr:
+                pass
         return result
     # Fallback for Python sequences
     try:
@@ -380,14 +411,12 @@ def rest(coll):
     """Return the rest of a collection as a sequence."""
     if coll is None:
         return None
-    if isinstance(coll, (Cons, LazySeq)):
+    if isinstance(coll, (Cons, ChunkedSeq, LazySeq)):
         r = coll.rest
         return r if r is not None and r is not type(None) else None
     if isinstance(coll, Vector):
-        if len(coll) <= 1:
-            return None
-        # Return a Cons chain for rest of vector
-        return seq(coll.nth(i) for i in range(1, len(coll)))
+        # Seq over the vector's leaves, sharing them rather than copying
+        return coll.to_seq().rest if len(coll) > 1 else None
     # Fallback for Python sequences
     try:
         it = iter(coll)
@@ -403,11 +432,13 @@ def seq(iterable):
         return None
     if isinstance(iterable, Cons):
         return iterable
-    if isinstance(iterable, LazySeq):
-        # Realize LazySeq to Cons if needed, or just return it
+    if isinstance(iterable, (ChunkedSeq, LazySeq)):
+        # Already a seq; only an empty one becomes nil
         return iterable if iterable else None
+    if isinstance(iterable, Vector):
+        return iterable.to_seq()
     # For Map, return [key value] pairs
-    if isinstance(iterable, Map):
+    if isinstance(iterable, (Map, IntMap)):
         result = None
         for k, v in reversed(list(iterable.items())):
             result = Cons(vec(k, v), result)
@@ -432,6 +463,9 @@ def lazy_seq(iterable):
         return None
     if isinstance(iterable, LazySeq):
         return iterable
+    if isinstance(iterable, _CHUNKED):
+        # Realized a chunk at a time already
+        return seq(iterable)
     if isinstance(iterable, Cons):
         # Wrap Cons iteration in LazySeq
         def cons_iter():
@@ -442,7 +476,7 @@ def lazy_seq(iterable):
 
         return LazySeq(cons_iter())
     # For Map, return [key value] pairs lazily
-    if isinstance(iterable, Map):
+    if isinstance(iterable, (Map, IntMap)):
 
         def map_pairs():
             for k, v in iterable.items():
@@ -474,6 +508,13 @@ def nth(coll, index, default=_MISSING):
     if isinstance(coll, SortedVector):
         return coll.nth(index, default) if default is not _MISSING else coll.nth(index)
 
+    if isinstance(coll, ChunkedSeq) and index >= 0:
+        for x in islice(coll, index, None):
+            return x
+        if default is _MISSING:
+            raise IndexError(f"Index {index} out of range")
+        return default
+
     if isinstance(coll, (Cons, LazySeq)):
         curr = coll
         for _ in range(index):
@@ -505,11 +546,12 @@ def conj(coll, val):
         return coll.conj(val)
     if isinstance(coll, SortedVector):
         return coll.conj(val)
-    if isinstance(coll, Cons):
+    if isinstance(coll, (Cons, ChunkedSeq)):
+        # A Cons cell carries on into a ChunkedSeq rest
         return Cons(val, coll)
-    if isinstance(coll, Set):
+    if isinstance(coll, (Set, IntSet)):
         return coll.conj(val)
-    if isinstance(coll, Map):
+    if isinstance(coll, (Map, IntMap)):
         if isinstance(val, Vector) and len(val) == 2:
             return coll.assoc(val.nth(0), val.nth(1))
         elif isinstance(val, (list, tuple)) and len(val) == 2:
@@ -531,7 +573,7 @@ def assoc(coll, key, val):
         return hash_map(key, val)
     if isinstance(coll, Vector):
         return coll.assoc(key, val)
-    if isinstance(coll, Map):
+    if isinstance(coll, (Map, IntMap)):
         return coll.assoc(key, val)
     if isinstance(coll, dict):
         new_dict = dict(coll)
@@ -544,7 +586,7 @@ def dissoc(coll, key):
     """Remove a key from a map."""
     if coll is None:
         return None
-    if isinstance(coll, Map):
+    if isinstance(coll, (Map, IntMap)):
         return coll.dissoc(key)
     if isinstance(coll, dict):
         new_dict = dict(coll)
@@ -557,7 +599,7 @@ def disj(coll, val):
     """Remove an element from a set or sorted vector."""
     if coll is None:
         return None
-    if isinstance(coll, Set):
+    if isinstance(coll, (Set, IntSet)):
         return coll.disj(val)
     if isinstance(coll, SortedVector):
         return coll.disj(val)
@@ -572,7 +614,7 @@ def get(coll, key, default=None):
     """Get a value from a collection by key."""
     if coll is None:
         return default
-    if isinstance(coll, Map):
+    if isinstance(coll, (Map, IntMap)):
         return coll.get(key, default)
     if isinstance(coll, Vector):
         if isinstance(key, int):
@@ -613,9 +655,9 @@ def contains_q(coll, key):
     """
     if coll is None:
         return False
-    if isinstance(coll, Set):
+    if isinstance(coll, (Set, IntSet)):
         return key in coll
-    if isinstance(coll, Map):
+    if isinstance(coll, (Map, IntMap)):
         return key in coll
     if isinstance(coll, set):
         return key in coll
@@ -642,7 +684,11 @@ def empty(coll):
         return EMPTY_SET
     if isinstance(coll, SortedVector):
         return EMPTY_SORTED_VECTOR
-    if isinstance(coll, Cons):
+    if isinstance(coll, IntMap):
+        return IntMap()
+    if isinstance(coll, IntSet):
+        return IntSet()
+    if isinstance(coll, (Cons, ChunkedSeq)):
         return None
     if isinstance(coll, list):
         return []
@@ -653,35 +699,34 @@ def empty(coll):
     return None
 
 
-def into(to_coll, from_coll):
-    """Add all items from from_coll into to_coll."""
+# Collections with a native reduce(f[, init]) that walks their leaf arrays
+# or nodes directly instead of going through the iterator protocol
+_NATIVE_REDUCIBLE = (Vector, DoubleVector, IntVector, Map, Set)
+
+
+def into(to_coll, *args):
+    """Add all items from from_coll into to_coll.
+
+    (into to from) - add every item of from
+    (into to xform from) - add every item of from after the transducer xform;
+    Vectors, Maps and Sets are filled in one native pass
+    """
+    if len(args) == 2:
+        xform, from_coll = args
+        if isinstance(to_coll, (Vector, Map, Set)):
+            return _into(to_coll, xform, from_coll)
+        return into(to_coll, eduction(xform, from_coll))
+    (from_coll,) = args
     if to_coll is None:
         return seq(from_coll)
-    if isinstance(to_coll, Vector):
-        t = to_coll.transient()
-        for item in from_coll:
-            t.conj_mut(item)
-        return t.persistent()
-    if isinstance(to_coll, Map):
-        t = to_coll.transient()
-        for item in from_coll:
-            if isinstance(item, Vector) and len(item) == 2:
-                t.assoc_mut(item.nth(0), item.nth(1))
-            elif isinstance(item, (list, tuple)) and len(item) == 2:
-                t.assoc_mut(item[0], item[1])
-            else:
-                raise ValueError("into map requires [key value] pairs")
-        return t.persistent()
-    if isinstance(to_coll, Set):
-        t = to_coll.transient()
-        for item in from_coll:
-            t.conj_mut(item)
-        return t.persistent()
+    if isinstance(to_coll, (Vector, Map, Set)):
+        return _into(to_coll, from_coll)
     if isinstance(to_coll, SortedVector):
-        t = to_coll.transient()
-        for item in from_coll:
-            t.conj_mut(item)
-        return t.persistent()
+        return to_coll.merge(from_coll)
+    if isinstance(to_coll, (IntMap, IntSet)):
+        # Merging builds the new keys into a trie first, then joins node by node
+        built = type(to_coll)(from_coll)
+        return to_coll | built if to_coll else built
     if isinstance(to_coll, Cons):
         result = to_coll
         for item in from_coll:
@@ -713,6 +758,8 @@ def transient(coll):
         return coll.transient()
     if isinstance(coll, SortedVector):
         return coll.transient()
+    if isinstance(coll, (IntMap, IntSet)):
+        return coll.transient()
     raise TypeError(f"Don't know how to create transient from {type(coll)}")
 
 
@@ -733,6 +780,8 @@ def persistent_bang(coll):
         return coll.persistent()
     if isinstance(coll, TransientSortedVector):
         return coll.persistent()
+    if isinstance(coll, (TransientIntMap, TransientIntSet)):
+        return coll.persistent()
     raise TypeError(f"Don't know how to make persistent from {type(coll)}")
 
 
@@ -747,13 +796,13 @@ def conj_bang(coll, val):
         return coll.conj_mut(val)
     if isinstance(coll, TransientIntVector):
         return coll.conj_mut(val)
-    if isinstance(coll, TransientMap):
+    if isinstance(coll, (TransientMap, TransientIntMap)):
         if isinstance(val, Vector) and len(val) == 2:
             return coll.assoc_mut(val.nth(0), val.nth(1))
         elif isinstance(val, (list, tuple)) and len(val) == 2:
             return coll.assoc_mut(val[0], val[1])
         raise ValueError("conj! on transient map requires a [key value] pair")
-    if isinstance(coll, TransientSet):
+    if isinstance(coll, (TransientSet, TransientIntSet)):
         return coll.conj_mut(val)
     if isinstance(coll, TransientSortedVector):
         return coll.conj_mut(val)
@@ -767,7 +816,7 @@ def assoc_bang(coll, key, val):
     """
     if isinstance(coll, TransientVector):
         return coll.assoc_mut(key, val)
-    if isinstance(coll, TransientMap):
+    if isinstance(coll, (TransientMap, TransientIntMap)):
         return coll.assoc_mut(key, val)
     raise TypeError(f"Don't know how to assoc! onto {type(coll)}")
 
@@ -777,17 +826,30 @@ def dissoc_bang(coll, key):
 
     Returns the same transient (mutated in place).
     """
-    if isinstance(coll, TransientMap):
+    if isinstance(coll, (TransientMap, TransientIntMap)):
         return coll.dissoc_mut(key)
     raise TypeError(f"Don't know how to dissoc! from {type(coll)}")
 
 
+def update_bang(coll, key, f, *default):
+    """Mutably set key of a transient map or vector to (f old-value).
+
+    A missing map key starts from default (nil if not given). Returns the
+    same transient (mutated in place).
+    """
+    if isinstance(coll, TransientMap):
+        return coll.update_mut(key, f, *default)
+    if isinstance(coll, TransientVector) and not default:
+        return coll.update_mut(key, f)
+    raise TypeError(f"Don't know how to update! {type(coll)}")
+
+
 def disj_bang(coll, val):
     """Mutably remove an element from a transient set or sorted vector.
 
     Returns the same transient (mutated in place).
     """
-    if isinstance(coll, TransientSet):
+    if isinstance(coll, (TransientSet, TransientIntSet)):
         return coll.disj_mut(val)
     if isinstance(coll, TransientSortedVector):
         return coll.disj_mut(val)
@@ -804,6 +866,58 @@ def pop_bang(coll):
     raise TypeError(f"Don't know how to pop! from {type(coll)}")
 
 
+# =============================================================================
+# Atoms
+# =============================================================================
+
+
+def atom(value=None):
+    """Create an Atom: a reference to a value shared between threads.
+
+    Reads never lock; swap! and reset! replace the value atomically.
+    """
+    return Atom(value)
+
+
+def deref(ref):
+    """Return the current value of an Atom."""
+    if isinstance(ref, Atom):
+        return ref.deref()
+    raise TypeError(f"Don't know how to deref {type(ref)}")
+
+
+def swap_bang(ref, f, *args):
+    """Set an Atom's value to (f current & args) and return it.
+
+    f is called again with the newer value if another thread changed the
+    atom first, so it should be free of side effects.
+    """
+    return ref.swap(f, *args)
+
+
+def reset_bang(ref, val):
+    """Set an Atom's value to val, regardless of the current one. Returns val."""
+    return ref.reset(val)
+
+
+def compare_and_set_bang(ref, old, new):
+    """Set an Atom's value to new only if it is currently old (the same object).
+
+    Returns True if the value was set.
+    """
+    return ref.compare_and_set(old, new)
+
+
+def add_watch(ref, key, f):
+    """Call (f key ref old new) after every change to an Atom. Returns the atom."""
+    return ref.add_watch(key, f)
+
+
+def remove_watch(ref, key):
+    """Remove the watch added to an Atom under key. Returns the atom."""
+    return ref.remove_watch(key)
+
+
 # =============================================================================
 # Lazy Sequence Functions (Generators)
 # =============================================================================
@@ -812,13 +926,23 @@ def pop_bang(coll):
 def spork_map(f, *colls):
     """Lazily map a function over one or more collections (generator).
 
+    With no collection: (map f) is a transducer calling f on each element.
     With one collection: (map f coll) yields (f x) for each x in coll.
     With multiple collections: (map f c1 c2 ...) yields (f x1 x2 ...)
     where x1, x2, ... are from c1, c2, ... respectively.
     Stops when the shortest collection is exhausted.
+
+    Over a single Vector or ChunkedSeq the result is a ChunkedSeq, and f
+    runs over a whole chunk (up to 32 items) the first time any of it is needed.
     """
     if not colls:
-        return
+        return xf_map(f)
+    if len(colls) == 1 and isinstance(colls[0], _CHUNKED):
+        return chunked_seq([f(x) for x in chunk] for chunk in chunks(colls[0]))
+    return _map_items(f, colls)
+
+
+def _map_items(f, colls):
     if len(colls) == 1:
         for x in colls[0]:
             yield f(x)
@@ -832,8 +956,20 @@ def spork_map(f, *colls):
                 return
 
 
-def spork_filter(pred, coll):
-    """Lazily filter a collection by a predicate (generator)."""
+def spork_filter(pred, coll=_MISSING):
+    """Lazily filter a collection by a predicate (generator).
+
+    Over a Vector or ChunkedSeq the result is a ChunkedSeq filtered a chunk at a time.
+    Without a collection, (filter pred) is a transducer.
+    """
+    if coll is _MISSING:
+        return xf_filter(pred)
+    if isinstance(coll, _CHUNKED):
+        return chunked_seq([x for x in chunk if pred(x)] for chunk in chunks(coll))
+    return _filter_items(pred, coll)
+
+
+def _filter_items(pred, coll):
     if coll is None:
         return
     for x in coll:
@@ -841,8 +977,29 @@ def spork_filter(pred, coll):
             yield x
 
 
-def take(n, coll):
-    """Lazily take the first n elements from a collection (generator)."""
+def take(n, coll=_MISSING):
+    """Lazily take the first n elements from a collection (generator).
+
+    Over a Vector or ChunkedSeq the result is a ChunkedSeq sharing its chunks.
+    Without a collection, (take n) is a transducer that stops its source after n.
+    """
+    if coll is _MISSING:
+        return xf_take(n)
+    if isinstance(coll, _CHUNKED) and n > 0:
+        return chunked_seq(_take_chunks(n, coll))
+    return _take_items(n, coll)
+
+
+def _take_chunks(n, coll):
+    for chunk in chunks(coll):
+        if len(chunk) >= n:
+            yield chunk[:n]
+            return
+        yield chunk
+        n -= len(chunk)
+
+
+def _take_items(n, coll):
     if coll is None or n <= 0:
         return
     count = 0
@@ -894,7 +1051,18 @@ def drop_while(pred, coll):
 
 
 def concat(*colls):
-    """Lazily concatenate multiple collections (generator)."""
+    """Lazily concatenate multiple collections (generator).
+
+    When every collection is a Vector or ChunkedSeq (or nil) the result is a
+    ChunkedSeq over their chunks.
+    """
+    present = [coll for coll in colls if coll is not None]
+    if present and all(isinstance(coll, _CHUNKED) for coll in present):
+        return chunked_seq(chunk for coll in present for chunk in chunks(coll))
+    return _concat_items(colls)
+
+
+def _concat_items(colls):
     for coll in colls:
         if coll is not None:
             yield from coll
@@ -984,12 +1152,19 @@ def interpose(sep, coll):
         yield x
 
 
-def partition(n, coll, step=None, pad=None):
+def partition(n, coll=_MISSING, step=None, pad=None):
     """Lazily partition a collection into chunks of n items (generator).
 
     step: how many items to advance (default: n)
     pad: collection to use to pad the last chunk if incomplete (default: None, drop incomplete)
+    Without a collection, (partition n) is a transducer grouping into Vectors of n.
     """
+    if coll is _MISSING:
+        return xf_partition(n)
+    return _partition_items(n, coll, step, pad)
+
+
+def _partition_items(n, coll, step, pad):
     if coll is None or n <= 0:
         return
     if step is None:
@@ -1014,8 +1189,17 @@ def partition(n, coll, step=None, pad=None):
         i += step
 
 
-def partition_all(n, coll, step=None):
-    """Lazily partition a collection, including incomplete final chunk (generator)."""
+def partition_all(n, coll=_MISSING, step=None):
+    """Lazily partition a collection, including incomplete final chunk (generator).
+
+    Without a collection, (partition-all n) is a transducer.
+    """
+    if coll is _MISSING:
+        return xf_partition(n, all=True)
+    return _partition_all_items(n, coll, step)
+
+
+def _partition_all_items(n, coll, step):
     if coll is None or n <= 0:
         return
     if step is None:
@@ -1157,9 +1341,13 @@ def reduce(f, *args):
 
     (reduce f coll) - reduces with no initial value
     (reduce f init coll) - reduces with initial value
+
+    Vectors, maps and sets are folded natively, a leaf at a time.
     """
     if len(args) == 1:
         coll = args[0]
+        if isinstance(coll, _NATIVE_REDUCIBLE):
+            return coll.reduce(f)
         it = iter(coll)
         try:
             acc = next(it)
@@ -1170,6 +1358,8 @@ def reduce(f, *args):
         return acc
     elif len(args) == 2:
         init, coll = args
+        if isinstance(coll, _NATIVE_REDUCIBLE):
+            return coll.reduce(f, init)
         acc = init
         for x in coll:
             acc = f(acc, x)
@@ -1211,48 +1401,6 @@ def reductions(f, *args):
 # =============================================================================
 
 
-def zipmap(keys, vals):
-    """Return a Map with keys mapped to corresponding vals."""
-    result = EMPTY_MAP
-    if result is None:
-        # pds not initialized yet, return dict
-        return dict(zip(keys, vals))
-    t = result.transient()
-    for k, v in zip(keys, vals):
-        t.assoc_mut(k, v)
-    return t.persistent()
-
-
-def group_by(f, coll):
-    """Return a Map of elements grouped by the result of f."""
-    result = {}
-    for x in coll:
-        key = f(x)
-        if key not in result:
-            result[key] = []
-        result[key].append(x)
-    # Convert to Map with Vector values
-    if EMPTY_MAP is not None:
-        t = EMPTY_MAP.transient()
-        for k, v in result.items():
-            t.assoc_mut(k, vec(*v))
-        return t.persistent()
-    return result
-
-
-def frequencies(coll):
-    """Return a Map of elements to their counts."""
-    result = {}
-    for x in coll:
-        result[x] = result.get(x, 0) + 1
-    if EMPTY_MAP is not None:
-        t = EMPTY_MAP.transient()
-        for k, v in result.items():
-            t.assoc_mut(k, v)
-        return t.persistent()
-    return result
-
-
 def reverse(coll):
     """Return a lazy reversed sequence (realizes collection first)."""
     if coll is None:
@@ -1317,6 +1465,8 @@ def realized_q(coll):
     """Return True if the collection is fully realized (not a generator)."""
     import types
 
+    if isinstance(coll, ChunkedSeq):
+        return coll.realized
     return not isinstance(coll, types.GeneratorType)
 
 
@@ -1523,14 +1673,25 @@ __all__ = [
     "contains_q",
     "empty",
     "into",
+    "transduce",
+    "eduction",
     # Transient operations
     "transient",
     "persistent_bang",
     "conj_bang",
     "assoc_bang",
     "dissoc_bang",
+    "update_bang",
     "disj_bang",
     "pop_bang",
+    # Atoms
+    "atom",
+    "deref",
+    "swap_bang",
+    "reset_bang",
+    "compare_and_set_bang",
+    "add_watch",
+    "remove_watch",
     # Lazy sequences
     "spork_map",
     "spork_filter",
@@ -1563,6 +1724,7 @@ __all__ = [
     "reductions",
     # Collection utilities
     "zipmap",
+    "diff",
     "group_by",
     "frequencies",
     "reverse",
@@ -18,9 +18,10 @@ Usage:
 """
 
 import json
-from typing import Any, TextIO
+from typing import Any, Iterable, Iterator, TextIO
 
 from spork.runtime.pds import (
+    ChunkedSeq,
     Cons,
     DoubleVector,
     IntVector,
@@ -32,6 +33,8 @@ from spork.runtime.pds import (
     TransientVector,
     Vector,
     hash_map,
+    json_lines,
+    json_loads,
     vec,
 )
 from spork.runtime.types import Keyword, Symbol
@@ -89,8 +92,8 @@ class SporkJSONEncoder(json.JSONEncoder):
         if isinstance(o, (Set, TransientSet)):
             return list(o)
 
-        # Cons (linked list) -> list
-        if isinstance(o, Cons):
+        # Cons (linked list) and chunked seqs -> list
+        if isinstance(o, (Cons, ChunkedSeq)):
             return list(o)
 
         # Keyword -> string with colon prefix
@@ -280,9 +283,9 @@ def loads_spork(
     """
     Parse a JSON string and convert to Spork persistent data structures.
 
-    This parses the JSON and then converts:
-    - dict -> Map
-    - list -> Vector
+    Objects become Maps and arrays become Vectors. Without extra json.loads
+    arguments the native decoder (pds.json_loads) parses straight into
+    them, never building the intermediate dicts and lists.
 
     Args:
         s: The JSON string to parse.
@@ -299,6 +302,8 @@ def loads_spork(
         >>> loads_spork('{"x": 1}', keywordize_keys=True)
         {:x 1}
     """
+    if not kwargs:
+        return json_loads(s, keywordize_keys=keywordize_keys)
     parsed = json.loads(s, **kwargs)
     return _to_spork(parsed, keywordize_keys)
 
@@ -312,9 +317,8 @@ def load_spork(
     """
     Parse JSON from a file and convert to Spork persistent data structures.
 
-    This parses the JSON and then converts:
-    - dict -> Map
-    - list -> Vector
+    Objects become Maps and arrays become Vectors, decoded natively as in
+    loads_spork.
 
     Args:
         fp: A file-like object with a read() method.
@@ -329,10 +333,40 @@ def load_spork(
         >>> with open("data.json") as f:
         ...     data = load_spork(f, keywordize_keys=True)
     """
+    if not kwargs:
+        return json_loads(fp.read(), keywordize_keys=keywordize_keys)
     parsed = json.load(fp, **kwargs)
     return _to_spork(parsed, keywordize_keys)
 
 
+def load_lines_spork(
+    source: str | bytes | Iterable[Any],
+    *,
+    keywordize_keys: bool = False,
+) -> Iterator[Any]:
+    """
+    Iterate over newline-delimited JSON, one Spork value per line.
+
+    Blank lines are skipped. Object keys are shared across lines, so a
+    stream of records with the same fields holds one copy of each key.
+
+    Args:
+        source: A str or bytes holding every line, or an iterable of lines
+            such as an open text or binary file.
+        keywordize_keys: If True, convert string keys to Keywords.
+
+    Returns:
+        An iterator of parsed values, decoded lazily.
+
+    Example:
+        >>> from spork.runtime.json import load_lines_spork
+        >>> with open("events.jsonl") as f:
+        ...     for event in load_lines_spork(f, keywordize_keys=True):
+        ...         handle(event)
+    """
+    return json_lines(source, keywordize_keys=keywordize_keys)
+
+
 __all__ = [
     "SporkJSONEncoder",
     "dumps",
@@ -341,4 +375,5 @@ __all__ = [
     "load",
     "loads_spork",
     "load_spork",
+    "load_lines_spork",
 ]
@@ -1,8 +1,9 @@
 // pds.c - Persistent Data Structures for spork
-// C implementation of Vector (bit-partitioned trie) and Map (HAMT)
+// C implementation of Vector (relaxed radix balanced trie) and Map (HAMT)
 // Includes type-specialized vectors: DoubleVector, IntVector
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdint.h>
 
@@ -32,7 +33,273 @@ static int _singletons_initialized = 0;
 
 #if defined(_MSC_VER)
 #include <intrin.h>
+#define PDS_THREAD_LOCAL __declspec(thread)
+#else
+#define PDS_THREAD_LOCAL _Thread_local
+#endif
+
+// Lazily computed caches (hashes, node entry counts, flat buffers) are
+// filled in by whichever reader needs them first. On free-threaded builds
+// the flag is published with a release store after the value is written,
+// and read with an acquire load, so a reader that sees the flag also sees
+// the value. Racing writers store identical values.
+#if HAVE_STDATOMIC && defined(Py_GIL_DISABLED)
+#define PDS_CACHE_READY(flag) atomic_load_explicit((_Atomic(int) *)&(flag), memory_order_acquire)
+#define PDS_CACHE_PUBLISH(flag) atomic_store_explicit((_Atomic(int) *)&(flag), 1, memory_order_release)
+#define PDS_SSIZE_LOAD(field) atomic_load_explicit((_Atomic(Py_ssize_t) *)&(field), memory_order_relaxed)
+#define PDS_SSIZE_STORE(field, v) atomic_store_explicit((_Atomic(Py_ssize_t) *)&(field), (v), memory_order_relaxed)
+#else
+#define PDS_CACHE_READY(flag) (flag)
+#define PDS_CACHE_PUBLISH(flag) ((flag) = 1)
+#define PDS_SSIZE_LOAD(field) (field)
+#define PDS_SSIZE_STORE(field, v) ((field) = (v))
+#endif
+
+// =============================================================================
+// INSTRUMENTATION
+// =============================================================================
+// Optional counters for node allocations, path copies, hash collisions and
+// buffer flattening, read back with pds.stats(). They are compiled in with
+// -DPDS_ENABLE_STATS=1 (PDS_STATS=1 when building through setup.py) and
+// compile away otherwise, in which case stats() reports zeros.
+
+#ifndef PDS_ENABLE_STATS
+#define PDS_ENABLE_STATS 0
+#endif
+
+typedef enum {
+    PDS_NODE_VECTOR,
+    PDS_NODE_DOUBLE_VECTOR,
+    PDS_NODE_INT_VECTOR,
+    PDS_NODE_BITMAP_INDEXED,
+    PDS_NODE_ARRAY,
+    PDS_NODE_HASH_COLLISION,
+    PDS_NODE_SORTED,
+    PDS_NODE_INT_MAP,
+    PDS_NODE_ARRAY_MAP,
+    PDS_NODE_KINDS
+} PdsNodeKind;
+
+static const char *const PDS_NODE_KIND_NAMES[PDS_NODE_KINDS] = {
+    "VectorNode", "DoubleVectorNode", "IntVectorNode", "BitmapIndexedNode",
+    "ArrayNode", "HashCollisionNode", "SortedNode", "IntMapNode", "ArrayMapNode",
+};
+
+typedef struct {
+    Py_ssize_t allocs[PDS_NODE_KINDS];
+    Py_ssize_t copies[PDS_NODE_KINDS];  // path copies: nodes rebuilt from an existing one
+    Py_ssize_t collisions;              // collision nodes started by two distinct keys
+    Py_ssize_t flatten_calls;
+    Py_ssize_t flatten_bytes;
+} PdsStats;
+
+#if PDS_ENABLE_STATS
+static PdsStats pds_stats;
+
+static inline void pds_stat_add(Py_ssize_t *counter, Py_ssize_t n) {
+#if HAVE_STDATOMIC && defined(Py_GIL_DISABLED)
+    atomic_fetch_add_explicit((_Atomic(Py_ssize_t) *)counter, n, memory_order_relaxed);
+#else
+    *counter += n;
+#endif
+}
+
+#define PDS_STAT_ADD(field, n) pds_stat_add(&pds_stats.field, (n))
+#else
+#define PDS_STAT_ADD(field, n) ((void)0)
+#endif
+
+#define PDS_STAT_ALLOC(kind) PDS_STAT_ADD(allocs[kind], 1)
+#define PDS_STAT_COPY(kind) PDS_STAT_ADD(copies[kind], 1)
+
+// =============================================================================
+// FREELISTS
+// =============================================================================
+// Objects built and dropped at high rates by conj / assoc chains (trie nodes,
+// small map nodes, SortedVector B+tree nodes, Cons cells and the Vector, Map
+// and Set headers) are
+// recycled through per-type freelists instead of going back to the
+// allocator. A dealloc pushes the dead object, chained through the word after
+// its header, and the matching create pops it and re-initialises the header
+// with PyObject_Init; the create then sets every field, as it does for fresh
+// memory. Variable-size nodes get one list per slot count. Each list keeps at
+// most pds_freelist_limit objects (set_freelist_limit) and counts its hits
+// and misses for freelists().
+//
+// Free-threaded builds give each thread its own set of lists, so a create or
+// dealloc never touches a list another thread can see. An object freed on one
+// thread goes onto that thread's lists, whichever thread built it. A thread's
+// lists are set up on its first create and kept alive by a capsule in its
+// thread state dict, so they are freed with the thread state; a thread that
+// runs pds code after that (rare: a C thread reusing PyGILState_Ensure) goes
+// without. -DPDS_FREELISTS=0 compiles the lists out on any build.
+
+#ifndef PDS_FREELISTS
+#define PDS_FREELISTS 1
+#endif
+
+#define PDS_FREELIST_LIMIT 256  // default number of objects kept per list
+
+typedef struct PdsFreeItem {
+    PyObject ob_base;
+    struct PdsFreeItem *next;
+} PdsFreeItem;
+
+typedef struct {
+    PdsFreeItem *head;
+    Py_ssize_t size;
+    Py_ssize_t hits;
+    Py_ssize_t misses;
+} PdsFreeList;
+
+static Py_ssize_t pds_freelist_limit = PDS_FREELIST_LIMIT;
+
+#define PDS_BIN_FREELIST_PAIRS 16  // BitmapIndexedNodes of up to 16 pairs are recycled
+#define PDS_ARRAY_MAP_FREELIST_PAIRS 8  // every ArrayMapNode size (ARRAY_MAP_MAX)
+
+typedef struct {
+    PdsFreeList vector_node, double_node, int_node, array_node;
+    PdsFreeList sorted_node;  // leaves and branches alike; a branch's sizes are freed first
+    PdsFreeList bin[PDS_BIN_FREELIST_PAIRS + 1];  // by pair count
+    PdsFreeList array_map[PDS_ARRAY_MAP_FREELIST_PAIRS + 1];  // by entry count
+    PdsFreeList cons, vector, map, set, chunked_seq;
+} PdsFreeLists;
+
+// Free objects past limit
+static void pds_freelist_trim(PdsFreeList *fl, Py_ssize_t limit) {
+    while (fl->size > limit) {
+        PdsFreeItem *item = fl->head;
+        fl->head = item->next;
+        fl->size--;
+        PyObject_Free(item);
+    }
+}
+
+static void pds_freelists_trim(PdsFreeLists *lists, Py_ssize_t limit) {
+    PdsFreeList *fl = (PdsFreeList *)lists;
+    for (size_t i = 0; i < sizeof(PdsFreeLists) / sizeof(PdsFreeList); i++) {
+        pds_freelist_trim(&fl[i], limit);
+    }
+}
+
+#if PDS_FREELISTS && defined(Py_GIL_DISABLED)
+#define PDS_FREELISTS_CAPSULE "spork.runtime.pds.freelists"
+
+static PDS_THREAD_LOCAL PdsFreeLists *pds_thread_lists = NULL;
+static PdsFreeLists pds_no_lists;  // pds_thread_lists of a thread that goes without
+
+// Capsule destructor, run as the thread state dict is cleared (usually on
+// the owning thread; on another after fork, or at shutdown, when the owner
+// no longer runs)
+static void pds_freelists_release(PyObject *capsule) {
+    PdsFreeLists *lists = PyCapsule_GetPointer(capsule, PDS_FREELISTS_CAPSULE);
+    if (lists == NULL) return;
+    pds_freelists_trim(lists, 0);
+    if (pds_thread_lists == lists) pds_thread_lists = &pds_no_lists;
+    PyMem_RawFree(lists);
+}
+
+// The calling thread's first create: give it lists, or none if that fails
+static PdsFreeLists *pds_freelists_attach(void) {
+    pds_thread_lists = &pds_no_lists;
+    PyObject *type, *value, *tb;  // a dealloc-time create may run with an error set
+    PyErr_Fetch(&type, &value, &tb);
+    PyObject *dict = PyThreadState_GetDict();
+    PdsFreeLists *lists = dict ? PyMem_RawCalloc(1, sizeof(PdsFreeLists)) : NULL;
+    PyObject *capsule = lists ? PyCapsule_New(lists, PDS_FREELISTS_CAPSULE, pds_freelists_release) : NULL;
+    if (capsule && PyDict_SetItemString(dict, PDS_FREELISTS_CAPSULE, capsule) == 0) {
+        pds_thread_lists = lists;
+    } else if (!capsule) {
+        PyMem_RawFree(lists);
+    }
+    Py_XDECREF(capsule);  // frees lists via the destructor if it was not stored
+    PyErr_Restore(type, value, tb);
+    return pds_thread_lists;
+}
+
+static inline PdsFreeLists *pds_current_freelists(void) {
+    PdsFreeLists *lists = pds_thread_lists;
+    if (lists == NULL) lists = pds_freelists_attach();
+    return lists == &pds_no_lists ? NULL : lists;
+}
+#else
+static PdsFreeLists pds_freelists;
+
+static inline PdsFreeLists *pds_current_freelists(void) {
+    return &pds_freelists;
+}
+#endif
+
+// The calling thread's list at offset into PdsFreeLists, NULL if it has none
+static inline PdsFreeList *pds_freelist_at(size_t offset) {
+    PdsFreeLists *lists = pds_current_freelists();
+    return lists ? (PdsFreeList *)((char *)lists + offset) : NULL;
+}
+
+#define PDS_FL(field) pds_freelist_at(offsetof(PdsFreeLists, field))
+#define PDS_FL_AT(field, i) pds_freelist_at(offsetof(PdsFreeLists, field) + (size_t)(i) * sizeof(PdsFreeList))
+
+#ifdef Py_GIL_DISABLED
+// set_freelist_limit trims only the calling thread's lists; other threads
+// drop their surplus on their next create from that list
+#define PDS_FREELIST_CATCH_UP(fl) \
+    do { \
+        Py_ssize_t _limit = PDS_SSIZE_LOAD(pds_freelist_limit); \
+        if ((fl)->size > _limit) pds_freelist_trim((fl), _limit); \
+    } while (0)
+#else
+#define PDS_FREELIST_CATCH_UP(fl) ((void)0)
+#endif
+
+// An object of type, from fl when it has one waiting
+static inline PyObject *pds_alloc(PdsFreeList *fl, PyTypeObject *type) {
+#if PDS_FREELISTS
+    if (fl) {
+        PDS_FREELIST_CATCH_UP(fl);
+        PdsFreeItem *item = fl->head;
+        if (item) {
+            fl->head = item->next;
+            fl->size--;
+            fl->hits++;
+            return PyObject_Init((PyObject *)item, type);
+        }
+        fl->misses++;
+    }
+#endif
+    return PyObject_New(PyObject, type);
+}
+
+// A variable-size object of type with n items; fl only ever holds that size
+static inline PyObject *pds_alloc_var(PdsFreeList *fl, PyTypeObject *type, Py_ssize_t n) {
+#if PDS_FREELISTS
+    if (fl) {
+        PDS_FREELIST_CATCH_UP(fl);
+        PdsFreeItem *item = fl->head;
+        if (item) {
+            fl->head = item->next;
+            fl->size--;
+            fl->hits++;
+            return (PyObject *)PyObject_InitVar((PyVarObject *)item, type, n);
+        }
+        fl->misses++;
+    }
+#endif
+    return (PyObject *)PyObject_NewVar(PyVarObject, type, n);
+}
+
+// Last step of a dealloc: keep op on fl when it is exactly of type (not a
+// subclass) and fl has room, free it otherwise
+static inline void pds_recycle(PdsFreeList *fl, PyObject *op, PyTypeObject *type) {
+#if PDS_FREELISTS
+    if (fl && Py_TYPE(op) == type && fl->size < PDS_SSIZE_LOAD(pds_freelist_limit)) {
+        ((PdsFreeItem *)op)->next = fl->head;
+        fl->head = (PdsFreeItem *)op;
+        fl->size++;
+        return;
+    }
 #endif
+    Py_TYPE(op)->tp_free(op);
+}
 
 // =============================================================================
 // SENTINEL TYPE
@@ -166,6 +433,118 @@ static inline int bitmap_index(unsigned int bitmap, unsigned int bit) {
     return ctpop(bitmap & (bit - 1));
 }
 
+// 31^n in wrapping arithmetic: what n further elements multiply the hash of
+// the elements before them by under the vector hash h = 31 * h + hash(x)
+static inline Py_uhash_t pds_pow31(Py_ssize_t n) {
+    Py_uhash_t result = 1, base = 31;
+    while (n > 0) {
+        if (n & 1) result *= base;
+        base *= base;
+        n >>= 1;
+    }
+    return result;
+}
+
+// Checked int64 arithmetic for the IntVector kernels; return 1 on overflow
+static inline int i64_add_overflow(int64_t a, int64_t b, int64_t *r) {
+#ifdef __GNUC__
+    return __builtin_add_overflow(a, b, r);
+#else
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) return 1;
+    *r = a + b;
+    return 0;
+#endif
+}
+
+static inline int i64_sub_overflow(int64_t a, int64_t b, int64_t *r) {
+#ifdef __GNUC__
+    return __builtin_sub_overflow(a, b, r);
+#else
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) return 1;
+    *r = a - b;
+    return 0;
+#endif
+}
+
+static inline int i64_mul_overflow(int64_t a, int64_t b, int64_t *r) {
+#ifdef __GNUC__
+    return __builtin_mul_overflow(a, b, r);
+#else
+    if (a != 0 && b != 0) {
+        if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN)) return 1;
+        if (a != -1 && b != -1 && ((a * b) / b != a)) return 1;
+    }
+    *r = a * b;
+    return 0;
+#endif
+}
+
+// Operator argument of the typed-vector compare kernels: "<", "<=", ">", ">=", "==" or "!="
+static int kernel_cmp_op(PyObject *op) {
+    static const char *names[] = {"<", "<=", "==", "!=", ">", ">="};  // Py_LT .. Py_GE order
+    const char *s = PyUnicode_Check(op) ? PyUnicode_AsUTF8(op) : NULL;
+    for (int i = 0; s != NULL && i < 6; i++) {
+        if (strcmp(s, names[i]) == 0) return i;
+    }
+    PyErr_SetString(PyExc_ValueError, "comparison must be one of '<', '<=', '==', '!=', '>', '>='");
+    return -1;
+}
+
+// Operator argument of the typed-vector map_scalar kernels: "+", "-", "*" or "/"
+static int kernel_arith_op(PyObject *op) {
+    const char *s = PyUnicode_Check(op) ? PyUnicode_AsUTF8(op) : NULL;
+    if (s != NULL && s[0] != '\0' && s[1] == '\0' && strchr("+-*/", s[0]) != NULL) {
+        return s[0];
+    }
+    PyErr_SetString(PyExc_ValueError, "operator must be one of '+', '-', '*', '/'");
+    return -1;
+}
+
+// One step of a native reduce: *acc = f(*acc, item). A NULL *acc means no
+// initial value was given, so the first item becomes the accumulator.
+static inline int reduce_step(PyObject *f, PyObject **acc, PyObject *item) {
+    if (*acc == NULL) {
+        Py_INCREF(item);
+        *acc = item;
+        return 0;
+    }
+    PyObject *args[2] = {*acc, item};
+    PyObject *result = PyObject_Vectorcall(f, args, 2, NULL);
+    if (!result) return -1;
+    Py_SETREF(*acc, result);
+    return 0;
+}
+
+// Copy `words` 8-byte words between native and little-endian order, the byte
+// order of pickled typed-vector data and key hashes
+static inline void le64_copy(char *dst, const char *src, Py_ssize_t words) {
+#if PY_LITTLE_ENDIAN
+    memcpy(dst, src, words * 8);
+#else
+    for (Py_ssize_t i = 0; i < words; i++) {
+        for (int b = 0; b < 8; b++) dst[8 * i + b] = src[8 * i + 7 - b];
+    }
+#endif
+}
+
+// Pickle payload for the bytes-like obj: a PickleBuffer under protocol 5, so
+// the pickler may hand it out of band, otherwise obj itself. Steals obj.
+static PyObject *pickle_payload(PyObject *obj, long protocol) {
+    if (obj == NULL || protocol < 5) return obj;
+    PyObject *buf = PyPickleBuffer_FromObject(obj);
+    Py_DECREF(obj);
+    return buf;
+}
+
+// Module-level function `name`, the reconstructor named in a __reduce__ result
+static PyObject *pds_module_function(const char *name) {
+    PyObject *module = PyImport_ImportModule("spork.runtime.pds");
+    if (module == NULL) return NULL;
+    PyObject *fn = PyObject_GetAttrString(module, name);
+    Py_DECREF(module);
+    return fn;
+}
+
 // === Forward declarations ===
 typedef struct VectorNode VectorNode;
 typedef struct Vector Vector;
@@ -186,7 +565,7 @@ typedef struct Set Set;
 typedef struct TransientSet TransientSet;
 typedef struct SetIterator SetIterator;
 typedef struct Cons Cons;
-typedef struct RBNode RBNode;
+typedef struct SortedNode SortedNode;
 typedef struct SortedVector SortedVector;
 typedef struct TransientSortedVector TransientSortedVector;
 typedef struct SortedVectorIterator SortedVectorIterator;
@@ -213,6 +592,9 @@ typedef struct {
 
     PyObject *EMPTY_SORTED_VECTOR;
 
+    PyObject *EMPTY_INT_MAP;
+    PyObject *EMPTY_INT_SET;
+
     // Internal nodes (not exposed to Python, but needed for cleanup)
     PyObject *EMPTY_NODE;
     PyObject *EMPTY_DOUBLE_NODE;
@@ -236,11 +618,25 @@ typedef struct Cons {
 } Cons;
 
 static PyTypeObject ConsType;
+static PyTypeObject ChunkedSeqType;
+static PyTypeObject ChunkedSeqIteratorType;
+static PyTypeObject EductionType;
+
+// A Cons list may end in a ChunkedSeq (conj onto one, or cons onto the rest
+// of a Vector); length, hash, equality, repr and iteration carry on into it
+static inline int Cons_is_chunked_tail(PyObject *rest) {
+    return PyObject_TypeCheck(rest, &ChunkedSeqType);
+}
 
 static void Cons_dealloc(Cons *self) {
     Py_XDECREF(self->first);
     Py_XDECREF(self->rest);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    pds_recycle(PDS_FL(cons), (PyObject *)self, &ConsType);
+}
+
+// Cons cell for the caller to fill in
+static inline Cons *Cons_alloc(void) {
+    return (Cons *)pds_alloc(PDS_FL(cons), &ConsType);
 }
 
 static PyObject *Cons_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
@@ -308,11 +704,16 @@ static Py_ssize_t Cons_length(Cons *self) {
         count++;
         curr = ((Cons *)curr)->rest;
     }
+    if (Cons_is_chunked_tail(curr)) {
+        Py_ssize_t n = PyObject_Length(curr);
+        if (n < 0) return -1;
+        count += n;
+    }
     return count;
 }
 
 static Py_hash_t Cons_hash(Cons *self) {
-    if (self->hash_computed) {
+    if (PDS_CACHE_READY(self->hash_computed)) {
         return self->hash;
     }
 
@@ -327,12 +728,61 @@ static Py_hash_t Cons_hash(Cons *self) {
         h = 31 * h + item_hash;
         curr = c->rest;
     }
+    if (Cons_is_chunked_tail(curr)) {
+        PyObject *it = PyObject_GetIter(curr);
+        if (!it) return -1;
+        PyObject *item;
+        while ((item = PyIter_Next(it)) != NULL) {
+            Py_hash_t item_hash = PyObject_Hash(item);
+            Py_DECREF(item);
+            if (item_hash == -1) {
+                Py_DECREF(it);
+                return -1;
+            }
+            h = 31 * h + item_hash;
+        }
+        Py_DECREF(it);
+        if (PyErr_Occurred()) return -1;
+    }
 
     self->hash = h;
-    self->hash_computed = 1;
+    PDS_CACHE_PUBLISH(self->hash_computed);
     return h;
 }
 
+// Whether the seqs a and b (each Py_None, a Cons or a ChunkedSeq) hold equal
+// elements in order; 1, 0, or -1 with an exception set
+static int Cons_tails_equal(PyObject *a, PyObject *b) {
+    PyObject *ia = a == Py_None ? NULL : PyObject_GetIter(a);
+    if (!ia && a != Py_None) return -1;
+    PyObject *ib = b == Py_None ? NULL : PyObject_GetIter(b);
+    if (!ib && b != Py_None) {
+        Py_XDECREF(ia);
+        return -1;
+    }
+    int equal = 1;
+    while (equal == 1) {
+        PyObject *x = ia ? PyIter_Next(ia) : NULL;
+        if (!x && PyErr_Occurred()) {
+            equal = -1;
+            break;
+        }
+        PyObject *y = ib ? PyIter_Next(ib) : NULL;
+        if (!x || !y) {
+            equal = PyErr_Occurred() ? -1 : x == y;
+            Py_XDECREF(x);
+            Py_XDECREF(y);
+            break;
+        }
+        equal = PyObject_RichCompareBool(x, y, Py_EQ);
+        Py_DECREF(x);
+        Py_DECREF(y);
+    }
+    Py_XDECREF(ia);
+    Py_XDECREF(ib);
+    return equal;
+}
+
 static PyObject *Cons_richcompare(Cons *self, PyObject *other, int op) {
     if (op != Py_EQ && op != Py_NE) {
         Py_RETURN_NOTIMPLEMENTED;
@@ -342,6 +792,9 @@ static PyObject *Cons_richcompare(Cons *self, PyObject *other, int op) {
         return PyBool_FromLong(op == Py_EQ);
     }
 
+    if (PyObject_TypeCheck(other, &ChunkedSeqType)) {
+        Py_RETURN_NOTIMPLEMENTED;  // compared by ChunkedSeq_richcompare
+    }
     if (!PyObject_TypeCheck(other, &ConsType)) {
         return PyBool_FromLong(op == Py_NE);
     }
@@ -365,6 +818,11 @@ static PyObject *Cons_richcompare(Cons *self, PyObject *other, int op) {
         b = cb->rest;
     }
 
+    if (Cons_is_chunked_tail(a) || Cons_is_chunked_tail(b)) {
+        int equal = Cons_tails_equal(a, b);
+        if (equal < 0) return NULL;
+        return PyBool_FromLong(op == Py_EQ ? equal : !equal);
+    }
     int both_none = (a == Py_None && b == Py_None);
     return PyBool_FromLong((op == Py_EQ) ? both_none : !both_none);
 }
@@ -389,6 +847,25 @@ static PyObject *Cons_repr(Cons *self) {
         Py_DECREF(repr);
         curr = c->rest;
     }
+    if (Cons_is_chunked_tail(curr)) {
+        PyObject *it = PyObject_GetIter(curr);
+        PyObject *item;
+        while (it && (item = PyIter_Next(it)) != NULL) {
+            PyObject *repr = PyObject_Repr(item);
+            Py_DECREF(item);
+            if (!repr || PyList_Append(parts, repr) < 0) {
+                Py_XDECREF(repr);
+                Py_CLEAR(it);
+                break;
+            }
+            Py_DECREF(repr);
+        }
+        Py_XDECREF(it);
+        if (PyErr_Occurred()) {
+            Py_DECREF(parts);
+            return NULL;
+        }
+    }
 
     PyObject *space = PyUnicode_FromString(" ");
     if (!space) {
@@ -407,7 +884,7 @@ static PyObject *Cons_repr(Cons *self) {
 }
 
 static PyObject *Cons_conj(Cons *self, PyObject *val) {
-    Cons *new_cons = (Cons *)ConsType.tp_alloc(&ConsType, 0);
+    Cons *new_cons = Cons_alloc();
     if (!new_cons) return NULL;
 
     new_cons->first = val;
@@ -444,7 +921,7 @@ static PySequenceMethods Cons_as_sequence = {
     .sq_length = (lenfunc)Cons_length,
 };
 
-// Cons iterator
+// Cons iterator; curr becomes an iterator over a ChunkedSeq tail on reaching one
 typedef struct {
     PyObject_HEAD
     PyObject *curr;
@@ -458,6 +935,14 @@ static void ConsIterator_dealloc(ConsIterator *self) {
 }
 
 static PyObject *ConsIterator_next(ConsIterator *self) {
+    if (Cons_is_chunked_tail(self->curr)) {
+        PyObject *it = PyObject_GetIter(self->curr);
+        if (!it) return NULL;
+        Py_SETREF(self->curr, it);
+    }
+    if (Py_TYPE(self->curr) == &ChunkedSeqIteratorType) {
+        return Py_TYPE(self->curr)->tp_iternext(self->curr);
+    }
     if (self->curr == Py_None || !PyObject_TypeCheck(self->curr, &ConsType)) {
         return NULL;  // StopIteration
     }
@@ -513,10 +998,21 @@ static PyTypeObject ConsType = {
 };
 
 // === VectorNode ===
+//
+// Vector tries are relaxed radix balanced (RRB) trees. A node with no size
+// table is regular: every leaf below it is full and its children are packed
+// to the left, so the child holding index i is (i >> level) & MASK. Slicing
+// and concatenation produce relaxed nodes, which carry a table of cumulative
+// subtree sizes and are searched from the radix guess. Regular nodes never
+// have relaxed children. All leaves sit at the same depth and keep their
+// elements packed from slot 0.
 typedef struct VectorNode {
     PyObject_HEAD
     PyObject *array[WIDTH];
     PyObject *transient_id;
+    Py_ssize_t *sizes;  // cumulative child sizes, NULL for regular nodes
+    Py_hash_t hash;     // cached hash of the elements below (see VectorTrie_hash)
+    int hash_computed;
 } VectorNode;
 
 static PyTypeObject VectorNodeType;
@@ -526,29 +1022,52 @@ static void VectorNode_dealloc(VectorNode *self) {
         Py_XDECREF(self->array[i]);
     }
     Py_XDECREF(self->transient_id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    PyMem_Free(self->sizes);
+    pds_recycle(PDS_FL(vector_node), (PyObject *)self, &VectorNodeType);
 }
 
 static VectorNode *VectorNode_create(PyObject *transient_id) {
-    VectorNode *node = PyObject_New(VectorNode, &VectorNodeType);
+    VectorNode *node = (VectorNode *)pds_alloc(PDS_FL(vector_node), &VectorNodeType);
     if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_VECTOR);
 
     for (int i = 0; i < WIDTH; i++) {
         node->array[i] = NULL;
     }
     node->transient_id = transient_id;
     Py_XINCREF(transient_id);
+    node->sizes = NULL;
+    node->hash = 0;
+    node->hash_computed = 0;
     return node;
 }
 
+static int VectorNode_alloc_sizes(VectorNode *node) {
+    if (node->sizes) return 0;
+    node->sizes = PyMem_Malloc(WIDTH * sizeof(Py_ssize_t));
+    if (!node->sizes) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    return 0;
+}
+
 static VectorNode *VectorNode_clone(VectorNode *self, PyObject *transient_id) {
     VectorNode *node = VectorNode_create(transient_id);
     if (!node) return NULL;
+    PDS_STAT_COPY(PDS_NODE_VECTOR);
 
     for (int i = 0; i < WIDTH; i++) {
         node->array[i] = self->array[i];
         Py_XINCREF(node->array[i]);
     }
+    if (self->sizes) {
+        if (VectorNode_alloc_sizes(node) < 0) {
+            Py_DECREF(node);
+            return NULL;
+        }
+        memcpy(node->sizes, self->sizes, WIDTH * sizeof(Py_ssize_t));
+    }
     return node;
 }
 
@@ -556,6 +1075,28 @@ static int VectorNode_is_editable(VectorNode *self, PyObject *transient_id) {
     return transient_id != NULL && self->transient_id == transient_id;
 }
 
+// Number of occupied slots (children, or elements for a leaf)
+static inline int VectorNode_slot_count(VectorNode *node) {
+    int lo = 0, hi = WIDTH;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (node->array[mid]) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Child slot holding index *i of a node at level; rebases *i into that child
+static inline int VectorNode_child_index(VectorNode *node, int level, Py_ssize_t *i) {
+    if (!node->sizes) {
+        return (int)((*i >> level) & MASK);
+    }
+    int idx = (int)(*i >> level);
+    while (node->sizes[idx] <= *i) idx++;
+    if (idx > 0) *i -= node->sizes[idx - 1];
+    return idx;
+}
+
 static PyTypeObject VectorNodeType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name = "spork.runtime.pds.VectorNode",
@@ -567,119 +1108,591 @@ static PyTypeObject VectorNodeType = {
 // Global empty node
 static VectorNode *EMPTY_NODE = NULL;
 
-// === Vector ===
-typedef struct Vector {
-    PyObject_HEAD
-    Py_ssize_t cnt;
-    int shift;
-    VectorNode *root;
-    PyObject *tail;  // tuple
-    Py_hash_t hash;
-    int hash_computed;
-    PyObject *transient_id;
-} Vector;
-
-static PyTypeObject VectorType;
-static Vector *EMPTY_VECTOR = NULL;
+// === Vector Trie ===
+// Operations shared by Vector and TransientVector. `level` is the shift of
+// the node passed in (0 for leaves). Nodes are edited in place when they
+// belong to transient_id, otherwise path-copied.
 
-static void Vector_dealloc(Vector *self) {
-    Py_XDECREF(self->root);
-    Py_XDECREF(self->tail);
-    Py_XDECREF(self->transient_id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+// Number of elements below a node
+static Py_ssize_t VectorTrie_count(VectorNode *node, int level) {
+    Py_ssize_t total = 0;
+    while (level > 0) {
+        int n = VectorNode_slot_count(node);
+        if (n == 0) return total;
+        if (node->sizes) return total + node->sizes[n - 1];
+        total += (Py_ssize_t)(n - 1) << level;
+        node = (VectorNode *)node->array[n - 1];
+        level -= BITS;
+    }
+    return total + VectorNode_slot_count(node);
 }
 
-static PyObject *Vector_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
-    Vector *self = (Vector *)type->tp_alloc(type, 0);
-    if (self != NULL) {
-        self->cnt = 0;
-        self->shift = BITS;
-        self->root = EMPTY_NODE;
-        Py_INCREF(EMPTY_NODE);
-        self->tail = PyTuple_New(0);
-        self->hash = 0;
-        self->hash_computed = 0;
-        self->transient_id = NULL;
+// Fill out[] with the cumulative sizes of the n children of a node
+static void VectorTrie_fill_sizes(VectorNode *node, int level, int n, Py_ssize_t *out) {
+    if (node->sizes) {
+        memcpy(out, node->sizes, n * sizeof(Py_ssize_t));
+        return;
     }
-    return (PyObject *)self;
+    for (int j = 0; j < n - 1; j++) {
+        out[j] = (Py_ssize_t)(j + 1) << level;
+    }
+    out[n - 1] = ((Py_ssize_t)(n - 1) << level)
+               + VectorTrie_count((VectorNode *)node->array[n - 1], level - BITS);
 }
 
-static Vector *Vector_create(Py_ssize_t cnt, int shift, VectorNode *root,
-                               PyObject *tail, PyObject *transient_id) {
-    Vector *vec = (Vector *)VectorType.tp_alloc(&VectorType, 0);
-    if (!vec) return NULL;
+// Vector hash of the elements below a node, in order. Persistent nodes are
+// never edited in place, so each node caches it and a derived vector only
+// rehashes the nodes on the paths it copied.
+static int VectorTrie_hash(VectorNode *node, int level, Py_uhash_t *out) {
+    if (PDS_CACHE_READY(node->hash_computed)) {
+        *out = (Py_uhash_t)node->hash;
+        return 0;
+    }
 
-    vec->cnt = cnt;
-    vec->shift = shift;
-    vec->root = root ? root : EMPTY_NODE;
-    Py_INCREF(vec->root);
-    vec->tail = tail ? tail : PyTuple_New(0);
-    if (!vec->tail) {
-        Py_DECREF(vec);
-        return NULL;
+    Py_uhash_t h = 0;
+    int n = VectorNode_slot_count(node);
+    if (level == 0) {
+        for (int i = 0; i < n; i++) {
+            Py_hash_t item_hash = PyObject_Hash(node->array[i]);
+            if (item_hash == -1) return -1;
+            h = 31 * h + (Py_uhash_t)item_hash;
+        }
+    } else if (n > 0) {
+        Py_ssize_t sizes[WIDTH];
+        VectorTrie_fill_sizes(node, level, n, sizes);
+        Py_ssize_t span = -1;
+        Py_uhash_t factor = 1;
+        for (int i = 0; i < n; i++) {
+            Py_uhash_t sub;
+            if (VectorTrie_hash((VectorNode *)node->array[i], level - BITS, &sub) < 0) return -1;
+            Py_ssize_t child_len = sizes[i] - (i > 0 ? sizes[i - 1] : 0);
+            if (child_len != span) {
+                span = child_len;
+                factor = pds_pow31(span);
+            }
+            h = h * factor + sub;
+        }
     }
-    if (tail) Py_INCREF(tail);
-    vec->hash = 0;
-    vec->hash_computed = 0;
-    vec->transient_id = transient_id;
-    Py_XINCREF(transient_id);
 
-    return vec;
+    node->hash = (Py_hash_t)h;
+    PDS_CACHE_PUBLISH(node->hash_computed);
+    *out = h;
+    return 0;
 }
 
-static Py_ssize_t Vector_length(Vector *self) {
-    return self->cnt;
+// Borrowed reference to element i of the trie
+static inline PyObject *VectorTrie_item(VectorNode *node, int shift, Py_ssize_t i) {
+    for (int level = shift; level > 0; level -= BITS) {
+        node = (VectorNode *)node->array[VectorNode_child_index(node, level, &i)];
+    }
+    return node->array[i & MASK];
+}
+
+// Leaf holding element i; stores the index of its first element in *start
+// and its length in *len
+static VectorNode *VectorTrie_leaf_for(VectorNode *node, int shift, Py_ssize_t i,
+                                       Py_ssize_t *start, Py_ssize_t *len) {
+    Py_ssize_t base = 0;
+    Py_ssize_t leaf_len = WIDTH;
+    for (int level = shift; level > 0; level -= BITS) {
+        int idx;
+        if (node->sizes) {
+            idx = (int)(i >> level);
+            while (node->sizes[idx] <= i) idx++;
+            Py_ssize_t before = idx > 0 ? node->sizes[idx - 1] : 0;
+            if (level == BITS) leaf_len = node->sizes[idx] - before;
+            i -= before;
+            base += before;
+        } else {
+            idx = (int)((i >> level) & MASK);
+        }
+        node = (VectorNode *)node->array[idx];
+    }
+    *start = base + (i & ~(Py_ssize_t)MASK);
+    *len = leaf_len;
+    return node;
 }
 
-static Py_ssize_t Vector_tail_off(Vector *self) {
-    if (self->cnt < WIDTH) {
-        return 0;
+static VectorNode *VectorTrie_new_path(int level, VectorNode *leaf, PyObject *transient_id) {
+    if (level == 0) {
+        Py_INCREF(leaf);
+        return leaf;
     }
-    return ((self->cnt - 1) >> BITS) << BITS;
-}
+    VectorNode *ret = VectorNode_create(transient_id);
+    if (!ret) return NULL;
 
-// Internal helper: returns pointer to the raw array for index i
-// For tail, returns NULL and sets *is_tail = 1, caller should use self->tail
-// For tree nodes, returns the VectorNode* containing the array
-// Does NOT create any new objects or do any refcounting
-static VectorNode *Vector_node_for(Vector *self, Py_ssize_t i, int *is_tail) {
-    *is_tail = 0;
-    if (i >= Vector_tail_off(self)) {
-        *is_tail = 1;
+    VectorNode *child = VectorTrie_new_path(level - BITS, leaf, transient_id);
+    if (!child) {
+        Py_DECREF(ret);
         return NULL;
     }
+    ret->array[0] = (PyObject *)child;
+    return ret;
+}
 
-    VectorNode *node = self->root;
-    for (int level = self->shift; level > 0; level -= BITS) {
-        node = (VectorNode *)node->array[(i >> level) & MASK];
+static VectorNode *VectorTrie_editable(VectorNode *node, PyObject *transient_id) {
+    if (VectorNode_is_editable(node, transient_id)) {
+        Py_INCREF(node);
+        return node;
     }
-    return node;
+    return VectorNode_clone(node, transient_id);
 }
 
-static PyObject *Vector_array_for(Vector *self, Py_ssize_t i) {
-    if (i < 0 || i >= self->cnt) {
-        PyErr_Format(PyExc_IndexError, "Index %zd out of range for vector of size %zd", i, self->cnt);
-        return NULL;
-    }
+// Append a full leaf at the right edge. Returns NULL without an exception
+// set when the subtree has no room left.
+static VectorNode *VectorTrie_push_leaf(VectorNode *node, int level, VectorNode *leaf,
+                                        PyObject *transient_id) {
+    int n = VectorNode_slot_count(node);
+    int slot = n - 1;
+    VectorNode *child = NULL;
 
-    if (i >= Vector_tail_off(self)) {
-        Py_INCREF(self->tail);
-        return self->tail;
+    if (level > BITS && n > 0) {
+        child = VectorTrie_push_leaf((VectorNode *)node->array[n - 1], level - BITS, leaf, transient_id);
+        if (!child && PyErr_Occurred()) return NULL;
     }
-
-    VectorNode *node = self->root;
-    for (int level = self->shift; level > 0; level -= BITS) {
-        node = (VectorNode *)node->array[(i >> level) & MASK];
+    if (!child) {
+        if (n == WIDTH) return NULL;
+        slot = n;
+        child = VectorTrie_new_path(level - BITS, leaf, transient_id);
+        if (!child) return NULL;
     }
 
-    // Build a tuple from the node array
-    PyObject *result = PyTuple_New(WIDTH);
-    if (!result) return NULL;
-
-    for (int j = 0; j < WIDTH; j++) {
-        PyObject *item = node->array[j];
-        if (item == NULL) item = Py_None;
-        Py_INCREF(item);
+    VectorNode *ret = VectorTrie_editable(node, transient_id);
+    if (!ret) {
+        Py_DECREF(child);
+        return NULL;
+    }
+    Py_XSETREF(ret->array[slot], (PyObject *)child);
+    if (ret->sizes) {
+        Py_ssize_t before = slot == n ? (n > 0 ? ret->sizes[n - 1] : 0) : ret->sizes[slot];
+        ret->sizes[slot] = before + WIDTH;
+    }
+    return ret;
+}
+
+// Remove the rightmost leaf, which holds leaf_len elements. Returns NULL
+// without an exception set when nothing is left below the node.
+static VectorNode *VectorTrie_pop_leaf(VectorNode *node, int level, Py_ssize_t leaf_len,
+                                       PyObject *transient_id) {
+    int n = VectorNode_slot_count(node);
+    VectorNode *child = NULL;
+
+    if (level > BITS) {
+        child = VectorTrie_pop_leaf((VectorNode *)node->array[n - 1], level - BITS, leaf_len, transient_id);
+        if (!child && PyErr_Occurred()) return NULL;
+    }
+    if (!child && n == 1) return NULL;
+
+    VectorNode *ret = VectorTrie_editable(node, transient_id);
+    if (!ret) {
+        Py_XDECREF(child);
+        return NULL;
+    }
+    if (child) {
+        Py_SETREF(ret->array[n - 1], (PyObject *)child);
+        if (ret->sizes) ret->sizes[n - 1] -= leaf_len;
+    } else {
+        Py_CLEAR(ret->array[n - 1]);
+    }
+    return ret;
+}
+
+static VectorNode *VectorTrie_assoc(VectorNode *node, int level, Py_ssize_t i, PyObject *val,
+                                    PyObject *transient_id) {
+    VectorNode *ret = VectorTrie_editable(node, transient_id);
+    if (!ret) return NULL;
+
+    if (level == 0) {
+        Py_INCREF(val);
+        Py_XSETREF(ret->array[i & MASK], val);
+        return ret;
+    }
+
+    int subidx = VectorNode_child_index(node, level, &i);
+    VectorNode *child = VectorTrie_assoc((VectorNode *)node->array[subidx], level - BITS, i, val, transient_id);
+    if (!child) {
+        Py_DECREF(ret);
+        return NULL;
+    }
+    Py_XSETREF(ret->array[subidx], (PyObject *)child);
+    return ret;
+}
+
+// New persistent subtree holding the first n elements (0 < n <= count)
+static VectorNode *VectorTrie_take(VectorNode *node, int level, Py_ssize_t n) {
+    if (level == 0) {
+        if (n == VectorNode_slot_count(node)) {
+            Py_INCREF(node);
+            return node;
+        }
+        VectorNode *leaf = VectorNode_create(NULL);
+        if (!leaf) return NULL;
+        for (Py_ssize_t j = 0; j < n; j++) {
+            leaf->array[j] = node->array[j];
+            Py_INCREF(leaf->array[j]);
+        }
+        return leaf;
+    }
+
+    Py_ssize_t i = n - 1;
+    int idx = VectorNode_child_index(node, level, &i);
+    Py_ssize_t before = node->sizes ? (idx > 0 ? node->sizes[idx - 1] : 0)
+                                    : (Py_ssize_t)idx << level;
+    if (idx == VectorNode_slot_count(node) - 1
+        && n == before + VectorTrie_count((VectorNode *)node->array[idx], level - BITS)) {
+        Py_INCREF(node);
+        return node;
+    }
+
+    VectorNode *child = VectorTrie_take((VectorNode *)node->array[idx], level - BITS, n - before);
+    if (!child) return NULL;
+
+    VectorNode *ret = VectorNode_create(NULL);
+    if (!ret) {
+        Py_DECREF(child);
+        return NULL;
+    }
+    for (int j = 0; j < idx; j++) {
+        ret->array[j] = node->array[j];
+        Py_INCREF(ret->array[j]);
+    }
+    ret->array[idx] = (PyObject *)child;
+
+    // A prefix of a regular node stays regular if it ends on a leaf boundary
+    if (node->sizes || (n & MASK) != 0) {
+        if (VectorNode_alloc_sizes(ret) < 0) {
+            Py_DECREF(ret);
+            return NULL;
+        }
+        if (idx > 0) VectorTrie_fill_sizes(node, level, idx, ret->sizes);
+        ret->sizes[idx] = n;
+    }
+    return ret;
+}
+
+// New persistent subtree holding the elements from index k on (0 <= k < count)
+static VectorNode *VectorTrie_drop(VectorNode *node, int level, Py_ssize_t k) {
+    if (k == 0) {
+        Py_INCREF(node);
+        return node;
+    }
+
+    int n = VectorNode_slot_count(node);
+    if (level == 0) {
+        VectorNode *leaf = VectorNode_create(NULL);
+        if (!leaf) return NULL;
+        for (Py_ssize_t j = k; j < n; j++) {
+            leaf->array[j - k] = node->array[j];
+            Py_INCREF(node->array[j]);
+        }
+        return leaf;
+    }
+
+    Py_ssize_t sizes[WIDTH];
+    VectorTrie_fill_sizes(node, level, n, sizes);
+
+    Py_ssize_t i = k;
+    int idx = VectorNode_child_index(node, level, &i);
+    Py_ssize_t before = idx > 0 ? sizes[idx - 1] : 0;
+
+    VectorNode *child = VectorTrie_drop((VectorNode *)node->array[idx], level - BITS, k - before);
+    if (!child) return NULL;
+
+    VectorNode *ret = VectorNode_create(NULL);
+    if (!ret) {
+        Py_DECREF(child);
+        return NULL;
+    }
+    ret->array[0] = (PyObject *)child;
+    for (int j = idx + 1; j < n; j++) {
+        ret->array[j - idx] = node->array[j];
+        Py_INCREF(node->array[j]);
+    }
+    if (VectorNode_alloc_sizes(ret) < 0) {
+        Py_DECREF(ret);
+        return NULL;
+    }
+    for (int j = idx; j < n; j++) {
+        ret->sizes[j - idx] = sizes[j] - k;
+    }
+    return ret;
+}
+
+// Relaxed node at level holding the given children (level - BITS)
+static VectorNode *VectorTrie_branch(VectorNode **children, int n, int level) {
+    VectorNode *ret = VectorNode_create(NULL);
+    if (!ret) return NULL;
+    if (VectorNode_alloc_sizes(ret) < 0) {
+        Py_DECREF(ret);
+        return NULL;
+    }
+    Py_ssize_t total = 0;
+    for (int j = 0; j < n; j++) {
+        ret->array[j] = (PyObject *)children[j];
+        Py_INCREF(children[j]);
+        total += VectorTrie_count(children[j], level - BITS);
+        ret->sizes[j] = total;
+    }
+    return ret;
+}
+
+// Nodes beyond the optimum tolerated per level before concat rebalances
+#define VECTOR_CONCAT_EXTRA 2
+
+// Merge the children of left (all but the last), center and right (all but
+// the first), which are nodes at level - BITS. Slots are redistributed until
+// at most VECTOR_CONCAT_EXTRA more nodes than necessary remain. Returns a
+// node at level + BITS with one or two children at level.
+static VectorNode *VectorTrie_rebalance(VectorNode *left, VectorNode *center, VectorNode *right, int level) {
+    VectorNode *all[2 * WIDTH + 2];
+    int plan[2 * WIDTH + 2];
+    int n = 0;
+
+    if (left) {
+        int ln = VectorNode_slot_count(left);
+        for (int j = 0; j < ln - 1; j++) all[n++] = (VectorNode *)left->array[j];
+    }
+    int cn = VectorNode_slot_count(center);
+    for (int j = 0; j < cn; j++) all[n++] = (VectorNode *)center->array[j];
+    if (right) {
+        int rn = VectorNode_slot_count(right);
+        for (int j = 1; j < rn; j++) all[n++] = (VectorNode *)right->array[j];
+    }
+
+    int total = 0;
+    for (int j = 0; j < n; j++) {
+        plan[j] = VectorNode_slot_count(all[j]);
+        total += plan[j];
+    }
+
+    // Compute the target slot counts: repeatedly take the first node that is
+    // noticeably short of full and spread its slots over its right neighbours
+    int optimal = (total + WIDTH - 1) / WIDTH;
+    int m = n;
+    int i = 0;
+    while (m > optimal + VECTOR_CONCAT_EXTRA) {
+        while (plan[i] >= WIDTH - VECTOR_CONCAT_EXTRA / 2) i++;
+        int remaining = plan[i];
+        while (remaining > 0) {
+            int merged = remaining + plan[i + 1];
+            plan[i] = merged < WIDTH ? merged : WIDTH;
+            remaining = merged - plan[i];
+            i++;
+        }
+        for (int j = i; j < m - 1; j++) plan[j] = plan[j + 1];
+        m--;
+        i--;
+    }
+
+    // Build the nodes of the plan, reusing untouched source nodes
+    VectorNode *merged[2 * WIDTH + 2];
+    int src = 0, off = 0;
+    for (int p = 0; p < m; p++) {
+        if (off == 0 && plan[p] == VectorNode_slot_count(all[src])) {
+            merged[p] = all[src++];
+            Py_INCREF(merged[p]);
+            continue;
+        }
+        VectorNode *node = VectorNode_create(NULL);
+        if (!node) {
+            for (int q = 0; q < p; q++) Py_DECREF(merged[q]);
+            return NULL;
+        }
+        for (int j = 0; j < plan[p]; j++) {
+            node->array[j] = all[src]->array[off];
+            Py_INCREF(node->array[j]);
+            if (++off == VectorNode_slot_count(all[src])) {
+                src++;
+                off = 0;
+            }
+        }
+        if (level - BITS > 0) {
+            if (VectorNode_alloc_sizes(node) < 0) {
+                Py_DECREF(node);
+                for (int q = 0; q < p; q++) Py_DECREF(merged[q]);
+                return NULL;
+            }
+            Py_ssize_t acc = 0;
+            for (int j = 0; j < plan[p]; j++) {
+                acc += VectorTrie_count((VectorNode *)node->array[j], level - 2 * BITS);
+                node->sizes[j] = acc;
+            }
+        }
+        merged[p] = node;
+    }
+
+    VectorNode *parts[2] = {NULL, NULL};
+    int nparts = m > WIDTH ? 2 : 1;
+    parts[0] = VectorTrie_branch(merged, m < WIDTH ? m : WIDTH, level);
+    if (parts[0] && nparts == 2) {
+        parts[1] = VectorTrie_branch(merged + WIDTH, m - WIDTH, level);
+    }
+    for (int q = 0; q < m; q++) Py_DECREF(merged[q]);
+    if (!parts[0] || (nparts == 2 && !parts[1])) {
+        Py_XDECREF(parts[0]);
+        return NULL;
+    }
+
+    VectorNode *top = VectorTrie_branch(parts, nparts, level + BITS);
+    Py_DECREF(parts[0]);
+    Py_XDECREF(parts[1]);
+    return top;
+}
+
+// Concatenate two non-empty subtrees. Returns a node one level above the
+// taller of the two.
+static VectorNode *VectorTrie_concat(VectorNode *left, int left_level, VectorNode *right, int right_level) {
+    if (left_level > right_level) {
+        int n = VectorNode_slot_count(left);
+        VectorNode *center = VectorTrie_concat((VectorNode *)left->array[n - 1], left_level - BITS,
+                                               right, right_level);
+        if (!center) return NULL;
+        VectorNode *ret = VectorTrie_rebalance(left, center, NULL, left_level);
+        Py_DECREF(center);
+        return ret;
+    }
+    if (left_level < right_level) {
+        VectorNode *center = VectorTrie_concat(left, left_level,
+                                               (VectorNode *)right->array[0], right_level - BITS);
+        if (!center) return NULL;
+        VectorNode *ret = VectorTrie_rebalance(NULL, center, right, right_level);
+        Py_DECREF(center);
+        return ret;
+    }
+    if (left_level == 0) {
+        VectorNode *leaves[2] = {left, right};
+        return VectorTrie_branch(leaves, 2, BITS);
+    }
+    int n = VectorNode_slot_count(left);
+    VectorNode *center = VectorTrie_concat((VectorNode *)left->array[n - 1], left_level - BITS,
+                                           (VectorNode *)right->array[0], right_level - BITS);
+    if (!center) return NULL;
+    VectorNode *ret = VectorTrie_rebalance(left, center, right, left_level);
+    Py_DECREF(center);
+    return ret;
+}
+
+// Drop root levels that have a single child. Steals the reference to *root.
+static void VectorTrie_collapse(VectorNode **root, int *shift) {
+    while (*shift > BITS && VectorNode_slot_count(*root) == 1) {
+        VectorNode *child = (VectorNode *)(*root)->array[0];
+        Py_INCREF(child);
+        Py_SETREF(*root, child);
+        *shift -= BITS;
+    }
+}
+
+// New root after the root at shift overflowed: [root, path to leaf]
+static VectorNode *VectorTrie_grow(VectorNode *root, int shift, Py_ssize_t root_cnt,
+                                   VectorNode *leaf, PyObject *transient_id) {
+    VectorNode *new_root = VectorNode_create(transient_id);
+    if (!new_root) return NULL;
+    new_root->array[0] = (PyObject *)root;
+    Py_INCREF(root);
+
+    VectorNode *path = VectorTrie_new_path(shift, leaf, transient_id);
+    if (!path) {
+        Py_DECREF(new_root);
+        return NULL;
+    }
+    new_root->array[1] = (PyObject *)path;
+
+    if (root->sizes) {
+        if (VectorNode_alloc_sizes(new_root) < 0) {
+            Py_DECREF(new_root);
+            return NULL;
+        }
+        new_root->sizes[0] = root_cnt;
+        new_root->sizes[1] = root_cnt + WIDTH;
+    }
+    return new_root;
+}
+
+// === Vector ===
+typedef struct Vector {
+    PyObject_HEAD
+    Py_ssize_t cnt;
+    int shift;
+    VectorNode *root;
+    PyObject *tail;  // tuple
+    Py_hash_t hash;
+    int hash_computed;
+    PyObject *transient_id;
+} Vector;
+
+static PyTypeObject VectorType;
+static Vector *EMPTY_VECTOR = NULL;
+
+static void Vector_dealloc(Vector *self) {
+    Py_XDECREF(self->root);
+    Py_XDECREF(self->tail);
+    Py_XDECREF(self->transient_id);
+    pds_recycle(PDS_FL(vector), (PyObject *)self, &VectorType);
+}
+
+static PyObject *Vector_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    Vector *self = (Vector *)type->tp_alloc(type, 0);
+    if (self != NULL) {
+        self->cnt = 0;
+        self->shift = BITS;
+        self->root = EMPTY_NODE;
+        Py_INCREF(EMPTY_NODE);
+        self->tail = PyTuple_New(0);
+        self->hash = 0;
+        self->hash_computed = 0;
+        self->transient_id = NULL;
+    }
+    return (PyObject *)self;
+}
+
+static Vector *Vector_create(Py_ssize_t cnt, int shift, VectorNode *root,
+                               PyObject *tail, PyObject *transient_id) {
+    Vector *vec = (Vector *)pds_alloc(PDS_FL(vector), &VectorType);
+    if (!vec) return NULL;
+
+    vec->cnt = cnt;
+    vec->shift = shift;
+    vec->root = root ? root : EMPTY_NODE;
+    Py_INCREF(vec->root);
+    vec->hash = 0;
+    vec->hash_computed = 0;
+    vec->transient_id = transient_id;
+    Py_XINCREF(transient_id);
+    vec->tail = tail ? tail : PyTuple_New(0);
+    if (!vec->tail) {
+        Py_DECREF(vec);
+        return NULL;
+    }
+    if (tail) Py_INCREF(tail);
+
+    return vec;
+}
+
+static Py_ssize_t Vector_length(Vector *self) {
+    return self->cnt;
+}
+
+static Py_ssize_t Vector_tail_off(Vector *self) {
+    return self->cnt - PyTuple_GET_SIZE(self->tail);
+}
+
+// Borrowed reference to element i (0 <= i < cnt)
+static inline PyObject *Vector_item(Vector *self, Py_ssize_t i) {
+    Py_ssize_t tail_off = Vector_tail_off(self);
+    if (i >= tail_off) {
+        return PyTuple_GET_ITEM(self->tail, i - tail_off);
+    }
+    return VectorTrie_item(self->root, self->shift, i);
+}
+
+// Tuple of the first len elements of a leaf
+static PyObject *VectorNode_to_tuple(VectorNode *leaf, Py_ssize_t len) {
+    PyObject *result = PyTuple_New(len);
+    if (!result) return NULL;
+
+    for (Py_ssize_t j = 0; j < len; j++) {
+        PyObject *item = leaf->array[j];
+        Py_INCREF(item);
         PyTuple_SET_ITEM(result, j, item);
     }
     return result;
@@ -701,12 +1714,8 @@ static PyObject *Vector_nth_impl(Vector *self, Py_ssize_t i, PyObject *default_v
         return NULL;
     }
 
-    PyObject *arr = Vector_array_for(self, i);
-    if (!arr) return NULL;
-
-    PyObject *result = PyTuple_GET_ITEM(arr, i & MASK);
+    PyObject *result = Vector_item(self, i);
     Py_INCREF(result);
-    Py_DECREF(arr);
     return result;
 }
 
@@ -722,6 +1731,78 @@ static PyObject *Vector_nth(Vector *self, PyObject *args) {
     return Vector_nth_impl(self, i, default_val);
 }
 
+// Contiguous slice [start, stop) sharing structure with self: the trie is
+// cut down with take/drop in O(log n) rather than copied
+static PyObject *Vector_slice(Vector *self, Py_ssize_t start, Py_ssize_t stop) {
+    if (start >= stop) {
+        Py_INCREF(EMPTY_VECTOR);
+        return (PyObject *)EMPTY_VECTOR;
+    }
+    if (start == 0 && stop == self->cnt) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_ssize_t tail_off = Vector_tail_off(self);
+    if (start >= tail_off) {
+        PyObject *new_tail = PyTuple_GetSlice(self->tail, start - tail_off, stop - tail_off);
+        if (!new_tail) return NULL;
+        Vector *result = Vector_create(stop - start, BITS, NULL, new_tail, NULL);
+        Py_DECREF(new_tail);
+        return (PyObject *)result;
+    }
+
+    int shift = self->shift;
+    Py_ssize_t trie_end = stop < tail_off ? stop : tail_off;
+    VectorNode *taken = VectorTrie_take(self->root, shift, trie_end);
+    if (!taken) return NULL;
+    VectorNode *root = VectorTrie_drop(taken, shift, start);
+    Py_DECREF(taken);
+    if (!root) return NULL;
+
+    PyObject *new_tail;
+    if (stop > tail_off) {
+        new_tail = PyTuple_GetSlice(self->tail, 0, stop - tail_off);
+        if (!new_tail) {
+            Py_DECREF(root);
+            return NULL;
+        }
+    } else {
+        // The slice ends inside the trie: its last leaf becomes the tail
+        Py_ssize_t leaf_start, leaf_len;
+        VectorNode *leaf = VectorTrie_leaf_for(root, shift, trie_end - start - 1, &leaf_start, &leaf_len);
+        new_tail = VectorNode_to_tuple(leaf, leaf_len);
+        if (!new_tail) {
+            Py_DECREF(root);
+            return NULL;
+        }
+        VectorNode *popped = VectorTrie_pop_leaf(root, shift, leaf_len, NULL);
+        Py_DECREF(root);
+        if (!popped && PyErr_Occurred()) {
+            Py_DECREF(new_tail);
+            return NULL;
+        }
+        if (!popped) {
+            popped = EMPTY_NODE;
+            Py_INCREF(popped);
+            shift = BITS;
+        }
+        root = popped;
+    }
+    VectorTrie_collapse(&root, &shift);
+
+    Vector *result = Vector_create(stop - start, shift, root, new_tail, NULL);
+    Py_DECREF(root);
+    Py_DECREF(new_tail);
+    return (PyObject *)result;
+}
+
+// Forward declaration for TransientVector
+static PyTypeObject TransientVectorType;
+static PyObject *Vector_transient(Vector *self, PyObject *Py_UNUSED(ignored));
+static PyObject *TransientVector_conj_mut(TransientVector *self, PyObject *val);
+static PyObject *TransientVector_persistent(TransientVector *self, PyObject *Py_UNUSED(ignored));
+
 static PyObject *Vector_getitem(Vector *self, PyObject *key) {
     if (PySlice_Check(key)) {
         // Handle slicing
@@ -730,25 +1811,25 @@ static PyObject *Vector_getitem(Vector *self, PyObject *key) {
             return NULL;
         }
 
-        // Build arguments for vec() function
-        PyObject *items = PyList_New(slicelength);
-        if (!items) return NULL;
+        if (step == 1) {
+            return Vector_slice(self, start, start + slicelength);
+        }
+
+        // Strided slices can't share structure; build them through a transient
+        PyObject *t = Vector_transient(EMPTY_VECTOR, NULL);
+        if (!t) return NULL;
 
         for (Py_ssize_t i = 0, j = start; i < slicelength; i++, j += step) {
-            PyObject *arr = Vector_array_for(self, j);
-            if (!arr) {
-                Py_DECREF(items);
+            PyObject *res = TransientVector_conj_mut((TransientVector *)t, Vector_item(self, j));
+            if (!res) {
+                Py_DECREF(t);
                 return NULL;
             }
-            PyObject *item = PyTuple_GET_ITEM(arr, j & MASK);
-            Py_INCREF(item);
-            PyList_SET_ITEM(items, i, item);
-            Py_DECREF(arr);
+            Py_DECREF(res);
         }
 
-        // Create new Vector from list
-        PyObject *result = PyObject_CallFunctionObjArgs((PyObject *)&VectorType, items, NULL);
-        Py_DECREF(items);
+        PyObject *result = TransientVector_persistent((TransientVector *)t, NULL);
+        Py_DECREF(t);
         return result;
     }
 
@@ -769,72 +1850,17 @@ static PyObject *Vector_getitem(Vector *self, PyObject *key) {
         return NULL;
     }
 
-    PyObject *arr = Vector_array_for(self, i);
-    if (!arr) return NULL;
-
-    PyObject *result = PyTuple_GET_ITEM(arr, i & MASK);
+    PyObject *result = Vector_item(self, i);
     Py_INCREF(result);
-    Py_DECREF(arr);
     return result;
 }
 
-static VectorNode *Vector_new_path(Vector *self, int level, VectorNode *node, PyObject *transient_id) {
-    if (level == 0) {
-        Py_INCREF(node);
-        return node;
-    }
-    VectorNode *ret = VectorNode_create(transient_id);
-    if (!ret) return NULL;
-
-    VectorNode *child = Vector_new_path(self, level - BITS, node, transient_id);
-    if (!child) {
-        Py_DECREF(ret);
-        return NULL;
-    }
-    ret->array[0] = (PyObject *)child;
-    return ret;
-}
-
-static VectorNode *Vector_push_tail(Vector *self, int level, VectorNode *parent, VectorNode *tail_node, PyObject *transient_id) {
-    int subidx = ((self->cnt - 1) >> level) & MASK;
-    VectorNode *ret;
-
-    if (VectorNode_is_editable(parent, transient_id)) {
-        ret = parent;
-        Py_INCREF(ret);
-    } else {
-        ret = VectorNode_clone(parent, transient_id);
-        if (!ret) return NULL;
-    }
-
-    VectorNode *node_to_insert;
-    if (level == BITS) {
-        node_to_insert = tail_node;
-        Py_INCREF(tail_node);
-    } else {
-        PyObject *child = parent->array[subidx];
-        if (child != NULL) {
-            node_to_insert = Vector_push_tail(self, level - BITS, (VectorNode *)child, tail_node, transient_id);
-        } else {
-            node_to_insert = Vector_new_path(self, level - BITS, tail_node, transient_id);
-        }
-        if (!node_to_insert) {
-            Py_DECREF(ret);
-            return NULL;
-        }
-    }
-
-    Py_XDECREF(ret->array[subidx]);
-    ret->array[subidx] = (PyObject *)node_to_insert;
-    return ret;
-}
-
-static PyObject *Vector_conj(Vector *self, PyObject *val) {
-    PyObject *transient_id = self->transient_id;
+static PyObject *Vector_conj(Vector *self, PyObject *val) {
+    PyObject *transient_id = self->transient_id;
 
     // Room in tail?
-    Py_ssize_t tail_len = PyTuple_Size(self->tail);
-    if (self->cnt - Vector_tail_off(self) < WIDTH) {
+    Py_ssize_t tail_len = PyTuple_GET_SIZE(self->tail);
+    if (tail_len < WIDTH) {
         PyObject *new_tail = PyTuple_New(tail_len + 1);
         if (!new_tail) return NULL;
 
@@ -855,41 +1881,20 @@ static PyObject *Vector_conj(Vector *self, PyObject *val) {
     VectorNode *tail_node = VectorNode_create(transient_id);
     if (!tail_node) return NULL;
 
-    for (Py_ssize_t i = 0; i < tail_len && i < WIDTH; i++) {
+    for (Py_ssize_t i = 0; i < WIDTH; i++) {
         tail_node->array[i] = PyTuple_GET_ITEM(self->tail, i);
         Py_INCREF(tail_node->array[i]);
     }
 
     int new_shift = self->shift;
-    VectorNode *new_root;
-
-    // Overflow root?
-    if (((size_t)self->cnt >> BITS) > (1ULL << self->shift)) {
-        new_root = VectorNode_create(transient_id);
-        if (!new_root) {
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        new_root->array[0] = (PyObject *)self->root;
-        Py_INCREF(self->root);
-
-        VectorNode *path = Vector_new_path(self, self->shift, tail_node, transient_id);
-        if (!path) {
-            Py_DECREF(new_root);
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        new_root->array[1] = (PyObject *)path;
+    VectorNode *new_root = VectorTrie_push_leaf(self->root, self->shift, tail_node, transient_id);
+    if (!new_root && !PyErr_Occurred()) {
+        // Overflow root
+        new_root = VectorTrie_grow(self->root, self->shift, self->cnt - WIDTH, tail_node, transient_id);
         new_shift += BITS;
-    } else {
-        new_root = Vector_push_tail(self, self->shift, self->root, tail_node, transient_id);
-        if (!new_root) {
-            Py_DECREF(tail_node);
-            return NULL;
-        }
     }
-
     Py_DECREF(tail_node);
+    if (!new_root) return NULL;
 
     PyObject *new_tail = PyTuple_New(1);
     if (!new_tail) {
@@ -905,35 +1910,7 @@ static PyObject *Vector_conj(Vector *self, PyObject *val) {
     return (PyObject *)result;
 }
 
-static VectorNode *Vector_do_assoc(Vector *self, int level, VectorNode *node, Py_ssize_t i, PyObject *val) {
-    VectorNode *ret = VectorNode_clone(node, NULL);
-    if (!ret) return NULL;
-
-    if (level == 0) {
-        Py_XDECREF(ret->array[i & MASK]);
-        ret->array[i & MASK] = val;
-        Py_INCREF(val);
-    } else {
-        int subidx = (i >> level) & MASK;
-        VectorNode *child = Vector_do_assoc(self, level - BITS, (VectorNode *)node->array[subidx], i, val);
-        if (!child) {
-            Py_DECREF(ret);
-            return NULL;
-        }
-        Py_XDECREF(ret->array[subidx]);
-        ret->array[subidx] = (PyObject *)child;
-    }
-    return ret;
-}
-
-static PyObject *Vector_assoc(Vector *self, PyObject *args) {
-    Py_ssize_t i;
-    PyObject *val;
-
-    if (!PyArg_ParseTuple(args, "nO", &i, &val)) {
-        return NULL;
-    }
-
+static PyObject *Vector_assoc_impl(Vector *self, Py_ssize_t i, PyObject *val) {
     if (i < 0) {
         i = self->cnt + i;
     }
@@ -947,15 +1924,16 @@ static PyObject *Vector_assoc(Vector *self, PyObject *args) {
         return Vector_conj(self, val);
     }
 
-    if (i >= Vector_tail_off(self)) {
+    Py_ssize_t tail_off = Vector_tail_off(self);
+    if (i >= tail_off) {
         // Update in tail
-        Py_ssize_t tail_len = PyTuple_Size(self->tail);
+        Py_ssize_t tail_len = PyTuple_GET_SIZE(self->tail);
         PyObject *new_tail = PyTuple_New(tail_len);
         if (!new_tail) return NULL;
 
         for (Py_ssize_t j = 0; j < tail_len; j++) {
             PyObject *item;
-            if (j == (i & MASK)) {
+            if (j == i - tail_off) {
                 item = val;
             } else {
                 item = PyTuple_GET_ITEM(self->tail, j);
@@ -970,7 +1948,7 @@ static PyObject *Vector_assoc(Vector *self, PyObject *args) {
     }
 
     // Update in trie
-    VectorNode *new_root = Vector_do_assoc(self, self->shift, self->root, i, val);
+    VectorNode *new_root = VectorTrie_assoc(self->root, self->shift, i, val, NULL);
     if (!new_root) return NULL;
 
     Vector *result = Vector_create(self->cnt, self->shift, new_root, self->tail, NULL);
@@ -978,28 +1956,15 @@ static PyObject *Vector_assoc(Vector *self, PyObject *args) {
     return (PyObject *)result;
 }
 
-static VectorNode *Vector_pop_tail(Vector *self, int level, VectorNode *node) {
-    int subidx = ((self->cnt - 2) >> level) & MASK;
+// Python wrapper - parses arguments then calls impl
+static PyObject *Vector_assoc(Vector *self, PyObject *args) {
+    Py_ssize_t i;
+    PyObject *val;
 
-    if (level > BITS) {
-        VectorNode *new_child = Vector_pop_tail(self, level - BITS, (VectorNode *)node->array[subidx]);
-        if (new_child == NULL && subidx == 0) {
-            return NULL;
-        }
-        VectorNode *ret = VectorNode_clone(node, NULL);
-        if (!ret) return NULL;
-        Py_XDECREF(ret->array[subidx]);
-        ret->array[subidx] = (PyObject *)new_child;
-        return ret;
-    } else if (subidx == 0) {
+    if (!PyArg_ParseTuple(args, "nO", &i, &val)) {
         return NULL;
-    } else {
-        VectorNode *ret = VectorNode_clone(node, NULL);
-        if (!ret) return NULL;
-        Py_XDECREF(ret->array[subidx]);
-        ret->array[subidx] = NULL;
-        return ret;
     }
+    return Vector_assoc_impl(self, i, val);
 }
 
 static PyObject *Vector_pop(Vector *self, PyObject *Py_UNUSED(ignored)) {
@@ -1013,8 +1978,8 @@ static PyObject *Vector_pop(Vector *self, PyObject *Py_UNUSED(ignored)) {
     }
 
     // More than one in tail?
-    Py_ssize_t tail_len = PyTuple_Size(self->tail);
-    if (self->cnt - Vector_tail_off(self) > 1) {
+    Py_ssize_t tail_len = PyTuple_GET_SIZE(self->tail);
+    if (tail_len > 1) {
         PyObject *new_tail = PyTuple_GetSlice(self->tail, 0, tail_len - 1);
         if (!new_tail) return NULL;
 
@@ -1023,25 +1988,25 @@ static PyObject *Vector_pop(Vector *self, PyObject *Py_UNUSED(ignored)) {
         return (PyObject *)result;
     }
 
-    // Pop from trie
-    PyObject *new_tail = Vector_array_for(self, self->cnt - 2);
+    // Pop from trie: the last leaf becomes the tail
+    Py_ssize_t leaf_start, leaf_len;
+    VectorNode *leaf = VectorTrie_leaf_for(self->root, self->shift, self->cnt - 2, &leaf_start, &leaf_len);
+    PyObject *new_tail = VectorNode_to_tuple(leaf, leaf_len);
     if (!new_tail) return NULL;
 
-    VectorNode *new_root = Vector_pop_tail(self, self->shift, self->root);
+    VectorNode *new_root = VectorTrie_pop_leaf(self->root, self->shift, leaf_len, NULL);
     int new_shift = self->shift;
 
     if (new_root == NULL) {
+        if (PyErr_Occurred()) {
+            Py_DECREF(new_tail);
+            return NULL;
+        }
         new_root = EMPTY_NODE;
         Py_INCREF(new_root);
+        new_shift = BITS;
     }
-
-    if (self->shift > BITS && new_root->array[1] == NULL) {
-        VectorNode *old_root = new_root;
-        new_root = (VectorNode *)new_root->array[0];
-        Py_INCREF(new_root);
-        Py_DECREF(old_root);
-        new_shift -= BITS;
-    }
+    VectorTrie_collapse(&new_root, &new_shift);
 
     Vector *result = Vector_create(self->cnt - 1, new_shift, new_root, new_tail, NULL);
     Py_DECREF(new_root);
@@ -1049,13 +2014,71 @@ static PyObject *Vector_pop(Vector *self, PyObject *Py_UNUSED(ignored)) {
     return (PyObject *)result;
 }
 
-// Forward declaration for TransientVector
-static PyTypeObject TransientVectorType;
-static PyObject *Vector_transient(Vector *self, PyObject *Py_UNUSED(ignored));
-static PyObject *TransientVector_conj_mut(TransientVector *self, PyObject *val);
-static PyObject *TransientVector_persistent(TransientVector *self, PyObject *Py_UNUSED(ignored));
+// self + other for two vectors: the tries are concatenated in O(log n),
+// sharing all but the nodes along the seam
+static PyObject *Vector_concat(Vector *self, Vector *other) {
+    Py_ssize_t tail_len = PyTuple_GET_SIZE(self->tail);
+    VectorNode *tail_node = VectorNode_create(NULL);
+    if (!tail_node) return NULL;
+    for (Py_ssize_t i = 0; i < tail_len; i++) {
+        tail_node->array[i] = PyTuple_GET_ITEM(self->tail, i);
+        Py_INCREF(tail_node->array[i]);
+    }
+
+    // Fold self's tail into its trie
+    VectorNode *left;
+    int left_level;
+    if (tail_len == 0) {
+        Py_DECREF(tail_node);
+        left = self->root;
+        Py_INCREF(left);
+        left_level = self->shift;
+    } else if (Vector_tail_off(self) == 0) {
+        left = tail_node;
+        left_level = 0;
+    } else {
+        left_level = self->shift;
+        if (tail_len == WIDTH) {
+            left = VectorTrie_push_leaf(self->root, self->shift, tail_node, NULL);
+            if (!left && !PyErr_Occurred()) {
+                left = VectorTrie_grow(self->root, self->shift, self->cnt - WIDTH, tail_node, NULL);
+                left_level += BITS;
+            }
+        } else {
+            left = VectorTrie_concat(self->root, self->shift, tail_node, 0);
+            left_level += BITS;
+        }
+        Py_DECREF(tail_node);
+        if (!left) return NULL;
+    }
+
+    VectorNode *root = VectorTrie_concat(left, left_level, other->root, other->shift);
+    int shift = (left_level > other->shift ? left_level : other->shift) + BITS;
+    Py_DECREF(left);
+    if (!root) return NULL;
+    VectorTrie_collapse(&root, &shift);
+
+    Vector *result = Vector_create(self->cnt + other->cnt, shift, root, other->tail, NULL);
+    Py_DECREF(root);
+    return (PyObject *)result;
+}
 
 static PyObject *Vector_add(Vector *self, PyObject *other) {
+    // Reflected calls (list + vector) arrive with the vector as other
+    if (!PyObject_TypeCheck(self, &VectorType)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    if (PyObject_TypeCheck(other, &VectorType)) {
+        Vector *o = (Vector *)other;
+        if (self->cnt == 0) {
+            Py_INCREF(other);
+            return other;
+        }
+        if (Vector_tail_off(o) > 0) {
+            return Vector_concat(self, o);
+        }
+    }
+
     // Try to get an iterator - this handles any iterable including Vector
     PyObject *iter = PyObject_GetIter(other);
     if (!iter) {
@@ -1097,26 +2120,111 @@ static PyObject *Vector_add(Vector *self, PyObject *other) {
 }
 
 static Py_hash_t Vector_hash(Vector *self) {
-    if (self->hash_computed) {
+    if (PDS_CACHE_READY(self->hash_computed)) {
         return self->hash;
     }
 
-    Py_hash_t h = 0;
-    for (Py_ssize_t i = 0; i < self->cnt; i++) {
-        PyObject *arr = Vector_array_for(self, i);
-        if (!arr) return -1;
+    Py_uhash_t h;
+    if (VectorTrie_hash(self->root, self->shift, &h) < 0) return -1;
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(self->tail); i++) {
+        Py_hash_t item_hash = PyObject_Hash(PyTuple_GET_ITEM(self->tail, i));
+        if (item_hash == -1) return -1;
+        h = 31 * h + (Py_uhash_t)item_hash;
+    }
 
-        PyObject *item = PyTuple_GET_ITEM(arr, i & MASK);
-        Py_hash_t item_hash = PyObject_Hash(item);
-        Py_DECREF(arr);
+    if (h == (Py_uhash_t)-1) h = (Py_uhash_t)-2;
+    self->hash = (Py_hash_t)h;
+    PDS_CACHE_PUBLISH(self->hash_computed);
+    return self->hash;
+}
 
-        if (item_hash == -1) return -1;
-        h = 31 * h + item_hash;
+// 1 if two elements differ, 0 if not, -1 on error
+static inline int pds_items_differ(PyObject *x, PyObject *y) {
+    if (x == y) return 0;
+    int eq = PyObject_RichCompareBool(x, y, Py_EQ);
+    return eq < 0 ? -1 : !eq;
+}
+
+// Index-by-index comparison of two vectors below `limit` that skips the
+// subtrees they share. `differ` is called with each index whose elements
+// differ and returns nonzero to stop the walk; without it the walk stops at
+// the first difference. Walk functions return -1 on error, 1 when stopped.
+typedef struct VectorCompare {
+    Vector *a;
+    Vector *b;
+    Py_ssize_t limit;
+    int (*differ)(struct VectorCompare *cmp, Py_ssize_t i, PyObject *y);
+    void *ctx;
+} VectorCompare;
+
+static int VectorCompare_item(VectorCompare *cmp, Py_ssize_t i, PyObject *x, PyObject *y) {
+    int d = pds_items_differ(x, y);
+    if (d <= 0) return d;
+    return cmp->differ ? cmp->differ(cmp, i, y) : 1;
+}
+
+// Indices [lo, hi) one at a time, wherever each vector keeps them
+static int VectorCompare_range(VectorCompare *cmp, Py_ssize_t lo, Py_ssize_t hi) {
+    if (hi > cmp->limit) hi = cmp->limit;
+    for (Py_ssize_t i = lo; i < hi; i++) {
+        int r = VectorCompare_item(cmp, i, Vector_item(cmp->a, i), Vector_item(cmp->b, i));
+        if (r) return r;
     }
+    return 0;
+}
 
-    self->hash = h;
-    self->hash_computed = 1;
-    return h;
+// Two trie nodes at `level` that both start at index `base`. Children
+// starting at the same index are walked together, so regular tries line up
+// all the way down and relaxed ones wherever their size tables agree; any
+// other child of a is compared element by element.
+static int VectorCompare_walk(VectorCompare *cmp, VectorNode *na, VectorNode *nb, int level, Py_ssize_t base) {
+    if (na == nb || base >= cmp->limit) return 0;
+    int n_a = VectorNode_slot_count(na);
+    int n_b = VectorNode_slot_count(nb);
+
+    if (level == 0) {
+        int n = n_a < n_b ? n_a : n_b;
+        for (int j = 0; j < n && base + j < cmp->limit; j++) {
+            int r = VectorCompare_item(cmp, base + j, na->array[j], nb->array[j]);
+            if (r) return r;
+        }
+        return VectorCompare_range(cmp, base + n, base + n_a);
+    }
+
+    Py_ssize_t sa[WIDTH], sb[WIDTH];
+    if (n_a > 0) VectorTrie_fill_sizes(na, level, n_a, sa);
+    if (n_b > 0) VectorTrie_fill_sizes(nb, level, n_b, sb);
+    for (int i = 0; i < n_a; i++) {
+        Py_ssize_t start = i > 0 ? sa[i - 1] : 0;
+        if (base + start >= cmp->limit) break;
+        int r;
+        if (i < n_b && (i > 0 ? sb[i - 1] : 0) == start) {
+            r = VectorCompare_walk(cmp, (VectorNode *)na->array[i], (VectorNode *)nb->array[i], level - BITS, base + start);
+        } else {
+            r = VectorCompare_range(cmp, base + start, base + sa[i]);
+        }
+        if (r) return r;
+    }
+    return 0;
+}
+
+// Compare every index below cmp->limit: the two tries lined up at the
+// height of the shorter one, then whatever a keeps past that
+static int VectorCompare_run(VectorCompare *cmp) {
+    Vector *a = cmp->a, *b = cmp->b;
+    VectorNode *ra = a->root, *rb = b->root;
+    int level = a->shift < b->shift ? a->shift : b->shift;
+    // A taller trie's leftmost subtree covers the indices of the shorter one
+    for (int l = a->shift; l > level && VectorNode_slot_count(ra) > 0; l -= BITS) {
+        ra = (VectorNode *)ra->array[0];
+    }
+    for (int l = b->shift; l > level && VectorNode_slot_count(rb) > 0; l -= BITS) {
+        rb = (VectorNode *)rb->array[0];
+    }
+    Py_ssize_t walked = a->shift > level ? VectorTrie_count(ra, level) : Vector_tail_off(a);
+    int r = VectorCompare_walk(cmp, ra, rb, level, 0);
+    if (r) return r;
+    return VectorCompare_range(cmp, walked, cmp->limit);
 }
 
 static PyObject *Vector_richcompare(Vector *self, PyObject *other, int op) {
@@ -1136,28 +2244,15 @@ static PyObject *Vector_richcompare(Vector *self, PyObject *other, int op) {
     if (self->cnt != o->cnt) {
         return PyBool_FromLong(op == Py_NE);
     }
-
-    for (Py_ssize_t i = 0; i < self->cnt; i++) {
-        PyObject *arr1 = Vector_array_for(self, i);
-        PyObject *arr2 = Vector_array_for(o, i);
-        if (!arr1 || !arr2) {
-            Py_XDECREF(arr1);
-            Py_XDECREF(arr2);
-            return NULL;
-        }
-
-        int cmp = PyObject_RichCompareBool(PyTuple_GET_ITEM(arr1, i & MASK),
-                                           PyTuple_GET_ITEM(arr2, i & MASK), Py_EQ);
-        Py_DECREF(arr1);
-        Py_DECREF(arr2);
-
-        if (cmp < 0) return NULL;
-        if (!cmp) {
-            return PyBool_FromLong(op == Py_NE);
-        }
+    if (PDS_CACHE_READY(self->hash_computed) && PDS_CACHE_READY(o->hash_computed) && self->hash != o->hash) {
+        return PyBool_FromLong(op == Py_NE);
     }
 
-    return PyBool_FromLong(op == Py_EQ);
+    // Shared subtrees (one conj or assoc apart) are skipped by identity
+    VectorCompare cmp = {self, o, self->cnt, NULL, NULL};
+    int r = VectorCompare_run(&cmp);
+    if (r < 0) return NULL;
+    return PyBool_FromLong((op == Py_EQ) == (r == 0));
 }
 
 static PyObject *Vector_repr(Vector *self) {
@@ -1165,16 +2260,7 @@ static PyObject *Vector_repr(Vector *self) {
     if (!parts) return NULL;
 
     for (Py_ssize_t i = 0; i < self->cnt; i++) {
-        PyObject *arr = Vector_array_for(self, i);
-        if (!arr) {
-            Py_DECREF(parts);
-            return NULL;
-        }
-
-        PyObject *item = PyTuple_GET_ITEM(arr, i & MASK);
-        PyObject *repr = PyObject_Repr(item);
-        Py_DECREF(arr);
-
+        PyObject *repr = PyObject_Repr(Vector_item(self, i));
         if (!repr) {
             Py_DECREF(parts);
             return NULL;
@@ -1204,55 +2290,11 @@ static PyObject *Vector_repr(Vector *self) {
 }
 
 
-static PyObject *Vector_to_seq(Vector *self, PyObject *Py_UNUSED(ignored)) {
-    if (self->cnt == 0) {
-        Py_RETURN_NONE;
-    }
-
-    // Build Cons list in reverse, processing chunks at a time
-    // Uses Vector_node_for to avoid creating intermediate tuples
-    Cons *result = NULL;
-    Py_ssize_t i = self->cnt - 1;
-
-    while (i >= 0) {
-        // Determine the chunk boundaries for this index
-        Py_ssize_t chunk_start = (i >> BITS) << BITS;
-
-        // Get direct access to the array for this chunk (no tuple allocation)
-        int is_tail;
-        VectorNode *node = Vector_node_for(self, i, &is_tail);
-
-        // Process all elements in this chunk, from i down to chunk_start
-        for (Py_ssize_t j = i; j >= chunk_start; j--) {
-            PyObject *item;
-            if (is_tail) {
-                item = PyTuple_GET_ITEM(self->tail, j & MASK);
-            } else {
-                item = node->array[j & MASK];
-                if (item == NULL) item = Py_None;
-            }
-
-            Cons *new_cons = (Cons *)ConsType.tp_alloc(&ConsType, 0);
-            if (!new_cons) {
-                Py_XDECREF(result);
-                return NULL;
-            }
-
-            Py_INCREF(item);
-            new_cons->first = item;
-            new_cons->rest = result ? (PyObject *)result : Py_None;
-            Py_INCREF(new_cons->rest);
-            new_cons->hash = 0;
-            new_cons->hash_computed = 0;
+static PyObject *ChunkedSeq_from_vector(Vector *v);
 
-            result = new_cons;
-        }
-
-        // Move to the last element of the previous chunk
-        i = chunk_start - 1;
-    }
-
-    return (PyObject *)result;
+// Seq over the vector, handed out a leaf at a time rather than cell by cell
+static PyObject *Vector_to_seq(Vector *self, PyObject *Py_UNUSED(ignored)) {
+    return ChunkedSeq_from_vector(self);
 }
 
 /* Vector.copy() - returns self since Vector is immutable */
@@ -1379,17 +2421,141 @@ static PyObject *Vector_reduce(Vector *self, PyObject *Py_UNUSED(ignored)) {
     return result;
 }
 
+/* Vector.reduce(f[, init]) - fold f over the elements a leaf at a time */
+static PyObject *Vector_reduce_fn(Vector *self, PyObject *args) {
+    PyObject *f;
+    PyObject *acc = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O:reduce", &f, &acc)) {
+        return NULL;
+    }
+    if (self->cnt == 0 && acc == NULL) {
+        return PyObject_CallNoArgs(f);
+    }
+    Py_XINCREF(acc);
+
+    Py_ssize_t tail_off = Vector_tail_off(self);
+    Py_ssize_t i = 0;
+    while (i < tail_off) {
+        Py_ssize_t start, len;
+        VectorNode *leaf = VectorTrie_leaf_for(self->root, self->shift, i, &start, &len);
+        for (Py_ssize_t j = 0; j < len; j++) {
+            if (reduce_step(f, &acc, leaf->array[j]) < 0) goto error;
+        }
+        i = start + len;
+    }
+    for (Py_ssize_t j = 0; j < PyTuple_GET_SIZE(self->tail); j++) {
+        if (reduce_step(f, &acc, PyTuple_GET_ITEM(self->tail, j)) < 0) goto error;
+    }
+    return acc;
+
+error:
+    Py_XDECREF(acc);
+    return NULL;
+}
+
+// Build a vector from n borrowed items: full 32-element leaves are filled
+// directly and internal nodes stacked on top one level at a time, leaving
+// the final partial chunk as the tail, the shape repeated conj produces
+static PyObject *Vector_from_items(PyObject *const *items, Py_ssize_t n) {
+    if (n == 0) {
+        Py_INCREF(EMPTY_VECTOR);
+        return (PyObject *)EMPTY_VECTOR;
+    }
+
+    Py_ssize_t tail_off = ((n - 1) >> BITS) << BITS;
+    Py_ssize_t len = tail_off >> BITS;
+    int shift = BITS;
+    while (((Py_ssize_t)1 << shift) < len) shift += BITS;
+
+    PyObject *tail = PyTuple_New(n - tail_off);
+    if (!tail) return NULL;
+    for (Py_ssize_t i = tail_off; i < n; i++) {
+        Py_INCREF(items[i]);
+        PyTuple_SET_ITEM(tail, i - tail_off, items[i]);
+    }
+
+    VectorNode *root = NULL;
+    if (len > 0) {
+        VectorNode **nodes = PyMem_Malloc(len * sizeof(VectorNode *));
+        if (!nodes) {
+            Py_DECREF(tail);
+            return PyErr_NoMemory();
+        }
+
+        Py_ssize_t live = 0;
+        for (; live < len; live++) {
+            VectorNode *leaf = VectorNode_create(NULL);
+            if (!leaf) goto error;
+            for (int j = 0; j < WIDTH; j++) {
+                leaf->array[j] = items[live * WIDTH + j];
+                Py_INCREF(leaf->array[j]);
+            }
+            nodes[live] = leaf;
+        }
+
+        // Parents overwrite the front of nodes[] as their children are consumed
+        for (int level = BITS; level <= shift; level += BITS) {
+            Py_ssize_t parents = (len + MASK) >> BITS;
+            for (Py_ssize_t p = 0; p < parents; p++) {
+                VectorNode *parent = VectorNode_create(NULL);
+                if (!parent) {
+                    for (Py_ssize_t i = 0; i < p; i++) Py_DECREF(nodes[i]);
+                    for (Py_ssize_t i = p * WIDTH; i < len; i++) Py_DECREF(nodes[i]);
+                    live = 0;
+                    goto error;
+                }
+                for (int c = 0; c < WIDTH && p * WIDTH + c < len; c++) {
+                    parent->array[c] = (PyObject *)nodes[p * WIDTH + c];
+                }
+                nodes[p] = parent;
+            }
+            len = parents;
+        }
+        root = nodes[0];
+        PyMem_Free(nodes);
+        goto done;
+
+    error:
+        for (Py_ssize_t i = 0; i < live; i++) Py_DECREF(nodes[i]);
+        PyMem_Free(nodes);
+        Py_DECREF(tail);
+        return NULL;
+    }
+
+done:;
+    Vector *vec = Vector_create(n, shift, root, tail, NULL);
+    Py_XDECREF(root);
+    Py_DECREF(tail);
+    return (PyObject *)vec;
+}
+
+/* Vector.from_iterable(iterable) - build a vector in bulk */
+static PyObject *Vector_from_iterable(PyObject *cls, PyObject *iterable) {
+    if (PyObject_TypeCheck(iterable, &VectorType)) {
+        Py_INCREF(iterable);
+        return iterable;
+    }
+    PyObject *seq = PySequence_Fast(iterable, "Vector.from_iterable expects an iterable");
+    if (!seq) return NULL;
+    PyObject *result = Vector_from_items(PySequence_Fast_ITEMS(seq), PySequence_Fast_GET_SIZE(seq));
+    Py_DECREF(seq);
+    return result;
+}
+
 static PyMethodDef Vector_methods[] = {
+    {"from_iterable", (PyCFunction)Vector_from_iterable, METH_O | METH_CLASS, "Build a vector from an iterable in bulk, leaf by leaf"},
     {"nth", (PyCFunction)Vector_nth, METH_VARARGS, "Get element at index"},
     {"conj", (PyCFunction)Vector_conj, METH_O, "Add element to end"},
     {"assoc", (PyCFunction)Vector_assoc, METH_VARARGS, "Set element at index"},
     {"pop", (PyCFunction)Vector_pop, METH_NOARGS, "Remove last element"},
     {"transient", (PyCFunction)Vector_transient, METH_NOARGS, "Get transient version"},
-    {"to_seq", (PyCFunction)Vector_to_seq, METH_NOARGS, "Convert to Cons sequence"},
+    {"to_seq", (PyCFunction)Vector_to_seq, METH_NOARGS, "Convert to a ChunkedSeq, read a leaf at a time"},
     {"copy", (PyCFunction)Vector_copy, METH_NOARGS, "Return self (immutable vectors don't need copying)"},
     {"index", (PyCFunction)Vector_index, METH_VARARGS, "Return index of first occurrence of value"},
     {"count", (PyCFunction)Vector_count, METH_O, "Return number of occurrences of value"},
     {"sort", (PyCFunction)Vector_sort, METH_VARARGS | METH_KEYWORDS, "Return a new sorted vector"},
+    {"reduce", (PyCFunction)Vector_reduce_fn, METH_VARARGS, "Reduce with f(acc, x), walking leaf arrays directly"},
     {"__reduce__", (PyCFunction)Vector_reduce, METH_NOARGS, "Pickle support"},
     {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
      "Return a generic alias for type annotations (e.g., Vector[int])"},
@@ -1411,12 +2577,8 @@ static PyObject *Vector_sq_item(Vector *self, Py_ssize_t i) {
         return NULL;
     }
 
-    PyObject *arr = Vector_array_for(self, i);
-    if (!arr) return NULL;
-
-    PyObject *result = PyTuple_GET_ITEM(arr, i & MASK);
+    PyObject *result = Vector_item(self, i);
     Py_INCREF(result);
-    Py_DECREF(arr);
     return result;
 }
 
@@ -1434,9 +2596,9 @@ typedef struct {
     PyObject_HEAD
     Vector *vec;
     Py_ssize_t index;
-    VectorNode *cached_node;   // Cached tree node (NULL if in tail)
-    Py_ssize_t cached_chunk;   // Which chunk is cached (chunk_start index)
-    int cached_is_tail;        // Whether cached chunk is the tail
+    VectorNode *cached_node;   // Cached leaf (NULL if in tail)
+    Py_ssize_t cached_start;   // Index of the first element of the cached chunk
+    Py_ssize_t cached_end;     // One past the last element of the cached chunk
 } VectorIterator;
 
 static PyTypeObject VectorIteratorType;
@@ -1453,20 +2615,27 @@ static PyObject *VectorIterator_next(VectorIterator *self) {
     }
 
     // Check if we need to fetch a new chunk
-    Py_ssize_t chunk_start = (self->index >> BITS) << BITS;
-    if (chunk_start != self->cached_chunk) {
-        Py_XDECREF(self->cached_node);
-        self->cached_node = Vector_node_for(self->vec, self->index, &self->cached_is_tail);
-        Py_XINCREF(self->cached_node);
-        self->cached_chunk = chunk_start;
+    if (self->index >= self->cached_end) {
+        Vector *vec = self->vec;
+        Py_ssize_t tail_off = Vector_tail_off(vec);
+        Py_CLEAR(self->cached_node);
+        if (self->index >= tail_off) {
+            self->cached_start = tail_off;
+            self->cached_end = vec->cnt;
+        } else {
+            Py_ssize_t len;
+            self->cached_node = VectorTrie_leaf_for(vec->root, vec->shift, self->index,
+                                                    &self->cached_start, &len);
+            Py_INCREF(self->cached_node);
+            self->cached_end = self->cached_start + len;
+        }
     }
 
     PyObject *result;
-    if (self->cached_is_tail) {
-        result = PyTuple_GET_ITEM(self->vec->tail, self->index & MASK);
+    if (!self->cached_node) {
+        result = PyTuple_GET_ITEM(self->vec->tail, self->index - self->cached_start);
     } else {
-        result = self->cached_node->array[self->index & MASK];
-        if (result == NULL) result = Py_None;
+        result = self->cached_node->array[self->index - self->cached_start];
     }
     Py_INCREF(result);
 
@@ -1492,8 +2661,8 @@ static PyObject *Vector_iter(Vector *self) {
     Py_INCREF(self);
     it->index = 0;
     it->cached_node = NULL;
-    it->cached_chunk = -1;  // Invalid chunk to force initial fetch
-    it->cached_is_tail = 0;
+    it->cached_start = 0;
+    it->cached_end = 0;  // Empty chunk to force initial fetch
     return (PyObject *)it;
 }
 
@@ -1571,7 +2740,7 @@ static int Vector_init(Vector *self, PyObject *args, PyObject *kwds) {
 static PyTypeObject VectorType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name = "spork.runtime.pds.Vector",
-    .tp_doc = "Persistent Vector using a bit-partitioned trie",
+    .tp_doc = "Persistent Vector using a relaxed radix balanced trie",
     .tp_basicsize = sizeof(Vector),
     .tp_itemsize = 0,
     .tp_dealloc = (destructor)Vector_dealloc,
@@ -1598,27 +2767,42 @@ static PyObject *DoubleVector_conj(DoubleVector *self, PyObject *val);
 // --- DoubleVectorNode ---
 // For internal nodes: array stores pointers to child nodes (cast to void*)
 // For leaf nodes: array stores double values
+// A leaf loaded from a snapshot instead points at values inside the mapping,
+// and owner holds a reference that keeps the mapping alive
 // We use a union to avoid strict-aliasing issues
 typedef struct DoubleVectorNode {
     PyObject_HEAD
     union {
         double values[WIDTH];
         struct DoubleVectorNode *children[WIDTH];
+        const double *mapped;
     } data;
-    int valid_mask;  // Bitmask of which slots are valid
+    uint32_t valid_mask;  // Bitmask of which slots are valid
     PyObject *transient_id;
+    PyObject *owner;  // exporter of data.mapped, or NULL
+    Py_hash_t hash;  // cached hash of the elements below (see DoubleVectorNode_hash)
+    int hash_computed;
+    int is_leaf;  // data holds values; otherwise it holds (owned) children
 } DoubleVectorNode;
 
+// The values of a leaf, wherever they live
+#define DVN_VALUES(node) ((node)->owner ? (node)->data.mapped : (const double *)(node)->data.values)
+
 static PyTypeObject DoubleVectorNodeType;
 
 static void DoubleVectorNode_dealloc(DoubleVectorNode *self) {
+    if (!self->is_leaf) {
+        for (int i = 0; i < WIDTH; i++) Py_XDECREF(self->data.children[i]);
+    }
     Py_XDECREF(self->transient_id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    Py_XDECREF(self->owner);
+    pds_recycle(PDS_FL(double_node), (PyObject *)self, &DoubleVectorNodeType);
 }
 
 static DoubleVectorNode *DoubleVectorNode_create(PyObject *transient_id) {
-    DoubleVectorNode *node = PyObject_New(DoubleVectorNode, &DoubleVectorNodeType);
+    DoubleVectorNode *node = (DoubleVectorNode *)pds_alloc(PDS_FL(double_node), &DoubleVectorNodeType);
     if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_DOUBLE_VECTOR);
 
     for (int i = 0; i < WIDTH; i++) {
         node->data.values[i] = 0.0;
@@ -1627,15 +2811,28 @@ static DoubleVectorNode *DoubleVectorNode_create(PyObject *transient_id) {
     node->valid_mask = 0;
     node->transient_id = transient_id;
     Py_XINCREF(transient_id);
+    node->owner = NULL;
+    node->hash = 0;
+    node->hash_computed = 0;
+    node->is_leaf = 0;
     return node;
 }
 
 static DoubleVectorNode *DoubleVectorNode_clone(DoubleVectorNode *self, PyObject *transient_id) {
     DoubleVectorNode *node = DoubleVectorNode_create(transient_id);
     if (!node) return NULL;
+    PDS_STAT_COPY(PDS_NODE_DOUBLE_VECTOR);
 
-    // Copy the entire union
-    memcpy(&node->data, &self->data, sizeof(self->data));
+    // Copy the entire union; a mapped leaf's copy gets its values inline
+    if (self->owner) {
+        memcpy(node->data.values, self->data.mapped, sizeof(node->data.values));
+    } else {
+        memcpy(&node->data, &self->data, sizeof(self->data));
+    }
+    if (!self->is_leaf) {
+        for (int i = 0; i < WIDTH; i++) Py_XINCREF(node->data.children[i]);
+    }
+    node->is_leaf = self->is_leaf;
     node->valid_mask = self->valid_mask;
     return node;
 }
@@ -1762,7 +2959,7 @@ static double *DoubleVector_array_for(DoubleVector *self, Py_ssize_t i) {
         int idx = (i >> level) & MASK;
         node = node->data.children[idx];
     }
-    return node->data.values;
+    return (double *)DVN_VALUES(node);
 }
 
 // Get raw double at index (no boxing)
@@ -1887,7 +3084,7 @@ static DoubleVectorNode *DoubleVector_push_tail(DoubleVector *self, int level, D
         Py_INCREF(tail_node);
     } else {
         DoubleVectorNode *child = parent->data.children[subidx];
-        if (child != NULL && (parent->valid_mask & (1 << subidx))) {
+        if (child != NULL && (parent->valid_mask & (1u << subidx))) {
             node_to_insert = DoubleVector_push_tail(self, level - BITS, child, tail_node, transient_id);
         } else {
             node_to_insert = DoubleVector_new_path(self, level - BITS, tail_node, transient_id);
@@ -1898,12 +3095,10 @@ static DoubleVectorNode *DoubleVector_push_tail(DoubleVector *self, int level, D
         }
     }
 
-    // Clean up old child if present
-    if (ret->valid_mask & (1 << subidx)) {
-        Py_XDECREF(ret->data.children[subidx]);
-    }
+    // ret owns a reference to the child it replaces (clones take one per child)
+    Py_XDECREF(ret->data.children[subidx]);
     ret->data.children[subidx] = node_to_insert;
-    ret->valid_mask |= (1 << subidx);
+    ret->valid_mask |= (1u << subidx);
     return ret;
 }
 
@@ -1939,10 +3134,11 @@ static PyObject *DoubleVector_conj(DoubleVector *self, PyObject *val) {
     // Tail is full, push into trie
     DoubleVectorNode *tail_node = DoubleVectorNode_create(transient_id);
     if (!tail_node) return NULL;
+    tail_node->is_leaf = 1;
 
     for (Py_ssize_t i = 0; i < self->tail_len && i < WIDTH; i++) {
         tail_node->data.values[i] = self->tail[i];
-        tail_node->valid_mask |= (1 << i);
+        tail_node->valid_mask |= (1u << i);
     }
 
     int new_shift = self->shift;
@@ -2042,32 +3238,107 @@ static PyObject *DoubleVector_repr(DoubleVector *self) {
     return final;
 }
 
-static Py_hash_t DoubleVector_hash(DoubleVector *self) {
-    if (self->hash_computed) {
-        return self->hash;
+// Hash of the `count` elements below a node at `level`, cached on the node
+// as in VectorTrie_hash
+static Py_uhash_t DoubleVectorNode_hash(DoubleVectorNode *node, int level, Py_ssize_t count) {
+    if (PDS_CACHE_READY(node->hash_computed)) {
+        return (Py_uhash_t)node->hash;
     }
 
-    Py_hash_t h = 0;
-    for (Py_ssize_t i = 0; i < self->cnt; i++) {
-        double val = DoubleVector_nth_raw(self, i);
-        // Hash the double bytes
-        Py_hash_t item_hash = _Py_HashDouble((PyObject *)self, val);
-        if (item_hash == -1 && PyErr_Occurred()) {
-            return -1;
+    Py_uhash_t h = 0;
+    if (level == 0) {
+        for (Py_ssize_t i = 0; i < count; i++) {
+            h = 31 * h + (Py_uhash_t)_Py_HashDouble((PyObject *)node, DVN_VALUES(node)[i]);
+        }
+    } else {
+        Py_ssize_t span = (Py_ssize_t)1 << level;
+        Py_uhash_t factor = pds_pow31(span);
+        for (int i = 0; count > 0; i++, count -= span) {
+            Py_ssize_t n = count < span ? count : span;
+            h = h * (n == span ? factor : pds_pow31(n)) + DoubleVectorNode_hash(node->data.children[i], level - BITS, n);
         }
-        h = 31 * h + item_hash;
     }
 
-    if (h == -1) h = -2;
-    self->hash = h;
-    self->hash_computed = 1;
+    node->hash = (Py_hash_t)h;
+    PDS_CACHE_PUBLISH(node->hash_computed);
     return h;
 }
 
-// Buffer Protocol Implementation for DoubleVector
-static int DoubleVector_flatten(DoubleVector *self) {
-    // Optimistic check - use atomic load for thread safety in free-threaded Python
-#if HAVE_STDATOMIC
+static Py_hash_t DoubleVector_hash(DoubleVector *self) {
+    if (PDS_CACHE_READY(self->hash_computed)) {
+        return self->hash;
+    }
+
+    Py_uhash_t h = DoubleVectorNode_hash(self->root, self->shift, DoubleVector_tail_off(self));
+    for (Py_ssize_t i = 0; i < self->tail_len; i++) {
+        h = 31 * h + (Py_uhash_t)_Py_HashDouble((PyObject *)self, self->tail[i]);
+    }
+
+    if (h == (Py_uhash_t)-1) h = (Py_uhash_t)-2;
+    self->hash = (Py_hash_t)h;
+    PDS_CACHE_PUBLISH(self->hash_computed);
+    return self->hash;
+}
+
+// 1 if the `count` elements below two nodes at `level` are equal, skipping
+// shared subtrees by identity
+static int DoubleVectorNode_equal(DoubleVectorNode *a, DoubleVectorNode *b, int level, Py_ssize_t count) {
+    if (a == b) return 1;
+    if (level == 0) {
+        for (Py_ssize_t i = 0; i < count; i++) {
+            if (DVN_VALUES(a)[i] != DVN_VALUES(b)[i]) return 0;
+        }
+        return 1;
+    }
+    Py_ssize_t span = (Py_ssize_t)1 << level;
+    for (int i = 0; count > 0; i++, count -= span) {
+        if (!DoubleVectorNode_equal(a->data.children[i], b->data.children[i], level - BITS, count < span ? count : span)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static PyObject *DoubleVector_richcompare(DoubleVector *self, PyObject *other, int op) {
+    if (op != Py_EQ && op != Py_NE) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    if (self == (DoubleVector *)other) {
+        return PyBool_FromLong(op == Py_EQ);
+    }
+    if (!PyObject_TypeCheck(other, &DoubleVectorType)) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+
+    DoubleVector *o = (DoubleVector *)other;
+    if (self->cnt != o->cnt) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+    if (PDS_CACHE_READY(self->hash_computed) && PDS_CACHE_READY(o->hash_computed) && self->hash != o->hash) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+
+    // Equal counts give both tries the same shape unless one was left taller
+    int eq = 1;
+    Py_ssize_t tail_off = DoubleVector_tail_off(self);
+    if (self->shift == o->shift) {
+        eq = DoubleVectorNode_equal(self->root, o->root, self->shift, tail_off);
+        for (Py_ssize_t i = 0; eq && i < self->tail_len; i++) {
+            eq = self->tail[i] == o->tail[i];
+        }
+    } else {
+        for (Py_ssize_t i = 0; eq && i < self->cnt; i++) {
+            eq = DoubleVector_nth_raw(self, i) == DoubleVector_nth_raw(o, i);
+        }
+    }
+    return PyBool_FromLong((op == Py_EQ) == eq);
+}
+
+// Buffer Protocol Implementation for DoubleVector
+static int DoubleVector_flatten(DoubleVector *self) {
+    PDS_STAT_ADD(flatten_calls, 1);
+    // Optimistic check - use atomic load for thread safety in free-threaded Python
+#if HAVE_STDATOMIC
     if (atomic_load_explicit((_Atomic(double *)*)&self->flat_buffer_cache, memory_order_acquire) != NULL) {
         return 0;  // Already flattened
     }
@@ -2086,14 +3357,12 @@ static int DoubleVector_flatten(DoubleVector *self) {
         PyErr_NoMemory();
         return -1;
     }
+    PDS_STAT_ADD(flatten_bytes, self->cnt * (Py_ssize_t)sizeof(double));
 
-    // Traverse trie and copy elements
-    for (Py_ssize_t i = 0; i < self->cnt; i++) {
-        buffer[i] = DoubleVector_nth_raw(self, i);
-        if (PyErr_Occurred()) {
-            free(buffer);
-            return -1;
-        }
+    // Copy the trie a leaf at a time
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+        memcpy(buffer + i, DoubleVector_array_for(self, i), n * sizeof(double));
     }
 
     // Atomic CAS: Try to swap NULL with our new buffer
@@ -2167,6 +3436,8 @@ typedef struct {
     PyObject_HEAD
     DoubleVector *vec;
     Py_ssize_t index;
+    double *leaf;             // Cached leaf (or tail) array
+    Py_ssize_t leaf_end;   // One past the last index covered by leaf
 } DoubleVectorIterator;
 
 static PyTypeObject DoubleVectorIteratorType;
@@ -2181,10 +3452,16 @@ static PyObject *DoubleVectorIterator_next(DoubleVectorIterator *self) {
         return NULL;  // StopIteration
     }
 
-    double val = DoubleVector_nth_raw(self->vec, self->index);
-    if (PyErr_Occurred()) return NULL;
-    self->index++;
-    return PyFloat_FromDouble(val);
+    if (self->index >= self->leaf_end) {
+        self->leaf = DoubleVector_array_for(self->vec, self->index);
+        if (!self->leaf) return NULL;
+        if (self->index >= DoubleVector_tail_off(self->vec)) {
+            self->leaf_end = self->vec->cnt;
+        } else {
+            self->leaf_end = (self->index | MASK) + 1;
+        }
+    }
+    return PyFloat_FromDouble(self->leaf[self->index++ & MASK]);
 }
 
 static PyTypeObject DoubleVectorIteratorType = {
@@ -2203,6 +3480,8 @@ static PyObject *DoubleVector_iter(DoubleVector *self) {
     it->vec = self;
     Py_INCREF(self);
     it->index = 0;
+    it->leaf = NULL;
+    it->leaf_end = 0;
     return (PyObject *)it;
 }
 
@@ -2276,7 +3555,7 @@ static DoubleVectorNode *TransientDoubleVector_push_tail(TransientDoubleVector *
         Py_INCREF(tail_node);
     } else {
         DoubleVectorNode *child = parent->data.children[subidx];
-        if (child != NULL && (parent->valid_mask & (1 << subidx))) {
+        if (child != NULL && (parent->valid_mask & (1u << subidx))) {
             node_to_insert = TransientDoubleVector_push_tail(self, level - BITS, child, tail_node);
         } else {
             node_to_insert = TransientDoubleVector_new_path(self, level - BITS, tail_node);
@@ -2287,11 +3566,10 @@ static DoubleVectorNode *TransientDoubleVector_push_tail(TransientDoubleVector *
         }
     }
 
-    if (ret->valid_mask & (1 << subidx)) {
-        Py_XDECREF(ret->data.children[subidx]);
-    }
+    // ret owns a reference to the child it replaces (clones take one per child)
+    Py_XDECREF(ret->data.children[subidx]);
     ret->data.children[subidx] = node_to_insert;
-    ret->valid_mask |= (1 << subidx);
+    ret->valid_mask |= (1u << subidx);
     return ret;
 }
 
@@ -2319,10 +3597,11 @@ static int TransientDoubleVector_conj_mut_raw(TransientDoubleVector *self, doubl
     // Tail is full, push into trie
     DoubleVectorNode *tail_node = DoubleVectorNode_create(self->id);
     if (!tail_node) return -1;
+    tail_node->is_leaf = 1;
 
     for (Py_ssize_t i = 0; i < self->tail_len && i < WIDTH; i++) {
         tail_node->data.values[i] = self->tail[i];
-        tail_node->valid_mask |= (1 << i);
+        tail_node->valid_mask |= (1u << i);
     }
 
     // Reset tail
@@ -2378,75 +3657,7 @@ static PyObject *TransientDoubleVector_conj_mut(TransientDoubleVector *self, PyO
         return NULL;
     }
 
-    // Room in tail?
-    if (self->cnt - TransientDoubleVector_tail_off(self) < WIDTH) {
-        // Grow tail if needed
-        if (self->tail_len >= self->tail_cap) {
-            Py_ssize_t new_cap = self->tail_cap == 0 ? WIDTH : self->tail_cap * 2;
-            if (new_cap > WIDTH) new_cap = WIDTH;
-            double *new_tail = (double *)realloc(self->tail, new_cap * sizeof(double));
-            if (!new_tail) {
-                PyErr_NoMemory();
-                return NULL;
-            }
-            self->tail = new_tail;
-            self->tail_cap = new_cap;
-        }
-        self->tail[self->tail_len++] = dval;
-        self->cnt++;
-        Py_INCREF(self);
-        return (PyObject *)self;
-    }
-
-    // Tail is full, push into trie
-    DoubleVectorNode *tail_node = DoubleVectorNode_create(self->id);
-    if (!tail_node) return NULL;
-
-    for (Py_ssize_t i = 0; i < self->tail_len && i < WIDTH; i++) {
-        tail_node->data.values[i] = self->tail[i];
-        tail_node->valid_mask |= (1 << i);
-    }
-
-    // Reset tail
-    self->tail[0] = dval;
-    self->tail_len = 1;
-
-    // Overflow root?
-    if (((size_t)self->cnt >> BITS) > (1ULL << self->shift)) {
-        DoubleVectorNode *new_root = DoubleVectorNode_create(self->id);
-        if (!new_root) {
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        new_root->data.children[0] = self->root;
-        Py_INCREF(self->root);
-        new_root->valid_mask = 1;
-
-        DoubleVectorNode *path = TransientDoubleVector_new_path(self, self->shift, tail_node);
-        if (!path) {
-            Py_DECREF(new_root);
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        new_root->data.children[1] = path;
-        new_root->valid_mask |= 2;
-
-        Py_DECREF(self->root);
-        self->root = new_root;
-        self->shift += BITS;
-    } else {
-        DoubleVectorNode *new_root = TransientDoubleVector_push_tail(self, self->shift, self->root, tail_node);
-        if (!new_root) {
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        Py_DECREF(self->root);
-        self->root = new_root;
-    }
-
-    Py_DECREF(tail_node);
-    self->cnt++;
-
+    if (TransientDoubleVector_conj_mut_raw(self, dval) < 0) return NULL;
     Py_INCREF(self);
     return (PyObject *)self;
 }
@@ -2616,11 +3827,234 @@ static PyObject *DoubleVector_reduce(DoubleVector *self, PyObject *Py_UNUSED(ign
     return result;
 }
 
+/* DoubleVector.__reduce_ex__(protocol) - from protocol 2 on, pickle the elements
+   as one block of little-endian words for _typed_vector. Under protocol 5 the
+   block is a PickleBuffer over the vector's own buffer, so it is neither
+   copied nor boxed and may travel out of band. */
+static PyObject *DoubleVector_reduce_ex(DoubleVector *self, PyObject *arg) {
+    long protocol = PyLong_AsLong(arg);
+    if (protocol == -1 && PyErr_Occurred()) return NULL;
+    if (protocol < 2 || Py_TYPE(self) != &DoubleVectorType) {
+        return DoubleVector_reduce(self, NULL);
+    }
+
+    PyObject *data;
+    if (PY_LITTLE_ENDIAN && protocol >= 5 && self->cnt > 0) {
+        Py_INCREF(self);
+        data = pickle_payload((PyObject *)self, protocol);
+    } else {
+        data = PyBytes_FromStringAndSize(NULL, self->cnt * (Py_ssize_t)sizeof(double));
+        char *out = data ? PyBytes_AS_STRING(data) : NULL;
+        for (Py_ssize_t i = 0; out != NULL && i < self->cnt; i += WIDTH) {
+            Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+            le64_copy(out + i * sizeof(double), (const char *)DoubleVector_array_for(self, i), n);
+        }
+        data = pickle_payload(data, protocol);
+    }
+    if (data == NULL) return NULL;
+
+    PyObject *fn = pds_module_function("_typed_vector");
+    if (fn == NULL) {
+        Py_DECREF(data);
+        return NULL;
+    }
+    return Py_BuildValue("(N(CN))", fn, 'd', data);
+}
+
+/* DoubleVector.reduce(f[, init]) - fold f over the elements a leaf at a time */
+static PyObject *DoubleVector_reduce_fn(DoubleVector *self, PyObject *args) {
+    PyObject *f;
+    PyObject *acc = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O:reduce", &f, &acc)) {
+        return NULL;
+    }
+    if (self->cnt == 0 && acc == NULL) {
+        return PyObject_CallNoArgs(f);
+    }
+    Py_XINCREF(acc);
+
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        double *arr = DoubleVector_array_for(self, i);
+        if (!arr) goto error;
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+        for (Py_ssize_t j = 0; j < n; j++) {
+            PyObject *item = PyFloat_FromDouble(arr[j]);
+            if (!item) goto error;
+            int rc = reduce_step(f, &acc, item);
+            Py_DECREF(item);
+            if (rc < 0) goto error;
+        }
+    }
+    return acc;
+
+error:
+    Py_XDECREF(acc);
+    return NULL;
+}
+
+// --- DoubleVector numeric kernels ---
+// These run a leaf (WIDTH doubles) at a time over the trie and the tail, with
+// no flattening and no boxing. Inner loops are branch-free so the compiler
+// can vectorize them.
+
+static PyObject *DoubleVector_sum(DoubleVector *self, PyObject *Py_UNUSED(ignored)) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        double *arr = DoubleVector_array_for(self, i);
+        if (!arr) return NULL;
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+        Py_ssize_t j = 0;
+        for (; j + 4 <= n; j += 4) {
+            s0 += arr[j];
+            s1 += arr[j + 1];
+            s2 += arr[j + 2];
+            s3 += arr[j + 3];
+        }
+        for (; j < n; j++) s0 += arr[j];
+    }
+    return PyFloat_FromDouble((s0 + s1) + (s2 + s3));
+}
+
+static PyObject *DoubleVector_mean(DoubleVector *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->cnt == 0) {
+        PyErr_SetString(PyExc_ValueError, "mean of an empty vector");
+        return NULL;
+    }
+    PyObject *sum = DoubleVector_sum(self, NULL);
+    if (!sum) return NULL;
+    double mean = PyFloat_AS_DOUBLE(sum) / (double)self->cnt;
+    Py_DECREF(sum);
+    return PyFloat_FromDouble(mean);
+}
+
+static PyObject *DoubleVector_extreme(DoubleVector *self, int want_max) {
+    if (self->cnt == 0) {
+        PyErr_SetString(PyExc_ValueError, want_max ? "max of an empty vector" : "min of an empty vector");
+        return NULL;
+    }
+    double m = DoubleVector_nth_raw(self, 0);
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        double *arr = DoubleVector_array_for(self, i);
+        if (!arr) return NULL;
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+        if (want_max) {
+            for (Py_ssize_t j = 0; j < n; j++) m = arr[j] > m ? arr[j] : m;
+        } else {
+            for (Py_ssize_t j = 0; j < n; j++) m = arr[j] < m ? arr[j] : m;
+        }
+    }
+    return PyFloat_FromDouble(m);
+}
+
+static PyObject *DoubleVector_min(DoubleVector *self, PyObject *Py_UNUSED(ignored)) {
+    return DoubleVector_extreme(self, 0);
+}
+
+static PyObject *DoubleVector_max(DoubleVector *self, PyObject *Py_UNUSED(ignored)) {
+    return DoubleVector_extreme(self, 1);
+}
+
+static PyObject *DoubleVector_dot(DoubleVector *self, PyObject *other) {
+    if (!PyObject_TypeCheck(other, &DoubleVectorType)) {
+        PyErr_SetString(PyExc_TypeError, "dot expects a DoubleVector");
+        return NULL;
+    }
+    DoubleVector *o = (DoubleVector *)other;
+    if (o->cnt != self->cnt) {
+        PyErr_SetString(PyExc_ValueError, "dot of vectors with different lengths");
+        return NULL;
+    }
+
+    // Equal lengths mean equal leaf boundaries, so leaves pair up one to one
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        double *a = DoubleVector_array_for(self, i);
+        double *b = DoubleVector_array_for(o, i);
+        if (!a || !b) return NULL;
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+        Py_ssize_t j = 0;
+        for (; j + 4 <= n; j += 4) {
+            s0 += a[j] * b[j];
+            s1 += a[j + 1] * b[j + 1];
+            s2 += a[j + 2] * b[j + 2];
+            s3 += a[j + 3] * b[j + 3];
+        }
+        for (; j < n; j++) s0 += a[j] * b[j];
+    }
+    return PyFloat_FromDouble((s0 + s1) + (s2 + s3));
+}
+
+static void DoubleVector_apply_scalar(const double *in, double *out, Py_ssize_t n, int op, double x) {
+    switch (op) {
+        case '+': for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] + x; break;
+        case '-': for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] - x; break;
+        case '*': for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] * x; break;
+        default:  for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] / x; break;
+    }
+}
+
+// Copy of the subtree at `level` with every leaf value replaced by value op x
+static DoubleVectorNode *DoubleVectorNode_map_scalar(DoubleVectorNode *node, int level, int op, double x) {
+    DoubleVectorNode *ret = DoubleVectorNode_create(NULL);
+    if (!ret) return NULL;
+    ret->valid_mask = node->valid_mask;
+
+    if (level == 0) {
+        ret->is_leaf = 1;
+        DoubleVector_apply_scalar(DVN_VALUES(node), ret->data.values, WIDTH, op, x);
+        return ret;
+    }
+    for (int i = 0; i < WIDTH; i++) {
+        if ((node->valid_mask & (1u << i)) && node->data.children[i] != NULL) {
+            ret->data.children[i] = DoubleVectorNode_map_scalar(node->data.children[i], level - BITS, op, x);
+            if (!ret->data.children[i]) {
+                Py_DECREF(ret);
+                return NULL;
+            }
+        }
+    }
+    return ret;
+}
+
+/* DoubleVector.map_scalar(op, x) - new vector of v op x, op one of + - * / */
+static PyObject *DoubleVector_map_scalar(DoubleVector *self, PyObject *args) {
+    PyObject *op_obj;
+    double x;
+
+    if (!PyArg_ParseTuple(args, "Od:map_scalar", &op_obj, &x)) {
+        return NULL;
+    }
+    int op = kernel_arith_op(op_obj);
+    if (op < 0) return NULL;
+
+    DoubleVectorNode *root = DoubleVectorNode_map_scalar(self->root, self->shift, op, x);
+    if (!root) return NULL;
+
+    double tail[WIDTH];
+    DoubleVector_apply_scalar(self->tail, tail, self->tail_len, op, x);
+    DoubleVector *result = DoubleVector_create(self->cnt, self->shift, root, tail, self->tail_len, NULL);
+    Py_DECREF(root);
+    return (PyObject *)result;
+}
+
+// Defined with the IntVector kernels, which produce its result type
+static PyObject *DoubleVector_compare(DoubleVector *self, PyObject *args);
+
 static PyMethodDef DoubleVector_methods[] = {
     {"nth", (PyCFunction)DoubleVector_nth, METH_VARARGS, "Get element at index"},
     {"conj", (PyCFunction)DoubleVector_conj, METH_O, "Add element to end"},
     {"transient", (PyCFunction)DoubleVector_transient, METH_NOARGS, "Return transient version for batch operations"},
+    {"reduce", (PyCFunction)DoubleVector_reduce_fn, METH_VARARGS, "Reduce with f(acc, x), walking leaf arrays directly"},
+    {"sum", (PyCFunction)DoubleVector_sum, METH_NOARGS, "Sum of the elements"},
+    {"mean", (PyCFunction)DoubleVector_mean, METH_NOARGS, "Arithmetic mean of the elements"},
+    {"min", (PyCFunction)DoubleVector_min, METH_NOARGS, "Smallest element"},
+    {"max", (PyCFunction)DoubleVector_max, METH_NOARGS, "Largest element"},
+    {"dot", (PyCFunction)DoubleVector_dot, METH_O, "Dot product with a DoubleVector of the same length"},
+    {"map_scalar", (PyCFunction)DoubleVector_map_scalar, METH_VARARGS, "New vector of v op x for op in '+', '-', '*', '/'"},
+    {"compare", (PyCFunction)DoubleVector_compare, METH_VARARGS, "IntVector mask of v op x for op in '<', '<=', '==', '!=', '>', '>='"},
     {"__reduce__", (PyCFunction)DoubleVector_reduce, METH_NOARGS, "Pickle support"},
+    {"__reduce_ex__", (PyCFunction)DoubleVector_reduce_ex, METH_O, "Pickle support, as a typed buffer from protocol 2"},
     {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
      "Return a generic alias for type annotations"},
     {NULL}
@@ -2663,6 +4097,7 @@ static PyTypeObject DoubleVectorType = {
     .tp_as_sequence = &DoubleVector_as_sequence,
     .tp_as_mapping = &DoubleVector_as_mapping,
     .tp_hash = (hashfunc)DoubleVector_hash,
+    .tp_richcompare = (richcmpfunc)DoubleVector_richcompare,
     .tp_flags = Py_TPFLAGS_DEFAULT,
     .tp_iter = (getiterfunc)DoubleVector_iter,
     .tp_methods = DoubleVector_methods,
@@ -2683,21 +4118,33 @@ typedef struct IntVectorNode {
     union {
         int64_t values[WIDTH];
         struct IntVectorNode *children[WIDTH];
+        const int64_t *mapped;
     } data;
-    int valid_mask;
+    uint32_t valid_mask;
     PyObject *transient_id;
+    PyObject *owner;  // exporter of data.mapped, or NULL (see DoubleVectorNode)
+    Py_hash_t hash;  // cached hash of the elements below (see IntVectorNode_hash)
+    int hash_computed;
+    int is_leaf;
 } IntVectorNode;
 
+#define IVN_VALUES(node) ((node)->owner ? (node)->data.mapped : (const int64_t *)(node)->data.values)
+
 static PyTypeObject IntVectorNodeType;
 
 static void IntVectorNode_dealloc(IntVectorNode *self) {
+    if (!self->is_leaf) {
+        for (int i = 0; i < WIDTH; i++) Py_XDECREF(self->data.children[i]);
+    }
     Py_XDECREF(self->transient_id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    Py_XDECREF(self->owner);
+    pds_recycle(PDS_FL(int_node), (PyObject *)self, &IntVectorNodeType);
 }
 
 static IntVectorNode *IntVectorNode_create(PyObject *transient_id) {
-    IntVectorNode *node = PyObject_New(IntVectorNode, &IntVectorNodeType);
+    IntVectorNode *node = (IntVectorNode *)pds_alloc(PDS_FL(int_node), &IntVectorNodeType);
     if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_INT_VECTOR);
 
     for (int i = 0; i < WIDTH; i++) {
         node->data.values[i] = 0;
@@ -2706,14 +4153,27 @@ static IntVectorNode *IntVectorNode_create(PyObject *transient_id) {
     node->valid_mask = 0;
     node->transient_id = transient_id;
     Py_XINCREF(transient_id);
+    node->owner = NULL;
+    node->hash = 0;
+    node->hash_computed = 0;
+    node->is_leaf = 0;
     return node;
 }
 
 static IntVectorNode *IntVectorNode_clone(IntVectorNode *self, PyObject *transient_id) {
     IntVectorNode *node = IntVectorNode_create(transient_id);
     if (!node) return NULL;
+    PDS_STAT_COPY(PDS_NODE_INT_VECTOR);
 
-    memcpy(&node->data, &self->data, sizeof(self->data));
+    if (self->owner) {
+        memcpy(node->data.values, self->data.mapped, sizeof(node->data.values));
+    } else {
+        memcpy(&node->data, &self->data, sizeof(self->data));
+    }
+    if (!self->is_leaf) {
+        for (int i = 0; i < WIDTH; i++) Py_XINCREF(node->data.children[i]);
+    }
+    node->is_leaf = self->is_leaf;
     node->valid_mask = self->valid_mask;
     return node;
 }
@@ -2839,7 +4299,7 @@ static int64_t *IntVector_array_for(IntVector *self, Py_ssize_t i) {
         int idx = (i >> level) & MASK;
         node = node->data.children[idx];
     }
-    return (int64_t *)node->data.values;
+    return (int64_t *)IVN_VALUES(node);
 }
 
 static int64_t IntVector_nth_raw(IntVector *self, Py_ssize_t i) {
@@ -2960,7 +4420,7 @@ static IntVectorNode *IntVector_push_tail(IntVector *self, int level, IntVectorN
         Py_INCREF(tail_node);
     } else {
         IntVectorNode *child = parent->data.children[subidx];
-        if (child != NULL && (parent->valid_mask & (1 << subidx))) {
+        if (child != NULL && (parent->valid_mask & (1u << subidx))) {
             node_to_insert = IntVector_push_tail(self, level - BITS, child, tail_node, transient_id);
         } else {
             node_to_insert = IntVector_new_path(self, level - BITS, tail_node, transient_id);
@@ -2971,11 +4431,10 @@ static IntVectorNode *IntVector_push_tail(IntVector *self, int level, IntVectorN
         }
     }
 
-    if (ret->valid_mask & (1 << subidx)) {
-        Py_XDECREF(ret->data.children[subidx]);
-    }
+    // ret owns a reference to the child it replaces (clones take one per child)
+    Py_XDECREF(ret->data.children[subidx]);
     ret->data.children[subidx] = node_to_insert;
-    ret->valid_mask |= (1 << subidx);
+    ret->valid_mask |= (1u << subidx);
     return ret;
 }
 
@@ -3010,10 +4469,11 @@ static PyObject *IntVector_conj(IntVector *self, PyObject *val) {
     // Tail is full, push into trie
     IntVectorNode *tail_node = IntVectorNode_create(transient_id);
     if (!tail_node) return NULL;
+    tail_node->is_leaf = 1;
 
     for (Py_ssize_t i = 0; i < self->tail_len && i < WIDTH; i++) {
         tail_node->data.values[i] = self->tail[i];
-        tail_node->valid_mask |= (1 << i);
+        tail_node->valid_mask |= (1u << i);
     }
 
     int new_shift = self->shift;
@@ -3113,27 +4573,103 @@ static PyObject *IntVector_repr(IntVector *self) {
     return final;
 }
 
+static inline Py_uhash_t IntVector_item_hash(int64_t val) {
+    return val == -1 ? (Py_uhash_t)-2 : (Py_uhash_t)val;
+}
+
+// Hash of the `count` elements below a node at `level`, cached on the node
+// as in VectorTrie_hash
+static Py_uhash_t IntVectorNode_hash(IntVectorNode *node, int level, Py_ssize_t count) {
+    if (PDS_CACHE_READY(node->hash_computed)) {
+        return (Py_uhash_t)node->hash;
+    }
+
+    Py_uhash_t h = 0;
+    if (level == 0) {
+        for (Py_ssize_t i = 0; i < count; i++) {
+            h = 31 * h + IntVector_item_hash(IVN_VALUES(node)[i]);
+        }
+    } else {
+        Py_ssize_t span = (Py_ssize_t)1 << level;
+        Py_uhash_t factor = pds_pow31(span);
+        for (int i = 0; count > 0; i++, count -= span) {
+            Py_ssize_t n = count < span ? count : span;
+            h = h * (n == span ? factor : pds_pow31(n)) + IntVectorNode_hash(node->data.children[i], level - BITS, n);
+        }
+    }
+
+    node->hash = (Py_hash_t)h;
+    PDS_CACHE_PUBLISH(node->hash_computed);
+    return h;
+}
+
 static Py_hash_t IntVector_hash(IntVector *self) {
-    if (self->hash_computed) {
+    if (PDS_CACHE_READY(self->hash_computed)) {
         return self->hash;
     }
 
-    Py_hash_t h = 0;
-    for (Py_ssize_t i = 0; i < self->cnt; i++) {
-        int64_t val = IntVector_nth_raw(self, i);
-        Py_hash_t item_hash = (Py_hash_t)val;
-        if (item_hash == -1) item_hash = -2;
-        h = 31 * h + item_hash;
+    Py_uhash_t h = IntVectorNode_hash(self->root, self->shift, IntVector_tail_off(self));
+    for (Py_ssize_t i = 0; i < self->tail_len; i++) {
+        h = 31 * h + IntVector_item_hash(self->tail[i]);
     }
 
-    if (h == -1) h = -2;
-    self->hash = h;
-    self->hash_computed = 1;
-    return h;
+    if (h == (Py_uhash_t)-1) h = (Py_uhash_t)-2;
+    self->hash = (Py_hash_t)h;
+    PDS_CACHE_PUBLISH(self->hash_computed);
+    return self->hash;
+}
+
+// 1 if the `count` elements below two nodes at `level` are equal, skipping
+// shared subtrees by identity
+static int IntVectorNode_equal(IntVectorNode *a, IntVectorNode *b, int level, Py_ssize_t count) {
+    if (a == b) return 1;
+    if (level == 0) {
+        return memcmp(IVN_VALUES(a), IVN_VALUES(b), count * sizeof(int64_t)) == 0;
+    }
+    Py_ssize_t span = (Py_ssize_t)1 << level;
+    for (int i = 0; count > 0; i++, count -= span) {
+        if (!IntVectorNode_equal(a->data.children[i], b->data.children[i], level - BITS, count < span ? count : span)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static PyObject *IntVector_richcompare(IntVector *self, PyObject *other, int op) {
+    if (op != Py_EQ && op != Py_NE) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    if (self == (IntVector *)other) {
+        return PyBool_FromLong(op == Py_EQ);
+    }
+    if (!PyObject_TypeCheck(other, &IntVectorType)) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+
+    IntVector *o = (IntVector *)other;
+    if (self->cnt != o->cnt) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+    if (PDS_CACHE_READY(self->hash_computed) && PDS_CACHE_READY(o->hash_computed) && self->hash != o->hash) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+
+    // Equal counts give both tries the same shape unless one was left taller
+    int eq = 1;
+    if (self->shift == o->shift) {
+        eq = IntVectorNode_equal(self->root, o->root, self->shift, IntVector_tail_off(self))
+             && (self->tail_len == 0 || memcmp(self->tail, o->tail, self->tail_len * sizeof(int64_t)) == 0);
+    } else {
+        for (Py_ssize_t i = 0; eq && i < self->cnt; i++) {
+            eq = IntVector_nth_raw(self, i) == IntVector_nth_raw(o, i);
+        }
+    }
+    return PyBool_FromLong((op == Py_EQ) == eq);
 }
 
 // Buffer Protocol for IntVector
 static int IntVector_flatten(IntVector *self) {
+    PDS_STAT_ADD(flatten_calls, 1);
     // Optimistic check - use atomic load for thread safety in free-threaded Python
 #if HAVE_STDATOMIC
     if (atomic_load_explicit((_Atomic(int64_t *)*)&self->flat_buffer_cache, memory_order_acquire) != NULL) {
@@ -3154,13 +4690,12 @@ static int IntVector_flatten(IntVector *self) {
         PyErr_NoMemory();
         return -1;
     }
+    PDS_STAT_ADD(flatten_bytes, self->cnt * (Py_ssize_t)sizeof(int64_t));
 
-    for (Py_ssize_t i = 0; i < self->cnt; i++) {
-        buffer[i] = IntVector_nth_raw(self, i);
-        if (PyErr_Occurred()) {
-            free(buffer);
-            return -1;
-        }
+    // Copy the trie a leaf at a time
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+        memcpy(buffer + i, IntVector_array_for(self, i), n * sizeof(int64_t));
     }
 
     // Atomic CAS: Try to swap NULL with our new buffer
@@ -3233,6 +4768,8 @@ typedef struct {
     PyObject_HEAD
     IntVector *vec;
     Py_ssize_t index;
+    int64_t *leaf;             // Cached leaf (or tail) array
+    Py_ssize_t leaf_end;   // One past the last index covered by leaf
 } IntVectorIterator;
 
 static PyTypeObject IntVectorIteratorType;
@@ -3247,10 +4784,16 @@ static PyObject *IntVectorIterator_next(IntVectorIterator *self) {
         return NULL;
     }
 
-    int64_t val = IntVector_nth_raw(self->vec, self->index);
-    if (PyErr_Occurred()) return NULL;
-    self->index++;
-    return PyLong_FromLongLong(val);
+    if (self->index >= self->leaf_end) {
+        self->leaf = IntVector_array_for(self->vec, self->index);
+        if (!self->leaf) return NULL;
+        if (self->index >= IntVector_tail_off(self->vec)) {
+            self->leaf_end = self->vec->cnt;
+        } else {
+            self->leaf_end = (self->index | MASK) + 1;
+        }
+    }
+    return PyLong_FromLongLong(self->leaf[self->index++ & MASK]);
 }
 
 static PyTypeObject IntVectorIteratorType = {
@@ -3269,6 +4812,8 @@ static PyObject *IntVector_iter(IntVector *self) {
     it->vec = self;
     Py_INCREF(self);
     it->index = 0;
+    it->leaf = NULL;
+    it->leaf_end = 0;
     return (PyObject *)it;
 }
 
@@ -3342,7 +4887,7 @@ static IntVectorNode *TransientIntVector_push_tail(TransientIntVector *self, int
         Py_INCREF(tail_node);
     } else {
         IntVectorNode *child = parent->data.children[subidx];
-        if (child != NULL && (parent->valid_mask & (1 << subidx))) {
+        if (child != NULL && (parent->valid_mask & (1u << subidx))) {
             node_to_insert = TransientIntVector_push_tail(self, level - BITS, child, tail_node);
         } else {
             node_to_insert = TransientIntVector_new_path(self, level - BITS, tail_node);
@@ -3353,11 +4898,10 @@ static IntVectorNode *TransientIntVector_push_tail(TransientIntVector *self, int
         }
     }
 
-    if (ret->valid_mask & (1 << subidx)) {
-        Py_XDECREF(ret->data.children[subidx]);
-    }
+    // ret owns a reference to the child it replaces (clones take one per child)
+    Py_XDECREF(ret->data.children[subidx]);
     ret->data.children[subidx] = node_to_insert;
-    ret->valid_mask |= (1 << subidx);
+    ret->valid_mask |= (1u << subidx);
     return ret;
 }
 
@@ -3385,10 +4929,11 @@ static int TransientIntVector_conj_mut_raw(TransientIntVector *self, int64_t lva
     // Tail is full, push into trie
     IntVectorNode *tail_node = IntVectorNode_create(self->id);
     if (!tail_node) return -1;
+    tail_node->is_leaf = 1;
 
     for (Py_ssize_t i = 0; i < self->tail_len && i < WIDTH; i++) {
         tail_node->data.values[i] = self->tail[i];
-        tail_node->valid_mask |= (1 << i);
+        tail_node->valid_mask |= (1u << i);
     }
 
     // Reset tail
@@ -3444,75 +4989,7 @@ static PyObject *TransientIntVector_conj_mut(TransientIntVector *self, PyObject
         return NULL;
     }
 
-    // Room in tail?
-    if (self->cnt - TransientIntVector_tail_off(self) < WIDTH) {
-        // Grow tail if needed
-        if (self->tail_len >= self->tail_cap) {
-            Py_ssize_t new_cap = self->tail_cap == 0 ? WIDTH : self->tail_cap * 2;
-            if (new_cap > WIDTH) new_cap = WIDTH;
-            int64_t *new_tail = (int64_t *)realloc(self->tail, new_cap * sizeof(int64_t));
-            if (!new_tail) {
-                PyErr_NoMemory();
-                return NULL;
-            }
-            self->tail = new_tail;
-            self->tail_cap = new_cap;
-        }
-        self->tail[self->tail_len++] = lval;
-        self->cnt++;
-        Py_INCREF(self);
-        return (PyObject *)self;
-    }
-
-    // Tail is full, push into trie
-    IntVectorNode *tail_node = IntVectorNode_create(self->id);
-    if (!tail_node) return NULL;
-
-    for (Py_ssize_t i = 0; i < self->tail_len && i < WIDTH; i++) {
-        tail_node->data.values[i] = self->tail[i];
-        tail_node->valid_mask |= (1 << i);
-    }
-
-    // Reset tail
-    self->tail[0] = lval;
-    self->tail_len = 1;
-
-    // Overflow root?
-    if (((size_t)self->cnt >> BITS) > (1ULL << self->shift)) {
-        IntVectorNode *new_root = IntVectorNode_create(self->id);
-        if (!new_root) {
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        new_root->data.children[0] = self->root;
-        Py_INCREF(self->root);
-        new_root->valid_mask = 1;
-
-        IntVectorNode *path = TransientIntVector_new_path(self, self->shift, tail_node);
-        if (!path) {
-            Py_DECREF(new_root);
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        new_root->data.children[1] = path;
-        new_root->valid_mask |= 2;
-
-        Py_DECREF(self->root);
-        self->root = new_root;
-        self->shift += BITS;
-    } else {
-        IntVectorNode *new_root = TransientIntVector_push_tail(self, self->shift, self->root, tail_node);
-        if (!new_root) {
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        Py_DECREF(self->root);
-        self->root = new_root;
-    }
-
-    Py_DECREF(tail_node);
-    self->cnt++;
-
+    if (TransientIntVector_conj_mut_raw(self, lval) < 0) return NULL;
     Py_INCREF(self);
     return (PyObject *)self;
 }
@@ -3682,11 +5159,438 @@ static PyObject *IntVector_reduce(IntVector *self, PyObject *Py_UNUSED(ignored))
     return result;
 }
 
+/* IntVector.__reduce_ex__(protocol) - from protocol 2 on, pickle the elements
+   as one block of little-endian words for _typed_vector. Under protocol 5 the
+   block is a PickleBuffer over the vector's own buffer, so it is neither
+   copied nor boxed and may travel out of band. */
+static PyObject *IntVector_reduce_ex(IntVector *self, PyObject *arg) {
+    long protocol = PyLong_AsLong(arg);
+    if (protocol == -1 && PyErr_Occurred()) return NULL;
+    if (protocol < 2 || Py_TYPE(self) != &IntVectorType) {
+        return IntVector_reduce(self, NULL);
+    }
+
+    PyObject *data;
+    if (PY_LITTLE_ENDIAN && protocol >= 5 && self->cnt > 0) {
+        Py_INCREF(self);
+        data = pickle_payload((PyObject *)self, protocol);
+    } else {
+        data = PyBytes_FromStringAndSize(NULL, self->cnt * (Py_ssize_t)sizeof(int64_t));
+        char *out = data ? PyBytes_AS_STRING(data) : NULL;
+        for (Py_ssize_t i = 0; out != NULL && i < self->cnt; i += WIDTH) {
+            Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+            le64_copy(out + i * sizeof(int64_t), (const char *)IntVector_array_for(self, i), n);
+        }
+        data = pickle_payload(data, protocol);
+    }
+    if (data == NULL) return NULL;
+
+    PyObject *fn = pds_module_function("_typed_vector");
+    if (fn == NULL) {
+        Py_DECREF(data);
+        return NULL;
+    }
+    return Py_BuildValue("(N(CN))", fn, 'q', data);
+}
+
+/* IntVector.reduce(f[, init]) - fold f over the elements a leaf at a time */
+static PyObject *IntVector_reduce_fn(IntVector *self, PyObject *args) {
+    PyObject *f;
+    PyObject *acc = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O:reduce", &f, &acc)) {
+        return NULL;
+    }
+    if (self->cnt == 0 && acc == NULL) {
+        return PyObject_CallNoArgs(f);
+    }
+    Py_XINCREF(acc);
+
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        int64_t *arr = IntVector_array_for(self, i);
+        if (!arr) goto error;
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+        for (Py_ssize_t j = 0; j < n; j++) {
+            PyObject *item = PyLong_FromLongLong(arr[j]);
+            if (!item) goto error;
+            int rc = reduce_step(f, &acc, item);
+            Py_DECREF(item);
+            if (rc < 0) goto error;
+        }
+    }
+    return acc;
+
+error:
+    Py_XDECREF(acc);
+    return NULL;
+}
+
+// --- IntVector numeric kernels ---
+// Leaf-at-a-time like the DoubleVector kernels. Results keep Python int
+// semantics: a running int64 total spills into a Python int on overflow.
+// Magnitudes below 2^57 (or 2^26 for dot products) let a whole leaf be
+// summed without per-element overflow checks.
+
+// *big += acc, then acc = 0
+static int IntVector_spill(PyObject **big, int64_t *acc) {
+    PyObject *part = PyLong_FromLongLong(*acc);
+    if (!part) return -1;
+    PyObject *total = *big ? PyNumber_Add(*big, part) : (Py_INCREF(part), part);
+    Py_DECREF(part);
+    if (!total) return -1;
+    Py_XSETREF(*big, total);
+    *acc = 0;
+    return 0;
+}
+
+static int IntVector_accumulate(PyObject **big, int64_t *acc, int64_t v) {
+    int64_t next;
+    if (i64_add_overflow(*acc, v, &next)) {
+        if (IntVector_spill(big, acc) < 0) return -1;
+        next = v;
+    }
+    *acc = next;
+    return 0;
+}
+
+static PyObject *IntVector_total(PyObject *big, int64_t acc) {
+    PyObject *part = PyLong_FromLongLong(acc);
+    if (!part || !big) return part;
+    PyObject *total = PyNumber_Add(big, part);
+    Py_DECREF(part);
+    return total;
+}
+
+static PyObject *IntVector_sum(IntVector *self, PyObject *Py_UNUSED(ignored)) {
+    int64_t acc = 0;
+    PyObject *big = NULL;
+
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        int64_t *arr = IntVector_array_for(self, i);
+        if (!arr) goto error;
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+
+        uint64_t bits = 0;
+        uint64_t s = 0;
+        for (Py_ssize_t j = 0; j < n; j++) {
+            bits |= (uint64_t)(arr[j] ^ (arr[j] >> 63));
+            s += (uint64_t)arr[j];
+        }
+        if ((bits >> 57) == 0) {
+            if (IntVector_accumulate(&big, &acc, (int64_t)s) < 0) goto error;
+        } else {
+            for (Py_ssize_t j = 0; j < n; j++) {
+                if (IntVector_accumulate(&big, &acc, arr[j]) < 0) goto error;
+            }
+        }
+    }
+    PyObject *result = IntVector_total(big, acc);
+    Py_XDECREF(big);
+    return result;
+
+error:
+    Py_XDECREF(big);
+    return NULL;
+}
+
+static PyObject *IntVector_mean(IntVector *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->cnt == 0) {
+        PyErr_SetString(PyExc_ValueError, "mean of an empty vector");
+        return NULL;
+    }
+    PyObject *sum = IntVector_sum(self, NULL);
+    if (!sum) return NULL;
+    PyObject *cnt = PyLong_FromSsize_t(self->cnt);
+    if (!cnt) {
+        Py_DECREF(sum);
+        return NULL;
+    }
+    PyObject *mean = PyNumber_TrueDivide(sum, cnt);
+    Py_DECREF(sum);
+    Py_DECREF(cnt);
+    return mean;
+}
+
+static PyObject *IntVector_extreme(IntVector *self, int want_max) {
+    if (self->cnt == 0) {
+        PyErr_SetString(PyExc_ValueError, want_max ? "max of an empty vector" : "min of an empty vector");
+        return NULL;
+    }
+    int64_t m = IntVector_nth_raw(self, 0);
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        int64_t *arr = IntVector_array_for(self, i);
+        if (!arr) return NULL;
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+        if (want_max) {
+            for (Py_ssize_t j = 0; j < n; j++) m = arr[j] > m ? arr[j] : m;
+        } else {
+            for (Py_ssize_t j = 0; j < n; j++) m = arr[j] < m ? arr[j] : m;
+        }
+    }
+    return PyLong_FromLongLong(m);
+}
+
+static PyObject *IntVector_min(IntVector *self, PyObject *Py_UNUSED(ignored)) {
+    return IntVector_extreme(self, 0);
+}
+
+static PyObject *IntVector_max(IntVector *self, PyObject *Py_UNUSED(ignored)) {
+    return IntVector_extreme(self, 1);
+}
+
+static PyObject *IntVector_dot(IntVector *self, PyObject *other) {
+    if (!PyObject_TypeCheck(other, &IntVectorType)) {
+        PyErr_SetString(PyExc_TypeError, "dot expects an IntVector");
+        return NULL;
+    }
+    IntVector *o = (IntVector *)other;
+    if (o->cnt != self->cnt) {
+        PyErr_SetString(PyExc_ValueError, "dot of vectors with different lengths");
+        return NULL;
+    }
+
+    int64_t acc = 0;
+    PyObject *big = NULL;
+    for (Py_ssize_t i = 0; i < self->cnt; i += WIDTH) {
+        int64_t *a = IntVector_array_for(self, i);
+        int64_t *b = IntVector_array_for(o, i);
+        if (!a || !b) goto error;
+        Py_ssize_t n = self->cnt - i < WIDTH ? self->cnt - i : WIDTH;
+
+        uint64_t bits = 0;
+        int64_t s = 0;
+        for (Py_ssize_t j = 0; j < n; j++) {
+            bits |= (uint64_t)(a[j] ^ (a[j] >> 63)) | (uint64_t)(b[j] ^ (b[j] >> 63));
+        }
+        if ((bits >> 26) == 0) {
+            for (Py_ssize_t j = 0; j < n; j++) s += a[j] * b[j];
+            if (IntVector_accumulate(&big, &acc, s) < 0) goto error;
+            continue;
+        }
+        for (Py_ssize_t j = 0; j < n; j++) {
+            int64_t p;
+            if (!i64_mul_overflow(a[j], b[j], &p)) {
+                if (IntVector_accumulate(&big, &acc, p) < 0) goto error;
+                continue;
+            }
+            // Product beyond int64: compute it as Python ints
+            PyObject *x = PyLong_FromLongLong(a[j]);
+            PyObject *y = x ? PyLong_FromLongLong(b[j]) : NULL;
+            PyObject *prod = y ? PyNumber_Multiply(x, y) : NULL;
+            Py_XDECREF(x);
+            Py_XDECREF(y);
+            if (!prod) goto error;
+            if (IntVector_spill(&big, &acc) < 0) {
+                Py_DECREF(prod);
+                goto error;
+            }
+            PyObject *total = PyNumber_Add(big, prod);
+            Py_DECREF(prod);
+            if (!total) goto error;
+            Py_SETREF(big, total);
+        }
+    }
+    PyObject *result = IntVector_total(big, acc);
+    Py_XDECREF(big);
+    return result;
+
+error:
+    Py_XDECREF(big);
+    return NULL;
+}
+
+// out[j] = in[j] op x; returns -1 with OverflowError set if a value leaves int64
+static int IntVector_apply_scalar(const int64_t *in, int64_t *out, Py_ssize_t n, int op, int64_t x) {
+    int overflow = 0;
+    switch (op) {
+        case '+': for (Py_ssize_t j = 0; j < n; j++) overflow |= i64_add_overflow(in[j], x, &out[j]); break;
+        case '-': for (Py_ssize_t j = 0; j < n; j++) overflow |= i64_sub_overflow(in[j], x, &out[j]); break;
+        default:  for (Py_ssize_t j = 0; j < n; j++) overflow |= i64_mul_overflow(in[j], x, &out[j]); break;
+    }
+    if (overflow) {
+        PyErr_SetString(PyExc_OverflowError, "result does not fit in an IntVector");
+        return -1;
+    }
+    return 0;
+}
+
+static IntVectorNode *IntVectorNode_map_scalar(IntVectorNode *node, int level, int op, int64_t x) {
+    IntVectorNode *ret = IntVectorNode_create(NULL);
+    if (!ret) return NULL;
+    ret->valid_mask = node->valid_mask;
+
+    if (level == 0) {
+        ret->is_leaf = 1;
+        if (IntVector_apply_scalar(IVN_VALUES(node), ret->data.values, WIDTH, op, x) < 0) {
+            Py_DECREF(ret);
+            return NULL;
+        }
+        return ret;
+    }
+    for (int i = 0; i < WIDTH; i++) {
+        if ((node->valid_mask & (1u << i)) && node->data.children[i] != NULL) {
+            ret->data.children[i] = IntVectorNode_map_scalar(node->data.children[i], level - BITS, op, x);
+            if (!ret->data.children[i]) {
+                Py_DECREF(ret);
+                return NULL;
+            }
+        }
+    }
+    return ret;
+}
+
+/* IntVector.map_scalar(op, x) - new vector of v op x, op one of + - * */
+static PyObject *IntVector_map_scalar(IntVector *self, PyObject *args) {
+    PyObject *op_obj;
+    long long x;
+
+    if (!PyArg_ParseTuple(args, "OL:map_scalar", &op_obj, &x)) {
+        return NULL;
+    }
+    int op = kernel_arith_op(op_obj);
+    if (op < 0) return NULL;
+    if (op == '/') {
+        PyErr_SetString(PyExc_ValueError, "IntVector.map_scalar does not support '/'");
+        return NULL;
+    }
+
+    IntVectorNode *root = IntVectorNode_map_scalar(self->root, self->shift, op, (int64_t)x);
+    if (!root) return NULL;
+
+    int64_t tail[WIDTH];
+    if (IntVector_apply_scalar(self->tail, tail, self->tail_len, op, (int64_t)x) < 0) {
+        Py_DECREF(root);
+        return NULL;
+    }
+    IntVector *result = IntVector_create(self->cnt, self->shift, root, tail, self->tail_len, NULL);
+    Py_DECREF(root);
+    return (PyObject *)result;
+}
+
+static void IntVector_compare_values(const int64_t *in, int64_t *out, Py_ssize_t n, int op, int64_t x) {
+    switch (op) {
+        case Py_LT: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] < x; break;
+        case Py_LE: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] <= x; break;
+        case Py_EQ: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] == x; break;
+        case Py_NE: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] != x; break;
+        case Py_GT: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] > x; break;
+        default:    for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] >= x; break;
+    }
+}
+
+static IntVectorNode *IntVectorNode_compare(IntVectorNode *node, int level, int op, int64_t x) {
+    IntVectorNode *ret = IntVectorNode_create(NULL);
+    if (!ret) return NULL;
+    ret->valid_mask = node->valid_mask;
+
+    if (level == 0) {
+        ret->is_leaf = 1;
+        IntVector_compare_values(IVN_VALUES(node), ret->data.values, WIDTH, op, x);
+        return ret;
+    }
+    for (int i = 0; i < WIDTH; i++) {
+        if ((node->valid_mask & (1u << i)) && node->data.children[i] != NULL) {
+            ret->data.children[i] = IntVectorNode_compare(node->data.children[i], level - BITS, op, x);
+            if (!ret->data.children[i]) {
+                Py_DECREF(ret);
+                return NULL;
+            }
+        }
+    }
+    return ret;
+}
+
+/* IntVector.compare(op, x) - IntVector mask with 1 where v op x holds */
+static PyObject *IntVector_compare(IntVector *self, PyObject *args) {
+    PyObject *op_obj;
+    long long x;
+
+    if (!PyArg_ParseTuple(args, "OL:compare", &op_obj, &x)) {
+        return NULL;
+    }
+    int op = kernel_cmp_op(op_obj);
+    if (op < 0) return NULL;
+
+    IntVectorNode *root = IntVectorNode_compare(self->root, self->shift, op, (int64_t)x);
+    if (!root) return NULL;
+
+    int64_t tail[WIDTH];
+    IntVector_compare_values(self->tail, tail, self->tail_len, op, (int64_t)x);
+    IntVector *result = IntVector_create(self->cnt, self->shift, root, tail, self->tail_len, NULL);
+    Py_DECREF(root);
+    return (PyObject *)result;
+}
+
+// DoubleVector.compare lives here because its masks are IntVectors
+static void DoubleVector_compare_values(const double *in, int64_t *out, Py_ssize_t n, int op, double x) {
+    switch (op) {
+        case Py_LT: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] < x; break;
+        case Py_LE: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] <= x; break;
+        case Py_EQ: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] == x; break;
+        case Py_NE: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] != x; break;
+        case Py_GT: for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] > x; break;
+        default:    for (Py_ssize_t j = 0; j < n; j++) out[j] = in[j] >= x; break;
+    }
+}
+
+// IntVector subtree of 0/1 flags shaped like the DoubleVector subtree at `level`
+static IntVectorNode *DoubleVectorNode_compare(DoubleVectorNode *node, int level, int op, double x) {
+    IntVectorNode *ret = IntVectorNode_create(NULL);
+    if (!ret) return NULL;
+    ret->valid_mask = node->valid_mask;
+
+    if (level == 0) {
+        ret->is_leaf = 1;
+        DoubleVector_compare_values(DVN_VALUES(node), ret->data.values, WIDTH, op, x);
+        return ret;
+    }
+    for (int i = 0; i < WIDTH; i++) {
+        if ((node->valid_mask & (1u << i)) && node->data.children[i] != NULL) {
+            ret->data.children[i] = DoubleVectorNode_compare(node->data.children[i], level - BITS, op, x);
+            if (!ret->data.children[i]) {
+                Py_DECREF(ret);
+                return NULL;
+            }
+        }
+    }
+    return ret;
+}
+
+/* DoubleVector.compare(op, x) - IntVector mask with 1 where v op x holds */
+static PyObject *DoubleVector_compare(DoubleVector *self, PyObject *args) {
+    PyObject *op_obj;
+    double x;
+
+    if (!PyArg_ParseTuple(args, "Od:compare", &op_obj, &x)) {
+        return NULL;
+    }
+    int op = kernel_cmp_op(op_obj);
+    if (op < 0) return NULL;
+
+    IntVectorNode *root = DoubleVectorNode_compare(self->root, self->shift, op, x);
+    if (!root) return NULL;
+
+    int64_t tail[WIDTH];
+    DoubleVector_compare_values(self->tail, tail, self->tail_len, op, x);
+    IntVector *result = IntVector_create(self->cnt, self->shift, root, tail, self->tail_len, NULL);
+    Py_DECREF(root);
+    return (PyObject *)result;
+}
+
 static PyMethodDef IntVector_methods[] = {
     {"nth", (PyCFunction)IntVector_nth, METH_VARARGS, "Get element at index"},
     {"conj", (PyCFunction)IntVector_conj, METH_O, "Add element to end"},
     {"transient", (PyCFunction)IntVector_transient, METH_NOARGS, "Return transient version for batch operations"},
+    {"reduce", (PyCFunction)IntVector_reduce_fn, METH_VARARGS, "Reduce with f(acc, x), walking leaf arrays directly"},
+    {"sum", (PyCFunction)IntVector_sum, METH_NOARGS, "Sum of the elements"},
+    {"mean", (PyCFunction)IntVector_mean, METH_NOARGS, "Arithmetic mean of the elements"},
+    {"min", (PyCFunction)IntVector_min, METH_NOARGS, "Smallest element"},
+    {"max", (PyCFunction)IntVector_max, METH_NOARGS, "Largest element"},
+    {"dot", (PyCFunction)IntVector_dot, METH_O, "Dot product with an IntVector of the same length"},
+    {"map_scalar", (PyCFunction)IntVector_map_scalar, METH_VARARGS, "New vector of v op x for op in '+', '-', '*'"},
+    {"compare", (PyCFunction)IntVector_compare, METH_VARARGS, "IntVector mask of v op x for op in '<', '<=', '==', '!=', '>', '>='"},
     {"__reduce__", (PyCFunction)IntVector_reduce, METH_NOARGS, "Pickle support"},
+    {"__reduce_ex__", (PyCFunction)IntVector_reduce_ex, METH_O, "Pickle support, as a typed buffer from protocol 2"},
     {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
      "Return a generic alias for type annotations"},
     {NULL}
@@ -3729,6 +5633,7 @@ static PyTypeObject IntVectorType = {
     .tp_as_sequence = &IntVector_as_sequence,
     .tp_as_mapping = &IntVector_as_mapping,
     .tp_hash = (hashfunc)IntVector_hash,
+    .tp_richcompare = (richcmpfunc)IntVector_richcompare,
     .tp_flags = Py_TPFLAGS_DEFAULT,
     .tp_iter = (getiterfunc)IntVector_iter,
     .tp_methods = IntVector_methods,
@@ -3744,6 +5649,7 @@ typedef struct TransientVector {
     VectorNode *root;
     PyObject *tail;  // list
     PyObject *id;
+    Py_ssize_t edits;  // bumped by every mutation, so update_mut can tell f left it alone
 } TransientVector;
 
 static void TransientVector_dealloc(TransientVector *self) {
@@ -3765,6 +5671,7 @@ static PyObject *Vector_transient(Vector *self, PyObject *Py_UNUSED(ignored)) {
 
     t->cnt = self->cnt;
     t->shift = self->shift;
+    t->edits = 0;
     t->root = VectorNode_clone(self->root, t->id);
     if (!t->root) {
         Py_DECREF(t);
@@ -3786,10 +5693,7 @@ static PyObject *Vector_transient(Vector *self, PyObject *Py_UNUSED(ignored)) {
 }
 
 static Py_ssize_t TransientVector_tail_off(TransientVector *self) {
-    if (self->cnt < WIDTH) {
-        return 0;
-    }
-    return ((self->cnt - 1) >> BITS) << BITS;
+    return self->cnt - PyList_GET_SIZE(self->tail);
 }
 
 static void TransientVector_ensure_editable(TransientVector *self) {
@@ -3798,64 +5702,14 @@ static void TransientVector_ensure_editable(TransientVector *self) {
     }
 }
 
-static VectorNode *TransientVector_new_path(TransientVector *self, int level, VectorNode *node) {
-    if (level == 0) {
-        Py_INCREF(node);
-        return node;
-    }
-    VectorNode *ret = VectorNode_create(self->id);
-    if (!ret) return NULL;
-
-    VectorNode *child = TransientVector_new_path(self, level - BITS, node);
-    if (!child) {
-        Py_DECREF(ret);
-        return NULL;
-    }
-    ret->array[0] = (PyObject *)child;
-    return ret;
-}
-
-static VectorNode *TransientVector_push_tail(TransientVector *self, int level, VectorNode *parent, VectorNode *tail_node) {
-    int subidx = ((self->cnt - 1) >> level) & MASK;
-    VectorNode *ret;
-
-    if (VectorNode_is_editable(parent, self->id)) {
-        ret = parent;
-        Py_INCREF(ret);
-    } else {
-        ret = VectorNode_clone(parent, self->id);
-        if (!ret) return NULL;
-    }
-
-    VectorNode *node_to_insert;
-    if (level == BITS) {
-        node_to_insert = tail_node;
-        Py_INCREF(tail_node);
-    } else {
-        PyObject *child = parent->array[subidx];
-        if (child != NULL) {
-            node_to_insert = TransientVector_push_tail(self, level - BITS, (VectorNode *)child, tail_node);
-        } else {
-            node_to_insert = TransientVector_new_path(self, level - BITS, tail_node);
-        }
-        if (!node_to_insert) {
-            Py_DECREF(ret);
-            return NULL;
-        }
-    }
-
-    Py_XDECREF(ret->array[subidx]);
-    ret->array[subidx] = (PyObject *)node_to_insert;
-    return ret;
-}
-
 static PyObject *TransientVector_conj_mut(TransientVector *self, PyObject *val) {
     TransientVector_ensure_editable(self);
     if (PyErr_Occurred()) return NULL;
+    self->edits++;
 
     // Room in tail?
-    Py_ssize_t tail_len = PyList_Size(self->tail);
-    if (self->cnt - TransientVector_tail_off(self) < WIDTH) {
+    Py_ssize_t tail_len = PyList_GET_SIZE(self->tail);
+    if (tail_len < WIDTH) {
         if (PyList_Append(self->tail, val) < 0) return NULL;
         self->cnt++;
         Py_INCREF(self);
@@ -3866,87 +5720,35 @@ static PyObject *TransientVector_conj_mut(TransientVector *self, PyObject *val)
     VectorNode *tail_node = VectorNode_create(self->id);
     if (!tail_node) return NULL;
 
-    for (Py_ssize_t i = 0; i < tail_len && i < WIDTH; i++) {
+    for (Py_ssize_t i = 0; i < WIDTH; i++) {
         tail_node->array[i] = PyList_GET_ITEM(self->tail, i);
         Py_INCREF(tail_node->array[i]);
     }
 
+    VectorNode *new_root = VectorTrie_push_leaf(self->root, self->shift, tail_node, self->id);
+    int new_shift = self->shift;
+    if (!new_root && !PyErr_Occurred()) {
+        // Overflow root
+        new_root = VectorTrie_grow(self->root, self->shift, self->cnt - WIDTH, tail_node, self->id);
+        new_shift += BITS;
+    }
+    Py_DECREF(tail_node);
+    if (!new_root) return NULL;
+    Py_SETREF(self->root, new_root);
+    self->shift = new_shift;
+
     // Reset tail
     Py_DECREF(self->tail);
     self->tail = PyList_New(1);
-    if (!self->tail) {
-        Py_DECREF(tail_node);
-        return NULL;
-    }
+    if (!self->tail) return NULL;
     Py_INCREF(val);
     PyList_SET_ITEM(self->tail, 0, val);
-
-    // Overflow root?
-    if (((size_t)self->cnt >> BITS) > (1ULL << self->shift)) {
-        VectorNode *new_root = VectorNode_create(self->id);
-        if (!new_root) {
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        new_root->array[0] = (PyObject *)self->root;
-        Py_INCREF(self->root);
-
-        VectorNode *path = TransientVector_new_path(self, self->shift, tail_node);
-        if (!path) {
-            Py_DECREF(new_root);
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        new_root->array[1] = (PyObject *)path;
-
-        Py_DECREF(self->root);
-        self->root = new_root;
-        self->shift += BITS;
-    } else {
-        VectorNode *new_root = TransientVector_push_tail(self, self->shift, self->root, tail_node);
-        if (!new_root) {
-            Py_DECREF(tail_node);
-            return NULL;
-        }
-        Py_DECREF(self->root);
-        self->root = new_root;
-    }
-
-    Py_DECREF(tail_node);
     self->cnt++;
 
     Py_INCREF(self);
     return (PyObject *)self;
 }
 
-static VectorNode *TransientVector_do_assoc(TransientVector *self, int level, VectorNode *node, Py_ssize_t i, PyObject *val) {
-    VectorNode *ret;
-
-    if (VectorNode_is_editable(node, self->id)) {
-        ret = node;
-        Py_INCREF(ret);
-    } else {
-        ret = VectorNode_clone(node, self->id);
-        if (!ret) return NULL;
-    }
-
-    if (level == 0) {
-        Py_XDECREF(ret->array[i & MASK]);
-        ret->array[i & MASK] = val;
-        Py_INCREF(val);
-    } else {
-        int subidx = (i >> level) & MASK;
-        VectorNode *child = TransientVector_do_assoc(self, level - BITS, (VectorNode *)node->array[subidx], i, val);
-        if (!child) {
-            Py_DECREF(ret);
-            return NULL;
-        }
-        Py_XDECREF(ret->array[subidx]);
-        ret->array[subidx] = (PyObject *)child;
-    }
-    return ret;
-}
-
 static PyObject *TransientVector_assoc_mut(TransientVector *self, PyObject *args) {
     Py_ssize_t i;
     PyObject *val;
@@ -3957,6 +5759,7 @@ static PyObject *TransientVector_assoc_mut(TransientVector *self, PyObject *args
 
     TransientVector_ensure_editable(self);
     if (PyErr_Occurred()) return NULL;
+    self->edits++;
 
     if (i < 0) {
         i = self->cnt + i;
@@ -3984,7 +5787,7 @@ static PyObject *TransientVector_assoc_mut(TransientVector *self, PyObject *args
     }
 
     // Update in trie
-    VectorNode *new_root = TransientVector_do_assoc(self, self->shift, self->root, i, val);
+    VectorNode *new_root = VectorTrie_assoc(self->root, self->shift, i, val, self->id);
     if (!new_root) return NULL;
 
     if (new_root != self->root) {
@@ -3998,49 +5801,72 @@ static PyObject *TransientVector_assoc_mut(TransientVector *self, PyObject *args
     return (PyObject *)self;
 }
 
-static VectorNode *TransientVector_pop_tail(TransientVector *self, int level, VectorNode *node) {
-    int subidx = ((self->cnt - 2) >> level) & MASK;
-    VectorNode *ret;
+// Element slot i of a transient's trie, claiming the nodes on the way down
+// for the transient. *ref is where the parent (or the transient) holds node.
+static PyObject **VectorTrie_edit_slot(VectorNode **ref, int level, Py_ssize_t i, PyObject *transient_id) {
+    VectorNode *node = VectorTrie_editable(*ref, transient_id);
+    if (!node) return NULL;
+    Py_SETREF(*ref, node);
 
-    if (VectorNode_is_editable(node, self->id)) {
-        ret = node;
-        Py_INCREF(ret);
-    } else {
-        ret = VectorNode_clone(node, self->id);
-        if (!ret) return NULL;
+    if (level == 0) {
+        return &node->array[i & MASK];
     }
+    int subidx = VectorNode_child_index(node, level, &i);
+    return VectorTrie_edit_slot((VectorNode **)&node->array[subidx], level - BITS, i, transient_id);
+}
 
-    if (level > BITS) {
-        VectorNode *new_child = TransientVector_pop_tail(self, level - BITS, (VectorNode *)node->array[subidx]);
-        if (new_child == NULL && !PyErr_Occurred()) {
-            // Child became empty
-            if (subidx == 0) {
-                Py_DECREF(ret);
-                return NULL;
-            }
-            Py_XDECREF(ret->array[subidx]);
-            ret->array[subidx] = NULL;
-        } else if (new_child == NULL) {
-            Py_DECREF(ret);
-            return NULL;
-        } else {
-            Py_XDECREF(ret->array[subidx]);
-            ret->array[subidx] = (PyObject *)new_child;
-        }
-        return ret;
-    } else if (subidx == 0) {
-        Py_DECREF(ret);
+/* TransientVector.update_mut(i, f) - replace element i with f(element),
+   finding its slot once */
+static PyObject *TransientVector_update_mut(TransientVector *self, PyObject *args) {
+    Py_ssize_t i;
+    PyObject *f;
+
+    if (!PyArg_ParseTuple(args, "nO:update_mut", &i, &f)) {
         return NULL;
-    } else {
-        Py_XDECREF(ret->array[subidx]);
-        ret->array[subidx] = NULL;
-        return ret;
     }
+
+    TransientVector_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (i < 0) {
+        i = self->cnt + i;
+    }
+    if (i < 0 || i >= self->cnt) {
+        PyErr_Format(PyExc_IndexError, "Index %zd out of range", i);
+        return NULL;
+    }
+
+    Py_ssize_t tail_off = TransientVector_tail_off(self);
+    PyObject **slot = i >= tail_off ? PySequence_Fast_ITEMS(self->tail) + (i - tail_off)
+                                    : VectorTrie_edit_slot(&self->root, self->shift, i, self->id);
+    if (!slot) return NULL;
+
+    PyObject *old = *slot;
+    Py_INCREF(old);
+    Py_ssize_t edits = self->edits;
+    PyObject *val = PyObject_CallOneArg(f, old);
+    Py_DECREF(old);
+    if (!val) return NULL;
+
+    // f may have edited the transient itself, moving the slot
+    if (self->edits != edits) {
+        PyObject *assoc_args = Py_BuildValue("(nN)", i, val);
+        if (!assoc_args) return NULL;
+        PyObject *result = TransientVector_assoc_mut(self, assoc_args);
+        Py_DECREF(assoc_args);
+        return result;
+    }
+    Py_SETREF(*slot, val);
+    self->edits++;
+
+    Py_INCREF(self);
+    return (PyObject *)self;
 }
 
 static PyObject *TransientVector_pop_mut(TransientVector *self, PyObject *Py_UNUSED(ignored)) {
     TransientVector_ensure_editable(self);
     if (PyErr_Occurred()) return NULL;
+    self->edits++;
 
     if (self->cnt == 0) {
         PyErr_SetString(PyExc_IndexError, "Can't pop from empty vector");
@@ -4067,63 +5893,41 @@ static PyObject *TransientVector_pop_mut(TransientVector *self, PyObject *Py_UNU
         return (PyObject *)self;
     }
 
-    // Tail has only one element, need to get new tail from trie
-
-    // Find the new tail in the trie
-    VectorNode *node = self->root;
-    for (int level = self->shift; level > 0; level -= BITS) {
-        node = (VectorNode *)node->array[((self->cnt - 2) >> level) & MASK];
-    }
-
-    // Create new tail from the leaf node
-    Py_DECREF(self->tail);
-    self->tail = PyList_New(WIDTH);
-    if (!self->tail) return NULL;
+    // Tail has only one element, the last leaf of the trie becomes the tail
+    Py_ssize_t leaf_start, leaf_len;
+    VectorNode *leaf = VectorTrie_leaf_for(self->root, self->shift, self->cnt - 2, &leaf_start, &leaf_len);
 
-    for (int i = 0; i < WIDTH; i++) {
-        PyObject *item = node->array[i];
-        if (item) {
-            Py_INCREF(item);
-            PyList_SET_ITEM(self->tail, i, item);
-        } else {
-            Py_INCREF(Py_None);
-            PyList_SET_ITEM(self->tail, i, Py_None);
-        }
+    PyObject *new_tail = PyList_New(leaf_len);
+    if (!new_tail) return NULL;
+    for (Py_ssize_t i = 0; i < leaf_len; i++) {
+        PyObject *item = leaf->array[i];
+        Py_INCREF(item);
+        PyList_SET_ITEM(new_tail, i, item);
     }
 
     // Remove the last leaf from trie
-    VectorNode *new_root = TransientVector_pop_tail(self, self->shift, self->root);
+    VectorNode *new_root = VectorTrie_pop_leaf(self->root, self->shift, leaf_len, self->id);
     int new_shift = self->shift;
 
-    if (new_root == NULL && !PyErr_Occurred()) {
+    if (new_root == NULL) {
+        if (PyErr_Occurred()) {
+            Py_DECREF(new_tail);
+            return NULL;
+        }
         new_root = VectorNode_create(self->id);
-        if (!new_root) return NULL;
-    } else if (new_root == NULL) {
-        return NULL;
-    }
-
-    // Check if we can reduce depth
-    if (self->shift > BITS && new_root->array[1] == NULL) {
-        VectorNode *nr = (VectorNode *)new_root->array[0];
-        Py_INCREF(nr);
-        Py_DECREF(new_root);
-        new_root = nr;
-        new_shift -= BITS;
+        if (!new_root) {
+            Py_DECREF(new_tail);
+            return NULL;
+        }
+        new_shift = BITS;
     }
+    VectorTrie_collapse(&new_root, &new_shift);
 
-    Py_DECREF(self->root);
-    self->root = new_root;
+    Py_SETREF(self->root, new_root);
+    Py_SETREF(self->tail, new_tail);
     self->shift = new_shift;
     self->cnt--;
 
-    // Trim tail to actual size
-    Py_ssize_t actual_tail_size = (self->cnt - 1) & MASK;
-    if (actual_tail_size < WIDTH - 1) {
-        if (PyList_SetSlice(self->tail, actual_tail_size + 1, WIDTH, NULL) < 0) {
-            return NULL;
-        }
-    }
-
     Py_INCREF(self);
     return (PyObject *)self;
 }
@@ -4131,6 +5935,7 @@ static PyObject *TransientVector_pop_mut(TransientVector *self, PyObject *Py_UNU
 static PyObject *TransientVector_persistent(TransientVector *self, PyObject *Py_UNUSED(ignored)) {
     TransientVector_ensure_editable(self);
     if (PyErr_Occurred()) return NULL;
+    self->edits++;
 
     Py_CLEAR(self->id);
 
@@ -4169,11 +5974,7 @@ static PyObject *TransientVector_sq_item(TransientVector *self, Py_ssize_t i) {
     }
 
     // In trie - navigate to the leaf node
-    VectorNode *node = self->root;
-    for (int level = self->shift; level > 0; level -= BITS) {
-        node = (VectorNode *)node->array[(i >> level) & MASK];
-    }
-    PyObject *result = node->array[i & MASK];
+    PyObject *result = VectorTrie_item(self->root, self->shift, i);
     Py_INCREF(result);
     return result;
 }
@@ -4195,6 +5996,7 @@ static PyObject *TransientVector_getitem(TransientVector *self, PyObject *key) {
 static int TransientVector_sq_ass_item(TransientVector *self, Py_ssize_t i, PyObject *val) {
     TransientVector_ensure_editable(self);
     if (PyErr_Occurred()) return -1;
+    self->edits++;
 
     if (i < 0) {
         i = self->cnt + i;
@@ -4218,7 +6020,7 @@ static int TransientVector_sq_ass_item(TransientVector *self, Py_ssize_t i, PyOb
         }
 
         // Update in trie
-        VectorNode *new_root = TransientVector_do_assoc(self, self->shift, self->root, i, val);
+        VectorNode *new_root = VectorTrie_assoc(self->root, self->shift, i, val, self->id);
         if (!new_root) return -1;
 
         if (new_root != self->root) {
@@ -4445,6 +6247,7 @@ static PyObject *TransientVector_sort(TransientVector *self, PyObject *args, PyO
 static PyMethodDef TransientVector_methods[] = {
     {"conj_mut", (PyCFunction)TransientVector_conj_mut, METH_O, "Mutably add element"},
     {"assoc_mut", (PyCFunction)TransientVector_assoc_mut, METH_VARARGS, "Mutably set element at index"},
+    {"update_mut", (PyCFunction)TransientVector_update_mut, METH_VARARGS, "Mutably replace element i with f(element)"},
     {"pop_mut", (PyCFunction)TransientVector_pop_mut, METH_NOARGS, "Mutably remove last element"},
     {"persistent", (PyCFunction)TransientVector_persistent, METH_NOARGS, "Return persistent vector"},
     {"append", (PyCFunction)TransientVector_append, METH_O, "Append element (alias for conj_mut)"},
@@ -4478,123 +6281,758 @@ static PyTypeObject TransientVectorType = {
     .tp_methods = TransientVector_methods,
 };
 
-// === Map Nodes ===
-
-// Forward declarations for iterator functions
-static PyObject *BitmapIndexedNode_iter_mode(BitmapIndexedNode *self, int mode);
-static PyObject *ArrayNode_iter_mode(ArrayNode *self, int mode);
-static PyObject *HashCollisionNode_iter_mode(HashCollisionNode *self, int mode);
+// === ChunkedSeq ===
+// A seq that hands out its elements a chunk at a time, like Clojure's
+// ChunkedCons. A chunk is one leaf (or the tail) of a Vector, read in place,
+// or a tuple taken from an iterator of chunks, so a lazy pipeline over a
+// vector allocates per chunk rather than per element. Every seq positioned
+// inside a chunk shares it, and a chunk creates its successor once: the
+// chunks of an iterator are read on demand and never twice.
 
-// BitmapIndexedNode
-typedef struct BitmapIndexedNode {
+typedef struct SeqChunk {
     PyObject_HEAD
-    unsigned int bitmap;
-    PyObject *array;  // list
-    PyObject *transient_id;
-} BitmapIndexedNode;
+    PyObject *owner;     // keeps items alive: a VectorNode, a vector tail or a chunk tuple
+    PyObject **items;
+    Py_ssize_t count;    // 0 marks the end of the seq
+    Vector *vec;         // chunks of a vector: the next one starts at vec_next
+    Py_ssize_t vec_next;
+    PyObject *source;    // iterator of chunks, for a pending chunk or its successor
+    PyObject *next;      // following chunk, Py_None at the end, NULL until asked for
+    int ready;           // 0 while still to be read from source (see PDS_CACHE_PUBLISH)
+    int reading;         // set while source runs, to catch a chunk needed to produce itself
+    int failed;          // source raised while producing this chunk; it is not retried
+} SeqChunk;
+
+typedef struct ChunkedSeq {
+    PyObject_HEAD
+    SeqChunk *chunk;
+    Py_ssize_t off;      // position inside the chunk
+    Py_hash_t hash;
+    int hash_computed;
+} ChunkedSeq;
 
-static PyTypeObject BitmapIndexedNodeType;
-static BitmapIndexedNode *EMPTY_BIN = NULL;
+static PyTypeObject SeqChunkType;
+static PyTypeObject ChunkedSeqIteratorType;
 
-static void BitmapIndexedNode_dealloc(BitmapIndexedNode *self) {
-    Py_XDECREF(self->array);
-    Py_XDECREF(self->transient_id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+static int SeqChunk_traverse(SeqChunk *self, visitproc visit, void *arg) {
+    Py_VISIT(self->owner);
+    Py_VISIT(self->vec);
+    Py_VISIT(self->source);
+    Py_VISIT(self->next);
+    return 0;
 }
 
-static BitmapIndexedNode *BitmapIndexedNode_create(unsigned int bitmap, PyObject *array, PyObject *transient_id) {
-    BitmapIndexedNode *node = PyObject_New(BitmapIndexedNode, &BitmapIndexedNodeType);
-    if (!node) return NULL;
-
-    node->bitmap = bitmap;
-    node->array = array ? array : PyList_New(0);
-    if (!node->array) {
-        Py_DECREF(node);
-        return NULL;
-    }
-    if (array) Py_INCREF(array);
-    node->transient_id = transient_id;
-    Py_XINCREF(transient_id);
-
-    return node;
+static int SeqChunk_clear(SeqChunk *self) {
+    self->items = NULL;
+    self->count = 0;
+    Py_CLEAR(self->owner);
+    Py_CLEAR(self->vec);
+    Py_CLEAR(self->source);
+    Py_CLEAR(self->next);
+    return 0;
 }
 
-static int BitmapIndexedNode_is_editable(BitmapIndexedNode *self, PyObject *transient_id) {
-    return transient_id != NULL && self->transient_id == transient_id;
-}
+static void SeqChunk_dealloc(SeqChunk *self) {
+    PyObject_GC_UnTrack(self);
+    // A pending source can hold a chunk that holds a pending source, and so
+    // on once per level of nested map/filter; the trashcan bounds the depth
+    Py_TRASHCAN_BEGIN(self, SeqChunk_dealloc)
+    PyObject *next = self->next;
+    Py_XDECREF(self->owner);
+    Py_XDECREF(self->vec);
+    Py_XDECREF(self->source);
+    Py_TYPE(self)->tp_free((PyObject *)self);
 
-static BitmapIndexedNode *BitmapIndexedNode_ensure_editable(BitmapIndexedNode *self, PyObject *transient_id) {
-    if (BitmapIndexedNode_is_editable(self, transient_id)) {
-        Py_INCREF(self);
-        return self;
+    // Unlink a realized chain one chunk at a time instead of recursing
+    while (next != NULL && Py_TYPE(next) == &SeqChunkType && Py_REFCNT(next) == 1) {
+        SeqChunk *c = (SeqChunk *)next;
+        next = c->next;
+        c->next = NULL;
+        Py_DECREF(c);
     }
-    PyObject *new_array = PyList_GetSlice(self->array, 0, PyList_Size(self->array));
-    if (!new_array) return NULL;
-    BitmapIndexedNode *result = BitmapIndexedNode_create(self->bitmap, new_array, transient_id);
-    Py_DECREF(new_array);
-    return result;
+    Py_XDECREF(next);
+    Py_TRASHCAN_END
 }
 
-// Forward declarations for node operations
-static PyObject *BitmapIndexedNode_assoc(BitmapIndexedNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val, PyObject *added_leaf, PyObject *transient_id);
-static PyObject *BitmapIndexedNode_find(BitmapIndexedNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *not_found);
-static PyObject *BitmapIndexedNode_dissoc(BitmapIndexedNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *removed_leaf, PyObject *transient_id);
-static PyObject *BitmapIndexedNode_iter_kv(BitmapIndexedNode *self);
-
-// ArrayNode
-typedef struct ArrayNode {
-    PyObject_HEAD
-    int count;
-    PyObject *array;  // list of WIDTH nodes
-    PyObject *transient_id;
-} ArrayNode;
-
-static PyTypeObject ArrayNodeType;
-
-static void ArrayNode_dealloc(ArrayNode *self) {
-    Py_XDECREF(self->array);
-    Py_XDECREF(self->transient_id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+static SeqChunk *SeqChunk_alloc(void) {
+    SeqChunk *c = PyObject_GC_New(SeqChunk, &SeqChunkType);
+    if (!c) return NULL;
+    c->owner = NULL;
+    c->items = NULL;
+    c->count = 0;
+    c->vec = NULL;
+    c->vec_next = 0;
+    c->source = NULL;
+    c->next = NULL;
+    c->ready = 1;
+    c->reading = 0;
+    c->failed = 0;
+    PyObject_GC_Track(c);
+    return c;
+}
+
+// Chunk of v from index start (< v->cnt) to the end of its leaf
+static SeqChunk *SeqChunk_from_vector(Vector *v, Py_ssize_t start) {
+    SeqChunk *c = SeqChunk_alloc();
+    if (!c) return NULL;
+    Py_ssize_t tail_off = Vector_tail_off(v);
+    if (start >= tail_off) {
+        c->owner = v->tail;
+        c->items = PySequence_Fast_ITEMS(v->tail) + (start - tail_off);
+        c->count = v->cnt - start;
+        c->vec_next = v->cnt;
+    } else {
+        Py_ssize_t leaf_start, len;
+        VectorNode *leaf = VectorTrie_leaf_for(v->root, v->shift, start, &leaf_start, &len);
+        c->owner = (PyObject *)leaf;
+        c->items = leaf->array + (start - leaf_start);
+        c->count = leaf_start + len - start;
+        c->vec_next = leaf_start + len;
+    }
+    Py_INCREF(c->owner);
+    c->vec = v;
+    Py_INCREF(v);
+    return c;
+}
+
+// Chunk still to be read from source, an iterator of chunks
+static SeqChunk *SeqChunk_pending(PyObject *source) {
+    SeqChunk *c = SeqChunk_alloc();
+    if (!c) return NULL;
+    c->source = source;
+    Py_INCREF(source);
+    c->ready = 0;
+    return c;
 }
 
-static ArrayNode *ArrayNode_create(int count, PyObject *array, PyObject *transient_id) {
-    ArrayNode *node = PyObject_New(ArrayNode, &ArrayNodeType);
-    if (!node) return NULL;
-
-    node->count = count;
-    if (array) {
-        node->array = array;
-        Py_INCREF(array);
-    } else {
-        node->array = PyList_New(WIDTH);
-        if (!node->array) {
-            Py_DECREF(node);
-            return NULL;
+// Read a pending chunk, skipping empty ones; at the source's end it stays empty
+static int SeqChunk_read(SeqChunk *c) {
+    if (c->ready) return 0;
+    if (c->reading) {
+        PyErr_SetString(PyExc_RuntimeError, "chunked seq needed its own next chunk to produce it");
+        return -1;
+    }
+    if (c->failed) {
+        // A generator that raised would just end, silently shortening the seq
+        PyErr_SetString(PyExc_RuntimeError, "chunked seq source failed earlier at this chunk");
+        return -1;
+    }
+    c->reading = 1;
+    int rc = 0;
+    for (;;) {
+        PyObject *chunk = PyIter_Next(c->source);
+        if (!chunk) {
+            if (PyErr_Occurred()) {
+                rc = -1;
+            } else {
+                Py_CLEAR(c->source);
+            }
+            break;
         }
-        for (int i = 0; i < WIDTH; i++) {
-            Py_INCREF(Py_None);
-            PyList_SET_ITEM(node->array, i, Py_None);
+        PyObject *items;
+#ifndef Py_GIL_DISABLED
+        if (PyList_CheckExact(chunk) && Py_REFCNT(chunk) == 1) {
+            items = chunk;  // nothing else can reach a fresh list, so keep it uncopied
+        } else
+#endif
+        {
+            items = PySequence_Tuple(chunk);
+            Py_DECREF(chunk);
+            if (!items) {
+                rc = -1;
+                break;
+            }
+        }
+        if (PySequence_Fast_GET_SIZE(items) > 0) {
+            c->owner = items;
+            c->items = PySequence_Fast_ITEMS(items);
+            c->count = PySequence_Fast_GET_SIZE(items);
+            break;
         }
+        Py_DECREF(items);
     }
-    node->transient_id = transient_id;
-    Py_XINCREF(transient_id);
+    c->reading = 0;
+    if (rc == 0) {
+        PDS_CACHE_PUBLISH(c->ready);
+    } else {
+        c->failed = 1;
+        Py_CLEAR(c->source);
+    }
+    return rc;
+}
+
+static int SeqChunk_realize(SeqChunk *c) {
+    if (PDS_CACHE_READY(c->ready)) return 0;
+    // A source pulling from another chunked seq (map over map over ...)
+    // comes back through here, once per level of nesting
+    if (Py_EnterRecursiveCall(" while realizing a chunked seq")) return -1;
+    int rc;
+#ifdef Py_GIL_DISABLED
+    Py_BEGIN_CRITICAL_SECTION(c);
+    rc = SeqChunk_read(c);
+    Py_END_CRITICAL_SECTION();
+#else
+    rc = SeqChunk_read(c);
+#endif
+    Py_LeaveRecursiveCall();
+    return rc;
+}
+
+// Chunk after a ready chunk c (borrowed; Py_None at the end), made on first
+// use. A successor read from an iterator stays pending until it is needed.
+static PyObject *SeqChunk_make_successor(SeqChunk *c) {
+    if (c->next) return c->next;
+    PyObject *next;
+    if (c->vec && c->vec_next < c->vec->cnt) {
+        next = (PyObject *)SeqChunk_from_vector(c->vec, c->vec_next);
+    } else if (c->source && c->count > 0) {
+        next = (PyObject *)SeqChunk_pending(c->source);
+        if (next) Py_CLEAR(c->source);
+    } else {
+        next = Py_None;
+        Py_INCREF(next);
+    }
+    c->next = next;
+    return next;
+}
 
-    return node;
+static PyObject *SeqChunk_successor(SeqChunk *c) {
+    PyObject *next;
+#ifdef Py_GIL_DISABLED
+    Py_BEGIN_CRITICAL_SECTION(c);
+    next = SeqChunk_make_successor(c);
+    Py_END_CRITICAL_SECTION();
+#else
+    next = SeqChunk_make_successor(c);
+#endif
+    return next;
 }
 
-static int ArrayNode_is_editable(ArrayNode *self, PyObject *transient_id) {
-    return transient_id != NULL && self->transient_id == transient_id;
+// Successor of c read and holding elements (borrowed), or Py_None at the end
+static PyObject *SeqChunk_next_ready(SeqChunk *c) {
+    PyObject *next = SeqChunk_successor(c);
+    if (!next || next == Py_None) return next;
+    if (SeqChunk_realize((SeqChunk *)next) < 0) return NULL;
+    return ((SeqChunk *)next)->count > 0 ? next : Py_None;
 }
 
-static ArrayNode *ArrayNode_ensure_editable(ArrayNode *self, PyObject *transient_id) {
+// Elements of a ready chunk from off on, as a tuple; whole tuple chunks are shared
+static PyObject *SeqChunk_tuple(SeqChunk *c, Py_ssize_t off) {
+    if (off == 0 && PyTuple_Check(c->owner) && PyTuple_GET_SIZE(c->owner) == c->count &&
+        PySequence_Fast_ITEMS(c->owner) == c->items) {
+        Py_INCREF(c->owner);
+        return c->owner;
+    }
+    PyObject *t = PyTuple_New(c->count - off);
+    if (!t) return NULL;
+    for (Py_ssize_t i = off; i < c->count; i++) {
+        Py_INCREF(c->items[i]);
+        PyTuple_SET_ITEM(t, i - off, c->items[i]);
+    }
+    return t;
+}
+
+static PyTypeObject SeqChunkType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.SeqChunk",
+    .tp_basicsize = sizeof(SeqChunk),
+    .tp_dealloc = (destructor)SeqChunk_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc)SeqChunk_traverse,
+    .tp_clear = (inquiry)SeqChunk_clear,
+};
+
+static void ChunkedSeq_dealloc(ChunkedSeq *self) {
+    Py_XDECREF(self->chunk);
+    pds_recycle(PDS_FL(chunked_seq), (PyObject *)self, &ChunkedSeqType);
+}
+
+// Seq at position off of chunk (a new reference to chunk is taken)
+static PyObject *ChunkedSeq_create(SeqChunk *chunk, Py_ssize_t off) {
+    ChunkedSeq *s = (ChunkedSeq *)pds_alloc(PDS_FL(chunked_seq), &ChunkedSeqType);
+    if (!s) return NULL;
+    s->chunk = chunk;
+    Py_INCREF(chunk);
+    s->off = off;
+    s->hash = 0;
+    s->hash_computed = 0;
+    return (PyObject *)s;
+}
+
+// Seq over v from index 0; Py_None for an empty vector, like Vector.to_seq
+static PyObject *ChunkedSeq_from_vector(Vector *v) {
+    if (v->cnt == 0) {
+        Py_RETURN_NONE;
+    }
+    SeqChunk *c = SeqChunk_from_vector(v, 0);
+    if (!c) return NULL;
+    PyObject *s = ChunkedSeq_create(c, 0);
+    Py_DECREF(c);
+    return s;
+}
+
+static PyObject *ChunkedSeq_get_first(ChunkedSeq *self, void *closure) {
+    if (SeqChunk_realize(self->chunk) < 0) return NULL;
+    PyObject *first = self->chunk->count > 0 ? self->chunk->items[self->off] : Py_None;
+    Py_INCREF(first);
+    return first;
+}
+
+static PyObject *ChunkedSeq_get_rest(ChunkedSeq *self, void *closure) {
+    SeqChunk *c = self->chunk;
+    if (SeqChunk_realize(c) < 0) return NULL;
+    if (c->count == 0) {
+        Py_RETURN_NONE;
+    }
+    if (self->off + 1 < c->count) {
+        return ChunkedSeq_create(c, self->off + 1);
+    }
+    PyObject *next = SeqChunk_next_ready(c);
+    if (!next) return NULL;
+    if (next == Py_None) {
+        Py_RETURN_NONE;
+    }
+    return ChunkedSeq_create((SeqChunk *)next, 0);
+}
+
+// True once the current chunk has been read from its source
+static PyObject *ChunkedSeq_get_realized(ChunkedSeq *self, void *closure) {
+    return PyBool_FromLong(PDS_CACHE_READY(self->chunk->ready));
+}
+
+static PyGetSetDef ChunkedSeq_getsetters[] = {
+    {"first", (getter)ChunkedSeq_get_first, NULL, "First element", NULL},
+    {"rest", (getter)ChunkedSeq_get_rest, NULL, "Seq of the remaining elements, or None", NULL},
+    {"realized", (getter)ChunkedSeq_get_realized, NULL, "Whether the current chunk has been read", NULL},
+    {NULL}
+};
+
+/* ChunkedSeq.chunk_first() - the elements left in the current chunk, as a tuple */
+static PyObject *ChunkedSeq_chunk_first(ChunkedSeq *self, PyObject *Py_UNUSED(ignored)) {
+    if (SeqChunk_realize(self->chunk) < 0) return NULL;
+    return SeqChunk_tuple(self->chunk, self->off);
+}
+
+/* ChunkedSeq.chunk_next() - seq from the start of the next chunk, or None */
+static PyObject *ChunkedSeq_chunk_next(ChunkedSeq *self, PyObject *Py_UNUSED(ignored)) {
+    if (SeqChunk_realize(self->chunk) < 0) return NULL;
+    if (self->chunk->count == 0) {
+        Py_RETURN_NONE;
+    }
+    PyObject *next = SeqChunk_next_ready(self->chunk);
+    if (!next) return NULL;
+    if (next == Py_None) {
+        Py_RETURN_NONE;
+    }
+    return ChunkedSeq_create((SeqChunk *)next, 0);
+}
+
+// Iterator over the elements of a chunked seq, or over its chunks as tuples
+typedef struct {
+    PyObject_HEAD
+    SeqChunk *chunk;  // NULL once exhausted
+    Py_ssize_t off;
+    int chunks;
+} ChunkedSeqIterator;
+
+static void ChunkedSeqIterator_dealloc(ChunkedSeqIterator *self) {
+    Py_XDECREF(self->chunk);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *ChunkedSeqIterator_next(ChunkedSeqIterator *self) {
+    while (self->chunk != NULL) {
+        SeqChunk *c = self->chunk;
+        if (SeqChunk_realize(c) < 0) return NULL;
+        if (self->off < c->count) {
+            if (self->chunks) {
+                PyObject *t = SeqChunk_tuple(c, self->off);
+                if (t) self->off = c->count;
+                return t;
+            }
+            PyObject *item = c->items[self->off++];
+            Py_INCREF(item);
+            return item;
+        }
+        PyObject *next = c->count > 0 ? SeqChunk_successor(c) : Py_None;
+        if (!next) return NULL;
+        if (next == Py_None) {
+            Py_CLEAR(self->chunk);
+        } else {
+            Py_INCREF(next);
+            Py_SETREF(self->chunk, (SeqChunk *)next);
+            self->off = 0;
+        }
+    }
+    return NULL;
+}
+
+static PyTypeObject ChunkedSeqIteratorType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.ChunkedSeqIterator",
+    .tp_basicsize = sizeof(ChunkedSeqIterator),
+    .tp_dealloc = (destructor)ChunkedSeqIterator_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)ChunkedSeqIterator_next,
+};
+
+// Iterator from position off of chunk (NULL for an exhausted one)
+static PyObject *ChunkedSeqIterator_create(SeqChunk *chunk, Py_ssize_t off, int chunks) {
+    ChunkedSeqIterator *it = PyObject_New(ChunkedSeqIterator, &ChunkedSeqIteratorType);
+    if (!it) return NULL;
+    it->chunk = chunk;
+    Py_XINCREF(chunk);
+    it->off = off;
+    it->chunks = chunks;
+    return (PyObject *)it;
+}
+
+static PyObject *ChunkedSeq_iter(ChunkedSeq *self) {
+    return ChunkedSeqIterator_create(self->chunk, self->off, 0);
+}
+
+/* ChunkedSeq.chunks() - iterator over the remaining chunks, as tuples */
+static PyObject *ChunkedSeq_chunks(ChunkedSeq *self, PyObject *Py_UNUSED(ignored)) {
+    return ChunkedSeqIterator_create(self->chunk, self->off, 1);
+}
+
+static int ChunkedSeq_bool(ChunkedSeq *self) {
+    if (SeqChunk_realize(self->chunk) < 0) return -1;
+    return self->chunk->count > 0;
+}
+
+static Py_ssize_t ChunkedSeq_length(ChunkedSeq *self) {
+    Py_ssize_t n = 0;
+    SeqChunk *c = self->chunk;
+    Py_ssize_t off = self->off;
+    for (;;) {
+        if (SeqChunk_realize(c) < 0) return -1;
+        if (c->count == 0) break;
+        n += c->count - off;
+        PyObject *next = SeqChunk_successor(c);
+        if (!next) return -1;
+        if (next == Py_None) break;
+        c = (SeqChunk *)next;
+        off = 0;
+    }
+    return n;
+}
+
+// Same formula as Cons_hash, so equal seqs hash alike
+static Py_hash_t ChunkedSeq_hash(ChunkedSeq *self) {
+    if (PDS_CACHE_READY(self->hash_computed)) {
+        return self->hash;
+    }
+    PyObject *it = ChunkedSeq_iter(self);
+    if (!it) return -1;
+    Py_hash_t h = 0;
+    PyObject *item;
+    while ((item = ChunkedSeqIterator_next((ChunkedSeqIterator *)it)) != NULL) {
+        Py_hash_t item_hash = PyObject_Hash(item);
+        Py_DECREF(item);
+        if (item_hash == -1) {
+            Py_DECREF(it);
+            return -1;
+        }
+        h = 31 * h + item_hash;
+    }
+    Py_DECREF(it);
+    if (PyErr_Occurred()) return -1;
+
+    self->hash = h;
+    PDS_CACHE_PUBLISH(self->hash_computed);
+    return h;
+}
+
+// Equal to another ChunkedSeq or a Cons list holding equal elements in order
+static PyObject *ChunkedSeq_richcompare(ChunkedSeq *self, PyObject *other, int op) {
+    if ((op != Py_EQ && op != Py_NE) ||
+        !(PyObject_TypeCheck(other, &ChunkedSeqType) || PyObject_TypeCheck(other, &ConsType))) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    if ((PyObject *)self == other) {
+        return PyBool_FromLong(op == Py_EQ);
+    }
+
+    PyObject *a = ChunkedSeq_iter(self);
+    PyObject *b = a ? PyObject_GetIter(other) : NULL;
+    int equal = b ? 1 : -1;
+    while (equal == 1) {
+        PyObject *x = PyIter_Next(a);
+        if (!x && PyErr_Occurred()) {
+            equal = -1;
+            break;
+        }
+        PyObject *y = PyIter_Next(b);
+        if (!x || !y) {
+            equal = PyErr_Occurred() ? -1 : x == y;
+            Py_XDECREF(x);
+            Py_XDECREF(y);
+            break;
+        }
+        equal = PyObject_RichCompareBool(x, y, Py_EQ);
+        Py_DECREF(x);
+        Py_DECREF(y);
+    }
+    Py_XDECREF(a);
+    Py_XDECREF(b);
+    if (equal < 0) return NULL;
+    return PyBool_FromLong(op == Py_EQ ? equal : !equal);
+}
+
+static PyObject *ChunkedSeq_repr(ChunkedSeq *self) {
+    PyObject *items = PySequence_List((PyObject *)self);
+    if (!items) return NULL;
+    PyObject *parts = PyList_New(PyList_GET_SIZE(items));
+    if (!parts) {
+        Py_DECREF(items);
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(items); i++) {
+        PyObject *repr = PyObject_Repr(PyList_GET_ITEM(items, i));
+        if (!repr) {
+            Py_DECREF(parts);
+            Py_DECREF(items);
+            return NULL;
+        }
+        PyList_SET_ITEM(parts, i, repr);
+    }
+    Py_DECREF(items);
+
+    PyObject *space = PyUnicode_FromString(" ");
+    PyObject *joined = space ? PyUnicode_Join(space, parts) : NULL;
+    Py_XDECREF(space);
+    Py_DECREF(parts);
+    if (!joined) return NULL;
+    PyObject *result = PyUnicode_FromFormat("(%U)", joined);
+    Py_DECREF(joined);
+    return result;
+}
+
+static PyObject *ChunkedSeq_reduce(ChunkedSeq *self, PyObject *Py_UNUSED(ignored)) {
+    // Rebuilt as one chunk holding the remaining elements
+    PyObject *items = PySequence_Tuple((PyObject *)self);
+    if (!items) return NULL;
+    PyObject *fn = pds_module_function("chunked_seq");
+    PyObject *result = fn ? Py_BuildValue("(O((O)))", fn, items) : NULL;
+    Py_XDECREF(fn);
+    Py_DECREF(items);
+    return result;
+}
+
+static PyMethodDef ChunkedSeq_methods[] = {
+    {"chunk_first", (PyCFunction)ChunkedSeq_chunk_first, METH_NOARGS, "Elements left in the current chunk, as a tuple"},
+    {"chunk_next", (PyCFunction)ChunkedSeq_chunk_next, METH_NOARGS, "Seq from the start of the next chunk, or None"},
+    {"chunks", (PyCFunction)ChunkedSeq_chunks, METH_NOARGS, "Iterate over the remaining chunks as tuples"},
+    {"__reduce__", (PyCFunction)ChunkedSeq_reduce, METH_NOARGS, "Pickle support"},
+    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
+     "Return a generic alias for type annotations (e.g., ChunkedSeq[int])"},
+    {NULL}
+};
+
+static PySequenceMethods ChunkedSeq_as_sequence = {
+    .sq_length = (lenfunc)ChunkedSeq_length,
+};
+
+static PyNumberMethods ChunkedSeq_as_number = {
+    .nb_bool = (inquiry)ChunkedSeq_bool,
+};
+
+static PyTypeObject ChunkedSeqType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.ChunkedSeq",
+    .tp_doc = "Immutable seq realized a chunk at a time (a vector leaf or a tuple of up to 32 elements)",
+    .tp_basicsize = sizeof(ChunkedSeq),
+    .tp_dealloc = (destructor)ChunkedSeq_dealloc,
+    .tp_repr = (reprfunc)ChunkedSeq_repr,
+    .tp_as_number = &ChunkedSeq_as_number,
+    .tp_as_sequence = &ChunkedSeq_as_sequence,
+    .tp_hash = (hashfunc)ChunkedSeq_hash,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_richcompare = (richcmpfunc)ChunkedSeq_richcompare,
+    .tp_iter = (getiterfunc)ChunkedSeq_iter,
+    .tp_methods = ChunkedSeq_methods,
+    .tp_getset = ChunkedSeq_getsetters,
+};
+
+/* chunked_seq(chunks) - lazy ChunkedSeq over an iterable of chunks
+   (sequences, empty ones skipped), each read when it is first needed */
+static PyObject *pds_chunked_seq(PyObject *self, PyObject *chunks) {
+    PyObject *source = PyObject_GetIter(chunks);
+    if (!source) return NULL;
+    SeqChunk *c = SeqChunk_pending(source);
+    Py_DECREF(source);
+    if (!c) return NULL;
+    PyObject *s = ChunkedSeq_create(c, 0);
+    Py_DECREF(c);
+    return s;
+}
+
+/* chunks(coll) - iterator over the chunks of a Vector (its leaves) or a
+   ChunkedSeq, as tuples */
+static PyObject *pds_chunks(PyObject *self, PyObject *coll) {
+    if (PyObject_TypeCheck(coll, &ChunkedSeqType)) {
+        return ChunkedSeq_chunks((ChunkedSeq *)coll, NULL);
+    }
+    if (PyObject_TypeCheck(coll, &VectorType)) {
+        Vector *v = (Vector *)coll;
+        SeqChunk *c = v->cnt > 0 ? SeqChunk_from_vector(v, 0) : NULL;
+        if (!c && v->cnt > 0) return NULL;
+        PyObject *it = ChunkedSeqIterator_create(c, 0, 1);
+        Py_XDECREF(c);
+        return it;
+    }
+    PyErr_Format(PyExc_TypeError, "chunks expects a Vector or ChunkedSeq, not %.200s", Py_TYPE(coll)->tp_name);
+    return NULL;
+}
+
+// === Map Nodes ===
+//
+// Node slots are stored inline in the node object rather than in a separate
+// list, so a node is a single allocation. BitmapIndexedNode and
+// HashCollisionNode are variable-size ([k1, v1, k2, v2, ...], ob_size = slot
+// count); a NULL key in a BitmapIndexedNode marks the value slot as a child
+// node. ArrayNode has WIDTH fixed child slots, NULL meaning empty.
+
+// Forward declarations for iterator functions
+static PyObject *BitmapIndexedNode_iter_mode(BitmapIndexedNode *self, int mode);
+static PyObject *ArrayNode_iter_mode(ArrayNode *self, int mode);
+static PyObject *HashCollisionNode_iter_mode(HashCollisionNode *self, int mode);
+
+// BitmapIndexedNode
+typedef struct BitmapIndexedNode {
+    PyObject_VAR_HEAD
+    unsigned int bitmap;
+    PyObject *transient_id;
+    Py_hash_t hash;  // cached subtree hash (see MapNode_hash)
+    int hash_computed;
+    Py_ssize_t size;  // cached entry count below this node, 0 = unknown (see MapNode_count)
+    PyObject *array[1];  // inline [k1, v1, ...], Py_SIZE(node) slots, then one key hash per pair
+} BitmapIndexedNode;
+
+// Hash of the key in pair idx, stored after the slots in the same allocation
+// so splits, promotions and comparisons never call __hash__ again. Pairs that
+// hold a child node have no key and their hash is unused.
+#define BIN_HASHES(node) ((Py_hash_t *)((node)->array + Py_SIZE(node)))
+
+static PyTypeObject BitmapIndexedNodeType;
+static BitmapIndexedNode *EMPTY_BIN = NULL;
+
+// Freelist for nodes of `pairs` pairs, if that size is recycled
+static inline PdsFreeList *BitmapIndexedNode_freelist(Py_ssize_t pairs) {
+    return pairs > 0 && pairs <= PDS_BIN_FREELIST_PAIRS ? PDS_FL_AT(bin, pairs) : NULL;
+}
+
+static void BitmapIndexedNode_dealloc(BitmapIndexedNode *self) {
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        Py_XDECREF(self->array[i]);
+    }
+    Py_XDECREF(self->transient_id);
+    pds_recycle(BitmapIndexedNode_freelist(Py_SIZE(self) / 2), (PyObject *)self, &BitmapIndexedNodeType);
+}
+
+// Allocate a node with `size` empty slots; the caller fills them with new references
+static BitmapIndexedNode *BitmapIndexedNode_create(unsigned int bitmap, Py_ssize_t size, PyObject *transient_id) {
+    Py_ssize_t pairs = size / 2;
+    Py_ssize_t hash_slots = (pairs * (Py_ssize_t)sizeof(Py_hash_t) + (Py_ssize_t)sizeof(PyObject *) - 1) / (Py_ssize_t)sizeof(PyObject *);
+    BitmapIndexedNode *node = (BitmapIndexedNode *)pds_alloc_var(BitmapIndexedNode_freelist(pairs), &BitmapIndexedNodeType, size + hash_slots);
+    if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_BITMAP_INDEXED);
+    Py_SET_SIZE(node, size);  // the hash area is not counted as slots
+
+    node->bitmap = bitmap;
+    node->hash = 0;
+    node->hash_computed = 0;
+    node->size = 0;
+    memset(node->array, 0, size * sizeof(PyObject *));
+    memset(BIN_HASHES(node), 0, pairs * sizeof(Py_hash_t));
+    node->transient_id = transient_id;
+    Py_XINCREF(transient_id);
+
+    return node;
+}
+
+static int BitmapIndexedNode_is_editable(BitmapIndexedNode *self, PyObject *transient_id) {
+    return transient_id != NULL && self->transient_id == transient_id;
+}
+
+static BitmapIndexedNode *BitmapIndexedNode_ensure_editable(BitmapIndexedNode *self, PyObject *transient_id) {
+    if (BitmapIndexedNode_is_editable(self, transient_id)) {
+        Py_INCREF(self);
+        return self;
+    }
+    Py_ssize_t size = Py_SIZE(self);
+    BitmapIndexedNode *result = BitmapIndexedNode_create(self->bitmap, size, transient_id);
+    if (!result) return NULL;
+    PDS_STAT_COPY(PDS_NODE_BITMAP_INDEXED);
+    for (Py_ssize_t i = 0; i < size; i++) {
+        result->array[i] = self->array[i];
+        Py_XINCREF(result->array[i]);
+    }
+    memcpy(BIN_HASHES(result), BIN_HASHES(self), (size / 2) * sizeof(Py_hash_t));
+    return result;
+}
+
+// Forward declarations for node operations
+static PyObject *BitmapIndexedNode_assoc(BitmapIndexedNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val, PyObject *added_leaf, PyObject *transient_id);
+static PyObject *BitmapIndexedNode_find(BitmapIndexedNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *not_found);
+static PyObject *BitmapIndexedNode_dissoc(BitmapIndexedNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *removed_leaf, PyObject *transient_id);
+static PyObject *BitmapIndexedNode_iter_kv(BitmapIndexedNode *self);
+
+// ArrayNode
+typedef struct ArrayNode {
+    PyObject_HEAD
+    int count;
+    PyObject *transient_id;
+    Py_hash_t hash;  // cached subtree hash (see MapNode_hash)
+    int hash_computed;
+    Py_ssize_t size;  // cached entry count below this node, 0 = unknown (see MapNode_count)
+    PyObject *array[WIDTH];  // child nodes, NULL = empty slot
+} ArrayNode;
+
+static PyTypeObject ArrayNodeType;
+
+static void ArrayNode_dealloc(ArrayNode *self) {
+    for (int i = 0; i < WIDTH; i++) {
+        Py_XDECREF(self->array[i]);
+    }
+    Py_XDECREF(self->transient_id);
+    pds_recycle(PDS_FL(array_node), (PyObject *)self, &ArrayNodeType);
+}
+
+static ArrayNode *ArrayNode_create(int count, PyObject *transient_id) {
+    ArrayNode *node = (ArrayNode *)pds_alloc(PDS_FL(array_node), &ArrayNodeType);
+    if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_ARRAY);
+
+    node->count = count;
+    node->hash = 0;
+    node->hash_computed = 0;
+    node->size = 0;
+    memset(node->array, 0, sizeof(node->array));
+    node->transient_id = transient_id;
+    Py_XINCREF(transient_id);
+
+    return node;
+}
+
+static int ArrayNode_is_editable(ArrayNode *self, PyObject *transient_id) {
+    return transient_id != NULL && self->transient_id == transient_id;
+}
+
+static ArrayNode *ArrayNode_ensure_editable(ArrayNode *self, PyObject *transient_id) {
     if (ArrayNode_is_editable(self, transient_id)) {
         Py_INCREF(self);
         return self;
     }
-    PyObject *new_array = PyList_GetSlice(self->array, 0, WIDTH);
-    if (!new_array) return NULL;
-    ArrayNode *result = ArrayNode_create(self->count, new_array, transient_id);
-    Py_DECREF(new_array);
+    ArrayNode *result = ArrayNode_create(self->count, transient_id);
+    if (!result) return NULL;
+    PDS_STAT_COPY(PDS_NODE_ARRAY);
+    for (int i = 0; i < WIDTH; i++) {
+        result->array[i] = self->array[i];
+        Py_XINCREF(result->array[i]);
+    }
     return result;
 }
 
@@ -4605,33 +7043,36 @@ static PyObject *ArrayNode_iter_kv(ArrayNode *self);
 
 // HashCollisionNode
 typedef struct HashCollisionNode {
-    PyObject_HEAD
-    Py_hash_t hash;
+    PyObject_VAR_HEAD
+    Py_hash_t hash;  // shared by every key in the node
     int count;
-    PyObject *array;  // list [k1, v1, k2, v2, ...]
     PyObject *transient_id;
+    Py_hash_t subtree_hash;  // cached (see MapNode_hash)
+    int hash_computed;
+    PyObject *array[1];  // inline [k1, v1, k2, v2, ...], 2 * count slots
 } HashCollisionNode;
 
 static PyTypeObject HashCollisionNodeType;
 
 static void HashCollisionNode_dealloc(HashCollisionNode *self) {
-    Py_XDECREF(self->array);
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        Py_XDECREF(self->array[i]);
+    }
     Py_XDECREF(self->transient_id);
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-static HashCollisionNode *HashCollisionNode_create(Py_hash_t hash_val, int count, PyObject *array, PyObject *transient_id) {
-    HashCollisionNode *node = PyObject_New(HashCollisionNode, &HashCollisionNodeType);
+// Allocate a node with room for `count` pairs; the caller fills the slots with new references
+static HashCollisionNode *HashCollisionNode_create(Py_hash_t hash_val, int count, PyObject *transient_id) {
+    HashCollisionNode *node = PyObject_NewVar(HashCollisionNode, &HashCollisionNodeType, 2 * count);
     if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_HASH_COLLISION);
 
     node->hash = hash_val;
     node->count = count;
-    node->array = array ? array : PyList_New(0);
-    if (!node->array) {
-        Py_DECREF(node);
-        return NULL;
-    }
-    if (array) Py_INCREF(array);
+    node->subtree_hash = 0;
+    node->hash_computed = 0;
+    memset(node->array, 0, 2 * count * sizeof(PyObject *));
     node->transient_id = transient_id;
     Py_XINCREF(transient_id);
 
@@ -4647,16 +7088,19 @@ static HashCollisionNode *HashCollisionNode_ensure_editable(HashCollisionNode *s
         Py_INCREF(self);
         return self;
     }
-    PyObject *new_array = PyList_GetSlice(self->array, 0, PyList_Size(self->array));
-    if (!new_array) return NULL;
-    HashCollisionNode *result = HashCollisionNode_create(self->hash, self->count, new_array, transient_id);
-    Py_DECREF(new_array);
+    HashCollisionNode *result = HashCollisionNode_create(self->hash, self->count, transient_id);
+    if (!result) return NULL;
+    PDS_STAT_COPY(PDS_NODE_HASH_COLLISION);
+    for (int i = 0; i < 2 * self->count; i++) {
+        result->array[i] = self->array[i];
+        Py_INCREF(result->array[i]);
+    }
     return result;
 }
 
 static int HashCollisionNode_find_index(HashCollisionNode *self, PyObject *key) {
     for (int i = 0; i < 2 * self->count; i += 2) {
-        PyObject *k = PyList_GET_ITEM(self->array, i);
+        PyObject *k = self->array[i];
         int eq = PyObject_RichCompareBool(k, key, Py_EQ);
         if (eq < 0) return -2;  // Error
         if (eq) return i;
@@ -4673,7 +7117,8 @@ static PyObject *HashCollisionNode_iter_kv(HashCollisionNode *self);
 static PyTypeObject BitmapIndexedNodeType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name = "spork.runtime.pds.BitmapIndexedNode",
-    .tp_basicsize = sizeof(BitmapIndexedNode),
+    .tp_basicsize = offsetof(BitmapIndexedNode, array),
+    .tp_itemsize = sizeof(PyObject *),
     .tp_dealloc = (destructor)BitmapIndexedNode_dealloc,
     .tp_flags = Py_TPFLAGS_DEFAULT,
 };
@@ -4689,25 +7134,22 @@ static PyTypeObject ArrayNodeType = {
 static PyTypeObject HashCollisionNodeType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name = "spork.runtime.pds.HashCollisionNode",
-    .tp_basicsize = sizeof(HashCollisionNode),
+    .tp_basicsize = offsetof(HashCollisionNode, array),
+    .tp_itemsize = sizeof(PyObject *),
     .tp_dealloc = (destructor)HashCollisionNode_dealloc,
     .tp_flags = Py_TPFLAGS_DEFAULT,
 };
 
 // Helper to create a node for two key-value pairs
-static PyObject *create_node(int shift, PyObject *key1, PyObject *val1, Py_hash_t hash2, PyObject *key2, PyObject *val2, PyObject *transient_id) {
-    Py_hash_t hash1 = PyObject_Hash(key1);
-    if (hash1 == -1 && PyErr_Occurred()) return NULL;
-
+static PyObject *create_node(int shift, Py_hash_t hash1, PyObject *key1, PyObject *val1, Py_hash_t hash2, PyObject *key2, PyObject *val2, PyObject *transient_id) {
     if (hash1 == hash2) {
-        PyObject *arr = PyList_New(4);
-        if (!arr) return NULL;
-        Py_INCREF(key1); PyList_SET_ITEM(arr, 0, key1);
-        Py_INCREF(val1); PyList_SET_ITEM(arr, 1, val1);
-        Py_INCREF(key2); PyList_SET_ITEM(arr, 2, key2);
-        Py_INCREF(val2); PyList_SET_ITEM(arr, 3, val2);
-        HashCollisionNode *node = HashCollisionNode_create(hash1, 2, arr, transient_id);
-        Py_DECREF(arr);
+        HashCollisionNode *node = HashCollisionNode_create(hash1, 2, transient_id);
+        if (!node) return NULL;
+        PDS_STAT_ADD(collisions, 1);
+        Py_INCREF(key1); node->array[0] = key1;
+        Py_INCREF(val1); node->array[1] = val1;
+        Py_INCREF(key2); node->array[2] = key2;
+        Py_INCREF(val2); node->array[3] = val2;
         return (PyObject *)node;
     }
 
@@ -4734,17 +7176,38 @@ static PyObject *create_node(int shift, PyObject *key1, PyObject *val1, Py_hash_
     return n2;
 }
 
-// BitmapIndexedNode implementation
-static PyObject *BitmapIndexedNode_assoc(BitmapIndexedNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val, PyObject *added_leaf, PyObject *transient_id) {
+// Copy of `self` with the pair at slot 2*idx removed and the bitmap bit cleared
+static PyObject *BitmapIndexedNode_without(BitmapIndexedNode *self, unsigned int bit, int idx, PyObject *transient_id) {
+    Py_ssize_t arr_len = Py_SIZE(self);
+    BitmapIndexedNode *node = BitmapIndexedNode_create(self->bitmap ^ bit, arr_len - 2, transient_id);
+    if (!node) return NULL;
+
+    for (Py_ssize_t i = 0; i < 2 * idx; i++) {
+        node->array[i] = self->array[i];
+        Py_XINCREF(node->array[i]);
+    }
+    for (Py_ssize_t i = 2 * idx + 2; i < arr_len; i++) {
+        node->array[i - 2] = self->array[i];
+        Py_XINCREF(node->array[i - 2]);
+    }
+    Py_hash_t *hashes = BIN_HASHES(node);
+    Py_hash_t *old_hashes = BIN_HASHES(self);
+    memcpy(hashes, old_hashes, idx * sizeof(Py_hash_t));
+    memcpy(hashes + idx, old_hashes + idx + 1, (arr_len / 2 - idx - 1) * sizeof(Py_hash_t));
+    return (PyObject *)node;
+}
+
+// BitmapIndexedNode implementation
+static PyObject *BitmapIndexedNode_assoc(BitmapIndexedNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val, PyObject *added_leaf, PyObject *transient_id) {
     unsigned int bit = bitpos(hash_val, shift);
     int idx = bitmap_index(self->bitmap, bit);
 
     if (self->bitmap & bit) {
         // Slot exists
-        PyObject *key_or_null = PyList_GET_ITEM(self->array, 2 * idx);
-        PyObject *val_or_node = PyList_GET_ITEM(self->array, 2 * idx + 1);
+        PyObject *key_or_null = self->array[2 * idx];
+        PyObject *val_or_node = self->array[2 * idx + 1];
 
-        if (key_or_null == Py_None) {
+        if (key_or_null == NULL) {
             // Child node
             PyObject *n;
             if (PyObject_TypeCheck(val_or_node, &BitmapIndexedNodeType)) {
@@ -4767,12 +7230,16 @@ static PyObject *BitmapIndexedNode_assoc(BitmapIndexedNode *self, int shift, Py_
                 Py_DECREF(n);
                 return NULL;
             }
-            PyList_SET_ITEM(node->array, 2 * idx + 1, n);
+            Py_SETREF(node->array[2 * idx + 1], n);
             return (PyObject *)node;
         }
 
-        int eq = PyObject_RichCompareBool(key, key_or_null, Py_EQ);
-        if (eq < 0) return NULL;
+        Py_hash_t old_hash = BIN_HASHES(self)[idx];
+        int eq = 0;
+        if (old_hash == hash_val) {
+            eq = PyObject_RichCompareBool(key, key_or_null, Py_EQ);
+            if (eq < 0) return NULL;
+        }
 
         if (eq) {
             // Same key - update value
@@ -4783,15 +7250,14 @@ static PyObject *BitmapIndexedNode_assoc(BitmapIndexedNode *self, int shift, Py_
             BitmapIndexedNode *node = BitmapIndexedNode_ensure_editable(self, transient_id);
             if (!node) return NULL;
             Py_INCREF(val);
-            Py_DECREF(PyList_GET_ITEM(node->array, 2 * idx + 1));
-            PyList_SET_ITEM(node->array, 2 * idx + 1, val);
+            Py_SETREF(node->array[2 * idx + 1], val);
             return (PyObject *)node;
         }
 
         // Hash collision at this level - need to go deeper
         if (PyList_Append(added_leaf, Py_True) < 0) return NULL;
 
-        PyObject *new_node = create_node(shift + BITS, key_or_null, val_or_node, hash_val, key, val, transient_id);
+        PyObject *new_node = create_node(shift + BITS, old_hash, key_or_null, val_or_node, hash_val, key, val, transient_id);
         if (!new_node) return NULL;
 
         BitmapIndexedNode *node = BitmapIndexedNode_ensure_editable(self, transient_id);
@@ -4799,91 +7265,79 @@ static PyObject *BitmapIndexedNode_assoc(BitmapIndexedNode *self, int shift, Py_
             Py_DECREF(new_node);
             return NULL;
         }
-        Py_INCREF(Py_None);
-        Py_DECREF(PyList_GET_ITEM(node->array, 2 * idx));
-        PyList_SET_ITEM(node->array, 2 * idx, Py_None);
-        Py_DECREF(PyList_GET_ITEM(node->array, 2 * idx + 1));
-        PyList_SET_ITEM(node->array, 2 * idx + 1, new_node);
+        Py_CLEAR(node->array[2 * idx]);
+        Py_SETREF(node->array[2 * idx + 1], new_node);
         return (PyObject *)node;
     } else {
         // New slot
         int n = ctpop(self->bitmap);
         if (n >= WIDTH / 2) {
             // Upgrade to ArrayNode
-            PyObject *nodes = PyList_New(WIDTH);
-            if (!nodes) return NULL;
-            for (int i = 0; i < WIDTH; i++) {
-                Py_INCREF(Py_None);
-                PyList_SET_ITEM(nodes, i, Py_None);
-            }
+            ArrayNode *result = ArrayNode_create(n + 1, transient_id);
+            if (!result) return NULL;
 
             int jdx = mask_hash(hash_val, shift);
             PyObject *new_bin = BitmapIndexedNode_assoc(EMPTY_BIN, shift + BITS, hash_val, key, val, added_leaf, transient_id);
             if (!new_bin) {
-                Py_DECREF(nodes);
+                Py_DECREF(result);
                 return NULL;
             }
-            Py_DECREF(PyList_GET_ITEM(nodes, jdx));
-            PyList_SET_ITEM(nodes, jdx, new_bin);
+            result->array[jdx] = new_bin;
 
             int j = 0;
             for (int i = 0; i < WIDTH; i++) {
                 if ((self->bitmap >> i) & 1) {
-                    PyObject *k = PyList_GET_ITEM(self->array, j);
-                    PyObject *v = PyList_GET_ITEM(self->array, j + 1);
-                    if (k == Py_None) {
+                    PyObject *k = self->array[j];
+                    PyObject *v = self->array[j + 1];
+                    if (k == NULL) {
                         Py_INCREF(v);
-                        Py_DECREF(PyList_GET_ITEM(nodes, i));
-                        PyList_SET_ITEM(nodes, i, v);
+                        result->array[i] = v;
                     } else {
+                        Py_hash_t kh = BIN_HASHES(self)[j / 2];
                         PyObject *al = PyList_New(0);
-                        Py_hash_t kh = PyObject_Hash(k);
-                        if (kh == -1 && PyErr_Occurred()) {
-                            Py_DECREF(al);
-                            Py_DECREF(nodes);
+                        if (!al) {
+                            Py_DECREF(result);
                             return NULL;
                         }
                         PyObject *child = BitmapIndexedNode_assoc(EMPTY_BIN, shift + BITS, kh, k, v, al, transient_id);
                         Py_DECREF(al);
                         if (!child) {
-                            Py_DECREF(nodes);
+                            Py_DECREF(result);
                             return NULL;
                         }
-                        Py_DECREF(PyList_GET_ITEM(nodes, i));
-                        PyList_SET_ITEM(nodes, i, child);
+                        result->array[i] = child;
                     }
                     j += 2;
                 }
             }
 
-            ArrayNode *result = ArrayNode_create(n + 1, nodes, transient_id);
-            Py_DECREF(nodes);
             return (PyObject *)result;
         } else {
             // Insert into bitmap node
             if (PyList_Append(added_leaf, Py_True) < 0) return NULL;
 
-            Py_ssize_t arr_len = PyList_Size(self->array);
-            PyObject *new_array = PyList_New(arr_len + 2);
-            if (!new_array) return NULL;
+            Py_ssize_t arr_len = Py_SIZE(self);
+            BitmapIndexedNode *node = BitmapIndexedNode_create(self->bitmap | bit, arr_len + 2, transient_id);
+            if (!node) return NULL;
 
             for (Py_ssize_t i = 0; i < 2 * idx; i++) {
-                PyObject *item = PyList_GET_ITEM(self->array, i);
-                Py_INCREF(item);
-                PyList_SET_ITEM(new_array, i, item);
+                node->array[i] = self->array[i];
+                Py_XINCREF(node->array[i]);
             }
             Py_INCREF(key);
-            PyList_SET_ITEM(new_array, 2 * idx, key);
+            node->array[2 * idx] = key;
             Py_INCREF(val);
-            PyList_SET_ITEM(new_array, 2 * idx + 1, val);
+            node->array[2 * idx + 1] = val;
             for (Py_ssize_t i = 2 * idx; i < arr_len; i++) {
-                PyObject *item = PyList_GET_ITEM(self->array, i);
-                Py_INCREF(item);
-                PyList_SET_ITEM(new_array, i + 2, item);
+                node->array[i + 2] = self->array[i];
+                Py_XINCREF(node->array[i + 2]);
             }
+            Py_hash_t *hashes = BIN_HASHES(node);
+            Py_hash_t *old_hashes = BIN_HASHES(self);
+            memcpy(hashes, old_hashes, idx * sizeof(Py_hash_t));
+            hashes[idx] = hash_val;
+            memcpy(hashes + idx + 1, old_hashes + idx, (arr_len / 2 - idx) * sizeof(Py_hash_t));
 
-            BitmapIndexedNode *node = BitmapIndexedNode_create(self->bitmap | bit, new_array, transient_id);
-            Py_DECREF(new_array);
             return (PyObject *)node;
         }
     }
@@ -4897,10 +7351,10 @@ static PyObject *BitmapIndexedNode_find(BitmapIndexedNode *self, int shift, Py_h
     }
 
     int idx = bitmap_index(self->bitmap, bit);
-    PyObject *key_or_null = PyList_GET_ITEM(self->array, 2 * idx);
-    PyObject *val_or_node = PyList_GET_ITEM(self->array, 2 * idx + 1);
+    PyObject *key_or_null = self->array[2 * idx];
+    PyObject *val_or_node = self->array[2 * idx + 1];
 
-    if (key_or_null == Py_None) {
+    if (key_or_null == NULL) {
         if (PyObject_TypeCheck(val_or_node, &BitmapIndexedNodeType)) {
             return BitmapIndexedNode_find((BitmapIndexedNode *)val_or_node, shift + BITS, hash_val, key, not_found);
         } else if (PyObject_TypeCheck(val_or_node, &ArrayNodeType)) {
@@ -4910,12 +7364,14 @@ static PyObject *BitmapIndexedNode_find(BitmapIndexedNode *self, int shift, Py_h
         }
     }
 
-    int eq = PyObject_RichCompareBool(key, key_or_null, Py_EQ);
-    if (eq < 0) return NULL;
+    if (BIN_HASHES(self)[idx] == hash_val) {
+        int eq = PyObject_RichCompareBool(key, key_or_null, Py_EQ);
+        if (eq < 0) return NULL;
 
-    if (eq) {
-        Py_INCREF(val_or_node);
-        return val_or_node;
+        if (eq) {
+            Py_INCREF(val_or_node);
+            return val_or_node;
+        }
     }
 
     Py_INCREF(not_found);
@@ -4930,10 +7386,10 @@ static PyObject *BitmapIndexedNode_dissoc(BitmapIndexedNode *self, int shift, Py
     }
 
     int idx = bitmap_index(self->bitmap, bit);
-    PyObject *key_or_null = PyList_GET_ITEM(self->array, 2 * idx);
-    PyObject *val_or_node = PyList_GET_ITEM(self->array, 2 * idx + 1);
+    PyObject *key_or_null = self->array[2 * idx];
+    PyObject *val_or_node = self->array[2 * idx + 1];
 
-    if (key_or_null == Py_None) {
+    if (key_or_null == NULL) {
         // Recurse into child node
         PyObject *n;
         if (PyObject_TypeCheck(val_or_node, &BitmapIndexedNodeType)) {
@@ -4956,40 +7412,24 @@ static PyObject *BitmapIndexedNode_dissoc(BitmapIndexedNode *self, int shift, Py
                 Py_DECREF(n);
                 return NULL;
             }
-            Py_DECREF(PyList_GET_ITEM(node->array, 2 * idx + 1));
-            PyList_SET_ITEM(node->array, 2 * idx + 1, n);
+            Py_SETREF(node->array[2 * idx + 1], n);
             return (PyObject *)node;
         }
+        Py_DECREF(n);
         if (self->bitmap == bit) {
-            Py_DECREF(n);
             Py_INCREF(Py_None);
             return Py_None;
         }
-        Py_DECREF(n);
 
         // Remove entry
-        Py_ssize_t arr_len = PyList_Size(self->array);
-        PyObject *new_array = PyList_New(arr_len - 2);
-        if (!new_array) return NULL;
-
-        for (Py_ssize_t i = 0; i < 2 * idx; i++) {
-            PyObject *item = PyList_GET_ITEM(self->array, i);
-            Py_INCREF(item);
-            PyList_SET_ITEM(new_array, i, item);
-        }
-        for (Py_ssize_t i = 2 * idx + 2; i < arr_len; i++) {
-            PyObject *item = PyList_GET_ITEM(self->array, i);
-            Py_INCREF(item);
-            PyList_SET_ITEM(new_array, i - 2, item);
-        }
-
-        BitmapIndexedNode *node = BitmapIndexedNode_create(self->bitmap ^ bit, new_array, transient_id);
-        Py_DECREF(new_array);
-        return (PyObject *)node;
+        return BitmapIndexedNode_without(self, bit, idx, transient_id);
     }
 
-    int eq = PyObject_RichCompareBool(key, key_or_null, Py_EQ);
-    if (eq < 0) return NULL;
+    int eq = 0;
+    if (BIN_HASHES(self)[idx] == hash_val) {
+        eq = PyObject_RichCompareBool(key, key_or_null, Py_EQ);
+        if (eq < 0) return NULL;
+    }
 
     if (eq) {
         // Mark that we found and removed a leaf
@@ -5000,24 +7440,7 @@ static PyObject *BitmapIndexedNode_dissoc(BitmapIndexedNode *self, int shift, Py
             return Py_None;
         }
 
-        Py_ssize_t arr_len = PyList_Size(self->array);
-        PyObject *new_array = PyList_New(arr_len - 2);
-        if (!new_array) return NULL;
-
-        for (Py_ssize_t i = 0; i < 2 * idx; i++) {
-            PyObject *item = PyList_GET_ITEM(self->array, i);
-            Py_INCREF(item);
-            PyList_SET_ITEM(new_array, i, item);
-        }
-        for (Py_ssize_t i = 2 * idx + 2; i < arr_len; i++) {
-            PyObject *item = PyList_GET_ITEM(self->array, i);
-            Py_INCREF(item);
-            PyList_SET_ITEM(new_array, i - 2, item);
-        }
-
-        BitmapIndexedNode *node = BitmapIndexedNode_create(self->bitmap ^ bit, new_array, transient_id);
-        Py_DECREF(new_array);
-        return (PyObject *)node;
+        return BitmapIndexedNode_without(self, bit, idx, transient_id);
     }
 
     Py_INCREF(self);
@@ -5055,13 +7478,13 @@ static PyObject *BitmapIndexedNodeIterator_next(BitmapIndexedNodeIterator *self)
         Py_CLEAR(self->child_iter);
     }
 
-    Py_ssize_t arr_len = PyList_Size(self->node->array);
+    Py_ssize_t arr_len = Py_SIZE(self->node);
     while (self->index < arr_len) {
-        PyObject *key_or_null = PyList_GET_ITEM(self->node->array, self->index);
-        PyObject *val_or_node = PyList_GET_ITEM(self->node->array, self->index + 1);
+        PyObject *key_or_null = self->node->array[self->index];
+        PyObject *val_or_node = self->node->array[self->index + 1];
         self->index += 2;
 
-        if (key_or_null != Py_None) {
+        if (key_or_null != NULL) {
             // Direct key-value pair - return based on mode
             PyObject *result;
             switch (self->mode) {
@@ -5078,7 +7501,7 @@ static PyObject *BitmapIndexedNodeIterator_next(BitmapIndexedNodeIterator *self)
                     break;
             }
             return result;
-        } else if (val_or_node != Py_None) {
+        } else if (val_or_node != NULL) {
             // Child node - get its iterator with same mode
             if (PyObject_TypeCheck(val_or_node, &BitmapIndexedNodeType)) {
                 self->child_iter = BitmapIndexedNode_iter_mode((BitmapIndexedNode *)val_or_node, self->mode);
@@ -5128,9 +7551,9 @@ static PyObject *BitmapIndexedNode_iter_kv(BitmapIndexedNode *self) {
 // ArrayNode implementation
 static PyObject *ArrayNode_assoc(ArrayNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val, PyObject *added_leaf, PyObject *transient_id) {
     int idx = mask_hash(hash_val, shift);
-    PyObject *node = PyList_GET_ITEM(self->array, idx);
+    PyObject *node = self->array[idx];
 
-    if (node == Py_None) {
+    if (node == NULL) {
         // Use a fresh added_leaf for recursive call to avoid double-counting
         // We'll count this insertion here, not in the recursive call
         PyObject *al_fresh = PyList_New(0);
@@ -5151,8 +7574,7 @@ static PyObject *ArrayNode_assoc(ArrayNode *self, int shift, Py_hash_t hash_val,
             Py_DECREF(new_node);
             return NULL;
         }
-        Py_DECREF(PyList_GET_ITEM(editable->array, idx));
-        PyList_SET_ITEM(editable->array, idx, new_node);
+        editable->array[idx] = new_node;
         editable->count++;
         return (PyObject *)editable;
     }
@@ -5178,16 +7600,15 @@ static PyObject *ArrayNode_assoc(ArrayNode *self, int shift, Py_hash_t hash_val,
         Py_DECREF(n);
         return NULL;
     }
-    Py_DECREF(PyList_GET_ITEM(editable->array, idx));
-    PyList_SET_ITEM(editable->array, idx, n);
+    Py_SETREF(editable->array[idx], n);
     return (PyObject *)editable;
 }
 
 static PyObject *ArrayNode_find(ArrayNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *not_found) {
     int idx = mask_hash(hash_val, shift);
-    PyObject *node = PyList_GET_ITEM(self->array, idx);
+    PyObject *node = self->array[idx];
 
-    if (node == Py_None) {
+    if (node == NULL) {
         Py_INCREF(not_found);
         return not_found;
     }
@@ -5202,37 +7623,35 @@ static PyObject *ArrayNode_find(ArrayNode *self, int shift, Py_hash_t hash_val,
 }
 
 static PyObject *ArrayNode_pack(ArrayNode *self, PyObject *transient_id, int idx) {
-    PyObject *new_array = PyList_New(0);
-    if (!new_array) return NULL;
+    Py_ssize_t n = 0;
+    for (int i = 0; i < WIDTH; i++) {
+        if (i != idx && self->array[i] != NULL) n++;
+    }
+
+    BitmapIndexedNode *result = BitmapIndexedNode_create(0, 2 * n, transient_id);
+    if (!result) return NULL;
 
     unsigned int bitmap = 0;
+    Py_ssize_t j = 1;
     for (int i = 0; i < WIDTH; i++) {
-        PyObject *node = PyList_GET_ITEM(self->array, i);
-        if (i != idx && node != Py_None) {
-            Py_INCREF(Py_None);
-            if (PyList_Append(new_array, Py_None) < 0) {
-                Py_DECREF(new_array);
-                return NULL;
-            }
+        PyObject *node = self->array[i];
+        if (i != idx && node != NULL) {
             Py_INCREF(node);
-            if (PyList_Append(new_array, node) < 0) {
-                Py_DECREF(new_array);
-                return NULL;
-            }
+            result->array[j] = node;
+            j += 2;
             bitmap |= 1U << i;
         }
     }
+    result->bitmap = bitmap;
 
-    BitmapIndexedNode *result = BitmapIndexedNode_create(bitmap, new_array, transient_id);
-    Py_DECREF(new_array);
     return (PyObject *)result;
 }
 
 static PyObject *ArrayNode_dissoc(ArrayNode *self, int shift, Py_hash_t hash_val, PyObject *key, PyObject *removed_leaf, PyObject *transient_id) {
     int idx = mask_hash(hash_val, shift);
-    PyObject *node = PyList_GET_ITEM(self->array, idx);
+    PyObject *node = self->array[idx];
 
-    if (node == Py_None) {
+    if (node == NULL) {
         Py_INCREF(self);
         return (PyObject *)self;
     }
@@ -5260,9 +7679,7 @@ static PyObject *ArrayNode_dissoc(ArrayNode *self, int shift, Py_hash_t hash_val
         }
         ArrayNode *editable = ArrayNode_ensure_editable(self, transient_id);
         if (!editable) return NULL;
-        Py_INCREF(Py_None);
-        Py_DECREF(PyList_GET_ITEM(editable->array, idx));
-        PyList_SET_ITEM(editable->array, idx, Py_None);
+        Py_CLEAR(editable->array[idx]);
         editable->count--;
         return (PyObject *)editable;
     }
@@ -5272,8 +7689,7 @@ static PyObject *ArrayNode_dissoc(ArrayNode *self, int shift, Py_hash_t hash_val
         Py_DECREF(n);
         return NULL;
     }
-    Py_DECREF(PyList_GET_ITEM(editable->array, idx));
-    PyList_SET_ITEM(editable->array, idx, n);
+    Py_SETREF(editable->array[idx], n);
     return (PyObject *)editable;
 }
 
@@ -5303,10 +7719,10 @@ static PyObject *ArrayNodeIterator_next(ArrayNodeIterator *self) {
     }
 
     while (self->index < WIDTH) {
-        PyObject *node = PyList_GET_ITEM(self->node->array, self->index);
+        PyObject *node = self->node->array[self->index];
         self->index++;
 
-        if (node != Py_None) {
+        if (node != NULL) {
             if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
                 self->child_iter = BitmapIndexedNode_iter_mode((BitmapIndexedNode *)node, self->mode);
             } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
@@ -5359,7 +7775,7 @@ static PyObject *HashCollisionNode_assoc(HashCollisionNode *self, int shift, Py_
         if (idx == -2) return NULL;  // Error
 
         if (idx != -1) {
-            PyObject *existing = PyList_GET_ITEM(self->array, idx + 1);
+            PyObject *existing = self->array[idx + 1];
             if (existing == val) {
                 Py_INCREF(self);
                 return (PyObject *)self;
@@ -5367,43 +7783,34 @@ static PyObject *HashCollisionNode_assoc(HashCollisionNode *self, int shift, Py_
             HashCollisionNode *node = HashCollisionNode_ensure_editable(self, transient_id);
             if (!node) return NULL;
             Py_INCREF(val);
-            Py_DECREF(PyList_GET_ITEM(node->array, idx + 1));
-            PyList_SET_ITEM(node->array, idx + 1, val);
+            Py_SETREF(node->array[idx + 1], val);
             return (PyObject *)node;
         }
 
         if (PyList_Append(added_leaf, Py_True) < 0) return NULL;
 
-        Py_ssize_t arr_len = PyList_Size(self->array);
-        PyObject *new_array = PyList_New(arr_len + 2);
-        if (!new_array) return NULL;
+        Py_ssize_t arr_len = 2 * self->count;
+        HashCollisionNode *node = HashCollisionNode_create(self->hash, self->count + 1, transient_id);
+        if (!node) return NULL;
+        PDS_STAT_COPY(PDS_NODE_HASH_COLLISION);
 
         for (Py_ssize_t i = 0; i < arr_len; i++) {
-            PyObject *item = PyList_GET_ITEM(self->array, i);
-            Py_INCREF(item);
-            PyList_SET_ITEM(new_array, i, item);
+            node->array[i] = self->array[i];
+            Py_INCREF(node->array[i]);
         }
         Py_INCREF(key);
-        PyList_SET_ITEM(new_array, arr_len, key);
+        node->array[arr_len] = key;
         Py_INCREF(val);
-        PyList_SET_ITEM(new_array, arr_len + 1, val);
+        node->array[arr_len + 1] = val;
 
-        HashCollisionNode *node = HashCollisionNode_create(self->hash, self->count + 1, new_array, transient_id);
-        Py_DECREF(new_array);
         return (PyObject *)node;
     }
 
     // Different hash - nest in a bitmap node
-    PyObject *arr = PyList_New(2);
-    if (!arr) return NULL;
-    Py_INCREF(Py_None);
-    PyList_SET_ITEM(arr, 0, Py_None);
-    Py_INCREF(self);
-    PyList_SET_ITEM(arr, 1, (PyObject *)self);
-
-    BitmapIndexedNode *bin = BitmapIndexedNode_create(bitpos(self->hash, shift), arr, transient_id);
-    Py_DECREF(arr);
+    BitmapIndexedNode *bin = BitmapIndexedNode_create(bitpos(self->hash, shift), 2, transient_id);
     if (!bin) return NULL;
+    Py_INCREF(self);
+    bin->array[1] = (PyObject *)self;
 
     PyObject *result = BitmapIndexedNode_assoc(bin, shift, hash_val, key, val, added_leaf, transient_id);
     Py_DECREF(bin);
@@ -5417,7 +7824,7 @@ static PyObject *HashCollisionNode_find(HashCollisionNode *self, int shift, Py_h
         Py_INCREF(not_found);
         return not_found;
     }
-    PyObject *result = PyList_GET_ITEM(self->array, idx + 1);
+    PyObject *result = self->array[idx + 1];
     Py_INCREF(result);
     return result;
 }
@@ -5438,25 +7845,22 @@ static PyObject *HashCollisionNode_dissoc(HashCollisionNode *self, int shift, Py
         return Py_None;
     }
 
-    Py_ssize_t arr_len = PyList_Size(self->array);
-    PyObject *new_array = PyList_New(arr_len - 2);
-    if (!new_array) return NULL;
+    Py_ssize_t arr_len = 2 * self->count;
+    HashCollisionNode *node = HashCollisionNode_create(self->hash, self->count - 1, transient_id);
+    if (!node) return NULL;
+    PDS_STAT_COPY(PDS_NODE_HASH_COLLISION);
 
     Py_ssize_t j = 0;
     for (Py_ssize_t i = 0; i < arr_len; i += 2) {
         if (i != idx) {
-            PyObject *k = PyList_GET_ITEM(self->array, i);
-            PyObject *v = PyList_GET_ITEM(self->array, i + 1);
-            Py_INCREF(k);
-            Py_INCREF(v);
-            PyList_SET_ITEM(new_array, j, k);
-            PyList_SET_ITEM(new_array, j + 1, v);
+            node->array[j] = self->array[i];
+            node->array[j + 1] = self->array[i + 1];
+            Py_INCREF(node->array[j]);
+            Py_INCREF(node->array[j + 1]);
             j += 2;
         }
     }
 
-    HashCollisionNode *node = HashCollisionNode_create(self->hash, self->count - 1, new_array, transient_id);
-    Py_DECREF(new_array);
     return (PyObject *)node;
 }
 
@@ -5476,12 +7880,12 @@ static void HashCollisionNodeIterator_dealloc(HashCollisionNodeIterator *self) {
 }
 
 static PyObject *HashCollisionNodeIterator_next(HashCollisionNodeIterator *self) {
-    if (self->index >= PyList_Size(self->node->array)) {
+    if (self->index >= 2 * self->node->count) {
         return NULL;
     }
 
-    PyObject *key = PyList_GET_ITEM(self->node->array, self->index);
-    PyObject *val = PyList_GET_ITEM(self->node->array, self->index + 1);
+    PyObject *key = self->node->array[self->index];
+    PyObject *val = self->node->array[self->index + 1];
     self->index += 2;
 
     PyObject *result;
@@ -5526,4187 +7930,11979 @@ static PyObject *HashCollisionNode_iter_kv(HashCollisionNode *self) {
     return HashCollisionNode_iter_mode(self, ITER_MODE_ITEMS);
 }
 
-// === Map ===
-typedef struct Map {
-    PyObject_HEAD
-    Py_ssize_t cnt;
-    PyObject *root;  // BitmapIndexedNode, ArrayNode, or HashCollisionNode
-    Py_hash_t hash;
-    int hash_computed;
-    PyObject *transient_id;
-} Map;
-
-static PyTypeObject MapType;
-static Map *EMPTY_MAP = NULL;
+// === ArrayMapNode ===
+// Root of a Map with at most ARRAY_MAP_MAX entries. The pairs and their key
+// hashes share one allocation and lookups are a short scan, comparing
+// identity before hashing the probe. Entries are kept in the order a trie
+// would iterate them, so iteration, repr and pickling cannot tell the two
+// forms apart. Only Map roots take this form: Set roots, transients and
+// merges always work on trie nodes (see ArrayMapNode_promote).
 
-static void Map_dealloc(Map *self) {
-    Py_XDECREF(self->root);
-    Py_XDECREF(self->transient_id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
-}
+#define ARRAY_MAP_MAX 8
 
-static PyObject *Map_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
-    Map *self = (Map *)type->tp_alloc(type, 0);
-    if (self != NULL) {
-        self->cnt = 0;
-        self->root = NULL;
-        self->hash = 0;
-        self->hash_computed = 0;
-        self->transient_id = NULL;
-    }
-    return (PyObject *)self;
-}
+typedef struct ArrayMapNode {
+    PyObject_VAR_HEAD  // Py_SIZE is the entry count
+    PyObject *array[1];  // inline [k1, v1, ...], 2 * count slots, then one key hash per pair
+} ArrayMapNode;
 
-static Map *Map_create(Py_ssize_t cnt, PyObject *root, PyObject *transient_id) {
-    Map *m = (Map *)MapType.tp_alloc(&MapType, 0);
-    if (!m) return NULL;
+#define AMN_HASHES(node) ((Py_hash_t *)((node)->array + 2 * Py_SIZE(node)))
 
-    m->cnt = cnt;
-    m->root = root;
-    Py_XINCREF(root);
-    m->hash = 0;
-    m->hash_computed = 0;
-    m->transient_id = transient_id;
-    Py_XINCREF(transient_id);
+static PyTypeObject ArrayMapNodeType;
 
-    return m;
+static inline int is_array_map(PyObject *node) {
+    return Py_TYPE(node) == &ArrayMapNodeType;
 }
 
-static Py_ssize_t Map_length(Map *self) {
-    return self->cnt;
+static void ArrayMapNode_dealloc(ArrayMapNode *self) {
+    for (Py_ssize_t i = 0; i < 2 * Py_SIZE(self); i++) {
+        Py_XDECREF(self->array[i]);
+    }
+    pds_recycle(PDS_FL_AT(array_map, Py_SIZE(self)), (PyObject *)self, &ArrayMapNodeType);
 }
 
-static PyObject *Map_get(Map *self, PyObject *args) {
-    PyObject *key;
-    PyObject *default_val = Py_None;
+// Allocate a node for `count` entries; the caller fills the slots with new references
+static ArrayMapNode *ArrayMapNode_create(Py_ssize_t count) {
+    Py_ssize_t hash_slots = (count * (Py_ssize_t)sizeof(Py_hash_t) + (Py_ssize_t)sizeof(PyObject *) - 1) / (Py_ssize_t)sizeof(PyObject *);
+    ArrayMapNode *node = (ArrayMapNode *)pds_alloc_var(PDS_FL_AT(array_map, count), &ArrayMapNodeType, 2 * count + hash_slots);
+    if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_ARRAY_MAP);
+    Py_SET_SIZE(node, count);  // the hash area is not counted
+    memset(node->array, 0, 2 * count * sizeof(PyObject *));
+    return node;
+}
 
-    if (!PyArg_ParseTuple(args, "O|O", &key, &default_val)) {
-        return NULL;
+// 1 if a key hashed `a` comes before one hashed `b` in trie order: the lowest
+// 5-bit chunk where they differ decides, as it picks their slots in the trie
+static inline int hash_precedes(Py_hash_t a, Py_hash_t b) {
+    for (int shift = 0; shift < (int)(8 * sizeof(Py_hash_t)); shift += BITS) {
+        int ca = mask_hash(a, shift), cb = mask_hash(b, shift);
+        if (ca != cb) return ca < cb;
     }
+    return 0;
+}
 
-    if (self->root == NULL) {
-        Py_INCREF(default_val);
-        return default_val;
+// Pair index of key, whose hash is hash_val; -1 if absent, -2 on error
+static Py_ssize_t ArrayMapNode_index_hashed(ArrayMapNode *self, Py_hash_t hash_val, PyObject *key) {
+    Py_hash_t *hashes = AMN_HASHES(self);
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        PyObject *k = self->array[2 * i];
+        if (k == key) return i;
+        if (hashes[i] == hash_val) {
+            int eq = PyObject_RichCompareBool(k, key, Py_EQ);
+            if (eq < 0) return -2;
+            if (eq) return i;
+        }
     }
+    return -1;
+}
 
+// Pair index of key, trying identity before hashing it. On a miss *hash_out
+// holds the key's hash for the caller to insert with; -2 on error.
+static Py_ssize_t ArrayMapNode_index(ArrayMapNode *self, PyObject *key, Py_hash_t *hash_out) {
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        if (self->array[2 * i] == key) {
+            *hash_out = AMN_HASHES(self)[i];
+            return i;
+        }
+    }
     Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
-
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, default_val);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_find((ArrayNode *)self->root, 0, h, key, default_val);
-    } else {
-        return HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, default_val);
+    if (h == -1 && PyErr_Occurred()) return -2;
+    *hash_out = h;
+
+    Py_hash_t *hashes = AMN_HASHES(self);
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        if (hashes[i] == h) {
+            int eq = PyObject_RichCompareBool(self->array[2 * i], key, Py_EQ);
+            if (eq < 0) return -2;
+            if (eq) return i;
+        }
     }
+    return -1;
 }
 
-static PyObject *Map_getitem(Map *self, PyObject *key) {
-    if (self->root == NULL) {
-        PyErr_SetObject(PyExc_KeyError, key);
-        return NULL;
-    }
+static PyObject *ArrayMapNode_find(ArrayMapNode *self, PyObject *key, PyObject *not_found) {
+    Py_hash_t h;
+    Py_ssize_t idx = ArrayMapNode_index(self, key, &h);
+    if (idx == -2) return NULL;
+    PyObject *result = idx < 0 ? not_found : self->array[2 * idx + 1];
+    Py_INCREF(result);
+    return result;
+}
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+// ArrayMapNode iterator
+typedef struct {
+    PyObject_HEAD
+    ArrayMapNode *node;
+    Py_ssize_t index;
+    int mode;  // ITER_MODE_ITEMS, ITER_MODE_KEYS, or ITER_MODE_VALUES
+} ArrayMapNodeIterator;
 
-    PyObject *result;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
-    } else {
-        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
-    }
+static PyTypeObject ArrayMapNodeIteratorType;
 
-    if (!result) return NULL;
+static void ArrayMapNodeIterator_dealloc(ArrayMapNodeIterator *self) {
+    Py_XDECREF(self->node);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
 
-    if (result == _MISSING) {
-        Py_DECREF(result);
-        PyErr_SetObject(PyExc_KeyError, key);
+static PyObject *ArrayMapNodeIterator_next(ArrayMapNodeIterator *self) {
+    if (self->index >= Py_SIZE(self->node)) {
         return NULL;
     }
 
-    return result;
-}
+    PyObject *key = self->node->array[2 * self->index];
+    PyObject *val = self->node->array[2 * self->index + 1];
+    self->index++;
 
-static int Map_contains(Map *self, PyObject *key) {
-    if (self->root == NULL) {
-        return 0;
+    switch (self->mode) {
+        case ITER_MODE_KEYS:
+            Py_INCREF(key);
+            return key;
+        case ITER_MODE_VALUES:
+            Py_INCREF(val);
+            return val;
+        default:  // ITER_MODE_ITEMS
+            return PyTuple_Pack(2, key, val);
     }
+}
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return -1;
-
-    PyObject *result;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
-    } else {
-        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
-    }
+static PyTypeObject ArrayMapNodeIteratorType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.ArrayMapNodeIterator",
+    .tp_basicsize = sizeof(ArrayMapNodeIterator),
+    .tp_dealloc = (destructor)ArrayMapNodeIterator_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)ArrayMapNodeIterator_next,
+};
 
-    if (!result) return -1;
+static PyObject *ArrayMapNode_iter_mode(ArrayMapNode *self, int mode) {
+    ArrayMapNodeIterator *it = PyObject_New(ArrayMapNodeIterator, &ArrayMapNodeIteratorType);
+    if (!it) return NULL;
 
-    int found = (result != _MISSING);
-    Py_DECREF(result);
-    return found;
+    it->node = self;
+    Py_INCREF(self);
+    it->index = 0;
+    it->mode = mode;
+    return (PyObject *)it;
 }
 
-static PyObject *Map_assoc(Map *self, PyObject *args) {
-    PyObject *key, *val;
+static PyTypeObject ArrayMapNodeType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.ArrayMapNode",
+    .tp_basicsize = offsetof(ArrayMapNode, array),
+    .tp_itemsize = sizeof(PyObject *),
+    .tp_dealloc = (destructor)ArrayMapNode_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+};
 
-    if (!PyArg_ParseTuple(args, "OO", &key, &val)) {
-        return NULL;
+// Fold f over the keys below a node, in iteration order (see reduce_step)
+static int MapNode_reduce_keys(PyObject *node, PyObject *f, PyObject **acc) {
+    if (is_array_map(node)) {
+        ArrayMapNode *amn = (ArrayMapNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(amn); i++) {
+            if (reduce_step(f, acc, amn->array[2 * i]) < 0) return -1;
+        }
+    } else if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        Py_ssize_t len = Py_SIZE(bin);
+        for (Py_ssize_t i = 0; i < len; i += 2) {
+            if (bin->array[i] != NULL) {
+                if (reduce_step(f, acc, bin->array[i]) < 0) return -1;
+            } else if (bin->array[i + 1] != NULL) {
+                if (MapNode_reduce_keys(bin->array[i + 1], f, acc) < 0) return -1;
+            }
+        }
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL && MapNode_reduce_keys(an->array[i], f, acc) < 0) return -1;
+        }
+    } else {
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        for (int i = 0; i < hcn->count; i++) {
+            if (reduce_step(f, acc, hcn->array[2 * i]) < 0) return -1;
+        }
     }
+    return 0;
+}
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
-
-    PyObject *added_leaf = PyList_New(0);
-    if (!added_leaf) return NULL;
-
-    PyObject *root = self->root ? self->root : (PyObject *)EMPTY_BIN;
-    PyObject *new_root;
+// reduce(f[, init]) over the keys of a Map or the elements of a Set
+static PyObject *MapNode_reduce_method(PyObject *root, Py_ssize_t cnt, PyObject *args) {
+    PyObject *f;
+    PyObject *acc = NULL;
 
-    if (PyObject_TypeCheck(root, &BitmapIndexedNodeType)) {
-        new_root = BitmapIndexedNode_assoc((BitmapIndexedNode *)root, 0, h, key, val, added_leaf, self->transient_id);
-    } else if (PyObject_TypeCheck(root, &ArrayNodeType)) {
-        new_root = ArrayNode_assoc((ArrayNode *)root, 0, h, key, val, added_leaf, self->transient_id);
-    } else {
-        new_root = HashCollisionNode_assoc((HashCollisionNode *)root, 0, h, key, val, added_leaf, self->transient_id);
+    if (!PyArg_ParseTuple(args, "O|O:reduce", &f, &acc)) {
+        return NULL;
+    }
+    if (cnt == 0 && acc == NULL) {
+        return PyObject_CallNoArgs(f);
     }
+    Py_XINCREF(acc);
 
-    if (!new_root) {
-        Py_DECREF(added_leaf);
+    if (root != NULL && MapNode_reduce_keys(root, f, &acc) < 0) {
+        Py_XDECREF(acc);
         return NULL;
     }
+    return acc;
+}
 
-    if (new_root == self->root) {
-        Py_DECREF(new_root);
-        Py_DECREF(added_leaf);
-        Py_INCREF(self);
-        return (PyObject *)self;
+// Look a key up below any node type, starting at `shift`
+static PyObject *MapNode_find(PyObject *node, int shift, Py_hash_t hash_val, PyObject *key, PyObject *not_found) {
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_find((BitmapIndexedNode *)node, shift, hash_val, key, not_found);
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        return ArrayNode_find((ArrayNode *)node, shift, hash_val, key, not_found);
+    } else if (is_array_map(node)) {
+        ArrayMapNode *amn = (ArrayMapNode *)node;
+        Py_ssize_t idx = ArrayMapNode_index_hashed(amn, hash_val, key);
+        if (idx == -2) return NULL;
+        PyObject *result = idx < 0 ? not_found : amn->array[2 * idx + 1];
+        Py_INCREF(result);
+        return result;
     }
-
-    Py_ssize_t new_cnt = self->cnt + PyList_Size(added_leaf);
-    Py_DECREF(added_leaf);
-
-    Map *result = Map_create(new_cnt, new_root, self->transient_id);
-    Py_DECREF(new_root);
-    return (PyObject *)result;
+    HashCollisionNode *hcn = (HashCollisionNode *)node;
+    if (hcn->hash != hash_val) {
+        Py_INCREF(not_found);
+        return not_found;
+    }
+    return HashCollisionNode_find(hcn, shift, hash_val, key, not_found);
 }
 
-static PyObject *Map_dissoc(Map *self, PyObject *key) {
-    if (self->root == NULL) {
-        Py_INCREF(self);
-        return (PyObject *)self;
+// Sum of hash(k) ^ hash(v) over the entries below a node. Persistent nodes are
+// never edited in place, so each node caches its sum and structurally shared
+// subtrees are hashed once.
+static int MapNode_hash(PyObject *node, Py_uhash_t *out) {
+    Py_uhash_t h = 0;
+
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        if (PDS_CACHE_READY(bin->hash_computed)) {
+            *out = (Py_uhash_t)bin->hash;
+            return 0;
+        }
+        Py_ssize_t len = Py_SIZE(bin);
+        for (Py_ssize_t i = 0; i < len; i += 2) {
+            if (bin->array[i] != NULL) {
+                Py_hash_t vh = PyObject_Hash(bin->array[i + 1]);
+                if (vh == -1 && PyErr_Occurred()) return -1;
+                h += (Py_uhash_t)(BIN_HASHES(bin)[i / 2] ^ vh);
+            } else if (bin->array[i + 1] != NULL) {
+                Py_uhash_t sub;
+                if (MapNode_hash(bin->array[i + 1], &sub) < 0) return -1;
+                h += sub;
+            }
+        }
+        bin->hash = (Py_hash_t)h;
+        PDS_CACHE_PUBLISH(bin->hash_computed);
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        if (PDS_CACHE_READY(an->hash_computed)) {
+            *out = (Py_uhash_t)an->hash;
+            return 0;
+        }
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL) {
+                Py_uhash_t sub;
+                if (MapNode_hash(an->array[i], &sub) < 0) return -1;
+                h += sub;
+            }
+        }
+        an->hash = (Py_hash_t)h;
+        PDS_CACHE_PUBLISH(an->hash_computed);
+    } else if (is_array_map(node)) {
+        // Uncached: only ever a root, and Map caches its own hash
+        ArrayMapNode *amn = (ArrayMapNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(amn); i++) {
+            Py_hash_t vh = PyObject_Hash(amn->array[2 * i + 1]);
+            if (vh == -1 && PyErr_Occurred()) return -1;
+            h += (Py_uhash_t)(AMN_HASHES(amn)[i] ^ vh);
+        }
+    } else {
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        if (PDS_CACHE_READY(hcn->hash_computed)) {
+            *out = (Py_uhash_t)hcn->subtree_hash;
+            return 0;
+        }
+        // Every key here hashes to hcn->hash
+        for (int i = 0; i < hcn->count; i++) {
+            Py_hash_t vh = PyObject_Hash(hcn->array[2 * i + 1]);
+            if (vh == -1 && PyErr_Occurred()) return -1;
+            h += (Py_uhash_t)(hcn->hash ^ vh);
+        }
+        hcn->subtree_hash = (Py_hash_t)h;
+        PDS_CACHE_PUBLISH(hcn->hash_computed);
     }
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+    *out = h;
+    return 0;
+}
 
-    PyObject *new_root;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        new_root = BitmapIndexedNode_dissoc((BitmapIndexedNode *)self->root, 0, h, key, NULL, self->transient_id);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        new_root = ArrayNode_dissoc((ArrayNode *)self->root, 0, h, key, NULL, self->transient_id);
+// XOR of the stored key hashes below a node
+static Py_uhash_t MapNode_xor_key_hashes(PyObject *node) {
+    Py_uhash_t h = 0;
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        Py_ssize_t len = Py_SIZE(bin);
+        for (Py_ssize_t i = 0; i < len; i += 2) {
+            if (bin->array[i] != NULL) {
+                h ^= (Py_uhash_t)BIN_HASHES(bin)[i / 2];
+            } else if (bin->array[i + 1] != NULL) {
+                h ^= MapNode_xor_key_hashes(bin->array[i + 1]);
+            }
+        }
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL) h ^= MapNode_xor_key_hashes(an->array[i]);
+        }
     } else {
-        new_root = HashCollisionNode_dissoc((HashCollisionNode *)self->root, 0, h, key, NULL, self->transient_id);
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        if (hcn->count & 1) h = (Py_uhash_t)hcn->hash;
     }
+    return h;
+}
 
-    if (!new_root) return NULL;
-
-    if (new_root == self->root) {
-        Py_DECREF(new_root);
-        Py_INCREF(self);
-        return (PyObject *)self;
+// 1 if `b` (a node at `shift`) maps key to a value equal to val, 0 if not, -1 on error
+static int MapNode_has_entry(PyObject *b, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val) {
+    PyObject *found = MapNode_find(b, shift, hash_val, key, _MISSING);
+    if (!found) return -1;
+    int eq = 0;
+    if (found != _MISSING) {
+        eq = PyObject_RichCompareBool(val, found, Py_EQ);
+    }
+    Py_DECREF(found);
+    return eq;
+}
+
+// Look every entry below `a` up in `b`, a node at `shift`
+static int MapNode_entries_in(PyObject *a, PyObject *b, int shift) {
+    if (PyObject_TypeCheck(a, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)a;
+        Py_ssize_t len = Py_SIZE(bin);
+        for (Py_ssize_t i = 0; i < len; i += 2) {
+            int r;
+            if (bin->array[i] != NULL) {
+                r = MapNode_has_entry(b, shift, BIN_HASHES(bin)[i / 2], bin->array[i], bin->array[i + 1]);
+            } else if (bin->array[i + 1] != NULL) {
+                r = MapNode_entries_in(bin->array[i + 1], b, shift);
+            } else {
+                continue;
+            }
+            if (r <= 0) return r;
+        }
+    } else if (PyObject_TypeCheck(a, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)a;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL) {
+                int r = MapNode_entries_in(an->array[i], b, shift);
+                if (r <= 0) return r;
+            }
+        }
+    } else if (is_array_map(a)) {
+        ArrayMapNode *amn = (ArrayMapNode *)a;
+        for (Py_ssize_t i = 0; i < Py_SIZE(amn); i++) {
+            int r = MapNode_has_entry(b, shift, AMN_HASHES(amn)[i], amn->array[2 * i], amn->array[2 * i + 1]);
+            if (r <= 0) return r;
+        }
+    } else {
+        HashCollisionNode *hcn = (HashCollisionNode *)a;
+        for (int i = 0; i < hcn->count; i++) {
+            int r = MapNode_has_entry(b, shift, hcn->hash, hcn->array[2 * i], hcn->array[2 * i + 1]);
+            if (r <= 0) return r;
+        }
+    }
+    return 1;
+}
+
+// 1 if every entry below `a` is also below `b`, both nodes at the same `shift`.
+// Walks the two tries side by side so shared subtrees are skipped by identity
+// and matching slots are compared without hashing or lookups.
+static int MapNode_contains_all(PyObject *a, PyObject *b, int shift) {
+    if (a == b) return 1;
+
+    if (PyObject_TypeCheck(a, &BitmapIndexedNodeType) && PyObject_TypeCheck(b, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *na = (BitmapIndexedNode *)a;
+        BitmapIndexedNode *nb = (BitmapIndexedNode *)b;
+        if ((na->bitmap & ~nb->bitmap) != 0) return 0;
+
+        unsigned int bitmap = na->bitmap;
+        int ia = 0;
+        while (bitmap) {
+            unsigned int bit = bitmap & (~bitmap + 1);
+            bitmap &= bitmap - 1;
+            int ib = bitmap_index(nb->bitmap, bit);
+            PyObject *ka = na->array[2 * ia];
+            PyObject *va = na->array[2 * ia + 1];
+            PyObject *kb = nb->array[2 * ib];
+            PyObject *vb = nb->array[2 * ib + 1];
+            Py_hash_t ha = BIN_HASHES(na)[ia];
+            Py_hash_t hb = BIN_HASHES(nb)[ib];
+            ia++;
+
+            int r;
+            if (ka != NULL && kb != NULL) {
+                // One key per slot: a's key is in b only if it is b's key
+                if (ha != hb) return 0;
+                r = PyObject_RichCompareBool(ka, kb, Py_EQ);
+                if (r > 0) r = PyObject_RichCompareBool(va, vb, Py_EQ);
+            } else if (ka == NULL && kb == NULL) {
+                r = MapNode_contains_all(va, vb, shift + BITS);
+            } else if (ka != NULL) {
+                r = MapNode_has_entry(b, shift, ha, ka, va);
+            } else {
+                r = MapNode_entries_in(va, b, shift);
+            }
+            if (r <= 0) return r;
+        }
+        return 1;
     }
 
-    Py_ssize_t new_cnt = (new_root != Py_None) ? self->cnt - 1 : 0;
-    if (new_root == Py_None) {
-        Py_DECREF(new_root);
-        new_root = NULL;
+    if (PyObject_TypeCheck(a, &ArrayNodeType) && PyObject_TypeCheck(b, &ArrayNodeType)) {
+        ArrayNode *na = (ArrayNode *)a;
+        ArrayNode *nb = (ArrayNode *)b;
+        for (int i = 0; i < WIDTH; i++) {
+            if (na->array[i] == NULL) continue;
+            if (nb->array[i] == NULL) return 0;
+            int r = MapNode_contains_all(na->array[i], nb->array[i], shift + BITS);
+            if (r <= 0) return r;
+        }
+        return 1;
     }
 
-    Map *result = Map_create(new_cnt, new_root, self->transient_id);
-    Py_XDECREF(new_root);
-    return (PyObject *)result;
+    return MapNode_entries_in(a, b, shift);
 }
 
-static PyObject *Map_iter(Map *self) {
-    if (self->root == NULL) {
-        return PyObject_GetIter(PyList_New(0));
+static PyObject *MapNode_assoc(PyObject *node, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val, PyObject *added_leaf) {
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_assoc((BitmapIndexedNode *)node, shift, hash_val, key, val, added_leaf, NULL);
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        return ArrayNode_assoc((ArrayNode *)node, shift, hash_val, key, val, added_leaf, NULL);
     }
+    return HashCollisionNode_assoc((HashCollisionNode *)node, shift, hash_val, key, val, added_leaf, NULL);
+}
 
-    // Get a key-only iterator directly (no tuple allocation)
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_KEYS);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_KEYS);
+// Number of entries below a node, cached like MapNode_hash
+static Py_ssize_t MapNode_count(PyObject *node) {
+    Py_ssize_t n = 0;
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        n = PDS_SSIZE_LOAD(bin->size);
+        if (n) return n;
+        Py_ssize_t len = Py_SIZE(bin);
+        for (Py_ssize_t i = 0; i < len; i += 2) {
+            if (bin->array[i] != NULL) {
+                n++;
+            } else if (bin->array[i + 1] != NULL) {
+                n += MapNode_count(bin->array[i + 1]);
+            }
+        }
+        PDS_SSIZE_STORE(bin->size, n);
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        n = PDS_SSIZE_LOAD(an->size);
+        if (n) return n;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL) n += MapNode_count(an->array[i]);
+        }
+        PDS_SSIZE_STORE(an->size, n);
+    } else if (is_array_map(node)) {
+        n = Py_SIZE(node);
     } else {
-        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_KEYS);
+        n = ((HashCollisionNode *)node)->count;
+    }
+    return n;
+}
+
+// Add one entry to `node` (at `shift`) under merge rules: with no f the right
+// value wins, otherwise the stored value is f(left, right). `from_left` says
+// which side the entry came from. Sets *found when the key was already present.
+static PyObject *MapNode_merge_entry(PyObject *node, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val,
+                                     PyObject *f, int from_left, int *found) {
+    PyObject *existing = MapNode_find(node, shift, hash_val, key, _MISSING);
+    if (!existing) return NULL;
+
+    *found = existing != _MISSING;
+    PyObject *new_val;
+    if (!*found) {
+        new_val = val;
+        Py_INCREF(new_val);
+    } else if (f != NULL) {
+        new_val = from_left ? PyObject_CallFunctionObjArgs(f, val, existing, NULL)
+                            : PyObject_CallFunctionObjArgs(f, existing, val, NULL);
+    } else if (from_left) {
+        // The right side already holds this key and wins
+        Py_DECREF(existing);
+        Py_INCREF(node);
+        return node;
+    } else {
+        new_val = val;
+        Py_INCREF(new_val);
+    }
+    Py_DECREF(existing);
+    if (!new_val) return NULL;
+
+    PyObject *added_leaf = PyList_New(0);
+    if (!added_leaf) {
+        Py_DECREF(new_val);
+        return NULL;
     }
+    PyObject *result = MapNode_assoc(node, shift, hash_val, key, new_val, added_leaf);
+    Py_DECREF(added_leaf);
+    Py_DECREF(new_val);
+    return result;
 }
 
-static PyObject *Map_items(Map *self, PyObject *Py_UNUSED(ignored)) {
-    if (self->root == NULL) {
-        return PyObject_GetIter(PyList_New(0));
+// Fold every entry below `b` into `acc`, a node at `shift`; steals acc
+static PyObject *MapNode_merge_entries(PyObject *acc, PyObject *b, int shift, PyObject *f, Py_ssize_t *added) {
+    if (PyObject_TypeCheck(b, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)b;
+        for (int i = 0; i < WIDTH && acc != NULL; i++) {
+            if (an->array[i] != NULL) acc = MapNode_merge_entries(acc, an->array[i], shift, f, added);
+        }
+        return acc;
+    }
+
+    int is_bin = PyObject_TypeCheck(b, &BitmapIndexedNodeType);
+    Py_ssize_t len = is_bin ? Py_SIZE(b) : 2 * ((HashCollisionNode *)b)->count;
+    PyObject **array = is_bin ? ((BitmapIndexedNode *)b)->array : ((HashCollisionNode *)b)->array;
+    for (Py_ssize_t i = 0; i < len && acc != NULL; i += 2) {
+        PyObject *next;
+        if (array[i] == NULL) {
+            if (array[i + 1] == NULL) continue;
+            next = MapNode_merge_entries(acc, array[i + 1], shift, f, added);
+            acc = NULL;
+        } else {
+            Py_hash_t h = is_bin ? BIN_HASHES((BitmapIndexedNode *)b)[i / 2] : ((HashCollisionNode *)b)->hash;
+            int found;
+            next = MapNode_merge_entry(acc, shift, h, array[i], array[i + 1], f, 0, &found);
+            Py_DECREF(acc);
+            if (next && !found) (*added)++;
+        }
+        acc = next;
+    }
+    return acc;
+}
+
+// One trie position of a BitmapIndexedNode or ArrayNode, seen uniformly
+static int MapNode_slot(PyObject *node, int i, PyObject **key, Py_hash_t *hash_val, PyObject **val) {
+    if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        *key = NULL;
+        *val = ((ArrayNode *)node)->array[i];
+        return *val != NULL;
+    }
+    BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+    unsigned int bit = 1U << i;
+    if ((bin->bitmap & bit) == 0) return 0;
+    int idx = bitmap_index(bin->bitmap, bit);
+    *key = bin->array[2 * idx];
+    *hash_val = BIN_HASHES(bin)[idx];
+    *val = bin->array[2 * idx + 1];
+    return 1;
+}
+
+// Build a node at `shift` from per-position slots: vals[i] NULL for an empty
+// position, keys[i] NULL when vals[i] is a child node. Borrows the slots.
+static PyObject *MapNode_from_slots(PyObject **keys, Py_hash_t *hashes, PyObject **vals, int n, int as_array, int shift) {
+    if (as_array) {
+        ArrayNode *an = ArrayNode_create(n, NULL);
+        for (int i = 0; an != NULL && i < WIDTH; i++) {
+            if (vals[i] == NULL) continue;
+            if (keys[i] == NULL) {
+                an->array[i] = vals[i];
+                Py_INCREF(vals[i]);
+                continue;
+            }
+            // A lone key moves one level down, as in BitmapIndexedNode_assoc
+            BitmapIndexedNode *child = BitmapIndexedNode_create(bitpos(hashes[i], shift + BITS), 2, NULL);
+            if (!child) {
+                Py_CLEAR(an);
+                break;
+            }
+            child->array[0] = keys[i];
+            child->array[1] = vals[i];
+            Py_INCREF(keys[i]);
+            Py_INCREF(vals[i]);
+            BIN_HASHES(child)[0] = hashes[i];
+            an->array[i] = (PyObject *)child;
+        }
+        return (PyObject *)an;
     }
 
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_iter_kv((BitmapIndexedNode *)self->root);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_iter_kv((ArrayNode *)self->root);
-    } else {
-        return HashCollisionNode_iter_kv((HashCollisionNode *)self->root);
+    unsigned int bitmap = 0;
+    for (int i = 0; i < WIDTH; i++) {
+        if (vals[i] != NULL) bitmap |= 1U << i;
+    }
+    BitmapIndexedNode *bin = BitmapIndexedNode_create(bitmap, 2 * n, NULL);
+    for (int i = 0, j = 0; bin != NULL && i < WIDTH; i++) {
+        if (vals[i] == NULL) continue;
+        bin->array[2 * j] = keys[i];
+        bin->array[2 * j + 1] = vals[i];
+        Py_XINCREF(keys[i]);
+        Py_INCREF(vals[i]);
+        BIN_HASHES(bin)[j] = hashes[i];
+        j++;
     }
+    return (PyObject *)bin;
 }
 
-static PyObject *Map_keys(Map *self, PyObject *Py_UNUSED(ignored)) {
-    return Map_iter(self);
+static void MapNode_clear_slots(PyObject **keys, PyObject **vals) {
+    for (int i = 0; i < WIDTH; i++) {
+        if (vals[i] != NULL) {
+            Py_XDECREF(keys[i]);
+            Py_DECREF(vals[i]);
+        }
+    }
 }
 
-static PyObject *Map_values(Map *self, PyObject *Py_UNUSED(ignored)) {
-    if (self->root == NULL) {
-        return PyObject_GetIter(PyList_New(0));
-    }
+// Bulk construction. Entries are partitioned on one hash chunk per level
+// with a stable counting sort, so each node is emitted once, bottom-up,
+// instead of path-copying from the root for every insertion. Stability
+// keeps input order within a key, so the last value for a key wins.
 
-    // Get a value-only iterator directly (no tuple allocation)
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_VALUES);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_VALUES);
-    } else {
-        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_VALUES);
-    }
+typedef struct {
+    Py_hash_t hash;
+    PyObject *key;
+    PyObject *val;
+} MapBuildEntry;
+
+// Append an entry, taking new references to key and val
+static int MapBuild_push(MapBuildEntry *e, Py_ssize_t *n, PyObject *key, PyObject *val) {
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return -1;
+    e[*n].hash = h;
+    e[*n].key = key;
+    e[*n].val = val;
+    Py_INCREF(key);
+    Py_INCREF(val);
+    (*n)++;
+    return 0;
 }
 
-static Py_hash_t Map_hash(Map *self) {
-    if (self->hash_computed) {
-        return self->hash;
+static void MapBuild_clear(MapBuildEntry *e, Py_ssize_t n) {
+    for (Py_ssize_t i = 0; i < n; i++) {
+        Py_DECREF(e[i].key);
+        Py_DECREF(e[i].val);
+    }
+    PyMem_Free(e);
+}
+
+// Distinct keys of a run sharing one hash: first[d] is where key d first
+// appears (that key object is kept) and last[d] where it last appears
+// (that value is kept), as repeated assoc would. Returns d or -1.
+static Py_ssize_t MapBuild_distinct(MapBuildEntry *e, Py_ssize_t k, Py_ssize_t *first, Py_ssize_t *last) {
+    Py_ssize_t d = 0;
+    for (Py_ssize_t i = 0; i < k; i++) {
+        Py_ssize_t j = 0;
+        for (; j < d; j++) {
+            PyObject *seen = e[first[j]].key;
+            int eq = seen == e[i].key ? 1 : PyObject_RichCompareBool(seen, e[i].key, Py_EQ);
+            if (eq < 0) return -1;
+            if (eq) break;
+        }
+        if (j == d) first[d++] = i;
+        last[j] = i;
     }
+    return d;
+}
 
-    Py_hash_t h = 0;
-    PyObject *items_iter = Map_items(self, NULL);
-    if (!items_iter) return -1;
+static PyObject *MapNode_build(MapBuildEntry *e, MapBuildEntry *tmp, Py_ssize_t n, int shift, Py_ssize_t *cnt);
 
-    PyObject *pair;
-    while ((pair = PyIter_Next(items_iter)) != NULL) {
-        PyObject *key = PyTuple_GET_ITEM(pair, 0);
-        PyObject *val = PyTuple_GET_ITEM(pair, 1);
+// Fill slot `pos` from the k entries e[0..k), all at that position below `shift`
+static int MapBuild_slot(MapBuildEntry *e, MapBuildEntry *tmp, Py_ssize_t k, int shift, int pos,
+                         PyObject **keys, Py_hash_t *hashes, PyObject **vals, Py_ssize_t *cnt) {
+    Py_ssize_t i = 1;
+    while (i < k && e[i].hash == e[0].hash) i++;
 
-        Py_hash_t kh = PyObject_Hash(key);
-        Py_hash_t vh = PyObject_Hash(val);
-        Py_DECREF(pair);
+    if (i < k) {
+        Py_ssize_t sub;
+        PyObject *child = MapNode_build(e, tmp, k, shift + BITS, &sub);
+        if (!child) return -1;
+        keys[pos] = NULL;
+        hashes[pos] = 0;
+        vals[pos] = child;
+        *cnt += sub;
+        return 0;
+    }
 
-        if ((kh == -1 || vh == -1) && PyErr_Occurred()) {
-            Py_DECREF(items_iter);
-            return -1;
+    // One full hash: a single key stays inline, colliding keys share a
+    // collision node, as in create_node
+    Py_ssize_t *first = PyMem_Malloc(2 * k * sizeof(Py_ssize_t));
+    if (!first) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    Py_ssize_t *last = first + k;
+    Py_ssize_t d = MapBuild_distinct(e, k, first, last);
+    if (d == 1) {
+        keys[pos] = e[first[0]].key;
+        hashes[pos] = e[0].hash;
+        vals[pos] = e[last[0]].val;
+        Py_INCREF(keys[pos]);
+        Py_INCREF(vals[pos]);
+    } else if (d > 1) {
+        HashCollisionNode *hcn = HashCollisionNode_create(e[0].hash, (int)d, NULL);
+        if (hcn) {
+            PDS_STAT_ADD(collisions, 1);
+            for (Py_ssize_t j = 0; j < d; j++) {
+                hcn->array[2 * j] = e[first[j]].key;
+                hcn->array[2 * j + 1] = e[last[j]].val;
+                Py_INCREF(e[first[j]].key);
+                Py_INCREF(e[last[j]].val);
+            }
         }
+        keys[pos] = NULL;
+        hashes[pos] = 0;
+        vals[pos] = (PyObject *)hcn;
+    }
+    PyMem_Free(first);
+    if (d < 0 || vals[pos] == NULL) return -1;
+    *cnt += d;
+    return 0;
+}
 
-        h += kh ^ vh;
+// Node at `shift` for the n entries e[0..n), which disagree somewhere at or
+// below `shift`; tmp is scratch of the same length. Stores the distinct
+// key count in *cnt.
+static PyObject *MapNode_build(MapBuildEntry *e, MapBuildEntry *tmp, Py_ssize_t n, int shift, Py_ssize_t *cnt) {
+    Py_ssize_t start[WIDTH + 1] = {0};
+    for (Py_ssize_t i = 0; i < n; i++) start[mask_hash(e[i].hash, shift) + 1]++;
+    for (int i = 0; i < WIDTH; i++) start[i + 1] += start[i];
+    Py_ssize_t fill[WIDTH];
+    memcpy(fill, start, sizeof(fill));
+    for (Py_ssize_t i = 0; i < n; i++) tmp[fill[mask_hash(e[i].hash, shift)]++] = e[i];
+    memcpy(e, tmp, n * sizeof(MapBuildEntry));
+
+    PyObject *keys[WIDTH], *vals[WIDTH];
+    Py_hash_t hashes[WIDTH];
+    int count = 0;
+    *cnt = 0;
+    for (int pos = 0; pos < WIDTH; pos++) {
+        vals[pos] = NULL;
+        Py_ssize_t k = start[pos + 1] - start[pos];
+        if (k == 0) continue;
+        if (MapBuild_slot(e + start[pos], tmp + start[pos], k, shift, pos, keys, hashes, vals, cnt) < 0) {
+            for (int i = pos + 1; i < WIDTH; i++) vals[i] = NULL;
+            MapNode_clear_slots(keys, vals);
+            return NULL;
+        }
+        count++;
     }
-    Py_DECREF(items_iter);
 
-    if (PyErr_Occurred()) return -1;
+    PyObject *node = MapNode_from_slots(keys, hashes, vals, count, count > WIDTH / 2, shift);
+    MapNode_clear_slots(keys, vals);
+    return node;
+}
 
-    self->hash = h;
-    self->hash_computed = 1;
-    return h;
+// Build a root from n owned entries, which are released here. Stores the
+// distinct count in *cnt; returns NULL without an error for n == 0.
+static PyObject *MapBuild_root(MapBuildEntry *e, Py_ssize_t n, Py_ssize_t *cnt) {
+    PyObject *root = NULL;
+    *cnt = 0;
+    if (n > 0) {
+        MapBuildEntry *tmp = PyMem_Malloc(n * sizeof(MapBuildEntry));
+        if (!tmp) {
+            PyErr_NoMemory();
+        } else {
+            root = MapNode_build(e, tmp, n, 0, cnt);
+            PyMem_Free(tmp);
+        }
+    }
+    MapBuild_clear(e, n);
+    return root;
 }
 
-static PyObject *Map_richcompare(Map *self, PyObject *other, int op) {
-    if (op != Py_EQ && op != Py_NE) {
-        Py_RETURN_NOTIMPLEMENTED;
+// Append a [key value] pair given as a tuple, list or Vector
+static int MapBuild_push_pair(MapBuildEntry *e, Py_ssize_t *n, PyObject *item, const char *who) {
+    if (PyObject_TypeCheck(item, &VectorType) && ((Vector *)item)->cnt == 2) {
+        return MapBuild_push(e, n, Vector_item((Vector *)item, 0), Vector_item((Vector *)item, 1));
+    }
+    if ((PyTuple_Check(item) || PyList_Check(item)) && PySequence_Fast_GET_SIZE(item) == 2) {
+        PyObject **kv = PySequence_Fast_ITEMS(item);
+        return MapBuild_push(e, n, kv[0], kv[1]);
     }
+    PyErr_Format(PyExc_ValueError, "%s requires [key value] pairs", who);
+    return -1;
+}
 
-    if (self == (Map *)other) {
-        return PyBool_FromLong(op == Py_EQ);
+// Collect entries from a dict, Map or iterable of pairs (keys_only: any
+// iterable, values None). Returns the array, owning its entries, or NULL.
+static MapBuildEntry *MapBuild_collect(PyObject *src, int keys_only, const char *who, Py_ssize_t *n) {
+    *n = 0;
+    MapBuildEntry *e;
+
+    if (PyDict_Check(src)) {
+        e = PyMem_Malloc((PyDict_GET_SIZE(src) + 1) * sizeof(MapBuildEntry));
+        if (!e) return (MapBuildEntry *)PyErr_NoMemory();
+        Py_ssize_t pos = 0;
+        PyObject *k, *v;
+        while (PyDict_Next(src, &pos, &k, &v)) {
+            if (MapBuild_push(e, n, k, keys_only ? Py_None : v) < 0) goto error;
+        }
+        return e;
     }
 
-    if (!PyObject_TypeCheck(other, &MapType)) {
-        return PyBool_FromLong(op == Py_NE);
+    PyObject *seq = PySequence_Fast(src, "expected an iterable");
+    if (!seq) return NULL;
+    Py_ssize_t len = PySequence_Fast_GET_SIZE(seq);
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+    e = PyMem_Malloc((len + 1) * sizeof(MapBuildEntry));
+    if (!e) {
+        Py_DECREF(seq);
+        return (MapBuildEntry *)PyErr_NoMemory();
+    }
+    for (Py_ssize_t i = 0; i < len; i++) {
+        int rc = keys_only ? MapBuild_push(e, n, items[i], Py_None)
+                           : MapBuild_push_pair(e, n, items[i], who);
+        if (rc < 0) {
+            Py_DECREF(seq);
+            goto error;
+        }
     }
+    Py_DECREF(seq);
+    return e;
 
-    Map *o = (Map *)other;
-    if (self->cnt != o->cnt) {
-        return PyBool_FromLong(op == Py_NE);
+error:
+    MapBuild_clear(e, *n);
+    return NULL;
+}
+
+// Merge the entries below `b` into those below `a`, both nodes at `shift`.
+// Positions present on one side only are taken as they are, pointer-identical
+// subtrees are reused when there is no conflict function, and matching
+// children are merged recursively. *added counts keys of b missing from a.
+static PyObject *MapNode_merge(PyObject *a, PyObject *b, int shift, PyObject *f, Py_ssize_t *added) {
+    if (a == b && f == NULL) {
+        Py_INCREF(a);
+        return a;
     }
 
-    PyObject *items_iter = Map_items(self, NULL);
-    if (!items_iter) return NULL;
+    if (PyObject_TypeCheck(a, &HashCollisionNodeType) || PyObject_TypeCheck(b, &HashCollisionNodeType)) {
+        Py_INCREF(a);
+        return MapNode_merge_entries(a, b, shift, f, added);
+    }
 
-    PyObject *pair;
-    while ((pair = PyIter_Next(items_iter)) != NULL) {
-        PyObject *key = PyTuple_GET_ITEM(pair, 0);
-        PyObject *val = PyTuple_GET_ITEM(pair, 1);
+    PyObject *keys[WIDTH], *vals[WIDTH];
+    Py_hash_t hashes[WIDTH];
+    int n = 0;
+    int same_as_a = 1;
+    int same_as_b = 1;
+    int as_array = PyObject_TypeCheck(a, &ArrayNodeType) || PyObject_TypeCheck(b, &ArrayNodeType);
 
-        Py_hash_t h = PyObject_Hash(key);
-        if (h == -1 && PyErr_Occurred()) {
-            Py_DECREF(pair);
-            Py_DECREF(items_iter);
-            return NULL;
+    for (int i = 0; i < WIDTH; i++) {
+        PyObject *ka = NULL, *va = NULL, *kb = NULL, *vb = NULL;
+        Py_hash_t ha = 0, hb = 0;
+        int in_a = MapNode_slot(a, i, &ka, &ha, &va);
+        int in_b = MapNode_slot(b, i, &kb, &hb, &vb);
+        PyObject *k = NULL, *v = NULL;
+        Py_hash_t h = 0;
+
+        if (!in_a && !in_b) {
+            vals[i] = NULL;
+            continue;
         }
-
-        PyObject *other_val;
-        if (o->root == NULL) {
-            other_val = _MISSING;
-            Py_INCREF(_MISSING);
-        } else if (PyObject_TypeCheck(o->root, &BitmapIndexedNodeType)) {
-            other_val = BitmapIndexedNode_find((BitmapIndexedNode *)o->root, 0, h, key, _MISSING);
-        } else if (PyObject_TypeCheck(o->root, &ArrayNodeType)) {
-            other_val = ArrayNode_find((ArrayNode *)o->root, 0, h, key, _MISSING);
+        if (!in_b) {
+            k = ka; h = ha; v = va;
+            Py_XINCREF(k);
+            Py_INCREF(v);
+            same_as_b = 0;
+        } else if (!in_a) {
+            k = kb; h = hb; v = vb;
+            Py_XINCREF(k);
+            Py_INCREF(v);
+            *added += kb != NULL ? 1 : MapNode_count(vb);
+            same_as_a = 0;
+        } else if (ka == NULL && kb == NULL) {
+            v = MapNode_merge(va, vb, shift + BITS, f, added);
+        } else if (ka != NULL && kb != NULL) {
+            int eq = 0;
+            if (ha == hb) {
+                eq = PyObject_RichCompareBool(ka, kb, Py_EQ);
+            }
+            if (eq > 0) {
+                k = ka; h = ha;
+                Py_INCREF(k);
+                if (f != NULL) {
+                    v = PyObject_CallFunctionObjArgs(f, va, vb, NULL);
+                    if (!v) Py_CLEAR(k);
+                } else {
+                    v = vb;
+                    Py_INCREF(v);
+                }
+            } else if (eq == 0) {
+                v = create_node(shift + BITS, ha, ka, va, hb, kb, vb, NULL);
+                (*added)++;
+            }
+        } else if (ka != NULL) {
+            int found;
+            v = MapNode_merge_entry(vb, shift + BITS, ha, ka, va, f, 1, &found);
+            *added += MapNode_count(vb) - found;
         } else {
-            other_val = HashCollisionNode_find((HashCollisionNode *)o->root, 0, h, key, _MISSING);
+            int found;
+            v = MapNode_merge_entry(va, shift + BITS, hb, kb, vb, f, 0, &found);
+            if (!found) (*added)++;
         }
 
-        if (!other_val) {
-            Py_DECREF(pair);
-            Py_DECREF(items_iter);
+        if (!v) {
+            for (int j = i; j < WIDTH; j++) vals[j] = NULL;
+            MapNode_clear_slots(keys, vals);
             return NULL;
         }
+        if (k != ka || v != va) same_as_a = 0;
+        if (k != kb || v != vb) same_as_b = 0;
+        keys[i] = k;
+        hashes[i] = h;
+        vals[i] = v;
+        n++;
+    }
 
-        if (other_val == _MISSING) {
-            Py_DECREF(other_val);
-            Py_DECREF(pair);
-            Py_DECREF(items_iter);
-            return PyBool_FromLong(op == Py_NE);
-        }
-
-        int eq = PyObject_RichCompareBool(val, other_val, Py_EQ);
-        Py_DECREF(other_val);
-        Py_DECREF(pair);
-
-        if (eq < 0) {
-            Py_DECREF(items_iter);
-            return NULL;
-        }
-        if (!eq) {
-            Py_DECREF(items_iter);
-            return PyBool_FromLong(op == Py_NE);
-        }
+    PyObject *result;
+    if (same_as_a) {
+        result = a;
+        Py_INCREF(result);
+    } else if (same_as_b) {
+        result = b;
+        Py_INCREF(result);
+    } else {
+        result = MapNode_from_slots(keys, hashes, vals, n, as_array || n > WIDTH / 2, shift);
     }
-    Py_DECREF(items_iter);
+    MapNode_clear_slots(keys, vals);
+    return result;
+}
 
-    if (PyErr_Occurred()) return NULL;
+static PyObject *MapNode_dissoc(PyObject *node, int shift, Py_hash_t hash_val, PyObject *key) {
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_dissoc((BitmapIndexedNode *)node, shift, hash_val, key, NULL, NULL);
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        return ArrayNode_dissoc((ArrayNode *)node, shift, hash_val, key, NULL, NULL);
+    }
+    HashCollisionNode *hcn = (HashCollisionNode *)node;
+    if (hcn->hash != hash_val) {
+        Py_INCREF(node);
+        return node;
+    }
+    return HashCollisionNode_dissoc(hcn, shift, hash_val, key, NULL, NULL);
+}
 
-    return PyBool_FromLong(op == Py_EQ);
+static int MapNode_has_key(PyObject *node, int shift, Py_hash_t hash_val, PyObject *key) {
+    PyObject *found = MapNode_find(node, shift, hash_val, key, _MISSING);
+    if (!found) return -1;
+    int has = found != _MISSING;
+    Py_DECREF(found);
+    return has;
 }
 
-static PyObject *Map_repr(Map *self) {
-    PyObject *parts = PyList_New(0);
-    if (!parts) return NULL;
+// Set algebra on nodes (see MapNode_setop)
+#define SETOP_AND 0
+#define SETOP_SUB 1
+#define SETOP_XOR 2
 
-    PyObject *items_iter = Map_items(self, NULL);
-    if (!items_iter) {
-        Py_DECREF(parts);
-        return NULL;
+// Toggle `key` in `node`: dissoc when present, otherwise assoc
+static PyObject *MapNode_toggle(PyObject *node, int shift, Py_hash_t hash_val, PyObject *key, PyObject *val, int present) {
+    if (present) {
+        return MapNode_dissoc(node, shift, hash_val, key);
     }
+    PyObject *added_leaf = PyList_New(0);
+    if (!added_leaf) return NULL;
+    PyObject *result = MapNode_assoc(node, shift, hash_val, key, val, added_leaf);
+    Py_DECREF(added_leaf);
+    return result;
+}
 
-    PyObject *pair;
-    while ((pair = PyIter_Next(items_iter)) != NULL) {
-        PyObject *key = PyTuple_GET_ITEM(pair, 0);
-        PyObject *val = PyTuple_GET_ITEM(pair, 1);
-
-        PyObject *key_repr = PyObject_Repr(key);
-        PyObject *val_repr = PyObject_Repr(val);
-        Py_DECREF(pair);
+typedef struct {
+    PyObject *acc;    // result so far, EMPTY_BIN when empty
+    PyObject *other;  // node the entries are checked against
+    int shift;
+    int op;
+    Py_ssize_t common;
+} MapNodeSetopState;
+
+static int MapNode_setop_step(MapNodeSetopState *st, PyObject *key, Py_hash_t hash_val, PyObject *val) {
+    int has = MapNode_has_key(st->other, st->shift, hash_val, key);
+    if (has < 0) return -1;
+    st->common += has;
+
+    PyObject *next;
+    if (st->op == SETOP_AND) {
+        if (!has) return 0;
+        next = MapNode_toggle(st->acc, st->shift, hash_val, key, val, 0);
+    } else if (st->op == SETOP_SUB) {
+        if (!has) return 0;
+        next = MapNode_dissoc(st->acc, st->shift, hash_val, key);
+    } else {
+        next = MapNode_toggle(st->acc, st->shift, hash_val, key, val, has);
+    }
+    if (!next) return -1;
+    if (next == Py_None) {
+        Py_DECREF(next);
+        next = (PyObject *)EMPTY_BIN;
+        Py_INCREF(next);
+    }
+    Py_SETREF(st->acc, next);
+    return 0;
+}
 
-        if (!key_repr || !val_repr) {
-            Py_XDECREF(key_repr);
-            Py_XDECREF(val_repr);
-            Py_DECREF(items_iter);
-            Py_DECREF(parts);
-            return NULL;
+static int MapNode_setop_walk(MapNodeSetopState *st, PyObject *node) {
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        Py_ssize_t len = Py_SIZE(bin);
+        for (Py_ssize_t i = 0; i < len; i += 2) {
+            int r = 0;
+            if (bin->array[i] != NULL) {
+                r = MapNode_setop_step(st, bin->array[i], BIN_HASHES(bin)[i / 2], bin->array[i + 1]);
+            } else if (bin->array[i + 1] != NULL) {
+                r = MapNode_setop_walk(st, bin->array[i + 1]);
+            }
+            if (r < 0) return -1;
         }
-
-        PyObject *part = PyUnicode_FromFormat("%U %U", key_repr, val_repr);
-        Py_DECREF(key_repr);
-        Py_DECREF(val_repr);
-
-        if (!part) {
-            Py_DECREF(items_iter);
-            Py_DECREF(parts);
-            return NULL;
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL && MapNode_setop_walk(st, an->array[i]) < 0) return -1;
         }
-
-        if (PyList_Append(parts, part) < 0) {
-            Py_DECREF(part);
-            Py_DECREF(items_iter);
-            Py_DECREF(parts);
-            return NULL;
+    } else {
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        for (int i = 0; i < hcn->count; i++) {
+            if (MapNode_setop_step(st, hcn->array[2 * i], hcn->hash, hcn->array[2 * i + 1]) < 0) return -1;
         }
-        Py_DECREF(part);
     }
-    Py_DECREF(items_iter);
+    return 0;
+}
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(parts);
-        return NULL;
-    }
+// Entry-at-a-time fallback for positions involving a HashCollisionNode.
+// AND collects a's entries found in b; SUB and XOR apply b's entries to a.
+static PyObject *MapNode_setop_entries(PyObject *a, PyObject *b, int shift, int op, Py_ssize_t *common) {
+    MapNodeSetopState st;
+    st.shift = shift;
+    st.op = op;
+    st.common = 0;
+    st.acc = op == SETOP_AND ? (PyObject *)EMPTY_BIN : a;
+    st.other = op == SETOP_AND ? b : a;
+    Py_INCREF(st.acc);
 
-    PyObject *space = PyUnicode_FromString(" ");
-    if (!space) {
-        Py_DECREF(parts);
+    if (MapNode_setop_walk(&st, op == SETOP_AND ? a : b) < 0) {
+        Py_DECREF(st.acc);
         return NULL;
     }
-
-    PyObject *joined = PyUnicode_Join(space, parts);
-    Py_DECREF(space);
-    Py_DECREF(parts);
-    if (!joined) return NULL;
-
-    PyObject *result = PyUnicode_FromFormat("{%U}", joined);
-    Py_DECREF(joined);
-    return result;
+    *common += st.common;
+    if (st.acc == (PyObject *)EMPTY_BIN) {
+        Py_DECREF(st.acc);
+        Py_RETURN_NONE;
+    }
+    return st.acc;
 }
 
-// TransientMap forward declaration
-static PyTypeObject TransientMapType;
-
-static PyObject *Map_transient(Map *self, PyObject *Py_UNUSED(ignored));
-static PyObject *TransientMap_assoc_mut_impl(TransientMap *self, PyObject *key, PyObject *val);
-static PyObject *TransientMap_persistent(TransientMap *self, PyObject *Py_UNUSED(ignored));
-
-static PyObject *Map_to_seq(Map *self, PyObject *Py_UNUSED(ignored)) {
-    if (self->cnt == 0) {
+// Intersection, difference or symmetric difference of the entries below two
+// nodes at `shift`, walking both tries position by position. Positions held by
+// one side are kept or dropped whole, pointer-identical subtrees are never
+// entered, and unchanged nodes are reused. Returns Py_None for an empty result
+// and adds the number of keys found on both sides to *common.
+static PyObject *MapNode_setop(PyObject *a, PyObject *b, int shift, int op, Py_ssize_t *common) {
+    if (a == b) {
+        *common += MapNode_count(a);
+        if (op == SETOP_AND) {
+            Py_INCREF(a);
+            return a;
+        }
         Py_RETURN_NONE;
     }
 
-    // Build Cons list of [k v] vectors
-    PyObject *items_iter = Map_items(self, NULL);
-    if (!items_iter) return NULL;
-
-    PyObject *pairs = PyList_New(0);
-    if (!pairs) {
-        Py_DECREF(items_iter);
-        return NULL;
+    if (PyObject_TypeCheck(a, &HashCollisionNodeType) || PyObject_TypeCheck(b, &HashCollisionNodeType)) {
+        return MapNode_setop_entries(a, b, shift, op, common);
     }
 
-    PyObject *pair;
-    while ((pair = PyIter_Next(items_iter)) != NULL) {
-        PyObject *key = PyTuple_GET_ITEM(pair, 0);
-        PyObject *val = PyTuple_GET_ITEM(pair, 1);
-
-        // Create Vector [key, val]
-        Vector *kv = (Vector *)VectorType.tp_alloc(&VectorType, 0);
-        if (!kv) {
-            Py_DECREF(pair);
-            Py_DECREF(items_iter);
-            Py_DECREF(pairs);
-            return NULL;
-        }
-        kv->cnt = 2;
-        kv->shift = BITS;
-        kv->root = EMPTY_NODE;
-        Py_INCREF(EMPTY_NODE);
-        kv->tail = PyTuple_Pack(2, key, val);
-        kv->hash = 0;
-        kv->hash_computed = 0;
-        kv->transient_id = NULL;
-
-        Py_DECREF(pair);
+    PyObject *keys[WIDTH];
+    PyObject *vals[WIDTH] = {NULL};
+    Py_hash_t hashes[WIDTH];
+    int n = 0;
+    int same_as_a = 1;
+    int same_as_b = 1;
 
-        if (!kv->tail) {
-            Py_DECREF(kv);
-            Py_DECREF(items_iter);
-            Py_DECREF(pairs);
-            return NULL;
+    for (int i = 0; i < WIDTH; i++) {
+        PyObject *ka = NULL, *va = NULL, *kb = NULL, *vb = NULL;
+        Py_hash_t ha = 0, hb = 0;
+        int in_a = MapNode_slot(a, i, &ka, &ha, &va);
+        int in_b = MapNode_slot(b, i, &kb, &hb, &vb);
+        PyObject *k = NULL, *v = NULL;
+        Py_hash_t h = 0;
+        int has = 0;
+
+        if (!in_a && !in_b) continue;
+
+        if (!in_a || !in_b) {
+            int keep = op == SETOP_XOR || (op == SETOP_SUB && in_a);
+            if (keep) {
+                k = in_a ? ka : kb;
+                h = in_a ? ha : hb;
+                v = in_a ? va : vb;
+                Py_XINCREF(k);
+                Py_INCREF(v);
+            }
+        } else if (ka != NULL && kb != NULL) {
+            if (ha == hb) {
+                has = PyObject_RichCompareBool(ka, kb, Py_EQ);
+                if (has < 0) goto error;
+            }
+            if (has == (op == SETOP_AND)) {
+                if (op == SETOP_XOR) {
+                    v = create_node(shift + BITS, ha, ka, va, hb, kb, vb, NULL);
+                    if (!v) goto error;
+                } else {
+                    k = ka; h = ha; v = va;
+                    Py_INCREF(k);
+                    Py_INCREF(v);
+                }
+            }
+        } else if (ka != NULL) {
+            has = MapNode_has_key(vb, shift + BITS, ha, ka);
+            if (has < 0) goto error;
+            if (op == SETOP_XOR) {
+                v = MapNode_toggle(vb, shift + BITS, ha, ka, va, has);
+                if (!v) goto error;
+            } else if (has == (op == SETOP_AND)) {
+                k = ka; h = ha; v = va;
+                Py_INCREF(k);
+                Py_INCREF(v);
+            }
+        } else if (kb != NULL) {
+            has = MapNode_has_key(va, shift + BITS, hb, kb);
+            if (has < 0) goto error;
+            if (op == SETOP_AND) {
+                if (has) {
+                    k = kb; h = hb; v = vb;
+                    Py_INCREF(k);
+                    Py_INCREF(v);
+                }
+            } else if (op == SETOP_SUB && !has) {
+                v = va;
+                Py_INCREF(v);
+            } else {
+                v = MapNode_toggle(va, shift + BITS, hb, kb, vb, has);
+                if (!v) goto error;
+            }
+        } else {
+            v = MapNode_setop(va, vb, shift + BITS, op, common);
+            if (!v) goto error;
         }
-
-        if (PyList_Append(pairs, (PyObject *)kv) < 0) {
-            Py_DECREF(kv);
-            Py_DECREF(items_iter);
-            Py_DECREF(pairs);
-            return NULL;
+        *common += has;
+
+        if (k == NULL && v == Py_None) {
+            // Empty child (set elements themselves hold None as their value)
+            Py_CLEAR(v);
+        } else if (k == NULL && v != NULL && v != va && v != vb && PyObject_TypeCheck(v, &BitmapIndexedNodeType)
+                   && Py_SIZE(v) == 2 && ((BitmapIndexedNode *)v)->array[0] != NULL) {
+            // Pull a child that shrank to one key back up into this slot
+            BitmapIndexedNode *child = (BitmapIndexedNode *)v;
+            k = child->array[0];
+            h = BIN_HASHES(child)[0];
+            v = child->array[1];
+            Py_INCREF(k);
+            Py_INCREF(v);
+            Py_DECREF(child);
         }
-        Py_DECREF(kv);
-    }
-    Py_DECREF(items_iter);
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(pairs);
+        if (in_a ? (k != ka || v != va) : v != NULL) same_as_a = 0;
+        if (in_b ? (k != kb || v != vb) : v != NULL) same_as_b = 0;
+        if (v == NULL) continue;
+        keys[i] = k;
+        hashes[i] = h;
+        vals[i] = v;
+        n++;
+        continue;
+
+    error:
+        MapNode_clear_slots(keys, vals);
         return NULL;
     }
 
-    // Build Cons list in reverse
-    Cons *result = NULL;
-    for (Py_ssize_t i = PyList_Size(pairs) - 1; i >= 0; i--) {
-        PyObject *item = PyList_GET_ITEM(pairs, i);
-        Cons *new_cons = (Cons *)ConsType.tp_alloc(&ConsType, 0);
-        if (!new_cons) {
-            Py_XDECREF(result);
-            Py_DECREF(pairs);
-            return NULL;
-        }
+    PyObject *result;
+    if (n == 0) {
+        result = Py_None;
+        Py_INCREF(result);
+    } else if (same_as_a) {
+        result = a;
+        Py_INCREF(result);
+    } else if (same_as_b) {
+        result = b;
+        Py_INCREF(result);
+    } else {
+        result = MapNode_from_slots(keys, hashes, vals, n, n > WIDTH / 2, shift);
+    }
+    MapNode_clear_slots(keys, vals);
+    return result;
+}
 
-        Py_INCREF(item);
-        new_cons->first = item;
-        new_cons->rest = result ? (PyObject *)result : Py_None;
-        Py_INCREF(new_cons->rest);
-        new_cons->hash = 0;
-        new_cons->hash_computed = 0;
+// === ArrayMapNode operations ===
 
-        result = new_cons;
+// Trie root for the entries of self, plus extra_key when it is not NULL (a key
+// not among them). Stored hashes are reused, so no key is hashed again.
+static PyObject *ArrayMapNode_promote(ArrayMapNode *self, PyObject *extra_key, Py_hash_t extra_hash, PyObject *extra_val) {
+    MapBuildEntry e[ARRAY_MAP_MAX + 1], tmp[ARRAY_MAP_MAX + 1];
+    Py_ssize_t n = Py_SIZE(self), cnt;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        e[i].hash = AMN_HASHES(self)[i];
+        e[i].key = self->array[2 * i];
+        e[i].val = self->array[2 * i + 1];
     }
-
-    Py_DECREF(pairs);
-    return (PyObject *)result;
+    if (extra_key != NULL) {
+        e[n].hash = extra_hash;
+        e[n].key = extra_key;
+        e[n].val = extra_val;
+        n++;
+    }
+    return MapNode_build(e, tmp, n, 0, &cnt);
 }
 
-// Map merge operation (|)
-static PyObject *Map_or(PyObject *left, PyObject *right) {
-    if (!PyObject_TypeCheck(left, &MapType)) {
-        Py_RETURN_NOTIMPLEMENTED;
+// Copy of self (NULL for an empty map) with key set to val, promoted to a trie
+// past ARRAY_MAP_MAX entries. h is the key's hash, or -1 if not yet computed.
+// Sets *added for a new key; returns self when the key already maps to val.
+static PyObject *ArrayMapNode_assoc(ArrayMapNode *self, PyObject *key, Py_hash_t h, PyObject *val, int *added) {
+    Py_ssize_t count = self ? Py_SIZE(self) : 0;
+    Py_ssize_t idx = -1;
+    if (self) {
+        idx = h == -1 ? ArrayMapNode_index(self, key, &h) : ArrayMapNode_index_hashed(self, h, key);
+        if (idx == -2) return NULL;
+    } else if (h == -1) {
+        h = PyObject_Hash(key);
+        if (h == -1 && PyErr_Occurred()) return NULL;
     }
-    Map *self = (Map *)left;
 
-    // If right is empty, return self
-    if (PyObject_TypeCheck(right, &MapType)) {
-        Map *other = (Map *)right;
-        if (other->cnt == 0) {
+    if (idx >= 0) {
+        if (self->array[2 * idx + 1] == val) {
             Py_INCREF(self);
             return (PyObject *)self;
         }
-        if (self->cnt == 0) {
-            Py_INCREF(other);
-            return (PyObject *)other;
+        ArrayMapNode *node = ArrayMapNode_create(count);
+        if (!node) return NULL;
+        PDS_STAT_COPY(PDS_NODE_ARRAY_MAP);
+        for (Py_ssize_t i = 0; i < 2 * count; i++) {
+            node->array[i] = i == 2 * idx + 1 ? val : self->array[i];
+            Py_INCREF(node->array[i]);
         }
+        memcpy(AMN_HASHES(node), AMN_HASHES(self), count * sizeof(Py_hash_t));
+        return (PyObject *)node;
     }
 
-    // Create transient from self via direct C call
-    TransientMap *t = (TransientMap *)Map_transient(self, NULL);
-    if (!t) return NULL;
+    *added = 1;
+    if (count == ARRAY_MAP_MAX) {
+        return ArrayMapNode_promote(self, key, h, val);
+    }
 
-    // Get items iterator for right
-    PyObject *items_iter;
+    // After every entry that does not follow it in trie order
+    Py_ssize_t pos = count;
+    while (pos > 0 && hash_precedes(h, AMN_HASHES(self)[pos - 1])) pos--;
 
-    if (PyObject_TypeCheck(right, &MapType)) {
-        // Fast internal iterator for Map
-        items_iter = Map_items((Map *)right, NULL);
-    } else if (PyDict_Check(right)) {
-        // Fast path for Python dicts
-        items_iter = PyObject_CallMethod(right, "items", NULL);
-        if (items_iter) {
-            PyObject *temp = PyObject_GetIter(items_iter);
-            Py_DECREF(items_iter);
-            items_iter = temp;
+    ArrayMapNode *node = ArrayMapNode_create(count + 1);
+    if (!node) return NULL;
+    if (self) PDS_STAT_COPY(PDS_NODE_ARRAY_MAP);
+    Py_hash_t *hashes = AMN_HASHES(node);
+    for (Py_ssize_t i = 0, j = 0; i <= count; i++) {
+        if (i == pos) {
+            node->array[2 * i] = key;
+            node->array[2 * i + 1] = val;
+            hashes[i] = h;
+        } else {
+            node->array[2 * i] = self->array[2 * j];
+            node->array[2 * i + 1] = self->array[2 * j + 1];
+            hashes[i] = AMN_HASHES(self)[j];
+            j++;
         }
-    } else if (PyObject_HasAttrString(right, "items")) {
-        // Generic mapping with .items() method (but not lists, etc.)
-        PyObject *items_method = PyObject_GetAttrString(right, "items");
-        if (!items_method) {
-            Py_DECREF(t);
-            return NULL;
+        Py_INCREF(node->array[2 * i]);
+        Py_INCREF(node->array[2 * i + 1]);
+    }
+    return (PyObject *)node;
+}
+
+// Copy of self without key: self when it is absent, Py_None when it was the last entry
+static PyObject *ArrayMapNode_dissoc(ArrayMapNode *self, PyObject *key) {
+    Py_hash_t h;
+    Py_ssize_t idx = ArrayMapNode_index(self, key, &h);
+    if (idx == -2) return NULL;
+    if (idx == -1) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_ssize_t count = Py_SIZE(self);
+    if (count == 1) {
+        Py_RETURN_NONE;
+    }
+    ArrayMapNode *node = ArrayMapNode_create(count - 1);
+    if (!node) return NULL;
+    PDS_STAT_COPY(PDS_NODE_ARRAY_MAP);
+    Py_hash_t *hashes = AMN_HASHES(node);
+    for (Py_ssize_t i = 0, j = 0; i < count; i++) {
+        if (i == idx) continue;
+        node->array[2 * j] = self->array[2 * i];
+        node->array[2 * j + 1] = self->array[2 * i + 1];
+        Py_INCREF(node->array[2 * j]);
+        Py_INCREF(node->array[2 * j + 1]);
+        hashes[j++] = AMN_HASHES(self)[i];
+    }
+    return (PyObject *)node;
+}
+
+// Append the entries below a trie node to dst from pair *n on, in iteration order
+static void ArrayMapNode_collect(ArrayMapNode *dst, PyObject *node, Py_ssize_t *n) {
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(bin); i += 2) {
+            if (bin->array[i] != NULL) {
+                dst->array[2 * *n] = bin->array[i];
+                dst->array[2 * *n + 1] = bin->array[i + 1];
+                Py_INCREF(bin->array[i]);
+                Py_INCREF(bin->array[i + 1]);
+                AMN_HASHES(dst)[(*n)++] = BIN_HASHES(bin)[i / 2];
+            } else if (bin->array[i + 1] != NULL) {
+                ArrayMapNode_collect(dst, bin->array[i + 1], n);
+            }
         }
-        items_iter = PyObject_CallObject(items_method, NULL);
-        Py_DECREF(items_method);
-        if (items_iter) {
-            PyObject *temp = PyObject_GetIter(items_iter);
-            Py_DECREF(items_iter);
-            items_iter = temp;
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL) ArrayMapNode_collect(dst, an->array[i], n);
         }
     } else {
-        // Fallback: assume iterable of pairs (e.g., list of tuples)
-        items_iter = PyObject_GetIter(right);
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        for (int i = 0; i < hcn->count; i++) {
+            dst->array[2 * *n] = hcn->array[2 * i];
+            dst->array[2 * *n + 1] = hcn->array[2 * i + 1];
+            Py_INCREF(hcn->array[2 * i]);
+            Py_INCREF(hcn->array[2 * i + 1]);
+            AMN_HASHES(dst)[(*n)++] = hcn->hash;
+        }
     }
+}
 
-    if (!items_iter) {
-        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
-            PyErr_Clear();
-            Py_DECREF(t);
-            Py_RETURN_NOTIMPLEMENTED;
+// Array-map copy of a trie root holding cnt <= ARRAY_MAP_MAX entries
+static PyObject *ArrayMapNode_demote(PyObject *root, Py_ssize_t cnt) {
+    ArrayMapNode *node = ArrayMapNode_create(cnt);
+    if (!node) return NULL;
+    Py_ssize_t n = 0;
+    ArrayMapNode_collect(node, root, &n);
+    return (PyObject *)node;
+}
+
+// Array-map root from n <= ARRAY_MAP_MAX owned entries, which are released
+// here. Like MapBuild_root, a repeated key keeps its first key object and its
+// last value; returns NULL without an error for n == 0.
+static PyObject *ArrayMapNode_build(MapBuildEntry *e, Py_ssize_t n, Py_ssize_t *cnt) {
+    MapBuildEntry out[ARRAY_MAP_MAX];
+    Py_ssize_t d = 0;
+    ArrayMapNode *node = NULL;
+    *cnt = 0;
+
+    for (Py_ssize_t i = 0; i < n; i++) {
+        Py_ssize_t j = 0;
+        for (; j < d; j++) {
+            if (out[j].hash != e[i].hash) continue;
+            int eq = out[j].key == e[i].key ? 1 : PyObject_RichCompareBool(out[j].key, e[i].key, Py_EQ);
+            if (eq < 0) goto done;
+            if (eq) break;
+        }
+        if (j < d) {
+            out[j].val = e[i].val;
+            continue;
+        }
+        Py_ssize_t pos = d;
+        while (pos > 0 && hash_precedes(e[i].hash, out[pos - 1].hash)) pos--;
+        memmove(out + pos + 1, out + pos, (d - pos) * sizeof(MapBuildEntry));
+        out[pos] = e[i];
+        d++;
+    }
+
+    *cnt = d;
+    if (d > 0 && (node = ArrayMapNode_create(d)) != NULL) {
+        for (Py_ssize_t i = 0; i < d; i++) {
+            node->array[2 * i] = out[i].key;
+            node->array[2 * i + 1] = out[i].val;
+            Py_INCREF(out[i].key);
+            Py_INCREF(out[i].val);
+            AMN_HASHES(node)[i] = out[i].hash;
         }
-        Py_DECREF(t);
-        return NULL;
     }
 
-    PyObject *item;
-    while ((item = PyIter_Next(items_iter)) != NULL) {
-        PyObject *key, *val;
+done:
+    MapBuild_clear(e, n);
+    return (PyObject *)node;
+}
 
-        // Handle tuples, lists, Vectors, and other sequences
-        if (PyTuple_Check(item) && PyTuple_GET_SIZE(item) == 2) {
-            key = PyTuple_GET_ITEM(item, 0);
-            val = PyTuple_GET_ITEM(item, 1);
-        } else if (PyList_Check(item) && PyList_GET_SIZE(item) == 2) {
-            key = PyList_GET_ITEM(item, 0);
-            val = PyList_GET_ITEM(item, 1);
-        } else if (PyObject_TypeCheck(item, &VectorType)) {
-            // Handle our Vector type directly using internal C API
-            Vector *vec = (Vector *)item;
-            if (vec->cnt != 2) {
-                PyErr_SetString(PyExc_ValueError, "Map merge requires (key, value) pairs");
-                Py_DECREF(item);
-                Py_DECREF(items_iter);
-                Py_DECREF(t);
-                return NULL;
-            }
-            key = Vector_nth_impl(vec, 0, NULL);
-            val = Vector_nth_impl(vec, 1, NULL);
-            if (!key || !val) {
-                Py_XDECREF(key);
-                Py_XDECREF(val);
-                Py_DECREF(item);
-                Py_DECREF(items_iter);
-                Py_DECREF(t);
-                return NULL;
-            }
-            PyObject *res = TransientMap_assoc_mut_impl(t, key, val);
-            Py_DECREF(key);
-            Py_DECREF(val);
-            Py_DECREF(item);
-            if (!res) {
-                Py_DECREF(items_iter);
-                Py_DECREF(t);
-                return NULL;
-            }
-            Py_DECREF(res);
-            continue;
-        } else if (PySequence_Check(item) && PySequence_Size(item) == 2) {
-            key = PySequence_GetItem(item, 0);
-            val = PySequence_GetItem(item, 1);
-            if (!key || !val) {
-                Py_XDECREF(key);
-                Py_XDECREF(val);
-                Py_DECREF(item);
-                Py_DECREF(items_iter);
-                Py_DECREF(t);
-                return NULL;
-            }
-            // Use impl and then decref the borrowed refs
-            PyObject *res = TransientMap_assoc_mut_impl(t, key, val);
-            Py_DECREF(key);
-            Py_DECREF(val);
-            Py_DECREF(item);
-            if (!res) {
-                Py_DECREF(items_iter);
-                Py_DECREF(t);
-                return NULL;
-            }
-            Py_DECREF(res);
-            continue;
-        } else {
-            PyErr_SetString(PyExc_ValueError, "Map merge requires (key, value) pairs");
-            Py_DECREF(item);
-            Py_DECREF(items_iter);
-            Py_DECREF(t);
-            return NULL;
+// === Hashed pickling ===
+// From protocol 2 on, Map and Set pickle as their entries in iteration order
+// plus one little-endian int64 key hash per entry, for _map_from_hashed and
+// _set_from_hashed to rebuild the same trie in bulk. Stored hashes are used
+// only when the loading process hashes strings the same way (see
+// pds_hash_fingerprint) and only for keys whose hash follows from their
+// value; any other key, such as an object hashed by identity, is hashed again.
+
+#define PDS_VALUE_HASH_TYPES_MAX 16
+
+// Types added through register_value_hash
+static PyTypeObject *pds_value_hash_types[PDS_VALUE_HASH_TYPES_MAX];
+static int pds_value_hash_ntypes = 0;
+
+// Hash of a fixed string: two processes agree on it exactly when their str
+// and bytes hashes agree (same hash seed and hash width)
+static Py_hash_t pds_hash_fingerprint(void) {
+    static Py_hash_t fingerprint = -1;
+    if (fingerprint == -1) {
+        PyObject *probe = PyUnicode_FromString("spork.runtime.pds");
+        if (probe == NULL) return -1;
+        fingerprint = PyObject_Hash(probe);
+        Py_DECREF(probe);
+    }
+    return fingerprint;
+}
+
+// 1 if key hashes the same in every process with the same fingerprint: str,
+// bytes, int, bool, non-NaN floats, tuples of these, and registered types
+static int pds_value_hashed(PyObject *key) {
+    PyTypeObject *t = Py_TYPE(key);
+    if (t == &PyUnicode_Type || t == &PyLong_Type || t == &PyBool_Type || t == &PyBytes_Type) {
+        return 1;
+    }
+    if (t == &PyFloat_Type) {
+        return !isnan(PyFloat_AS_DOUBLE(key));  // NaN hashes by identity
+    }
+    if (t == &PyTuple_Type) {
+        for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(key); i++) {
+            if (!pds_value_hashed(PyTuple_GET_ITEM(key, i))) return 0;
         }
+        return 1;
+    }
+    for (int i = 0; i < pds_value_hash_ntypes; i++) {
+        if (t == pds_value_hash_types[i]) return 1;
+    }
+    return 0;
+}
 
-        // OPTIMIZATION: Call internal C function directly
-        PyObject *res = TransientMap_assoc_mut_impl(t, key, val);
-        Py_DECREF(item);
-        if (!res) {
-            Py_DECREF(items_iter);
-            Py_DECREF(t);
-            return NULL;
+static inline void MapNode_dump_entry(PyObject *items, char *hashes, int keys_only, Py_ssize_t *n,
+                                      PyObject *key, PyObject *val, Py_hash_t h) {
+    int64_t h64 = h;
+    le64_copy(hashes + 8 * *n, (const char *)&h64, 1);
+    Py_INCREF(key);
+    if (keys_only) {
+        PyTuple_SET_ITEM(items, *n, key);
+    } else {
+        Py_INCREF(val);
+        PyTuple_SET_ITEM(items, 2 * *n, key);
+        PyTuple_SET_ITEM(items, 2 * *n + 1, val);
+    }
+    (*n)++;
+}
+
+// Store the entries below node from entry *n on, in iteration order: keys,
+// or keys and values, into the tuple items and key hashes into hashes
+static void MapNode_dump(PyObject *node, PyObject *items, char *hashes, int keys_only, Py_ssize_t *n) {
+    if (is_array_map(node)) {
+        ArrayMapNode *amn = (ArrayMapNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(amn); i++) {
+            MapNode_dump_entry(items, hashes, keys_only, n, amn->array[2 * i], amn->array[2 * i + 1],
+                               AMN_HASHES(amn)[i]);
+        }
+    } else if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(bin); i += 2) {
+            if (bin->array[i] != NULL) {
+                MapNode_dump_entry(items, hashes, keys_only, n, bin->array[i], bin->array[i + 1],
+                                   BIN_HASHES(bin)[i / 2]);
+            } else if (bin->array[i + 1] != NULL) {
+                MapNode_dump(bin->array[i + 1], items, hashes, keys_only, n);
+            }
+        }
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL) MapNode_dump(an->array[i], items, hashes, keys_only, n);
+        }
+    } else {
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        for (int i = 0; i < hcn->count; i++) {
+            MapNode_dump_entry(items, hashes, keys_only, n, hcn->array[2 * i], hcn->array[2 * i + 1], hcn->hash);
         }
-        Py_DECREF(res);
     }
+}
 
-    Py_DECREF(items_iter);
+// (reconstructor, (fingerprint, hashes, items)) for a Map or Set root of cnt entries
+static PyObject *MapNode_reduce_hashed(PyObject *root, Py_ssize_t cnt, int keys_only, long protocol) {
+    Py_hash_t fingerprint = pds_hash_fingerprint();
+    if (fingerprint == -1) return NULL;
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(t);
+    PyObject *items = PyTuple_New(keys_only ? cnt : 2 * cnt);
+    PyObject *hashes = PyBytes_FromStringAndSize(NULL, 8 * cnt);
+    if (items == NULL || hashes == NULL) {
+        Py_XDECREF(items);
+        Py_XDECREF(hashes);
         return NULL;
     }
+    Py_ssize_t n = 0;
+    if (root != NULL) MapNode_dump(root, items, PyBytes_AS_STRING(hashes), keys_only, &n);
 
-    PyObject *result = TransientMap_persistent(t, NULL);
-    Py_DECREF(t);
-    return result;
+    hashes = pickle_payload(hashes, protocol);
+    PyObject *fn = hashes ? pds_module_function(keys_only ? "_set_from_hashed" : "_map_from_hashed") : NULL;
+    if (fn == NULL) {
+        Py_XDECREF(hashes);
+        Py_DECREF(items);
+        return NULL;
+    }
+    return Py_BuildValue("(N(nNN))", fn, fingerprint, hashes, items);
 }
 
-static PyNumberMethods Map_as_number = {
-    .nb_or = (binaryfunc)Map_or,
-};
+// === Map ===
+typedef struct Map {
+    PyObject_HEAD
+    Py_ssize_t cnt;
+    PyObject *root;  // ArrayMapNode, BitmapIndexedNode, ArrayNode, or HashCollisionNode
+    Py_hash_t hash;
+    int hash_computed;
+    PyObject *transient_id;
+} Map;
 
-/* Map.copy() - returns self since Map is immutable */
-static PyObject *Map_copy(Map *self, PyObject *Py_UNUSED(ignored)) {
-    Py_INCREF(self);
+static PyTypeObject MapType;
+static Map *EMPTY_MAP = NULL;
+
+static void Map_dealloc(Map *self) {
+    Py_XDECREF(self->root);
+    Py_XDECREF(self->transient_id);
+    pds_recycle(PDS_FL(map), (PyObject *)self, &MapType);
+}
+
+static PyObject *Map_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    Map *self = (Map *)type->tp_alloc(type, 0);
+    if (self != NULL) {
+        self->cnt = 0;
+        self->root = NULL;
+        self->hash = 0;
+        self->hash_computed = 0;
+        self->transient_id = NULL;
+    }
     return (PyObject *)self;
 }
 
-// Forward declaration for hash_map function used by Map_reduce
-static PyObject *pds_hash_map(PyObject *self, PyObject *args);
+static Map *Map_create(Py_ssize_t cnt, PyObject *root, PyObject *transient_id) {
+    Map *m = (Map *)pds_alloc(PDS_FL(map), &MapType);
+    if (!m) return NULL;
 
-static PyObject *Map_reduce(Map *self, PyObject *Py_UNUSED(ignored)) {
-    // Build a tuple of (k1, v1, k2, v2, ...) for hash_map reconstructor
-    PyObject *args = PyTuple_New(self->cnt * 2);
-    if (args == NULL) {
-        return NULL;
+    m->cnt = cnt;
+    m->root = root;
+    Py_XINCREF(root);
+    m->hash = 0;
+    m->hash_computed = 0;
+    m->transient_id = transient_id;
+    Py_XINCREF(transient_id);
+
+    return m;
+}
+
+// Map over a trie root (borrowed), switching to an array map when it is small
+static PyObject *Map_from_trie(Py_ssize_t cnt, PyObject *root) {
+    if (root == NULL || cnt > ARRAY_MAP_MAX || is_array_map(root)) {
+        return (PyObject *)Map_create(cnt, root, NULL);
     }
+    PyObject *small = ArrayMapNode_demote(root, cnt);
+    if (!small) return NULL;
+    Map *m = Map_create(cnt, small, NULL);
+    Py_DECREF(small);
+    return (PyObject *)m;
+}
 
-    // Iterate over items and flatten into the args tuple
-    PyObject *items_iter = Map_items(self, NULL);
-    if (items_iter == NULL) {
-        Py_DECREF(args);
+// Map from n owned build entries, which are released here
+static PyObject *Map_build(MapBuildEntry *e, Py_ssize_t n) {
+    Py_ssize_t cnt;
+    PyObject *root = n <= ARRAY_MAP_MAX ? ArrayMapNode_build(e, n, &cnt) : MapBuild_root(e, n, &cnt);
+    if (!root) {
+        if (PyErr_Occurred()) return NULL;
+        Py_INCREF(EMPTY_MAP);
+        return (PyObject *)EMPTY_MAP;
+    }
+    Map *m = Map_create(cnt, root, NULL);
+    Py_DECREF(root);
+    return (PyObject *)m;
+}
+
+static Py_ssize_t Map_length(Map *self) {
+    return self->cnt;
+}
+
+static PyObject *Map_get(Map *self, PyObject *args) {
+    PyObject *key;
+    PyObject *default_val = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key, &default_val)) {
         return NULL;
     }
 
-    Py_ssize_t i = 0;
-    PyObject *item;
-    while ((item = PyIter_Next(items_iter)) != NULL) {
-        PyObject *key = PyTuple_GET_ITEM(item, 0);
-        PyObject *val = PyTuple_GET_ITEM(item, 1);
-        Py_INCREF(key);
-        Py_INCREF(val);
-        PyTuple_SET_ITEM(args, i * 2, key);
-        PyTuple_SET_ITEM(args, i * 2 + 1, val);
-        Py_DECREF(item);
-        i++;
+    if (self->root == NULL) {
+        Py_INCREF(default_val);
+        return default_val;
+    }
+    if (is_array_map(self->root)) {
+        return ArrayMapNode_find((ArrayMapNode *)self->root, key, default_val);
     }
-    Py_DECREF(items_iter);
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(args);
-        return NULL;
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, default_val);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_find((ArrayNode *)self->root, 0, h, key, default_val);
+    } else {
+        return HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, default_val);
     }
+}
 
-    // Get the hash_map function from the pds module
-    PyObject *pds_module = PyImport_ImportModule("spork.runtime.pds");
-    if (pds_module == NULL) {
-        Py_DECREF(args);
+static PyObject *Map_getitem(Map *self, PyObject *key) {
+    if (self->root == NULL) {
+        PyErr_SetObject(PyExc_KeyError, key);
         return NULL;
     }
 
-    PyObject *hash_map_func = PyObject_GetAttrString(pds_module, "hash_map");
-    Py_DECREF(pds_module);
-    if (hash_map_func == NULL) {
-        Py_DECREF(args);
+    PyObject *result;
+    if (is_array_map(self->root)) {
+        result = ArrayMapNode_find((ArrayMapNode *)self->root, key, _MISSING);
+    } else {
+        Py_hash_t h = PyObject_Hash(key);
+        if (h == -1 && PyErr_Occurred()) return NULL;
+
+        if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+            result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
+        } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+            result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
+        } else {
+            result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+        }
+    }
+
+    if (!result) return NULL;
+
+    if (result == _MISSING) {
+        Py_DECREF(result);
+        PyErr_SetObject(PyExc_KeyError, key);
         return NULL;
     }
 
-    // Return (hash_map, args_tuple) - pickle will call hash_map(*args_tuple)
-    PyObject *result = PyTuple_Pack(2, hash_map_func, args);
-    Py_DECREF(hash_map_func);
-    Py_DECREF(args);
     return result;
 }
 
-static PyMethodDef Map_methods[] = {
-    {"get", (PyCFunction)Map_get, METH_VARARGS, "Get value for key"},
-    {"assoc", (PyCFunction)Map_assoc, METH_VARARGS, "Set key to value"},
-    {"dissoc", (PyCFunction)Map_dissoc, METH_O, "Remove key"},
-    {"items", (PyCFunction)Map_items, METH_NOARGS, "Iterate over key-value pairs"},
-    {"keys", (PyCFunction)Map_keys, METH_NOARGS, "Iterate over keys"},
-    {"values", (PyCFunction)Map_values, METH_NOARGS, "Iterate over values"},
-    {"transient", (PyCFunction)Map_transient, METH_NOARGS, "Get transient version"},
-    {"to_seq", (PyCFunction)Map_to_seq, METH_NOARGS, "Convert to Cons sequence"},
-    {"copy", (PyCFunction)Map_copy, METH_NOARGS, "Return self (immutable maps don't need copying)"},
-    {"__reduce__", (PyCFunction)Map_reduce, METH_NOARGS, "Pickle support"},
-    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
-     "Return a generic alias for type annotations (e.g., Map[str, int])"},
+static int Map_contains(Map *self, PyObject *key) {
+    if (self->root == NULL) {
+        return 0;
+    }
+
+    PyObject *result;
+    if (is_array_map(self->root)) {
+        result = ArrayMapNode_find((ArrayMapNode *)self->root, key, _MISSING);
+    } else {
+        Py_hash_t h = PyObject_Hash(key);
+        if (h == -1 && PyErr_Occurred()) return -1;
+
+        if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+            result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
+        } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+            result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
+        } else {
+            result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+        }
+    }
+
+    if (!result) return -1;
+
+    int found = (result != _MISSING);
+    Py_DECREF(result);
+    return found;
+}
+
+// Copy of self with key set to val; h is the key's hash, or -1 if not yet computed
+static PyObject *Map_assoc_impl(Map *self, PyObject *key, Py_hash_t h, PyObject *val) {
+    if (self->root == NULL || is_array_map(self->root)) {
+        int added = 0;
+        PyObject *new_root = ArrayMapNode_assoc((ArrayMapNode *)self->root, key, h, val, &added);
+        if (!new_root) return NULL;
+        if (new_root == self->root) {
+            Py_DECREF(new_root);
+            Py_INCREF(self);
+            return (PyObject *)self;
+        }
+        Map *result = Map_create(self->cnt + added, new_root, self->transient_id);
+        Py_DECREF(new_root);
+        return (PyObject *)result;
+    }
+
+    if (h == -1) {
+        h = PyObject_Hash(key);
+        if (h == -1 && PyErr_Occurred()) return NULL;
+    }
+
+    PyObject *added_leaf = PyList_New(0);
+    if (!added_leaf) return NULL;
+
+    PyObject *root = self->root ? self->root : (PyObject *)EMPTY_BIN;
+    PyObject *new_root;
+
+    if (PyObject_TypeCheck(root, &BitmapIndexedNodeType)) {
+        new_root = BitmapIndexedNode_assoc((BitmapIndexedNode *)root, 0, h, key, val, added_leaf, self->transient_id);
+    } else if (PyObject_TypeCheck(root, &ArrayNodeType)) {
+        new_root = ArrayNode_assoc((ArrayNode *)root, 0, h, key, val, added_leaf, self->transient_id);
+    } else {
+        new_root = HashCollisionNode_assoc((HashCollisionNode *)root, 0, h, key, val, added_leaf, self->transient_id);
+    }
+
+    if (!new_root) {
+        Py_DECREF(added_leaf);
+        return NULL;
+    }
+
+    if (new_root == self->root) {
+        Py_DECREF(new_root);
+        Py_DECREF(added_leaf);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_ssize_t new_cnt = self->cnt + PyList_Size(added_leaf);
+    Py_DECREF(added_leaf);
+
+    Map *result = Map_create(new_cnt, new_root, self->transient_id);
+    Py_DECREF(new_root);
+    return (PyObject *)result;
+}
+
+static PyObject *Map_assoc(Map *self, PyObject *args) {
+    PyObject *key, *val;
+
+    if (!PyArg_ParseTuple(args, "OO", &key, &val)) {
+        return NULL;
+    }
+    return Map_assoc_impl(self, key, -1, val);
+}
+
+static PyObject *Map_dissoc(Map *self, PyObject *key) {
+    if (self->root == NULL) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    PyObject *new_root;
+    if (is_array_map(self->root)) {
+        new_root = ArrayMapNode_dissoc((ArrayMapNode *)self->root, key);
+    } else {
+        Py_hash_t h = PyObject_Hash(key);
+        if (h == -1 && PyErr_Occurred()) return NULL;
+
+        if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+            new_root = BitmapIndexedNode_dissoc((BitmapIndexedNode *)self->root, 0, h, key, NULL, self->transient_id);
+        } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+            new_root = ArrayNode_dissoc((ArrayNode *)self->root, 0, h, key, NULL, self->transient_id);
+        } else {
+            new_root = HashCollisionNode_dissoc((HashCollisionNode *)self->root, 0, h, key, NULL, self->transient_id);
+        }
+    }
+
+    if (!new_root) return NULL;
+
+    if (new_root == self->root) {
+        Py_DECREF(new_root);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_ssize_t new_cnt = (new_root != Py_None) ? self->cnt - 1 : 0;
+    if (new_root == Py_None) {
+        Py_DECREF(new_root);
+        new_root = NULL;
+    }
+
+    Map *result = Map_create(new_cnt, new_root, self->transient_id);
+    Py_XDECREF(new_root);
+    return (PyObject *)result;
+}
+
+static PyObject *Map_iter(Map *self) {
+    if (self->root == NULL) {
+        return PyObject_GetIter(PyList_New(0));
+    }
+
+    // Get a key-only iterator directly (no tuple allocation)
+    if (is_array_map(self->root)) {
+        return ArrayMapNode_iter_mode((ArrayMapNode *)self->root, ITER_MODE_KEYS);
+    } else if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_KEYS);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_KEYS);
+    } else {
+        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_KEYS);
+    }
+}
+
+static PyObject *Map_items(Map *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->root == NULL) {
+        return PyObject_GetIter(PyList_New(0));
+    }
+
+    if (is_array_map(self->root)) {
+        return ArrayMapNode_iter_mode((ArrayMapNode *)self->root, ITER_MODE_ITEMS);
+    } else if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_iter_kv((BitmapIndexedNode *)self->root);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_iter_kv((ArrayNode *)self->root);
+    } else {
+        return HashCollisionNode_iter_kv((HashCollisionNode *)self->root);
+    }
+}
+
+static PyObject *Map_keys(Map *self, PyObject *Py_UNUSED(ignored)) {
+    return Map_iter(self);
+}
+
+static PyObject *Map_values(Map *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->root == NULL) {
+        return PyObject_GetIter(PyList_New(0));
+    }
+
+    // Get a value-only iterator directly (no tuple allocation)
+    if (is_array_map(self->root)) {
+        return ArrayMapNode_iter_mode((ArrayMapNode *)self->root, ITER_MODE_VALUES);
+    } else if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_VALUES);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_VALUES);
+    } else {
+        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_VALUES);
+    }
+}
+
+static Py_hash_t Map_hash(Map *self) {
+    if (PDS_CACHE_READY(self->hash_computed)) {
+        return self->hash;
+    }
+
+    Py_uhash_t h = 0;
+    if (self->root != NULL && MapNode_hash(self->root, &h) < 0) {
+        return -1;
+    }
+    if ((Py_hash_t)h == -1) {
+        h = (Py_uhash_t)-2;
+    }
+
+    self->hash = (Py_hash_t)h;
+    PDS_CACHE_PUBLISH(self->hash_computed);
+    return self->hash;
+}
+
+static PyObject *Map_richcompare(Map *self, PyObject *other, int op) {
+    if (op != Py_EQ && op != Py_NE) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    if (self == (Map *)other) {
+        return PyBool_FromLong(op == Py_EQ);
+    }
+
+    if (!PyObject_TypeCheck(other, &MapType)) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+
+    Map *o = (Map *)other;
+    if (self->cnt != o->cnt) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+
+    if (self->cnt == 0) {
+        return PyBool_FromLong(op == Py_EQ);
+    }
+    if (PDS_CACHE_READY(self->hash_computed) && PDS_CACHE_READY(o->hash_computed) && self->hash != o->hash) {
+        return PyBool_FromLong(op == Py_NE);
+    }
+
+    // Equal counts, so self == other exactly when other contains all of self
+    int eq = MapNode_contains_all(self->root, o->root, 0);
+    if (eq < 0) return NULL;
+    return PyBool_FromLong((op == Py_EQ) == (eq == 1));
+}
+
+static PyObject *Map_repr(Map *self) {
+    PyObject *parts = PyList_New(0);
+    if (!parts) return NULL;
+
+    PyObject *items_iter = Map_items(self, NULL);
+    if (!items_iter) {
+        Py_DECREF(parts);
+        return NULL;
+    }
+
+    PyObject *pair;
+    while ((pair = PyIter_Next(items_iter)) != NULL) {
+        PyObject *key = PyTuple_GET_ITEM(pair, 0);
+        PyObject *val = PyTuple_GET_ITEM(pair, 1);
+
+        PyObject *key_repr = PyObject_Repr(key);
+        PyObject *val_repr = PyObject_Repr(val);
+        Py_DECREF(pair);
+
+        if (!key_repr || !val_repr) {
+            Py_XDECREF(key_repr);
+            Py_XDECREF(val_repr);
+            Py_DECREF(items_iter);
+            Py_DECREF(parts);
+            return NULL;
+        }
+
+        PyObject *part = PyUnicode_FromFormat("%U %U", key_repr, val_repr);
+        Py_DECREF(key_repr);
+        Py_DECREF(val_repr);
+
+        if (!part) {
+            Py_DECREF(items_iter);
+            Py_DECREF(parts);
+            return NULL;
+        }
+
+        if (PyList_Append(parts, part) < 0) {
+            Py_DECREF(part);
+            Py_DECREF(items_iter);
+            Py_DECREF(parts);
+            return NULL;
+        }
+        Py_DECREF(part);
+    }
+    Py_DECREF(items_iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(parts);
+        return NULL;
+    }
+
+    PyObject *space = PyUnicode_FromString(" ");
+    if (!space) {
+        Py_DECREF(parts);
+        return NULL;
+    }
+
+    PyObject *joined = PyUnicode_Join(space, parts);
+    Py_DECREF(space);
+    Py_DECREF(parts);
+    if (!joined) return NULL;
+
+    PyObject *result = PyUnicode_FromFormat("{%U}", joined);
+    Py_DECREF(joined);
+    return result;
+}
+
+// TransientMap forward declaration
+static PyTypeObject TransientMapType;
+
+static PyObject *Map_transient(Map *self, PyObject *Py_UNUSED(ignored));
+static PyObject *TransientMap_assoc_mut_impl(TransientMap *self, PyObject *key, PyObject *val);
+static PyObject *TransientMap_persistent(TransientMap *self, PyObject *Py_UNUSED(ignored));
+
+static PyObject *Map_to_seq(Map *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->cnt == 0) {
+        Py_RETURN_NONE;
+    }
+
+    // Build Cons list of [k v] vectors
+    PyObject *items_iter = Map_items(self, NULL);
+    if (!items_iter) return NULL;
+
+    PyObject *pairs = PyList_New(0);
+    if (!pairs) {
+        Py_DECREF(items_iter);
+        return NULL;
+    }
+
+    PyObject *pair;
+    while ((pair = PyIter_Next(items_iter)) != NULL) {
+        PyObject *key = PyTuple_GET_ITEM(pair, 0);
+        PyObject *val = PyTuple_GET_ITEM(pair, 1);
+
+        // Create Vector [key, val]
+        Vector *kv = (Vector *)pds_alloc(PDS_FL(vector), &VectorType);
+        if (!kv) {
+            Py_DECREF(pair);
+            Py_DECREF(items_iter);
+            Py_DECREF(pairs);
+            return NULL;
+        }
+        kv->cnt = 2;
+        kv->shift = BITS;
+        kv->root = EMPTY_NODE;
+        Py_INCREF(EMPTY_NODE);
+        kv->tail = PyTuple_Pack(2, key, val);
+        kv->hash = 0;
+        kv->hash_computed = 0;
+        kv->transient_id = NULL;
+
+        Py_DECREF(pair);
+
+        if (!kv->tail) {
+            Py_DECREF(kv);
+            Py_DECREF(items_iter);
+            Py_DECREF(pairs);
+            return NULL;
+        }
+
+        if (PyList_Append(pairs, (PyObject *)kv) < 0) {
+            Py_DECREF(kv);
+            Py_DECREF(items_iter);
+            Py_DECREF(pairs);
+            return NULL;
+        }
+        Py_DECREF(kv);
+    }
+    Py_DECREF(items_iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(pairs);
+        return NULL;
+    }
+
+    // Build Cons list in reverse
+    Cons *result = NULL;
+    for (Py_ssize_t i = PyList_Size(pairs) - 1; i >= 0; i--) {
+        PyObject *item = PyList_GET_ITEM(pairs, i);
+        Cons *new_cons = Cons_alloc();
+        if (!new_cons) {
+            Py_XDECREF(result);
+            Py_DECREF(pairs);
+            return NULL;
+        }
+
+        Py_INCREF(item);
+        new_cons->first = item;
+        new_cons->rest = result ? (PyObject *)result : Py_None;
+        Py_INCREF(new_cons->rest);
+        new_cons->hash = 0;
+        new_cons->hash_computed = 0;
+
+        result = new_cons;
+    }
+
+    Py_DECREF(pairs);
+    return (PyObject *)result;
+}
+
+// Map merge operation (|)
+// Merge two maps node by node; see MapNode_merge
+static PyObject *Map_merge_maps(Map *self, Map *other, PyObject *f) {
+    if (other->cnt == 0) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+    if (self->cnt == 0) {
+        Py_INCREF(other);
+        return (PyObject *)other;
+    }
+
+    // Merging walks tries, so array-map roots are promoted for the duration
+    PyObject *a = is_array_map(self->root) ? ArrayMapNode_promote((ArrayMapNode *)self->root, NULL, 0, NULL) : self->root;
+    if (!a) return NULL;
+    PyObject *b = is_array_map(other->root) ? ArrayMapNode_promote((ArrayMapNode *)other->root, NULL, 0, NULL) : other->root;
+    if (!b) {
+        if (a != self->root) Py_DECREF(a);
+        return NULL;
+    }
+
+    Py_ssize_t added = 0;
+    PyObject *root = MapNode_merge(a, b, 0, f, &added);
+    if (b != other->root) Py_DECREF(b);
+    if (root == a) {
+        Py_DECREF(root);
+        if (a != self->root) Py_DECREF(a);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+    if (a != self->root) Py_DECREF(a);
+    if (!root) return NULL;
+
+    PyObject *result = Map_from_trie(self->cnt + added, root);
+    Py_DECREF(root);
+    return result;
+}
+
+static PyObject *Map_merge_with(Map *self, PyObject *args) {
+    PyObject *f, *other;
+
+    if (!PyArg_ParseTuple(args, "OO:merge_with", &f, &other)) {
+        return NULL;
+    }
+    if (!PyObject_TypeCheck(other, &MapType)) {
+        PyErr_Format(PyExc_TypeError, "merge_with expects a Map, got %.200s", Py_TYPE(other)->tp_name);
+        return NULL;
+    }
+    return Map_merge_maps(self, (Map *)other, f == Py_None ? NULL : f);
+}
+
+static PyObject *Map_or(PyObject *left, PyObject *right) {
+    if (!PyObject_TypeCheck(left, &MapType)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    Map *self = (Map *)left;
+
+    // If right is empty, return self
+    if (PyObject_TypeCheck(right, &MapType)) {
+        Map *other = (Map *)right;
+        if (other->cnt == 0) {
+            Py_INCREF(self);
+            return (PyObject *)self;
+        }
+        if (self->cnt == 0) {
+            Py_INCREF(other);
+            return (PyObject *)other;
+        }
+    }
+
+    if (PyObject_TypeCheck(right, &MapType)) {
+        return Map_merge_maps(self, (Map *)right, NULL);
+    }
+
+    // Create transient from self via direct C call
+    TransientMap *t = (TransientMap *)Map_transient(self, NULL);
+    if (!t) return NULL;
+
+    // Get items iterator for right
+    PyObject *items_iter;
+
+    if (PyObject_TypeCheck(right, &MapType)) {
+        // Fast internal iterator for Map
+        items_iter = Map_items((Map *)right, NULL);
+    } else if (PyDict_Check(right)) {
+        // Fast path for Python dicts
+        items_iter = PyObject_CallMethod(right, "items", NULL);
+        if (items_iter) {
+            PyObject *temp = PyObject_GetIter(items_iter);
+            Py_DECREF(items_iter);
+            items_iter = temp;
+        }
+    } else if (PyObject_HasAttrString(right, "items")) {
+        // Generic mapping with .items() method (but not lists, etc.)
+        PyObject *items_method = PyObject_GetAttrString(right, "items");
+        if (!items_method) {
+            Py_DECREF(t);
+            return NULL;
+        }
+        items_iter = PyObject_CallObject(items_method, NULL);
+        Py_DECREF(items_method);
+        if (items_iter) {
+            PyObject *temp = PyObject_GetIter(items_iter);
+            Py_DECREF(items_iter);
+            items_iter = temp;
+        }
+    } else {
+        // Fallback: assume iterable of pairs (e.g., list of tuples)
+        items_iter = PyObject_GetIter(right);
+    }
+
+    if (!items_iter) {
+        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
+            PyErr_Clear();
+            Py_DECREF(t);
+            Py_RETURN_NOTIMPLEMENTED;
+        }
+        Py_DECREF(t);
+        return NULL;
+    }
+
+    PyObject *item;
+    while ((item = PyIter_Next(items_iter)) != NULL) {
+        PyObject *key, *val;
+
+        // Handle tuples, lists, Vectors, and other sequences
+        if (PyTuple_Check(item) && PyTuple_GET_SIZE(item) == 2) {
+            key = PyTuple_GET_ITEM(item, 0);
+            val = PyTuple_GET_ITEM(item, 1);
+        } else if (PyList_Check(item) && PyList_GET_SIZE(item) == 2) {
+            key = PyList_GET_ITEM(item, 0);
+            val = PyList_GET_ITEM(item, 1);
+        } else if (PyObject_TypeCheck(item, &VectorType)) {
+            // Handle our Vector type directly using internal C API
+            Vector *vec = (Vector *)item;
+            if (vec->cnt != 2) {
+                PyErr_SetString(PyExc_ValueError, "Map merge requires (key, value) pairs");
+                Py_DECREF(item);
+                Py_DECREF(items_iter);
+                Py_DECREF(t);
+                return NULL;
+            }
+            key = Vector_nth_impl(vec, 0, NULL);
+            val = Vector_nth_impl(vec, 1, NULL);
+            if (!key || !val) {
+                Py_XDECREF(key);
+                Py_XDECREF(val);
+                Py_DECREF(item);
+                Py_DECREF(items_iter);
+                Py_DECREF(t);
+                return NULL;
+            }
+            PyObject *res = TransientMap_assoc_mut_impl(t, key, val);
+            Py_DECREF(key);
+            Py_DECREF(val);
+            Py_DECREF(item);
+            if (!res) {
+                Py_DECREF(items_iter);
+                Py_DECREF(t);
+                return NULL;
+            }
+            Py_DECREF(res);
+            continue;
+        } else if (PySequence_Check(item) && PySequence_Size(item) == 2) {
+            key = PySequence_GetItem(item, 0);
+            val = PySequence_GetItem(item, 1);
+            if (!key || !val) {
+                Py_XDECREF(key);
+                Py_XDECREF(val);
+                Py_DECREF(item);
+                Py_DECREF(items_iter);
+                Py_DECREF(t);
+                return NULL;
+            }
+            // Use impl and then decref the borrowed refs
+            PyObject *res = TransientMap_assoc_mut_impl(t, key, val);
+            Py_DECREF(key);
+            Py_DECREF(val);
+            Py_DECREF(item);
+            if (!res) {
+                Py_DECREF(items_iter);
+                Py_DECREF(t);
+                return NULL;
+            }
+            Py_DECREF(res);
+            continue;
+        } else {
+            PyErr_SetString(PyExc_ValueError, "Map merge requires (key, value) pairs");
+            Py_DECREF(item);
+            Py_DECREF(items_iter);
+            Py_DECREF(t);
+            return NULL;
+        }
+
+        // OPTIMIZATION: Call internal C function directly
+        PyObject *res = TransientMap_assoc_mut_impl(t, key, val);
+        Py_DECREF(item);
+        if (!res) {
+            Py_DECREF(items_iter);
+            Py_DECREF(t);
+            return NULL;
+        }
+        Py_DECREF(res);
+    }
+
+    Py_DECREF(items_iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(t);
+        return NULL;
+    }
+
+    PyObject *result = TransientMap_persistent(t, NULL);
+    Py_DECREF(t);
+    return result;
+}
+
+static PyNumberMethods Map_as_number = {
+    .nb_or = (binaryfunc)Map_or,
+};
+
+/* Map.copy() - returns self since Map is immutable */
+/* Map.reduce(f[, init]) - fold f over the keys, walking the nodes directly */
+static PyObject *Map_reduce_fn(Map *self, PyObject *args) {
+    return MapNode_reduce_method(self->root, self->cnt, args);
+}
+
+static PyObject *Map_copy(Map *self, PyObject *Py_UNUSED(ignored)) {
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+// Forward declaration for hash_map function used by Map_reduce
+static PyObject *pds_hash_map(PyObject *self, PyObject *args);
+
+static PyObject *Map_reduce(Map *self, PyObject *Py_UNUSED(ignored)) {
+    // Build a tuple of (k1, v1, k2, v2, ...) for hash_map reconstructor
+    PyObject *args = PyTuple_New(self->cnt * 2);
+    if (args == NULL) {
+        return NULL;
+    }
+
+    // Iterate over items and flatten into the args tuple
+    PyObject *items_iter = Map_items(self, NULL);
+    if (items_iter == NULL) {
+        Py_DECREF(args);
+        return NULL;
+    }
+
+    Py_ssize_t i = 0;
+    PyObject *item;
+    while ((item = PyIter_Next(items_iter)) != NULL) {
+        PyObject *key = PyTuple_GET_ITEM(item, 0);
+        PyObject *val = PyTuple_GET_ITEM(item, 1);
+        Py_INCREF(key);
+        Py_INCREF(val);
+        PyTuple_SET_ITEM(args, i * 2, key);
+        PyTuple_SET_ITEM(args, i * 2 + 1, val);
+        Py_DECREF(item);
+        i++;
+    }
+    Py_DECREF(items_iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(args);
+        return NULL;
+    }
+
+    // Get the hash_map function from the pds module
+    PyObject *pds_module = PyImport_ImportModule("spork.runtime.pds");
+    if (pds_module == NULL) {
+        Py_DECREF(args);
+        return NULL;
+    }
+
+    PyObject *hash_map_func = PyObject_GetAttrString(pds_module, "hash_map");
+    Py_DECREF(pds_module);
+    if (hash_map_func == NULL) {
+        Py_DECREF(args);
+        return NULL;
+    }
+
+    // Return (hash_map, args_tuple) - pickle will call hash_map(*args_tuple)
+    PyObject *result = PyTuple_Pack(2, hash_map_func, args);
+    Py_DECREF(hash_map_func);
+    Py_DECREF(args);
+    return result;
+}
+
+/* Map.__reduce_ex__(protocol) - from protocol 2 on, pickle the entries with
+   their key hashes for _map_from_hashed (see Hashed pickling) */
+static PyObject *Map_reduce_ex(Map *self, PyObject *arg) {
+    long protocol = PyLong_AsLong(arg);
+    if (protocol == -1 && PyErr_Occurred()) return NULL;
+    if (protocol < 2 || Py_TYPE(self) != &MapType) {
+        return Map_reduce(self, NULL);
+    }
+    return MapNode_reduce_hashed(self->root, self->cnt, 0, protocol);
+}
+
+/* Map.from_dict(src) - build a map in bulk from a dict, Map or iterable of pairs */
+static PyObject *Map_from_dict(PyObject *cls, PyObject *src) {
+    if (PyObject_TypeCheck(src, &MapType)) {
+        Py_INCREF(src);
+        return src;
+    }
+    Py_ssize_t n;
+    MapBuildEntry *e = MapBuild_collect(src, 0, "Map.from_dict", &n);
+    if (!e) return NULL;
+    return Map_build(e, n);
+}
+
+static PyMethodDef Map_methods[] = {
+    {"from_dict", (PyCFunction)Map_from_dict, METH_O | METH_CLASS, "Build a map in bulk from a dict, Map or iterable of pairs"},
+    {"get", (PyCFunction)Map_get, METH_VARARGS, "Get value for key"},
+    {"assoc", (PyCFunction)Map_assoc, METH_VARARGS, "Set key to value"},
+    {"dissoc", (PyCFunction)Map_dissoc, METH_O, "Remove key"},
+    {"items", (PyCFunction)Map_items, METH_NOARGS, "Iterate over key-value pairs"},
+    {"keys", (PyCFunction)Map_keys, METH_NOARGS, "Iterate over keys"},
+    {"values", (PyCFunction)Map_values, METH_NOARGS, "Iterate over values"},
+    {"transient", (PyCFunction)Map_transient, METH_NOARGS, "Get transient version"},
+    {"to_seq", (PyCFunction)Map_to_seq, METH_NOARGS, "Convert to Cons sequence"},
+    {"copy", (PyCFunction)Map_copy, METH_NOARGS, "Return self (immutable maps don't need copying)"},
+    {"reduce", (PyCFunction)Map_reduce_fn, METH_VARARGS, "Reduce with f(acc, key), walking nodes directly"},
+    {"merge_with", (PyCFunction)Map_merge_with, METH_VARARGS, "Merge another map, combining shared keys with f(left, right)"},
+    {"__reduce__", (PyCFunction)Map_reduce, METH_NOARGS, "Pickle support"},
+    {"__reduce_ex__", (PyCFunction)Map_reduce_ex, METH_O, "Pickle support, keeping key hashes from protocol 2"},
+    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
+     "Return a generic alias for type annotations (e.g., Map[str, int])"},
+    {NULL}
+};
+
+static PySequenceMethods Map_as_sequence = {
+    .sq_contains = (objobjproc)Map_contains,
+};
+
+static PyMappingMethods Map_as_mapping = {
+    .mp_length = (lenfunc)Map_length,
+    .mp_subscript = (binaryfunc)Map_getitem,
+};
+
+static PyTypeObject MapType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.Map",
+    .tp_doc = "Persistent Hash Map using HAMT",
+    .tp_basicsize = sizeof(Map),
+    .tp_itemsize = 0,
+    .tp_dealloc = (destructor)Map_dealloc,
+    .tp_repr = (reprfunc)Map_repr,
+    .tp_as_number = &Map_as_number,
+    .tp_as_sequence = &Map_as_sequence,
+    .tp_as_mapping = &Map_as_mapping,
+    .tp_hash = (hashfunc)Map_hash,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_richcompare = (richcmpfunc)Map_richcompare,
+    .tp_iter = (getiterfunc)Map_iter,
+    .tp_methods = Map_methods,
+    .tp_new = Map_new,
+};
+
+// === TransientMap ===
+typedef struct TransientMap {
+    PyObject_HEAD
+    Py_ssize_t cnt;
+    PyObject *root;
+    PyObject *id;
+    Py_ssize_t edits;  // bumped by every mutation, so update_mut can tell f left it alone
+} TransientMap;
+
+static void TransientMap_dealloc(TransientMap *self) {
+    Py_XDECREF(self->root);
+    Py_XDECREF(self->id);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Map_transient(Map *self, PyObject *Py_UNUSED(ignored)) {
+    TransientMap *t = PyObject_New(TransientMap, &TransientMapType);
+    if (!t) return NULL;
+
+    t->id = PyObject_New(PyObject, &PdsSentinelType);
+    if (!t->id) {
+        Py_DECREF(t);
+        return NULL;
+    }
+
+    t->cnt = self->cnt;
+    t->edits = 0;
+    if (self->root != NULL && is_array_map(self->root)) {
+        // The promoted trie is private, so only its root needs claiming
+        PyObject *root = ArrayMapNode_promote((ArrayMapNode *)self->root, NULL, 0, NULL);
+        t->root = root ? (PyObject *)BitmapIndexedNode_ensure_editable((BitmapIndexedNode *)root, t->id) : NULL;
+        Py_XDECREF(root);
+        if (!t->root) {
+            Py_DECREF(t);
+            return NULL;
+        }
+    } else if (self->root != NULL) {
+        if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+            t->root = (PyObject *)BitmapIndexedNode_ensure_editable((BitmapIndexedNode *)self->root, t->id);
+        } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+            t->root = (PyObject *)ArrayNode_ensure_editable((ArrayNode *)self->root, t->id);
+        } else {
+            t->root = (PyObject *)HashCollisionNode_ensure_editable((HashCollisionNode *)self->root, t->id);
+        }
+        if (!t->root) {
+            Py_DECREF(t);
+            return NULL;
+        }
+    } else {
+        t->root = NULL;
+    }
+
+    return (PyObject *)t;
+}
+
+static void TransientMap_ensure_editable(TransientMap *self) {
+    if (self->id == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Transient used after persistent() call");
+    }
+}
+
+// assoc_mut for a key already hashed to h
+static PyObject *TransientMap_assoc_hashed(TransientMap *self, PyObject *key, Py_hash_t h, PyObject *val) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+    self->edits++;
+
+    PyObject *added_leaf = PyList_New(0);
+    if (!added_leaf) return NULL;
+
+    PyObject *root = self->root ? self->root : (PyObject *)EMPTY_BIN;
+    PyObject *new_root;
+
+    if (PyObject_TypeCheck(root, &BitmapIndexedNodeType)) {
+        new_root = BitmapIndexedNode_assoc((BitmapIndexedNode *)root, 0, h, key, val, added_leaf, self->id);
+    } else if (PyObject_TypeCheck(root, &ArrayNodeType)) {
+        new_root = ArrayNode_assoc((ArrayNode *)root, 0, h, key, val, added_leaf, self->id);
+    } else {
+        new_root = HashCollisionNode_assoc((HashCollisionNode *)root, 0, h, key, val, added_leaf, self->id);
+    }
+
+    if (!new_root) {
+        Py_DECREF(added_leaf);
+        return NULL;
+    }
+
+    if (new_root != self->root) {
+        Py_XDECREF(self->root);
+        self->root = new_root;
+    } else {
+        Py_DECREF(new_root);
+    }
+
+    self->cnt += PyList_Size(added_leaf);
+    Py_DECREF(added_leaf);
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+// Internal C API - no argument parsing overhead
+static PyObject *TransientMap_assoc_mut_impl(TransientMap *self, PyObject *key, PyObject *val) {
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+    return TransientMap_assoc_hashed(self, key, h, val);
+}
+
+// Python wrapper - parses arguments then calls impl
+static PyObject *TransientMap_assoc_mut(TransientMap *self, PyObject *args) {
+    PyObject *key, *val;
+    if (!PyArg_ParseTuple(args, "OO", &key, &val)) {
+        return NULL;
+    }
+    return TransientMap_assoc_mut_impl(self, key, val);
+}
+
+static PyObject *TransientMap_dissoc_mut(TransientMap *self, PyObject *key) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+    self->edits++;
+
+    if (self->root == NULL) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    PyObject *removed_leaf = PyList_New(0);
+    if (!removed_leaf) return NULL;
+
+    PyObject *new_root;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        new_root = BitmapIndexedNode_dissoc((BitmapIndexedNode *)self->root, 0, h, key, removed_leaf, self->id);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        new_root = ArrayNode_dissoc((ArrayNode *)self->root, 0, h, key, removed_leaf, self->id);
+    } else {
+        new_root = HashCollisionNode_dissoc((HashCollisionNode *)self->root, 0, h, key, removed_leaf, self->id);
+    }
+
+    if (!new_root && PyErr_Occurred()) {
+        Py_DECREF(removed_leaf);
+        return NULL;
+    }
+
+    // Check if a key was actually removed using the removed_leaf flag
+    int key_was_removed = PyList_Size(removed_leaf) > 0;
+    Py_DECREF(removed_leaf);
+
+    if (new_root != self->root) {
+        // Root changed
+        if (new_root == Py_None) {
+            // Map is now empty
+            Py_DECREF(new_root);
+            Py_XDECREF(self->root);
+            self->root = NULL;
+            self->cnt = 0;
+        } else {
+            Py_XDECREF(self->root);
+            self->root = new_root;
+            if (key_was_removed) {
+                self->cnt--;
+            }
+        }
+    } else if (new_root) {
+        // Root unchanged, but key might have been removed via in-place mutation
+        Py_DECREF(new_root);
+        if (key_was_removed) {
+            self->cnt--;
+        }
+    }
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+// Value slot for key below a transient's trie, claiming the nodes on the way
+// down for the transient; NULL when key is absent (or on error, with it set).
+// *ref is where the parent (or the transient) holds node.
+static PyObject **MapNode_edit_slot(PyObject **ref, int shift, Py_hash_t hash_val, PyObject *key, PyObject *transient_id) {
+    PyObject *node = *ref;
+
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        unsigned int bit = bitpos(hash_val, shift);
+        if (!(bin->bitmap & bit)) return NULL;
+        int idx = bitmap_index(bin->bitmap, bit);
+        PyObject *k = bin->array[2 * idx];
+        if (k == NULL && bin->array[2 * idx + 1] == NULL) return NULL;
+        if (k != NULL && k != key) {
+            if (BIN_HASHES(bin)[idx] != hash_val) return NULL;
+            if (PyObject_RichCompareBool(k, key, Py_EQ) <= 0) return NULL;
+        }
+        BitmapIndexedNode *owned = BitmapIndexedNode_ensure_editable(bin, transient_id);
+        if (!owned) return NULL;
+        Py_SETREF(*ref, (PyObject *)owned);
+        PyObject **slot = &owned->array[2 * idx + 1];
+        return k != NULL ? slot : MapNode_edit_slot(slot, shift + BITS, hash_val, key, transient_id);
+    }
+
+    if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        int idx = mask_hash(hash_val, shift);
+        if (((ArrayNode *)node)->array[idx] == NULL) return NULL;
+        ArrayNode *owned = ArrayNode_ensure_editable((ArrayNode *)node, transient_id);
+        if (!owned) return NULL;
+        Py_SETREF(*ref, (PyObject *)owned);
+        return MapNode_edit_slot(&owned->array[idx], shift + BITS, hash_val, key, transient_id);
+    }
+
+    HashCollisionNode *hcn = (HashCollisionNode *)node;
+    if (hcn->hash != hash_val) return NULL;
+    int idx = HashCollisionNode_find_index(hcn, key);
+    if (idx < 0) return NULL;
+    HashCollisionNode *owned = HashCollisionNode_ensure_editable(hcn, transient_id);
+    if (!owned) return NULL;
+    Py_SETREF(*ref, (PyObject *)owned);
+    return &owned->array[idx + 1];
+}
+
+/* TransientMap.update_mut(key, f, default=None) - set key to f(value), or to
+   f(default) when it is missing. A present key is found once and its value
+   replaced in place. */
+static PyObject *TransientMap_update_mut(TransientMap *self, PyObject *args) {
+    PyObject *key, *f;
+    PyObject *default_val = Py_None;
+
+    if (!PyArg_ParseTuple(args, "OO|O:update_mut", &key, &f, &default_val)) {
+        return NULL;
+    }
+
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    PyObject **slot = self->root ? MapNode_edit_slot(&self->root, 0, h, key, self->id) : NULL;
+    if (!slot && PyErr_Occurred()) return NULL;
+
+    PyObject *old = slot ? *slot : default_val;
+    Py_INCREF(old);
+    Py_ssize_t edits = self->edits;
+    PyObject *val = PyObject_CallOneArg(f, old);
+    Py_DECREF(old);
+    if (!val) return NULL;
+
+    // A new key, or f edited the transient itself and may have moved the slot
+    if (!slot || self->edits != edits) {
+        PyObject *result = TransientMap_assoc_mut_impl(self, key, val);
+        Py_DECREF(val);
+        return result;
+    }
+    Py_SETREF(*slot, val);
+    self->edits++;
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+// assoc_mut one [key value] pair given as a tuple, list or Vector
+static int TransientMap_assoc_pair(TransientMap *self, PyObject *item) {
+    PyObject *key, *val;
+    if (PyObject_TypeCheck(item, &VectorType) && ((Vector *)item)->cnt == 2) {
+        key = Vector_item((Vector *)item, 0);
+        val = Vector_item((Vector *)item, 1);
+    } else if ((PyTuple_Check(item) || PyList_Check(item)) && PySequence_Fast_GET_SIZE(item) == 2) {
+        key = PySequence_Fast_GET_ITEM(item, 0);
+        val = PySequence_Fast_GET_ITEM(item, 1);
+    } else {
+        PyErr_SetString(PyExc_ValueError, "assoc_many_mut requires [key value] pairs");
+        return -1;
+    }
+    PyObject *result = TransientMap_assoc_mut_impl(self, key, val);
+    Py_XDECREF(result);
+    return result ? 0 : -1;
+}
+
+/* TransientMap.assoc_many_mut(pairs) - assoc_mut every entry of a dict or
+   Map, or every [key value] pair of an iterable */
+static PyObject *TransientMap_assoc_many_mut(TransientMap *self, PyObject *pairs) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (PyDict_Check(pairs)) {
+        Py_ssize_t pos = 0;
+        PyObject *k, *v;
+        while (PyDict_Next(pairs, &pos, &k, &v)) {
+            Py_INCREF(k);
+            Py_INCREF(v);
+            PyObject *result = TransientMap_assoc_mut_impl(self, k, v);
+            Py_DECREF(k);
+            Py_DECREF(v);
+            if (!result) return NULL;
+            Py_DECREF(result);
+        }
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    PyObject *iter = PyObject_TypeCheck(pairs, &MapType) ? Map_items((Map *)pairs, NULL) : PyObject_GetIter(pairs);
+    if (!iter) return NULL;
+    PyObject *item;
+    while ((item = PyIter_Next(iter)) != NULL) {
+        int rc = TransientMap_assoc_pair(self, item);
+        Py_DECREF(item);
+        if (rc < 0) {
+            Py_DECREF(iter);
+            return NULL;
+        }
+    }
+    Py_DECREF(iter);
+    if (PyErr_Occurred()) return NULL;
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *TransientMap_persistent(TransientMap *self, PyObject *Py_UNUSED(ignored)) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+    self->edits++;
+
+    Py_CLEAR(self->id);
+
+    return Map_from_trie(self->cnt, self->root);
+}
+
+// === TransientMap MutableMapping Protocol ===
+
+static Py_ssize_t TransientMap_length(TransientMap *self) {
+    return self->cnt;
+}
+
+static PyObject *TransientMap_getitem(TransientMap *self, PyObject *key) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (self->root == NULL) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    PyObject *result;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
+    } else {
+        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+    }
+
+    if (!result) return NULL;
+
+    if (result == _MISSING) {
+        Py_DECREF(result);
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+
+    return result;
+}
+
+static int TransientMap_ass_subscript(TransientMap *self, PyObject *key, PyObject *val) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return -1;
+
+    if (val != NULL) {
+        // Set: t[k] = v
+        PyObject *result = TransientMap_assoc_mut_impl(self, key, val);
+        if (!result) return -1;
+        Py_DECREF(result);
+        return 0;
+    } else {
+        // Delete: del t[k]
+        // First check if key exists (Python semantics require KeyError if missing)
+        Py_hash_t h = PyObject_Hash(key);
+        if (h == -1 && PyErr_Occurred()) return -1;
+
+        if (self->root != NULL) {
+            PyObject *found;
+            if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+                found = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
+            } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+                found = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
+            } else {
+                found = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+            }
+
+            if (!found) return -1;
+
+            if (found == _MISSING) {
+                Py_DECREF(found);
+                PyErr_SetObject(PyExc_KeyError, key);
+                return -1;
+            }
+            Py_DECREF(found);
+        } else {
+            PyErr_SetObject(PyExc_KeyError, key);
+            return -1;
+        }
+
+        PyObject *result = TransientMap_dissoc_mut(self, key);
+        if (!result) return -1;
+        Py_DECREF(result);
+        return 0;
+    }
+}
+
+static int TransientMap_contains(TransientMap *self, PyObject *key) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return -1;
+
+    if (self->root == NULL) {
+        return 0;
+    }
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return -1;
+
+    PyObject *result;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
+    } else {
+        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+    }
+
+    if (!result) return -1;
+
+    int found = (result != _MISSING);
+    Py_DECREF(result);
+    return found;
+}
+
+static PyObject *TransientMap_iter(TransientMap *self) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (self->root == NULL) {
+        // Return empty iterator
+        return PyObject_GetIter(PyTuple_New(0));
+    }
+
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_KEYS);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_KEYS);
+    } else {
+        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_KEYS);
+    }
+}
+
+static PyObject *TransientMap_keys(TransientMap *self, PyObject *Py_UNUSED(ignored)) {
+    return TransientMap_iter(self);
+}
+
+static PyObject *TransientMap_values(TransientMap *self, PyObject *Py_UNUSED(ignored)) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (self->root == NULL) {
+        return PyObject_GetIter(PyTuple_New(0));
+    }
+
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_VALUES);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_VALUES);
+    } else {
+        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_VALUES);
+    }
+}
+
+static PyObject *TransientMap_items(TransientMap *self, PyObject *Py_UNUSED(ignored)) {
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (self->root == NULL) {
+        return PyObject_GetIter(PyTuple_New(0));
+    }
+
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_ITEMS);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_ITEMS);
+    } else {
+        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_ITEMS);
+    }
+}
+
+static PyObject *TransientMap_get(TransientMap *self, PyObject *args) {
+    PyObject *key;
+    PyObject *default_val = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key, &default_val)) {
+        return NULL;
+    }
+
+    TransientMap_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (self->root == NULL) {
+        Py_INCREF(default_val);
+        return default_val;
+    }
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, default_val);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_find((ArrayNode *)self->root, 0, h, key, default_val);
+    } else {
+        return HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, default_val);
+    }
+}
+
+static PyMethodDef TransientMap_methods[] = {
+    {"assoc_mut", (PyCFunction)TransientMap_assoc_mut, METH_VARARGS, "Mutably set key to value"},
+    {"dissoc_mut", (PyCFunction)TransientMap_dissoc_mut, METH_O, "Mutably remove key"},
+    {"update_mut", (PyCFunction)TransientMap_update_mut, METH_VARARGS, "Mutably set key to f(value), f(default) when missing"},
+    {"assoc_many_mut", (PyCFunction)TransientMap_assoc_many_mut, METH_O, "Mutably set every [key value] pair of a dict, Map or iterable"},
+    {"persistent", (PyCFunction)TransientMap_persistent, METH_NOARGS, "Return persistent map"},
+    {"get", (PyCFunction)TransientMap_get, METH_VARARGS, "Get value for key with optional default"},
+    {"keys", (PyCFunction)TransientMap_keys, METH_NOARGS, "Iterate over keys"},
+    {"values", (PyCFunction)TransientMap_values, METH_NOARGS, "Iterate over values"},
+    {"items", (PyCFunction)TransientMap_items, METH_NOARGS, "Iterate over key-value pairs"},
+    {NULL}
+};
+
+static PySequenceMethods TransientMap_as_sequence = {
+    .sq_contains = (objobjproc)TransientMap_contains,
+};
+
+static PyMappingMethods TransientMap_as_mapping = {
+    .mp_length = (lenfunc)TransientMap_length,
+    .mp_subscript = (binaryfunc)TransientMap_getitem,
+    .mp_ass_subscript = (objobjargproc)TransientMap_ass_subscript,
+};
+
+static PyTypeObject TransientMapType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.TransientMap",
+    .tp_doc = "Transient map for batch operations",
+    .tp_basicsize = sizeof(TransientMap),
+    .tp_dealloc = (destructor)TransientMap_dealloc,
+    .tp_as_sequence = &TransientMap_as_sequence,
+    .tp_as_mapping = &TransientMap_as_mapping,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = (getiterfunc)TransientMap_iter,
+    .tp_methods = TransientMap_methods,
+};
+
+// === Set ===
+// Immutable hash set using HAMT (same structure as Map, but values are always Py_None)
+
+struct Set {
+    PyObject_HEAD
+    Py_ssize_t cnt;
+    PyObject *root;  // BitmapIndexedNode, ArrayNode, or HashCollisionNode
+    Py_hash_t hash;
+    int hash_computed;
+    PyObject *transient_id;
+};
+
+static PyTypeObject SetType;
+static Set *EMPTY_SET = NULL;
+
+static void Set_dealloc(Set *self) {
+    Py_XDECREF(self->root);
+    Py_XDECREF(self->transient_id);
+    pds_recycle(PDS_FL(set), (PyObject *)self, &SetType);
+}
+
+static PyObject *Set_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    Set *self = (Set *)type->tp_alloc(type, 0);
+    if (self != NULL) {
+        self->cnt = 0;
+        self->root = NULL;
+        self->hash = 0;
+        self->hash_computed = 0;
+        self->transient_id = NULL;
+    }
+    return (PyObject *)self;
+}
+
+// Forward declarations for Set_init
+static PyObject *Set_conj(Set *self, PyObject *val);
+
+static int Set_init(Set *self, PyObject *args, PyObject *kwds) {
+    Py_ssize_t n = PyTuple_Size(args);
+
+    if (n == 0) {
+        return 0;  // Empty set, already initialized by tp_new
+    }
+
+    // Build set by conj'ing each element
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *item = PyTuple_GET_ITEM(args, i);
+        PyObject *new_set = Set_conj(self, item);
+        if (!new_set) {
+            return -1;
+        }
+
+        // Update self from new_set
+        Set *ns = (Set *)new_set;
+        Py_XDECREF(self->root);
+        self->cnt = ns->cnt;
+        self->root = ns->root;
+        Py_XINCREF(self->root);
+        self->hash = 0;
+        self->hash_computed = 0;
+        Py_DECREF(new_set);
+    }
+
+    return 0;
+}
+
+static Set *Set_create(Py_ssize_t cnt, PyObject *root, PyObject *transient_id) {
+    Set *s = (Set *)pds_alloc(PDS_FL(set), &SetType);
+    if (!s) return NULL;
+
+    s->cnt = cnt;
+    s->root = root;
+    Py_XINCREF(root);
+    s->hash = 0;
+    s->hash_computed = 0;
+    s->transient_id = transient_id;
+    Py_XINCREF(transient_id);
+
+    return s;
+}
+
+static Py_ssize_t Set_length(Set *self) {
+    return self->cnt;
+}
+
+static int Set_contains(Set *self, PyObject *key) {
+    if (self->root == NULL) {
+        return 0;
+    }
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return -1;
+
+    PyObject *result;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
+    } else {
+        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+    }
+
+    if (!result) return -1;
+
+    int found = (result != _MISSING);
+    Py_DECREF(result);
+    return found;
+}
+
+static PyObject *Set_conj(Set *self, PyObject *key) {
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    PyObject *added_leaf = PyList_New(0);
+    if (!added_leaf) return NULL;
+
+    PyObject *root = self->root ? self->root : (PyObject *)EMPTY_BIN;
+    PyObject *new_root;
+
+    if (PyObject_TypeCheck(root, &BitmapIndexedNodeType)) {
+        new_root = BitmapIndexedNode_assoc((BitmapIndexedNode *)root, 0, h, key, Py_None, added_leaf, self->transient_id);
+    } else if (PyObject_TypeCheck(root, &ArrayNodeType)) {
+        new_root = ArrayNode_assoc((ArrayNode *)root, 0, h, key, Py_None, added_leaf, self->transient_id);
+    } else {
+        new_root = HashCollisionNode_assoc((HashCollisionNode *)root, 0, h, key, Py_None, added_leaf, self->transient_id);
+    }
+
+    if (!new_root) {
+        Py_DECREF(added_leaf);
+        return NULL;
+    }
+
+    if (new_root == self->root) {
+        Py_DECREF(new_root);
+        Py_DECREF(added_leaf);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_ssize_t new_cnt = self->cnt + PyList_Size(added_leaf);
+    Py_DECREF(added_leaf);
+
+    Set *result = Set_create(new_cnt, new_root, self->transient_id);
+    Py_DECREF(new_root);
+    return (PyObject *)result;
+}
+
+static PyObject *Set_disj(Set *self, PyObject *key) {
+    if (self->root == NULL) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    PyObject *new_root;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        new_root = BitmapIndexedNode_dissoc((BitmapIndexedNode *)self->root, 0, h, key, NULL, self->transient_id);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        new_root = ArrayNode_dissoc((ArrayNode *)self->root, 0, h, key, NULL, self->transient_id);
+    } else {
+        new_root = HashCollisionNode_dissoc((HashCollisionNode *)self->root, 0, h, key, NULL, self->transient_id);
+    }
+
+    if (!new_root) return NULL;
+
+    if (new_root == self->root) {
+        Py_DECREF(new_root);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_ssize_t new_cnt = (new_root != Py_None) ? self->cnt - 1 : 0;
+    if (new_root == Py_None) {
+        Py_DECREF(new_root);
+        new_root = NULL;
+    }
+
+    Set *result = Set_create(new_cnt, new_root, self->transient_id);
+    Py_XDECREF(new_root);
+    return (PyObject *)result;
+}
+
+// SetIterator - yields only keys from the HAMT
+struct SetIterator {
+    PyObject_HEAD
+    PyObject *kv_iter;  // Underlying key-value iterator
+};
+
+static PyTypeObject SetIteratorType;
+
+static void SetIterator_dealloc(SetIterator *self) {
+    Py_XDECREF(self->kv_iter);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *SetIterator_next(SetIterator *self) {
+    if (!self->kv_iter) return NULL;
+
+    PyObject *pair = PyIter_Next(self->kv_iter);
+    if (!pair) return NULL;  // StopIteration or error
+
+    PyObject *key = PyTuple_GET_ITEM(pair, 0);
+    Py_INCREF(key);
+    Py_DECREF(pair);
+    return key;
+}
+
+static PyTypeObject SetIteratorType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.SetIterator",
+    .tp_basicsize = sizeof(SetIterator),
+    .tp_dealloc = (destructor)SetIterator_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)SetIterator_next,
+};
+
+static PyObject *Set_iter(Set *self) {
+    if (self->root == NULL) {
+        return PyObject_GetIter(PyList_New(0));
+    }
+
+    PyObject *kv_iter;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        kv_iter = BitmapIndexedNode_iter_kv((BitmapIndexedNode *)self->root);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        kv_iter = ArrayNode_iter_kv((ArrayNode *)self->root);
+    } else {
+        kv_iter = HashCollisionNode_iter_kv((HashCollisionNode *)self->root);
+    }
+
+    if (!kv_iter) return NULL;
+
+    SetIterator *it = PyObject_New(SetIterator, &SetIteratorType);
+    if (!it) {
+        Py_DECREF(kv_iter);
+        return NULL;
+    }
+
+    it->kv_iter = kv_iter;
+    return (PyObject *)it;
+}
+
+// Set operations: union, intersection, difference
+
+// Forward declarations for TransientSet functions (defined later)
+static PyTypeObject TransientSetType;
+static PyObject *Set_transient(Set *self, PyObject *Py_UNUSED(ignored));
+static PyObject *TransientSet_conj_mut(TransientSet *self, PyObject *key);
+static PyObject *TransientSet_disj_mut(TransientSet *self, PyObject *key);
+static PyObject *TransientSet_persistent(TransientSet *self, PyObject *Py_UNUSED(ignored));
+
+// Union, intersection, difference or symmetric difference of two Sets on
+// their tries (MapNode_merge / MapNode_setop)
+#define SETOP_OR (-1)
+
+static PyObject *Set_setop(Set *self, Set *other, int op) {
+    if (self->cnt == 0 || other->cnt == 0) {
+        Set *result;
+        if (op == SETOP_AND) {
+            result = EMPTY_SET;
+        } else if (op == SETOP_SUB) {
+            result = self;
+        } else {
+            result = self->cnt == 0 ? other : self;
+        }
+        Py_INCREF(result);
+        return (PyObject *)result;
+    }
+
+    Py_ssize_t cnt;
+    PyObject *root;
+    if (op == SETOP_OR) {
+        Py_ssize_t added = 0;
+        root = MapNode_merge(self->root, other->root, 0, NULL, &added);
+        cnt = self->cnt + added;
+    } else {
+        Py_ssize_t common = 0;
+        root = MapNode_setop(self->root, other->root, 0, op, &common);
+        if (op == SETOP_AND) {
+            cnt = common;
+        } else if (op == SETOP_SUB) {
+            cnt = self->cnt - common;
+        } else {
+            cnt = self->cnt + other->cnt - 2 * common;
+        }
+    }
+    if (!root) return NULL;
+
+    Set *result = NULL;
+    if (root == Py_None) {
+        result = EMPTY_SET;
+    } else if (root == self->root) {
+        result = self;
+    } else if (root == other->root) {
+        result = other;
+    }
+    if (result != NULL) {
+        Py_DECREF(root);
+        Py_INCREF(result);
+        return (PyObject *)result;
+    }
+
+    result = Set_create(cnt, root, NULL);
+    Py_DECREF(root);
+    return (PyObject *)result;
+}
+
+static PyObject *Set_or(PyObject *left, PyObject *right) {
+    if (!PyObject_TypeCheck(left, &SetType)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    Set *self = (Set *)left;
+
+    if (PyObject_TypeCheck(right, &SetType)) {
+        return Set_setop(self, (Set *)right, SETOP_OR);
+    }
+
+    // Other is an iterable - use transient for efficient accumulation
+    PyObject *iter = PyObject_GetIter(right);
+    if (!iter) {
+        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
+            PyErr_Clear();
+            Py_RETURN_NOTIMPLEMENTED;
+        }
+        return NULL;
+    }
+
+    TransientSet *trans = (TransientSet *)Set_transient(self, NULL);
+    if (!trans) {
+        Py_DECREF(iter);
+        return NULL;
+    }
+
+    PyObject *key;
+    while ((key = PyIter_Next(iter)) != NULL) {
+        PyObject *res = TransientSet_conj_mut(trans, key);
+        Py_DECREF(key);
+        if (!res) {
+            Py_DECREF(trans);
+            Py_DECREF(iter);
+            return NULL;
+        }
+        Py_DECREF(res);
+    }
+    Py_DECREF(iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(trans);
+        return NULL;
+    }
+
+    PyObject *result = TransientSet_persistent(trans, NULL);
+    Py_DECREF(trans);
+    return result;
+}
+
+static PyObject *Set_and(PyObject *left, PyObject *right) {
+    if (!PyObject_TypeCheck(left, &SetType)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    Set *self = (Set *)left;
+
+    if (PyObject_TypeCheck(right, &SetType)) {
+        return Set_setop(self, (Set *)right, SETOP_AND);
+    }
+
+    if (self->cnt == 0) {
+        Py_INCREF(EMPTY_SET);
+        return (PyObject *)EMPTY_SET;
+    }
+
+    // Use transient for efficient accumulation from empty set
+    TransientSet *trans = (TransientSet *)Set_transient(EMPTY_SET, NULL);
+    if (!trans) return NULL;
+
+    // Other is an iterable - check each element against self
+    PyObject *iter = PyObject_GetIter(right);
+    if (!iter) {
+        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
+            PyErr_Clear();
+            Py_DECREF(trans);
+            Py_RETURN_NOTIMPLEMENTED;
+        }
+        Py_DECREF(trans);
+        return NULL;
+    }
+
+    PyObject *key;
+    while ((key = PyIter_Next(iter)) != NULL) {
+        int found = Set_contains(self, key);
+        if (found < 0) {
+            Py_DECREF(key);
+            Py_DECREF(iter);
+            Py_DECREF(trans);
+            return NULL;
+        }
+        if (found) {
+            PyObject *res = TransientSet_conj_mut(trans, key);
+            Py_DECREF(key);
+            if (!res) {
+                Py_DECREF(iter);
+                Py_DECREF(trans);
+                return NULL;
+            }
+            Py_DECREF(res);
+        } else {
+            Py_DECREF(key);
+        }
+    }
+    Py_DECREF(iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(trans);
+        return NULL;
+    }
+
+    PyObject *result = TransientSet_persistent(trans, NULL);
+    Py_DECREF(trans);
+    return result;
+}
+
+static PyObject *Set_sub(PyObject *left, PyObject *right) {
+    if (!PyObject_TypeCheck(left, &SetType)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    Set *self = (Set *)left;
+
+    if (PyObject_TypeCheck(right, &SetType)) {
+        return Set_setop(self, (Set *)right, SETOP_SUB);
+    }
+
+    if (self->cnt == 0) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    PyObject *iter = PyObject_GetIter(right);
+    if (!iter) {
+        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
+            PyErr_Clear();
+            Py_RETURN_NOTIMPLEMENTED;
+        }
+        return NULL;
+    }
+
+    // Use transient for efficient mutation
+    TransientSet *trans = (TransientSet *)Set_transient(self, NULL);
+    if (!trans) {
+        Py_DECREF(iter);
+        return NULL;
+    }
+
+    PyObject *key;
+    while ((key = PyIter_Next(iter)) != NULL) {
+        PyObject *res = TransientSet_disj_mut(trans, key);
+        Py_DECREF(key);
+        if (!res) {
+            Py_DECREF(trans);
+            Py_DECREF(iter);
+            return NULL;
+        }
+        Py_DECREF(res);
+    }
+    Py_DECREF(iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(trans);
+        return NULL;
+    }
+
+    PyObject *result = TransientSet_persistent(trans, NULL);
+    Py_DECREF(trans);
+    return result;
+}
+
+static PyObject *Set_xor(PyObject *left, PyObject *right) {
+    // Symmetric difference: (self | other) - (self & other)
+    // or equivalently: (self - other) | (other - self)
+    if (!PyObject_TypeCheck(left, &SetType)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    Set *self = (Set *)left;
+
+    if (PyObject_TypeCheck(right, &SetType)) {
+        return Set_setop(self, (Set *)right, SETOP_XOR);
+    }
+
+    // Use transient for efficient accumulation from empty set
+    TransientSet *trans = (TransientSet *)Set_transient(EMPTY_SET, NULL);
+    if (!trans) return NULL;
+
+    // Add elements from self that are not in other
+    PyObject *self_iter = Set_iter(self);
+    if (!self_iter) {
+        Py_DECREF(trans);
+        return NULL;
+    }
+
+    PyObject *key;
+    while ((key = PyIter_Next(self_iter)) != NULL) {
+        // For non-Set iterables, we need to check membership
+        int in_other = PySequence_Contains(right, key);
+
+        if (in_other < 0) {
+            Py_DECREF(key);
+            Py_DECREF(self_iter);
+            Py_DECREF(trans);
+            return NULL;
+        }
+
+        if (!in_other) {
+            PyObject *res = TransientSet_conj_mut(trans, key);
+            Py_DECREF(key);
+            if (!res) {
+                Py_DECREF(self_iter);
+                Py_DECREF(trans);
+                return NULL;
+            }
+            Py_DECREF(res);
+        } else {
+            Py_DECREF(key);
+        }
+    }
+    Py_DECREF(self_iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(trans);
+        return NULL;
+    }
+
+    // Add elements from other that are not in self
+    PyObject *other_iter = PyObject_GetIter(right);
+    if (!other_iter) {
+        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
+            PyErr_Clear();
+            Py_DECREF(trans);
+            Py_RETURN_NOTIMPLEMENTED;
+        }
+        Py_DECREF(trans);
+        return NULL;
+    }
+
+    while ((key = PyIter_Next(other_iter)) != NULL) {
+        int in_self = Set_contains(self, key);
+        if (in_self < 0) {
+            Py_DECREF(key);
+            Py_DECREF(other_iter);
+            Py_DECREF(trans);
+            return NULL;
+        }
+
+        if (!in_self) {
+            PyObject *res = TransientSet_conj_mut(trans, key);
+            Py_DECREF(key);
+            if (!res) {
+                Py_DECREF(other_iter);
+                Py_DECREF(trans);
+                return NULL;
+            }
+            Py_DECREF(res);
+        } else {
+            Py_DECREF(key);
+        }
+    }
+    Py_DECREF(other_iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(trans);
+        return NULL;
+    }
+
+    PyObject *result = TransientSet_persistent(trans, NULL);
+    Py_DECREF(trans);
+    return result;
+}
+
+static Py_hash_t Set_hash(Set *self) {
+    if (PDS_CACHE_READY(self->hash_computed)) {
+        return self->hash;
+    }
+
+    // Use XOR of element hashes for order-independent hash
+    Py_hash_t h = self->root ? (Py_hash_t)MapNode_xor_key_hashes(self->root) : 0;
+
+    // Avoid returning -1 which signals error
+    if (h == -1) h = -2;
+
+    self->hash = h;
+    PDS_CACHE_PUBLISH(self->hash_computed);
+    return h;
+}
+
+static PyObject *Set_richcompare(Set *self, PyObject *other, int op) {
+    if (op != Py_EQ && op != Py_NE && op != Py_LT && op != Py_LE && op != Py_GT && op != Py_GE) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    if (self == (Set *)other) {
+        if (op == Py_EQ || op == Py_LE || op == Py_GE) {
+            Py_RETURN_TRUE;
+        } else {
+            Py_RETURN_FALSE;
+        }
+    }
+
+    if (!PyObject_TypeCheck(other, &SetType)) {
+        if (op == Py_EQ) Py_RETURN_FALSE;
+        if (op == Py_NE) Py_RETURN_TRUE;
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    Set *o = (Set *)other;
+
+    // Every op reduces to "sub is a subset of sup" plus a count check
+    Set *sub = self;
+    Set *sup = o;
+    if (op == Py_GT || op == Py_GE) {
+        sub = o;
+        sup = self;
+    }
+    if (op == Py_EQ || op == Py_NE) {
+        if (self->cnt != o->cnt) {
+            return PyBool_FromLong(op == Py_NE);
+        }
+    } else if (op == Py_LT || op == Py_GT) {
+        if (sub->cnt >= sup->cnt) Py_RETURN_FALSE;
+    } else if (sub->cnt > sup->cnt) {
+        Py_RETURN_FALSE;
+    }
+
+    // Element nodes all hold None as their value, so the map walk applies as is
+    int subset = 1;
+    if (sub->cnt > 0) {
+        subset = MapNode_contains_all(sub->root, sup->root, 0);
+        if (subset < 0) return NULL;
+    }
+    return PyBool_FromLong((op == Py_NE) != (subset == 1));
+}
+
+static PyObject *Set_repr(Set *self) {
+    if (self->cnt == 0) {
+        return PyUnicode_FromString("#{}");
+    }
+
+    PyObject *parts = PyList_New(0);
+    if (!parts) return NULL;
+
+    PyObject *iter = Set_iter(self);
+    if (!iter) {
+        Py_DECREF(parts);
+        return NULL;
+    }
+
+    PyObject *key;
+    while ((key = PyIter_Next(iter)) != NULL) {
+        PyObject *key_repr = PyObject_Repr(key);
+        Py_DECREF(key);
+
+        if (!key_repr) {
+            Py_DECREF(iter);
+            Py_DECREF(parts);
+            return NULL;
+        }
+
+        if (PyList_Append(parts, key_repr) < 0) {
+            Py_DECREF(key_repr);
+            Py_DECREF(iter);
+            Py_DECREF(parts);
+            return NULL;
+        }
+        Py_DECREF(key_repr);
+    }
+    Py_DECREF(iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(parts);
+        return NULL;
+    }
+
+    PyObject *space = PyUnicode_FromString(" ");
+    if (!space) {
+        Py_DECREF(parts);
+        return NULL;
+    }
+
+    PyObject *joined = PyUnicode_Join(space, parts);
+    Py_DECREF(space);
+    Py_DECREF(parts);
+    if (!joined) return NULL;
+
+    PyObject *result = PyUnicode_FromFormat("#{%U}", joined);
+    Py_DECREF(joined);
+    return result;
+}
+
+// TransientSet forward declaration
+static PyTypeObject TransientSetType;
+
+static PyObject *Set_transient(Set *self, PyObject *Py_UNUSED(ignored));
+
+static PyObject *Set_to_seq(Set *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->cnt == 0) {
+        Py_RETURN_NONE;
+    }
+
+    // Build Cons list of elements
+    PyObject *iter = Set_iter(self);
+    if (!iter) return NULL;
+
+    PyObject *elements = PyList_New(0);
+    if (!elements) {
+        Py_DECREF(iter);
+        return NULL;
+    }
+
+    PyObject *key;
+    while ((key = PyIter_Next(iter)) != NULL) {
+        if (PyList_Append(elements, key) < 0) {
+            Py_DECREF(key);
+            Py_DECREF(iter);
+            Py_DECREF(elements);
+            return NULL;
+        }
+        Py_DECREF(key);
+    }
+    Py_DECREF(iter);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(elements);
+        return NULL;
+    }
+
+    // Build Cons list in reverse
+    Cons *result = NULL;
+    for (Py_ssize_t i = PyList_Size(elements) - 1; i >= 0; i--) {
+        PyObject *item = PyList_GET_ITEM(elements, i);
+        Cons *new_cons = Cons_alloc();
+        if (!new_cons) {
+            Py_XDECREF(result);
+            Py_DECREF(elements);
+            return NULL;
+        }
+
+        Py_INCREF(item);
+        new_cons->first = item;
+        new_cons->rest = result ? (PyObject *)result : Py_None;
+        Py_INCREF(new_cons->rest);
+        new_cons->hash = 0;
+        new_cons->hash_computed = 0;
+
+        result = new_cons;
+    }
+
+    Py_DECREF(elements);
+    return (PyObject *)result;
+}
+
+/* Set.copy() - returns self since Set is immutable */
+/* Set.reduce(f[, init]) - fold f over the elements, walking the nodes directly */
+static PyObject *Set_reduce_fn(Set *self, PyObject *args) {
+    return MapNode_reduce_method(self->root, self->cnt, args);
+}
+
+static PyObject *Set_copy(Set *self, PyObject *Py_UNUSED(ignored)) {
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+/* Set.isdisjoint(other) - return True if no common elements */
+static PyObject *Set_isdisjoint(Set *self, PyObject *other) {
+    PyObject *iter = PyObject_GetIter(other);
+    if (!iter) return NULL;
+
+    PyObject *item;
+    while ((item = PyIter_Next(iter)) != NULL) {
+        int contains = Set_contains(self, item);
+        Py_DECREF(item);
+
+        if (contains < 0) {
+            Py_DECREF(iter);
+            return NULL;
+        }
+        if (contains) {
+            Py_DECREF(iter);
+            Py_RETURN_FALSE;
+        }
+    }
+    Py_DECREF(iter);
+
+    if (PyErr_Occurred()) return NULL;
+
+    Py_RETURN_TRUE;
+}
+
+static PyObject *Set_reduce(Set *self, PyObject *Py_UNUSED(ignored)) {
+    // Convert Set to a tuple using the sequence protocol (iteration)
+    PyObject *args = PySequence_Tuple((PyObject *)self);
+    if (args == NULL) {
+        return NULL;
+    }
+
+    // Return (type, args_tuple) - pickle will call type(*args_tuple)
+    PyObject *result = PyTuple_Pack(2, (PyObject *)Py_TYPE(self), args);
+    Py_DECREF(args);
+    return result;
+}
+
+/* Set.__reduce_ex__(protocol) - from protocol 2 on, pickle the elements with
+   their hashes for _set_from_hashed (see Hashed pickling) */
+static PyObject *Set_reduce_ex(Set *self, PyObject *arg) {
+    long protocol = PyLong_AsLong(arg);
+    if (protocol == -1 && PyErr_Occurred()) return NULL;
+    if (protocol < 2 || Py_TYPE(self) != &SetType) {
+        return Set_reduce(self, NULL);
+    }
+    return MapNode_reduce_hashed(self->root, self->cnt, 1, protocol);
+}
+
+/* Set.from_iterable(iterable) - build a set in bulk */
+static PyObject *Set_from_iterable(PyObject *cls, PyObject *iterable) {
+    if (PyObject_TypeCheck(iterable, &SetType)) {
+        Py_INCREF(iterable);
+        return iterable;
+    }
+    Py_ssize_t n, cnt;
+    MapBuildEntry *e = MapBuild_collect(iterable, 1, "Set.from_iterable", &n);
+    if (!e) return NULL;
+    PyObject *root = MapBuild_root(e, n, &cnt);
+    if (!root) {
+        if (PyErr_Occurred()) return NULL;
+        Py_INCREF(EMPTY_SET);
+        return (PyObject *)EMPTY_SET;
+    }
+    Set *result = Set_create(cnt, root, NULL);
+    Py_DECREF(root);
+    return (PyObject *)result;
+}
+
+static PyMethodDef Set_methods[] = {
+    {"from_iterable", (PyCFunction)Set_from_iterable, METH_O | METH_CLASS, "Build a set in bulk from an iterable"},
+    {"conj", (PyCFunction)Set_conj, METH_O, "Add element to set"},
+    {"disj", (PyCFunction)Set_disj, METH_O, "Remove element from set"},
+    {"transient", (PyCFunction)Set_transient, METH_NOARGS, "Get transient version"},
+    {"to_seq", (PyCFunction)Set_to_seq, METH_NOARGS, "Convert to Cons sequence"},
+    {"copy", (PyCFunction)Set_copy, METH_NOARGS, "Return self (immutable sets don't need copying)"},
+    {"isdisjoint", (PyCFunction)Set_isdisjoint, METH_O, "Return True if no common elements with other"},
+    {"reduce", (PyCFunction)Set_reduce_fn, METH_VARARGS, "Reduce with f(acc, x), walking nodes directly"},
+    {"__reduce__", (PyCFunction)Set_reduce, METH_NOARGS, "Pickle support"},
+    {"__reduce_ex__", (PyCFunction)Set_reduce_ex, METH_O, "Pickle support, keeping element hashes from protocol 2"},
+    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
+     "Return a generic alias for type annotations (e.g., Set[int])"},
+    {NULL}
+};
+
+static PySequenceMethods Set_as_sequence = {
+    .sq_length = (lenfunc)Set_length,
+    .sq_contains = (objobjproc)Set_contains,
+};
+
+static PyNumberMethods Set_as_number = {
+    .nb_or = Set_or,
+    .nb_and = Set_and,
+    .nb_subtract = Set_sub,
+    .nb_xor = Set_xor,
+};
+
+static PyTypeObject SetType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.Set",
+    .tp_doc = "Persistent Hash Set using HAMT",
+    .tp_basicsize = sizeof(Set),
+    .tp_itemsize = 0,
+    .tp_dealloc = (destructor)Set_dealloc,
+    .tp_repr = (reprfunc)Set_repr,
+    .tp_as_number = &Set_as_number,
+    .tp_as_sequence = &Set_as_sequence,
+    .tp_hash = (hashfunc)Set_hash,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_richcompare = (richcmpfunc)Set_richcompare,
+    .tp_iter = (getiterfunc)Set_iter,
+    .tp_methods = Set_methods,
+    .tp_init = (initproc)Set_init,
+    .tp_new = Set_new,
+};
+
+// === TransientSet ===
+struct TransientSet {
+    PyObject_HEAD
+    Py_ssize_t cnt;
+    PyObject *root;
+    PyObject *id;
+};
+
+static void TransientSet_dealloc(TransientSet *self) {
+    Py_XDECREF(self->root);
+    Py_XDECREF(self->id);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Set_transient(Set *self, PyObject *Py_UNUSED(ignored)) {
+    TransientSet *t = PyObject_New(TransientSet, &TransientSetType);
+    if (!t) return NULL;
+
+    t->id = PyObject_New(PyObject, &PdsSentinelType);
+    if (!t->id) {
+        Py_DECREF(t);
+        return NULL;
+    }
+
+    t->cnt = self->cnt;
+    if (self->root != NULL) {
+        if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+            t->root = (PyObject *)BitmapIndexedNode_ensure_editable((BitmapIndexedNode *)self->root, t->id);
+        } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+            t->root = (PyObject *)ArrayNode_ensure_editable((ArrayNode *)self->root, t->id);
+        } else {
+            t->root = (PyObject *)HashCollisionNode_ensure_editable((HashCollisionNode *)self->root, t->id);
+        }
+        if (!t->root) {
+            Py_DECREF(t);
+            return NULL;
+        }
+    } else {
+        t->root = NULL;
+    }
+
+    return (PyObject *)t;
+}
+
+static void TransientSet_ensure_editable(TransientSet *self) {
+    if (self->id == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Transient used after persistent() call");
+    }
+}
+
+static PyObject *TransientSet_conj_mut(TransientSet *self, PyObject *key) {
+    TransientSet_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    PyObject *added_leaf = PyList_New(0);
+    if (!added_leaf) return NULL;
+
+    PyObject *root = self->root ? self->root : (PyObject *)EMPTY_BIN;
+    PyObject *new_root;
+
+    if (PyObject_TypeCheck(root, &BitmapIndexedNodeType)) {
+        new_root = BitmapIndexedNode_assoc((BitmapIndexedNode *)root, 0, h, key, Py_None, added_leaf, self->id);
+    } else if (PyObject_TypeCheck(root, &ArrayNodeType)) {
+        new_root = ArrayNode_assoc((ArrayNode *)root, 0, h, key, Py_None, added_leaf, self->id);
+    } else {
+        new_root = HashCollisionNode_assoc((HashCollisionNode *)root, 0, h, key, Py_None, added_leaf, self->id);
+    }
+
+    if (!new_root) {
+        Py_DECREF(added_leaf);
+        return NULL;
+    }
+
+    if (new_root != self->root) {
+        Py_XDECREF(self->root);
+        self->root = new_root;
+    } else {
+        Py_DECREF(new_root);
+    }
+
+    self->cnt += PyList_Size(added_leaf);
+    Py_DECREF(added_leaf);
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *TransientSet_disj_mut(TransientSet *self, PyObject *key) {
+    TransientSet_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (self->root == NULL) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return NULL;
+
+    // Check if key exists before attempting removal
+    // This is necessary because transient mutation may return the same pointer
+    // even when a modification was made (due to in-place editing)
+    PyObject *found;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        found = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        found = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
+    } else {
+        found = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+    }
+
+    if (!found) {
+        // Error occurred during find
+        return NULL;
+    }
+    if (found == _MISSING) {
+        // Key not in set, nothing to do
+        Py_DECREF(found);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+    Py_DECREF(found);
+
+    // Key exists, perform removal
+    PyObject *new_root;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        new_root = BitmapIndexedNode_dissoc((BitmapIndexedNode *)self->root, 0, h, key, NULL, self->id);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        new_root = ArrayNode_dissoc((ArrayNode *)self->root, 0, h, key, NULL, self->id);
+    } else {
+        new_root = HashCollisionNode_dissoc((HashCollisionNode *)self->root, 0, h, key, NULL, self->id);
+    }
+
+    if (!new_root && PyErr_Occurred()) {
+        return NULL;
+    }
+
+    if (new_root == Py_None) {
+        Py_DECREF(new_root);
+        Py_XDECREF(self->root);
+        self->root = NULL;
+        self->cnt = 0;
+    } else if (new_root != self->root) {
+        Py_XDECREF(self->root);
+        self->root = new_root;
+        self->cnt--;
+    } else {
+        // Same pointer returned due to in-place mutation, but key was removed
+        Py_DECREF(new_root);
+        self->cnt--;
+    }
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *TransientSet_persistent(TransientSet *self, PyObject *Py_UNUSED(ignored)) {
+    TransientSet_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    Py_CLEAR(self->id);
+
+    Set *result = Set_create(self->cnt, self->root, NULL);
+    return (PyObject *)result;
+}
+
+// === TransientSet MutableSet Protocol ===
+
+static Py_ssize_t TransientSet_length(TransientSet *self) {
+    return self->cnt;
+}
+
+static int TransientSet_contains(TransientSet *self, PyObject *key) {
+    TransientSet_ensure_editable(self);
+    if (PyErr_Occurred()) return -1;
+
+    if (self->root == NULL) {
+        return 0;
+    }
+
+    Py_hash_t h = PyObject_Hash(key);
+    if (h == -1 && PyErr_Occurred()) return -1;
+
+    PyObject *result;
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
+    } else {
+        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+    }
+
+    if (!result) return -1;
+
+    int found = (result != _MISSING);
+    Py_DECREF(result);
+    return found;
+}
+
+static PyObject *TransientSet_iter(TransientSet *self) {
+    TransientSet_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    if (self->root == NULL) {
+        // Return empty iterator
+        return PyObject_GetIter(PyTuple_New(0));
+    }
+
+    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
+        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_KEYS);
+    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
+        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_KEYS);
+    } else {
+        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_KEYS);
+    }
+}
+
+// Python set methods: add, discard, remove, clear
+
+static PyObject *TransientSet_add(TransientSet *self, PyObject *key) {
+    // add() is alias for conj_mut but returns None (Python set semantics)
+    PyObject *result = TransientSet_conj_mut(self, key);
+    if (!result) return NULL;
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static PyObject *TransientSet_discard(TransientSet *self, PyObject *key) {
+    // discard() removes key if present, does not raise if missing
+    PyObject *result = TransientSet_disj_mut(self, key);
+    if (!result) return NULL;
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static PyObject *TransientSet_remove(TransientSet *self, PyObject *key) {
+    // remove() raises KeyError if key not present
+    TransientSet_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    // Check if key exists first
+    int found = TransientSet_contains(self, key);
+    if (found < 0) return NULL;  // Error occurred
+
+    if (!found) {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+
+    PyObject *result = TransientSet_disj_mut(self, key);
+    if (!result) return NULL;
+    Py_DECREF(result);
+    Py_RETURN_NONE;
+}
+
+static PyObject *TransientSet_clear(TransientSet *self, PyObject *Py_UNUSED(ignored)) {
+    TransientSet_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
+
+    Py_XDECREF(self->root);
+    self->root = NULL;
+    self->cnt = 0;
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef TransientSet_methods[] = {
+    {"conj_mut", (PyCFunction)TransientSet_conj_mut, METH_O, "Mutably add element"},
+    {"disj_mut", (PyCFunction)TransientSet_disj_mut, METH_O, "Mutably remove element"},
+    {"persistent", (PyCFunction)TransientSet_persistent, METH_NOARGS, "Return persistent set"},
+    {"add", (PyCFunction)TransientSet_add, METH_O, "Add element to set"},
+    {"discard", (PyCFunction)TransientSet_discard, METH_O, "Remove element if present"},
+    {"remove", (PyCFunction)TransientSet_remove, METH_O, "Remove element, raise KeyError if missing"},
+    {"clear", (PyCFunction)TransientSet_clear, METH_NOARGS, "Remove all elements"},
     {NULL}
 };
 
-static PySequenceMethods Map_as_sequence = {
-    .sq_contains = (objobjproc)Map_contains,
-};
+static PySequenceMethods TransientSet_as_sequence = {
+    .sq_length = (lenfunc)TransientSet_length,
+    .sq_contains = (objobjproc)TransientSet_contains,
+};
+
+static PyTypeObject TransientSetType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.TransientSet",
+    .tp_doc = "Transient set for batch operations",
+    .tp_basicsize = sizeof(TransientSet),
+    .tp_dealloc = (destructor)TransientSet_dealloc,
+    .tp_as_sequence = &TransientSet_as_sequence,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = (getiterfunc)TransientSet_iter,
+    .tp_methods = TransientSet_methods,
+};
+
+// === SortedVector (Persistent B+tree with order statistics) ===
+//
+// Elements live in leaves of up to SORTED_WIDTH entries, each beside its
+// cached sort key. Branches keep every child's largest key for routing and
+// the cumulative element counts below each child for positional access, so
+// a lookup touches one node per level. Equal keys keep insertion order.
+//
+// Keys are specialized per tree: when every key is an exact int that fits
+// in 64 bits or every key is an exact float, nodes hold them unboxed and
+// compare them directly; exact str keys stay objects but skip rich
+// comparison. Any other key turns the tree generic, once.
+
+#define SORTED_WIDTH 32
+#define SORTED_MIN (SORTED_WIDTH / 2)
+#define SORTED_MAX_DEPTH 32
+
+// Which edges of the tree a node lies on, for append-friendly splits
+#define SORTED_EDGE_FIRST 1
+#define SORTED_EDGE_LAST 2
+
+// How a tree stores its sort keys
+#define SORTED_KEYS_OBJECT 0  // any objects, rich comparison
+#define SORTED_KEYS_INT 1     // exact ints as int64_t
+#define SORTED_KEYS_FLOAT 2   // exact floats as double
+#define SORTED_KEYS_STR 3     // exact str objects
+
+// Whether keys of a kind are object references
+#define SORTED_KEYS_OWNED(kind) ((kind) == SORTED_KEYS_OBJECT || (kind) == SORTED_KEYS_STR)
+
+typedef union {
+    PyObject *obj;
+    int64_t i;
+    double f;
+} SortedKey;
+
+static const SortedKey SORTED_NO_KEY = {NULL};
+
+typedef struct SortedNode {
+    PyObject_HEAD
+    int count;                      // entries (leaf) or children (branch)
+    int leaf;
+    int kind;                       // SORTED_KEYS_*, shared by the whole tree
+    Py_ssize_t size;                // elements below this node
+    Py_ssize_t *sizes;              // branch only: cumulative sizes of children
+    SortedKey keys[SORTED_WIDTH];   // leaf: sort keys; branch: each child's largest key
+    PyObject *items[SORTED_WIDTH];  // leaf: values; branch: child SortedNodes
+    PyObject *edit;                 // For transient support (NULL = persistent)
+} SortedNode;
+
+static PyTypeObject SortedNodeType;
+
+static void SortedNode_dealloc(SortedNode *self) {
+    int owned = SORTED_KEYS_OWNED(self->kind);
+    for (int i = 0; i < self->count; i++) {
+        if (owned) Py_XDECREF(self->keys[i].obj);
+        Py_XDECREF(self->items[i]);
+    }
+    PyMem_Free(self->sizes);
+    Py_XDECREF(self->edit);
+    pds_recycle(PDS_FL(sorted_node), (PyObject *)self, &SortedNodeType);
+}
+
+static SortedNode *SortedNode_create(int leaf, int kind, PyObject *edit) {
+    SortedNode *node = (SortedNode *)pds_alloc(PDS_FL(sorted_node), &SortedNodeType);
+    if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_SORTED);
+
+    node->count = 0;
+    node->leaf = leaf;
+    node->kind = kind;
+    node->size = 0;
+    node->sizes = NULL;
+    node->edit = edit;
+    Py_XINCREF(edit);
+    if (!leaf) {
+        node->sizes = PyMem_Malloc(SORTED_WIDTH * sizeof(Py_ssize_t));
+        if (!node->sizes) {
+            Py_DECREF(node);
+            PyErr_NoMemory();
+            return NULL;
+        }
+    }
+
+    return node;
+}
+
+// Clone a node (for persistent operations)
+static SortedNode *SortedNode_clone(SortedNode *node, PyObject *edit) {
+    SortedNode *new_node = SortedNode_create(node->leaf, node->kind, edit);
+    if (!new_node) return NULL;
+    PDS_STAT_COPY(PDS_NODE_SORTED);
+
+    int owned = SORTED_KEYS_OWNED(node->kind);
+    for (int i = 0; i < node->count; i++) {
+        new_node->keys[i] = node->keys[i];
+        if (owned) Py_XINCREF(new_node->keys[i].obj);
+        new_node->items[i] = node->items[i];
+        Py_INCREF(new_node->items[i]);
+    }
+    new_node->count = node->count;
+    new_node->size = node->size;
+    if (!node->leaf) {
+        memcpy(new_node->sizes, node->sizes, node->count * sizeof(Py_ssize_t));
+    }
+
+    return new_node;
+}
+
+static int SortedNode_is_editable(SortedNode *node, PyObject *edit) {
+    return edit && node->edit == edit;
+}
+
+// Ensure node is editable (clone if necessary)
+static SortedNode *SortedNode_ensure_editable(SortedNode *node, PyObject *edit) {
+    if (SortedNode_is_editable(node, edit)) {
+        Py_INCREF(node);
+        return node;
+    }
+    return SortedNode_clone(node, edit);
+}
+
+static PyTypeObject SortedNodeType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.SortedNode",
+    .tp_doc = "Sorted vector B+tree node (internal)",
+    .tp_basicsize = sizeof(SortedNode),
+    .tp_dealloc = (destructor)SortedNode_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+};
+
+// Whether key a sorts strictly before key b; -1 on error
+static int SortedVector_key_less(PyObject *a, PyObject *b, int reverse) {
+    return PyObject_RichCompareBool(a, b, reverse ? Py_GT : Py_LT);
+}
+
+// Code point order of two exact str objects
+static int SortedKey_str_less(PyObject *a, PyObject *b) {
+    if (PyUnicode_KIND(a) == PyUnicode_1BYTE_KIND && PyUnicode_KIND(b) == PyUnicode_1BYTE_KIND) {
+        Py_ssize_t la = PyUnicode_GET_LENGTH(a), lb = PyUnicode_GET_LENGTH(b);
+        int c = memcmp(PyUnicode_DATA(a), PyUnicode_DATA(b), la < lb ? la : lb);
+        return c < 0 || (c == 0 && la < lb);
+    }
+    return PyUnicode_Compare(a, b) < 0;
+}
+
+// Whether stored key a sorts strictly before b in a tree of the given kind; -1 on error
+static inline int SortedKey_less(int kind, SortedKey a, SortedKey b, int reverse) {
+    switch (kind) {
+    case SORTED_KEYS_INT:
+        return reverse ? b.i < a.i : a.i < b.i;
+    case SORTED_KEYS_FLOAT:
+        return reverse ? b.f < a.f : a.f < b.f;
+    case SORTED_KEYS_STR:
+        return reverse ? SortedKey_str_less(b.obj, a.obj) : SortedKey_str_less(a.obj, b.obj);
+    default:
+        return SortedVector_key_less(a.obj, b.obj, reverse);
+    }
+}
+
+// The kind of tree a first key would start
+static int SortedKey_kind_of(PyObject *key) {
+    if (PyLong_CheckExact(key)) {
+        int overflow;
+        PyLong_AsLongLongAndOverflow(key, &overflow);
+        return overflow ? SORTED_KEYS_OBJECT : SORTED_KEYS_INT;
+    }
+    if (PyFloat_CheckExact(key)) return SORTED_KEYS_FLOAT;
+    if (PyUnicode_CheckExact(key)) return SORTED_KEYS_STR;
+    return SORTED_KEYS_OBJECT;
+}
+
+// Key of a kind as an object (new reference)
+static PyObject *SortedKey_box(int kind, SortedKey key) {
+    switch (kind) {
+    case SORTED_KEYS_INT:
+        return PyLong_FromLongLong(key.i);
+    case SORTED_KEYS_FLOAT:
+        return PyFloat_FromDouble(key.f);
+    default:
+        Py_INCREF(key.obj);
+        return key.obj;
+    }
+}
+
+// A sort key being looked up or inserted in a tree of a given kind. Keys
+// with no exact form in that kind (2.5 among int keys, say) stay boxed and
+// compare against boxed copies of the stored keys.
+typedef struct {
+    SortedKey key;  // obj is borrowed
+    int kind;
+    int boxed;
+} SortedProbe;
+
+static void SortedProbe_init(SortedProbe *p, int kind, PyObject *key) {
+    p->kind = kind;
+    p->boxed = 0;
+    p->key.obj = key;
+    if (kind == SORTED_KEYS_INT) {
+        int overflow = 1;
+        if (PyLong_CheckExact(key)) {
+            long long v = PyLong_AsLongLongAndOverflow(key, &overflow);
+            if (!overflow) p->key.i = v;
+        } else if (PyFloat_CheckExact(key)) {
+            // Integral floats inside the int64 range equal an int key
+            double d = PyFloat_AS_DOUBLE(key);
+            if (d >= -9223372036854775808.0 && d < 9223372036854775808.0 && d == (double)(int64_t)d) {
+                p->key.i = (int64_t)d;
+                overflow = 0;
+            }
+        }
+        p->boxed = overflow;
+    } else if (kind == SORTED_KEYS_FLOAT) {
+        if (PyFloat_CheckExact(key)) {
+            p->key.f = PyFloat_AS_DOUBLE(key);
+        } else {
+            // Ints up to 2**53 convert to a double exactly
+            int overflow = 1;
+            long long v = PyLong_CheckExact(key) ? PyLong_AsLongLongAndOverflow(key, &overflow) : 0;
+            p->boxed = overflow || v > (1LL << 53) || v < -(1LL << 53);
+            if (!p->boxed) p->key.f = (double)v;
+        }
+    } else if (kind == SORTED_KEYS_STR) {
+        p->boxed = !PyUnicode_CheckExact(key);
+    }
+}
+
+// Whether the probe sorts before key (after: key before the probe); -1 on error
+static int SortedProbe_less(const SortedProbe *p, SortedKey key, int reverse, int after) {
+    if (!p->boxed) {
+        return after ? SortedKey_less(p->kind, key, p->key, reverse)
+                     : SortedKey_less(p->kind, p->key, key, reverse);
+    }
+    PyObject *stored = SortedKey_box(p->kind, key);
+    if (!stored) return -1;
+    int rc = after ? SortedVector_key_less(stored, p->key.obj, reverse)
+                   : SortedVector_key_less(p->key.obj, stored, reverse);
+    Py_DECREF(stored);
+    return rc;
+}
+
+// First slot whose key is >= the probe (upper: > the probe); -1 on error
+static int SortedNode_search(SortedNode *node, const SortedProbe *p, int reverse, int upper) {
+    int lo = 0, hi = node->count;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        int past = SortedProbe_less(p, node->keys[mid], reverse, !upper);
+        if (past < 0) return -1;
+        if (upper ? !past : past) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Recompute a node's size and, for a branch, its children's bounds and
+// cumulative sizes. Every child must be non-empty.
+static void SortedNode_refresh(SortedNode *node) {
+    if (node->leaf) {
+        node->size = node->count;
+        return;
+    }
+    Py_ssize_t total = 0;
+    for (int i = 0; i < node->count; i++) {
+        SortedNode *child = (SortedNode *)node->items[i];
+        total += child->size;
+        node->sizes[i] = total;
+        SortedKey bound = child->keys[child->count - 1];
+        if (!SORTED_KEYS_OWNED(node->kind)) {
+            node->keys[i] = bound;
+        } else if (node->keys[i].obj != bound.obj) {
+            Py_INCREF(bound.obj);
+            Py_XSETREF(node->keys[i].obj, bound.obj);
+        }
+    }
+    node->size = total;
+}
+
+// Open slot pos in an editable node with room, taking ownership of key and item
+static void SortedNode_put(SortedNode *node, int pos, SortedKey key, PyObject *item) {
+    int tail = node->count - pos;
+    memmove(&node->keys[pos + 1], &node->keys[pos], tail * sizeof(SortedKey));
+    memmove(&node->items[pos + 1], &node->items[pos], tail * sizeof(PyObject *));
+    node->keys[pos] = key;
+    node->items[pos] = item;
+    node->count++;
+}
+
+// Drop slot pos of an editable node
+static void SortedNode_drop(SortedNode *node, int pos) {
+    if (SORTED_KEYS_OWNED(node->kind)) Py_XDECREF(node->keys[pos].obj);
+    Py_DECREF(node->items[pos]);
+    int tail = node->count - pos - 1;
+    memmove(&node->keys[pos], &node->keys[pos + 1], tail * sizeof(SortedKey));
+    memmove(&node->items[pos], &node->items[pos + 1], tail * sizeof(PyObject *));
+    node->count--;
+}
+
+// Move the last n slots of a onto the front of b (both editable)
+static void SortedNode_shift_right(SortedNode *a, SortedNode *b, int n) {
+    memmove(&b->keys[n], &b->keys[0], b->count * sizeof(SortedKey));
+    memmove(&b->items[n], &b->items[0], b->count * sizeof(PyObject *));
+    memcpy(&b->keys[0], &a->keys[a->count - n], n * sizeof(SortedKey));
+    memcpy(&b->items[0], &a->items[a->count - n], n * sizeof(PyObject *));
+    a->count -= n;
+    b->count += n;
+}
+
+// Move the first n slots of b onto the end of a (both editable)
+static void SortedNode_shift_left(SortedNode *a, SortedNode *b, int n) {
+    memcpy(&a->keys[a->count], &b->keys[0], n * sizeof(SortedKey));
+    memcpy(&a->items[a->count], &b->items[0], n * sizeof(PyObject *));
+    memmove(&b->keys[0], &b->keys[n], (b->count - n) * sizeof(SortedKey));
+    memmove(&b->items[0], &b->items[n], (b->count - n) * sizeof(PyObject *));
+    a->count += n;
+    b->count -= n;
+}
+
+// Insert key and item (references taken) at pos of an editable node. A full
+// node splits and stores its new right sibling in *split: in half, or with
+// the old entries kept together when appending past the last edge of the
+// tree (or prepending before the first), so ordered loads fill every node.
+static int SortedNode_insert_at(SortedNode *node, int pos, SortedKey key, PyObject *item,
+                                int edge, PyObject *edit, SortedNode **split) {
+    *split = NULL;
+    if (node->count < SORTED_WIDTH) {
+        SortedNode_put(node, pos, key, item);
+        return 0;
+    }
+
+    SortedNode *right = SortedNode_create(node->leaf, node->kind, edit);
+    if (!right) {
+        if (SORTED_KEYS_OWNED(node->kind)) Py_XDECREF(key.obj);
+        Py_DECREF(item);
+        return -1;
+    }
+    int mid = SORTED_WIDTH / 2;
+    if (pos == SORTED_WIDTH && (edge & SORTED_EDGE_LAST)) {
+        mid = SORTED_WIDTH;
+    } else if (pos == 0 && (edge & SORTED_EDGE_FIRST)) {
+        mid = 0;
+    }
+    SortedNode_shift_right(node, right, SORTED_WIDTH - mid);
+    if (pos > mid || pos == SORTED_WIDTH) {
+        SortedNode_put(right, pos - mid, key, item);
+    } else {
+        SortedNode_put(node, pos, key, item);
+    }
+    SortedNode_refresh(right);
+    *split = right;
+    return 0;
+}
+
+// Insert value under key after any equal keys in the subtree at node.
+// Returns the edited subtree, its new right sibling in *split if it had
+// to split, or NULL on error.
+static SortedNode *SortedNode_insert(SortedNode *node, const SortedProbe *key, PyObject *value,
+                                     int reverse, int edge, PyObject *edit, SortedNode **split) {
+    *split = NULL;
+    int pos = SortedNode_search(node, key, reverse, 1);
+    if (pos < 0) return NULL;
+
+    SortedNode *child = NULL, *child_split = NULL;
+    if (!node->leaf) {
+        // The first child whose largest key sorts after key, else the last
+        if (pos == node->count) pos--;
+        int child_edge = (pos == 0 ? edge & SORTED_EDGE_FIRST : 0) |
+                         (pos == node->count - 1 ? edge & SORTED_EDGE_LAST : 0);
+        child = SortedNode_insert((SortedNode *)node->items[pos], key, value, reverse,
+                                  child_edge, edit, &child_split);
+        if (!child) return NULL;
+    }
+
+    SortedNode *result = SortedNode_ensure_editable(node, edit);
+    if (!result) {
+        Py_XDECREF(child);
+        Py_XDECREF(child_split);
+        return NULL;
+    }
+
+    int rc = 0;
+    if (node->leaf) {
+        if (SORTED_KEYS_OWNED(key->kind)) Py_INCREF(key->key.obj);
+        Py_INCREF(value);
+        rc = SortedNode_insert_at(result, pos, key->key, value, edge, edit, split);
+    } else {
+        Py_SETREF(result->items[pos], (PyObject *)child);
+        if (child_split) {
+            rc = SortedNode_insert_at(result, pos + 1, SORTED_NO_KEY, (PyObject *)child_split,
+                                      edge, edit, split);
+        }
+    }
+    if (rc < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    SortedNode_refresh(result);
+    return result;
+}
+
+// Insert a key of the tree's kind into the tree at root (may be NULL);
+// returns the new root
+static SortedNode *SortedNode_root_insert_probe(SortedNode *root, const SortedProbe *key,
+                                                PyObject *value, int reverse, PyObject *edit) {
+    if (!root) {
+        SortedNode *leaf = SortedNode_create(1, key->kind, edit);
+        if (!leaf) return NULL;
+        if (SORTED_KEYS_OWNED(key->kind)) Py_INCREF(key->key.obj);
+        Py_INCREF(value);
+        SortedNode_put(leaf, 0, key->key, value);
+        SortedNode_refresh(leaf);
+        return leaf;
+    }
+
+    SortedNode *split;
+    SortedNode *new_root = SortedNode_insert(root, key, value, reverse,
+                                             SORTED_EDGE_FIRST | SORTED_EDGE_LAST, edit, &split);
+    if (!new_root || !split) return new_root;
+
+    // Grow a level
+    SortedNode *branch = SortedNode_create(0, root->kind, edit);
+    if (!branch) {
+        Py_DECREF(new_root);
+        Py_DECREF(split);
+        return NULL;
+    }
+    SortedNode_put(branch, 0, SORTED_NO_KEY, (PyObject *)new_root);
+    SortedNode_put(branch, 1, SORTED_NO_KEY, (PyObject *)split);
+    SortedNode_refresh(branch);
+    return branch;
+}
+
+static SortedNode *SortedNode_generalize(SortedNode *root);
+
+// Insert into the tree at root (may be NULL); returns the new root. A key
+// the tree's kind cannot hold first turns the tree generic.
+static SortedNode *SortedNode_root_insert(SortedNode *root, PyObject *key, PyObject *value,
+                                          int reverse, PyObject *edit) {
+    SortedProbe probe;
+    SortedProbe_init(&probe, root ? root->kind : SortedKey_kind_of(key), key);
+    if (!probe.boxed) return SortedNode_root_insert_probe(root, &probe, value, reverse, edit);
+
+    SortedNode *generic = SortedNode_generalize(root);
+    if (!generic) return NULL;
+    SortedProbe_init(&probe, SORTED_KEYS_OBJECT, key);
+    SortedNode *new_root = SortedNode_root_insert_probe(generic, &probe, value, reverse, edit);
+    Py_DECREF(generic);
+    return new_root;
+}
+
+// Top up or merge the underfull child at pos of an editable branch with a
+// neighbour; children stay non-empty unless merged away
+static int SortedNode_rebalance(SortedNode *node, int pos, PyObject *edit) {
+    int l = pos + 1 < node->count ? pos : pos - 1;
+    SortedNode *a = SortedNode_ensure_editable((SortedNode *)node->items[l], edit);
+    if (!a) return -1;
+    Py_SETREF(node->items[l], (PyObject *)a);
+    SortedNode *b = SortedNode_ensure_editable((SortedNode *)node->items[l + 1], edit);
+    if (!b) return -1;
+    Py_SETREF(node->items[l + 1], (PyObject *)b);
+
+    int total = a->count + b->count;
+    if (total <= SORTED_WIDTH) {
+        SortedNode_shift_left(a, b, b->count);
+        SortedNode_refresh(a);
+        SortedNode_drop(node, l + 1);
+        return 0;
+    }
+    if (a->count < total / 2) {
+        SortedNode_shift_left(a, b, total / 2 - a->count);
+    } else {
+        SortedNode_shift_right(a, b, a->count - total / 2);
+    }
+    SortedNode_refresh(a);
+    SortedNode_refresh(b);
+    return 0;
+}
+
+// Remove the first element under node whose key sorts equal to key and
+// whose value equals value. Returns 1 with the edited subtree in *out
+// (possibly underfull or empty), 0 if there is no such element, -1 on error.
+static int SortedNode_remove(SortedNode *node, const SortedProbe *key, PyObject *value, int reverse,
+                             PyObject *edit, SortedNode **out) {
+    int pos = SortedNode_search(node, key, reverse, 0);
+    if (pos < 0) return -1;
+
+    for (; pos < node->count; pos++) {
+        // Slots from pos on sort at or after key, so a slot equal to key is
+        // one that key does not sort before
+        int after = SortedProbe_less(key, node->keys[pos], reverse, 0);
+        if (after < 0) return -1;
+
+        if (node->leaf) {
+            if (after) return 0;
+            int eq = PyObject_RichCompareBool(value, node->items[pos], Py_EQ);
+            if (eq < 0) return -1;
+            if (!eq) continue;
+            SortedNode *result = SortedNode_ensure_editable(node, edit);
+            if (!result) return -1;
+            SortedNode_drop(result, pos);
+            SortedNode_refresh(result);
+            *out = result;
+            return 1;
+        }
+
+        SortedNode *child;
+        int rc = SortedNode_remove((SortedNode *)node->items[pos], key, value, reverse, edit, &child);
+        if (rc < 0) return -1;
+        if (rc == 0) {
+            // Equal keys run on into the next child only if this one ends with one
+            if (after) return 0;
+            continue;
+        }
+
+        SortedNode *result = SortedNode_ensure_editable(node, edit);
+        if (!result) {
+            Py_DECREF(child);
+            return -1;
+        }
+        Py_SETREF(result->items[pos], (PyObject *)child);
+        if (child->count == 0) {
+            SortedNode_drop(result, pos);
+        } else if (child->count < SORTED_MIN && result->count > 1) {
+            if (SortedNode_rebalance(result, pos, edit) < 0) {
+                Py_DECREF(result);
+                return -1;
+            }
+        }
+        SortedNode_refresh(result);
+        *out = result;
+        return 1;
+    }
+    return 0;
+}
+
+// Remove from the tree at root; *new_root gets the new root (NULL once
+// empty). Returns 1 if an element was removed, 0 if absent, -1 on error.
+static int SortedNode_root_remove(SortedNode *root, PyObject *key, PyObject *value, int reverse,
+                                  PyObject *edit, SortedNode **new_root) {
+    if (!root) return 0;
+    SortedProbe probe;
+    SortedProbe_init(&probe, root->kind, key);
+    SortedNode *result;
+    int rc = SortedNode_remove(root, &probe, value, reverse, edit, &result);
+    if (rc <= 0) return rc;
+
+    // Shrink a level while the root has a single child
+    while (result->count == 1 && !result->leaf) {
+        SortedNode *child = (SortedNode *)result->items[0];
+        Py_INCREF(child);
+        Py_SETREF(result, child);
+    }
+    if (result->count == 0) {
+        Py_CLEAR(result);
+    }
+    *new_root = result;
+    return 1;
+}
+
+// Element at index, which must be in range (borrowed)
+static PyObject *SortedNode_nth(SortedNode *node, Py_ssize_t index) {
+    while (!node->leaf) {
+        int i = 0;
+        while (node->sizes[i] <= index) i++;
+        if (i > 0) index -= node->sizes[i - 1];
+        node = (SortedNode *)node->items[i];
+    }
+    return node->items[index];
+}
+
+// === SortedVector cursor (a root-to-leaf path with slot indexes) ===
+
+typedef struct {
+    SortedNode *path[SORTED_MAX_DEPTH];
+    int index[SORTED_MAX_DEPTH];
+    int depth;       // levels on the path; 0 once exhausted
+    Py_ssize_t pos;  // position of the current element in the vector
+} SortedCursor;
+
+// Park at the start of node's subtree from level d down
+static void SortedCursor_descend(SortedCursor *c, SortedNode *node, int d) {
+    for (;;) {
+        c->path[d] = node;
+        c->index[d] = 0;
+        if (node->leaf) break;
+        node = (SortedNode *)node->items[0];
+        d++;
+    }
+    c->depth = d + 1;
+}
+
+static void SortedCursor_first(SortedCursor *c, SortedNode *root) {
+    c->pos = 0;
+    c->depth = 0;
+    if (root) SortedCursor_descend(c, root, 0);
+}
+
+// Position at the first element whose key is >= key (upper: > key)
+static int SortedCursor_seek(SortedCursor *c, SortedNode *root, PyObject *key, int reverse, int upper) {
+    c->pos = 0;
+    c->depth = 0;
+    if (!root) return 0;
+    SortedProbe probe;
+    SortedProbe_init(&probe, root->kind, key);
+    for (int d = 0; root; d++) {
+        int i = SortedNode_search(root, &probe, reverse, upper);
+        if (i < 0) return -1;
+        if (i == root->count) {
+            // Only the root can lack a slot at or after key: past the end
+            c->pos += root->size;
+            c->depth = 0;
+            return 0;
+        }
+        if (!root->leaf && i > 0) c->pos += root->sizes[i - 1];
+        if (root->leaf) c->pos += i;
+        c->path[d] = root;
+        c->index[d] = i;
+        c->depth = d + 1;
+        root = root->leaf ? NULL : (SortedNode *)root->items[i];
+    }
+    return 0;
+}
+
+static SortedKey SortedCursor_key(SortedCursor *c) {
+    return c->path[c->depth - 1]->keys[c->index[c->depth - 1]];
+}
+
+static PyObject *SortedCursor_value(SortedCursor *c) {
+    return c->path[c->depth - 1]->items[c->index[c->depth - 1]];
+}
+
+// Step to the next element
+static void SortedCursor_advance(SortedCursor *c) {
+    int d = c->depth - 1;
+    c->pos++;
+    if (++c->index[d] < c->path[d]->count) return;
+    while (d > 0 && c->index[d] >= c->path[d]->count) {
+        d--;
+        c->index[d]++;
+    }
+    if (c->index[d] >= c->path[d]->count) {
+        c->depth = 0;
+        return;
+    }
+    SortedCursor_descend(c, (SortedNode *)c->path[d]->items[c->index[d]], d + 1);
+}
+
+// Position at the element with the given index, which must be in range
+static void SortedCursor_seek_index(SortedCursor *c, SortedNode *root, Py_ssize_t index) {
+    c->pos = index;
+    int d = 0;
+    for (SortedNode *node = root;; d++) {
+        int i = 0;
+        if (node->leaf) {
+            i = (int)index;
+        } else {
+            while (node->sizes[i] <= index) i++;
+            if (i > 0) index -= node->sizes[i - 1];
+        }
+        c->path[d] = node;
+        c->index[d] = i;
+        if (node->leaf) break;
+        node = (SortedNode *)node->items[i];
+    }
+    c->depth = d + 1;
+}
+
+// === SortedVector bulk construction ===
+
+typedef struct {
+    SortedKey key;
+    PyObject *value;
+} SortedEntry;
+
+static void SortedEntry_clear(SortedEntry *e, Py_ssize_t n, int kind) {
+    int owned = SORTED_KEYS_OWNED(kind);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (owned) Py_DECREF(e[i].key.obj);
+        Py_DECREF(e[i].value);
+    }
+    PyMem_Free(e);
+}
+
+// Elements of iterable with their sort keys, owned, stored in the most
+// specific kind that holds them all (*kind); NULL on error
+static SortedEntry *SortedEntry_collect(PyObject *iterable, PyObject *key_fn, Py_ssize_t *n, int *kind) {
+    PyObject *seq = PySequence_Fast(iterable, "sorted_vec expects an iterable");
+    if (!seq) return NULL;
+    Py_ssize_t len = PySequence_Fast_GET_SIZE(seq);
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+
+    SortedEntry *e = PyMem_Malloc((len + 1) * sizeof(SortedEntry));
+    if (!e) {
+        Py_DECREF(seq);
+        return (SortedEntry *)PyErr_NoMemory();
+    }
+    *n = 0;
+    *kind = SORTED_KEYS_OBJECT;
+    for (Py_ssize_t i = 0; i < len; i++) {
+        PyObject *key = items[i];
+        if (key_fn) {
+            key = PyObject_CallOneArg(key_fn, items[i]);
+            if (!key) {
+                Py_DECREF(seq);
+                SortedEntry_clear(e, *n, SORTED_KEYS_OBJECT);
+                return NULL;
+            }
+        } else {
+            Py_INCREF(key);
+        }
+        int k = SortedKey_kind_of(key);
+        if (i == 0) {
+            *kind = k;
+        } else if (k != *kind) {
+            *kind = SORTED_KEYS_OBJECT;
+        }
+        e[*n].key.obj = key;
+        e[*n].value = items[i];
+        Py_INCREF(items[i]);
+        (*n)++;
+    }
+    Py_DECREF(seq);
+
+    if (!SORTED_KEYS_OWNED(*kind)) {
+        for (Py_ssize_t i = 0; i < *n; i++) {
+            PyObject *key = e[i].key.obj;
+            SortedProbe probe;
+            SortedProbe_init(&probe, *kind, key);
+            e[i].key = probe.key;
+            Py_DECREF(key);
+        }
+    }
+    return e;
+}
+
+// Stable sort by key. Already ordered input is detected in one pass and
+// left alone; anything else goes through a bottom-up merge sort.
+static int SortedEntry_sort(SortedEntry *e, Py_ssize_t n, int kind, int reverse) {
+    Py_ssize_t i = 1;
+    for (; i < n; i++) {
+        int less = SortedKey_less(kind, e[i].key, e[i - 1].key, reverse);
+        if (less < 0) return -1;
+        if (less) break;
+    }
+    if (i >= n) return 0;
+
+    SortedEntry *buf = PyMem_Malloc(n * sizeof(SortedEntry));
+    if (!buf) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    SortedEntry *src = e, *dst = buf;
+    for (Py_ssize_t width = 1; width < n; width *= 2) {
+        for (Py_ssize_t lo = 0; lo < n; lo += 2 * width) {
+            Py_ssize_t mid = lo + width < n ? lo + width : n;
+            Py_ssize_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            Py_ssize_t a = lo, b = mid, k = lo;
+            while (a < mid && b < hi) {
+                // Take from the right run only when strictly smaller, for stability
+                int less = SortedKey_less(kind, src[b].key, src[a].key, reverse);
+                if (less < 0) {
+                    // src still holds every entry once, so e stays clearable
+                    if (src != e) memcpy(e, src, n * sizeof(SortedEntry));
+                    PyMem_Free(buf);
+                    return -1;
+                }
+                dst[k++] = less ? src[b++] : src[a++];
+            }
+            while (a < mid) dst[k++] = src[a++];
+            while (b < hi) dst[k++] = src[b++];
+        }
+        SortedEntry *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != e) memcpy(e, src, n * sizeof(SortedEntry));
+    PyMem_Free(buf);
+    return 0;
+}
+
+// Box the keys of n entries of an unboxed kind in place
+static int SortedEntry_generalize(SortedEntry *e, Py_ssize_t n, int kind) {
+    if (SORTED_KEYS_OWNED(kind)) return 0;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *key = SortedKey_box(kind, e[i].key);
+        if (!key) {
+            // Unbox what was done so the entries stay of their kind
+            for (Py_ssize_t j = 0; j < i; j++) {
+                PyObject *boxed = e[j].key.obj;
+                SortedProbe probe;
+                SortedProbe_init(&probe, kind, boxed);
+                e[j].key = probe.key;
+                Py_DECREF(boxed);
+            }
+            return -1;
+        }
+        e[i].key.obj = key;
+    }
+    return 0;
+}
+
+// Build a tree over n > 0 sorted entries (borrowed) bottom-up, spreading
+// each level evenly so every node but a lone root is at least half full
+static SortedNode *SortedNode_build(SortedEntry *e, Py_ssize_t n, int kind) {
+    Py_ssize_t len = (n + SORTED_WIDTH - 1) / SORTED_WIDTH;
+    SortedNode **nodes = PyMem_Malloc(len * sizeof(SortedNode *));
+    if (!nodes) return (SortedNode *)PyErr_NoMemory();
+
+    int owned = SORTED_KEYS_OWNED(kind);
+    Py_ssize_t live = 0, next = 0;
+    for (; live < len; live++) {
+        SortedNode *leaf = SortedNode_create(1, kind, NULL);
+        if (!leaf) goto error;
+        Py_ssize_t take = n / len + (live < n % len);
+        for (Py_ssize_t j = 0; j < take; j++, next++) {
+            if (owned) Py_INCREF(e[next].key.obj);
+            Py_INCREF(e[next].value);
+            SortedNode_put(leaf, (int)j, e[next].key, e[next].value);
+        }
+        SortedNode_refresh(leaf);
+        nodes[live] = leaf;
+    }
+
+    // Parents overwrite the front of nodes[] as their children are consumed
+    while (len > 1) {
+        Py_ssize_t parents = (len + SORTED_WIDTH - 1) / SORTED_WIDTH;
+        next = 0;
+        for (Py_ssize_t p = 0; p < parents; p++) {
+            SortedNode *branch = SortedNode_create(0, kind, NULL);
+            if (!branch) {
+                for (Py_ssize_t i = 0; i < p; i++) Py_DECREF(nodes[i]);
+                for (Py_ssize_t i = next; i < len; i++) Py_DECREF(nodes[i]);
+                PyMem_Free(nodes);
+                return NULL;
+            }
+            Py_ssize_t take = len / parents + (p < len % parents);
+            for (Py_ssize_t j = 0; j < take; j++, next++) {
+                SortedNode_put(branch, (int)j, SORTED_NO_KEY, (PyObject *)nodes[next]);
+            }
+            SortedNode_refresh(branch);
+            nodes[p] = branch;
+        }
+        len = parents;
+    }
+
+    SortedNode *root = nodes[0];
+    PyMem_Free(nodes);
+    return root;
+
+error:
+    for (Py_ssize_t i = 0; i < live; i++) Py_DECREF(nodes[i]);
+    PyMem_Free(nodes);
+    return NULL;
+}
+
+// Entries of the tree at root with their keys as stored (borrowed)
+static SortedEntry *SortedEntry_from_tree(SortedNode *root) {
+    Py_ssize_t n = root->size;
+    SortedEntry *e = PyMem_Malloc(n * sizeof(SortedEntry));
+    if (!e) return (SortedEntry *)PyErr_NoMemory();
+    SortedCursor c;
+    SortedCursor_first(&c, root);
+    for (Py_ssize_t i = 0; i < n; i++, SortedCursor_advance(&c)) {
+        e[i].key = SortedCursor_key(&c);
+        e[i].value = SortedCursor_value(&c);
+    }
+    return e;
+}
+
+// A generic copy of the non-empty tree at root, for keys its kind cannot hold
+static SortedNode *SortedNode_generalize(SortedNode *root) {
+    if (root->kind == SORTED_KEYS_OBJECT) {
+        Py_INCREF(root);
+        return root;
+    }
+
+    Py_ssize_t n = root->size;
+    SortedEntry *e = SortedEntry_from_tree(root);
+    if (!e) return NULL;
+    SortedNode *result = NULL;
+    if (root->kind == SORTED_KEYS_STR || SortedEntry_generalize(e, n, root->kind) == 0) {
+        result = SortedNode_build(e, n, SORTED_KEYS_OBJECT);
+        if (root->kind != SORTED_KEYS_STR) {
+            for (Py_ssize_t i = 0; i < n; i++) Py_DECREF(e[i].key.obj);
+        }
+    }
+    PyMem_Free(e);
+    return result;
+}
+
+// Subtree of node holding its elements [start, end), at node's height.
+// Boundary children are topped up from their neighbours so that only the
+// edges of the result can be underfull.
+static SortedNode *SortedNode_slice(SortedNode *node, Py_ssize_t start, Py_ssize_t end) {
+    if (start == 0 && end == node->size) {
+        Py_INCREF(node);
+        return node;
+    }
+
+    SortedNode *result = SortedNode_create(node->leaf, node->kind, NULL);
+    if (!result) return NULL;
+
+    if (node->leaf) {
+        for (Py_ssize_t i = start; i < end; i++) {
+            if (SORTED_KEYS_OWNED(node->kind)) Py_INCREF(node->keys[i].obj);
+            Py_INCREF(node->items[i]);
+            SortedNode_put(result, result->count, node->keys[i], node->items[i]);
+        }
+        SortedNode_refresh(result);
+        return result;
+    }
+
+    int first = 0;
+    while (node->sizes[first] <= start) first++;
+    int last = first;
+    while (node->sizes[last] < end) last++;
+
+    for (int i = first; i <= last; i++) {
+        Py_ssize_t off = i > 0 ? node->sizes[i - 1] : 0;
+        SortedNode *child = (SortedNode *)node->items[i];
+        Py_ssize_t s = i == first ? start - off : 0;
+        Py_ssize_t t = i == last ? end - off : child->size;
+        SortedNode *part = SortedNode_slice(child, s, t);
+        if (!part) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        SortedNode_put(result, result->count, SORTED_NO_KEY, (PyObject *)part);
+    }
+
+    // Rebalancing may merge the two boundary children into one
+    if (result->count > 1 && ((SortedNode *)result->items[0])->count < SORTED_MIN &&
+        SortedNode_rebalance(result, 0, NULL) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    int tail = result->count - 1;
+    if (tail > 0 && ((SortedNode *)result->items[tail])->count < SORTED_MIN &&
+        SortedNode_rebalance(result, tail, NULL) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    SortedNode_refresh(result);
+    return result;
+}
+
+// Tree of the elements [start, end) of the tree at root (NULL if empty)
+static SortedNode *SortedNode_root_slice(SortedNode *root, Py_ssize_t start, Py_ssize_t end) {
+    if (start >= end) return NULL;
 
-static PyMappingMethods Map_as_mapping = {
-    .mp_length = (lenfunc)Map_length,
-    .mp_subscript = (binaryfunc)Map_getitem,
-};
+    // Descend while one child holds the whole range
+    while (!root->leaf) {
+        int i = 0;
+        while (root->sizes[i] <= start) i++;
+        if (root->sizes[i] < end) break;
+        if (i > 0) {
+            start -= root->sizes[i - 1];
+            end -= root->sizes[i - 1];
+        }
+        root = (SortedNode *)root->items[i];
+    }
 
-static PyTypeObject MapType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.Map",
-    .tp_doc = "Persistent Hash Map using HAMT",
-    .tp_basicsize = sizeof(Map),
-    .tp_itemsize = 0,
-    .tp_dealloc = (destructor)Map_dealloc,
-    .tp_repr = (reprfunc)Map_repr,
-    .tp_as_number = &Map_as_number,
-    .tp_as_sequence = &Map_as_sequence,
-    .tp_as_mapping = &Map_as_mapping,
-    .tp_hash = (hashfunc)Map_hash,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_richcompare = (richcmpfunc)Map_richcompare,
-    .tp_iter = (getiterfunc)Map_iter,
-    .tp_methods = Map_methods,
-    .tp_new = Map_new,
-};
+    SortedNode *result = SortedNode_slice(root, start, end);
+    while (result && !result->leaf && result->count == 1) {
+        SortedNode *child = (SortedNode *)result->items[0];
+        Py_INCREF(child);
+        Py_SETREF(result, child);
+    }
+    return result;
+}
 
-// === TransientMap ===
-typedef struct TransientMap {
+// === SortedVector ===
+
+typedef struct SortedVector {
     PyObject_HEAD
+    SortedNode *root;
     Py_ssize_t cnt;
-    PyObject *root;
-    PyObject *id;
-} TransientMap;
+    PyObject *key_fn;    // Optional key function (NULL = use element itself)
+    int reverse;         // Sort in descending order
+} SortedVector;
 
-static void TransientMap_dealloc(TransientMap *self) {
+static PyTypeObject SortedVectorType;
+
+static void SortedVector_dealloc(SortedVector *self) {
     Py_XDECREF(self->root);
-    Py_XDECREF(self->id);
+    Py_XDECREF(self->key_fn);
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-static PyObject *Map_transient(Map *self, PyObject *Py_UNUSED(ignored)) {
-    TransientMap *t = PyObject_New(TransientMap, &TransientMapType);
-    if (!t) return NULL;
-
-    t->id = PyObject_New(PyObject, &PdsSentinelType);
-    if (!t->id) {
-        Py_DECREF(t);
-        return NULL;
+static PyObject *SortedVector_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    SortedVector *self = (SortedVector *)type->tp_alloc(type, 0);
+    if (self) {
+        self->root = NULL;
+        self->cnt = 0;
+        self->key_fn = NULL;
+        self->reverse = 0;
     }
+    return (PyObject *)self;
+}
 
-    t->cnt = self->cnt;
-    if (self->root != NULL) {
-        if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-            t->root = (PyObject *)BitmapIndexedNode_ensure_editable((BitmapIndexedNode *)self->root, t->id);
-        } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-            t->root = (PyObject *)ArrayNode_ensure_editable((ArrayNode *)self->root, t->id);
-        } else {
-            t->root = (PyObject *)HashCollisionNode_ensure_editable((HashCollisionNode *)self->root, t->id);
-        }
-        if (!t->root) {
-            Py_DECREF(t);
-            return NULL;
-        }
-    } else {
-        t->root = NULL;
+// Get the sort key for a value
+static PyObject *SortedVector_get_sort_key(SortedVector *self, PyObject *value) {
+    if (self->key_fn && self->key_fn != Py_None) {
+        return PyObject_CallOneArg(self->key_fn, value);
     }
-
-    return (PyObject *)t;
+    Py_INCREF(value);
+    return value;
 }
 
-static void TransientMap_ensure_editable(TransientMap *self) {
-    if (self->id == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "Transient used after persistent() call");
+// A SortedVector sharing self's key function and order around root (stolen)
+static PyObject *SortedVector_derive(SortedVector *self, SortedNode *root, Py_ssize_t cnt) {
+    SortedVector *result = PyObject_New(SortedVector, &SortedVectorType);
+    if (!result) {
+        Py_XDECREF(root);
+        return NULL;
     }
+
+    result->root = root;
+    result->cnt = cnt;
+    result->key_fn = self->key_fn;
+    Py_XINCREF(result->key_fn);
+    result->reverse = self->reverse;
+
+    return (PyObject *)result;
 }
 
-// Internal C API - no argument parsing overhead
-static PyObject *TransientMap_assoc_mut_impl(TransientMap *self, PyObject *key, PyObject *val) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+// conj: Add element maintaining sorted order
+static PyObject *SortedVector_conj(SortedVector *self, PyObject *value) {
+    PyObject *sort_key = SortedVector_get_sort_key(self, value);
+    if (!sort_key) return NULL;
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+    SortedNode *new_root = SortedNode_root_insert(self->root, sort_key, value, self->reverse, NULL);
+    Py_DECREF(sort_key);
+    if (!new_root) return NULL;
 
-    PyObject *added_leaf = PyList_New(0);
-    if (!added_leaf) return NULL;
+    return SortedVector_derive(self, new_root, self->cnt + 1);
+}
 
-    PyObject *root = self->root ? self->root : (PyObject *)EMPTY_BIN;
-    PyObject *new_root;
+// nth: Get element at index (O(log n))
+static PyObject *SortedVector_nth(SortedVector *self, PyObject *args) {
+    Py_ssize_t index;
+    PyObject *default_val = NULL;
 
-    if (PyObject_TypeCheck(root, &BitmapIndexedNodeType)) {
-        new_root = BitmapIndexedNode_assoc((BitmapIndexedNode *)root, 0, h, key, val, added_leaf, self->id);
-    } else if (PyObject_TypeCheck(root, &ArrayNodeType)) {
-        new_root = ArrayNode_assoc((ArrayNode *)root, 0, h, key, val, added_leaf, self->id);
-    } else {
-        new_root = HashCollisionNode_assoc((HashCollisionNode *)root, 0, h, key, val, added_leaf, self->id);
+    if (!PyArg_ParseTuple(args, "n|O", &index, &default_val)) {
+        return NULL;
     }
 
-    if (!new_root) {
-        Py_DECREF(added_leaf);
+    // Handle negative indices
+    if (index < 0) {
+        index += self->cnt;
+    }
+
+    if (index < 0 || index >= self->cnt) {
+        if (default_val) {
+            Py_INCREF(default_val);
+            return default_val;
+        }
+        PyErr_SetString(PyExc_IndexError, "index out of range");
         return NULL;
     }
 
-    if (new_root != self->root) {
-        Py_XDECREF(self->root);
-        self->root = new_root;
-    } else {
-        Py_DECREF(new_root);
+    PyObject *value = SortedNode_nth(self->root, index);
+    Py_INCREF(value);
+    return value;
+}
+
+static PyObject *SortedVector_slice(SortedVector *self, Py_ssize_t start, Py_ssize_t end);
+
+static PyObject *SortedVector_getitem(SortedVector *self, PyObject *key) {
+    if (PySlice_Check(key)) {
+        Py_ssize_t start, stop, step;
+        if (PySlice_Unpack(key, &start, &stop, &step) < 0) return NULL;
+        Py_ssize_t n = PySlice_AdjustIndices(self->cnt, &start, &stop, step);
+        if (step == 1) return SortedVector_slice(self, start, start + n);
+        if (step < 0) {
+            PyErr_SetString(PyExc_ValueError, "SortedVector slices cannot reverse the order");
+            return NULL;
+        }
+        if (n == 0) return SortedVector_slice(self, 0, 0);
+
+        // Every step-th element, still in order (entries borrowed)
+        SortedEntry *e = PyMem_Malloc(n * sizeof(SortedEntry));
+        if (!e) return PyErr_NoMemory();
+        SortedCursor c;
+        for (Py_ssize_t i = 0; i < n; i++) {
+            SortedCursor_seek_index(&c, self->root, start + i * step);
+            e[i].key = SortedCursor_key(&c);
+            e[i].value = SortedCursor_value(&c);
+        }
+        SortedNode *root = SortedNode_build(e, n, self->root->kind);
+        PyMem_Free(e);
+        if (!root) return NULL;
+        return SortedVector_derive(self, root, n);
     }
 
-    self->cnt += PyList_Size(added_leaf);
-    Py_DECREF(added_leaf);
+    if (PyLong_Check(key)) {
+        Py_ssize_t index = PyLong_AsSsize_t(key);
+        if (index == -1 && PyErr_Occurred()) return NULL;
 
-    Py_INCREF(self);
-    return (PyObject *)self;
-}
+        if (index < 0) index += self->cnt;
 
-// Python wrapper - parses arguments then calls impl
-static PyObject *TransientMap_assoc_mut(TransientMap *self, PyObject *args) {
-    PyObject *key, *val;
-    if (!PyArg_ParseTuple(args, "OO", &key, &val)) {
-        return NULL;
+        if (index < 0 || index >= self->cnt) {
+            PyErr_SetString(PyExc_IndexError, "index out of range");
+            return NULL;
+        }
+
+        PyObject *value = SortedNode_nth(self->root, index);
+        Py_INCREF(value);
+        return value;
     }
-    return TransientMap_assoc_mut_impl(self, key, val);
+
+    PyErr_SetString(PyExc_TypeError, "indices must be integers");
+    return NULL;
 }
 
-static PyObject *TransientMap_dissoc_mut(TransientMap *self, PyObject *key) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+static Py_ssize_t SortedVector_length(SortedVector *self) {
+    return self->cnt;
+}
 
-    if (self->root == NULL) {
-        Py_INCREF(self);
-        return (PyObject *)self;
+// first: Get minimum element
+static PyObject *SortedVector_first(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->cnt == 0) {
+        Py_RETURN_NONE;
     }
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+    SortedNode *node = self->root;
+    while (!node->leaf) {
+        node = (SortedNode *)node->items[0];
+    }
 
-    PyObject *removed_leaf = PyList_New(0);
-    if (!removed_leaf) return NULL;
+    Py_INCREF(node->items[0]);
+    return node->items[0];
+}
 
-    PyObject *new_root;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        new_root = BitmapIndexedNode_dissoc((BitmapIndexedNode *)self->root, 0, h, key, removed_leaf, self->id);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        new_root = ArrayNode_dissoc((ArrayNode *)self->root, 0, h, key, removed_leaf, self->id);
-    } else {
-        new_root = HashCollisionNode_dissoc((HashCollisionNode *)self->root, 0, h, key, removed_leaf, self->id);
+// last: Get maximum element
+static PyObject *SortedVector_last(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
+    if (self->cnt == 0) {
+        Py_RETURN_NONE;
     }
 
-    if (!new_root && PyErr_Occurred()) {
-        Py_DECREF(removed_leaf);
-        return NULL;
+    SortedNode *node = self->root;
+    while (!node->leaf) {
+        node = (SortedNode *)node->items[node->count - 1];
     }
 
-    // Check if a key was actually removed using the removed_leaf flag
-    int key_was_removed = PyList_Size(removed_leaf) > 0;
-    Py_DECREF(removed_leaf);
+    Py_INCREF(node->items[node->count - 1]);
+    return node->items[node->count - 1];
+}
 
-    if (new_root != self->root) {
-        // Root changed
-        if (new_root == Py_None) {
-            // Map is now empty
-            Py_DECREF(new_root);
-            Py_XDECREF(self->root);
-            self->root = NULL;
-            self->cnt = 0;
-        } else {
-            Py_XDECREF(self->root);
-            self->root = new_root;
-            if (key_was_removed) {
-                self->cnt--;
-            }
-        }
-    } else if (new_root) {
-        // Root unchanged, but key might have been removed via in-place mutation
-        Py_DECREF(new_root);
-        if (key_was_removed) {
-            self->cnt--;
+// Index of the first element whose key equals sort_key, -1 if none, -2 on error
+static Py_ssize_t SortedVector_find(SortedVector *self, PyObject *sort_key) {
+    SortedCursor c;
+    if (SortedCursor_seek(&c, self->root, sort_key, self->reverse, 0) < 0) return -2;
+    if (c.depth == 0) return -1;
+
+    SortedProbe probe;
+    SortedProbe_init(&probe, self->root->kind, sort_key);
+    int after = SortedProbe_less(&probe, SortedCursor_key(&c), self->reverse, 0);
+    if (after < 0) return -2;
+    return after ? -1 : c.pos;
+}
+
+static PyObject *SortedVector_index_of(SortedVector *self, PyObject *value) {
+    PyObject *sort_key = SortedVector_get_sort_key(self, value);
+    if (!sort_key) return NULL;
+
+    Py_ssize_t index = SortedVector_find(self, sort_key);
+    Py_DECREF(sort_key);
+
+    if (index == -2) return NULL;  // Error occurred
+
+    return PyLong_FromSsize_t(index);
+}
+
+// contains: Check if element exists
+static int SortedVector_contains(SortedVector *self, PyObject *value) {
+    if (self->cnt == 0) return 0;
+
+    PyObject *sort_key = SortedVector_get_sort_key(self, value);
+    if (!sort_key) return -1;
+
+    // Scan the run of equal keys for an equal value
+    SortedCursor c;
+    SortedProbe probe;
+    SortedProbe_init(&probe, self->root->kind, sort_key);
+    int result = SortedCursor_seek(&c, self->root, sort_key, self->reverse, 0);
+    while (result == 0 && c.depth > 0) {
+        int after = SortedProbe_less(&probe, SortedCursor_key(&c), self->reverse, 0);
+        if (after != 0) {
+            result = after < 0 ? -1 : 0;
+            break;
         }
+        result = PyObject_RichCompareBool(value, SortedCursor_value(&c), Py_EQ);
+        if (result != 0) break;
+        SortedCursor_advance(&c);
     }
+    Py_DECREF(sort_key);
 
-    Py_INCREF(self);
-    return (PyObject *)self;
+    return result;
 }
 
-static PyObject *TransientMap_persistent(TransientMap *self, PyObject *Py_UNUSED(ignored)) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
-
-    Py_CLEAR(self->id);
-
-    Map *result = Map_create(self->cnt, self->root, NULL);
-    return (PyObject *)result;
-}
+// rank: Count of elements less than given value
+static PyObject *SortedVector_rank(SortedVector *self, PyObject *value) {
+    PyObject *sort_key = SortedVector_get_sort_key(self, value);
+    if (!sort_key) return NULL;
 
-// === TransientMap MutableMapping Protocol ===
+    SortedCursor c;
+    int rc = SortedCursor_seek(&c, self->root, sort_key, self->reverse, 0);
+    Py_DECREF(sort_key);
 
-static Py_ssize_t TransientMap_length(TransientMap *self) {
-    return self->cnt;
+    if (rc < 0) return NULL;
+    return PyLong_FromSsize_t(c.pos);
 }
 
-static PyObject *TransientMap_getitem(TransientMap *self, PyObject *key) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
-
-    if (self->root == NULL) {
-        PyErr_SetObject(PyExc_KeyError, key);
-        return NULL;
-    }
+// === SortedVector Iterator (in-order traversal) ===
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+typedef struct SortedVectorIterator {
+    PyObject_HEAD
+    SortedNode *root;  // keeps the cursor's path alive
+    SortedCursor cursor;
+    Py_ssize_t stop;   // position to stop before
+} SortedVectorIterator;
 
-    PyObject *result;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
-    } else {
-        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
-    }
+static PyTypeObject SortedVectorIteratorType;
 
-    if (!result) return NULL;
+static void SortedVectorIterator_dealloc(SortedVectorIterator *self) {
+    Py_XDECREF(self->root);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
 
-    if (result == _MISSING) {
-        Py_DECREF(result);
-        PyErr_SetObject(PyExc_KeyError, key);
-        return NULL;
+static PyObject *SortedVectorIterator_next(SortedVectorIterator *self) {
+    if (self->cursor.depth == 0 || self->cursor.pos >= self->stop) {
+        return NULL;  // StopIteration
     }
 
-    return result;
+    PyObject *value = SortedCursor_value(&self->cursor);
+    Py_INCREF(value);
+    SortedCursor_advance(&self->cursor);
+    return value;
 }
 
-static int TransientMap_ass_subscript(TransientMap *self, PyObject *key, PyObject *val) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return -1;
+static PyTypeObject SortedVectorIteratorType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.SortedVectorIterator",
+    .tp_basicsize = sizeof(SortedVectorIterator),
+    .tp_dealloc = (destructor)SortedVectorIterator_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)SortedVectorIterator_next,
+};
 
-    if (val != NULL) {
-        // Set: t[k] = v
-        PyObject *result = TransientMap_assoc_mut_impl(self, key, val);
-        if (!result) return -1;
-        Py_DECREF(result);
-        return 0;
-    } else {
-        // Delete: del t[k]
-        // First check if key exists (Python semantics require KeyError if missing)
-        Py_hash_t h = PyObject_Hash(key);
-        if (h == -1 && PyErr_Occurred()) return -1;
+static PyObject *SortedVector_iter(SortedVector *self) {
+    SortedVectorIterator *iter = PyObject_New(SortedVectorIterator, &SortedVectorIteratorType);
+    if (!iter) return NULL;
 
-        if (self->root != NULL) {
-            PyObject *found;
-            if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-                found = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
-            } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-                found = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
-            } else {
-                found = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
-            }
+    iter->root = self->root;
+    Py_XINCREF(iter->root);
+    SortedCursor_first(&iter->cursor, self->root);
+    iter->stop = self->cnt;
 
-            if (!found) return -1;
+    return (PyObject *)iter;
+}
 
-            if (found == _MISSING) {
-                Py_DECREF(found);
-                PyErr_SetObject(PyExc_KeyError, key);
-                return -1;
-            }
-            Py_DECREF(found);
-        } else {
-            PyErr_SetObject(PyExc_KeyError, key);
-            return -1;
-        }
+// === SortedVector repr ===
 
-        PyObject *result = TransientMap_dissoc_mut(self, key);
-        if (!result) return -1;
-        Py_DECREF(result);
-        return 0;
+static PyObject *SortedVector_repr(SortedVector *self) {
+    if (self->cnt == 0) {
+        return PyUnicode_FromString("sorted_vec()");
     }
-}
 
-static int TransientMap_contains(TransientMap *self, PyObject *key) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return -1;
+    PyObject *items = PyList_New(0);
+    if (!items) return NULL;
 
-    if (self->root == NULL) {
-        return 0;
+    PyObject *iter = SortedVector_iter(self);
+    if (!iter) {
+        Py_DECREF(items);
+        return NULL;
     }
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return -1;
+    PyObject *item;
+    while ((item = SortedVectorIterator_next((SortedVectorIterator *)iter)) != NULL) {
+        PyObject *repr = PyObject_Repr(item);
+        Py_DECREF(item);
+        if (!repr) {
+            Py_DECREF(iter);
+            Py_DECREF(items);
+            return NULL;
+        }
+        if (PyList_Append(items, repr) < 0) {
+            Py_DECREF(repr);
+            Py_DECREF(iter);
+            Py_DECREF(items);
+            return NULL;
+        }
+        Py_DECREF(repr);
+    }
+    Py_DECREF(iter);
 
-    PyObject *result;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
-    } else {
-        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+    PyObject *sep = PyUnicode_FromString(", ");
+    if (!sep) {
+        Py_DECREF(items);
+        return NULL;
     }
 
-    if (!result) return -1;
+    PyObject *joined = PyUnicode_Join(sep, items);
+    Py_DECREF(sep);
+    Py_DECREF(items);
+    if (!joined) return NULL;
 
-    int found = (result != _MISSING);
-    Py_DECREF(result);
-    return found;
+    PyObject *result = PyUnicode_FromFormat("sorted_vec(%U)", joined);
+    Py_DECREF(joined);
+    return result;
 }
 
-static PyObject *TransientMap_iter(TransientMap *self) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+// === SortedVector hash ===
 
-    if (self->root == NULL) {
-        // Return empty iterator
-        return PyObject_GetIter(PyTuple_New(0));
-    }
+static Py_hash_t SortedVector_hash(SortedVector *self) {
+    Py_hash_t hash = 0x345678;
+    Py_hash_t mult = 1000003;
 
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_KEYS);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_KEYS);
-    } else {
-        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_KEYS);
+    PyObject *iter = SortedVector_iter(self);
+    if (!iter) return -1;
+
+    PyObject *item;
+    while ((item = SortedVectorIterator_next((SortedVectorIterator *)iter)) != NULL) {
+        Py_hash_t item_hash = PyObject_Hash(item);
+        Py_DECREF(item);
+        if (item_hash == -1) {
+            Py_DECREF(iter);
+            return -1;
+        }
+        hash = (hash ^ item_hash) * mult;
+        mult += 82520 + 2 * self->cnt;
     }
-}
+    Py_DECREF(iter);
 
-static PyObject *TransientMap_keys(TransientMap *self, PyObject *Py_UNUSED(ignored)) {
-    return TransientMap_iter(self);
+    hash += 97531;
+    if (hash == -1) hash = -2;
+    return hash;
 }
 
-static PyObject *TransientMap_values(TransientMap *self, PyObject *Py_UNUSED(ignored)) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+// === SortedVector equality ===
 
-    if (self->root == NULL) {
-        return PyObject_GetIter(PyTuple_New(0));
+static PyObject *SortedVector_richcompare(SortedVector *self, PyObject *other, int op) {
+    if (op != Py_EQ && op != Py_NE) {
+        Py_RETURN_NOTIMPLEMENTED;
     }
 
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_VALUES);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_VALUES);
-    } else {
-        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_VALUES);
+    if (!PyObject_TypeCheck(other, &SortedVectorType)) {
+        if (op == Py_EQ) Py_RETURN_FALSE;
+        Py_RETURN_TRUE;
     }
-}
-
-static PyObject *TransientMap_items(TransientMap *self, PyObject *Py_UNUSED(ignored)) {
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
 
-    if (self->root == NULL) {
-        return PyObject_GetIter(PyTuple_New(0));
-    }
+    SortedVector *other_sv = (SortedVector *)other;
 
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_ITEMS);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_ITEMS);
-    } else {
-        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_ITEMS);
+    if (self->cnt != other_sv->cnt) {
+        if (op == Py_EQ) Py_RETURN_FALSE;
+        Py_RETURN_TRUE;
     }
-}
-
-static PyObject *TransientMap_get(TransientMap *self, PyObject *args) {
-    PyObject *key;
-    PyObject *default_val = Py_None;
 
-    if (!PyArg_ParseTuple(args, "O|O", &key, &default_val)) {
+    // Compare elements in order
+    PyObject *iter1 = SortedVector_iter(self);
+    PyObject *iter2 = SortedVector_iter(other_sv);
+    if (!iter1 || !iter2) {
+        Py_XDECREF(iter1);
+        Py_XDECREF(iter2);
         return NULL;
     }
 
-    TransientMap_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+    int equal = 1;
+    PyObject *item1, *item2;
+    while ((item1 = SortedVectorIterator_next((SortedVectorIterator *)iter1)) != NULL) {
+        item2 = SortedVectorIterator_next((SortedVectorIterator *)iter2);
+        if (!item2) {
+            Py_DECREF(item1);
+            equal = 0;
+            break;
+        }
 
-    if (self->root == NULL) {
-        Py_INCREF(default_val);
-        return default_val;
+        int cmp = PyObject_RichCompareBool(item1, item2, Py_EQ);
+        Py_DECREF(item1);
+        Py_DECREF(item2);
+
+        if (cmp < 0) {
+            Py_DECREF(iter1);
+            Py_DECREF(iter2);
+            return NULL;
+        }
+        if (!cmp) {
+            equal = 0;
+            break;
+        }
     }
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+    Py_DECREF(iter1);
+    Py_DECREF(iter2);
 
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, default_val);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_find((ArrayNode *)self->root, 0, h, key, default_val);
+    if (op == Py_EQ) {
+        if (equal) Py_RETURN_TRUE;
+        Py_RETURN_FALSE;
     } else {
-        return HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, default_val);
+        if (equal) Py_RETURN_FALSE;
+        Py_RETURN_TRUE;
     }
 }
 
-static PyMethodDef TransientMap_methods[] = {
-    {"assoc_mut", (PyCFunction)TransientMap_assoc_mut, METH_VARARGS, "Mutably set key to value"},
-    {"dissoc_mut", (PyCFunction)TransientMap_dissoc_mut, METH_O, "Mutably remove key"},
-    {"persistent", (PyCFunction)TransientMap_persistent, METH_NOARGS, "Return persistent map"},
-    {"get", (PyCFunction)TransientMap_get, METH_VARARGS, "Get value for key with optional default"},
-    {"keys", (PyCFunction)TransientMap_keys, METH_NOARGS, "Iterate over keys"},
-    {"values", (PyCFunction)TransientMap_values, METH_NOARGS, "Iterate over values"},
-    {"items", (PyCFunction)TransientMap_items, METH_NOARGS, "Iterate over key-value pairs"},
-    {NULL}
-};
-
-static PySequenceMethods TransientMap_as_sequence = {
-    .sq_contains = (objobjproc)TransientMap_contains,
-};
-
-static PyMappingMethods TransientMap_as_mapping = {
-    .mp_length = (lenfunc)TransientMap_length,
-    .mp_subscript = (binaryfunc)TransientMap_getitem,
-    .mp_ass_subscript = (objobjargproc)TransientMap_ass_subscript,
-};
+// === SortedVector disj (remove element) ===
 
-static PyTypeObject TransientMapType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.TransientMap",
-    .tp_doc = "Transient map for batch operations",
-    .tp_basicsize = sizeof(TransientMap),
-    .tp_dealloc = (destructor)TransientMap_dealloc,
-    .tp_as_sequence = &TransientMap_as_sequence,
-    .tp_as_mapping = &TransientMap_as_mapping,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_iter = (getiterfunc)TransientMap_iter,
-    .tp_methods = TransientMap_methods,
-};
+static PyObject *SortedVector_disj(SortedVector *self, PyObject *value) {
+    if (self->cnt == 0) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
 
-// === Set ===
-// Immutable hash set using HAMT (same structure as Map, but values are always Py_None)
+    PyObject *sort_key = SortedVector_get_sort_key(self, value);
+    if (!sort_key) return NULL;
 
-struct Set {
-    PyObject_HEAD
-    Py_ssize_t cnt;
-    PyObject *root;  // BitmapIndexedNode, ArrayNode, or HashCollisionNode
-    Py_hash_t hash;
-    int hash_computed;
-    PyObject *transient_id;
-};
+    SortedNode *new_root = NULL;
+    int deleted = SortedNode_root_remove(self->root, sort_key, value, self->reverse, NULL, &new_root);
+    Py_DECREF(sort_key);
 
-static PyTypeObject SetType;
-static Set *EMPTY_SET = NULL;
+    if (deleted < 0) return NULL;
+    if (!deleted) {
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
 
-static void Set_dealloc(Set *self) {
-    Py_XDECREF(self->root);
-    Py_XDECREF(self->transient_id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    return SortedVector_derive(self, new_root, self->cnt - 1);
 }
 
-static PyObject *Set_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
-    Set *self = (Set *)type->tp_alloc(type, 0);
-    if (self != NULL) {
-        self->cnt = 0;
-        self->root = NULL;
-        self->hash = 0;
-        self->hash_computed = 0;
-        self->transient_id = NULL;
+// Fill an empty sorted vector from iterable: sort (a single pass when the
+// input is already in order) and build the tree bottom-up
+static int SortedVector_fill(SortedVector *self, PyObject *iterable) {
+    Py_ssize_t n;
+    int kind;
+    SortedEntry *e = SortedEntry_collect(iterable, self->key_fn, &n, &kind);
+    if (!e) return -1;
+
+    int rc = SortedEntry_sort(e, n, kind, self->reverse);
+    if (rc == 0 && n > 0) {
+        self->root = SortedNode_build(e, n, kind);
+        if (self->root) {
+            self->cnt = n;
+        } else {
+            rc = -1;
+        }
     }
-    return (PyObject *)self;
+    SortedEntry_clear(e, n, kind);
+    return rc;
 }
 
-// Forward declarations for Set_init
-static PyObject *Set_conj(Set *self, PyObject *val);
+// === SortedVector init ===
 
-static int Set_init(Set *self, PyObject *args, PyObject *kwds) {
-    Py_ssize_t n = PyTuple_Size(args);
+static int SortedVector_init(SortedVector *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"", "key", "reverse", NULL};
+    PyObject *iterable = NULL;
+    PyObject *key_fn = Py_None;
+    int reverse = 0;
 
-    if (n == 0) {
-        return 0;  // Empty set, already initialized by tp_new
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O$Op", kwlist,
+                                     &iterable, &key_fn, &reverse)) {
+        return -1;
     }
 
-    // Build set by conj'ing each element
-    for (Py_ssize_t i = 0; i < n; i++) {
-        PyObject *item = PyTuple_GET_ITEM(args, i);
-        PyObject *new_set = Set_conj(self, item);
-        if (!new_set) {
-            return -1;
-        }
+    Py_CLEAR(self->root);
+    self->cnt = 0;
+    self->reverse = reverse;
 
-        // Update self from new_set
-        Set *ns = (Set *)new_set;
-        Py_XDECREF(self->root);
-        self->cnt = ns->cnt;
-        self->root = ns->root;
-        Py_XINCREF(self->root);
-        self->hash = 0;
-        self->hash_computed = 0;
-        Py_DECREF(new_set);
+    Py_CLEAR(self->key_fn);
+    if (key_fn != Py_None) {
+        self->key_fn = key_fn;
+        Py_INCREF(key_fn);
+    }
+
+    if (iterable && iterable != Py_None) {
+        return SortedVector_fill(self, iterable);
     }
 
     return 0;
 }
 
-static Set *Set_create(Py_ssize_t cnt, PyObject *root, PyObject *transient_id) {
-    Set *s = (Set *)SetType.tp_alloc(&SetType, 0);
-    if (!s) return NULL;
+// === SortedVector transient ===
 
-    s->cnt = cnt;
-    s->root = root;
-    Py_XINCREF(root);
-    s->hash = 0;
-    s->hash_computed = 0;
-    s->transient_id = transient_id;
-    Py_XINCREF(transient_id);
+typedef struct TransientSortedVector {
+    PyObject_HEAD
+    SortedNode *root;
+    Py_ssize_t cnt;
+    PyObject *key_fn;
+    int reverse;
+    PyObject *id;  // Edit token
+} TransientSortedVector;
 
-    return s;
-}
+static PyTypeObject TransientSortedVectorType;
 
-static Py_ssize_t Set_length(Set *self) {
-    return self->cnt;
+static void TransientSortedVector_dealloc(TransientSortedVector *self) {
+    Py_XDECREF(self->root);
+    Py_XDECREF(self->key_fn);
+    Py_XDECREF(self->id);
+    Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-static int Set_contains(Set *self, PyObject *key) {
-    if (self->root == NULL) {
-        return 0;
+static void TransientSortedVector_ensure_editable(TransientSortedVector *self) {
+    if (!self->id) {
+        PyErr_SetString(PyExc_RuntimeError, "TransientSortedVector already made persistent");
     }
+}
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return -1;
+static PyObject *SortedVector_transient(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
+    TransientSortedVector *t = PyObject_New(TransientSortedVector, &TransientSortedVectorType);
+    if (!t) return NULL;
 
-    PyObject *result;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
-    } else {
-        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
+    t->root = NULL;
+    t->key_fn = NULL;
+    t->id = PyObject_New(PyObject, &PdsSentinelType);
+    if (!t->id) {
+        Py_DECREF(t);
+        return NULL;
     }
 
-    if (!result) return -1;
+    t->root = self->root;
+    Py_XINCREF(t->root);
+    t->cnt = self->cnt;
+    t->key_fn = self->key_fn;
+    Py_XINCREF(t->key_fn);
+    t->reverse = self->reverse;
 
-    int found = (result != _MISSING);
-    Py_DECREF(result);
-    return found;
+    return (PyObject *)t;
 }
 
-static PyObject *Set_conj(Set *self, PyObject *key) {
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+// Get sort key for transient
+static PyObject *TransientSortedVector_get_sort_key(TransientSortedVector *self, PyObject *value) {
+    if (self->key_fn && self->key_fn != Py_None) {
+        return PyObject_CallOneArg(self->key_fn, value);
+    }
+    Py_INCREF(value);
+    return value;
+}
 
-    PyObject *added_leaf = PyList_New(0);
-    if (!added_leaf) return NULL;
+static PyObject *TransientSortedVector_conj_mut(TransientSortedVector *self, PyObject *value) {
+    TransientSortedVector_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
 
-    PyObject *root = self->root ? self->root : (PyObject *)EMPTY_BIN;
-    PyObject *new_root;
+    PyObject *sort_key = TransientSortedVector_get_sort_key(self, value);
+    if (!sort_key) return NULL;
 
-    if (PyObject_TypeCheck(root, &BitmapIndexedNodeType)) {
-        new_root = BitmapIndexedNode_assoc((BitmapIndexedNode *)root, 0, h, key, Py_None, added_leaf, self->transient_id);
-    } else if (PyObject_TypeCheck(root, &ArrayNodeType)) {
-        new_root = ArrayNode_assoc((ArrayNode *)root, 0, h, key, Py_None, added_leaf, self->transient_id);
-    } else {
-        new_root = HashCollisionNode_assoc((HashCollisionNode *)root, 0, h, key, Py_None, added_leaf, self->transient_id);
-    }
+    SortedNode *new_root = SortedNode_root_insert(self->root, sort_key, value, self->reverse, self->id);
+    Py_DECREF(sort_key);
+    if (!new_root) return NULL;
 
-    if (!new_root) {
-        Py_DECREF(added_leaf);
-        return NULL;
-    }
+    Py_XSETREF(self->root, new_root);
+    self->cnt++;
+
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *TransientSortedVector_disj_mut(TransientSortedVector *self, PyObject *value) {
+    TransientSortedVector_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
 
-    if (new_root == self->root) {
-        Py_DECREF(new_root);
-        Py_DECREF(added_leaf);
+    if (self->cnt == 0) {
         Py_INCREF(self);
         return (PyObject *)self;
     }
 
-    Py_ssize_t new_cnt = self->cnt + PyList_Size(added_leaf);
-    Py_DECREF(added_leaf);
+    PyObject *sort_key = TransientSortedVector_get_sort_key(self, value);
+    if (!sort_key) return NULL;
 
-    Set *result = Set_create(new_cnt, new_root, self->transient_id);
-    Py_DECREF(new_root);
-    return (PyObject *)result;
-}
+    SortedNode *new_root = NULL;
+    int deleted = SortedNode_root_remove(self->root, sort_key, value, self->reverse, self->id, &new_root);
+    Py_DECREF(sort_key);
 
-static PyObject *Set_disj(Set *self, PyObject *key) {
-    if (self->root == NULL) {
-        Py_INCREF(self);
-        return (PyObject *)self;
+    if (deleted < 0) return NULL;
+    if (deleted) {
+        Py_XSETREF(self->root, new_root);
+        self->cnt--;
     }
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
 
-    PyObject *new_root;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        new_root = BitmapIndexedNode_dissoc((BitmapIndexedNode *)self->root, 0, h, key, NULL, self->transient_id);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        new_root = ArrayNode_dissoc((ArrayNode *)self->root, 0, h, key, NULL, self->transient_id);
-    } else {
-        new_root = HashCollisionNode_dissoc((HashCollisionNode *)self->root, 0, h, key, NULL, self->transient_id);
-    }
+static PyObject *TransientSortedVector_persistent(TransientSortedVector *self, PyObject *Py_UNUSED(ignored)) {
+    TransientSortedVector_ensure_editable(self);
+    if (PyErr_Occurred()) return NULL;
 
-    if (!new_root) return NULL;
+    SortedVector *result = PyObject_New(SortedVector, &SortedVectorType);
+    if (!result) return NULL;
 
-    if (new_root == self->root) {
-        Py_DECREF(new_root);
-        Py_INCREF(self);
-        return (PyObject *)self;
-    }
+    result->root = self->root;
+    Py_XINCREF(result->root);
+    result->cnt = self->cnt;
+    result->key_fn = self->key_fn;
+    Py_XINCREF(result->key_fn);
+    result->reverse = self->reverse;
 
-    Py_ssize_t new_cnt = (new_root != Py_None) ? self->cnt - 1 : 0;
-    if (new_root == Py_None) {
-        Py_DECREF(new_root);
-        new_root = NULL;
-    }
+    // Invalidate transient
+    Py_CLEAR(self->id);
 
-    Set *result = Set_create(new_cnt, new_root, self->transient_id);
-    Py_XDECREF(new_root);
     return (PyObject *)result;
 }
 
-// SetIterator - yields only keys from the HAMT
-struct SetIterator {
-    PyObject_HEAD
-    PyObject *kv_iter;  // Underlying key-value iterator
-};
-
-static PyTypeObject SetIteratorType;
-
-static void SetIterator_dealloc(SetIterator *self) {
-    Py_XDECREF(self->kv_iter);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+static Py_ssize_t TransientSortedVector_length(TransientSortedVector *self) {
+    return self->cnt;
 }
 
-static PyObject *SetIterator_next(SetIterator *self) {
-    if (!self->kv_iter) return NULL;
-
-    PyObject *pair = PyIter_Next(self->kv_iter);
-    if (!pair) return NULL;  // StopIteration or error
+static PyMethodDef TransientSortedVector_methods[] = {
+    {"conj_mut", (PyCFunction)TransientSortedVector_conj_mut, METH_O, "Mutably add element"},
+    {"disj_mut", (PyCFunction)TransientSortedVector_disj_mut, METH_O, "Mutably remove element"},
+    {"persistent", (PyCFunction)TransientSortedVector_persistent, METH_NOARGS, "Return persistent sorted vector"},
+    {NULL}
+};
 
-    PyObject *key = PyTuple_GET_ITEM(pair, 0);
-    Py_INCREF(key);
-    Py_DECREF(pair);
-    return key;
-}
+static PySequenceMethods TransientSortedVector_as_sequence = {
+    .sq_length = (lenfunc)TransientSortedVector_length,
+};
 
-static PyTypeObject SetIteratorType = {
+static PyTypeObject TransientSortedVectorType = {
     PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.SetIterator",
-    .tp_basicsize = sizeof(SetIterator),
-    .tp_dealloc = (destructor)SetIterator_dealloc,
+    .tp_name = "spork.runtime.pds.TransientSortedVector",
+    .tp_doc = "Transient sorted vector for batch operations",
+    .tp_basicsize = sizeof(TransientSortedVector),
+    .tp_dealloc = (destructor)TransientSortedVector_dealloc,
+    .tp_as_sequence = &TransientSortedVector_as_sequence,
     .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_iter = PyObject_SelfIter,
-    .tp_iternext = (iternextfunc)SetIterator_next,
+    .tp_methods = TransientSortedVector_methods,
 };
 
-static PyObject *Set_iter(Set *self) {
-    if (self->root == NULL) {
-        return PyObject_GetIter(PyList_New(0));
+// === SortedVector ranges and merge ===
+
+// Positions [*start, *end) of the elements whose keys lie between lo and hi
+// (None for unbounded); inclusive is a bool for both ends or a (lo, hi) pair
+static int SortedVector_bounds(SortedVector *self, PyObject *args, PyObject *kwds,
+                               Py_ssize_t *start, Py_ssize_t *end) {
+    static char *kwlist[] = {"lo", "hi", "inclusive", NULL};
+    PyObject *lo = Py_None, *hi = Py_None, *inclusive = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO$O", kwlist, &lo, &hi, &inclusive)) {
+        return -1;
     }
 
-    PyObject *kv_iter;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        kv_iter = BitmapIndexedNode_iter_kv((BitmapIndexedNode *)self->root);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        kv_iter = ArrayNode_iter_kv((ArrayNode *)self->root);
-    } else {
-        kv_iter = HashCollisionNode_iter_kv((HashCollisionNode *)self->root);
+    int lo_inclusive = 1, hi_inclusive = 0;
+    if (inclusive && !PyBool_Check(inclusive) && PySequence_Check(inclusive)) {
+        PyObject *pair = PySequence_Fast(inclusive, "inclusive must be a bool or a (lo, hi) pair");
+        if (!pair) return -1;
+        if (PySequence_Fast_GET_SIZE(pair) != 2) {
+            Py_DECREF(pair);
+            PyErr_SetString(PyExc_ValueError, "inclusive must be a bool or a (lo, hi) pair");
+            return -1;
+        }
+        lo_inclusive = PyObject_IsTrue(PySequence_Fast_GET_ITEM(pair, 0));
+        hi_inclusive = PyObject_IsTrue(PySequence_Fast_GET_ITEM(pair, 1));
+        Py_DECREF(pair);
+    } else if (inclusive) {
+        lo_inclusive = hi_inclusive = PyObject_IsTrue(inclusive);
     }
+    if (lo_inclusive < 0 || hi_inclusive < 0) return -1;
 
-    if (!kv_iter) return NULL;
+    SortedCursor c;
+    *start = 0;
+    *end = self->cnt;
+    if (lo != Py_None) {
+        if (SortedCursor_seek(&c, self->root, lo, self->reverse, !lo_inclusive) < 0) return -1;
+        *start = c.pos;
+    }
+    if (hi != Py_None) {
+        if (SortedCursor_seek(&c, self->root, hi, self->reverse, hi_inclusive) < 0) return -1;
+        *end = c.pos;
+    }
+    if (*end < *start) *end = *start;
+    return 0;
+}
 
-    SetIterator *it = PyObject_New(SetIterator, &SetIteratorType);
-    if (!it) {
-        Py_DECREF(kv_iter);
-        return NULL;
+// Elements [start, end) as a SortedVector sharing all but its boundary paths
+static PyObject *SortedVector_slice(SortedVector *self, Py_ssize_t start, Py_ssize_t end) {
+    if (start == 0 && end == self->cnt) {
+        Py_INCREF(self);
+        return (PyObject *)self;
     }
+    SortedNode *root = SortedNode_root_slice(self->root, start, end);
+    if (!root && PyErr_Occurred()) return NULL;
+    return SortedVector_derive(self, root, root ? end - start : 0);
+}
 
-    it->kv_iter = kv_iter;
-    return (PyObject *)it;
+/* range(lo=None, hi=None, *, inclusive=(True, False)) - elements with keys between lo and hi */
+static PyObject *SortedVector_range(SortedVector *self, PyObject *args, PyObject *kwds) {
+    Py_ssize_t start, end;
+    if (SortedVector_bounds(self, args, kwds, &start, &end) < 0) return NULL;
+    return SortedVector_slice(self, start, end);
 }
 
-// Set operations: union, intersection, difference
+/* subseq(lo=None, hi=None, *, inclusive=(True, False)) - iterate keys between lo and hi */
+static PyObject *SortedVector_subseq(SortedVector *self, PyObject *args, PyObject *kwds) {
+    Py_ssize_t start, end;
+    if (SortedVector_bounds(self, args, kwds, &start, &end) < 0) return NULL;
 
-// Forward declarations for TransientSet functions (defined later)
-static PyTypeObject TransientSetType;
-static PyObject *Set_transient(Set *self, PyObject *Py_UNUSED(ignored));
-static PyObject *TransientSet_conj_mut(TransientSet *self, PyObject *key);
-static PyObject *TransientSet_disj_mut(TransientSet *self, PyObject *key);
-static PyObject *TransientSet_persistent(TransientSet *self, PyObject *Py_UNUSED(ignored));
+    SortedVectorIterator *iter = PyObject_New(SortedVectorIterator, &SortedVectorIteratorType);
+    if (!iter) return NULL;
 
-static PyObject *Set_or(PyObject *left, PyObject *right) {
-    if (!PyObject_TypeCheck(left, &SetType)) {
-        Py_RETURN_NOTIMPLEMENTED;
+    iter->root = self->root;
+    Py_XINCREF(iter->root);
+    iter->cursor.depth = 0;
+    iter->cursor.pos = start;
+    if (start < end) SortedCursor_seek_index(&iter->cursor, self->root, start);
+    iter->stop = end;
+
+    return (PyObject *)iter;
+}
+
+// Below this many elements per element merged in, merge inserts instead
+#define SORTED_MERGE_INSERT_RATIO 32
+
+/* merge(other) - all elements of self and other; equal keys keep self's first */
+static PyObject *SortedVector_merge(SortedVector *self, PyObject *other) {
+    Py_ssize_t m;
+    int kind;
+    SortedEntry *theirs;
+    SortedVector *osv = PyObject_TypeCheck(other, &SortedVectorType) ? (SortedVector *)other : NULL;
+
+    if (osv && osv->key_fn == self->key_fn && osv->reverse == self->reverse) {
+        // Same order: the other vector's cached keys are reused as they are
+        m = osv->cnt;
+        kind = osv->root ? osv->root->kind : SORTED_KEYS_OBJECT;
+        theirs = PyMem_Malloc((m + 1) * sizeof(SortedEntry));
+        if (!theirs) return PyErr_NoMemory();
+        SortedCursor c;
+        SortedCursor_first(&c, osv->root);
+        for (Py_ssize_t i = 0; i < m; i++, SortedCursor_advance(&c)) {
+            theirs[i].key = SortedCursor_key(&c);
+            theirs[i].value = SortedCursor_value(&c);
+            if (SORTED_KEYS_OWNED(kind)) Py_INCREF(theirs[i].key.obj);
+            Py_INCREF(theirs[i].value);
+        }
+    } else {
+        theirs = SortedEntry_collect(other, self->key_fn, &m, &kind);
+        if (!theirs) return NULL;
+        if (SortedEntry_sort(theirs, m, kind, self->reverse) < 0) {
+            SortedEntry_clear(theirs, m, kind);
+            return NULL;
+        }
     }
 
-    Set *self = (Set *)left;
+    if (m == 0) {
+        SortedEntry_clear(theirs, m, kind);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
 
-    // If other is also a Set, iterate directly
-    if (PyObject_TypeCheck(right, &SetType)) {
-        Set *other = (Set *)right;
-        if (other->cnt == 0) {
-            Py_INCREF(self);
-            return (PyObject *)self;
+    // Bring both sides to one key kind
+    SortedNode *mine = self->root;
+    Py_XINCREF(mine);
+    if (mine && mine->kind != kind) {
+        if (SortedEntry_generalize(theirs, m, kind) < 0) {
+            SortedEntry_clear(theirs, m, kind);
+            Py_DECREF(mine);
+            return NULL;
         }
-        if (self->cnt == 0) {
-            Py_INCREF(other);
-            return (PyObject *)other;
+        kind = SORTED_KEYS_OBJECT;
+        Py_SETREF(mine, SortedNode_generalize(mine));
+        if (!mine) {
+            SortedEntry_clear(theirs, m, kind);
+            return NULL;
+        }
+    }
+
+    SortedNode *root = NULL;
+    Py_ssize_t n = self->cnt;
+    if (n == 0) {
+        root = SortedNode_build(theirs, m, kind);
+    } else if (m * SORTED_MERGE_INSERT_RATIO < n) {
+        // A few elements into a large vector: insert each, editing the
+        // copied paths in place
+        PyObject *edit = PyObject_New(PyObject, &PdsSentinelType);
+        if (edit) {
+            root = mine;
+            Py_INCREF(root);
+            for (Py_ssize_t i = 0; root && i < m; i++) {
+                SortedProbe probe = {theirs[i].key, kind, 0};
+                SortedNode *next = SortedNode_root_insert_probe(root, &probe, theirs[i].value,
+                                                                self->reverse, edit);
+                Py_SETREF(root, next);
+            }
+            Py_DECREF(edit);
+        }
+    } else {
+        // Merge the two ordered runs in one pass (entries borrowed)
+        SortedEntry *all = PyMem_Malloc((n + m) * sizeof(SortedEntry));
+        if (!all) {
+            PyErr_NoMemory();
+        } else {
+            SortedCursor c;
+            SortedCursor_first(&c, mine);
+            Py_ssize_t j = 0, k = 0;
+            int less = 0;
+            while (c.depth > 0 && j < m) {
+                less = SortedKey_less(kind, theirs[j].key, SortedCursor_key(&c), self->reverse);
+                if (less < 0) break;
+                if (less) {
+                    all[k++] = theirs[j++];
+                } else {
+                    all[k].key = SortedCursor_key(&c);
+                    all[k++].value = SortedCursor_value(&c);
+                    SortedCursor_advance(&c);
+                }
+            }
+            if (less >= 0) {
+                for (; c.depth > 0; SortedCursor_advance(&c)) {
+                    all[k].key = SortedCursor_key(&c);
+                    all[k++].value = SortedCursor_value(&c);
+                }
+                while (j < m) all[k++] = theirs[j++];
+                root = SortedNode_build(all, n + m, kind);
+            }
+            PyMem_Free(all);
         }
+    }
+    SortedEntry_clear(theirs, m, kind);
+    Py_XDECREF(mine);
 
-        // Use the larger set as base and add elements from smaller
-        Set *base = (self->cnt >= other->cnt) ? self : other;
-        Set *to_add = (self->cnt >= other->cnt) ? other : self;
+    if (!root) return NULL;
+    return SortedVector_derive(self, root, n + m);
+}
 
-        // Create transient from base for efficient mutation
-        TransientSet *trans = (TransientSet *)Set_transient(base, NULL);
-        if (!trans) return NULL;
+// === SortedVector methods table ===
 
-        PyObject *iter = Set_iter(to_add);
-        if (!iter) {
-            Py_DECREF(trans);
+static PyObject *SortedVector_reduce(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
+    // Convert SortedVector to a tuple for the iterable argument
+    PyObject *contents = PySequence_Tuple((PyObject *)self);
+    if (contents == NULL) {
+        return NULL;
+    }
+
+    // Build args tuple: (contents_tuple,)
+    PyObject *args = PyTuple_Pack(1, contents);
+    Py_DECREF(contents);
+    if (args == NULL) {
+        return NULL;
+    }
+
+    // Build kwargs dict with key and reverse
+    PyObject *kwargs = PyDict_New();
+    if (kwargs == NULL) {
+        Py_DECREF(args);
+        return NULL;
+    }
+
+    // Add key function if present
+    if (self->key_fn != NULL) {
+        if (PyDict_SetItemString(kwargs, "key", self->key_fn) < 0) {
+            Py_DECREF(args);
+            Py_DECREF(kwargs);
             return NULL;
         }
+    }
 
-        PyObject *key;
-        while ((key = PyIter_Next(iter)) != NULL) {
-            PyObject *res = TransientSet_conj_mut(trans, key);
-            Py_DECREF(key);
-            if (!res) {
-                Py_DECREF(trans);
-                Py_DECREF(iter);
-                return NULL;
-            }
-            Py_DECREF(res);
+    // Add reverse if True
+    if (self->reverse) {
+        if (PyDict_SetItemString(kwargs, "reverse", Py_True) < 0) {
+            Py_DECREF(args);
+            Py_DECREF(kwargs);
+            return NULL;
         }
-        Py_DECREF(iter);
+    }
+
+    // Get functools.partial to create a callable with kwargs
+    PyObject *functools = PyImport_ImportModule("functools");
+    if (functools == NULL) {
+        Py_DECREF(args);
+        Py_DECREF(kwargs);
+        return NULL;
+    }
+
+    PyObject *partial = PyObject_GetAttrString(functools, "partial");
+    Py_DECREF(functools);
+    if (partial == NULL) {
+        Py_DECREF(args);
+        Py_DECREF(kwargs);
+        return NULL;
+    }
+
+    // Create partial(SortedVector, **kwargs)
+    PyObject *partial_args = PyTuple_Pack(1, (PyObject *)Py_TYPE(self));
+    if (partial_args == NULL) {
+        Py_DECREF(partial);
+        Py_DECREF(args);
+        Py_DECREF(kwargs);
+        return NULL;
+    }
+
+    PyObject *reconstructor = PyObject_Call(partial, partial_args, kwargs);
+    Py_DECREF(partial);
+    Py_DECREF(partial_args);
+    Py_DECREF(kwargs);
 
-        if (PyErr_Occurred()) {
-            Py_DECREF(trans);
-            return NULL;
-        }
+    if (reconstructor == NULL) {
+        Py_DECREF(args);
+        return NULL;
+    }
 
-        PyObject *result = TransientSet_persistent(trans, NULL);
-        Py_DECREF(trans);
-        return result;
+    // Return (partial(SortedVector, **kwargs), (contents_tuple,))
+    PyObject *result = PyTuple_Pack(2, reconstructor, args);
+    Py_DECREF(reconstructor);
+    Py_DECREF(args);
+    return result;
+}
+
+static PyObject *SortedVector_getnewargs_ex(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
+    // Convert SortedVector to a tuple for the iterable argument
+    PyObject *contents = PySequence_Tuple((PyObject *)self);
+    if (contents == NULL) {
+        return NULL;
     }
 
-    // Other is an iterable - use transient for efficient accumulation
-    PyObject *iter = PyObject_GetIter(right);
-    if (!iter) {
-        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
-            PyErr_Clear();
-            Py_RETURN_NOTIMPLEMENTED;
-        }
+    // Build args tuple: (contents_tuple,)
+    PyObject *args = PyTuple_Pack(1, contents);
+    Py_DECREF(contents);
+    if (args == NULL) {
         return NULL;
     }
 
-    TransientSet *trans = (TransientSet *)Set_transient(self, NULL);
-    if (!trans) {
-        Py_DECREF(iter);
+    // Build kwargs dict with key and reverse
+    PyObject *kwargs = PyDict_New();
+    if (kwargs == NULL) {
+        Py_DECREF(args);
         return NULL;
     }
 
-    PyObject *key;
-    while ((key = PyIter_Next(iter)) != NULL) {
-        PyObject *res = TransientSet_conj_mut(trans, key);
-        Py_DECREF(key);
-        if (!res) {
-            Py_DECREF(trans);
-            Py_DECREF(iter);
+    // Add key function if present
+    if (self->key_fn != NULL) {
+        if (PyDict_SetItemString(kwargs, "key", self->key_fn) < 0) {
+            Py_DECREF(args);
+            Py_DECREF(kwargs);
             return NULL;
         }
-        Py_DECREF(res);
     }
-    Py_DECREF(iter);
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(trans);
-        return NULL;
+    // Add reverse if True
+    if (self->reverse) {
+        if (PyDict_SetItemString(kwargs, "reverse", Py_True) < 0) {
+            Py_DECREF(args);
+            Py_DECREF(kwargs);
+            return NULL;
+        }
     }
 
-    PyObject *result = TransientSet_persistent(trans, NULL);
-    Py_DECREF(trans);
+    // Return (args, kwargs) tuple
+    PyObject *result = PyTuple_Pack(2, args, kwargs);
+    Py_DECREF(args);
+    Py_DECREF(kwargs);
     return result;
 }
 
-static PyObject *Set_and(PyObject *left, PyObject *right) {
-    if (!PyObject_TypeCheck(left, &SetType)) {
-        Py_RETURN_NOTIMPLEMENTED;
-    }
+static PyMethodDef SortedVector_methods[] = {
+    {"nth", (PyCFunction)SortedVector_nth, METH_VARARGS, "Get element at index"},
+    {"conj", (PyCFunction)SortedVector_conj, METH_O, "Add element maintaining sorted order"},
+    {"disj", (PyCFunction)SortedVector_disj, METH_O, "Remove element"},
+    {"first", (PyCFunction)SortedVector_first, METH_NOARGS, "Get minimum element"},
+    {"last", (PyCFunction)SortedVector_last, METH_NOARGS, "Get maximum element"},
+    {"index_of", (PyCFunction)SortedVector_index_of, METH_O, "Find index of element"},
+    {"rank", (PyCFunction)SortedVector_rank, METH_O, "Count of elements less than value"},
+    {"range", (PyCFunction)SortedVector_range, METH_VARARGS | METH_KEYWORDS, "Sorted vector of the elements with keys between lo and hi"},
+    {"subseq", (PyCFunction)SortedVector_subseq, METH_VARARGS | METH_KEYWORDS, "Iterate the elements with keys between lo and hi"},
+    {"merge", (PyCFunction)SortedVector_merge, METH_O, "Merge in the elements of another sorted vector or iterable"},
+    {"transient", (PyCFunction)SortedVector_transient, METH_NOARGS, "Get transient version"},
+    {"__reduce__", (PyCFunction)SortedVector_reduce, METH_NOARGS, "Pickle support"},
+    {"__getnewargs_ex__", (PyCFunction)SortedVector_getnewargs_ex, METH_NOARGS, "Pickle support with keyword args"},
+    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
+     "Return a generic alias for type annotations"},
+    {NULL}
+};
 
-    Set *self = (Set *)left;
+static PySequenceMethods SortedVector_as_sequence = {
+    .sq_length = (lenfunc)SortedVector_length,
+    .sq_contains = (objobjproc)SortedVector_contains,
+};
 
-    if (self->cnt == 0) {
-        Py_INCREF(EMPTY_SET);
-        return (PyObject *)EMPTY_SET;
+static PyMappingMethods SortedVector_as_mapping = {
+    .mp_length = (lenfunc)SortedVector_length,
+    .mp_subscript = (binaryfunc)SortedVector_getitem,
+};
+
+static PyTypeObject SortedVectorType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.SortedVector",
+    .tp_doc = "Persistent sorted vector (B+tree)",
+    .tp_basicsize = sizeof(SortedVector),
+    .tp_dealloc = (destructor)SortedVector_dealloc,
+    .tp_repr = (reprfunc)SortedVector_repr,
+    .tp_as_sequence = &SortedVector_as_sequence,
+    .tp_as_mapping = &SortedVector_as_mapping,
+    .tp_hash = (hashfunc)SortedVector_hash,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_iter = (getiterfunc)SortedVector_iter,
+    .tp_richcompare = (richcmpfunc)SortedVector_richcompare,
+    .tp_methods = SortedVector_methods,
+    .tp_new = SortedVector_new,
+    .tp_init = (initproc)SortedVector_init,
+};
+
+// Empty sorted vector constant
+static SortedVector *EMPTY_SORTED_VECTOR = NULL;
+
+// === IntMap / IntSet (persistent containers keyed by unboxed int64) ===
+//
+// A 32-way radix trie over the key bits, most significant chunk first, with
+// the sign bit flipped so unsigned order is numeric order and iteration
+// runs in ascending key order. Nodes are CHAMP-style: one bitmap for the
+// entries stored inline and one for child nodes, compacted into a single
+// allocation. Paths are compressed: each node records the chunk it branches
+// on and the key bits above it, so clustered keys (sequential IDs, say) do
+// not pay for the empty levels above them. A position holding one key keeps
+// it inline, so every node but a root holds at least two entries or
+// children and equal key sets always have the same shape, which lets set
+// algebra run node against node and skip shared subtrees by identity.
+// IntSet uses the same nodes with Py_None values.
+
+#define INTMAP_SIGN 0x8000000000000000ULL
+#define INTMAP_MAX_DEPTH 13  // chunks at shifts 60, 55, ..., 0
+
+// Set algebra operations (see IntMapItem_combine)
+#define INTMAP_UNION 0
+#define INTMAP_AND 1
+#define INTMAP_SUB 2
+
+typedef union {
+    uint64_t key;
+    PyObject *obj;
+} IntMapSlot;
+
+typedef struct IntMapNode {
+    PyObject_VAR_HEAD
+    uint32_t datamap;     // chunks holding an entry inline
+    uint32_t nodemap;     // chunks holding a child node
+    int shift;            // branches on key bits [shift, shift + BITS)
+    uint64_t prefix;      // key bits above the chunk, shared by everything below
+    Py_ssize_t size;      // entries below this node
+    PyObject *edit;       // For transient support (NULL = persistent)
+    IntMapSlot slots[1];  // entry keys, entry values, then children (Py_SIZE slots)
+} IntMapNode;
+
+static PyTypeObject IntMapNodeType;
+
+static inline int clz64(uint64_t x) {
+#ifdef __GNUC__
+    return __builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long i;
+    _BitScanReverse64(&i, x);
+    return 63 - (int)i;
+#else
+    int n = 0;
+    while (!(x & INTMAP_SIGN)) {
+        x <<= 1;
+        n++;
     }
+    return n;
+#endif
+}
 
-    // Use transient for efficient accumulation from empty set
-    TransientSet *trans = (TransientSet *)Set_transient(EMPTY_SET, NULL);
-    if (!trans) return NULL;
+static inline int IntMap_chunk(uint64_t k, int shift) {
+    return (int)((k >> shift) & MASK);
+}
 
-    if (PyObject_TypeCheck(right, &SetType)) {
-        Set *other = (Set *)right;
-        if (other->cnt == 0) {
-            Py_DECREF(trans);
-            Py_INCREF(EMPTY_SET);
-            return (PyObject *)EMPTY_SET;
-        }
+static inline uint64_t IntMap_prefix(uint64_t k, int shift) {
+    return shift + BITS >= 64 ? 0 : k >> (shift + BITS);
+}
 
-        // Iterate over smaller set, check membership in larger
-        Set *smaller = (self->cnt <= other->cnt) ? self : other;
-        Set *larger = (self->cnt <= other->cnt) ? other : self;
+// Shift of the chunk holding the highest set bit of diff (non-zero)
+static inline int IntMap_split_shift(uint64_t diff) {
+    int h = 63 - clz64(diff);
+    return h - h % BITS;
+}
 
-        PyObject *iter = Set_iter(smaller);
-        if (!iter) {
-            Py_DECREF(trans);
-            return NULL;
-        }
+// Smallest key that could lie below n
+static inline uint64_t IntMapNode_base(IntMapNode *n) {
+    return n->shift + BITS >= 64 ? 0 : n->prefix << (n->shift + BITS);
+}
 
-        PyObject *key;
-        while ((key = PyIter_Next(iter)) != NULL) {
-            int found = Set_contains(larger, key);
-            if (found < 0) {
-                Py_DECREF(key);
-                Py_DECREF(iter);
-                Py_DECREF(trans);
-                return NULL;
-            }
-            if (found) {
-                PyObject *res = TransientSet_conj_mut(trans, key);
-                Py_DECREF(key);
-                if (!res) {
-                    Py_DECREF(iter);
-                    Py_DECREF(trans);
-                    return NULL;
-                }
-                Py_DECREF(res);
-            } else {
-                Py_DECREF(key);
-            }
-        }
-        Py_DECREF(iter);
-    } else {
-        // Other is an iterable - check each element against self
-        PyObject *iter = PyObject_GetIter(right);
-        if (!iter) {
-            if (PyErr_ExceptionMatches(PyExc_TypeError)) {
-                PyErr_Clear();
-                Py_DECREF(trans);
-                Py_RETURN_NOTIMPLEMENTED;
-            }
-            Py_DECREF(trans);
-            return NULL;
-        }
+// Shift at which key k leaves n's prefix, or -1 if k falls inside n
+static inline int IntMapNode_split(IntMapNode *n, uint64_t k) {
+    if (n->shift + BITS >= 64) return -1;
+    uint64_t diff = ((k >> (n->shift + BITS)) ^ n->prefix) << (n->shift + BITS);
+    return diff ? IntMap_split_shift(diff) : -1;
+}
 
-        PyObject *key;
-        while ((key = PyIter_Next(iter)) != NULL) {
-            int found = Set_contains(self, key);
-            if (found < 0) {
-                Py_DECREF(key);
-                Py_DECREF(iter);
-                Py_DECREF(trans);
-                return NULL;
-            }
-            if (found) {
-                PyObject *res = TransientSet_conj_mut(trans, key);
-                Py_DECREF(key);
-                if (!res) {
-                    Py_DECREF(iter);
-                    Py_DECREF(trans);
-                    return NULL;
-                }
-                Py_DECREF(res);
-            } else {
-                Py_DECREF(key);
-            }
-        }
-        Py_DECREF(iter);
-    }
+#define INTMAP_VAL(n, i) ((n)->slots[ctpop((n)->datamap) + (i)].obj)
+#define INTMAP_CHILD(n, j) ((n)->slots[2 * ctpop((n)->datamap) + (j)].obj)
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(trans);
-        return NULL;
+static void IntMapNode_dealloc(IntMapNode *self) {
+    for (Py_ssize_t i = ctpop(self->datamap); i < Py_SIZE(self); i++) {
+        Py_XDECREF(self->slots[i].obj);
     }
+    Py_XDECREF(self->edit);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
 
-    PyObject *result = TransientSet_persistent(trans, NULL);
-    Py_DECREF(trans);
-    return result;
+// Allocate a node for the given bitmaps; the caller fills the slots and size
+static IntMapNode *IntMapNode_create(uint32_t datamap, uint32_t nodemap, int shift, uint64_t prefix,
+                                     PyObject *edit) {
+    Py_ssize_t n = 2 * ctpop(datamap) + ctpop(nodemap);
+    IntMapNode *node = PyObject_NewVar(IntMapNode, &IntMapNodeType, n);
+    if (!node) return NULL;
+    PDS_STAT_ALLOC(PDS_NODE_INT_MAP);
+
+    node->datamap = datamap;
+    node->nodemap = nodemap;
+    node->shift = shift;
+    node->prefix = prefix;
+    node->size = 0;
+    memset(node->slots, 0, n * sizeof(IntMapSlot));
+    node->edit = edit;
+    Py_XINCREF(edit);
+    return node;
 }
 
-static PyObject *Set_sub(PyObject *left, PyObject *right) {
-    if (!PyObject_TypeCheck(left, &SetType)) {
-        Py_RETURN_NOTIMPLEMENTED;
+static IntMapNode *IntMapNode_ensure_editable(IntMapNode *n, PyObject *edit) {
+    if (edit && n->edit == edit) {
+        Py_INCREF(n);
+        return n;
+    }
+    IntMapNode *r = IntMapNode_create(n->datamap, n->nodemap, n->shift, n->prefix, edit);
+    if (!r) return NULL;
+    PDS_STAT_COPY(PDS_NODE_INT_MAP);
+    int d = ctpop(n->datamap);
+    memcpy(r->slots, n->slots, Py_SIZE(n) * sizeof(IntMapSlot));
+    for (Py_ssize_t i = d; i < Py_SIZE(n); i++) {
+        Py_INCREF(r->slots[i].obj);
     }
+    r->size = n->size;
+    return r;
+}
 
-    Set *self = (Set *)left;
+// A root holding a single entry
+static IntMapNode *IntMapNode_lone(uint64_t k, PyObject *val, PyObject *edit) {
+    IntMapNode *r = IntMapNode_create(1U << IntMap_chunk(k, 0), 0, 0, IntMap_prefix(k, 0), edit);
+    if (!r) return NULL;
+    r->slots[0].key = k;
+    r->slots[1].obj = val;
+    Py_INCREF(val);
+    r->size = 1;
+    return r;
+}
+
+// Node holding two entries with distinct keys
+static IntMapNode *IntMapNode_pair(uint64_t k1, PyObject *v1, uint64_t k2, PyObject *v2, PyObject *edit) {
+    int shift = IntMap_split_shift(k1 ^ k2);
+    if (k1 > k2) {
+        uint64_t tk = k1;
+        PyObject *tv = v1;
+        k1 = k2;
+        v1 = v2;
+        k2 = tk;
+        v2 = tv;
+    }
+    IntMapNode *r = IntMapNode_create((1U << IntMap_chunk(k1, shift)) | (1U << IntMap_chunk(k2, shift)), 0,
+                                      shift, IntMap_prefix(k1, shift), edit);
+    if (!r) return NULL;
+    r->slots[0].key = k1;
+    r->slots[1].key = k2;
+    r->slots[2].obj = v1;
+    r->slots[3].obj = v2;
+    Py_INCREF(v1);
+    Py_INCREF(v2);
+    r->size = 2;
+    return r;
+}
+
+// Copy of n with the position at bit replaced: by the entry (key, val) when
+// val is set, by child when child is set, or left empty. Takes the
+// references to val and child.
+static IntMapNode *IntMapNode_with(IntMapNode *n, uint32_t bit, uint64_t key, PyObject *val,
+                                   IntMapNode *child, PyObject *edit) {
+    uint32_t datamap = (n->datamap & ~bit) | (val ? bit : 0);
+    uint32_t nodemap = (n->nodemap & ~bit) | (child ? bit : 0);
+    IntMapNode *r = IntMapNode_create(datamap, nodemap, n->shift, n->prefix, edit);
+    if (!r) {
+        Py_XDECREF(val);
+        Py_XDECREF(child);
+        return NULL;
+    }
 
-    if (self->cnt == 0) {
-        Py_INCREF(self);
-        return (PyObject *)self;
+    int d = ctpop(n->datamap), rd = ctpop(datamap), k = 0;
+    for (uint32_t m = datamap; m; m &= m - 1, k++) {
+        uint32_t b = m & (~m + 1);
+        if (b == bit) {
+            r->slots[k].key = key;
+            r->slots[rd + k].obj = val;
+        } else {
+            int i = bitmap_index(n->datamap, b);
+            r->slots[k].key = n->slots[i].key;
+            r->slots[rd + k].obj = n->slots[d + i].obj;
+            Py_INCREF(r->slots[rd + k].obj);
+        }
+    }
+    Py_ssize_t size = rd;
+    k = 0;
+    for (uint32_t m = nodemap; m; m &= m - 1, k++) {
+        uint32_t b = m & (~m + 1);
+        PyObject *c = (PyObject *)child;
+        if (b != bit) {
+            c = INTMAP_CHILD(n, bitmap_index(n->nodemap, b));
+            Py_INCREF(c);
+        }
+        r->slots[2 * rd + k].obj = c;
+        size += ((IntMapNode *)c)->size;
     }
+    r->size = size;
+    return r;
+}
 
-    PyObject *iter;
-    if (PyObject_TypeCheck(right, &SetType)) {
-        iter = Set_iter((Set *)right);
-    } else {
-        iter = PyObject_GetIter(right);
+// Value stored under k below n (borrowed), or NULL
+static PyObject *IntMapNode_find(IntMapNode *n, uint64_t k) {
+    while (n) {
+        if (IntMap_prefix(k, n->shift) != n->prefix) return NULL;
+        uint32_t bit = 1U << IntMap_chunk(k, n->shift);
+        if (n->datamap & bit) {
+            int i = bitmap_index(n->datamap, bit);
+            return n->slots[i].key == k ? INTMAP_VAL(n, i) : NULL;
+        }
+        if (!(n->nodemap & bit)) return NULL;
+        n = (IntMapNode *)INTMAP_CHILD(n, bitmap_index(n->nodemap, bit));
     }
+    return NULL;
+}
 
-    if (!iter) {
-        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
-            PyErr_Clear();
-            Py_RETURN_NOTIMPLEMENTED;
+// Set k to val below n, a node holding at least two entries or children.
+// Returns the new subtree (n itself when nothing changed) or NULL on error;
+// *added (zeroed by the caller) is set when k was not present.
+static IntMapNode *IntMapNode_assoc(IntMapNode *n, uint64_t k, PyObject *val, PyObject *edit, int *added) {
+    int split = IntMapNode_split(n, k);
+    if (split >= 0) {
+        // k falls outside n: a new parent holds both
+        uint32_t kbit = 1U << IntMap_chunk(k, split);
+        IntMapNode *r = IntMapNode_create(kbit, 1U << IntMap_chunk(IntMapNode_base(n), split), split,
+                                          IntMap_prefix(k, split), edit);
+        if (!r) return NULL;
+        r->slots[0].key = k;
+        r->slots[1].obj = val;
+        r->slots[2].obj = (PyObject *)n;
+        Py_INCREF(val);
+        Py_INCREF(n);
+        r->size = n->size + 1;
+        *added = 1;
+        return r;
+    }
+
+    uint32_t bit = 1U << IntMap_chunk(k, n->shift);
+    if (n->datamap & bit) {
+        int i = bitmap_index(n->datamap, bit);
+        PyObject *old = INTMAP_VAL(n, i);
+        if (n->slots[i].key == k) {
+            if (old == val) {
+                Py_INCREF(n);
+                return n;
+            }
+            IntMapNode *r = IntMapNode_ensure_editable(n, edit);
+            if (!r) return NULL;
+            Py_INCREF(val);
+            Py_SETREF(INTMAP_VAL(r, i), val);
+            return r;
         }
-        return NULL;
+        // Two keys share the chunk: they move down into a child
+        IntMapNode *child = IntMapNode_pair(n->slots[i].key, old, k, val, edit);
+        if (!child) return NULL;
+        *added = 1;
+        return IntMapNode_with(n, bit, 0, NULL, child, edit);
+    }
+
+    if (n->nodemap & bit) {
+        int j = bitmap_index(n->nodemap, bit);
+        IntMapNode *old = (IntMapNode *)INTMAP_CHILD(n, j);
+        IntMapNode *child = IntMapNode_assoc(old, k, val, edit, added);
+        if (!child) return NULL;
+        if (child == old && !*added) {
+            Py_DECREF(child);
+            Py_INCREF(n);
+            return n;
+        }
+        IntMapNode *r = IntMapNode_ensure_editable(n, edit);
+        if (!r) {
+            Py_DECREF(child);
+            return NULL;
+        }
+        if (child != old) {
+            Py_SETREF(INTMAP_CHILD(r, j), (PyObject *)child);
+        } else {
+            Py_DECREF(child);
+        }
+        r->size += *added;
+        return r;
     }
 
-    // Use transient for efficient mutation
-    TransientSet *trans = (TransientSet *)Set_transient(self, NULL);
-    if (!trans) {
-        Py_DECREF(iter);
-        return NULL;
+    Py_INCREF(val);
+    *added = 1;
+    return IntMapNode_with(n, bit, k, val, NULL, edit);
+}
+
+// Remove k below n. Returns 0 when k is absent, 1 with the new subtree in
+// *out when it was removed, -1 on error. The new subtree is NULL once
+// empty; one left with a single entry is returned as a lone node for the
+// parent to inline, and one left with a single child is that child.
+static int IntMapNode_dissoc(IntMapNode *n, uint64_t k, PyObject *edit, IntMapNode **out) {
+    if (IntMapNode_split(n, k) >= 0) return 0;
+
+    uint32_t bit = 1U << IntMap_chunk(k, n->shift);
+    int things = ctpop(n->datamap) + ctpop(n->nodemap);
+    if (n->datamap & bit) {
+        int i = bitmap_index(n->datamap, bit);
+        if (n->slots[i].key != k) return 0;
+        if (things == 1) {
+            *out = NULL;
+            return 1;
+        }
+        if (things == 2 && n->nodemap) {
+            *out = (IntMapNode *)INTMAP_CHILD(n, 0);
+            Py_INCREF(*out);
+            return 1;
+        }
+        *out = IntMapNode_with(n, bit, 0, NULL, NULL, edit);
+        return *out ? 1 : -1;
     }
+    if (!(n->nodemap & bit)) return 0;
 
-    PyObject *key;
-    while ((key = PyIter_Next(iter)) != NULL) {
-        PyObject *res = TransientSet_disj_mut(trans, key);
-        Py_DECREF(key);
-        if (!res) {
-            Py_DECREF(trans);
-            Py_DECREF(iter);
-            return NULL;
+    // Children hold at least two entries, so one remains
+    int j = bitmap_index(n->nodemap, bit);
+    IntMapNode *child;
+    int rc = IntMapNode_dissoc((IntMapNode *)INTMAP_CHILD(n, j), k, edit, &child);
+    if (rc <= 0) return rc;
+
+    if (child->size == 1) {
+        if (things == 1) {
+            *out = child;
+            return 1;
         }
-        Py_DECREF(res);
+        uint64_t key = child->slots[0].key;
+        PyObject *val = child->slots[1].obj;
+        Py_INCREF(val);
+        Py_DECREF(child);
+        *out = IntMapNode_with(n, bit, key, val, NULL, edit);
+        return *out ? 1 : -1;
     }
-    Py_DECREF(iter);
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(trans);
-        return NULL;
+    IntMapNode *r = IntMapNode_ensure_editable(n, edit);
+    if (!r) {
+        Py_DECREF(child);
+        return -1;
+    }
+    if (child != (IntMapNode *)INTMAP_CHILD(r, j)) {
+        Py_SETREF(INTMAP_CHILD(r, j), (PyObject *)child);
+    } else {
+        Py_DECREF(child);
+    }
+    r->size--;
+    *out = r;
+    return 1;
+}
+
+// Set k to val in the tree at root (may be NULL); returns the new root
+static IntMapNode *IntMapNode_root_assoc(IntMapNode *root, uint64_t k, PyObject *val, PyObject *edit,
+                                         int *added) {
+    *added = 0;
+    if (!root) {
+        *added = 1;
+        return IntMapNode_lone(k, val, edit);
+    }
+    if (root->size == 1 && root->slots[0].key != k) {
+        *added = 1;
+        return IntMapNode_pair(root->slots[0].key, root->slots[1].obj, k, val, edit);
+    }
+    if (root->size == 1) {
+        if (root->slots[1].obj == val) {
+            Py_INCREF(root);
+            return root;
+        }
+        IntMapNode *r = IntMapNode_ensure_editable(root, edit);
+        if (!r) return NULL;
+        Py_INCREF(val);
+        Py_SETREF(r->slots[1].obj, val);
+        return r;
     }
+    return IntMapNode_assoc(root, k, val, edit, added);
+}
 
-    PyObject *result = TransientSet_persistent(trans, NULL);
-    Py_DECREF(trans);
-    return result;
+// Remove k from the tree at root; mirrors IntMapNode_dissoc, except that a
+// lone entry stays as the root
+static int IntMapNode_root_dissoc(IntMapNode *root, uint64_t k, PyObject *edit, IntMapNode **out) {
+    return root ? IntMapNode_dissoc(root, k, edit, out) : 0;
 }
 
-static PyObject *Set_xor(PyObject *left, PyObject *right) {
-    // Symmetric difference: (self | other) - (self & other)
-    // or equivalently: (self - other) | (other - self)
-    if (!PyObject_TypeCheck(left, &SetType)) {
-        Py_RETURN_NOTIMPLEMENTED;
-    }
+// === IntMap set algebra ===
 
-    Set *self = (Set *)left;
+// One trie position during set algebra: a child node, a lone entry (node
+// NULL, val set), or nothing (both NULL)
+typedef struct {
+    IntMapNode *node;
+    uint64_t key;
+    PyObject *val;
+} IntMapItem;
 
-    // Use transient for efficient accumulation from empty set
-    TransientSet *trans = (TransientSet *)Set_transient(EMPTY_SET, NULL);
-    if (!trans) return NULL;
+static const IntMapItem INTMAP_NO_ITEM = {NULL, 0, NULL};
 
-    // Add elements from self that are not in other
-    PyObject *self_iter = Set_iter(self);
-    if (!self_iter) {
-        Py_DECREF(trans);
-        return NULL;
+static void IntMapItem_clear(IntMapItem *it) {
+    Py_XDECREF(it->node);
+    Py_XDECREF(it->val);
+    *it = INTMAP_NO_ITEM;
+}
+
+static inline int IntMapItem_empty(const IntMapItem *it) {
+    return !it->node && !it->val;
+}
+
+// Copy of it holding its own references
+static IntMapItem IntMapItem_ref(const IntMapItem *it) {
+    Py_XINCREF(it->node);
+    Py_XINCREF(it->val);
+    return *it;
+}
+
+// Item for a tree root (borrowed): a lone entry root is seen as its entry
+static IntMapItem IntMapItem_of_root(IntMapNode *root) {
+    IntMapItem it = INTMAP_NO_ITEM;
+    if (root && root->size == 1) {
+        it.key = root->slots[0].key;
+        it.val = root->slots[1].obj;
+    } else {
+        it.node = root;
     }
+    return it;
+}
 
-    PyObject *key;
-    while ((key = PyIter_Next(self_iter)) != NULL) {
-        int in_other;
-        if (PyObject_TypeCheck(right, &SetType)) {
-            in_other = Set_contains((Set *)right, key);
-        } else {
-            // For non-Set iterables, we need to check membership
-            in_other = PySequence_Contains(right, key);
-        }
+// Root for an item, which is consumed
+static IntMapNode *IntMapItem_to_root(IntMapItem *it) {
+    if (it->node) return it->node;
+    if (!it->val) return NULL;
+    IntMapNode *root = IntMapNode_lone(it->key, it->val, NULL);
+    Py_DECREF(it->val);
+    return root;
+}
 
-        if (in_other < 0) {
-            Py_DECREF(key);
-            Py_DECREF(self_iter);
-            Py_DECREF(trans);
-            return NULL;
+// Item for a subtree returned by dissoc (consumed)
+static IntMapItem IntMapItem_of_subtree(IntMapNode *n) {
+    IntMapItem it = INTMAP_NO_ITEM;
+    if (n && n->size == 1) {
+        it.key = n->slots[0].key;
+        it.val = n->slots[1].obj;
+        Py_INCREF(it.val);
+        Py_DECREF(n);
+    } else {
+        it.node = n;
+    }
+    return it;
+}
+
+// Items at the 32 positions of a node at shift with the given prefix that
+// a subtree occupies (borrowed). Returns 0 if the subtree lies outside it.
+static int IntMapItem_spread(const IntMapItem *it, int shift, uint64_t prefix, IntMapItem *pos) {
+    for (int i = 0; i < WIDTH; i++) pos[i] = INTMAP_NO_ITEM;
+    IntMapNode *n = it->node;
+    if (n && n->shift == shift) {
+        if (n->prefix != prefix) return 0;
+        int d = ctpop(n->datamap), k = 0;
+        for (uint32_t m = n->datamap; m; m &= m - 1, k++) {
+            IntMapItem *p = &pos[IntMap_chunk(n->slots[k].key, shift)];
+            p->key = n->slots[k].key;
+            p->val = n->slots[d + k].obj;
         }
+        k = 0;
+        for (uint32_t m = n->nodemap; m; m &= m - 1, k++) {
+            pos[ctpop((m & (~m + 1)) - 1)].node = (IntMapNode *)INTMAP_CHILD(n, k);
+        }
+        return 1;
+    }
+    uint64_t key = n ? IntMapNode_base(n) : it->key;
+    if (IntMap_prefix(key, shift) != prefix) return 0;
+    pos[IntMap_chunk(key, shift)] = *it;
+    return 1;
+}
 
-        if (!in_other) {
-            PyObject *res = TransientSet_conj_mut(trans, key);
-            Py_DECREF(key);
-            if (!res) {
-                Py_DECREF(self_iter);
-                Py_DECREF(trans);
-                return NULL;
-            }
-            Py_DECREF(res);
+// Collapse the items at the positions of a node at shift into one item:
+// nothing, the single item present, or a new node. Consumes the items.
+static int IntMapItem_build(IntMapItem *pos, int shift, IntMapItem *out) {
+    uint32_t datamap = 0, nodemap = 0;
+    int last = -1;
+    for (int i = 0; i < WIDTH; i++) {
+        if (pos[i].node) {
+            nodemap |= 1U << i;
+        } else if (pos[i].val) {
+            datamap |= 1U << i;
         } else {
-            Py_DECREF(key);
+            continue;
         }
+        last = i;
+    }
+    if (last < 0 || ctpop(datamap | nodemap) == 1) {
+        *out = last < 0 ? INTMAP_NO_ITEM : pos[last];
+        return 0;
     }
-    Py_DECREF(self_iter);
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(trans);
-        return NULL;
+    uint64_t key = pos[last].node ? IntMapNode_base(pos[last].node) : pos[last].key;
+    IntMapNode *r = IntMapNode_create(datamap, nodemap, shift, IntMap_prefix(key, shift), NULL);
+    if (!r) {
+        for (int i = 0; i < WIDTH; i++) IntMapItem_clear(&pos[i]);
+        return -1;
     }
+    int d = ctpop(datamap), k = 0, j = 0;
+    Py_ssize_t size = d;
+    for (int i = 0; i < WIDTH; i++) {
+        if (pos[i].node) {
+            r->slots[2 * d + j++].obj = (PyObject *)pos[i].node;
+            size += pos[i].node->size;
+        } else if (pos[i].val) {
+            r->slots[k].key = pos[i].key;
+            r->slots[d + k++].obj = pos[i].val;
+        }
+    }
+    r->size = size;
+    out->node = r;
+    out->val = NULL;
+    return 0;
+}
 
-    // Add elements from other that are not in self
-    PyObject *other_iter;
-    if (PyObject_TypeCheck(right, &SetType)) {
-        other_iter = Set_iter((Set *)right);
-    } else {
-        other_iter = PyObject_GetIter(right);
+// Combine two items (borrowed) into *out (owned): UNION keeps b's value for
+// keys in both, AND keeps a's entries whose keys are in b, SUB keeps a's
+// entries whose keys are not in b. Returns -1 on error.
+static int IntMapItem_combine(const IntMapItem *a, const IntMapItem *b, int op, IntMapItem *out) {
+    *out = INTMAP_NO_ITEM;
+    if (IntMapItem_empty(a) || IntMapItem_empty(b)) {
+        if (op == INTMAP_UNION) *out = IntMapItem_ref(IntMapItem_empty(a) ? b : a);
+        if (op == INTMAP_SUB) *out = IntMapItem_ref(a);
+        return 0;
     }
 
-    if (!other_iter) {
-        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
-            PyErr_Clear();
-            Py_DECREF(trans);
-            Py_RETURN_NOTIMPLEMENTED;
+    if (!a->node && !b->node) {
+        if (a->key == b->key) {
+            if (op != INTMAP_SUB) *out = IntMapItem_ref(op == INTMAP_UNION ? b : a);
+            return 0;
         }
-        Py_DECREF(trans);
-        return NULL;
+        if (op == INTMAP_SUB) *out = IntMapItem_ref(a);
+        if (op == INTMAP_UNION) {
+            out->node = IntMapNode_pair(a->key, a->val, b->key, b->val, NULL);
+            if (!out->node) return -1;
+        }
+        return 0;
     }
 
-    while ((key = PyIter_Next(other_iter)) != NULL) {
-        int in_self = Set_contains(self, key);
-        if (in_self < 0) {
-            Py_DECREF(key);
-            Py_DECREF(other_iter);
-            Py_DECREF(trans);
-            return NULL;
+    if (!a->node) {
+        // An entry against a subtree
+        int found = IntMapNode_find(b->node, a->key) != NULL;
+        if (op == INTMAP_UNION && !found) {
+            int added = 0;
+            out->node = IntMapNode_assoc(b->node, a->key, a->val, NULL, &added);
+            return out->node ? 0 : -1;
         }
+        if (op == INTMAP_UNION) *out = IntMapItem_ref(b);
+        if (op == (found ? INTMAP_AND : INTMAP_SUB)) *out = IntMapItem_ref(a);
+        return 0;
+    }
 
-        if (!in_self) {
-            PyObject *res = TransientSet_conj_mut(trans, key);
-            Py_DECREF(key);
-            if (!res) {
-                Py_DECREF(other_iter);
-                Py_DECREF(trans);
-                return NULL;
+    if (!b->node) {
+        // A subtree against an entry
+        if (op == INTMAP_UNION) {
+            int added = 0;
+            out->node = IntMapNode_assoc(a->node, b->key, b->val, NULL, &added);
+            return out->node ? 0 : -1;
+        }
+        if (op == INTMAP_AND) {
+            PyObject *val = IntMapNode_find(a->node, b->key);
+            if (val) {
+                out->key = b->key;
+                out->val = val;
+                Py_INCREF(val);
             }
-            Py_DECREF(res);
-        } else {
-            Py_DECREF(key);
+            return 0;
         }
+        IntMapNode *rest;
+        int rc = IntMapNode_dissoc(a->node, b->key, NULL, &rest);
+        if (rc < 0) return -1;
+        *out = rc ? IntMapItem_of_subtree(rest) : IntMapItem_ref(a);
+        return 0;
     }
-    Py_DECREF(other_iter);
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(trans);
-        return NULL;
+    if (a->node == b->node) {
+        if (op != INTMAP_SUB) *out = IntMapItem_ref(a);
+        return 0;
     }
 
-    PyObject *result = TransientSet_persistent(trans, NULL);
-    Py_DECREF(trans);
-    return result;
-}
-
-static Py_hash_t Set_hash(Set *self) {
-    if (self->hash_computed) {
-        return self->hash;
+    // Two subtrees: lay both out over the positions of the higher one
+    IntMapNode *hi = a->node->shift >= b->node->shift ? a->node : b->node;
+    IntMapItem pa[WIDTH], pb[WIDTH], res[WIDTH];
+    if (!IntMapItem_spread(a, hi->shift, hi->prefix, pa) || !IntMapItem_spread(b, hi->shift, hi->prefix, pb)) {
+        // Disjoint key ranges
+        if (op == INTMAP_SUB) *out = IntMapItem_ref(a);
+        if (op != INTMAP_UNION) return 0;
+        uint64_t ka = IntMapNode_base(a->node), kb = IntMapNode_base(b->node);
+        int shift = IntMap_split_shift(ka ^ kb);
+        for (int i = 0; i < WIDTH; i++) res[i] = INTMAP_NO_ITEM;
+        res[IntMap_chunk(ka, shift)] = IntMapItem_ref(a);
+        res[IntMap_chunk(kb, shift)] = IntMapItem_ref(b);
+        return IntMapItem_build(res, shift, out);
+    }
+    for (int i = 0; i < WIDTH; i++) {
+        if (IntMapItem_combine(&pa[i], &pb[i], op, &res[i]) < 0) {
+            for (int j = 0; j < i; j++) IntMapItem_clear(&res[j]);
+            return -1;
+        }
     }
+    return IntMapItem_build(res, hi->shift, out);
+}
 
-    // Use XOR of element hashes for order-independent hash
-    Py_hash_t h = 0;
-    PyObject *iter = Set_iter(self);
-    if (!iter) return -1;
+// Root of the combination of the trees at a and b (new reference, NULL
+// when empty or on error)
+static IntMapNode *IntMapNode_setop(IntMapNode *a, IntMapNode *b, int op) {
+    IntMapItem ia = IntMapItem_of_root(a), ib = IntMapItem_of_root(b), out;
+    if (IntMapItem_combine(&ia, &ib, op, &out) < 0) return NULL;
+    return IntMapItem_to_root(&out);
+}
 
-    PyObject *key;
-    while ((key = PyIter_Next(iter)) != NULL) {
-        Py_hash_t kh = PyObject_Hash(key);
-        Py_DECREF(key);
+// === IntMap iterator (in key order) ===
 
-        if (kh == -1 && PyErr_Occurred()) {
-            Py_DECREF(iter);
-            return -1;
+typedef struct {
+    IntMapNode *path[INTMAP_MAX_DEPTH];
+    uint32_t rest[INTMAP_MAX_DEPTH];  // positions not yet visited at each level
+    int depth;
+} IntMapCursor;
+
+static void IntMapCursor_init(IntMapCursor *c, IntMapNode *root) {
+    c->depth = root ? 1 : 0;
+    if (root) {
+        c->path[0] = root;
+        c->rest[0] = root->datamap | root->nodemap;
+    }
+}
+
+// Step to the next entry, slot i of *node; returns 0 when done
+static int IntMapCursor_next(IntMapCursor *c, IntMapNode **node, int *i) {
+    while (c->depth > 0) {
+        int d = c->depth - 1;
+        IntMapNode *n = c->path[d];
+        uint32_t m = c->rest[d];
+        if (!m) {
+            c->depth--;
+            continue;
         }
-
-        h ^= kh;
+        uint32_t bit = m & (~m + 1);
+        c->rest[d] = m & (m - 1);
+        if (n->datamap & bit) {
+            *node = n;
+            *i = bitmap_index(n->datamap, bit);
+            return 1;
+        }
+        IntMapNode *child = (IntMapNode *)INTMAP_CHILD(n, bitmap_index(n->nodemap, bit));
+        c->path[c->depth] = child;
+        c->rest[c->depth] = child->datamap | child->nodemap;
+        c->depth++;
     }
-    Py_DECREF(iter);
+    return 0;
+}
 
-    if (PyErr_Occurred()) return -1;
+typedef struct {
+    PyObject_HEAD
+    IntMapNode *root;  // keeps the cursor's path alive
+    IntMapCursor cursor;
+    int mode;          // ITER_MODE_*
+} IntMapIterator;
 
-    // Avoid returning -1 which signals error
-    if (h == -1) h = -2;
+static PyTypeObject IntMapIteratorType;
 
-    self->hash = h;
-    self->hash_computed = 1;
-    return h;
+static void IntMapIterator_dealloc(IntMapIterator *self) {
+    Py_XDECREF(self->root);
+    Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-static PyObject *Set_richcompare(Set *self, PyObject *other, int op) {
-    if (op != Py_EQ && op != Py_NE && op != Py_LT && op != Py_LE && op != Py_GT && op != Py_GE) {
-        Py_RETURN_NOTIMPLEMENTED;
-    }
+static inline PyObject *IntMap_box_key(uint64_t k) {
+    return PyLong_FromLongLong((long long)(k ^ INTMAP_SIGN));
+}
 
-    if (self == (Set *)other) {
-        if (op == Py_EQ || op == Py_LE || op == Py_GE) {
-            Py_RETURN_TRUE;
-        } else {
-            Py_RETURN_FALSE;
-        }
-    }
+static PyObject *IntMapIterator_next(IntMapIterator *self) {
+    IntMapNode *n;
+    int i;
+    if (!IntMapCursor_next(&self->cursor, &n, &i)) return NULL;
 
-    if (!PyObject_TypeCheck(other, &SetType)) {
-        if (op == Py_EQ) Py_RETURN_FALSE;
-        if (op == Py_NE) Py_RETURN_TRUE;
-        Py_RETURN_NOTIMPLEMENTED;
+    if (self->mode == ITER_MODE_VALUES) {
+        Py_INCREF(INTMAP_VAL(n, i));
+        return INTMAP_VAL(n, i);
     }
+    PyObject *key = IntMap_box_key(n->slots[i].key);
+    if (!key || self->mode == ITER_MODE_KEYS) return key;
+    PyObject *pair = PyTuple_New(2);
+    if (!pair) {
+        Py_DECREF(key);
+        return NULL;
+    }
+    PyTuple_SET_ITEM(pair, 0, key);
+    PyTuple_SET_ITEM(pair, 1, INTMAP_VAL(n, i));
+    Py_INCREF(INTMAP_VAL(n, i));
+    return pair;
+}
 
-    Set *o = (Set *)other;
+static PyTypeObject IntMapIteratorType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.IntMapIterator",
+    .tp_basicsize = sizeof(IntMapIterator),
+    .tp_dealloc = (destructor)IntMapIterator_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)IntMapIterator_next,
+};
 
-    // For equality, check counts first
-    if (op == Py_EQ || op == Py_NE) {
-        if (self->cnt != o->cnt) {
-            return PyBool_FromLong(op == Py_NE);
-        }
+static PyObject *IntMapIterator_create(IntMapNode *root, int mode) {
+    IntMapIterator *it = PyObject_New(IntMapIterator, &IntMapIteratorType);
+    if (!it) return NULL;
+    it->root = root;
+    Py_XINCREF(root);
+    IntMapCursor_init(&it->cursor, root);
+    it->mode = mode;
+    return (PyObject *)it;
+}
 
-        // Check all elements of self are in other
-        PyObject *iter = Set_iter(self);
-        if (!iter) return NULL;
+static PyTypeObject IntMapNodeType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.IntMapNode",
+    .tp_doc = "IntMap radix trie node (internal)",
+    .tp_basicsize = offsetof(IntMapNode, slots),
+    .tp_itemsize = sizeof(IntMapSlot),
+    .tp_dealloc = (destructor)IntMapNode_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+};
 
-        PyObject *key;
-        while ((key = PyIter_Next(iter)) != NULL) {
-            int found = Set_contains(o, key);
-            Py_DECREF(key);
+// === IntMap and IntSet ===
 
-            if (found < 0) {
-                Py_DECREF(iter);
-                return NULL;
-            }
-            if (!found) {
-                Py_DECREF(iter);
-                return PyBool_FromLong(op == Py_NE);
-            }
-        }
-        Py_DECREF(iter);
+// IntMap and IntSet share one layout; IntSet values are all Py_None
+typedef struct IntMap {
+    PyObject_HEAD
+    IntMapNode *root;  // NULL when empty
+    Py_ssize_t cnt;
+    Py_hash_t hash;
+    int hash_computed;
+} IntMap;
 
-        if (PyErr_Occurred()) return NULL;
+static PyTypeObject IntMapType;
+static PyTypeObject IntSetType;
+static PyTypeObject TransientIntMapType;
+static PyTypeObject TransientIntSetType;
 
-        return PyBool_FromLong(op == Py_EQ);
+static IntMap *EMPTY_INT_MAP = NULL;
+static IntMap *EMPTY_INT_SET = NULL;
+
+// Trie key for an int being stored; -1 with TypeError or OverflowError set
+static int IntMap_key(PyObject *key, uint64_t *out) {
+    if (!PyLong_Check(key)) {
+        PyErr_Format(PyExc_TypeError, "IntMap keys must be int, not %.200s", Py_TYPE(key)->tp_name);
+        return -1;
+    }
+    int overflow;
+    long long v = PyLong_AsLongLongAndOverflow(key, &overflow);
+    if (overflow) {
+        PyErr_SetString(PyExc_OverflowError, "IntMap keys must fit in 64 bits");
+        return -1;
     }
+    if (v == -1 && PyErr_Occurred()) return -1;
+    *out = (uint64_t)v ^ INTMAP_SIGN;
+    return 0;
+}
 
-    // Subset/superset comparisons
-    // self < other: self is proper subset of other
-    // self <= other: self is subset of other
-    // self > other: self is proper superset of other
-    // self >= other: self is superset of other
+// Trie key for a lookup: 1 if key could be stored, 0 if it cannot be
+// present (a non-integral float, huge int or other type), -1 on error
+static int IntMap_probe(PyObject *key, uint64_t *out) {
+    if (PyLong_Check(key)) {
+        int overflow;
+        long long v = PyLong_AsLongLongAndOverflow(key, &overflow);
+        if (overflow) return 0;
+        if (v == -1 && PyErr_Occurred()) return -1;
+        *out = (uint64_t)v ^ INTMAP_SIGN;
+        return 1;
+    }
+    if (PyFloat_Check(key)) {
+        // Floats equal to an int find it, as they do in a dict
+        double d = PyFloat_AS_DOUBLE(key);
+        if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0)) return 0;
+        long long v = (long long)d;
+        if ((double)v != d) return 0;
+        *out = (uint64_t)v ^ INTMAP_SIGN;
+        return 1;
+    }
+    return 0;
+}
 
-    if (op == Py_LT) {
-        // self < other: cnt < other.cnt and all self elements in other
-        if (self->cnt >= o->cnt) Py_RETURN_FALSE;
+static PyObject *IntMap_create(PyTypeObject *type, IntMapNode *root, Py_ssize_t cnt) {
+    IntMap *self = PyObject_New(IntMap, type);
+    if (!self) {
+        Py_XDECREF(root);
+        return NULL;
+    }
+    self->root = root;
+    self->cnt = cnt;
+    self->hash = 0;
+    self->hash_computed = 0;
+    return (PyObject *)self;
+}
 
-        PyObject *iter = Set_iter(self);
-        if (!iter) return NULL;
+// An IntMap or IntSet of self's type around root (stolen); the shared
+// empty instance when root is NULL
+static PyObject *IntMap_derive(IntMap *self, IntMapNode *root) {
+    if (!root) {
+        IntMap *empty = Py_TYPE(self) == &IntSetType ? EMPTY_INT_SET : EMPTY_INT_MAP;
+        if (empty && Py_TYPE(self) == Py_TYPE(empty)) {
+            Py_INCREF(empty);
+            return (PyObject *)empty;
+        }
+    }
+    return IntMap_create(Py_TYPE(self), root, root ? root->size : 0);
+}
 
-        PyObject *key;
-        while ((key = PyIter_Next(iter)) != NULL) {
-            int found = Set_contains(o, key);
-            Py_DECREF(key);
+static void IntMap_dealloc(IntMap *self) {
+    Py_XDECREF(self->root);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
 
-            if (found < 0) {
-                Py_DECREF(iter);
-                return NULL;
-            }
-            if (!found) {
-                Py_DECREF(iter);
-                Py_RETURN_FALSE;
+// Set key to val in *root, editing nodes owned by edit in place
+static int IntMap_put(IntMapNode **root, PyObject *key, PyObject *val, PyObject *edit) {
+    uint64_t k;
+    if (IntMap_key(key, &k) < 0) return -1;
+    int added;
+    IntMapNode *r = IntMapNode_root_assoc(*root, k, val, edit, &added);
+    if (!r) return -1;
+    Py_XSETREF(*root, r);
+    return 0;
+}
+
+// Remove key from *root, editing nodes owned by edit in place
+static int IntMap_remove(IntMapNode **root, PyObject *key, PyObject *edit) {
+    uint64_t k;
+    int rc = IntMap_probe(key, &k);
+    if (rc <= 0) return rc;
+    IntMapNode *r;
+    rc = IntMapNode_root_dissoc(*root, k, edit, &r);
+    if (rc <= 0) return rc;
+    Py_XSETREF(*root, r);
+    return 0;
+}
+
+// Add every entry of src to *root: a mapping, or an iterable of pairs for
+// an IntMap or of keys for an IntSet
+static int IntMap_fill(IntMapNode **root, PyObject *src, int is_set) {
+    PyObject *edit = PyObject_New(PyObject, &PdsSentinelType);
+    if (!edit) return -1;
+
+    PyObject *items = NULL;
+    if (!is_set && (PyDict_Check(src) || PyObject_TypeCheck(src, &MapType) ||
+                    PyObject_TypeCheck(src, &IntMapType))) {
+        items = PyObject_CallMethod(src, "items", NULL);
+        src = items;
+    }
+    PyObject *iter = src ? PyObject_GetIter(src) : NULL;
+    Py_XDECREF(items);
+    if (!iter) {
+        Py_DECREF(edit);
+        return -1;
+    }
+
+    int rc = 0;
+    PyObject *item;
+    while (rc == 0 && (item = PyIter_Next(iter)) != NULL) {
+        if (is_set) {
+            rc = IntMap_put(root, item, Py_None, edit);
+        } else {
+            PyObject *pair = PySequence_Fast(item, "int_map expects key-value pairs");
+            if (!pair) {
+                rc = -1;
+            } else if (PySequence_Fast_GET_SIZE(pair) != 2) {
+                PyErr_SetString(PyExc_ValueError, "int_map expects key-value pairs");
+                rc = -1;
+            } else {
+                rc = IntMap_put(root, PySequence_Fast_GET_ITEM(pair, 0), PySequence_Fast_GET_ITEM(pair, 1), edit);
             }
+            Py_XDECREF(pair);
         }
-        Py_DECREF(iter);
+        Py_DECREF(item);
+    }
+    Py_DECREF(iter);
+    Py_DECREF(edit);
+    return rc < 0 || PyErr_Occurred() ? -1 : 0;
+}
 
-        if (PyErr_Occurred()) return NULL;
-        Py_RETURN_TRUE;
+// IntMap or IntSet of type built from src (may be NULL or None)
+static PyObject *IntMap_from(PyTypeObject *type, PyObject *src) {
+    IntMapNode *root = NULL;
+    if (src && src != Py_None) {
+        if (Py_TYPE(src) == type) {
+            Py_INCREF(src);
+            return src;
+        }
+        if (IntMap_fill(&root, src, type == &IntSetType) < 0) {
+            Py_XDECREF(root);
+            return NULL;
+        }
+    }
+    IntMap *empty = type == &IntSetType ? EMPTY_INT_SET : EMPTY_INT_MAP;
+    if (!root && empty) {
+        Py_INCREF(empty);
+        return (PyObject *)empty;
+    }
+    return IntMap_create(type, root, root ? root->size : 0);
+}
+
+static PyObject *IntMap_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"", NULL};
+    PyObject *src = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &src)) {
+        return NULL;
     }
+    return IntMap_from(type, src);
+}
 
-    if (op == Py_LE) {
-        // self <= other: all self elements in other
-        if (self->cnt > o->cnt) Py_RETURN_FALSE;
+static Py_ssize_t IntMap_length(IntMap *self) {
+    return self->cnt;
+}
 
-        PyObject *iter = Set_iter(self);
-        if (!iter) return NULL;
+// Value under key (borrowed), NULL if absent or on error
+static PyObject *IntMap_lookup(IntMapNode *root, PyObject *key) {
+    uint64_t k;
+    return IntMap_probe(key, &k) > 0 ? IntMapNode_find(root, k) : NULL;
+}
 
-        PyObject *key;
-        while ((key = PyIter_Next(iter)) != NULL) {
-            int found = Set_contains(o, key);
-            Py_DECREF(key);
+static int IntMap_contains(IntMap *self, PyObject *key) {
+    PyObject *val = IntMap_lookup(self->root, key);
+    return val ? 1 : (PyErr_Occurred() ? -1 : 0);
+}
 
-            if (found < 0) {
-                Py_DECREF(iter);
-                return NULL;
-            }
-            if (!found) {
-                Py_DECREF(iter);
-                Py_RETURN_FALSE;
-            }
-        }
-        Py_DECREF(iter);
+static PyObject *IntMap_get(IntMap *self, PyObject *args) {
+    PyObject *key, *default_val = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O", &key, &default_val)) {
+        return NULL;
+    }
+    PyObject *val = IntMap_lookup(self->root, key);
+    if (!val && PyErr_Occurred()) return NULL;
+    val = val ? val : default_val;
+    Py_INCREF(val);
+    return val;
+}
 
-        if (PyErr_Occurred()) return NULL;
-        Py_RETURN_TRUE;
+static PyObject *IntMap_getitem(IntMap *self, PyObject *key) {
+    PyObject *val = IntMap_lookup(self->root, key);
+    if (!val) {
+        if (!PyErr_Occurred()) PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
     }
+    Py_INCREF(val);
+    return val;
+}
 
-    if (op == Py_GT) {
-        // self > other: other < self
-        if (o->cnt >= self->cnt) Py_RETURN_FALSE;
+static PyObject *IntMap_assoc_impl(IntMap *self, PyObject *key, PyObject *val) {
+    IntMapNode *root = self->root;
+    Py_XINCREF(root);
+    if (IntMap_put(&root, key, val, NULL) < 0) {
+        Py_XDECREF(root);
+        return NULL;
+    }
+    if (root == self->root) {
+        Py_DECREF(root);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+    return IntMap_derive(self, root);
+}
 
-        PyObject *iter = Set_iter(o);
-        if (!iter) return NULL;
+static PyObject *IntMap_assoc(IntMap *self, PyObject *args) {
+    PyObject *key, *val;
+    if (!PyArg_ParseTuple(args, "OO", &key, &val)) {
+        return NULL;
+    }
+    return IntMap_assoc_impl(self, key, val);
+}
 
-        PyObject *key;
-        while ((key = PyIter_Next(iter)) != NULL) {
-            int found = Set_contains(self, key);
-            Py_DECREF(key);
+static PyObject *IntMap_dissoc(IntMap *self, PyObject *key) {
+    IntMapNode *root = self->root;
+    Py_XINCREF(root);
+    if (IntMap_remove(&root, key, NULL) < 0) {
+        Py_XDECREF(root);
+        return NULL;
+    }
+    if (root == self->root) {
+        Py_XDECREF(root);
+        Py_INCREF(self);
+        return (PyObject *)self;
+    }
+    return IntMap_derive(self, root);
+}
 
-            if (found < 0) {
-                Py_DECREF(iter);
-                return NULL;
-            }
-            if (!found) {
-                Py_DECREF(iter);
-                Py_RETURN_FALSE;
-            }
-        }
-        Py_DECREF(iter);
+static PyObject *IntMap_iter(IntMap *self) {
+    return IntMapIterator_create(self->root, ITER_MODE_KEYS);
+}
 
-        if (PyErr_Occurred()) return NULL;
-        Py_RETURN_TRUE;
-    }
+static PyObject *IntMap_keys(IntMap *self, PyObject *Py_UNUSED(ignored)) {
+    return IntMapIterator_create(self->root, ITER_MODE_KEYS);
+}
 
-    if (op == Py_GE) {
-        // self >= other: other <= self
-        if (o->cnt > self->cnt) Py_RETURN_FALSE;
+static PyObject *IntMap_values(IntMap *self, PyObject *Py_UNUSED(ignored)) {
+    return IntMapIterator_create(self->root, ITER_MODE_VALUES);
+}
 
-        PyObject *iter = Set_iter(o);
-        if (!iter) return NULL;
+static PyObject *IntMap_items(IntMap *self, PyObject *Py_UNUSED(ignored)) {
+    return IntMapIterator_create(self->root, ITER_MODE_ITEMS);
+}
 
-        PyObject *key;
-        while ((key = PyIter_Next(iter)) != NULL) {
-            int found = Set_contains(self, key);
-            Py_DECREF(key);
+// Order-independent hash: the sum of hash(k) ^ hash(v) for an IntMap, as
+// for Map, and the XOR of the key hashes for an IntSet, as for Set
+static Py_hash_t IntMap_hash(IntMap *self) {
+    if (PDS_CACHE_READY(self->hash_computed)) {
+        return self->hash;
+    }
 
-            if (found < 0) {
-                Py_DECREF(iter);
-                return NULL;
-            }
-            if (!found) {
-                Py_DECREF(iter);
-                Py_RETURN_FALSE;
-            }
+    int is_set = Py_TYPE(self) == &IntSetType;
+    Py_uhash_t h = 0;
+    IntMapCursor c;
+    IntMapNode *n;
+    int i;
+    IntMapCursor_init(&c, self->root);
+    while (IntMapCursor_next(&c, &n, &i)) {
+        PyObject *key = IntMap_box_key(n->slots[i].key);
+        if (!key) return -1;
+        Py_hash_t hk = PyObject_Hash(key);
+        Py_DECREF(key);
+        if (hk == -1) return -1;
+        if (is_set) {
+            h ^= (Py_uhash_t)hk;
+            continue;
         }
-        Py_DECREF(iter);
-
-        if (PyErr_Occurred()) return NULL;
-        Py_RETURN_TRUE;
+        Py_hash_t hv = PyObject_Hash(INTMAP_VAL(n, i));
+        if (hv == -1) return -1;
+        h += (Py_uhash_t)(hk ^ hv);
+    }
+    if ((Py_hash_t)h == -1) {
+        h = (Py_uhash_t)-2;
     }
 
-    Py_RETURN_NOTIMPLEMENTED;
+    self->hash = (Py_hash_t)h;
+    PDS_CACHE_PUBLISH(self->hash_computed);
+    return self->hash;
 }
 
-static PyObject *Set_repr(Set *self) {
-    if (self->cnt == 0) {
-        return PyUnicode_FromString("#{}");
+static PyObject *IntMap_richcompare(IntMap *self, PyObject *other, int op) {
+    if (op != Py_EQ && op != Py_NE) {
+        Py_RETURN_NOTIMPLEMENTED;
     }
-
-    PyObject *parts = PyList_New(0);
-    if (!parts) return NULL;
-
-    PyObject *iter = Set_iter(self);
-    if (!iter) {
-        Py_DECREF(parts);
-        return NULL;
+    if (Py_TYPE(other) != Py_TYPE(self)) {
+        return PyBool_FromLong(op == Py_NE);
     }
 
-    PyObject *key;
-    while ((key = PyIter_Next(iter)) != NULL) {
-        PyObject *key_repr = PyObject_Repr(key);
-        Py_DECREF(key);
+    IntMap *o = (IntMap *)other;
+    if (self->root == o->root) {
+        return PyBool_FromLong(op == Py_EQ);
+    }
+    if (self->cnt != o->cnt ||
+        (PDS_CACHE_READY(self->hash_computed) && PDS_CACHE_READY(o->hash_computed) && self->hash != o->hash)) {
+        return PyBool_FromLong(op == Py_NE);
+    }
 
-        if (!key_repr) {
-            Py_DECREF(iter);
-            Py_DECREF(parts);
-            return NULL;
+    // Both walks run in key order, so equal maps line up entry by entry
+    IntMapCursor a, b;
+    IntMapNode *na, *nb;
+    int ia, ib, eq = 1;
+    IntMapCursor_init(&a, self->root);
+    IntMapCursor_init(&b, o->root);
+    while (eq == 1 && IntMapCursor_next(&a, &na, &ia) && IntMapCursor_next(&b, &nb, &ib)) {
+        if (na->slots[ia].key != nb->slots[ib].key) {
+            eq = 0;
+        } else {
+            eq = PyObject_RichCompareBool(INTMAP_VAL(na, ia), INTMAP_VAL(nb, ib), Py_EQ);
         }
+    }
+    if (eq < 0) return NULL;
+    return PyBool_FromLong((op == Py_EQ) == (eq == 1));
+}
 
-        if (PyList_Append(parts, key_repr) < 0) {
-            Py_DECREF(key_repr);
-            Py_DECREF(iter);
+static PyObject *IntMap_repr(IntMap *self) {
+    int is_set = Py_TYPE(self) == &IntSetType;
+    PyObject *parts = PyList_New(0);
+    if (!parts) return NULL;
+
+    IntMapCursor c;
+    IntMapNode *n;
+    int i;
+    IntMapCursor_init(&c, self->root);
+    while (IntMapCursor_next(&c, &n, &i)) {
+        PyObject *part = is_set ? PyUnicode_FromFormat("%lld", (long long)(n->slots[i].key ^ INTMAP_SIGN))
+                                : PyUnicode_FromFormat("%lld: %R", (long long)(n->slots[i].key ^ INTMAP_SIGN),
+                                                       INTMAP_VAL(n, i));
+        if (!part || PyList_Append(parts, part) < 0) {
+            Py_XDECREF(part);
             Py_DECREF(parts);
             return NULL;
         }
-        Py_DECREF(key_repr);
-    }
-    Py_DECREF(iter);
-
-    if (PyErr_Occurred()) {
-        Py_DECREF(parts);
-        return NULL;
+        Py_DECREF(part);
     }
 
-    PyObject *space = PyUnicode_FromString(" ");
-    if (!space) {
+    PyObject *sep = PyUnicode_FromString(", ");
+    if (!sep) {
         Py_DECREF(parts);
         return NULL;
     }
-
-    PyObject *joined = PyUnicode_Join(space, parts);
-    Py_DECREF(space);
+    PyObject *joined = PyUnicode_Join(sep, parts);
+    Py_DECREF(sep);
     Py_DECREF(parts);
     if (!joined) return NULL;
 
-    PyObject *result = PyUnicode_FromFormat("#{%U}", joined);
+    PyObject *result = is_set ? PyUnicode_FromFormat("int_set([%U])", joined)
+                              : PyUnicode_FromFormat("int_map({%U})", joined);
     Py_DECREF(joined);
     return result;
 }
 
-// TransientSet forward declaration
-static PyTypeObject TransientSetType;
-
-static PyObject *Set_transient(Set *self, PyObject *Py_UNUSED(ignored));
+// Combine two IntMaps or two IntSets of the same type node by node
+static PyObject *IntMap_setop(PyObject *a, PyObject *b, int op) {
+    if (Py_TYPE(a) != Py_TYPE(b) || (Py_TYPE(a) != &IntMapType && Py_TYPE(a) != &IntSetType)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    IntMapNode *ra = ((IntMap *)a)->root, *rb = ((IntMap *)b)->root;
+    IntMapNode *root = IntMapNode_setop(ra, rb, op);
+    if (!root && PyErr_Occurred()) return NULL;
 
-static PyObject *Set_to_seq(Set *self, PyObject *Py_UNUSED(ignored)) {
-    if (self->cnt == 0) {
-        Py_RETURN_NONE;
+    // Results that are one of the operands keep its cached hash
+    if (root == ra || root == rb) {
+        Py_XDECREF(root);
+        PyObject *same = root == ra ? a : b;
+        Py_INCREF(same);
+        return same;
     }
+    return IntMap_derive((IntMap *)a, root);
+}
 
-    // Build Cons list of elements
-    PyObject *iter = Set_iter(self);
-    if (!iter) return NULL;
+static PyObject *IntMap_or(PyObject *a, PyObject *b) {
+    return IntMap_setop(a, b, INTMAP_UNION);
+}
 
-    PyObject *elements = PyList_New(0);
-    if (!elements) {
-        Py_DECREF(iter);
+static PyObject *IntMap_and(PyObject *a, PyObject *b) {
+    return IntMap_setop(a, b, INTMAP_AND);
+}
+
+static PyObject *IntMap_sub(PyObject *a, PyObject *b) {
+    return IntMap_setop(a, b, INTMAP_SUB);
+}
+
+static PyObject *IntSet_xor(PyObject *a, PyObject *b) {
+    PyObject *left = IntMap_setop(a, b, INTMAP_SUB);
+    if (!left || left == Py_NotImplemented) return left;
+    PyObject *right = IntMap_setop(b, a, INTMAP_SUB);
+    if (!right) {
+        Py_DECREF(left);
         return NULL;
     }
+    PyObject *result = IntMap_setop(left, right, INTMAP_UNION);
+    Py_DECREF(left);
+    Py_DECREF(right);
+    return result;
+}
 
-    PyObject *key;
-    while ((key = PyIter_Next(iter)) != NULL) {
-        if (PyList_Append(elements, key) < 0) {
-            Py_DECREF(key);
-            Py_DECREF(iter);
-            Py_DECREF(elements);
-            return NULL;
-        }
-        Py_DECREF(key);
-    }
+static PyObject *IntMap_reduce(IntMap *self, PyObject *Py_UNUSED(ignored)) {
+    // IntMaps pickle as their item pairs and IntSets as their keys, in order
+    PyObject *iter = Py_TYPE(self) == &IntSetType ? IntMap_keys(self, NULL) : IntMap_items(self, NULL);
+    if (!iter) return NULL;
+    PyObject *contents = PySequence_Tuple(iter);
     Py_DECREF(iter);
+    if (!contents) return NULL;
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(elements);
-        return NULL;
-    }
+    return Py_BuildValue("(O(N))", (PyObject *)Py_TYPE(self), contents);
+}
 
-    // Build Cons list in reverse
-    Cons *result = NULL;
-    for (Py_ssize_t i = PyList_Size(elements) - 1; i >= 0; i--) {
-        PyObject *item = PyList_GET_ITEM(elements, i);
-        Cons *new_cons = (Cons *)ConsType.tp_alloc(&ConsType, 0);
-        if (!new_cons) {
-            Py_XDECREF(result);
-            Py_DECREF(elements);
-            return NULL;
-        }
+// === TransientIntMap and TransientIntSet ===
 
-        Py_INCREF(item);
-        new_cons->first = item;
-        new_cons->rest = result ? (PyObject *)result : Py_None;
-        Py_INCREF(new_cons->rest);
-        new_cons->hash = 0;
-        new_cons->hash_computed = 0;
+typedef struct TransientIntMap {
+    PyObject_HEAD
+    IntMapNode *root;
+    PyObject *id;  // Edit token
+} TransientIntMap;
 
-        result = new_cons;
+static void TransientIntMap_dealloc(TransientIntMap *self) {
+    Py_XDECREF(self->root);
+    Py_XDECREF(self->id);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int TransientIntMap_ensure_editable(TransientIntMap *self) {
+    if (!self->id) {
+        PyErr_SetString(PyExc_RuntimeError, Py_TYPE(self) == &TransientIntSetType
+                                                 ? "TransientIntSet already made persistent"
+                                                 : "TransientIntMap already made persistent");
+        return -1;
     }
+    return 0;
+}
 
-    Py_DECREF(elements);
-    return (PyObject *)result;
+static PyObject *IntMap_transient(IntMap *self, PyObject *Py_UNUSED(ignored)) {
+    PyTypeObject *type = Py_TYPE(self) == &IntSetType ? &TransientIntSetType : &TransientIntMapType;
+    TransientIntMap *t = PyObject_New(TransientIntMap, type);
+    if (!t) return NULL;
+
+    t->root = self->root;
+    Py_XINCREF(t->root);
+    t->id = PyObject_New(PyObject, &PdsSentinelType);
+    if (!t->id) {
+        Py_DECREF(t);
+        return NULL;
+    }
+    return (PyObject *)t;
 }
 
-/* Set.copy() - returns self since Set is immutable */
-static PyObject *Set_copy(Set *self, PyObject *Py_UNUSED(ignored)) {
+static PyObject *TransientIntMap_assoc_mut(TransientIntMap *self, PyObject *args) {
+    PyObject *key, *val;
+    if (!PyArg_ParseTuple(args, "OO", &key, &val)) {
+        return NULL;
+    }
+    if (TransientIntMap_ensure_editable(self) < 0 || IntMap_put(&self->root, key, val, self->id) < 0) {
+        return NULL;
+    }
     Py_INCREF(self);
     return (PyObject *)self;
 }
 
-/* Set.isdisjoint(other) - return True if no common elements */
-static PyObject *Set_isdisjoint(Set *self, PyObject *other) {
-    PyObject *iter = PyObject_GetIter(other);
-    if (!iter) return NULL;
+static PyObject *TransientIntSet_conj_mut(TransientIntMap *self, PyObject *key) {
+    if (TransientIntMap_ensure_editable(self) < 0 || IntMap_put(&self->root, key, Py_None, self->id) < 0) {
+        return NULL;
+    }
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
 
-    PyObject *item;
-    while ((item = PyIter_Next(iter)) != NULL) {
-        int contains = Set_contains(self, item);
-        Py_DECREF(item);
+static PyObject *TransientIntMap_dissoc_mut(TransientIntMap *self, PyObject *key) {
+    if (TransientIntMap_ensure_editable(self) < 0 || IntMap_remove(&self->root, key, self->id) < 0) {
+        return NULL;
+    }
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
 
-        if (contains < 0) {
-            Py_DECREF(iter);
-            return NULL;
-        }
-        if (contains) {
-            Py_DECREF(iter);
-            Py_RETURN_FALSE;
-        }
+static PyObject *TransientIntMap_persistent(TransientIntMap *self, PyObject *Py_UNUSED(ignored)) {
+    if (TransientIntMap_ensure_editable(self) < 0) return NULL;
+    Py_CLEAR(self->id);
+
+    PyTypeObject *type = Py_TYPE(self) == &TransientIntSetType ? &IntSetType : &IntMapType;
+    IntMap *empty = type == &IntSetType ? EMPTY_INT_SET : EMPTY_INT_MAP;
+    if (!self->root && empty) {
+        Py_INCREF(empty);
+        return (PyObject *)empty;
     }
-    Py_DECREF(iter);
+    Py_XINCREF(self->root);
+    return IntMap_create(type, self->root, self->root ? self->root->size : 0);
+}
 
-    if (PyErr_Occurred()) return NULL;
+static Py_ssize_t TransientIntMap_length(TransientIntMap *self) {
+    if (TransientIntMap_ensure_editable(self) < 0) return -1;
+    return self->root ? self->root->size : 0;
+}
 
-    Py_RETURN_TRUE;
+static int TransientIntMap_contains(TransientIntMap *self, PyObject *key) {
+    if (TransientIntMap_ensure_editable(self) < 0) return -1;
+    PyObject *val = IntMap_lookup(self->root, key);
+    return val ? 1 : (PyErr_Occurred() ? -1 : 0);
 }
 
-static PyObject *Set_reduce(Set *self, PyObject *Py_UNUSED(ignored)) {
-    // Convert Set to a tuple using the sequence protocol (iteration)
-    PyObject *args = PySequence_Tuple((PyObject *)self);
-    if (args == NULL) {
+static PyObject *TransientIntMap_get(TransientIntMap *self, PyObject *args) {
+    PyObject *key, *default_val = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O", &key, &default_val)) {
         return NULL;
     }
-
-    // Return (type, args_tuple) - pickle will call type(*args_tuple)
-    PyObject *result = PyTuple_Pack(2, (PyObject *)Py_TYPE(self), args);
-    Py_DECREF(args);
-    return result;
+    if (TransientIntMap_ensure_editable(self) < 0) return NULL;
+    PyObject *val = IntMap_lookup(self->root, key);
+    if (!val && PyErr_Occurred()) return NULL;
+    val = val ? val : default_val;
+    Py_INCREF(val);
+    return val;
+}
+
+static PyObject *TransientIntMap_getitem(TransientIntMap *self, PyObject *key) {
+    if (TransientIntMap_ensure_editable(self) < 0) return NULL;
+    PyObject *val = IntMap_lookup(self->root, key);
+    if (!val) {
+        if (!PyErr_Occurred()) PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+    Py_INCREF(val);
+    return val;
 }
 
-static PyMethodDef Set_methods[] = {
-    {"conj", (PyCFunction)Set_conj, METH_O, "Add element to set"},
-    {"disj", (PyCFunction)Set_disj, METH_O, "Remove element from set"},
-    {"transient", (PyCFunction)Set_transient, METH_NOARGS, "Get transient version"},
-    {"to_seq", (PyCFunction)Set_to_seq, METH_NOARGS, "Convert to Cons sequence"},
-    {"copy", (PyCFunction)Set_copy, METH_NOARGS, "Return self (immutable sets don't need copying)"},
-    {"isdisjoint", (PyCFunction)Set_isdisjoint, METH_O, "Return True if no common elements with other"},
-    {"__reduce__", (PyCFunction)Set_reduce, METH_NOARGS, "Pickle support"},
-    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
-     "Return a generic alias for type annotations (e.g., Set[int])"},
+static PyMethodDef TransientIntMap_methods[] = {
+    {"assoc_mut", (PyCFunction)TransientIntMap_assoc_mut, METH_VARARGS, "Mutably set key to value"},
+    {"dissoc_mut", (PyCFunction)TransientIntMap_dissoc_mut, METH_O, "Mutably remove key"},
+    {"persistent", (PyCFunction)TransientIntMap_persistent, METH_NOARGS, "Return persistent int map"},
+    {"get", (PyCFunction)TransientIntMap_get, METH_VARARGS, "Get value for key with optional default"},
     {NULL}
 };
 
-static PySequenceMethods Set_as_sequence = {
-    .sq_length = (lenfunc)Set_length,
-    .sq_contains = (objobjproc)Set_contains,
+static PySequenceMethods TransientIntMap_as_sequence = {
+    .sq_contains = (objobjproc)TransientIntMap_contains,
 };
 
-static PyNumberMethods Set_as_number = {
-    .nb_or = Set_or,
-    .nb_and = Set_and,
-    .nb_subtract = Set_sub,
-    .nb_xor = Set_xor,
+static PyMappingMethods TransientIntMap_as_mapping = {
+    .mp_length = (lenfunc)TransientIntMap_length,
+    .mp_subscript = (binaryfunc)TransientIntMap_getitem,
 };
 
-static PyTypeObject SetType = {
+static PyTypeObject TransientIntMapType = {
     PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.Set",
-    .tp_doc = "Persistent Hash Set using HAMT",
-    .tp_basicsize = sizeof(Set),
-    .tp_itemsize = 0,
-    .tp_dealloc = (destructor)Set_dealloc,
-    .tp_repr = (reprfunc)Set_repr,
-    .tp_as_number = &Set_as_number,
-    .tp_as_sequence = &Set_as_sequence,
-    .tp_hash = (hashfunc)Set_hash,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_richcompare = (richcmpfunc)Set_richcompare,
-    .tp_iter = (getiterfunc)Set_iter,
-    .tp_methods = Set_methods,
-    .tp_init = (initproc)Set_init,
-    .tp_new = Set_new,
+    .tp_name = "spork.runtime.pds.TransientIntMap",
+    .tp_doc = "Transient int map for batch operations",
+    .tp_basicsize = sizeof(TransientIntMap),
+    .tp_dealloc = (destructor)TransientIntMap_dealloc,
+    .tp_as_sequence = &TransientIntMap_as_sequence,
+    .tp_as_mapping = &TransientIntMap_as_mapping,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_methods = TransientIntMap_methods,
 };
 
-// === TransientSet ===
-struct TransientSet {
-    PyObject_HEAD
-    Py_ssize_t cnt;
-    PyObject *root;
-    PyObject *id;
+static PyMethodDef TransientIntSet_methods[] = {
+    {"conj_mut", (PyCFunction)TransientIntSet_conj_mut, METH_O, "Mutably add element"},
+    {"disj_mut", (PyCFunction)TransientIntMap_dissoc_mut, METH_O, "Mutably remove element"},
+    {"persistent", (PyCFunction)TransientIntMap_persistent, METH_NOARGS, "Return persistent int set"},
+    {NULL}
 };
 
-static void TransientSet_dealloc(TransientSet *self) {
-    Py_XDECREF(self->root);
-    Py_XDECREF(self->id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
-}
+static PySequenceMethods TransientIntSet_as_sequence = {
+    .sq_length = (lenfunc)TransientIntMap_length,
+    .sq_contains = (objobjproc)TransientIntMap_contains,
+};
 
-static PyObject *Set_transient(Set *self, PyObject *Py_UNUSED(ignored)) {
-    TransientSet *t = PyObject_New(TransientSet, &TransientSetType);
-    if (!t) return NULL;
+static PyTypeObject TransientIntSetType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.TransientIntSet",
+    .tp_doc = "Transient int set for batch operations",
+    .tp_basicsize = sizeof(TransientIntMap),
+    .tp_dealloc = (destructor)TransientIntMap_dealloc,
+    .tp_as_sequence = &TransientIntSet_as_sequence,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_methods = TransientIntSet_methods,
+};
 
-    t->id = PyObject_New(PyObject, &PdsSentinelType);
-    if (!t->id) {
-        Py_DECREF(t);
-        return NULL;
-    }
+// === IntMap and IntSet type objects ===
+
+static PyMethodDef IntMap_methods[] = {
+    {"get", (PyCFunction)IntMap_get, METH_VARARGS, "Get value for key"},
+    {"assoc", (PyCFunction)IntMap_assoc, METH_VARARGS, "Set key to value"},
+    {"dissoc", (PyCFunction)IntMap_dissoc, METH_O, "Remove key"},
+    {"items", (PyCFunction)IntMap_items, METH_NOARGS, "Iterate over key-value pairs in key order"},
+    {"keys", (PyCFunction)IntMap_keys, METH_NOARGS, "Iterate over keys in order"},
+    {"values", (PyCFunction)IntMap_values, METH_NOARGS, "Iterate over values in key order"},
+    {"transient", (PyCFunction)IntMap_transient, METH_NOARGS, "Get transient version"},
+    {"__reduce__", (PyCFunction)IntMap_reduce, METH_NOARGS, "Pickle support"},
+    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
+     "Return a generic alias for type annotations (e.g., IntMap[str])"},
+    {NULL}
+};
 
-    t->cnt = self->cnt;
-    if (self->root != NULL) {
-        if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-            t->root = (PyObject *)BitmapIndexedNode_ensure_editable((BitmapIndexedNode *)self->root, t->id);
-        } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-            t->root = (PyObject *)ArrayNode_ensure_editable((ArrayNode *)self->root, t->id);
-        } else {
-            t->root = (PyObject *)HashCollisionNode_ensure_editable((HashCollisionNode *)self->root, t->id);
-        }
-        if (!t->root) {
-            Py_DECREF(t);
-            return NULL;
-        }
-    } else {
-        t->root = NULL;
-    }
+static PySequenceMethods IntMap_as_sequence = {
+    .sq_contains = (objobjproc)IntMap_contains,
+};
 
-    return (PyObject *)t;
-}
+static PyMappingMethods IntMap_as_mapping = {
+    .mp_length = (lenfunc)IntMap_length,
+    .mp_subscript = (binaryfunc)IntMap_getitem,
+};
 
-static void TransientSet_ensure_editable(TransientSet *self) {
-    if (self->id == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "Transient used after persistent() call");
-    }
+static PyNumberMethods IntMap_as_number = {
+    .nb_or = IntMap_or,
+    .nb_and = IntMap_and,
+    .nb_subtract = IntMap_sub,
+};
+
+static PyTypeObject IntMapType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.IntMap",
+    .tp_doc = "Persistent map keyed by int64, stored unboxed in a radix trie",
+    .tp_basicsize = sizeof(IntMap),
+    .tp_dealloc = (destructor)IntMap_dealloc,
+    .tp_repr = (reprfunc)IntMap_repr,
+    .tp_as_number = &IntMap_as_number,
+    .tp_as_sequence = &IntMap_as_sequence,
+    .tp_as_mapping = &IntMap_as_mapping,
+    .tp_hash = (hashfunc)IntMap_hash,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_richcompare = (richcmpfunc)IntMap_richcompare,
+    .tp_iter = (getiterfunc)IntMap_iter,
+    .tp_methods = IntMap_methods,
+    .tp_new = IntMap_new,
+};
+
+static PyObject *IntSet_conj(IntMap *self, PyObject *key) {
+    return IntMap_assoc_impl(self, key, Py_None);
 }
 
-static PyObject *TransientSet_conj_mut(TransientSet *self, PyObject *key) {
-    TransientSet_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+static PyMethodDef IntSet_methods[] = {
+    {"conj", (PyCFunction)IntSet_conj, METH_O, "Add element to set"},
+    {"disj", (PyCFunction)IntMap_dissoc, METH_O, "Remove element from set"},
+    {"transient", (PyCFunction)IntMap_transient, METH_NOARGS, "Get transient version"},
+    {"__reduce__", (PyCFunction)IntMap_reduce, METH_NOARGS, "Pickle support"},
+    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
+     "Return a generic alias for type annotations"},
+    {NULL}
+};
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+static PySequenceMethods IntSet_as_sequence = {
+    .sq_length = (lenfunc)IntMap_length,
+    .sq_contains = (objobjproc)IntMap_contains,
+};
 
-    PyObject *added_leaf = PyList_New(0);
-    if (!added_leaf) return NULL;
+static PyNumberMethods IntSet_as_number = {
+    .nb_or = IntMap_or,
+    .nb_and = IntMap_and,
+    .nb_subtract = IntMap_sub,
+    .nb_xor = IntSet_xor,
+};
 
-    PyObject *root = self->root ? self->root : (PyObject *)EMPTY_BIN;
-    PyObject *new_root;
+static PyTypeObject IntSetType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.IntSet",
+    .tp_doc = "Persistent set of int64, stored unboxed in a radix trie",
+    .tp_basicsize = sizeof(IntMap),
+    .tp_dealloc = (destructor)IntMap_dealloc,
+    .tp_repr = (reprfunc)IntMap_repr,
+    .tp_as_number = &IntSet_as_number,
+    .tp_as_sequence = &IntSet_as_sequence,
+    .tp_hash = (hashfunc)IntMap_hash,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_richcompare = (richcmpfunc)IntMap_richcompare,
+    .tp_iter = (getiterfunc)IntMap_iter,
+    .tp_methods = IntSet_methods,
+    .tp_new = IntMap_new,
+};
 
-    if (PyObject_TypeCheck(root, &BitmapIndexedNodeType)) {
-        new_root = BitmapIndexedNode_assoc((BitmapIndexedNode *)root, 0, h, key, Py_None, added_leaf, self->id);
-    } else if (PyObject_TypeCheck(root, &ArrayNodeType)) {
-        new_root = ArrayNode_assoc((ArrayNode *)root, 0, h, key, Py_None, added_leaf, self->id);
-    } else {
-        new_root = HashCollisionNode_assoc((HashCollisionNode *)root, 0, h, key, Py_None, added_leaf, self->id);
-    }
+// === Module-level functions ===
 
-    if (!new_root) {
-        Py_DECREF(added_leaf);
+static PyObject *pds_cons(PyObject *self, PyObject *args) {
+    PyObject *first, *rest = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O", &first, &rest)) {
         return NULL;
     }
 
-    if (new_root != self->root) {
-        Py_XDECREF(self->root);
-        self->root = new_root;
-    } else {
-        Py_DECREF(new_root);
-    }
+    Cons *c = Cons_alloc();
+    if (!c) return NULL;
 
-    self->cnt += PyList_Size(added_leaf);
-    Py_DECREF(added_leaf);
+    c->first = first;
+    Py_INCREF(first);
+    c->rest = rest;
+    Py_INCREF(rest);
+    c->hash = 0;
+    c->hash_computed = 0;
 
-    Py_INCREF(self);
-    return (PyObject *)self;
+    return (PyObject *)c;
 }
 
-static PyObject *TransientSet_disj_mut(TransientSet *self, PyObject *key) {
-    TransientSet_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+static PyObject *pds_vec(PyObject *self, PyObject *args) {
+    Py_ssize_t n = PyTuple_Size(args);
 
-    if (self->root == NULL) {
-        Py_INCREF(self);
-        return (PyObject *)self;
+    // Check for single iterable argument
+    if (n == 1) {
+        PyObject *arg = PyTuple_GET_ITEM(args, 0);
+        if (PyIter_Check(arg) || PyObject_TypeCheck(arg, &SortedVectorType) ||
+            PyObject_TypeCheck(arg, &ChunkedSeqType) || PyObject_TypeCheck(arg, &EductionType) ||
+            (PySequence_Check(arg) && !PyUnicode_Check(arg) &&
+            !PyObject_TypeCheck(arg, &VectorType) && !PyObject_TypeCheck(arg, &MapType))) {
+            // Single iterable - expand it
+            PyObject *iter = PyObject_GetIter(arg);
+            if (!iter) {
+                PyErr_Clear();
+                // Not iterable, treat as single element
+            } else {
+                PyObject *seq = PySequence_Fast(iter, "vec expects an iterable");
+                Py_DECREF(iter);
+                if (!seq) return NULL;
+                PyObject *result = Vector_from_items(PySequence_Fast_ITEMS(seq), PySequence_Fast_GET_SIZE(seq));
+                Py_DECREF(seq);
+                return result;
+            }
+        }
     }
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return NULL;
+    // Multiple arguments or single non-iterable
+    return Vector_from_items(PySequence_Fast_ITEMS(args), n);
+}
 
-    // Check if key exists before attempting removal
-    // This is necessary because transient mutation may return the same pointer
-    // even when a modification was made (due to in-place editing)
-    PyObject *found;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        found = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        found = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
-    } else {
-        found = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
-    }
+static PyObject *pds_set(PyObject *self, PyObject *args) {
+    PyObject *iterable = NULL;
 
-    if (!found) {
-        // Error occurred during find
+    if (!PyArg_ParseTuple(args, "|O", &iterable)) {
         return NULL;
     }
-    if (found == _MISSING) {
-        // Key not in set, nothing to do
-        Py_DECREF(found);
-        Py_INCREF(self);
-        return (PyObject *)self;
-    }
-    Py_DECREF(found);
 
-    // Key exists, perform removal
-    PyObject *new_root;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        new_root = BitmapIndexedNode_dissoc((BitmapIndexedNode *)self->root, 0, h, key, NULL, self->id);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        new_root = ArrayNode_dissoc((ArrayNode *)self->root, 0, h, key, NULL, self->id);
-    } else {
-        new_root = HashCollisionNode_dissoc((HashCollisionNode *)self->root, 0, h, key, NULL, self->id);
+    if (iterable == NULL) {
+        Py_INCREF(EMPTY_SET);
+        return (PyObject *)EMPTY_SET;
     }
 
-    if (!new_root && PyErr_Occurred()) {
+    return Set_from_iterable(NULL, iterable);
+}
+
+static PyObject *pds_hash_map(PyObject *self, PyObject *args) {
+    Py_ssize_t n = PyTuple_Size(args);
+
+    if (n % 2 != 0) {
+        PyErr_SetString(PyExc_ValueError, "hash_map requires an even number of arguments");
         return NULL;
     }
 
-    if (new_root == Py_None) {
-        Py_DECREF(new_root);
-        Py_XDECREF(self->root);
-        self->root = NULL;
-        self->cnt = 0;
-    } else if (new_root != self->root) {
-        Py_XDECREF(self->root);
-        self->root = new_root;
-        self->cnt--;
-    } else {
-        // Same pointer returned due to in-place mutation, but key was removed
-        Py_DECREF(new_root);
-        self->cnt--;
+    if (n == 0) {
+        Py_INCREF(EMPTY_MAP);
+        return (PyObject *)EMPTY_MAP;
     }
 
-    Py_INCREF(self);
-    return (PyObject *)self;
+    MapBuildEntry *e = PyMem_Malloc((n / 2) * sizeof(MapBuildEntry));
+    if (!e) return PyErr_NoMemory();
+    Py_ssize_t len = 0;
+    for (Py_ssize_t i = 0; i < n; i += 2) {
+        if (MapBuild_push(e, &len, PyTuple_GET_ITEM(args, i), PyTuple_GET_ITEM(args, i + 1)) < 0) {
+            MapBuild_clear(e, len);
+            return NULL;
+        }
+    }
+    return Map_build(e, len);
 }
 
-static PyObject *TransientSet_persistent(TransientSet *self, PyObject *Py_UNUSED(ignored)) {
-    TransientSet_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+// =============================================================================
+// FACTORY FUNCTIONS FOR TYPE-SPECIALIZED VECTORS
+// =============================================================================
 
-    Py_CLEAR(self->id);
+// Bulk construction: elements are copied (or unboxed once) into a flat
+// array, cut into full leaves with memcpy, and the trie is built bottom-up
+// one level at a time. The last partial chunk becomes the tail, matching
+// the shape repeated conj would produce. Given an owner that keeps src alive
+// (a snapshot mapping), full leaves point into src instead of copying it.
+
+#define TYPED_LEAF_FULL 0xFFFFFFFFu
+
+// Smallest root shift whose trie holds n_leaves leaves
+static int typed_vector_shift_for(Py_ssize_t n_leaves) {
+    int shift = BITS;
+    while (((Py_ssize_t)1 << shift) < n_leaves) shift += BITS;
+    return shift;
+}
+
+static PyObject *DoubleVector_from_array(const double *src, Py_ssize_t n, PyObject *owner) {
+    if (n == 0) {
+        Py_INCREF(EMPTY_DOUBLE_VECTOR);
+        return (PyObject *)EMPTY_DOUBLE_VECTOR;
+    }
+
+    Py_ssize_t tail_off = n < WIDTH ? 0 : ((n - 1) >> BITS) << BITS;
+    Py_ssize_t len = tail_off >> BITS;
+    int shift = typed_vector_shift_for(len);
+    DoubleVectorNode *root = NULL;
+
+    if (len > 0) {
+        DoubleVectorNode **nodes = PyMem_Malloc(len * sizeof(DoubleVectorNode *));
+        if (!nodes) return PyErr_NoMemory();
+
+        Py_ssize_t built = 0;
+        for (; built < len; built++) {
+            DoubleVectorNode *leaf = DoubleVectorNode_create(NULL);
+            if (!leaf) goto error;
+            leaf->is_leaf = 1;
+            if (owner) {
+                leaf->data.mapped = src + built * WIDTH;
+                Py_INCREF(owner);
+                leaf->owner = owner;
+            } else {
+                memcpy(leaf->data.values, src + built * WIDTH, WIDTH * sizeof(double));
+            }
+            leaf->valid_mask = TYPED_LEAF_FULL;
+            nodes[built] = leaf;
+        }
 
-    Set *result = Set_create(self->cnt, self->root, NULL);
-    return (PyObject *)result;
-}
+        // Parents overwrite the front of nodes[] as their children are consumed
+        for (int level = BITS; level <= shift; level += BITS) {
+            Py_ssize_t parents = (len + MASK) >> BITS;
+            for (Py_ssize_t p = 0; p < parents; p++) {
+                DoubleVectorNode *parent = DoubleVectorNode_create(NULL);
+                if (!parent) {
+                    for (Py_ssize_t i = 0; i < p; i++) Py_DECREF(nodes[i]);
+                    for (Py_ssize_t i = p * WIDTH; i < len; i++) Py_DECREF(nodes[i]);
+                    PyMem_Free(nodes);
+                    return NULL;
+                }
+                Py_ssize_t first = p * WIDTH;
+                for (int c = 0; c < WIDTH && first + c < len; c++) {
+                    parent->data.children[c] = nodes[first + c];
+                    parent->valid_mask |= (1u << c);
+                }
+                nodes[p] = parent;
+            }
+            len = parents;
+        }
+        root = nodes[0];
+        PyMem_Free(nodes);
+        goto done;
 
-// === TransientSet MutableSet Protocol ===
+    error:
+        for (Py_ssize_t i = 0; i < built; i++) Py_DECREF(nodes[i]);
+        PyMem_Free(nodes);
+        return NULL;
+    }
 
-static Py_ssize_t TransientSet_length(TransientSet *self) {
-    return self->cnt;
+done:;
+    DoubleVector *vec = DoubleVector_create(n, shift, root, (double *)src + tail_off,
+                                           n - tail_off, NULL);
+    Py_XDECREF(root);
+    return (PyObject *)vec;
 }
 
-static int TransientSet_contains(TransientSet *self, PyObject *key) {
-    TransientSet_ensure_editable(self);
-    if (PyErr_Occurred()) return -1;
-
-    if (self->root == NULL) {
-        return 0;
+static PyObject *IntVector_from_array(const int64_t *src, Py_ssize_t n, PyObject *owner) {
+    if (n == 0) {
+        Py_INCREF(EMPTY_LONG_VECTOR);
+        return (PyObject *)EMPTY_LONG_VECTOR;
     }
 
-    Py_hash_t h = PyObject_Hash(key);
-    if (h == -1 && PyErr_Occurred()) return -1;
+    Py_ssize_t tail_off = n < WIDTH ? 0 : ((n - 1) >> BITS) << BITS;
+    Py_ssize_t len = tail_off >> BITS;
+    int shift = typed_vector_shift_for(len);
+    IntVectorNode *root = NULL;
+
+    if (len > 0) {
+        IntVectorNode **nodes = PyMem_Malloc(len * sizeof(IntVectorNode *));
+        if (!nodes) return PyErr_NoMemory();
+
+        Py_ssize_t built = 0;
+        for (; built < len; built++) {
+            IntVectorNode *leaf = IntVectorNode_create(NULL);
+            if (!leaf) goto error;
+            leaf->is_leaf = 1;
+            if (owner) {
+                leaf->data.mapped = src + built * WIDTH;
+                Py_INCREF(owner);
+                leaf->owner = owner;
+            } else {
+                memcpy(leaf->data.values, src + built * WIDTH, WIDTH * sizeof(int64_t));
+            }
+            leaf->valid_mask = TYPED_LEAF_FULL;
+            nodes[built] = leaf;
+        }
 
-    PyObject *result;
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        result = BitmapIndexedNode_find((BitmapIndexedNode *)self->root, 0, h, key, _MISSING);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        result = ArrayNode_find((ArrayNode *)self->root, 0, h, key, _MISSING);
-    } else {
-        result = HashCollisionNode_find((HashCollisionNode *)self->root, 0, h, key, _MISSING);
-    }
+        for (int level = BITS; level <= shift; level += BITS) {
+            Py_ssize_t parents = (len + MASK) >> BITS;
+            for (Py_ssize_t p = 0; p < parents; p++) {
+                IntVectorNode *parent = IntVectorNode_create(NULL);
+                if (!parent) {
+                    for (Py_ssize_t i = 0; i < p; i++) Py_DECREF(nodes[i]);
+                    for (Py_ssize_t i = p * WIDTH; i < len; i++) Py_DECREF(nodes[i]);
+                    PyMem_Free(nodes);
+                    return NULL;
+                }
+                Py_ssize_t first = p * WIDTH;
+                for (int c = 0; c < WIDTH && first + c < len; c++) {
+                    parent->data.children[c] = nodes[first + c];
+                    parent->valid_mask |= (1u << c);
+                }
+                nodes[p] = parent;
+            }
+            len = parents;
+        }
+        root = nodes[0];
+        PyMem_Free(nodes);
+        goto done;
 
-    if (!result) return -1;
+    error:
+        for (Py_ssize_t i = 0; i < built; i++) Py_DECREF(nodes[i]);
+        PyMem_Free(nodes);
+        return NULL;
+    }
 
-    int found = (result != _MISSING);
-    Py_DECREF(result);
-    return found;
+done:;
+    IntVector *vec = IntVector_create(n, shift, root, (int64_t *)src + tail_off,
+                                     n - tail_off, NULL);
+    Py_XDECREF(root);
+    return (PyObject *)vec;
 }
 
-static PyObject *TransientSet_iter(TransientSet *self) {
-    TransientSet_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
-
-    if (self->root == NULL) {
-        // Return empty iterator
-        return PyObject_GetIter(PyTuple_New(0));
+// Element code of a one-dimensional, native-order buffer, or 0 when the
+// buffer has to be read through the iteration protocol instead
+static char typed_buffer_code(Py_buffer *view) {
+    if (view->ndim != 1 || view->itemsize <= 0) return 0;
+    const char *f = view->format ? view->format : "B";
+    if (*f == '@' || *f == '=') {
+        f++;
     }
-
-    if (PyObject_TypeCheck(self->root, &BitmapIndexedNodeType)) {
-        return BitmapIndexedNode_iter_mode((BitmapIndexedNode *)self->root, ITER_MODE_KEYS);
-    } else if (PyObject_TypeCheck(self->root, &ArrayNodeType)) {
-        return ArrayNode_iter_mode((ArrayNode *)self->root, ITER_MODE_KEYS);
-    } else {
-        return HashCollisionNode_iter_mode((HashCollisionNode *)self->root, ITER_MODE_KEYS);
+#if PY_LITTLE_ENDIAN
+    else if (*f == '<') f++;
+#else
+    else if (*f == '>' || *f == '!') f++;
+#endif
+    if (f[0] == '\0' || f[1] != '\0') return 0;
+
+    switch (f[0]) {
+    case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+    case 'B': case 'H': case 'I': case 'L': case 'Q': case 'N': case '?':
+        return (view->itemsize == 1 || view->itemsize == 2 ||
+                view->itemsize == 4 || view->itemsize == 8) ? f[0] : 0;
+    case 'f':
+        return view->itemsize == sizeof(float) ? 'f' : 0;
+    case 'd':
+        return view->itemsize == sizeof(double) ? 'd' : 0;
+    default:
+        return 0;
     }
 }
 
-// Python set methods: add, discard, remove, clear
+static int typed_code_is_float(char code) {
+    return code == 'f' || code == 'd';
+}
 
-static PyObject *TransientSet_add(TransientSet *self, PyObject *key) {
-    // add() is alias for conj_mut but returns None (Python set semantics)
-    PyObject *result = TransientSet_conj_mut(self, key);
-    if (!result) return NULL;
-    Py_DECREF(result);
-    Py_RETURN_NONE;
+static int typed_code_is_unsigned(char code) {
+    return code == 'B' || code == 'H' || code == 'I' || code == 'L' ||
+           code == 'Q' || code == 'N' || code == '?';
 }
 
-static PyObject *TransientSet_discard(TransientSet *self, PyObject *key) {
-    // discard() removes key if present, does not raise if missing
-    PyObject *result = TransientSet_disj_mut(self, key);
-    if (!result) return NULL;
-    Py_DECREF(result);
-    Py_RETURN_NONE;
+// Read integer item i; *is_big is set for unsigned values above INT64_MAX
+static int64_t typed_buffer_int_at(const char *buf, Py_ssize_t i, Py_ssize_t size,
+                                   int is_unsigned, int *is_big) {
+    const char *p = buf + i * size;
+    *is_big = 0;
+    switch (size) {
+    case 1: {
+        if (is_unsigned) return *(const uint8_t *)p;
+        return *(const int8_t *)p;
+    }
+    case 2: {
+        if (is_unsigned) { uint16_t v; memcpy(&v, p, 2); return v; }
+        int16_t v; memcpy(&v, p, 2); return v;
+    }
+    case 4: {
+        if (is_unsigned) { uint32_t v; memcpy(&v, p, 4); return v; }
+        int32_t v; memcpy(&v, p, 4); return v;
+    }
+    default: {
+        if (is_unsigned) {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            *is_big = v > (uint64_t)INT64_MAX;
+            return (int64_t)v;
+        }
+        int64_t v; memcpy(&v, p, 8); return v;
+    }
+    }
 }
 
-static PyObject *TransientSet_remove(TransientSet *self, PyObject *key) {
-    // remove() raises KeyError if key not present
-    TransientSet_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+// Try to build from a buffer. Returns the vector, NULL with an error set,
+// or NULL without an error when obj must go through iteration instead.
+static PyObject *DoubleVector_from_buffer(PyObject *obj) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        PyErr_Clear();
+        return NULL;
+    }
+    char code = typed_buffer_code(&view);
+    if (!code) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
 
-    // Check if key exists first
-    int found = TransientSet_contains(self, key);
-    if (found < 0) return NULL;  // Error occurred
+    Py_ssize_t n = view.len / view.itemsize;
+    PyObject *result;
+    if (code == 'd') {
+        result = DoubleVector_from_array((const double *)view.buf, n, NULL);
+    } else {
+        double *vals = PyMem_Malloc((n ? n : 1) * sizeof(double));
+        if (!vals) {
+            PyBuffer_Release(&view);
+            return PyErr_NoMemory();
+        }
+        const char *buf = (const char *)view.buf;
+        if (code == 'f') {
+            for (Py_ssize_t i = 0; i < n; i++) {
+                float v;
+                memcpy(&v, buf + i * sizeof(float), sizeof(float));
+                vals[i] = v;
+            }
+        } else {
+            int is_unsigned = typed_code_is_unsigned(code);
+            for (Py_ssize_t i = 0; i < n; i++) {
+                int is_big;
+                int64_t v = typed_buffer_int_at(buf, i, view.itemsize, is_unsigned, &is_big);
+                vals[i] = is_big ? (double)(uint64_t)v : (double)v;
+            }
+        }
+        result = DoubleVector_from_array(vals, n, NULL);
+        PyMem_Free(vals);
+    }
+    PyBuffer_Release(&view);
+    return result;
+}
 
-    if (!found) {
-        PyErr_SetObject(PyExc_KeyError, key);
+static PyObject *IntVector_from_buffer(PyObject *obj) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        PyErr_Clear();
+        return NULL;
+    }
+    char code = typed_buffer_code(&view);
+    // Float buffers fall back to iteration, which reports the TypeError
+    if (!code || typed_code_is_float(code)) {
+        PyBuffer_Release(&view);
         return NULL;
     }
 
-    PyObject *result = TransientSet_disj_mut(self, key);
-    if (!result) return NULL;
-    Py_DECREF(result);
-    Py_RETURN_NONE;
+    Py_ssize_t n = view.len / view.itemsize;
+    PyObject *result;
+    if (view.itemsize == sizeof(int64_t) && !typed_code_is_unsigned(code)) {
+        result = IntVector_from_array((const int64_t *)view.buf, n, NULL);
+    } else {
+        int64_t *vals = PyMem_Malloc((n ? n : 1) * sizeof(int64_t));
+        if (!vals) {
+            PyBuffer_Release(&view);
+            return PyErr_NoMemory();
+        }
+        const char *buf = (const char *)view.buf;
+        int is_unsigned = typed_code_is_unsigned(code);
+        for (Py_ssize_t i = 0; i < n; i++) {
+            int is_big;
+            vals[i] = typed_buffer_int_at(buf, i, view.itemsize, is_unsigned, &is_big);
+            if (is_big) {
+                PyMem_Free(vals);
+                PyBuffer_Release(&view);
+                PyErr_Format(PyExc_OverflowError,
+                    "vec_i64 element %zd does not fit in int64", i);
+                return NULL;
+            }
+        }
+        result = IntVector_from_array(vals, n, NULL);
+        PyMem_Free(vals);
+    }
+    PyBuffer_Release(&view);
+    return result;
 }
 
-static PyObject *TransientSet_clear(TransientSet *self, PyObject *Py_UNUSED(ignored)) {
-    TransientSet_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+// A lone argument is taken as a collection of elements when it exposes a
+// buffer or is a non-numeric iterable; anything else is a single element.
+// Returns a new reference to the sequence of items, or NULL (error set or
+// not) as for the *_from_buffer helpers, with *result set on buffer success.
+static PyObject *typed_vector_items(PyObject *args, const char *name,
+                                    PyObject *(*from_buffer)(PyObject *),
+                                    PyObject **result) {
+    *result = NULL;
+    if (PyTuple_GET_SIZE(args) != 1) {
+        Py_INCREF(args);
+        return args;
+    }
 
-    Py_XDECREF(self->root);
-    self->root = NULL;
-    self->cnt = 0;
+    PyObject *arg = PyTuple_GET_ITEM(args, 0);
+    if (PyFloat_Check(arg) || PyLong_Check(arg) || PyUnicode_Check(arg)) {
+        Py_INCREF(args);
+        return args;
+    }
+    if (PyObject_CheckBuffer(arg)) {
+        *result = from_buffer(arg);
+        if (*result || PyErr_Occurred()) return NULL;
+    }
 
-    Py_RETURN_NONE;
+    PyObject *iter = PyObject_GetIter(arg);
+    if (!iter) {
+        PyErr_Clear();
+        Py_INCREF(args);
+        return args;
+    }
+    Py_DECREF(iter);
+    return PySequence_Fast(arg, name);
 }
 
-static PyMethodDef TransientSet_methods[] = {
-    {"conj_mut", (PyCFunction)TransientSet_conj_mut, METH_O, "Mutably add element"},
-    {"disj_mut", (PyCFunction)TransientSet_disj_mut, METH_O, "Mutably remove element"},
-    {"persistent", (PyCFunction)TransientSet_persistent, METH_NOARGS, "Return persistent set"},
-    {"add", (PyCFunction)TransientSet_add, METH_O, "Add element to set"},
-    {"discard", (PyCFunction)TransientSet_discard, METH_O, "Remove element if present"},
-    {"remove", (PyCFunction)TransientSet_remove, METH_O, "Remove element, raise KeyError if missing"},
-    {"clear", (PyCFunction)TransientSet_clear, METH_NOARGS, "Remove all elements"},
-    {NULL}
-};
+static PyObject *pds_vec_f64(PyObject *self, PyObject *args) {
+    PyObject *result;
+    PyObject *items = typed_vector_items(args, "vec_f64 expects numbers or an iterable",
+                                         DoubleVector_from_buffer, &result);
+    if (!items) return result;
 
-static PySequenceMethods TransientSet_as_sequence = {
-    .sq_length = (lenfunc)TransientSet_length,
-    .sq_contains = (objobjproc)TransientSet_contains,
-};
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(items);
+    PyObject **elems = PySequence_Fast_ITEMS(items);
 
-static PyTypeObject TransientSetType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.TransientSet",
-    .tp_doc = "Transient set for batch operations",
-    .tp_basicsize = sizeof(TransientSet),
-    .tp_dealloc = (destructor)TransientSet_dealloc,
-    .tp_as_sequence = &TransientSet_as_sequence,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_iter = (getiterfunc)TransientSet_iter,
-    .tp_methods = TransientSet_methods,
-};
+    // Unbox once into a flat array, then build the trie in bulk
+    double *vals = PyMem_Malloc((n ? n : 1) * sizeof(double));
+    if (!vals) {
+        Py_DECREF(items);
+        return PyErr_NoMemory();
+    }
 
-// === SortedVector (Persistent Red-Black Tree with size annotations) ===
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *item = elems[i];
+        double val = PyFloat_AsDouble(item);
 
-#define RB_RED 0
-#define RB_BLACK 1
+        if (val == -1.0 && PyErr_Occurred()) {
+            PyErr_Clear();
+            PyErr_Format(PyExc_TypeError,
+                "vec_f64 argument %zd must be a number, got %s",
+                i, Py_TYPE(item)->tp_name);
+            PyMem_Free(vals);
+            Py_DECREF(items);
+            return NULL;
+        }
+        vals[i] = val;
+    }
 
-// Red-Black Tree Node
-typedef struct RBNode {
-    PyObject_HEAD
-    PyObject *value;       // The stored element
-    PyObject *sort_key;    // Cached key for comparison (result of key_fn(value))
-    struct RBNode *left;
-    struct RBNode *right;
-    Py_ssize_t size;       // Subtree size for O(log n) indexing
-    unsigned char color;   // RB_RED or RB_BLACK
-    PyObject *edit;        // For transient support (NULL = persistent)
-} RBNode;
-
-static PyTypeObject RBNodeType;
-
-static void RBNode_dealloc(RBNode *self) {
-    Py_XDECREF(self->value);
-    Py_XDECREF(self->sort_key);
-    Py_XDECREF(self->left);
-    Py_XDECREF(self->right);
-    Py_XDECREF(self->edit);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    result = DoubleVector_from_array(vals, n, NULL);
+    PyMem_Free(vals);
+    Py_DECREF(items);
+    return result;
 }
 
-static Py_ssize_t RBNode_size(RBNode *node) {
-    return node ? node->size : 0;
-}
+static PyObject *pds_vec_i64(PyObject *self, PyObject *args) {
+    PyObject *result;
+    PyObject *items = typed_vector_items(args, "vec_i64 expects integers or an iterable",
+                                         IntVector_from_buffer, &result);
+    if (!items) return result;
 
-static void RBNode_update_size(RBNode *node) {
-    if (node) {
-        node->size = 1 + RBNode_size(node->left) + RBNode_size(node->right);
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(items);
+    PyObject **elems = PySequence_Fast_ITEMS(items);
+
+    int64_t *vals = PyMem_Malloc((n ? n : 1) * sizeof(int64_t));
+    if (!vals) {
+        Py_DECREF(items);
+        return PyErr_NoMemory();
     }
-}
 
-static RBNode *RBNode_create(PyObject *value, PyObject *sort_key, unsigned char color, PyObject *edit) {
-    RBNode *node = PyObject_New(RBNode, &RBNodeType);
-    if (!node) return NULL;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *item = elems[i];
+        int64_t val = PyLong_AsLongLong(item);
 
-    Py_INCREF(value);
-    node->value = value;
-    Py_INCREF(sort_key);
-    node->sort_key = sort_key;
-    node->left = NULL;
-    node->right = NULL;
-    node->size = 1;
-    node->color = color;
-    node->edit = edit;
-    Py_XINCREF(edit);
+        if (val == -1 && PyErr_Occurred()) {
+            PyErr_Clear();
+            PyErr_Format(PyExc_TypeError,
+                "vec_i64 argument %zd must be an integer, got %s",
+                i, Py_TYPE(item)->tp_name);
+            PyMem_Free(vals);
+            Py_DECREF(items);
+            return NULL;
+        }
+        vals[i] = val;
+    }
 
-    return node;
+    result = IntVector_from_array(vals, n, NULL);
+    PyMem_Free(vals);
+    Py_DECREF(items);
+    return result;
 }
 
-// Clone a node (for persistent operations)
-static RBNode *RBNode_clone(RBNode *node, PyObject *edit) {
-    if (!node) return NULL;
+static PyObject *pds_sorted_vec(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"", "key", "reverse", NULL};
+    PyObject *iterable = NULL;
+    PyObject *key_fn = Py_None;
+    int reverse = 0;
 
-    RBNode *new_node = PyObject_New(RBNode, &RBNodeType);
-    if (!new_node) return NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O$Op", kwlist,
+                                     &iterable, &key_fn, &reverse)) {
+        return NULL;
+    }
 
-    Py_INCREF(node->value);
-    new_node->value = node->value;
-    Py_INCREF(node->sort_key);
-    new_node->sort_key = node->sort_key;
-    new_node->left = node->left;
-    Py_XINCREF(new_node->left);
-    new_node->right = node->right;
-    Py_XINCREF(new_node->right);
-    new_node->size = node->size;
-    new_node->color = node->color;
-    new_node->edit = edit;
-    Py_XINCREF(edit);
+    SortedVector *sv = (SortedVector *)SortedVector_new(&SortedVectorType, NULL, NULL);
+    if (!sv) return NULL;
 
-    return new_node;
-}
+    sv->reverse = reverse;
+    if (key_fn != Py_None) {
+        sv->key_fn = key_fn;
+        Py_INCREF(key_fn);
+    }
 
-static int RBNode_is_red(RBNode *node) {
-    return node && node->color == RB_RED;
-}
+    if (iterable && iterable != Py_None && SortedVector_fill(sv, iterable) < 0) {
+        Py_DECREF(sv);
+        return NULL;
+    }
 
-static int RBNode_is_editable(RBNode *node, PyObject *edit) {
-    return node && edit && node->edit == edit;
+    return (PyObject *)sv;
 }
 
-// Ensure node is editable (clone if necessary)
-static RBNode *RBNode_ensure_editable(RBNode *node, PyObject *edit) {
-    if (!node) return NULL;
-    if (RBNode_is_editable(node, edit)) {
-        Py_INCREF(node);
-        return node;
+/* int_map(src=None) - IntMap from a dict, Map or iterable of (key, value) pairs */
+static PyObject *pds_int_map(PyObject *self, PyObject *args) {
+    PyObject *src = NULL;
+    if (!PyArg_ParseTuple(args, "|O:int_map", &src)) {
+        return NULL;
     }
-    return RBNode_clone(node, edit);
+    return IntMap_from(&IntMapType, src);
 }
 
-static PyTypeObject RBNodeType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.RBNode",
-    .tp_doc = "Red-Black Tree Node (internal)",
-    .tp_basicsize = sizeof(RBNode),
-    .tp_dealloc = (destructor)RBNode_dealloc,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-};
-
-// Compare two sort keys, returning -1, 0, or 1
-// Also handles reverse ordering
-static int SortedVector_compare_keys(PyObject *a, PyObject *b, int reverse) {
-    int cmp = PyObject_RichCompareBool(a, b, Py_LT);
-    if (cmp < 0) return -2;  // Error
-    if (cmp) return reverse ? 1 : -1;
-
-    cmp = PyObject_RichCompareBool(a, b, Py_GT);
-    if (cmp < 0) return -2;  // Error
-    if (cmp) return reverse ? -1 : 1;
-
-    return 0;  // Equal
+/* int_set(iterable=None) - IntSet of the ints in iterable */
+static PyObject *pds_int_set(PyObject *self, PyObject *args) {
+    PyObject *iterable = NULL;
+    if (!PyArg_ParseTuple(args, "|O:int_set", &iterable)) {
+        return NULL;
+    }
+    return IntMap_from(&IntSetType, iterable);
 }
 
-// === Red-Black Tree Rotations (return new root of subtree) ===
-
-static RBNode *RBNode_rotate_left(RBNode *h, PyObject *edit) {
-    RBNode *x = RBNode_ensure_editable(h->right, edit);
-    if (!x) return NULL;
+// =============================================================================
+// COMPACT PICKLING
+// =============================================================================
+// Reconstructors named by the __reduce_ex__ methods. Typed vectors load from
+// one block of little-endian words, without boxing an element; Map and Set
+// load from their entries and stored key hashes (see Hashed pickling).
 
-    RBNode *new_h = RBNode_ensure_editable(h, edit);
-    if (!new_h) {
-        Py_DECREF(x);
+// The mapping pds_open is loading from, set for the length of its
+// pickle.loads call. A typed vector whose data lies inside it keeps its full
+// leaves in the mapping rather than copying them out.
+typedef struct {
+    PyObject *view;
+    const char *base;
+    Py_ssize_t len;
+} SnapshotMapping;
+
+static PDS_THREAD_LOCAL SnapshotMapping snapshot_loading = {NULL, NULL, 0};
+
+/* _typed_vector(code, data) - DoubleVector ('d') or IntVector ('q') from a
+   bytes-like block of little-endian 8-byte words */
+static PyObject *pds_typed_vector(PyObject *self, PyObject *args) {
+    int code;
+    Py_buffer view;
+    if (!PyArg_ParseTuple(args, "Cy*:_typed_vector", &code, &view)) {
+        return NULL;
+    }
+    if ((code != 'd' && code != 'q') || view.len % 8 != 0) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "_typed_vector: malformed typed vector data");
         return NULL;
     }
 
-    Py_XDECREF(new_h->right);
-    new_h->right = x->left;
-    Py_XINCREF(new_h->right);
-
-    Py_XDECREF(x->left);
-    x->left = new_h;
-    // new_h reference is now owned by x->left
-
-    x->color = new_h->color;
-    new_h->color = RB_RED;
-
-    RBNode_update_size(new_h);
-    RBNode_update_size(x);
-
-    return x;
+    Py_ssize_t n = view.len / 8;
+    const char *src = view.buf;
+    char *swapped = NULL;
+    if (!PY_LITTLE_ENDIAN && n > 0) {
+        swapped = PyMem_Malloc(view.len);
+        if (swapped == NULL) {
+            PyBuffer_Release(&view);
+            return PyErr_NoMemory();
+        }
+        le64_copy(swapped, src, n);
+        src = swapped;
+    }
+    PyObject *owner = NULL;
+    uintptr_t at = (uintptr_t)src, base = (uintptr_t)snapshot_loading.base;
+    if (snapshot_loading.view && !swapped && at % 8 == 0 && at >= base &&
+        at - base <= (uintptr_t)snapshot_loading.len &&
+        (uintptr_t)view.len <= (uintptr_t)snapshot_loading.len - (at - base)) {
+        owner = snapshot_loading.view;
+    }
+    PyObject *result = code == 'd' ? DoubleVector_from_array((const double *)src, n, owner)
+                                   : IntVector_from_array((const int64_t *)src, n, owner);
+    PyMem_Free(swapped);
+    PyBuffer_Release(&view);
+    return result;
 }
 
-static RBNode *RBNode_rotate_right(RBNode *h, PyObject *edit) {
-    RBNode *x = RBNode_ensure_editable(h->left, edit);
-    if (!x) return NULL;
-
-    RBNode *new_h = RBNode_ensure_editable(h, edit);
-    if (!new_h) {
-        Py_DECREF(x);
+// Build entries from the (fingerprint, hashes, items) arguments of a hashed
+// pickle, reusing the stored hash of every key pds_value_hashed trusts
+static MapBuildEntry *hashed_entries(PyObject *args, int keys_only, const char *fname, Py_ssize_t *n_out) {
+    PyObject *fingerprint, *items;
+    Py_buffer view;
+    if (!PyArg_ParseTuple(args, "O!y*O!", &PyLong_Type, &fingerprint, &view, &PyTuple_Type, &items)) {
         return NULL;
     }
 
-    Py_XDECREF(new_h->left);
-    new_h->left = x->right;
-    Py_XINCREF(new_h->left);
-
-    Py_XDECREF(x->right);
-    x->right = new_h;
-    // new_h reference is now owned by x->right
-
-    x->color = new_h->color;
-    new_h->color = RB_RED;
-
-    RBNode_update_size(new_h);
-    RBNode_update_size(x);
-
-    return x;
-}
-
-// Safe flip colors that ensures all nodes are editable first
-static RBNode *RBNode_flip_colors(RBNode *h, PyObject *edit) {
-    RBNode *new_h = RBNode_ensure_editable(h, edit);
-    if (!new_h) return NULL;
+    Py_ssize_t stride = keys_only ? 1 : 2;
+    Py_ssize_t n = PyTuple_GET_SIZE(items) / stride;
+    if (PyTuple_GET_SIZE(items) % stride != 0 || view.len != 8 * n) {
+        PyBuffer_Release(&view);
+        PyErr_Format(PyExc_ValueError, "%s: malformed hashed pickle", fname);
+        return NULL;
+    }
 
-    new_h->color = !new_h->color;
+    int overflow;
+    long long stored = PyLong_AsLongLongAndOverflow(fingerprint, &overflow);
+    Py_hash_t local = pds_hash_fingerprint();
+    if (local == -1) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    int trusted = !overflow && stored == (long long)local;
 
-    if (new_h->left) {
-        RBNode *new_left = RBNode_ensure_editable(new_h->left, edit);
-        if (!new_left) {
-            Py_DECREF(new_h);
+    MapBuildEntry *e = PyMem_Malloc((n ? n : 1) * sizeof(MapBuildEntry));
+    if (!e) {
+        PyBuffer_Release(&view);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    const char *hashes = view.buf;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *key = PyTuple_GET_ITEM(items, stride * i);
+        Py_hash_t h;
+        if (trusted && pds_value_hashed(key)) {
+            int64_t h64;
+            le64_copy((char *)&h64, hashes + 8 * i, 1);
+            h = (Py_hash_t)h64;
+        } else if ((h = PyObject_Hash(key)) == -1 && PyErr_Occurred()) {
+            MapBuild_clear(e, i);
+            PyBuffer_Release(&view);
             return NULL;
         }
-        new_left->color = !new_left->color;
-        Py_XDECREF(new_h->left);
-        new_h->left = new_left;
+        e[i].hash = h;
+        e[i].key = key;
+        e[i].val = keys_only ? Py_None : PyTuple_GET_ITEM(items, 2 * i + 1);
+        Py_INCREF(e[i].key);
+        Py_INCREF(e[i].val);
+    }
+    PyBuffer_Release(&view);
+    *n_out = n;
+    return e;
+}
+
+/* _map_from_hashed(fingerprint, hashes, kvs) - Map from a hashed pickle */
+static PyObject *pds_map_from_hashed(PyObject *self, PyObject *args) {
+    Py_ssize_t n;
+    MapBuildEntry *e = hashed_entries(args, 0, "_map_from_hashed", &n);
+    if (!e) return NULL;
+    return Map_build(e, n);
+}
+
+/* _set_from_hashed(fingerprint, hashes, keys) - Set from a hashed pickle */
+static PyObject *pds_set_from_hashed(PyObject *self, PyObject *args) {
+    Py_ssize_t n, cnt;
+    MapBuildEntry *e = hashed_entries(args, 1, "_set_from_hashed", &n);
+    if (!e) return NULL;
+    PyObject *root = MapBuild_root(e, n, &cnt);
+    if (!root) {
+        if (PyErr_Occurred()) return NULL;
+        Py_INCREF(EMPTY_SET);
+        return (PyObject *)EMPTY_SET;
     }
+    Set *result = Set_create(cnt, root, NULL);
+    Py_DECREF(root);
+    return (PyObject *)result;
+}
 
-    if (new_h->right) {
-        RBNode *new_right = RBNode_ensure_editable(new_h->right, edit);
-        if (!new_right) {
-            Py_DECREF(new_h);
+/* register_value_hash(cls) - trust the pickled hashes of Map keys and Set
+   elements of exactly type cls. Its hash must follow from the value alone
+   (like a hash of str or int fields), never from identity. Returns cls. */
+static PyObject *pds_register_value_hash(PyObject *self, PyObject *cls) {
+    if (!PyType_Check(cls)) {
+        PyErr_SetString(PyExc_TypeError, "register_value_hash expects a type");
+        return NULL;
+    }
+    int known = 0;
+    for (int i = 0; i < pds_value_hash_ntypes; i++) {
+        known |= pds_value_hash_types[i] == (PyTypeObject *)cls;
+    }
+    if (!known) {
+        if (pds_value_hash_ntypes == PDS_VALUE_HASH_TYPES_MAX) {
+            PyErr_SetString(PyExc_ValueError, "register_value_hash: too many registered types");
             return NULL;
         }
-        new_right->color = !new_right->color;
-        Py_XDECREF(new_h->right);
-        new_h->right = new_right;
+        Py_INCREF(cls);
+        pds_value_hash_types[pds_value_hash_ntypes++] = (PyTypeObject *)cls;
     }
+    Py_INCREF(cls);
+    return cls;
+}
 
-    return new_h;
+// =============================================================================
+// SNAPSHOTS
+// =============================================================================
+// Memory-mapped pickles. dump(coll, path) writes a file that open(path)
+// memory-maps. The file holds a header, a table of buffers, the protocol 5
+// pickle of coll, and then each out-of-band buffer at a SNAPSHOT_ALIGN-aligned
+// offset. Those buffers are typed-vector data and Map/Set key hashes, plus any
+// buffers other objects hand out. open is pickle.loads with the buffers sliced
+// from a read-only mapping. This is not a lazily decoded node format: every
+// object is rebuilt in private memory before open returns, Maps and Sets in
+// bulk from their stored hashes. Only buffer contents stay in the mapping: the
+// full leaves of a typed vector point into it and hold a reference to it, as
+// does any buffer another object keeps (a numpy array, say). On big-endian
+// hosts typed vectors are copied out instead. All integers in the header and
+// table are little-endian uint64:
+//
+//   0   magic "SPORKPDS"      24  pickle offset
+//   8   format version        32  pickle length
+//   16  buffer count          40  per buffer: offset, length
+
+#define SNAPSHOT_MAGIC "SPORKPDS"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER 40
+#define SNAPSHOT_ALIGN 64
+
+static inline void snapshot_put(char *dst, uint64_t v) {
+    le64_copy(dst, (const char *)&v, 1);
+}
+
+static inline uint64_t snapshot_get(const char *src) {
+    uint64_t v;
+    le64_copy((char *)&v, src, 1);
+    return v;
+}
+
+// pickle.<name>(arg, **kwargs)
+static PyObject *snapshot_call_pickle(const char *name, PyObject *arg, PyObject *kwargs) {
+    PyObject *pickle = PyImport_ImportModule("pickle");
+    if (!pickle) return NULL;
+    PyObject *fn = PyObject_GetAttrString(pickle, name);
+    Py_DECREF(pickle);
+    if (!fn) return NULL;
+    PyObject *call_args = PyTuple_Pack(1, arg);
+    PyObject *result = call_args ? PyObject_Call(fn, call_args, kwargs) : NULL;
+    Py_XDECREF(call_args);
+    Py_DECREF(fn);
+    return result;
 }
 
-// Balance after insertion
-static RBNode *RBNode_balance(RBNode *h, PyObject *edit) {
-    if (!h) return NULL;
+// Write len bytes, padded with zeros up to offset `at` first; 0 or -1 (see errno)
+static int snapshot_write(FILE *fp, uint64_t *pos, uint64_t at, const void *buf, Py_ssize_t len) {
+    static const char zeros[SNAPSHOT_ALIGN] = {0};
+    if (at > *pos && fwrite(zeros, 1, (size_t)(at - *pos), fp) != (size_t)(at - *pos)) return -1;
+    if (len > 0 && fwrite(buf, 1, (size_t)len, fp) != (size_t)len) return -1;
+    *pos = at + (uint64_t)len;
+    return 0;
+}
 
-    // Right-leaning red link -> rotate left
-    if (RBNode_is_red(h->right) && !RBNode_is_red(h->left)) {
-        h = RBNode_rotate_left(h, edit);
-        if (!h) return NULL;
+/* dump(coll, path) - write coll to a snapshot file for open(); returns the
+   file size in bytes */
+static PyObject *pds_dump(PyObject *self, PyObject *args) {
+    PyObject *coll, *path;
+    if (!PyArg_ParseTuple(args, "OO&:dump", &coll, PyUnicode_FSConverter, &path)) {
+        return NULL;
     }
 
-    // Two consecutive left red links -> rotate right
-    if (RBNode_is_red(h->left) && RBNode_is_red(h->left->left)) {
-        h = RBNode_rotate_right(h, edit);
-        if (!h) return NULL;
-    }
+    PyObject *result = NULL, *kwargs = NULL, *data = NULL;
+    PyObject *buffers = PyList_New(0);
+    PyObject *append = buffers ? PyObject_GetAttrString(buffers, "append") : NULL;
+    Py_buffer *views = NULL;
+    Py_ssize_t nviews = 0;
+    char *table = NULL;
+    if (append) kwargs = Py_BuildValue("{s:i,s:O}", "protocol", 5, "buffer_callback", append);
+    if (kwargs) data = snapshot_call_pickle("dumps", coll, kwargs);
+    if (!data) goto done;
+
+    Py_ssize_t nbuf = PyList_GET_SIZE(buffers);
+    Py_ssize_t table_len = SNAPSHOT_HEADER + 16 * nbuf;
+    views = PyMem_Calloc(nbuf ? nbuf : 1, sizeof(Py_buffer));
+    table = PyMem_Malloc(table_len);
+    if (!views || !table) {
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    uint64_t end = (uint64_t)table_len + (uint64_t)PyBytes_GET_SIZE(data);
+    for (; nviews < nbuf; nviews++) {
+        if (PyObject_GetBuffer(PyList_GET_ITEM(buffers, nviews), &views[nviews], PyBUF_CONTIG_RO) < 0) goto done;
+        uint64_t at = (end + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+        snapshot_put(table + SNAPSHOT_HEADER + 16 * nviews, at);
+        snapshot_put(table + SNAPSHOT_HEADER + 16 * nviews + 8, (uint64_t)views[nviews].len);
+        end = at + (uint64_t)views[nviews].len;
+    }
+    memcpy(table, SNAPSHOT_MAGIC, 8);
+    snapshot_put(table + 8, SNAPSHOT_VERSION);
+    snapshot_put(table + 16, (uint64_t)nbuf);
+    snapshot_put(table + 24, (uint64_t)table_len);
+    snapshot_put(table + 32, (uint64_t)PyBytes_GET_SIZE(data));
+
+    FILE *fp = fopen(PyBytes_AS_STRING(path), "wb");
+    if (!fp) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, PyBytes_AS_STRING(path));
+        goto done;
+    }
+    int failed;
+    Py_BEGIN_ALLOW_THREADS
+    uint64_t pos = 0;
+    failed = snapshot_write(fp, &pos, 0, table, table_len) < 0 ||
+             snapshot_write(fp, &pos, pos, PyBytes_AS_STRING(data), PyBytes_GET_SIZE(data)) < 0;
+    for (Py_ssize_t i = 0; !failed && i < nbuf; i++) {
+        uint64_t at = snapshot_get(table + SNAPSHOT_HEADER + 16 * i);
+        failed = snapshot_write(fp, &pos, at, views[i].buf, views[i].len) < 0;
+    }
+    failed = fclose(fp) != 0 || failed;
+    Py_END_ALLOW_THREADS
+    if (failed) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, PyBytes_AS_STRING(path));
+        goto done;
+    }
+    result = PyLong_FromUnsignedLongLong(end);
+
+done:
+    for (Py_ssize_t i = 0; i < nviews; i++) PyBuffer_Release(&views[i]);
+    PyMem_Free(views);
+    PyMem_Free(table);
+    Py_XDECREF(data);
+    Py_XDECREF(kwargs);
+    Py_XDECREF(append);
+    Py_XDECREF(buffers);
+    Py_DECREF(path);
+    return result;
+}
 
-    // Both children red -> flip colors
-    if (RBNode_is_red(h->left) && RBNode_is_red(h->right)) {
-        h = RBNode_flip_colors(h, edit);
-        if (!h) return NULL;
+// view[start:start + len], after checking it lies inside the view
+static PyObject *snapshot_slice(PyObject *view, uint64_t start, uint64_t len) {
+    uint64_t size = (uint64_t)PyMemoryView_GET_BUFFER(view)->len;
+    if (start > size || len > size - start) {
+        PyErr_SetString(PyExc_ValueError, "open: truncated pds snapshot");
+        return NULL;
     }
+    PyObject *lo = PyLong_FromUnsignedLongLong(start);
+    PyObject *hi = PyLong_FromUnsignedLongLong(start + len);
+    PyObject *slice = lo && hi ? PySlice_New(lo, hi, NULL) : NULL;
+    PyObject *result = slice ? PyObject_GetItem(view, slice) : NULL;
+    Py_XDECREF(lo);
+    Py_XDECREF(hi);
+    Py_XDECREF(slice);
+    return result;
+}
 
-    RBNode_update_size(h);
-    return h;
+// Read-only memoryview over an mmap of the file at path
+static PyObject *snapshot_map(PyObject *path) {
+    PyObject *io = PyImport_ImportModule("io");
+    PyObject *mmap_module = io ? PyImport_ImportModule("mmap") : NULL;
+    PyObject *file = mmap_module ? PyObject_CallMethod(io, "open", "Os", path, "rb") : NULL;
+    PyObject *fileno = file ? PyObject_CallMethod(file, "fileno", NULL) : NULL;
+    PyObject *map = NULL, *view = NULL;
+    if (fileno) {
+        PyObject *access = PyObject_GetAttrString(mmap_module, "ACCESS_READ");
+        PyObject *mmap_type = access ? PyObject_GetAttrString(mmap_module, "mmap") : NULL;
+        PyObject *kwargs = mmap_type ? Py_BuildValue("{s:O}", "access", access) : NULL;
+        PyObject *call_args = kwargs ? Py_BuildValue("(Oi)", fileno, 0) : NULL;
+        if (call_args) map = PyObject_Call(mmap_type, call_args, kwargs);
+        Py_XDECREF(call_args);
+        Py_XDECREF(kwargs);
+        Py_XDECREF(mmap_type);
+        Py_XDECREF(access);
+    }
+    if (file) {
+        // The mapping outlives the file object
+        PyObject *closed = PyObject_CallMethod(file, "close", NULL);
+        if (!closed) Py_CLEAR(map);
+        Py_XDECREF(closed);
+    }
+    if (map) view = PyMemoryView_FromObject(map);
+    Py_XDECREF(map);
+    Py_XDECREF(fileno);
+    Py_XDECREF(file);
+    Py_XDECREF(mmap_module);
+    Py_XDECREF(io);
+    return view;
+}
+
+/* open(path) - load a collection written by dump(): pickle.loads with its
+   buffers read straight from a read-only memory map of the file. Like
+   pickle.load, only open snapshots from a trusted source. */
+static PyObject *pds_open(PyObject *self, PyObject *path) {
+    PyObject *view = snapshot_map(path);
+    if (!view) return NULL;
+
+    PyObject *result = NULL, *payload = NULL, *buffers = NULL, *kwargs = NULL;
+    Py_buffer *buf = PyMemoryView_GET_BUFFER(view);
+    const char *base = buf->buf;
+    if (buf->len < SNAPSHOT_HEADER || memcmp(base, SNAPSHOT_MAGIC, 8) != 0) {
+        PyErr_SetString(PyExc_ValueError, "open: not a pds snapshot");
+        goto done;
+    }
+    if (snapshot_get(base + 8) != SNAPSHOT_VERSION) {
+        PyErr_Format(PyExc_ValueError, "open: unsupported pds snapshot version %llu",
+                     (unsigned long long)snapshot_get(base + 8));
+        goto done;
+    }
+    uint64_t nbuf = snapshot_get(base + 16);
+    if (nbuf > ((uint64_t)buf->len - SNAPSHOT_HEADER) / 16) {
+        PyErr_SetString(PyExc_ValueError, "open: truncated pds snapshot");
+        goto done;
+    }
+
+    buffers = PyList_New((Py_ssize_t)nbuf);
+    if (!buffers) goto done;
+    for (uint64_t i = 0; i < nbuf; i++) {
+        const char *entry = base + SNAPSHOT_HEADER + 16 * i;
+        PyObject *part = snapshot_slice(view, snapshot_get(entry), snapshot_get(entry + 8));
+        if (!part) goto done;
+        PyList_SET_ITEM(buffers, (Py_ssize_t)i, part);
+    }
+    payload = snapshot_slice(view, snapshot_get(base + 24), snapshot_get(base + 32));
+    kwargs = payload ? Py_BuildValue("{s:O}", "buffers", buffers) : NULL;
+    if (kwargs) {
+        SnapshotMapping outer = snapshot_loading;
+        snapshot_loading = (SnapshotMapping){view, base, buf->len};
+        result = snapshot_call_pickle("loads", payload, kwargs);
+        snapshot_loading = outer;
+    }
+
+done:
+    Py_XDECREF(kwargs);
+    Py_XDECREF(payload);
+    Py_XDECREF(buffers);
+    Py_DECREF(view);
+    return result;
 }
 
-// === SortedVector ===
+// =============================================================================
+// JSON DECODING
+// =============================================================================
+// json_loads parses JSON text straight into Maps and Vectors, with no dict or
+// list built on the way. Array items and object entries collect on stacks
+// shared by the whole document. Each container is then built in bulk when it
+// closes: Vector_from_items for arrays, Map_build for objects (so objects of
+// up to ARRAY_MAP_MAX keys get the flat array node). Short ASCII object keys
+// go through a small direct-mapped cache, so a repeated key is one str (or
+// Keyword) object, whose hash is computed once. json_lines reads
+// newline-delimited JSON one document at a time, reusing the same stacks
+// and key cache across lines. The grammar, the number conversions and the
+// error positions follow the json module (NaN and Infinity included).
+// Errors raise json.JSONDecodeError.
+
+#define JSON_KEY_CACHE_SIZE 512  // slots, a power of two
+#define JSON_KEY_CACHE_MAX_LEN 64
 
-typedef struct SortedVector {
-    PyObject_HEAD
-    RBNode *root;
-    Py_ssize_t cnt;
-    PyObject *key_fn;    // Optional key function (NULL = use element itself)
-    int reverse;         // Sort in descending order
-} SortedVector;
+typedef struct {
+    PyObject *name;  // ASCII str of the key text
+    PyObject *key;   // name itself, or Keyword(name)
+    Py_hash_t hash;  // hash of key
+} JsonKeySlot;
+
+// With the GIL, every decoder shares one cache: slots are only read and
+// written from C, with no Python code in between. Free-threaded builds give
+// each decoder its own.
+#ifndef Py_GIL_DISABLED
+static JsonKeySlot json_shared_keys[2][JSON_KEY_CACHE_SIZE];  // [keywordize]
+#endif
 
-static PyTypeObject SortedVectorType;
+// UTF-8 text of a document and what keeps it alive
+typedef struct {
+    PyObject *owner;   // str or bytes holding the text, unless view is used
+    Py_buffer view;    // bytes-like input
+    int has_view;
+    const char *data;
+    Py_ssize_t len;
+    PyObject *doc;     // str form of the document for errors; NULL until needed
+    const char *errors;  // "surrogatepass" if the text carries lone surrogates
+} JsonText;
 
-static void SortedVector_dealloc(SortedVector *self) {
-    Py_XDECREF(self->root);
-    Py_XDECREF(self->key_fn);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+typedef struct {
+    JsonText *text;
+    const char *p, *end;
+    PyObject *keyword;  // Keyword type when keywordizing keys, else NULL
+    JsonKeySlot *keys;  // key cache; NULL until the first key
+    int own_keys;
+    PyObject **items;   // pending array items
+    Py_ssize_t nitems, items_cap;
+    MapBuildEntry *entries;  // pending object entries
+    Py_ssize_t nentries, entries_cap;
+} JsonDecoder;
+
+static void JsonText_release(JsonText *t) {
+    if (t->has_view) PyBuffer_Release(&t->view);
+    t->has_view = 0;
+    Py_CLEAR(t->owner);
+    Py_CLEAR(t->doc);
+}
+
+// Fill t from a str or bytes-like obj; bytes are UTF-8 (a BOM is skipped)
+// or UTF-16/32 as the json module detects them
+static int JsonText_init(JsonText *t, PyObject *obj) {
+    memset(t, 0, sizeof(*t));
+    if (PyUnicode_Check(obj)) {
+        Py_INCREF(obj);
+        t->doc = obj;
+        const char *data = PyUnicode_AsUTF8AndSize(obj, &t->len);
+        if (data == NULL) {
+            // Lone surrogates, which json.loads accepts in str input
+            if (!PyErr_ExceptionMatches(PyExc_UnicodeEncodeError)) return -1;
+            PyErr_Clear();
+            t->owner = PyUnicode_AsEncodedString(obj, "utf-8", "surrogatepass");
+            if (t->owner == NULL) return -1;
+            data = PyBytes_AS_STRING(t->owner);
+            t->len = PyBytes_GET_SIZE(t->owner);
+            t->errors = "surrogatepass";
+        }
+        t->data = data;
+        return 0;
+    }
+    if (!PyObject_CheckBuffer(obj)) {
+        PyErr_Format(PyExc_TypeError, "the JSON object must be str, bytes or bytearray, not %.100s",
+                     Py_TYPE(obj)->tp_name);
+        return -1;
+    }
+    if (PyObject_GetBuffer(obj, &t->view, PyBUF_SIMPLE) < 0) return -1;
+    t->has_view = 1;
+    const unsigned char *b = t->view.buf;
+    Py_ssize_t n = t->view.len;
+    if (n >= 2 && (b[0] == 0 || b[1] == 0 || (b[0] == 0xFF && b[1] == 0xFE) || (b[0] == 0xFE && b[1] == 0xFF))) {
+        // UTF-16 or UTF-32: decode to str the way json.loads would
+        PyObject *json = PyImport_ImportModule("json");
+        PyObject *enc = json ? PyObject_CallMethod(json, "detect_encoding", "O", obj) : NULL;
+        Py_XDECREF(json);
+        PyObject *str = enc ? PyUnicode_FromEncodedObject(obj, PyUnicode_AsUTF8(enc), "surrogatepass") : NULL;
+        Py_XDECREF(enc);
+        JsonText_release(t);
+        if (str == NULL) return -1;
+        int rc = JsonText_init(t, str);
+        Py_DECREF(str);
+        return rc;
+    }
+    if (n >= 3 && b[0] == 0xEF && b[1] == 0xBB && b[2] == 0xBF) {
+        b += 3;
+        n -= 3;
+    }
+    t->data = (const char *)b;
+    t->len = n;
+    return 0;
 }
 
-static PyObject *SortedVector_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
-    SortedVector *self = (SortedVector *)type->tp_alloc(type, 0);
-    if (self) {
-        self->root = NULL;
-        self->cnt = 0;
-        self->key_fn = NULL;
-        self->reverse = 0;
+// JSONDecodeError(msg, doc, pos) for the byte at p
+static void json_error(JsonDecoder *d, const char *msg, const char *p) {
+    JsonText *t = d->text;
+    if (t->doc == NULL) {
+        t->doc = PyUnicode_DecodeUTF8(t->data, t->len, "replace");
+        if (t->doc == NULL) return;
+    }
+    // Character position: count UTF-8 lead bytes before p
+    Py_ssize_t pos = 0;
+    for (const char *c = t->data; c < p; c++) {
+        pos += ((unsigned char)*c & 0xC0) != 0x80;
+    }
+    PyObject *json = PyImport_ImportModule("json");
+    PyObject *cls = json ? PyObject_GetAttrString(json, "JSONDecodeError") : NULL;
+    Py_XDECREF(json);
+    if (cls == NULL) return;
+    PyObject *exc = PyObject_CallFunction(cls, "sOn", msg, t->doc, pos);
+    Py_DECREF(cls);
+    if (exc != NULL) {
+        PyErr_SetObject((PyObject *)Py_TYPE(exc), exc);
+        Py_DECREF(exc);
     }
-    return (PyObject *)self;
 }
 
-// Get the sort key for a value
-static PyObject *SortedVector_get_sort_key(SortedVector *self, PyObject *value) {
-    if (self->key_fn && self->key_fn != Py_None) {
-        return PyObject_CallOneArg(self->key_fn, value);
-    }
-    Py_INCREF(value);
-    return value;
+static inline void json_skip_ws(JsonDecoder *d) {
+    while (d->p < d->end && (*d->p == ' ' || *d->p == '\t' || *d->p == '\n' || *d->p == '\r')) d->p++;
 }
 
-// Recursive insert into Red-Black Tree
-static RBNode *RBNode_insert(RBNode *h, PyObject *value, PyObject *sort_key, int reverse, PyObject *edit) {
-    if (!h) {
-        return RBNode_create(value, sort_key, RB_RED, edit);
+static int json_push_item(JsonDecoder *d, PyObject *item) {
+    if (d->nitems == d->items_cap) {
+        Py_ssize_t cap = d->items_cap ? 2 * d->items_cap : 64;
+        PyObject **items = PyMem_Realloc(d->items, cap * sizeof(PyObject *));
+        if (!items) {
+            Py_DECREF(item);
+            PyErr_NoMemory();
+            return -1;
+        }
+        d->items = items;
+        d->items_cap = cap;
     }
+    d->items[d->nitems++] = item;
+    return 0;
+}
 
-    int cmp = SortedVector_compare_keys(sort_key, h->sort_key, reverse);
-    if (cmp == -2) return NULL;  // Error
-
-    RBNode *new_h = RBNode_ensure_editable(h, edit);
-    if (!new_h) return NULL;
-
-    if (cmp < 0) {
-        RBNode *new_left = RBNode_insert(new_h->left, value, sort_key, reverse, edit);
-        if (!new_left && PyErr_Occurred()) {
-            Py_DECREF(new_h);
-            return NULL;
-        }
-        Py_XDECREF(new_h->left);
-        new_h->left = new_left;
-    } else {
-        // cmp >= 0: equal keys go to the right to maintain insertion order for duplicates
-        RBNode *new_right = RBNode_insert(new_h->right, value, sort_key, reverse, edit);
-        if (!new_right && PyErr_Occurred()) {
-            Py_DECREF(new_h);
-            return NULL;
+static int json_push_entry(JsonDecoder *d, PyObject *key, Py_hash_t hash, PyObject *val) {
+    if (d->nentries == d->entries_cap) {
+        Py_ssize_t cap = d->entries_cap ? 2 * d->entries_cap : 32;
+        MapBuildEntry *entries = PyMem_Realloc(d->entries, cap * sizeof(MapBuildEntry));
+        if (!entries) {
+            Py_DECREF(key);
+            Py_DECREF(val);
+            PyErr_NoMemory();
+            return -1;
         }
-        Py_XDECREF(new_h->right);
-        new_h->right = new_right;
+        d->entries = entries;
+        d->entries_cap = cap;
     }
-
-    return RBNode_balance(new_h, edit);
+    d->entries[d->nentries].hash = hash;
+    d->entries[d->nentries].key = key;
+    d->entries[d->nentries].val = val;
+    d->nentries++;
+    return 0;
 }
 
-// conj: Add element maintaining sorted order
-static PyObject *SortedVector_conj(SortedVector *self, PyObject *value) {
-    PyObject *sort_key = SortedVector_get_sort_key(self, value);
-    if (!sort_key) return NULL;
-
-    RBNode *new_root = RBNode_insert(self->root, value, sort_key, self->reverse, NULL);
-    Py_DECREF(sort_key);
-
-    if (!new_root && PyErr_Occurred()) return NULL;
-
-    // Make root black
-    if (new_root && new_root->color == RB_RED) {
-        RBNode *black_root = RBNode_clone(new_root, NULL);
-        Py_DECREF(new_root);
-        if (!black_root) return NULL;
-        black_root->color = RB_BLACK;
-        new_root = black_root;
-    }
+static inline int json_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
 
-    // Create new SortedVector
-    SortedVector *result = PyObject_New(SortedVector, &SortedVectorType);
-    if (!result) {
-        Py_XDECREF(new_root);
-        return NULL;
+// Four hex digits at p as a code unit, or -1
+static int json_hex4(const char *p) {
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        int h = json_hex(p[i]);
+        if (h < 0) return -1;
+        v = (v << 4) | h;
     }
-
-    result->root = new_root;
-    result->cnt = self->cnt + 1;
-    result->key_fn = self->key_fn;
-    Py_XINCREF(result->key_fn);
-    result->reverse = self->reverse;
-
-    return (PyObject *)result;
+    return v;
 }
 
-// nth: Get element at index (O(log n))
-static PyObject *RBNode_nth(RBNode *node, Py_ssize_t index) {
-    if (!node) {
-        PyErr_SetString(PyExc_IndexError, "index out of range");
-        return NULL;
+static char *json_put_utf8(char *out, unsigned int cp) {
+    if (cp < 0x80) {
+        *out++ = (char)cp;
+    } else if (cp < 0x800) {
+        *out++ = (char)(0xC0 | (cp >> 6));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *out++ = (char)(0xE0 | (cp >> 12));
+        *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    } else {
+        *out++ = (char)(0xF0 | (cp >> 18));
+        *out++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+// Decode the string whose opening quote is at d->p, which has escapes
+static PyObject *json_parse_escaped(JsonDecoder *d) {
+    const char *quote = d->p;
+    const char *p = quote + 1;
+    // Escapes never make the text longer, so the raw length bounds the output
+    const char *close = p;
+    while (close < d->end && *close != '"') close += *close == '\\' ? 2 : 1;
+    char *buf = PyMem_Malloc(close - p + 1);
+    if (!buf) return PyErr_NoMemory();
+    char *out = buf;
+    const char *errors = d->text->errors;
+
+    while (1) {
+        if (p >= d->end) {
+            json_error(d, "Unterminated string starting at", quote);
+            goto error;
+        }
+        unsigned char c = (unsigned char)*p;
+        if (c == '"') break;
+        if (c < 0x20) {
+            json_error(d, "Invalid control character at", p);
+            goto error;
+        }
+        if (c != '\\') {
+            *out++ = (char)c;
+            p++;
+            continue;
+        }
+        if (p + 1 >= d->end) {
+            json_error(d, "Unterminated string starting at", quote);
+            goto error;
+        }
+        char e = p[1];
+        p += 2;
+        switch (e) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                int cp = d->end - p >= 4 ? json_hex4(p) : -1;
+                if (cp < 0) {
+                    json_error(d, "Invalid \\uXXXX escape", p - 1);
+                    goto error;
+                }
+                p += 4;
+                unsigned int code = (unsigned int)cp;
+                if (code >= 0xD800 && code <= 0xDBFF && d->end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    int lo = json_hex4(p + 2);
+                    if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + ((unsigned int)lo - 0xDC00);
+                        p += 6;
+                    }
+                }
+                if (code >= 0xD800 && code <= 0xDFFF) errors = "surrogatepass";
+                out = json_put_utf8(out, code);
+                break;
+            }
+            default:
+                json_error(d, "Invalid \\escape", p - 2);
+                goto error;
+        }
     }
 
-    Py_ssize_t left_size = RBNode_size(node->left);
+    d->p = p + 1;
+    PyObject *result = PyUnicode_DecodeUTF8(buf, out - buf, errors);
+    PyMem_Free(buf);
+    return result;
 
-    if (index < left_size) {
-        return RBNode_nth(node->left, index);
-    } else if (index == left_size) {
-        Py_INCREF(node->value);
-        return node->value;
-    } else {
-        return RBNode_nth(node->right, index - left_size - 1);
-    }
+error:
+    PyMem_Free(buf);
+    return NULL;
 }
 
-static PyObject *SortedVector_nth(SortedVector *self, PyObject *args) {
-    Py_ssize_t index;
-    PyObject *default_val = NULL;
-
-    if (!PyArg_ParseTuple(args, "n|O", &index, &default_val)) {
+// Decode the string whose opening quote is at d->p; *ascii_len is set to its
+// length when it is plain ASCII without escapes, else to -1
+static PyObject *json_parse_string(JsonDecoder *d, Py_ssize_t *ascii_len) {
+    const char *start = d->p + 1;
+    const char *p = start;
+    unsigned char high = 0;
+    while (p < d->end) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\' || c < 0x20) break;
+        high |= c;
+        p++;
+    }
+    if (p >= d->end || *p != '"') {
+        if (ascii_len) *ascii_len = -1;
+        if (p < d->end && *p == '\\') return json_parse_escaped(d);
+        json_error(d, p < d->end ? "Invalid control character at" : "Unterminated string starting at",
+                   p < d->end ? p : d->p);
         return NULL;
     }
 
-    // Handle negative indices
-    if (index < 0) {
-        index += self->cnt;
+    Py_ssize_t n = p - start;
+    d->p = p + 1;
+    if (high & 0x80) {
+        if (ascii_len) *ascii_len = -1;
+        return PyUnicode_DecodeUTF8(start, n, d->text->errors);
     }
+    if (ascii_len) *ascii_len = n;
+    PyObject *s = PyUnicode_New(n, 127);
+    if (s) memcpy(PyUnicode_1BYTE_DATA(s), start, n);
+    return s;
+}
 
-    if (index < 0 || index >= self->cnt) {
-        if (default_val) {
-            Py_INCREF(default_val);
-            return default_val;
+// An object key, new reference, and its hash. Short ASCII keys come from the
+// key cache.
+static PyObject *json_parse_key(JsonDecoder *d, Py_hash_t *hash) {
+    const char *start = d->p + 1;
+    const char *p = start;
+    while (p < d->end && p - start <= JSON_KEY_CACHE_MAX_LEN) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80) break;
+        p++;
+    }
+    JsonKeySlot *slot = NULL;
+    if (p < d->end && *p == '"' && p - start <= JSON_KEY_CACHE_MAX_LEN) {
+        Py_ssize_t n = p - start;
+        if (d->keys == NULL) {
+#ifndef Py_GIL_DISABLED
+            d->keys = json_shared_keys[d->keyword != NULL];
+#else
+            d->keys = PyMem_Calloc(JSON_KEY_CACHE_SIZE, sizeof(JsonKeySlot));
+            if (!d->keys) {
+                PyErr_NoMemory();
+                return NULL;
+            }
+            d->own_keys = 1;
+#endif
+        }
+        uint32_t h = 2166136261u;  // FNV-1a
+        for (Py_ssize_t i = 0; i < n; i++) h = (h ^ (unsigned char)start[i]) * 16777619u;
+        slot = &d->keys[h & (JSON_KEY_CACHE_SIZE - 1)];
+        if (slot->name != NULL && PyUnicode_GET_LENGTH(slot->name) == n &&
+            memcmp(PyUnicode_1BYTE_DATA(slot->name), start, n) == 0) {
+            d->p = p + 1;
+            *hash = slot->hash;
+            Py_INCREF(slot->key);
+            return slot->key;
         }
-        PyErr_SetString(PyExc_IndexError, "index out of range");
-        return NULL;
     }
 
-    return RBNode_nth(self->root, index);
-}
-
-static PyObject *SortedVector_getitem(SortedVector *self, PyObject *key) {
-    if (PyLong_Check(key)) {
-        Py_ssize_t index = PyLong_AsSsize_t(key);
-        if (index == -1 && PyErr_Occurred()) return NULL;
-
-        if (index < 0) index += self->cnt;
-
-        if (index < 0 || index >= self->cnt) {
-            PyErr_SetString(PyExc_IndexError, "index out of range");
+    Py_ssize_t ascii_len;
+    PyObject *name = json_parse_string(d, &ascii_len);
+    if (!name) return NULL;
+    PyObject *key = name;
+    if (d->keyword != NULL) {
+        key = PyObject_CallOneArg(d->keyword, name);
+        if (!key) {
+            Py_DECREF(name);
             return NULL;
         }
-
-        return RBNode_nth(self->root, index);
     }
-
-    PyErr_SetString(PyExc_TypeError, "indices must be integers");
-    return NULL;
-}
-
-static Py_ssize_t SortedVector_length(SortedVector *self) {
-    return self->cnt;
-}
-
-// first: Get minimum element
-static PyObject *SortedVector_first(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
-    if (self->cnt == 0) {
-        Py_RETURN_NONE;
+    *hash = PyObject_Hash(key);
+    if (*hash == -1 && PyErr_Occurred()) {
+        if (key != name) Py_DECREF(key);
+        Py_DECREF(name);
+        return NULL;
     }
-
-    RBNode *node = self->root;
-    while (node->left) {
-        node = node->left;
+    if (slot != NULL && ascii_len >= 0) {
+        // Python code run above may have refilled the slot; replace it
+        PyObject *old_name = slot->name, *old_key = slot->key;
+        Py_INCREF(name);
+        Py_INCREF(key);
+        slot->name = name;
+        slot->key = key;
+        slot->hash = *hash;
+        Py_XDECREF(old_key);
+        Py_XDECREF(old_name);
     }
-
-    Py_INCREF(node->value);
-    return node->value;
+    if (key != name) Py_DECREF(name);
+    return key;
 }
 
-// last: Get maximum element
-static PyObject *SortedVector_last(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
-    if (self->cnt == 0) {
-        Py_RETURN_NONE;
+// A number starting at d->p, following the json module's grammar:
+// -?(0|[1-9]\d*)(\.\d+)?([eE][-+]?\d+)?
+static PyObject *json_parse_number(JsonDecoder *d) {
+    const char *start = d->p, *p = start;
+    if (p < d->end && *p == '-') p++;
+    if (p >= d->end || *p < '0' || *p > '9') {
+        json_error(d, "Expecting value", start);
+        return NULL;
     }
-
-    RBNode *node = self->root;
-    while (node->right) {
-        node = node->right;
+    if (*p == '0') {
+        p++;
+    } else {
+        while (p < d->end && *p >= '0' && *p <= '9') p++;
+    }
+    int is_float = 0;
+    if (p + 1 < d->end && *p == '.' && p[1] >= '0' && p[1] <= '9') {
+        is_float = 1;
+        p += 2;
+        while (p < d->end && *p >= '0' && *p <= '9') p++;
+    }
+    if (p < d->end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        if (q < d->end && (*q == '+' || *q == '-')) q++;
+        if (q < d->end && *q >= '0' && *q <= '9') {
+            is_float = 1;
+            while (q < d->end && *q >= '0' && *q <= '9') q++;
+            p = q;
+        }
     }
-
-    Py_INCREF(node->value);
-    return node->value;
-}
-
-// Binary search for a value, returns index or -1 if not found
-static Py_ssize_t RBNode_index_of(RBNode *node, PyObject *sort_key, int reverse, Py_ssize_t offset) {
-    if (!node) return -1;
-
-    int cmp = SortedVector_compare_keys(sort_key, node->sort_key, reverse);
-    if (cmp == -2) return -2;  // Error
-
-    Py_ssize_t left_size = RBNode_size(node->left);
-
-    if (cmp < 0) {
-        return RBNode_index_of(node->left, sort_key, reverse, offset);
-    } else if (cmp > 0) {
-        return RBNode_index_of(node->right, sort_key, reverse, offset + left_size + 1);
+    d->p = p;
+
+    Py_ssize_t n = p - start;
+    if (!is_float && n <= 18) {
+        const char *q = start + (*start == '-');
+        int64_t v = 0;
+        for (; q < p; q++) v = v * 10 + (*q - '0');
+        return PyLong_FromLongLong(*start == '-' ? -v : v);
+    }
+    // Long integers and floats convert from a NUL-terminated copy
+    char small[64];
+    char *buf = n < (Py_ssize_t)sizeof(small) ? small : PyMem_Malloc(n + 1);
+    if (!buf) return PyErr_NoMemory();
+    memcpy(buf, start, n);
+    buf[n] = '\0';
+    PyObject *result;
+    if (is_float) {
+        double v = PyOS_string_to_double(buf, NULL, NULL);
+        result = v == -1.0 && PyErr_Occurred() ? NULL : PyFloat_FromDouble(v);
     } else {
-        // Found a match - but check left subtree for earlier occurrence
-        Py_ssize_t left_result = RBNode_index_of(node->left, sort_key, reverse, offset);
-        if (left_result == -2) return -2;  // Error
-        if (left_result >= 0) return left_result;
-        return offset + left_size;
+        result = PyLong_FromString(buf, NULL, 10);
     }
+    if (buf != small) PyMem_Free(buf);
+    return result;
 }
 
-static PyObject *SortedVector_index_of(SortedVector *self, PyObject *value) {
-    PyObject *sort_key = SortedVector_get_sort_key(self, value);
-    if (!sort_key) return NULL;
+static PyObject *json_parse_value(JsonDecoder *d);
 
-    Py_ssize_t index = RBNode_index_of(self->root, sort_key, self->reverse, 0);
-    Py_DECREF(sort_key);
+static PyObject *json_parse_array(JsonDecoder *d) {
+    Py_ssize_t base = d->nitems;
+    d->p++;
+    json_skip_ws(d);
+    if (d->p < d->end && *d->p == ']') {
+        d->p++;
+        Py_INCREF(EMPTY_VECTOR);
+        return (PyObject *)EMPTY_VECTOR;
+    }
+    while (1) {
+        PyObject *item = json_parse_value(d);
+        if (!item || json_push_item(d, item) < 0) goto error;
+        json_skip_ws(d);
+        if (d->p < d->end && *d->p == ',') {
+            d->p++;
+            json_skip_ws(d);
+        } else if (d->p < d->end && *d->p == ']') {
+            d->p++;
+            break;
+        } else {
+            json_error(d, "Expecting ',' delimiter", d->p);
+            goto error;
+        }
+    }
 
-    if (index == -2) return NULL;  // Error occurred
+    PyObject *result = Vector_from_items(d->items + base, d->nitems - base);
+    for (Py_ssize_t i = base; i < d->nitems; i++) Py_DECREF(d->items[i]);
+    d->nitems = base;
+    return result;
 
-    return PyLong_FromSsize_t(index);
+error:
+    for (Py_ssize_t i = base; i < d->nitems; i++) Py_DECREF(d->items[i]);
+    d->nitems = base;
+    return NULL;
 }
 
-// contains: Check if element exists
-static int RBNode_contains(RBNode *node, PyObject *sort_key, PyObject *value, int reverse) {
-    if (!node) return 0;
-
-    int cmp = SortedVector_compare_keys(sort_key, node->sort_key, reverse);
-    if (cmp == -2) return -1;  // Error
-
-    if (cmp < 0) {
-        return RBNode_contains(node->left, sort_key, value, reverse);
-    } else if (cmp > 0) {
-        return RBNode_contains(node->right, sort_key, value, reverse);
-    } else {
-        // Keys match - check if values are equal
-        int eq = PyObject_RichCompareBool(value, node->value, Py_EQ);
-        if (eq < 0) return -1;
-        if (eq) return 1;
-
-        // Check both subtrees for equal keys
-        int left_result = RBNode_contains(node->left, sort_key, value, reverse);
-        if (left_result != 0) return left_result;
-        return RBNode_contains(node->right, sort_key, value, reverse);
+static PyObject *json_parse_object(JsonDecoder *d) {
+    Py_ssize_t base = d->nentries;
+    d->p++;
+    json_skip_ws(d);
+    if (d->p < d->end && *d->p == '}') {
+        d->p++;
+        Py_INCREF(EMPTY_MAP);
+        return (PyObject *)EMPTY_MAP;
+    }
+    while (1) {
+        if (d->p >= d->end || *d->p != '"') {
+            json_error(d, "Expecting property name enclosed in double quotes", d->p);
+            goto error;
+        }
+        Py_hash_t hash;
+        PyObject *key = json_parse_key(d, &hash);
+        if (!key) goto error;
+        json_skip_ws(d);
+        if (d->p >= d->end || *d->p != ':') {
+            Py_DECREF(key);
+            json_error(d, "Expecting ':' delimiter", d->p);
+            goto error;
+        }
+        d->p++;
+        json_skip_ws(d);
+        PyObject *val = json_parse_value(d);
+        if (!val) {
+            Py_DECREF(key);
+            goto error;
+        }
+        if (json_push_entry(d, key, hash, val) < 0) goto error;
+        json_skip_ws(d);
+        if (d->p < d->end && *d->p == ',') {
+            d->p++;
+            json_skip_ws(d);
+        } else if (d->p < d->end && *d->p == '}') {
+            d->p++;
+            break;
+        } else {
+            json_error(d, "Expecting ',' delimiter", d->p);
+            goto error;
+        }
     }
-}
-
-static int SortedVector_contains(SortedVector *self, PyObject *value) {
-    if (self->cnt == 0) return 0;
-
-    PyObject *sort_key = SortedVector_get_sort_key(self, value);
-    if (!sort_key) return -1;
 
-    int result = RBNode_contains(self->root, sort_key, value, self->reverse);
-    Py_DECREF(sort_key);
+    // Map_build takes the entries in a block of their own
+    Py_ssize_t n = d->nentries - base;
+    MapBuildEntry *e = PyMem_Malloc(n * sizeof(MapBuildEntry));
+    if (!e) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    memcpy(e, d->entries + base, n * sizeof(MapBuildEntry));
+    d->nentries = base;
+    return Map_build(e, n);
 
-    return result;
+error:
+    for (Py_ssize_t i = base; i < d->nentries; i++) {
+        Py_DECREF(d->entries[i].key);
+        Py_DECREF(d->entries[i].val);
+    }
+    d->nentries = base;
+    return NULL;
 }
 
-// rank: Count of elements less than given value
-static Py_ssize_t RBNode_rank(RBNode *node, PyObject *sort_key, int reverse) {
-    if (!node) return 0;
+// 1 if the text at d->p starts with lit, which is then skipped
+static inline int json_literal(JsonDecoder *d, const char *lit, Py_ssize_t n) {
+    if (d->end - d->p < n || memcmp(d->p, lit, n) != 0) return 0;
+    d->p += n;
+    return 1;
+}
 
-    int cmp = SortedVector_compare_keys(sort_key, node->sort_key, reverse);
-    if (cmp == -2) return -1;  // Error
+static PyObject *json_parse_value(JsonDecoder *d) {
+    if (d->p >= d->end) {
+        json_error(d, "Expecting value", d->p);
+        return NULL;
+    }
+    PyObject *result;
+    switch (*d->p) {
+        case '"':
+            return json_parse_string(d, NULL);
+        case '{':
+        case '[':
+            if (Py_EnterRecursiveCall(" while decoding a JSON document")) return NULL;
+            result = *d->p == '{' ? json_parse_object(d) : json_parse_array(d);
+            Py_LeaveRecursiveCall();
+            return result;
+        case 't':
+            if (json_literal(d, "true", 4)) Py_RETURN_TRUE;
+            break;
+        case 'f':
+            if (json_literal(d, "false", 5)) Py_RETURN_FALSE;
+            break;
+        case 'n':
+            if (json_literal(d, "null", 4)) Py_RETURN_NONE;
+            break;
+        case 'N':
+            if (json_literal(d, "NaN", 3)) return PyFloat_FromDouble(Py_NAN);
+            break;
+        case 'I':
+            if (json_literal(d, "Infinity", 8)) return PyFloat_FromDouble(Py_HUGE_VAL);
+            break;
+        case '-':
+            if (json_literal(d, "-Infinity", 9)) return PyFloat_FromDouble(-Py_HUGE_VAL);
+            return json_parse_number(d);
+        default:
+            if (*d->p >= '0' && *d->p <= '9') return json_parse_number(d);
+            break;
+    }
+    json_error(d, "Expecting value", d->p);
+    return NULL;
+}
 
-    Py_ssize_t left_size = RBNode_size(node->left);
+static int JsonDecoder_init(JsonDecoder *d, int keywordize) {
+    memset(d, 0, sizeof(*d));
+    if (!keywordize) return 0;
+    PyObject *types = PyImport_ImportModule("spork.runtime.types");
+    if (!types) return -1;
+    d->keyword = PyObject_GetAttrString(types, "Keyword");
+    Py_DECREF(types);
+    return d->keyword ? 0 : -1;
+}
 
-    if (cmp <= 0) {
-        return RBNode_rank(node->left, sort_key, reverse);
-    } else {
-        Py_ssize_t right_rank = RBNode_rank(node->right, sort_key, reverse);
-        if (right_rank < 0) return -1;
-        return left_size + 1 + right_rank;
+static void JsonDecoder_clear(JsonDecoder *d) {
+    if (d->own_keys) {
+        for (int i = 0; i < JSON_KEY_CACHE_SIZE; i++) {
+            Py_XDECREF(d->keys[i].name);
+            Py_XDECREF(d->keys[i].key);
+        }
+        PyMem_Free(d->keys);
+    }
+    d->keys = NULL;
+    d->own_keys = 0;
+    PyMem_Free(d->items);
+    PyMem_Free(d->entries);
+    d->items = NULL;
+    d->entries = NULL;
+    d->items_cap = d->entries_cap = 0;
+    Py_CLEAR(d->keyword);
+}
+
+// One value from t->data[*pos:], stopping at the end of its line when
+// one_line is set and at the end of the text otherwise: anything else but
+// whitespace there is "Extra data"
+static PyObject *json_decode_at(JsonDecoder *d, JsonText *t, Py_ssize_t *pos, int one_line) {
+    d->text = t;
+    d->p = t->data + *pos;
+    d->end = t->data + t->len;
+    json_skip_ws(d);
+    PyObject *result = json_parse_value(d);
+    if (!result) return NULL;
+    while (d->p < d->end && (*d->p == ' ' || *d->p == '\t' || *d->p == '\r' || (!one_line && *d->p == '\n'))) {
+        d->p++;
+    }
+    if (d->p < d->end && !(one_line && *d->p == '\n')) {
+        Py_DECREF(result);
+        json_error(d, "Extra data", d->p);
+        return NULL;
     }
+    *pos = d->p - t->data;
+    return result;
 }
 
-static PyObject *SortedVector_rank(SortedVector *self, PyObject *value) {
-    PyObject *sort_key = SortedVector_get_sort_key(self, value);
-    if (!sort_key) return NULL;
+/* json_loads(s, keywordize_keys=False) - parse a JSON document (str or
+   UTF-8/16/32 bytes) into Maps and Vectors; keys become Keywords when
+   keywordize_keys is true */
+static PyObject *pds_json_loads(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"s", "keywordize_keys", NULL};
+    PyObject *s;
+    int keywordize = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|p:json_loads", kwlist, &s, &keywordize)) {
+        return NULL;
+    }
 
-    Py_ssize_t r = RBNode_rank(self->root, sort_key, self->reverse);
-    Py_DECREF(sort_key);
+    JsonText text;
+    if (JsonText_init(&text, s) < 0) {
+        JsonText_release(&text);
+        return NULL;
+    }
+    if (text.doc != NULL && text.len >= 3 && memcmp(text.data, "\xEF\xBB\xBF", 3) == 0) {
+        JsonDecoder d = {.text = &text};
+        json_error(&d, "Unexpected UTF-8 BOM (decode using utf-8-sig)", text.data);
+        JsonText_release(&text);
+        return NULL;
+    }
 
-    if (r < 0) return NULL;
-    return PyLong_FromSsize_t(r);
+    JsonDecoder d;
+    PyObject *result = NULL;
+    Py_ssize_t pos = 0;
+    if (JsonDecoder_init(&d, keywordize) == 0) {
+        result = json_decode_at(&d, &text, &pos, 0);
+    }
+    JsonDecoder_clear(&d);
+    JsonText_release(&text);
+    return result;
 }
 
-// === SortedVector Iterator (in-order traversal) ===
-
-typedef struct SortedVectorIterator {
+// json_lines iterator: one document per non-blank line
+typedef struct {
     PyObject_HEAD
-    RBNode **stack;
-    Py_ssize_t stack_size;
-    Py_ssize_t stack_capacity;
-} SortedVectorIterator;
-
-static PyTypeObject SortedVectorIteratorType;
-
-static void SortedVectorIterator_dealloc(SortedVectorIterator *self) {
-    for (Py_ssize_t i = 0; i < self->stack_size; i++) {
-        Py_XDECREF(self->stack[i]);
-    }
-    PyMem_Free(self->stack);
+    JsonDecoder dec;
+    JsonText text;     // the whole input, for a str / bytes source
+    Py_ssize_t pos;
+    PyObject *lines;   // iterator of lines otherwise
+} JsonLinesIterator;
+
+static PyTypeObject JsonLinesIteratorType;
+
+static void JsonLinesIterator_dealloc(JsonLinesIterator *self) {
+    JsonDecoder_clear(&self->dec);
+    JsonText_release(&self->text);
+    Py_XDECREF(self->lines);
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
-static void SortedVectorIterator_push_left(SortedVectorIterator *self, RBNode *node) {
-    while (node) {
-        if (self->stack_size >= self->stack_capacity) {
-            Py_ssize_t new_cap = self->stack_capacity * 2;
-            RBNode **new_stack = PyMem_Realloc(self->stack, new_cap * sizeof(RBNode *));
-            if (!new_stack) return;
-            self->stack = new_stack;
-            self->stack_capacity = new_cap;
-        }
-        Py_INCREF(node);
-        self->stack[self->stack_size++] = node;
-        node = node->left;
+static PyObject *JsonLinesIterator_next(JsonLinesIterator *self) {
+    if (self->lines == NULL) {
+        // Skip blank lines; the end of the text ends the iteration
+        const char *p = self->text.data + self->pos, *end = self->text.data + self->text.len;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+        self->pos = p - self->text.data;
+        if (p >= end) return NULL;
+        return json_decode_at(&self->dec, &self->text, &self->pos, 1);
     }
-}
 
-static PyObject *SortedVectorIterator_next(SortedVectorIterator *self) {
-    if (self->stack_size == 0) {
-        return NULL;  // StopIteration
+    PyObject *line;
+    while ((line = PyIter_Next(self->lines)) != NULL) {
+        JsonText text;
+        if (JsonText_init(&text, line) < 0) {
+            JsonText_release(&text);
+            Py_DECREF(line);
+            return NULL;
+        }
+        Py_DECREF(line);
+        const char *p = text.data, *end = text.data + text.len;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+        PyObject *result = NULL;
+        if (p < end) {
+            Py_ssize_t pos = 0;
+            result = json_decode_at(&self->dec, &text, &pos, 0);
+        }
+        JsonText_release(&text);
+        if (result || PyErr_Occurred()) return result;
     }
-
-    RBNode *node = self->stack[--self->stack_size];
-    PyObject *value = node->value;
-    Py_INCREF(value);
-
-    // Push left spine of right subtree
-    SortedVectorIterator_push_left(self, node->right);
-
-    Py_DECREF(node);
-    return value;
+    return NULL;
 }
 
-static PyTypeObject SortedVectorIteratorType = {
+static PyTypeObject JsonLinesIteratorType = {
     PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.SortedVectorIterator",
-    .tp_basicsize = sizeof(SortedVectorIterator),
-    .tp_dealloc = (destructor)SortedVectorIterator_dealloc,
+    .tp_name = "spork.runtime.pds.JsonLinesIterator",
+    .tp_basicsize = sizeof(JsonLinesIterator),
+    .tp_dealloc = (destructor)JsonLinesIterator_dealloc,
     .tp_flags = Py_TPFLAGS_DEFAULT,
     .tp_iter = PyObject_SelfIter,
-    .tp_iternext = (iternextfunc)SortedVectorIterator_next,
+    .tp_iternext = (iternextfunc)JsonLinesIterator_next,
 };
 
-static PyObject *SortedVector_iter(SortedVector *self) {
-    SortedVectorIterator *iter = PyObject_New(SortedVectorIterator, &SortedVectorIteratorType);
-    if (!iter) return NULL;
-
-    // Initial capacity based on expected tree depth
-    iter->stack_capacity = 32;
-    iter->stack = PyMem_Malloc(iter->stack_capacity * sizeof(RBNode *));
-    if (!iter->stack) {
-        Py_DECREF(iter);
-        return PyErr_NoMemory();
+/* json_lines(source, keywordize_keys=False) - iterator over the documents of
+   newline-delimited JSON: a str or bytes holding every line, or an iterable
+   of lines such as a text or binary file. Blank lines are skipped. */
+static PyObject *pds_json_lines(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"source", "keywordize_keys", NULL};
+    PyObject *source;
+    int keywordize = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|p:json_lines", kwlist, &source, &keywordize)) {
+        return NULL;
     }
-    iter->stack_size = 0;
-
-    SortedVectorIterator_push_left(iter, self->root);
-
-    return (PyObject *)iter;
-}
-
-// === SortedVector repr ===
 
-static PyObject *SortedVector_repr(SortedVector *self) {
-    if (self->cnt == 0) {
-        return PyUnicode_FromString("sorted_vec()");
+    JsonLinesIterator *it = PyObject_New(JsonLinesIterator, &JsonLinesIteratorType);
+    if (!it) return NULL;
+    memset(&it->dec, 0, sizeof(it->dec));
+    memset(&it->text, 0, sizeof(it->text));
+    it->pos = 0;
+    it->lines = NULL;
+    if (JsonDecoder_init(&it->dec, keywordize) < 0) goto error;
+    if (PyUnicode_Check(source) || PyObject_CheckBuffer(source)) {
+        if (JsonText_init(&it->text, source) < 0) goto error;
+    } else {
+        it->lines = PyObject_GetIter(source);
+        if (!it->lines) goto error;
     }
+    return (PyObject *)it;
 
-    PyObject *items = PyList_New(0);
-    if (!items) return NULL;
+error:
+    Py_DECREF(it);
+    return NULL;
+}
 
-    PyObject *iter = SortedVector_iter(self);
-    if (!iter) {
-        Py_DECREF(items);
-        return NULL;
+// =============================================================================
+// COLLECTION BUILDERS
+// =============================================================================
+// into, group_by, frequencies and zipmap fill one transient, or a bulk build
+// buffer, straight from the source. Vectors are read leaf by leaf, Maps (by
+// key) and Sets node by node, and lists and tuples in place; anything else
+// goes through its iterator. group_by and frequencies hash each key once and
+// update the value slot where it lives in the transient trie: groups grow as
+// TransientVectors and are sealed when the map is made persistent.
+
+// Called with every element (borrowed): 0 to go on, -1 on error, 1 to stop early
+typedef int (*pds_visit_fn)(PyObject *item, void *ctx);
+
+static int MapNode_each_key(PyObject *node, pds_visit_fn fn, void *ctx) {
+    int rc;
+    if (is_array_map(node)) {
+        ArrayMapNode *amn = (ArrayMapNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(amn); i++) {
+            if ((rc = fn(amn->array[2 * i], ctx)) != 0) return rc;
+        }
+    } else if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(bin); i += 2) {
+            if (bin->array[i] != NULL) {
+                if ((rc = fn(bin->array[i], ctx)) != 0) return rc;
+            } else if (bin->array[i + 1] != NULL) {
+                if ((rc = MapNode_each_key(bin->array[i + 1], fn, ctx)) != 0) return rc;
+            }
+        }
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL && (rc = MapNode_each_key(an->array[i], fn, ctx)) != 0) return rc;
+        }
+    } else {
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        for (int i = 0; i < hcn->count; i++) {
+            if ((rc = fn(hcn->array[2 * i], ctx)) != 0) return rc;
+        }
     }
+    return 0;
+}
 
-    PyObject *item;
-    while ((item = SortedVectorIterator_next((SortedVectorIterator *)iter)) != NULL) {
-        PyObject *repr = PyObject_Repr(item);
-        Py_DECREF(item);
-        if (!repr) {
-            Py_DECREF(iter);
-            Py_DECREF(items);
-            return NULL;
+// Call fn on every element of coll, in iteration order, until it returns
+// nonzero; returns what fn last returned
+static int pds_each(PyObject *coll, pds_visit_fn fn, void *ctx) {
+    int rc;
+    if (PyObject_TypeCheck(coll, &VectorType)) {
+        Vector *v = (Vector *)coll;
+        Py_ssize_t tail_off = Vector_tail_off(v);
+        Py_ssize_t i = 0;
+        while (i < tail_off) {
+            Py_ssize_t start, len;
+            VectorNode *leaf = VectorTrie_leaf_for(v->root, v->shift, i, &start, &len);
+            for (; i < start + len; i++) {
+                if ((rc = fn(leaf->array[i - start], ctx)) != 0) return rc;
+            }
         }
-        if (PyList_Append(items, repr) < 0) {
-            Py_DECREF(repr);
-            Py_DECREF(iter);
-            Py_DECREF(items);
-            return NULL;
+        for (; i < v->cnt; i++) {
+            if ((rc = fn(PyTuple_GET_ITEM(v->tail, i - tail_off), ctx)) != 0) return rc;
         }
-        Py_DECREF(repr);
+        return 0;
     }
-    Py_DECREF(iter);
-
-    PyObject *sep = PyUnicode_FromString(", ");
-    if (!sep) {
-        Py_DECREF(items);
-        return NULL;
+    if (PyObject_TypeCheck(coll, &ChunkedSeqType)) {
+        // The seq keeps its chunks (and their items) alive while fn runs
+        SeqChunk *chunk = ((ChunkedSeq *)coll)->chunk;
+        Py_ssize_t off = ((ChunkedSeq *)coll)->off;
+        if (SeqChunk_realize(chunk) < 0) return -1;
+        while (chunk->count > 0) {
+            for (Py_ssize_t i = off; i < chunk->count; i++) {
+                if ((rc = fn(chunk->items[i], ctx)) != 0) return rc;
+            }
+            PyObject *next = SeqChunk_next_ready(chunk);
+            if (!next) return -1;
+            if (next == Py_None) break;
+            chunk = (SeqChunk *)next;
+            off = 0;
+        }
+        return 0;
+    }
+    if (PyObject_TypeCheck(coll, &MapType) || PyObject_TypeCheck(coll, &SetType)) {
+        PyObject *root = PyObject_TypeCheck(coll, &MapType) ? ((Map *)coll)->root : ((Set *)coll)->root;
+        return root ? MapNode_each_key(root, fn, ctx) : 0;
+    }
+    if (PyList_Check(coll) || PyTuple_Check(coll)) {
+        // fn may run Python code that resizes a list, so the size is reread
+        for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(coll); i++) {
+            PyObject *item = PySequence_Fast_GET_ITEM(coll, i);
+            Py_INCREF(item);
+            rc = fn(item, ctx);
+            Py_DECREF(item);
+            if (rc != 0) return rc;
+        }
+        return 0;
     }
 
-    PyObject *joined = PyUnicode_Join(sep, items);
-    Py_DECREF(sep);
-    Py_DECREF(items);
-    if (!joined) return NULL;
-
-    PyObject *result = PyUnicode_FromFormat("sorted_vec(%U)", joined);
-    Py_DECREF(joined);
-    return result;
-}
-
-// === SortedVector hash ===
-
-static Py_hash_t SortedVector_hash(SortedVector *self) {
-    Py_hash_t hash = 0x345678;
-    Py_hash_t mult = 1000003;
-
-    PyObject *iter = SortedVector_iter(self);
+    PyObject *iter = PyObject_GetIter(coll);
     if (!iter) return -1;
-
     PyObject *item;
-    while ((item = SortedVectorIterator_next((SortedVectorIterator *)iter)) != NULL) {
-        Py_hash_t item_hash = PyObject_Hash(item);
+    while ((item = PyIter_Next(iter)) != NULL) {
+        rc = fn(item, ctx);
         Py_DECREF(item);
-        if (item_hash == -1) {
+        if (rc != 0) {
             Py_DECREF(iter);
-            return -1;
+            return rc;
         }
-        hash = (hash ^ item_hash) * mult;
-        mult += 82520 + 2 * self->cnt;
     }
     Py_DECREF(iter);
-
-    hash += 97531;
-    if (hash == -1) hash = -2;
-    return hash;
+    return PyErr_Occurred() ? -1 : 0;
 }
 
-// === SortedVector equality ===
+// Value slot of key in a transient, hashing it into *h for a later insert;
+// NULL when the key is absent (or on error, with it set)
+static PyObject **TransientMap_slot(TransientMap *t, PyObject *key, Py_hash_t *h) {
+    *h = PyObject_Hash(key);
+    if (*h == -1 && PyErr_Occurred()) return NULL;
+    return t->root ? MapNode_edit_slot(&t->root, 0, *h, key, t->id) : NULL;
+}
 
-static PyObject *SortedVector_richcompare(SortedVector *self, PyObject *other, int op) {
-    if (op != Py_EQ && op != Py_NE) {
-        Py_RETURN_NOTIMPLEMENTED;
+// Replace every value below a node with fn(value). Only for nodes owned by a
+// transient that nothing else can see yet, as they are edited in place.
+static int MapNode_replace_values(PyObject *node, PyObject *(*fn)(PyObject *)) {
+    PyObject **vals[WIDTH];
+    int n = 0;
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(bin); i += 2) {
+            if (bin->array[i] != NULL) {
+                vals[n++] = &bin->array[i + 1];
+            } else if (bin->array[i + 1] != NULL) {
+                if (MapNode_replace_values(bin->array[i + 1], fn) < 0) return -1;
+            }
+        }
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL && MapNode_replace_values(an->array[i], fn) < 0) return -1;
+        }
+    } else {
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        for (int i = 0; i < hcn->count; i++) {
+            PyObject *val = fn(hcn->array[2 * i + 1]);
+            if (!val) return -1;
+            Py_SETREF(hcn->array[2 * i + 1], val);
+        }
     }
-
-    if (!PyObject_TypeCheck(other, &SortedVectorType)) {
-        if (op == Py_EQ) Py_RETURN_FALSE;
-        Py_RETURN_TRUE;
+    for (int i = 0; i < n; i++) {
+        PyObject *val = fn(*vals[i]);
+        if (!val) return -1;
+        Py_SETREF(*vals[i], val);
     }
+    return 0;
+}
 
-    SortedVector *other_sv = (SortedVector *)other;
+static int conj_vector_step(PyObject *item, void *ctx) {
+    PyObject *r = TransientVector_conj_mut((TransientVector *)ctx, item);
+    Py_XDECREF(r);
+    return r ? 0 : -1;
+}
 
-    if (self->cnt != other_sv->cnt) {
-        if (op == Py_EQ) Py_RETURN_FALSE;
-        Py_RETURN_TRUE;
+static int conj_set_step(PyObject *item, void *ctx) {
+    PyObject *r = TransientSet_conj_mut((TransientSet *)ctx, item);
+    Py_XDECREF(r);
+    return r ? 0 : -1;
+}
+
+static PyObject *into_vector(Vector *to, PyObject *from) {
+    if (to->cnt == 0) {
+        if (PyObject_TypeCheck(from, &VectorType)) {
+            Py_INCREF(from);
+            return from;
+        }
+        if (PyList_Check(from) || PyTuple_Check(from)) {
+            return Vector_from_items(PySequence_Fast_ITEMS(from), PySequence_Fast_GET_SIZE(from));
+        }
     }
+    PyObject *t = Vector_transient(to, NULL);
+    if (!t) return NULL;
+    PyObject *result = pds_each(from, conj_vector_step, t) < 0 ? NULL : TransientVector_persistent((TransientVector *)t, NULL);
+    Py_DECREF(t);
+    return result;
+}
 
-    // Compare elements in order
-    PyObject *iter1 = SortedVector_iter(self);
-    PyObject *iter2 = SortedVector_iter(other_sv);
-    if (!iter1 || !iter2) {
-        Py_XDECREF(iter1);
-        Py_XDECREF(iter2);
-        return NULL;
+static PyObject *into_set(Set *to, PyObject *from) {
+    if (PyObject_TypeCheck(from, &SetType)) {
+        return Set_or((PyObject *)to, from);
     }
+    if (to->cnt == 0) {
+        return Set_from_iterable(NULL, from);
+    }
+    PyObject *t = Set_transient(to, NULL);
+    if (!t) return NULL;
+    PyObject *result = pds_each(from, conj_set_step, t) < 0 ? NULL : TransientSet_persistent((TransientSet *)t, NULL);
+    Py_DECREF(t);
+    return result;
+}
 
-    int equal = 1;
-    PyObject *item1, *item2;
-    while ((item1 = SortedVectorIterator_next((SortedVectorIterator *)iter1)) != NULL) {
-        item2 = SortedVectorIterator_next((SortedVectorIterator *)iter2);
-        if (!item2) {
-            Py_DECREF(item1);
-            equal = 0;
-            break;
-        }
+static PyObject *into_map(Map *to, PyObject *from) {
+    if (PyObject_TypeCheck(from, &MapType)) {
+        return Map_or((PyObject *)to, from);
+    }
+    Py_ssize_t n;
+    MapBuildEntry *e = MapBuild_collect(from, 0, "into map", &n);
+    if (!e) return NULL;
+    PyObject *built = Map_build(e, n);
+    if (!built || to->cnt == 0) return built;
+    PyObject *result = Map_or((PyObject *)to, built);
+    Py_DECREF(built);
+    return result;
+}
 
-        int cmp = PyObject_RichCompareBool(item1, item2, Py_EQ);
-        Py_DECREF(item1);
-        Py_DECREF(item2);
+static PyObject *into_xform(PyObject *to, PyObject *xform, PyObject *from);
 
-        if (cmp < 0) {
-            Py_DECREF(iter1);
-            Py_DECREF(iter2);
-            return NULL;
-        }
-        if (!cmp) {
-            equal = 0;
-            break;
-        }
+/* into(to, [xform,] from) - to with every element of from added: conj'd onto
+   a Vector or Set, or assoc'd into a Map from a Map, dict or [key value] pairs.
+   With a transducer the elements go through its stages first. */
+static PyObject *pds_into(PyObject *self, PyObject *args) {
+    PyObject *to, *arg, *from = NULL;
+    if (!PyArg_ParseTuple(args, "OO|O:into", &to, &arg, &from)) {
+        return NULL;
     }
+    if (from) return into_xform(to, arg, from);
+    from = arg;
+    if (PyObject_TypeCheck(to, &VectorType)) return into_vector((Vector *)to, from);
+    if (PyObject_TypeCheck(to, &MapType)) return into_map((Map *)to, from);
+    if (PyObject_TypeCheck(to, &SetType)) return into_set((Set *)to, from);
+    PyErr_Format(PyExc_TypeError, "into expects a Vector, Map or Set, not %.200s", Py_TYPE(to)->tp_name);
+    return NULL;
+}
 
-    Py_DECREF(iter1);
-    Py_DECREF(iter2);
-
-    if (op == Py_EQ) {
-        if (equal) Py_RETURN_TRUE;
-        Py_RETURN_FALSE;
+typedef struct {
+    PyObject *f;
+    TransientMap *t;
+} GroupBy;
+
+static int group_by_step(PyObject *item, void *ctx) {
+    GroupBy *g = (GroupBy *)ctx;
+    PyObject *key = PyObject_CallOneArg(g->f, item);
+    if (!key) return -1;
+
+    Py_hash_t h;
+    PyObject **slot = TransientMap_slot(g->t, key, &h);
+    PyObject *r;
+    if (slot) {
+        r = TransientVector_conj_mut((TransientVector *)*slot, item);
+    } else if (PyErr_Occurred()) {
+        r = NULL;
     } else {
-        if (equal) Py_RETURN_FALSE;
-        Py_RETURN_TRUE;
+        PyObject *group = Vector_transient(EMPTY_VECTOR, NULL);
+        r = group ? TransientVector_conj_mut((TransientVector *)group, item) : NULL;
+        if (r) {
+            Py_DECREF(r);
+            r = TransientMap_assoc_hashed(g->t, key, h, group);
+        }
+        Py_XDECREF(group);
     }
+    Py_DECREF(key);
+    Py_XDECREF(r);
+    return r ? 0 : -1;
 }
 
-// === SortedVector disj (remove element) ===
+// A finished group: its TransientVector made persistent
+static PyObject *group_seal(PyObject *group) {
+    return TransientVector_persistent((TransientVector *)group, NULL);
+}
 
-// Helper functions for Red-Black deletion
-static RBNode *RBNode_move_red_left(RBNode *h, PyObject *edit) {
-    h = RBNode_flip_colors(h, edit);
-    if (!h) return NULL;
+/* group_by(f, coll) - Map of f(x) to the Vector of the elements x it came from */
+static PyObject *pds_group_by(PyObject *self, PyObject *args) {
+    GroupBy g;
+    PyObject *coll;
+    if (!PyArg_ParseTuple(args, "OO:group_by", &g.f, &coll)) {
+        return NULL;
+    }
+    g.t = (TransientMap *)Map_transient(EMPTY_MAP, NULL);
+    if (!g.t) return NULL;
 
-    if (h->right && RBNode_is_red(h->right->left)) {
-        RBNode *new_right = RBNode_rotate_right(h->right, edit);
-        if (!new_right) {
-            Py_DECREF(h);
-            return NULL;
-        }
-        Py_XDECREF(h->right);
-        h->right = new_right;
+    PyObject *result = NULL;
+    if (pds_each(coll, group_by_step, &g) == 0 &&
+        (g.t->root == NULL || MapNode_replace_values(g.t->root, group_seal) == 0)) {
+        result = TransientMap_persistent(g.t, NULL);
+    }
+    Py_DECREF(g.t);
+    return result;
+}
 
-        h = RBNode_rotate_left(h, edit);
-        if (!h) return NULL;
-        h = RBNode_flip_colors(h, edit);
-        if (!h) return NULL;
+static int frequencies_step(PyObject *item, void *ctx) {
+    TransientMap *t = (TransientMap *)ctx;
+    Py_hash_t h;
+    PyObject **slot = TransientMap_slot(t, item, &h);
+    if (slot) {
+        // Counts are ints this function stored
+        PyObject *count = PyLong_FromSsize_t(PyLong_AsSsize_t(*slot) + 1);
+        if (!count) return -1;
+        Py_SETREF(*slot, count);
+        return 0;
     }
-    return h;
+    if (PyErr_Occurred()) return -1;
+    PyObject *one = PyLong_FromLong(1);
+    PyObject *r = one ? TransientMap_assoc_hashed(t, item, h, one) : NULL;
+    Py_XDECREF(one);
+    Py_XDECREF(r);
+    return r ? 0 : -1;
+}
+
+/* frequencies(coll) - Map of each distinct element to the times it occurs */
+static PyObject *pds_frequencies(PyObject *self, PyObject *coll) {
+    TransientMap *t = (TransientMap *)Map_transient(EMPTY_MAP, NULL);
+    if (!t) return NULL;
+    PyObject *result = pds_each(coll, frequencies_step, t) < 0 ? NULL : TransientMap_persistent(t, NULL);
+    Py_DECREF(t);
+    return result;
 }
 
-static RBNode *RBNode_move_red_right(RBNode *h, PyObject *edit) {
-    h = RBNode_flip_colors(h, edit);
-    if (!h) return NULL;
+// One side of zipmap: a Vector, list or tuple read by index, else an iterator
+typedef struct {
+    PyObject *coll;
+    PyObject *iter;
+    Py_ssize_t i;
+} ZipSource;
 
-    if (h->left && RBNode_is_red(h->left->left)) {
-        h = RBNode_rotate_right(h, edit);
-        if (!h) return NULL;
-        h = RBNode_flip_colors(h, edit);
-        if (!h) return NULL;
+static int ZipSource_init(ZipSource *z, PyObject *coll) {
+    z->coll = coll;
+    z->iter = NULL;
+    z->i = 0;
+    if (PyObject_TypeCheck(coll, &VectorType) || PyList_Check(coll) || PyTuple_Check(coll)) {
+        return 0;
     }
-    return h;
+    z->iter = PyObject_GetIter(coll);
+    return z->iter ? 0 : -1;
 }
 
-static RBNode *RBNode_min(RBNode *node) {
-    while (node->left) node = node->left;
-    return node;
+// Next element (new reference); NULL when exhausted or on error
+static PyObject *ZipSource_next(ZipSource *z) {
+    if (z->iter) return PyIter_Next(z->iter);
+    PyObject *item = NULL;
+    if (PyObject_TypeCheck(z->coll, &VectorType)) {
+        if (z->i < ((Vector *)z->coll)->cnt) item = Vector_item((Vector *)z->coll, z->i);
+    } else if (z->i < PySequence_Fast_GET_SIZE(z->coll)) {
+        item = PySequence_Fast_GET_ITEM(z->coll, z->i);
+    }
+    z->i++;
+    Py_XINCREF(item);
+    return item;
 }
 
-static RBNode *RBNode_delete_min(RBNode *h, PyObject *edit) {
-    // First ensure we have an editable copy before any modifications
-    RBNode *new_h = RBNode_ensure_editable(h, edit);
-    if (!new_h) return NULL;
-
-    // Now check if this is the min node (no left child)
-    if (!new_h->left) {
-        Py_DECREF(new_h);
+/* zipmap(keys, vals) - Map of each key to the value at the same position,
+   stopping at the shorter side; built in one bulk pass */
+static PyObject *pds_zipmap(PyObject *self, PyObject *args) {
+    PyObject *keys, *vals;
+    if (!PyArg_ParseTuple(args, "OO:zipmap", &keys, &vals)) {
         return NULL;
     }
 
-    if (!RBNode_is_red(new_h->left) && !RBNode_is_red(new_h->left->left)) {
-        new_h = RBNode_move_red_left(new_h, edit);
-        if (!new_h) return NULL;
+    ZipSource zk, zv;
+    if (ZipSource_init(&zk, keys) < 0) return NULL;
+    if (ZipSource_init(&zv, vals) < 0) {
+        Py_XDECREF(zk.iter);
+        return NULL;
     }
 
-    RBNode *new_left = RBNode_delete_min(new_h->left, edit);
-    if (new_h->left && !new_left && PyErr_Occurred()) {
-        Py_DECREF(new_h);
+    Py_ssize_t n = 0, cap = 8;
+    MapBuildEntry *e = PyMem_Malloc(cap * sizeof(MapBuildEntry));
+    if (!e) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    for (;;) {
+        PyObject *k = ZipSource_next(&zk);
+        if (!k) break;
+        PyObject *v = ZipSource_next(&zv);
+        if (!v) {
+            Py_DECREF(k);
+            break;
+        }
+        if (n == cap) {
+            MapBuildEntry *grown = PyMem_Realloc(e, 2 * cap * sizeof(MapBuildEntry));
+            if (!grown) {
+                PyErr_NoMemory();
+            } else {
+                e = grown;
+                cap *= 2;
+            }
+        }
+        int rc = n < cap ? MapBuild_push(e, &n, k, v) : -1;
+        Py_DECREF(k);
+        Py_DECREF(v);
+        if (rc < 0) break;
+    }
+    Py_XDECREF(zk.iter);
+    Py_XDECREF(zv.iter);
+    if (PyErr_Occurred()) {
+        MapBuild_clear(e, n);
         return NULL;
     }
-    Py_XDECREF(new_h->left);
-    new_h->left = new_left;
+    return Map_build(e, n);
 
-    return RBNode_balance(new_h, edit);
+error:
+    Py_XDECREF(zk.iter);
+    Py_XDECREF(zv.iter);
+    return NULL;
 }
 
-// Delete a node with matching sort_key and value
-static RBNode *RBNode_delete(RBNode *h, PyObject *sort_key, PyObject *value, int reverse, int *deleted, PyObject *edit) {
-    if (!h) {
-        *deleted = 0;
-        return NULL;
-    }
+// =============================================================================
+// STRUCTURAL DIFF
+// =============================================================================
+// diff(old, new) walks two versions of a Map, Set or Vector side by side.
+// Pointer-identical subtrees are skipped without being entered, so when one
+// version was derived from the other the walk only visits the paths that were
+// copied: O(changes * log n) rather than O(n). Positions where the two tries
+// have different shapes (array maps, collision nodes, relaxed vector nodes
+// that do not line up) fall back to comparing entries one at a time.
 
-    int cmp = SortedVector_compare_keys(sort_key, h->sort_key, reverse);
-    if (cmp == -2) return NULL;  // Error
+typedef struct {
+    TransientMap *removed;  // entries only in old
+    TransientMap *added;    // entries only in new
+    TransientMap *changed;  // keys in both whose value differs, with the new value
+} MapDiff;
 
-    RBNode *new_h = RBNode_ensure_editable(h, edit);
-    if (!new_h) return NULL;
+typedef int (*pds_entry_fn)(PyObject *key, Py_hash_t hash_val, PyObject *val, void *ctx);
 
-    if (cmp < 0) {
-        if (new_h->left && !RBNode_is_red(new_h->left) && !RBNode_is_red(new_h->left->left)) {
-            new_h = RBNode_move_red_left(new_h, edit);
-            if (!new_h) return NULL;
+// Call fn on every entry below a node of any type; a nonzero result stops the walk
+static int MapNode_each_entry(PyObject *node, pds_entry_fn fn, void *ctx) {
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(bin); i += 2) {
+            int r = 0;
+            if (bin->array[i] != NULL) {
+                r = fn(bin->array[i], BIN_HASHES(bin)[i / 2], bin->array[i + 1], ctx);
+            } else if (bin->array[i + 1] != NULL) {
+                r = MapNode_each_entry(bin->array[i + 1], fn, ctx);
+            }
+            if (r) return r;
         }
-        RBNode *new_left = RBNode_delete(new_h->left, sort_key, value, reverse, deleted, edit);
-        if (new_h->left && !new_left && PyErr_Occurred()) {
-            Py_DECREF(new_h);
-            return NULL;
+    } else if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] == NULL) continue;
+            int r = MapNode_each_entry(an->array[i], fn, ctx);
+            if (r) return r;
+        }
+    } else if (is_array_map(node)) {
+        ArrayMapNode *amn = (ArrayMapNode *)node;
+        for (Py_ssize_t i = 0; i < Py_SIZE(amn); i++) {
+            int r = fn(amn->array[2 * i], AMN_HASHES(amn)[i], amn->array[2 * i + 1], ctx);
+            if (r) return r;
         }
-        Py_XDECREF(new_h->left);
-        new_h->left = new_left;
     } else {
-        if (RBNode_is_red(new_h->left)) {
-            new_h = RBNode_rotate_right(new_h, edit);
-            if (!new_h) return NULL;
+        HashCollisionNode *hcn = (HashCollisionNode *)node;
+        for (int i = 0; i < hcn->count; i++) {
+            int r = fn(hcn->array[2 * i], hcn->hash, hcn->array[2 * i + 1], ctx);
+            if (r) return r;
         }
+    }
+    return 0;
+}
 
-        // Check if this is the node to delete
-        int eq = PyObject_RichCompareBool(value, new_h->value, Py_EQ);
-        if (eq < 0) {
-            Py_DECREF(new_h);
-            return NULL;
-        }
+static int diff_put(PyObject *key, Py_hash_t hash_val, PyObject *val, void *ctx) {
+    PyObject *r = TransientMap_assoc_hashed((TransientMap *)ctx, key, hash_val, val);
+    if (!r) return -1;
+    Py_DECREF(r);
+    return 0;
+}
 
-        int key_eq = (SortedVector_compare_keys(sort_key, new_h->sort_key, reverse) == 0);
+typedef struct {
+    MapDiff *st;
+    PyObject *other;  // node the entries are looked up in
+    int shift;
+    int from_new;     // entries come from new, so missing ones were added
+} MapDiffLookup;
+
+static int diff_lookup_entry(PyObject *key, Py_hash_t hash_val, PyObject *val, void *ctx) {
+    MapDiffLookup *lk = (MapDiffLookup *)ctx;
+    PyObject *found = MapNode_find(lk->other, lk->shift, hash_val, key, _MISSING);
+    if (!found) return -1;
+    int r = 0;
+    if (found == _MISSING) {
+        r = diff_put(key, hash_val, val, lk->from_new ? lk->st->added : lk->st->removed);
+    } else if (!lk->from_new) {
+        r = pds_items_differ(val, found);
+        if (r > 0) r = diff_put(key, hash_val, found, lk->st->changed);
+    }
+    Py_DECREF(found);
+    return r;
+}
 
-        if (key_eq && eq && !new_h->right) {
-            *deleted = 1;
-            Py_DECREF(new_h);
-            return NULL;
-        }
+// Entry-at-a-time fallback for two nodes at `shift` whose shapes do not line up.
+// Changed values are recorded while walking old, so new only adds its new keys.
+static int MapDiff_entries(MapDiff *st, PyObject *a, PyObject *b, int shift) {
+    MapDiffLookup lk = {st, b, shift, 0};
+    if (MapNode_each_entry(a, diff_lookup_entry, &lk) < 0) return -1;
+    lk.other = a;
+    lk.from_new = 1;
+    return MapNode_each_entry(b, diff_lookup_entry, &lk) < 0 ? -1 : 0;
+}
 
-        if (new_h->right && !RBNode_is_red(new_h->right) && !RBNode_is_red(new_h->right->left)) {
-            new_h = RBNode_move_red_right(new_h, edit);
-            if (!new_h) return NULL;
-        }
+typedef struct {
+    PyObject *key;   // entry to leave out, or NULL once it has been seen
+    Py_hash_t hash;
+    TransientMap *into;
+} MapDiffExcept;
 
-        // Re-check after rotation
-        eq = PyObject_RichCompareBool(value, new_h->value, Py_EQ);
-        if (eq < 0) {
-            Py_DECREF(new_h);
-            return NULL;
+static int diff_put_except(PyObject *key, Py_hash_t hash_val, PyObject *val, void *ctx) {
+    MapDiffExcept *ex = (MapDiffExcept *)ctx;
+    if (ex->key != NULL && hash_val == ex->hash) {
+        int eq = key == ex->key ? 1 : PyObject_RichCompareBool(key, ex->key, Py_EQ);
+        if (eq < 0) return -1;
+        if (eq) {
+            ex->key = NULL;
+            return 0;
         }
-        key_eq = (SortedVector_compare_keys(sort_key, new_h->sort_key, reverse) == 0);
+    }
+    return diff_put(key, hash_val, val, ex->into);
+}
 
-        if (key_eq && eq) {
-            // Replace with successor
-            RBNode *min_node = RBNode_min(new_h->right);
+// One side holds a lone key at a position where the other holds a subtree at
+// `shift`: the key is looked up in the subtree and the rest of the subtree is
+// recorded as removed or added wholesale.
+static int MapDiff_key_vs_node(MapDiff *st, PyObject *key, Py_hash_t hash_val, PyObject *val,
+                               PyObject *node, int shift, int key_in_new) {
+    PyObject *found = MapNode_find(node, shift, hash_val, key, _MISSING);
+    if (!found) return -1;
+    int present = found != _MISSING;
+    int r;
+    if (!present) {
+        r = diff_put(key, hash_val, val, key_in_new ? st->added : st->removed);
+    } else {
+        r = pds_items_differ(val, found);
+        if (r > 0) r = diff_put(key, hash_val, key_in_new ? val : found, st->changed);
+    }
+    Py_DECREF(found);
+    if (r < 0) return -1;
 
-            Py_DECREF(new_h->value);
-            new_h->value = min_node->value;
-            Py_INCREF(new_h->value);
+    MapDiffExcept ex = {present ? key : NULL, hash_val, key_in_new ? st->removed : st->added};
+    return MapNode_each_entry(node, diff_put_except, &ex) < 0 ? -1 : 0;
+}
 
-            Py_DECREF(new_h->sort_key);
-            new_h->sort_key = min_node->sort_key;
-            Py_INCREF(new_h->sort_key);
+// Diff the entries below two nodes at `shift`, position by position
+static int MapDiff_walk(MapDiff *st, PyObject *a, PyObject *b, int shift) {
+    if (a == b) return 0;
 
-            RBNode *new_right = RBNode_delete_min(new_h->right, edit);
-            if (new_h->right && !new_right && PyErr_Occurred()) {
-                Py_DECREF(new_h);
-                return NULL;
-            }
-            Py_XDECREF(new_h->right);
-            new_h->right = new_right;
+    int trie_a = PyObject_TypeCheck(a, &BitmapIndexedNodeType) || PyObject_TypeCheck(a, &ArrayNodeType);
+    int trie_b = PyObject_TypeCheck(b, &BitmapIndexedNodeType) || PyObject_TypeCheck(b, &ArrayNodeType);
+    if (!trie_a || !trie_b) return MapDiff_entries(st, a, b, shift);
 
-            *deleted = 1;
-        } else {
-            RBNode *new_right = RBNode_delete(new_h->right, sort_key, value, reverse, deleted, edit);
-            if (new_h->right && !new_right && PyErr_Occurred()) {
-                Py_DECREF(new_h);
-                return NULL;
+    for (int i = 0; i < WIDTH; i++) {
+        PyObject *ka = NULL, *va = NULL, *kb = NULL, *vb = NULL;
+        Py_hash_t ha = 0, hb = 0;
+        int in_a = MapNode_slot(a, i, &ka, &ha, &va) && (ka != NULL || va != NULL);
+        int in_b = MapNode_slot(b, i, &kb, &hb, &vb) && (kb != NULL || vb != NULL);
+        if (!in_a && !in_b) continue;
+        if (in_a && in_b && ka == kb && va == vb) continue;
+
+        int r;
+        if (!in_b) {
+            r = ka ? diff_put(ka, ha, va, st->removed) : MapNode_each_entry(va, diff_put, st->removed);
+        } else if (!in_a) {
+            r = kb ? diff_put(kb, hb, vb, st->added) : MapNode_each_entry(vb, diff_put, st->added);
+        } else if (ka != NULL && kb != NULL) {
+            int same = 0;
+            if (ha == hb) {
+                same = ka == kb ? 1 : PyObject_RichCompareBool(ka, kb, Py_EQ);
+                if (same < 0) return -1;
+            }
+            if (same) {
+                r = pds_items_differ(va, vb);
+                if (r > 0) r = diff_put(kb, hb, vb, st->changed);
+            } else {
+                r = diff_put(ka, ha, va, st->removed);
+                if (r == 0) r = diff_put(kb, hb, vb, st->added);
             }
-            Py_XDECREF(new_h->right);
-            new_h->right = new_right;
+        } else if (ka == NULL && kb == NULL) {
+            r = MapDiff_walk(st, va, vb, shift + BITS);
+        } else if (ka != NULL) {
+            r = MapDiff_key_vs_node(st, ka, ha, va, vb, shift + BITS, 0);
+        } else {
+            r = MapDiff_key_vs_node(st, kb, hb, vb, va, shift + BITS, 1);
+        }
+        if (r < 0) return -1;
+    }
+    return 0;
+}
+
+// Finish an accumulator as a Map, or as a Set over the same nodes
+static PyObject *MapDiff_finish(TransientMap *t, int as_set) {
+    if (!as_set) return TransientMap_persistent(t, NULL);
+    Py_CLEAR(t->id);
+    if (t->cnt == 0) {
+        Py_INCREF(EMPTY_SET);
+        return (PyObject *)EMPTY_SET;
+    }
+    return (PyObject *)Set_create(t->cnt, t->root, NULL);
+}
+
+// (removed, added, changed) between two Map roots, or (removed, added) between Set roots
+static PyObject *MapNode_diff(PyObject *a, PyObject *b, int is_set) {
+    MapDiff st;
+    st.removed = (TransientMap *)Map_transient(EMPTY_MAP, NULL);
+    st.added = (TransientMap *)Map_transient(EMPTY_MAP, NULL);
+    st.changed = (TransientMap *)Map_transient(EMPTY_MAP, NULL);
+    PyObject *result = NULL;
+    if (st.removed && st.added && st.changed
+        && MapDiff_walk(&st, a ? a : (PyObject *)EMPTY_BIN, b ? b : (PyObject *)EMPTY_BIN, 0) == 0) {
+        PyObject *removed = MapDiff_finish(st.removed, is_set);
+        PyObject *added = removed ? MapDiff_finish(st.added, is_set) : NULL;
+        PyObject *changed = added && !is_set ? MapDiff_finish(st.changed, 0) : NULL;
+        if (added && (is_set || changed)) {
+            result = is_set ? PyTuple_Pack(2, removed, added) : PyTuple_Pack(3, removed, added, changed);
         }
+        Py_XDECREF(removed);
+        Py_XDECREF(added);
+        Py_XDECREF(changed);
     }
+    Py_XDECREF(st.removed);
+    Py_XDECREF(st.added);
+    Py_XDECREF(st.changed);
+    return result;
+}
 
-    return RBNode_balance(new_h, edit);
+// Record index i -> y in the changed map a Vector diff builds
+static int diff_put_index(VectorCompare *cmp, Py_ssize_t i, PyObject *y) {
+    PyObject *key = PyLong_FromSsize_t(i);
+    if (!key) return -1;
+    Py_hash_t h = PyObject_Hash(key);
+    int r = h == -1 ? -1 : diff_put(key, h, y, cmp->ctx);
+    Py_DECREF(key);
+    return r;
+}
+
+// (removed, added, changed) between two vectors: the elements of old past the
+// end of new, the elements of new past the end of old, and a Map of each index
+// both share to its new value where the elements differ.
+static PyObject *Vector_diff(Vector *a, Vector *b) {
+    TransientMap *changed_t = (TransientMap *)Map_transient(EMPTY_MAP, NULL);
+    if (!changed_t) return NULL;
+    VectorCompare cmp = {a, b, a->cnt < b->cnt ? a->cnt : b->cnt, diff_put_index, changed_t};
+
+    PyObject *result = NULL;
+    if (VectorCompare_run(&cmp) == 0) {
+        PyObject *removed = Vector_slice(a, cmp.limit, a->cnt);
+        PyObject *added = removed ? Vector_slice(b, cmp.limit, b->cnt) : NULL;
+        PyObject *changed = added ? TransientMap_persistent(changed_t, NULL) : NULL;
+        if (changed) result = PyTuple_Pack(3, removed, added, changed);
+        Py_XDECREF(removed);
+        Py_XDECREF(added);
+        Py_XDECREF(changed);
+    }
+    Py_DECREF(changed_t);
+    return result;
 }
 
-static PyObject *SortedVector_disj(SortedVector *self, PyObject *value) {
-    if (self->cnt == 0) {
-        Py_INCREF(self);
-        return (PyObject *)self;
+/* diff(old, new) - what changed between two versions of a collection:
+   (removed, added, changed) Maps for two Maps, (removed, added) Sets for two
+   Sets, and for two Vectors (removed tail, added tail, {index new-value}).
+   Subtrees the versions share are skipped by identity. */
+static PyObject *pds_diff(PyObject *self, PyObject *args) {
+    PyObject *a, *b;
+    if (!PyArg_ParseTuple(args, "OO:diff", &a, &b)) return NULL;
+
+    if (PyObject_TypeCheck(a, &MapType) && PyObject_TypeCheck(b, &MapType)) {
+        return MapNode_diff(((Map *)a)->root, ((Map *)b)->root, 0);
+    }
+    if (PyObject_TypeCheck(a, &SetType) && PyObject_TypeCheck(b, &SetType)) {
+        return MapNode_diff(((Set *)a)->root, ((Set *)b)->root, 1);
+    }
+    if (PyObject_TypeCheck(a, &VectorType) && PyObject_TypeCheck(b, &VectorType)) {
+        return Vector_diff((Vector *)a, (Vector *)b);
     }
+    PyErr_Format(PyExc_TypeError, "diff expects two Maps, two Sets or two Vectors, not %.200s and %.200s",
+                 Py_TYPE(a)->tp_name, Py_TYPE(b)->tp_name);
+    return NULL;
+}
 
-    PyObject *sort_key = SortedVector_get_sort_key(self, value);
-    if (!sort_key) return NULL;
+// =============================================================================
+// TRANSDUCERS
+// =============================================================================
+// A Transducer is a flat list of map / filter / take / partition stages.
+// transduce, into and eduction build one XfRun per use, holding the stages'
+// running state (take counts, partition buffers), and push each source
+// element through the stages in a single C loop into a sink: a transient,
+// a reducing function or an eduction's output buffer. Sources are walked
+// with pds_each, so Vector leaves and Map / Set nodes are read in place.
+// Composing transducers concatenates their stages; `comp` of transducers
+// is resolved by applying it to the empty transducer.
 
-    int deleted = 0;
-    RBNode *new_root = RBNode_delete(self->root, sort_key, value, self->reverse, &deleted, NULL);
-    Py_DECREF(sort_key);
+enum { XF_MAP, XF_FILTER, XF_TAKE, XF_PARTITION, XF_PARTITION_ALL };
 
-    if (self->root && !new_root && PyErr_Occurred()) return NULL;
+static const char *const XF_NAMES[] = {"map", "filter", "take", "partition", "partition-all"};
 
-    if (!deleted) {
-        Py_XDECREF(new_root);
-        Py_INCREF(self);
-        return (PyObject *)self;
-    }
+typedef struct {
+    int kind;
+    PyObject *fn;     // XF_MAP, XF_FILTER
+    Py_ssize_t n;     // XF_TAKE count, partition size
+} XfStage;
+
+typedef struct {
+    PyObject_HEAD
+    Py_ssize_t count;
+    XfStage *stages;
+} Transducer;
+
+static PyTypeObject TransducerType;
 
-    // Make root black
-    if (new_root && new_root->color == RB_RED) {
-        new_root->color = RB_BLACK;
+static void Transducer_dealloc(Transducer *self) {
+    for (Py_ssize_t i = 0; i < self->count; i++) {
+        Py_XDECREF(self->stages[i].fn);
     }
+    PyMem_Free(self->stages);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
 
-    SortedVector *result = PyObject_New(SortedVector, &SortedVectorType);
-    if (!result) {
-        Py_XDECREF(new_root);
+static Transducer *Transducer_alloc(Py_ssize_t count) {
+    Transducer *xf = PyObject_New(Transducer, &TransducerType);
+    if (!xf) return NULL;
+    xf->count = 0;
+    xf->stages = count ? PyMem_New(XfStage, count) : NULL;
+    if (count && !xf->stages) {
+        Py_DECREF(xf);
+        PyErr_NoMemory();
         return NULL;
     }
+    xf->count = count;
+    return xf;
+}
 
-    result->root = new_root;
-    result->cnt = self->cnt - 1;
-    result->key_fn = self->key_fn;
-    Py_XINCREF(result->key_fn);
-    result->reverse = self->reverse;
+static PyObject *Transducer_stage(int kind, PyObject *fn, Py_ssize_t n) {
+    Transducer *xf = Transducer_alloc(1);
+    if (!xf) return NULL;
+    xf->stages[0].kind = kind;
+    xf->stages[0].fn = fn;
+    Py_XINCREF(fn);
+    xf->stages[0].n = n;
+    return (PyObject *)xf;
+}
 
-    return (PyObject *)result;
+// a's stages followed by b's: elements go through a first
+static PyObject *Transducer_compose(Transducer *a, Transducer *b) {
+    Transducer *xf = Transducer_alloc(a->count + b->count);
+    if (!xf) return NULL;
+    for (Py_ssize_t i = 0; i < xf->count; i++) {
+        XfStage *s = i < a->count ? &a->stages[i] : &b->stages[i - a->count];
+        xf->stages[i] = *s;
+        Py_XINCREF(s->fn);
+    }
+    return (PyObject *)xf;
 }
 
-// === SortedVector init ===
+/* Transducer(other) - compose: self's stages run first, as with comp */
+static PyObject *Transducer_call(Transducer *self, PyObject *args, PyObject *kwds) {
+    PyObject *other;
+    if (!PyArg_ParseTuple(args, "O:Transducer", &other)) {
+        return NULL;
+    }
+    if (!PyObject_TypeCheck(other, &TransducerType)) {
+        PyErr_Format(PyExc_TypeError, "a transducer composes only with another transducer, not %.200s",
+                     Py_TYPE(other)->tp_name);
+        return NULL;
+    }
+    return Transducer_compose(self, (Transducer *)other);
+}
 
-static int SortedVector_init(SortedVector *self, PyObject *args, PyObject *kwds) {
-    static char *kwlist[] = {"", "key", "reverse", NULL};
-    PyObject *iterable = NULL;
-    PyObject *key_fn = Py_None;
-    int reverse = 0;
+static PyObject *Transducer_repr(Transducer *self) {
+    PyObject *parts = PyList_New(0);
+    if (!parts) return NULL;
+    for (Py_ssize_t i = 0; i < self->count; i++) {
+        XfStage *s = &self->stages[i];
+        PyObject *part = s->fn ? PyUnicode_FromString(XF_NAMES[s->kind])
+                               : PyUnicode_FromFormat("%s(%zd)", XF_NAMES[s->kind], s->n);
+        if (!part || PyList_Append(parts, part) < 0) {
+            Py_XDECREF(part);
+            Py_DECREF(parts);
+            return NULL;
+        }
+        Py_DECREF(part);
+    }
+    PyObject *sep = PyUnicode_FromString(" ");
+    PyObject *joined = sep ? PyUnicode_Join(sep, parts) : NULL;
+    Py_XDECREF(sep);
+    Py_DECREF(parts);
+    if (!joined) return NULL;
+    PyObject *result = PyUnicode_FromFormat("<Transducer %U>", joined);
+    Py_DECREF(joined);
+    return result;
+}
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O$Op", kwlist,
-                                     &iterable, &key_fn, &reverse)) {
+static PyTypeObject TransducerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.Transducer",
+    .tp_doc = "Composable map / filter / take / partition stages, run in one pass by transduce, into and eduction",
+    .tp_basicsize = sizeof(Transducer),
+    .tp_dealloc = (destructor)Transducer_dealloc,
+    .tp_repr = (reprfunc)Transducer_repr,
+    .tp_call = (ternaryfunc)Transducer_call,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+};
+
+// xform as a Transducer (new reference): a Transducer itself, or a function
+// composed of them, such as (comp (map f) (filter p)), applied to the empty one
+static Transducer *Transducer_resolve(PyObject *xform) {
+    if (PyObject_TypeCheck(xform, &TransducerType)) {
+        Py_INCREF(xform);
+        return (Transducer *)xform;
+    }
+    if (!PyCallable_Check(xform)) {
+        PyErr_Format(PyExc_TypeError, "expected a transducer, not %.200s", Py_TYPE(xform)->tp_name);
+        return NULL;
+    }
+    Transducer *empty = Transducer_alloc(0);
+    if (!empty) return NULL;
+    PyObject *xf = PyObject_CallOneArg(xform, (PyObject *)empty);
+    Py_DECREF(empty);
+    if (xf && !PyObject_TypeCheck(xf, &TransducerType)) {
+        PyErr_Format(PyExc_TypeError, "expected a transducer, %.200s returned %.200s",
+                     Py_TYPE(xform)->tp_name, Py_TYPE(xf)->tp_name);
+        Py_CLEAR(xf);
+    }
+    return (Transducer *)xf;
+}
+
+// One pass of a transducer: per-stage state and where results go
+typedef struct {
+    Transducer *xf;
+    Py_ssize_t *left;     // per stage: XF_TAKE elements still to pass
+    PyObject **buf;       // per stage: partition buffer (a list), made when first needed
+    pds_visit_fn sink;
+    void *sink_ctx;
+} XfRun;
+
+static int XfRun_init(XfRun *run, Transducer *xf, pds_visit_fn sink, void *sink_ctx) {
+    Py_ssize_t n = xf->count;
+    run->xf = xf;
+    Py_INCREF(xf);
+    run->sink = sink;
+    run->sink_ctx = sink_ctx;
+    run->left = PyMem_New(Py_ssize_t, n ? n : 1);
+    run->buf = PyMem_New(PyObject *, n ? n : 1);
+    if (!run->left || !run->buf) {
+        PyMem_Free(run->left);
+        PyMem_Free(run->buf);
+        Py_CLEAR(run->xf);
+        PyErr_NoMemory();
         return -1;
     }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        run->left[i] = xf->stages[i].n;
+        run->buf[i] = NULL;
+    }
+    return 0;
+}
 
-    self->root = NULL;
-    self->cnt = 0;
-    self->reverse = reverse;
+static void XfRun_clear(XfRun *run) {
+    if (!run->xf) return;
+    for (Py_ssize_t i = 0; i < run->xf->count; i++) {
+        Py_XDECREF(run->buf[i]);
+    }
+    PyMem_Free(run->left);
+    PyMem_Free(run->buf);
+    Py_CLEAR(run->xf);
+}
+
+// Push item (borrowed) through the stages from i on: 0 to go on, -1 on
+// error, 1 once a take has passed its last element and the source can stop
+static int XfRun_push(XfRun *run, Py_ssize_t i, PyObject *item) {
+    for (; i < run->xf->count; i++) {
+        XfStage *s = &run->xf->stages[i];
+        switch (s->kind) {
+        case XF_MAP: {
+            PyObject *y = PyObject_CallOneArg(s->fn, item);
+            if (!y) return -1;
+            int rc = XfRun_push(run, i + 1, y);
+            Py_DECREF(y);
+            return rc;
+        }
+        case XF_FILTER: {
+            PyObject *t = PyObject_CallOneArg(s->fn, item);
+            if (!t) return -1;
+            int keep = PyObject_IsTrue(t);
+            Py_DECREF(t);
+            if (keep <= 0) return keep;
+            break;
+        }
+        case XF_TAKE: {
+            if (run->left[i] <= 0) return 1;
+            run->left[i]--;
+            int rc = XfRun_push(run, i + 1, item);
+            return rc == 0 && run->left[i] == 0 ? 1 : rc;
+        }
+        default: {  // XF_PARTITION, XF_PARTITION_ALL
+            if (!run->buf[i] && !(run->buf[i] = PyList_New(0))) return -1;
+            if (PyList_Append(run->buf[i], item) < 0) return -1;
+            if (PyList_GET_SIZE(run->buf[i]) < s->n) return 0;
+            PyObject *group = Vector_from_items(PySequence_Fast_ITEMS(run->buf[i]), s->n);
+            Py_CLEAR(run->buf[i]);
+            if (!group) return -1;
+            int rc = XfRun_push(run, i + 1, group);
+            Py_DECREF(group);
+            return rc;
+        }
+        }
+    }
+    return run->sink(item, run->sink_ctx);
+}
 
-    if (key_fn != Py_None) {
-        self->key_fn = key_fn;
-        Py_INCREF(key_fn);
-    } else {
-        self->key_fn = NULL;
+// The source is done: flush partial partition-all groups, first stage first
+static int XfRun_finish(XfRun *run) {
+    for (Py_ssize_t i = 0; i < run->xf->count; i++) {
+        PyObject *buf = run->buf[i];
+        if (!buf || run->xf->stages[i].kind != XF_PARTITION_ALL || PyList_GET_SIZE(buf) == 0) continue;
+        PyObject *group = Vector_from_items(PySequence_Fast_ITEMS(buf), PyList_GET_SIZE(buf));
+        Py_CLEAR(run->buf[i]);
+        if (!group) return -1;
+        int rc = XfRun_push(run, i + 1, group);
+        Py_DECREF(group);
+        if (rc < 0) return -1;
     }
+    return 0;
+}
 
-    if (iterable && iterable != Py_None) {
-        PyObject *iter = PyObject_GetIter(iterable);
-        if (!iter) return -1;
+static int XfRun_step(PyObject *item, void *ctx) {
+    return XfRun_push((XfRun *)ctx, 0, item);
+}
 
-        PyObject *item;
-        while ((item = PyIter_Next(iter)) != NULL) {
-            PyObject *new_sv = SortedVector_conj(self, item);
-            Py_DECREF(item);
-            if (!new_sv) {
-                Py_DECREF(iter);
-                return -1;
-            }
+// Run xform over every element of coll into sink, stopping early after a take
+static int Transducer_run(Transducer *xf, PyObject *coll, pds_visit_fn sink, void *sink_ctx) {
+    XfRun run;
+    if (XfRun_init(&run, xf, sink, sink_ctx) < 0) return -1;
+    int rc = pds_each(coll, XfRun_step, &run);
+    if (rc >= 0) rc = XfRun_finish(&run);
+    XfRun_clear(&run);
+    return rc;
+}
 
-            // Move data from new_sv to self
-            Py_XDECREF(self->root);
-            self->root = ((SortedVector *)new_sv)->root;
-            Py_XINCREF(self->root);
-            self->cnt = ((SortedVector *)new_sv)->cnt;
-            Py_DECREF(new_sv);
-        }
-        Py_DECREF(iter);
+static int assoc_pair_step(PyObject *item, void *ctx) {
+    return TransientMap_assoc_pair((TransientMap *)ctx, item);
+}
 
-        if (PyErr_Occurred()) return -1;
+/* into(to, xform, from) - into through a transducer: each element of from
+   is pushed through xform's stages and added straight to a transient of to */
+static PyObject *into_xform(PyObject *to, PyObject *xform, PyObject *from) {
+    pds_visit_fn step;
+    PyObject *t;
+    if (PyObject_TypeCheck(to, &VectorType)) {
+        t = Vector_transient((Vector *)to, NULL);
+        step = conj_vector_step;
+    } else if (PyObject_TypeCheck(to, &MapType)) {
+        t = Map_transient((Map *)to, NULL);
+        step = assoc_pair_step;
+    } else if (PyObject_TypeCheck(to, &SetType)) {
+        t = Set_transient((Set *)to, NULL);
+        step = conj_set_step;
+    } else {
+        PyErr_Format(PyExc_TypeError, "into expects a Vector, Map or Set, not %.200s", Py_TYPE(to)->tp_name);
+        return NULL;
     }
+    if (!t) return NULL;
+    Transducer *xf = Transducer_resolve(xform);
+    PyObject *result = NULL;
+    if (xf && Transducer_run(xf, from, step, t) >= 0) {
+        if (step == conj_vector_step) {
+            result = TransientVector_persistent((TransientVector *)t, NULL);
+        } else if (step == assoc_pair_step) {
+            result = TransientMap_persistent((TransientMap *)t, NULL);
+        } else {
+            result = TransientSet_persistent((TransientSet *)t, NULL);
+        }
+    }
+    Py_XDECREF(xf);
+    Py_DECREF(t);
+    return result;
+}
 
+typedef struct {
+    PyObject *f;
+    PyObject *acc;
+} XfReduce;
+
+static int transduce_step(PyObject *item, void *ctx) {
+    XfReduce *r = (XfReduce *)ctx;
+    PyObject *args[2] = {r->acc, item};
+    PyObject *acc = PyObject_Vectorcall(r->f, args, 2, NULL);
+    if (!acc) return -1;
+    Py_SETREF(r->acc, acc);
     return 0;
 }
 
-// === SortedVector transient ===
+/* transduce(xform, f, [init,] coll) - reduce coll with f(acc, x) after
+   xform's stages, in one pass; without init it starts from f() */
+static PyObject *pds_transduce(PyObject *self, PyObject *args) {
+    PyObject *xform, *f, *init = NULL, *coll;
+    Py_ssize_t n = PyTuple_GET_SIZE(args);
+    if (n == 3) {
+        if (!PyArg_ParseTuple(args, "OOO:transduce", &xform, &f, &coll)) return NULL;
+    } else if (!PyArg_ParseTuple(args, "OOOO:transduce", &xform, &f, &init, &coll)) {
+        return NULL;
+    }
+    Transducer *xf = Transducer_resolve(xform);
+    if (!xf) return NULL;
+    XfReduce r = {f, init};
+    if (init) {
+        Py_INCREF(init);
+    } else {
+        r.acc = PyObject_CallNoArgs(f);
+    }
+    if (r.acc && Transducer_run(xf, coll, transduce_step, &r) < 0) {
+        Py_CLEAR(r.acc);
+    }
+    Py_DECREF(xf);
+    return r.acc;
+}
 
-typedef struct TransientSortedVector {
+// === Eduction ===
+
+// Eduction(xform, coll): a reusable iterable that runs xform over coll
+// afresh each time it is iterated
+typedef struct {
     PyObject_HEAD
-    RBNode *root;
-    Py_ssize_t cnt;
-    PyObject *key_fn;
-    int reverse;
-    PyObject *id;  // Edit token
-} TransientSortedVector;
+    Transducer *xf;
+    PyObject *coll;
+} Eduction;
+
+typedef struct {
+    PyObject_HEAD
+    XfRun run;
+    PyObject *source;     // iterator over the collection, NULL once it is done
+    PyObject *out;        // elements the stages produced and next has yet to return
+    Py_ssize_t out_pos;
+    int running;
+} EductionIterator;
+
+static PyTypeObject EductionIteratorType;
+
+static void Eduction_dealloc(Eduction *self) {
+    Py_XDECREF(self->xf);
+    Py_XDECREF(self->coll);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static void EductionIterator_dealloc(EductionIterator *self) {
+    XfRun_clear(&self->run);
+    Py_XDECREF(self->source);
+    Py_XDECREF(self->out);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int eduction_emit(PyObject *item, void *ctx) {
+    return PyList_Append((PyObject *)ctx, item);
+}
+
+static PyObject *EductionIterator_next(EductionIterator *self) {
+    if (self->running) {
+        PyErr_SetString(PyExc_RuntimeError, "eduction iterator is already running");
+        return NULL;
+    }
+    for (;;) {
+        Py_ssize_t size = PyList_GET_SIZE(self->out);
+        if (self->out_pos < size) {
+            PyObject *item = PyList_GET_ITEM(self->out, self->out_pos++);
+            Py_INCREF(item);
+            if (self->out_pos == size) {
+                self->out_pos = 0;
+                if (PyList_SetSlice(self->out, 0, size, NULL) < 0) {
+                    Py_DECREF(item);
+                    return NULL;
+                }
+            }
+            return item;
+        }
+        if (!self->source) return NULL;
+
+        self->running = 1;
+        int rc;
+        PyObject *item = PyIter_Next(self->source);
+        if (item) {
+            rc = XfRun_push(&self->run, 0, item);
+            Py_DECREF(item);
+        } else {
+            rc = PyErr_Occurred() ? -1 : 1;
+        }
+        if (rc > 0) {
+            Py_CLEAR(self->source);
+            rc = XfRun_finish(&self->run);
+        }
+        self->running = 0;
+        if (rc < 0) return NULL;
+    }
+}
+
+static PyTypeObject EductionIteratorType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.EductionIterator",
+    .tp_basicsize = sizeof(EductionIterator),
+    .tp_dealloc = (destructor)EductionIterator_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)EductionIterator_next,
+};
+
+static PyObject *Eduction_iter(Eduction *self) {
+    EductionIterator *it = PyObject_New(EductionIterator, &EductionIteratorType);
+    if (!it) return NULL;
+    it->run.xf = NULL;
+    it->out_pos = 0;
+    it->running = 0;
+    it->source = NULL;
+    it->out = PyList_New(0);
+    if (!it->out) goto error;
+    if (XfRun_init(&it->run, self->xf, eduction_emit, it->out) < 0) goto error;
+    it->source = PyObject_GetIter(self->coll);
+    if (!it->source) goto error;
+    return (PyObject *)it;
 
-static PyTypeObject TransientSortedVectorType;
+error:
+    Py_DECREF(it);
+    return NULL;
+}
 
-static void TransientSortedVector_dealloc(TransientSortedVector *self) {
-    Py_XDECREF(self->root);
-    Py_XDECREF(self->key_fn);
-    Py_XDECREF(self->id);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+static PyObject *Eduction_repr(Eduction *self) {
+    return PyUnicode_FromFormat("<Eduction %R over %.200s>", self->xf, Py_TYPE(self->coll)->tp_name);
 }
 
-static void TransientSortedVector_ensure_editable(TransientSortedVector *self) {
-    if (!self->id) {
-        PyErr_SetString(PyExc_RuntimeError, "TransientSortedVector already made persistent");
+static PyTypeObject EductionType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.Eduction",
+    .tp_doc = "Iterable applying a transducer to a collection each time it is iterated",
+    .tp_basicsize = sizeof(Eduction),
+    .tp_dealloc = (destructor)Eduction_dealloc,
+    .tp_repr = (reprfunc)Eduction_repr,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_iter = (getiterfunc)Eduction_iter,
+};
+
+/* eduction(xform, coll) - iterable of coll's elements through xform,
+   computed lazily and again on every iteration */
+static PyObject *pds_eduction(PyObject *self, PyObject *args) {
+    PyObject *xform, *coll;
+    if (!PyArg_ParseTuple(args, "OO:eduction", &xform, &coll)) {
+        return NULL;
+    }
+    Transducer *xf = Transducer_resolve(xform);
+    if (!xf) return NULL;
+    Eduction *ed = PyObject_New(Eduction, &EductionType);
+    if (!ed) {
+        Py_DECREF(xf);
+        return NULL;
     }
+    ed->xf = xf;
+    ed->coll = coll;
+    Py_INCREF(coll);
+    return (PyObject *)ed;
 }
 
-static PyObject *SortedVector_transient(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
-    TransientSortedVector *t = PyObject_New(TransientSortedVector, &TransientSortedVectorType);
-    if (!t) return NULL;
+/* xf_map(f), xf_filter(pred) - single-stage transducers */
+static PyObject *pds_xf_map(PyObject *self, PyObject *f) {
+    return Transducer_stage(XF_MAP, f, 0);
+}
 
-    t->id = PyObject_New(PyObject, &PdsSentinelType);
-    if (!t->id) {
-        Py_DECREF(t);
+static PyObject *pds_xf_filter(PyObject *self, PyObject *pred) {
+    return Transducer_stage(XF_FILTER, pred, 0);
+}
+
+/* xf_take(n) - pass the first n elements, then stop the source */
+static PyObject *pds_xf_take(PyObject *self, PyObject *arg) {
+    Py_ssize_t n = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+    if (n == -1 && PyErr_Occurred()) return NULL;
+    return Transducer_stage(XF_TAKE, NULL, n < 0 ? 0 : n);
+}
+
+/* xf_partition(n, all=False) - group elements into Vectors of n; a short
+   last group is kept only with all */
+static PyObject *pds_xf_partition(PyObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"n", "all", NULL};
+    Py_ssize_t n;
+    int all = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "n|p:xf_partition", kwlist, &n, &all)) {
+        return NULL;
+    }
+    if (n <= 0) {
+        PyErr_SetString(PyExc_ValueError, "partition size must be positive");
         return NULL;
     }
+    return Transducer_stage(all ? XF_PARTITION_ALL : XF_PARTITION, NULL, n);
+}
 
-    t->root = self->root;
-    Py_XINCREF(t->root);
-    t->cnt = self->cnt;
-    t->key_fn = self->key_fn;
-    Py_XINCREF(t->key_fn);
-    t->reverse = self->reverse;
+// =============================================================================
+// NESTED PATHS
+// =============================================================================
+// get_in, assoc_in, update_in and dissoc_in walk a path of keys through nested
+// Maps, Vectors and their transients in one call. Each level hashes its key
+// once for both the lookup and the assoc that rebuilds the level, and only
+// the nodes along the path are copied. Transients on the path are edited in
+// place. When a level ends up holding the value it already had, the level
+// itself is returned, so an unchanged path allocates nothing. Other
+// collections (dicts, IntMaps, ...) go through their get / assoc / dissoc.
+
+// Keys of a path: a Vector is read in place, anything else through PySequence_Fast
+typedef struct {
+    Vector *vec;
+    PyObject *seq;
+    Py_ssize_t n;
+} PathKeys;
+
+static int PathKeys_init(PathKeys *p, PyObject *path) {
+    p->vec = NULL;
+    p->seq = NULL;
+    if (PyObject_TypeCheck(path, &VectorType)) {
+        p->vec = (Vector *)path;
+        p->n = p->vec->cnt;
+        return 0;
+    }
+    p->seq = PySequence_Fast(path, "path must be a sequence of keys");
+    if (!p->seq) return -1;
+    p->n = PySequence_Fast_GET_SIZE(p->seq);
+    return 0;
+}
 
-    return (PyObject *)t;
+static inline PyObject *PathKeys_get(PathKeys *p, Py_ssize_t i) {
+    return p->vec ? Vector_item(p->vec, i) : PySequence_Fast_GET_ITEM(p->seq, i);
 }
 
-// Get sort key for transient
-static PyObject *TransientSortedVector_get_sort_key(TransientSortedVector *self, PyObject *value) {
-    if (self->key_fn && self->key_fn != Py_None) {
-        return PyObject_CallOneArg(self->key_fn, value);
+// Value under key in coll (a new reference), or _MISSING. For Maps *h gets the
+// key's hash for path_assoc to reuse; otherwise it is left at -1.
+static PyObject *path_lookup(PyObject *coll, PyObject *key, Py_hash_t *h) {
+    *h = -1;
+
+    if (PyObject_TypeCheck(coll, &MapType)) {
+        PyObject *root = ((Map *)coll)->root;
+        PyObject *result = _MISSING;
+        if (root == NULL) {
+            // nothing to find
+        } else if (is_array_map(root)) {
+            Py_ssize_t idx = ArrayMapNode_index((ArrayMapNode *)root, key, h);
+            if (idx == -2) return NULL;
+            if (idx >= 0) result = ((ArrayMapNode *)root)->array[2 * idx + 1];
+        } else {
+            *h = PyObject_Hash(key);
+            if (*h == -1 && PyErr_Occurred()) return NULL;
+            return MapNode_find(root, 0, *h, key, _MISSING);
+        }
+        Py_INCREF(result);
+        return result;
     }
-    Py_INCREF(value);
-    return value;
-}
 
-static PyObject *TransientSortedVector_conj_mut(TransientSortedVector *self, PyObject *value) {
-    TransientSortedVector_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+    if (PyObject_TypeCheck(coll, &VectorType) || PyObject_TypeCheck(coll, &TransientVectorType)) {
+        Py_ssize_t i = PyLong_Check(key) ? PyLong_AsSsize_t(key) : -1;
+        if (!PyLong_Check(key) || (i == -1 && PyErr_Occurred())) {
+            PyErr_Clear();  // like get, a non-index key is simply absent
+            Py_INCREF(_MISSING);
+            return _MISSING;
+        }
+        if (PyObject_TypeCheck(coll, &VectorType)) {
+            return Vector_nth_impl((Vector *)coll, i, _MISSING);
+        }
+        TransientVector *tv = (TransientVector *)coll;
+        TransientVector_ensure_editable(tv);
+        if (PyErr_Occurred()) return NULL;
+        if (i < 0) i += tv->cnt;
+        if (i < 0 || i >= tv->cnt) {
+            Py_INCREF(_MISSING);
+            return _MISSING;
+        }
+        return TransientVector_sq_item(tv, i);
+    }
 
-    PyObject *sort_key = TransientSortedVector_get_sort_key(self, value);
-    if (!sort_key) return NULL;
+    if (PyObject_TypeCheck(coll, &TransientMapType)) {
+        TransientMap *tm = (TransientMap *)coll;
+        TransientMap_ensure_editable(tm);
+        if (PyErr_Occurred()) return NULL;
+        if (tm->root == NULL) {
+            Py_INCREF(_MISSING);
+            return _MISSING;
+        }
+        *h = PyObject_Hash(key);
+        if (*h == -1 && PyErr_Occurred()) return NULL;
+        return MapNode_find(tm->root, 0, *h, key, _MISSING);
+    }
 
-    RBNode *new_root = RBNode_insert(self->root, value, sort_key, self->reverse, self->id);
-    Py_DECREF(sort_key);
+    if (coll == Py_None) {
+        Py_INCREF(_MISSING);
+        return _MISSING;
+    }
 
-    if (!new_root && PyErr_Occurred()) return NULL;
+    if (PyDict_Check(coll)) {
+        PyObject *result = PyDict_GetItemWithError(coll, key);
+        if (!result) {
+            if (PyErr_Occurred()) return NULL;
+            result = _MISSING;
+        }
+        Py_INCREF(result);
+        return result;
+    }
 
-    // Make root black
-    if (new_root && new_root->color == RB_RED) {
-        new_root->color = RB_BLACK;
+    PyObject *result = PyObject_GetItem(coll, key);
+    if (!result) {
+        if (!PyErr_ExceptionMatches(PyExc_KeyError) && !PyErr_ExceptionMatches(PyExc_IndexError) &&
+            !PyErr_ExceptionMatches(PyExc_TypeError)) {
+            return NULL;
+        }
+        PyErr_Clear();
+        Py_INCREF(_MISSING);
+        result = _MISSING;
     }
+    return result;
+}
 
-    Py_XDECREF(self->root);
-    self->root = new_root;
-    self->cnt++;
+// coll with key set to val: a new version for persistent collections, coll
+// itself (edited) for transients. h is the key's hash from path_lookup, or -1.
+static PyObject *path_assoc(PyObject *coll, PyObject *key, Py_hash_t h, PyObject *val) {
+    if (PyObject_TypeCheck(coll, &MapType)) {
+        return Map_assoc_impl((Map *)coll, key, h, val);
+    }
+    if (PyObject_TypeCheck(coll, &VectorType)) {
+        Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred()) return NULL;
+        return Vector_assoc_impl((Vector *)coll, i, val);
+    }
+    if (PyObject_TypeCheck(coll, &TransientMapType)) {
+        return TransientMap_assoc_mut_impl((TransientMap *)coll, key, val);
+    }
+    if (PyObject_TypeCheck(coll, &TransientVectorType)) {
+        PyObject *args = PyTuple_Pack(2, key, val);
+        if (!args) return NULL;
+        PyObject *result = TransientVector_assoc_mut((TransientVector *)coll, args);
+        Py_DECREF(args);
+        return result;
+    }
+    if (coll == Py_None) {
+        // A missing level becomes a map, whatever the key
+        return Map_assoc_impl(EMPTY_MAP, key, -1, val);
+    }
+    if (PyDict_Check(coll)) {
+        PyObject *copy = PyDict_Copy(coll);
+        if (copy && PyDict_SetItem(copy, key, val) < 0) Py_CLEAR(copy);
+        return copy;
+    }
 
-    Py_INCREF(self);
-    return (PyObject *)self;
+    PyObject *result = PyObject_CallMethod(coll, "assoc", "OO", key, val);
+    if (!result && PyErr_ExceptionMatches(PyExc_AttributeError)) {
+        PyErr_Clear();
+        PyErr_Format(PyExc_TypeError, "Don't know how to assoc onto %.200s", Py_TYPE(coll)->tp_name);
+    }
+    return result;
 }
 
-static PyObject *TransientSortedVector_disj_mut(TransientSortedVector *self, PyObject *value) {
-    TransientSortedVector_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+// coll without key, or coll itself when it does not hold key
+static PyObject *path_dissoc(PyObject *coll, PyObject *key) {
+    if (PyObject_TypeCheck(coll, &MapType)) {
+        return Map_dissoc((Map *)coll, key);
+    }
+    if (PyObject_TypeCheck(coll, &TransientMapType)) {
+        return TransientMap_dissoc_mut((TransientMap *)coll, key);
+    }
+    if (coll == Py_None) {
+        Py_RETURN_NONE;
+    }
+    if (PyDict_Check(coll)) {
+        int present = PyDict_Contains(coll, key);
+        if (present <= 0) {
+            if (present < 0) return NULL;
+            Py_INCREF(coll);
+            return coll;
+        }
+        PyObject *copy = PyDict_Copy(coll);
+        if (copy && PyDict_DelItem(copy, key) < 0) Py_CLEAR(copy);
+        return copy;
+    }
 
-    if (self->cnt == 0) {
-        Py_INCREF(self);
-        return (PyObject *)self;
+    PyObject *result = PyObject_CallMethod(coll, "dissoc", "O", key);
+    if (!result && PyErr_ExceptionMatches(PyExc_AttributeError)) {
+        PyErr_Clear();
+        PyErr_Format(PyExc_TypeError, "Don't know how to dissoc from %.200s", Py_TYPE(coll)->tp_name);
     }
+    return result;
+}
 
-    PyObject *sort_key = TransientSortedVector_get_sort_key(self, value);
-    if (!sort_key) return NULL;
+enum { PATH_ASSOC, PATH_UPDATE, PATH_DISSOC };
 
-    int deleted = 0;
-    RBNode *new_root = RBNode_delete(self->root, sort_key, value, self->reverse, &deleted, self->id);
-    Py_DECREF(sort_key);
+// coll with the value at path[i:] set to arg (PATH_ASSOC), replaced by
+// arg(value, *extra) (PATH_UPDATE) or removed (PATH_DISSOC). Missing levels
+// are created as maps, except by PATH_DISSOC, which leaves coll as it is.
+static PyObject *path_edit(PyObject *coll, PathKeys *p, Py_ssize_t i, int op, PyObject *arg, PyObject *extra) {
+    PyObject *key = PathKeys_get(p, i);
+    int last = i == p->n - 1;
+
+    if (op == PATH_DISSOC && last) {
+        return path_dissoc(coll, key);
+    }
 
-    if (self->root && !new_root && PyErr_Occurred()) return NULL;
+    Py_hash_t h;
+    PyObject *old = path_lookup(coll, key, &h);
+    if (!old) return NULL;
+    PyObject *cur = old == _MISSING ? Py_None : old;
 
-    if (deleted) {
-        if (new_root && new_root->color == RB_RED) {
-            new_root->color = RB_BLACK;
+    PyObject *val;
+    if (!last) {
+        if (op == PATH_DISSOC && cur == Py_None) {
+            Py_DECREF(old);
+            Py_INCREF(coll);
+            return coll;
         }
-        Py_XDECREF(self->root);
-        self->root = new_root;
-        self->cnt--;
+        if (Py_EnterRecursiveCall(" while walking a path")) {
+            Py_DECREF(old);
+            return NULL;
+        }
+        val = path_edit(cur, p, i + 1, op, arg, extra);
+        Py_LeaveRecursiveCall();
+    } else if (op == PATH_ASSOC) {
+        val = arg;
+        Py_INCREF(val);
+    } else if (PyTuple_GET_SIZE(extra) == 0) {
+        val = PyObject_CallOneArg(arg, cur);
     } else {
-        Py_XDECREF(new_root);
+        PyObject *call_args = PyTuple_New(PyTuple_GET_SIZE(extra) + 1);
+        if (!call_args) {
+            Py_DECREF(old);
+            return NULL;
+        }
+        Py_INCREF(cur);
+        PyTuple_SET_ITEM(call_args, 0, cur);
+        for (Py_ssize_t j = 0; j < PyTuple_GET_SIZE(extra); j++) {
+            PyObject *x = PyTuple_GET_ITEM(extra, j);
+            Py_INCREF(x);
+            PyTuple_SET_ITEM(call_args, j + 1, x);
+        }
+        val = PyObject_Call(arg, call_args, NULL);
+        Py_DECREF(call_args);
     }
 
-    Py_INCREF(self);
-    return (PyObject *)self;
+    if (!val || val == old) {
+        // An error, or the level already holds val (a transient below was edited in place)
+        Py_DECREF(old);
+        if (!val) return NULL;
+        Py_DECREF(val);
+        Py_INCREF(coll);
+        return coll;
+    }
+    Py_DECREF(old);
+
+    PyObject *result = path_assoc(coll, key, h, val);
+    Py_DECREF(val);
+    return result;
 }
 
-static PyObject *TransientSortedVector_persistent(TransientSortedVector *self, PyObject *Py_UNUSED(ignored)) {
-    TransientSortedVector_ensure_editable(self);
-    if (PyErr_Occurred()) return NULL;
+static PyObject *path_edit_all(PyObject *coll, PyObject *path, int op, PyObject *arg, PyObject *extra, const char *fname) {
+    PathKeys p;
+    if (PathKeys_init(&p, path) < 0) return NULL;
+    PyObject *result = NULL;
+    if (p.n == 0) {
+        PyErr_Format(PyExc_ValueError, "%s requires a non-empty path", fname);
+    } else {
+        result = path_edit(coll, &p, 0, op, arg, extra);
+    }
+    Py_XDECREF(p.seq);
+    return result;
+}
 
-    SortedVector *result = PyObject_New(SortedVector, &SortedVectorType);
-    if (!result) return NULL;
+/* get_in(coll, path, default=None) - the value at the end of path, or default
+   when some key along it is missing */
+static PyObject *pds_get_in(PyObject *self, PyObject *args) {
+    PyObject *coll, *path, *default_val = Py_None;
+    if (!PyArg_ParseTuple(args, "OO|O:get_in", &coll, &path, &default_val)) {
+        return NULL;
+    }
 
-    result->root = self->root;
-    Py_XINCREF(result->root);
-    result->cnt = self->cnt;
-    result->key_fn = self->key_fn;
-    Py_XINCREF(result->key_fn);
-    result->reverse = self->reverse;
+    PathKeys p;
+    if (PathKeys_init(&p, path) < 0) return NULL;
 
-    // Invalidate transient
-    Py_CLEAR(self->id);
+    Py_INCREF(coll);
+    for (Py_ssize_t i = 0; i < p.n && coll != NULL; i++) {
+        Py_hash_t h;
+        PyObject *next = path_lookup(coll, PathKeys_get(&p, i), &h);
+        Py_DECREF(coll);
+        coll = next;
+        if (coll == _MISSING) {
+            Py_DECREF(coll);
+            Py_INCREF(default_val);
+            coll = default_val;
+            break;
+        }
+    }
+    Py_XDECREF(p.seq);
+    return coll;
+}
 
-    return (PyObject *)result;
+/* assoc_in(coll, path, val) - coll with the value at path set to val,
+   creating missing levels as maps */
+static PyObject *pds_assoc_in(PyObject *self, PyObject *args) {
+    PyObject *coll, *path, *val;
+    if (!PyArg_ParseTuple(args, "OOO:assoc_in", &coll, &path, &val)) {
+        return NULL;
+    }
+    return path_edit_all(coll, path, PATH_ASSOC, val, NULL, "assoc_in");
 }
 
-static Py_ssize_t TransientSortedVector_length(TransientSortedVector *self) {
-    return self->cnt;
+/* update_in(coll, path, f, *args) - coll with the value at path replaced by
+   f(value, *args); a missing value is passed as None */
+static PyObject *pds_update_in(PyObject *self, PyObject *args) {
+    if (PyTuple_GET_SIZE(args) < 3) {
+        PyErr_SetString(PyExc_TypeError, "update_in expects (coll, path, f, *args)");
+        return NULL;
+    }
+    PyObject *extra = PyTuple_GetSlice(args, 3, PyTuple_GET_SIZE(args));
+    if (!extra) return NULL;
+    PyObject *result = path_edit_all(PyTuple_GET_ITEM(args, 0), PyTuple_GET_ITEM(args, 1), PATH_UPDATE,
+                                     PyTuple_GET_ITEM(args, 2), extra, "update_in");
+    Py_DECREF(extra);
+    return result;
 }
 
-static PyMethodDef TransientSortedVector_methods[] = {
-    {"conj_mut", (PyCFunction)TransientSortedVector_conj_mut, METH_O, "Mutably add element"},
-    {"disj_mut", (PyCFunction)TransientSortedVector_disj_mut, METH_O, "Mutably remove element"},
-    {"persistent", (PyCFunction)TransientSortedVector_persistent, METH_NOARGS, "Return persistent sorted vector"},
-    {NULL}
-};
+/* dissoc_in(coll, path) - coll without the last key of path in the map it
+   leads to; coll itself when the path is not there */
+static PyObject *pds_dissoc_in(PyObject *self, PyObject *args) {
+    PyObject *coll, *path;
+    if (!PyArg_ParseTuple(args, "OO:dissoc_in", &coll, &path)) {
+        return NULL;
+    }
+    return path_edit_all(coll, path, PATH_DISSOC, NULL, NULL, "dissoc_in");
+}
 
-static PySequenceMethods TransientSortedVector_as_sequence = {
-    .sq_length = (lenfunc)TransientSortedVector_length,
-};
+// =============================================================================
+// PARALLEL FOLD
+// =============================================================================
+// fold(coll, reducef, combinef, chunk=512) cuts a vector, map or set into
+// pieces of about `chunk` elements along its trie: index ranges for vectors,
+// subtrees (and runs of keys stored inline in a split node) for maps and
+// sets. Each piece is reduced with reducef starting from combinef(), and
+// the partial results are joined in order with combinef(left, right).
+//
+// The tries are immutable, so on free-threaded builds with the GIL disabled
+// the pieces run on a shared thread pool. Otherwise, and for folds started
+// from inside a fold worker (which would otherwise wait on their own pool),
+// the pieces run one after another on the calling thread.
 
-static PyTypeObject TransientSortedVectorType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.TransientSortedVector",
-    .tp_doc = "Transient sorted vector for batch operations",
-    .tp_basicsize = sizeof(TransientSortedVector),
-    .tp_dealloc = (destructor)TransientSortedVector_dealloc,
-    .tp_as_sequence = &TransientSortedVector_as_sequence,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_methods = TransientSortedVector_methods,
-};
+#define FOLD_DEFAULT_CHUNK 512
 
-// === SortedVector methods table ===
+static PDS_THREAD_LOCAL int fold_in_worker = 0;
+static PyObject *FOLD_POOL = NULL;
+#ifdef Py_GIL_DISABLED
+static PyMutex FOLD_POOL_LOCK;
+#endif
 
-static PyObject *SortedVector_reduce(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
-    // Convert SortedVector to a tuple for the iterable argument
-    PyObject *contents = PySequence_Tuple((PyObject *)self);
-    if (contents == NULL) {
-        return NULL;
+static int Vector_reduce_range(Vector *self, Py_ssize_t i, Py_ssize_t stop,
+                               PyObject *f, PyObject **acc) {
+    Py_ssize_t tail_off = Vector_tail_off(self);
+    while (i < stop && i < tail_off) {
+        Py_ssize_t start, len;
+        VectorNode *leaf = VectorTrie_leaf_for(self->root, self->shift, i, &start, &len);
+        Py_ssize_t end = start + len < stop ? start + len : stop;
+        for (; i < end; i++) {
+            if (reduce_step(f, acc, leaf->array[i - start]) < 0) return -1;
+        }
     }
+    for (; i < stop; i++) {
+        if (reduce_step(f, acc, PyTuple_GET_ITEM(self->tail, i - tail_off)) < 0) return -1;
+    }
+    return 0;
+}
 
-    // Build args tuple: (contents_tuple,)
-    PyObject *args = PyTuple_Pack(1, contents);
-    Py_DECREF(contents);
-    if (args == NULL) {
-        return NULL;
+static int DoubleVector_reduce_range(DoubleVector *self, Py_ssize_t i, Py_ssize_t stop,
+                                     PyObject *f, PyObject **acc) {
+    while (i < stop) {
+        double *arr = DoubleVector_array_for(self, i);
+        if (!arr) return -1;
+        Py_ssize_t end = (i | MASK) + 1 < stop ? (i | MASK) + 1 : stop;
+        for (; i < end; i++) {
+            PyObject *item = PyFloat_FromDouble(arr[i & MASK]);
+            if (!item) return -1;
+            int rc = reduce_step(f, acc, item);
+            Py_DECREF(item);
+            if (rc < 0) return -1;
+        }
     }
+    return 0;
+}
 
-    // Build kwargs dict with key and reverse
-    PyObject *kwargs = PyDict_New();
-    if (kwargs == NULL) {
-        Py_DECREF(args);
-        return NULL;
+static int IntVector_reduce_range(IntVector *self, Py_ssize_t i, Py_ssize_t stop,
+                                  PyObject *f, PyObject **acc) {
+    while (i < stop) {
+        int64_t *arr = IntVector_array_for(self, i);
+        if (!arr) return -1;
+        Py_ssize_t end = (i | MASK) + 1 < stop ? (i | MASK) + 1 : stop;
+        for (; i < end; i++) {
+            PyObject *item = PyLong_FromLongLong(arr[i & MASK]);
+            if (!item) return -1;
+            int rc = reduce_step(f, acc, item);
+            Py_DECREF(item);
+            if (rc < 0) return -1;
+        }
     }
+    return 0;
+}
 
-    // Add key function if present
-    if (self->key_fn != NULL) {
-        if (PyDict_SetItemString(kwargs, "key", self->key_fn) < 0) {
-            Py_DECREF(args);
-            Py_DECREF(kwargs);
-            return NULL;
+// Pieces are (vector, start, stop), (node,) or (tuple_of_keys,)
+static int fold_add_piece(PyObject *pieces, PyObject *obj, Py_ssize_t start, Py_ssize_t stop) {
+    PyObject *piece = stop < 0 ? PyTuple_Pack(1, obj) : Py_BuildValue("(Onn)", obj, start, stop);
+    if (!piece) return -1;
+    int rc = PyList_Append(pieces, piece);
+    Py_DECREF(piece);
+    return rc;
+}
+
+static int fold_flush_keys(PyObject *pieces, PyObject *run) {
+    if (PyList_GET_SIZE(run) == 0) return 0;
+    PyObject *keys = PyList_AsTuple(run);
+    if (!keys) return -1;
+    int rc = fold_add_piece(pieces, keys, 0, -1);
+    Py_DECREF(keys);
+    if (rc == 0) rc = PyList_SetSlice(run, 0, PyList_GET_SIZE(run), NULL);
+    return rc;
+}
+
+static int fold_split_node(PyObject *node, Py_ssize_t chunk, PyObject *pieces) {
+    if (MapNode_count(node) <= chunk || PyObject_TypeCheck(node, &HashCollisionNodeType) || is_array_map(node)) {
+        return fold_add_piece(pieces, node, 0, -1);
+    }
+    if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL && fold_split_node(an->array[i], chunk, pieces) < 0) return -1;
         }
+        return 0;
     }
 
-    // Add reverse if True
-    if (self->reverse) {
-        if (PyDict_SetItemString(kwargs, "reverse", Py_True) < 0) {
-            Py_DECREF(args);
-            Py_DECREF(kwargs);
-            return NULL;
+    // Inline keys between subtrees are gathered into runs, keeping key order
+    BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+    PyObject *run = PyList_New(0);
+    if (!run) return -1;
+    for (Py_ssize_t i = 0; i < Py_SIZE(bin); i += 2) {
+        if (bin->array[i] != NULL) {
+            if (PyList_Append(run, bin->array[i]) < 0) goto error;
+        } else if (bin->array[i + 1] != NULL) {
+            if (fold_flush_keys(pieces, run) < 0) goto error;
+            if (fold_split_node(bin->array[i + 1], chunk, pieces) < 0) goto error;
         }
     }
+    if (fold_flush_keys(pieces, run) < 0) goto error;
+    Py_DECREF(run);
+    return 0;
 
-    // Get functools.partial to create a callable with kwargs
-    PyObject *functools = PyImport_ImportModule("functools");
-    if (functools == NULL) {
-        Py_DECREF(args);
-        Py_DECREF(kwargs);
-        return NULL;
+error:
+    Py_DECREF(run);
+    return -1;
+}
+
+// Split coll into a list of pieces, or return Py_None if it is not a trie
+static PyObject *fold_pieces(PyObject *coll, Py_ssize_t chunk) {
+    Py_ssize_t cnt;
+    PyObject *root = NULL;
+
+    if (PyObject_TypeCheck(coll, &VectorType)) {
+        cnt = ((Vector *)coll)->cnt;
+    } else if (PyObject_TypeCheck(coll, &DoubleVectorType)) {
+        cnt = ((DoubleVector *)coll)->cnt;
+    } else if (PyObject_TypeCheck(coll, &IntVectorType)) {
+        cnt = ((IntVector *)coll)->cnt;
+    } else if (PyObject_TypeCheck(coll, &MapType)) {
+        cnt = ((Map *)coll)->cnt;
+        root = ((Map *)coll)->root;
+    } else if (PyObject_TypeCheck(coll, &SetType)) {
+        cnt = ((Set *)coll)->cnt;
+        root = ((Set *)coll)->root;
+    } else {
+        Py_RETURN_NONE;
     }
 
-    PyObject *partial = PyObject_GetAttrString(functools, "partial");
-    Py_DECREF(functools);
-    if (partial == NULL) {
-        Py_DECREF(args);
-        Py_DECREF(kwargs);
-        return NULL;
+    PyObject *pieces = PyList_New(0);
+    if (!pieces || cnt == 0) return pieces;
+
+    if (root != NULL) {
+        if (fold_split_node(root, chunk, pieces) < 0) goto error;
+        return pieces;
     }
 
-    // Create partial(SortedVector, **kwargs)
-    PyObject *partial_args = PyTuple_Pack(1, (PyObject *)Py_TYPE(self));
-    if (partial_args == NULL) {
-        Py_DECREF(partial);
-        Py_DECREF(args);
-        Py_DECREF(kwargs);
-        return NULL;
+    // Vector ranges start on leaf boundaries where the trie is regular
+    Py_ssize_t step = chunk < WIDTH ? WIDTH : (chunk + MASK) & ~(Py_ssize_t)MASK;
+    for (Py_ssize_t start = 0; start < cnt; start += step) {
+        Py_ssize_t stop = cnt - start < step ? cnt : start + step;
+        if (fold_add_piece(pieces, coll, start, stop) < 0) goto error;
     }
+    return pieces;
 
-    PyObject *reconstructor = PyObject_Call(partial, partial_args, kwargs);
-    Py_DECREF(partial);
-    Py_DECREF(partial_args);
-    Py_DECREF(kwargs);
+error:
+    Py_DECREF(pieces);
+    return NULL;
+}
 
-    if (reconstructor == NULL) {
-        Py_DECREF(args);
+// Reduce one piece; takes ownership of init
+static PyObject *fold_run_piece(PyObject *piece, PyObject *f, PyObject *init) {
+    PyObject *acc = init;
+    PyObject *obj = PyTuple_GET_ITEM(piece, 0);
+    int rc;
+
+    if (PyTuple_GET_SIZE(piece) == 3) {
+        Py_ssize_t start = PyLong_AsSsize_t(PyTuple_GET_ITEM(piece, 1));
+        Py_ssize_t stop = PyLong_AsSsize_t(PyTuple_GET_ITEM(piece, 2));
+        if (PyObject_TypeCheck(obj, &VectorType)) {
+            rc = Vector_reduce_range((Vector *)obj, start, stop, f, &acc);
+        } else if (PyObject_TypeCheck(obj, &DoubleVectorType)) {
+            rc = DoubleVector_reduce_range((DoubleVector *)obj, start, stop, f, &acc);
+        } else {
+            rc = IntVector_reduce_range((IntVector *)obj, start, stop, f, &acc);
+        }
+    } else if (PyTuple_Check(obj)) {
+        rc = 0;
+        for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(obj) && rc == 0; i++) {
+            rc = reduce_step(f, &acc, PyTuple_GET_ITEM(obj, i));
+        }
+    } else {
+        rc = MapNode_reduce_keys(obj, f, &acc);
+    }
+
+    if (rc < 0) {
+        Py_XDECREF(acc);
         return NULL;
     }
+    return acc;
+}
 
-    // Return (partial(SortedVector, **kwargs), (contents_tuple,))
-    PyObject *result = PyTuple_Pack(2, reconstructor, args);
-    Py_DECREF(reconstructor);
-    Py_DECREF(args);
+// Pool task: self is (piece, reducef, init)
+static PyObject *fold_task(PyObject *task, PyObject *Py_UNUSED(ignored)) {
+    PyObject *init = PyTuple_GET_ITEM(task, 2);
+    Py_INCREF(init);
+    fold_in_worker = 1;
+    PyObject *result = fold_run_piece(PyTuple_GET_ITEM(task, 0), PyTuple_GET_ITEM(task, 1), init);
+    fold_in_worker = 0;
     return result;
 }
 
-static PyObject *SortedVector_getnewargs_ex(SortedVector *self, PyObject *Py_UNUSED(ignored)) {
-    // Convert SortedVector to a tuple for the iterable argument
-    PyObject *contents = PySequence_Tuple((PyObject *)self);
-    if (contents == NULL) {
-        return NULL;
-    }
+static PyMethodDef fold_task_def = {"_fold_task", (PyCFunction)fold_task, METH_NOARGS, NULL};
 
-    // Build args tuple: (contents_tuple,)
-    PyObject *args = PyTuple_Pack(1, contents);
-    Py_DECREF(contents);
-    if (args == NULL) {
-        return NULL;
+static int fold_parallel_enabled(void) {
+#ifdef Py_GIL_DISABLED
+    if (fold_in_worker) return 0;
+    PyObject *is_gil_enabled = PySys_GetObject("_is_gil_enabled");
+    if (!is_gil_enabled) return 0;
+    PyObject *r = PyObject_CallNoArgs(is_gil_enabled);
+    if (!r) {
+        PyErr_Clear();
+        return 0;
     }
+    int enabled = PyObject_IsTrue(r);
+    Py_DECREF(r);
+    return enabled == 0;
+#else
+    return 0;
+#endif
+}
 
-    // Build kwargs dict with key and reverse
-    PyObject *kwargs = PyDict_New();
-    if (kwargs == NULL) {
-        Py_DECREF(args);
-        return NULL;
+// Borrowed reference to the shared ThreadPoolExecutor, created on first use
+static PyObject *fold_pool(void) {
+#ifdef Py_GIL_DISABLED
+    PyMutex_Lock(&FOLD_POOL_LOCK);
+#endif
+    if (FOLD_POOL == NULL) {
+        PyObject *futures = PyImport_ImportModule("concurrent.futures");
+        if (futures) {
+            PyObject *cls = PyObject_GetAttrString(futures, "ThreadPoolExecutor");
+            Py_DECREF(futures);
+            if (cls) {
+                PyObject *kwargs = Py_BuildValue("{s:s}", "thread_name_prefix", "pds-fold");
+                if (kwargs) {
+                    PyObject *noargs = PyTuple_New(0);
+                    if (noargs) {
+                        FOLD_POOL = PyObject_Call(cls, noargs, kwargs);
+                        Py_DECREF(noargs);
+                    }
+                    Py_DECREF(kwargs);
+                }
+                Py_DECREF(cls);
+            }
+        }
     }
+    PyObject *pool = FOLD_POOL;
+#ifdef Py_GIL_DISABLED
+    PyMutex_Unlock(&FOLD_POOL_LOCK);
+#endif
+    return pool;
+}
 
-    // Add key function if present
-    if (self->key_fn != NULL) {
-        if (PyDict_SetItemString(kwargs, "key", self->key_fn) < 0) {
-            Py_DECREF(args);
-            Py_DECREF(kwargs);
-            return NULL;
-        }
+// Submit every piece, then collect the results in order; returns a list
+static PyObject *fold_run_parallel(PyObject *pieces, PyObject *f, PyObject *inits) {
+    PyObject *pool = fold_pool();
+    if (!pool) return NULL;
+
+    Py_ssize_t n = PyList_GET_SIZE(pieces);
+    PyObject *futures = PyList_New(0);
+    PyObject *results = PyList_New(n);
+    if (!futures || !results) goto error;
+
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *task = PyTuple_Pack(3, PyList_GET_ITEM(pieces, i), f, PyList_GET_ITEM(inits, i));
+        if (!task) goto error;
+        PyObject *fn = PyCFunction_New(&fold_task_def, task);
+        Py_DECREF(task);
+        if (!fn) goto error;
+        PyObject *future = PyObject_CallMethod(pool, "submit", "O", fn);
+        Py_DECREF(fn);
+        if (!future) goto error;
+        int rc = PyList_Append(futures, future);
+        Py_DECREF(future);
+        if (rc < 0) goto error;
     }
 
-    // Add reverse if True
-    if (self->reverse) {
-        if (PyDict_SetItemString(kwargs, "reverse", Py_True) < 0) {
-            Py_DECREF(args);
-            Py_DECREF(kwargs);
-            return NULL;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *r = PyObject_CallMethod(PyList_GET_ITEM(futures, i), "result", NULL);
+        if (!r) goto error;
+        PyList_SET_ITEM(results, i, r);
+    }
+    Py_DECREF(futures);
+    return results;
+
+error:
+    // Drop work that has not started; running pieces finish on their own
+    if (futures) {
+        PyObject *type, *value, *tb;
+        PyErr_Fetch(&type, &value, &tb);
+        for (Py_ssize_t i = 0; i < PyList_GET_SIZE(futures); i++) {
+            PyObject *r = PyObject_CallMethod(PyList_GET_ITEM(futures, i), "cancel", NULL);
+            if (r) Py_DECREF(r);
+            else PyErr_Clear();
         }
+        PyErr_Restore(type, value, tb);
     }
-
-    // Return (args, kwargs) tuple
-    PyObject *result = PyTuple_Pack(2, args, kwargs);
-    Py_DECREF(args);
-    Py_DECREF(kwargs);
-    return result;
+    Py_XDECREF(futures);
+    Py_XDECREF(results);
+    return NULL;
 }
 
-static PyMethodDef SortedVector_methods[] = {
-    {"nth", (PyCFunction)SortedVector_nth, METH_VARARGS, "Get element at index"},
-    {"conj", (PyCFunction)SortedVector_conj, METH_O, "Add element maintaining sorted order"},
-    {"disj", (PyCFunction)SortedVector_disj, METH_O, "Remove element"},
-    {"first", (PyCFunction)SortedVector_first, METH_NOARGS, "Get minimum element"},
-    {"last", (PyCFunction)SortedVector_last, METH_NOARGS, "Get maximum element"},
-    {"index_of", (PyCFunction)SortedVector_index_of, METH_O, "Find index of element"},
-    {"rank", (PyCFunction)SortedVector_rank, METH_O, "Count of elements less than value"},
-    {"transient", (PyCFunction)SortedVector_transient, METH_NOARGS, "Get transient version"},
-    {"__reduce__", (PyCFunction)SortedVector_reduce, METH_NOARGS, "Pickle support"},
-    {"__getnewargs_ex__", (PyCFunction)SortedVector_getnewargs_ex, METH_NOARGS, "Pickle support with keyword args"},
-    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
-     "Return a generic alias for type annotations"},
-    {NULL}
-};
-
-static PySequenceMethods SortedVector_as_sequence = {
-    .sq_length = (lenfunc)SortedVector_length,
-    .sq_contains = (objobjproc)SortedVector_contains,
-};
-
-static PyMappingMethods SortedVector_as_mapping = {
-    .mp_length = (lenfunc)SortedVector_length,
-    .mp_subscript = (binaryfunc)SortedVector_getitem,
-};
+static PyObject *pds_fold(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"coll", "reducef", "combinef", "chunk", NULL};
+    PyObject *coll, *f, *combinef;
+    Py_ssize_t chunk = FOLD_DEFAULT_CHUNK;
 
-static PyTypeObject SortedVectorType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "spork.runtime.pds.SortedVector",
-    .tp_doc = "Persistent sorted vector (Red-Black Tree)",
-    .tp_basicsize = sizeof(SortedVector),
-    .tp_dealloc = (destructor)SortedVector_dealloc,
-    .tp_repr = (reprfunc)SortedVector_repr,
-    .tp_as_sequence = &SortedVector_as_sequence,
-    .tp_as_mapping = &SortedVector_as_mapping,
-    .tp_hash = (hashfunc)SortedVector_hash,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_iter = (getiterfunc)SortedVector_iter,
-    .tp_richcompare = (richcmpfunc)SortedVector_richcompare,
-    .tp_methods = SortedVector_methods,
-    .tp_new = SortedVector_new,
-    .tp_init = (initproc)SortedVector_init,
-};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|n:fold", kwlist, &coll, &f, &combinef, &chunk)) {
+        return NULL;
+    }
+    if (chunk < 1) {
+        PyErr_SetString(PyExc_ValueError, "fold chunk must be positive");
+        return NULL;
+    }
 
-// Empty sorted vector constant
-static SortedVector *EMPTY_SORTED_VECTOR = NULL;
+    PyObject *pieces = fold_pieces(coll, chunk);
+    if (!pieces) return NULL;
 
-// === Module-level functions ===
+    // Not a trie: a plain reduce from combinef()
+    if (pieces == Py_None) {
+        Py_DECREF(pieces);
+        PyObject *acc = PyObject_CallNoArgs(combinef);
+        if (!acc) return NULL;
+        PyObject *iter = PyObject_GetIter(coll);
+        if (!iter) {
+            Py_DECREF(acc);
+            return NULL;
+        }
+        PyObject *item;
+        while ((item = PyIter_Next(iter)) != NULL) {
+            int rc = reduce_step(f, &acc, item);
+            Py_DECREF(item);
+            if (rc < 0) break;
+        }
+        Py_DECREF(iter);
+        if (PyErr_Occurred()) {
+            Py_XDECREF(acc);
+            return NULL;
+        }
+        return acc;
+    }
 
-static PyObject *pds_cons(PyObject *self, PyObject *args) {
-    PyObject *first, *rest = Py_None;
+    Py_ssize_t n = PyList_GET_SIZE(pieces);
+    if (n == 0) {
+        Py_DECREF(pieces);
+        return PyObject_CallNoArgs(combinef);
+    }
 
-    if (!PyArg_ParseTuple(args, "O|O", &first, &rest)) {
-        return NULL;
+    // combinef() is called on this thread once per piece, so each piece gets
+    // its own (possibly mutable) seed
+    PyObject *results = NULL;
+    PyObject *inits = PyList_New(n);
+    if (!inits) goto done;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *init = PyObject_CallNoArgs(combinef);
+        if (!init) goto done;
+        PyList_SET_ITEM(inits, i, init);
     }
 
-    Cons *c = (Cons *)ConsType.tp_alloc(&ConsType, 0);
-    if (!c) return NULL;
+    if (n > 1 && fold_parallel_enabled()) {
+        results = fold_run_parallel(pieces, f, inits);
+    } else {
+        results = PyList_New(n);
+        for (Py_ssize_t i = 0; results && i < n; i++) {
+            PyObject *init = PyList_GET_ITEM(inits, i);
+            Py_INCREF(init);
+            PyObject *r = fold_run_piece(PyList_GET_ITEM(pieces, i), f, init);
+            if (!r) Py_CLEAR(results);
+            else PyList_SET_ITEM(results, i, r);
+        }
+    }
 
-    c->first = first;
-    Py_INCREF(first);
-    c->rest = rest;
-    Py_INCREF(rest);
-    c->hash = 0;
-    c->hash_computed = 0;
+done:
+    Py_DECREF(pieces);
+    Py_XDECREF(inits);
+    if (!results) return NULL;
 
-    return (PyObject *)c;
+    PyObject *acc = PyList_GET_ITEM(results, 0);
+    Py_INCREF(acc);
+    for (Py_ssize_t i = 1; i < n; i++) {
+        PyObject *call_args[2] = {acc, PyList_GET_ITEM(results, i)};
+        PyObject *joined = PyObject_Vectorcall(combinef, call_args, 2, NULL);
+        Py_DECREF(acc);
+        if (!joined) {
+            Py_DECREF(results);
+            return NULL;
+        }
+        acc = joined;
+    }
+    Py_DECREF(results);
+    return acc;
 }
 
-static PyObject *pds_vec(PyObject *self, PyObject *args) {
-    Py_ssize_t n = PyTuple_Size(args);
+// =============================================================================
+// ATOMS
+// =============================================================================
+// Atom(value) is a mutable reference that threads share, meant to hold a
+// persistent collection. deref reads it without taking a lock. swap(f, *args)
+// computes f(current, *args) and installs the result only if the atom still
+// holds current, retrying with the new current otherwise, so f may run more
+// than once and should not have side effects. Watches are called as
+// fn(key, atom, old, new) after each change, on the thread that made it.
+//
+// On free-threaded builds a deref is counted in one of two reader counters
+// while it loads the value pointer and takes a reference to it. A writer
+// that replaced a value must not drop the atom's reference to it while a
+// deref may still be between that load and its Py_INCREF: unless both
+// counters already read zero, it flips the epoch that picks the counter new
+// derefs use and waits for the old counter to drain, twice. Readers never
+// wait; writers only wait out the derefs already in flight. With the GIL no
+// Python code runs between swap's check and its store, so plain loads and
+// stores are enough.
+
+#if HAVE_STDATOMIC && defined(Py_GIL_DISABLED)
+#define PDS_ATOM_EPOCHS 1
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#define pds_yield_thread() SwitchToThread()
+#else
+#include <sched.h>
+#define pds_yield_thread() sched_yield()
+#endif
+#else
+#define PDS_ATOM_EPOCHS 0
+#endif
 
-    if (n == 0) {
-        Py_INCREF(EMPTY_VECTOR);
-        return (PyObject *)EMPTY_VECTOR;
-    }
+typedef struct {
+    PyObject_HEAD
+    PyObject *value;
+    PyObject *watches;          // dict of key -> fn, replaced rather than mutated; NULL when empty
+#if PDS_ATOM_EPOCHS
+    int epoch;                  // low bit picks the counter new derefs use
+    Py_ssize_t readers[2];      // derefs in progress, by counter
+    PyMutex sync_lock;          // lets one writer at a time flip the epoch
+#endif
+} Atom;
 
-    // Check for single iterable argument
-    if (n == 1) {
-        PyObject *arg = PyTuple_GET_ITEM(args, 0);
-        if (PyIter_Check(arg) || PyObject_TypeCheck(arg, &SortedVectorType) ||
-            (PySequence_Check(arg) && !PyUnicode_Check(arg) &&
-            !PyObject_TypeCheck(arg, &VectorType) && !PyObject_TypeCheck(arg, &MapType))) {
-            // Single iterable - expand it
-            PyObject *iter = PyObject_GetIter(arg);
-            if (!iter) {
-                PyErr_Clear();
-                // Not iterable, treat as single element
-            } else {
-                TransientVector *t = (TransientVector *)Vector_transient(EMPTY_VECTOR, NULL);
-                if (!t) {
-                    Py_DECREF(iter);
-                    return NULL;
-                }
+static PyTypeObject AtomType;
 
-                PyObject *item;
-                while ((item = PyIter_Next(iter)) != NULL) {
-                    PyObject *result = TransientVector_conj_mut(t, item);
-                    Py_DECREF(item);
-                    if (!result) {
-                        Py_DECREF(iter);
-                        Py_DECREF(t);
-                        return NULL;
-                    }
-                    Py_DECREF(result);
-                }
-                Py_DECREF(iter);
+#if PDS_ATOM_EPOCHS
+#define ATOM_VALUE(a) ((_Atomic(PyObject *) *)&(a)->value)
+#define ATOM_EPOCH(a) ((_Atomic(int) *)&(a)->epoch)
+#define ATOM_READERS(a, i) ((_Atomic(Py_ssize_t) *)&(a)->readers[i])
+#endif
 
-                if (PyErr_Occurred()) {
-                    Py_DECREF(t);
-                    return NULL;
-                }
+// New reference to the current value
+static PyObject *Atom_load(Atom *self) {
+    PyObject *v;
+#if PDS_ATOM_EPOCHS
+    int i = atomic_load(ATOM_EPOCH(self)) & 1;
+    atomic_fetch_add(ATOM_READERS(self, i), 1);
+    v = atomic_load(ATOM_VALUE(self));
+    Py_INCREF(v);
+    atomic_fetch_sub_explicit(ATOM_READERS(self, i), 1, memory_order_release);
+#elif defined(Py_GIL_DISABLED)
+    Py_BEGIN_CRITICAL_SECTION(self);
+    v = self->value;
+    Py_INCREF(v);
+    Py_END_CRITICAL_SECTION();
+#else
+    v = self->value;
+    Py_INCREF(v);
+#endif
+    return v;
+}
+
+// Install desired (whose reference passes to the atom) if the atom still
+// holds expected. On success the atom's reference to expected passes to the
+// caller, who gives it back with Atom_retire.
+static int Atom_cas(Atom *self, PyObject *expected, PyObject *desired) {
+#if PDS_ATOM_EPOCHS
+    return atomic_compare_exchange_strong(ATOM_VALUE(self), &expected, desired);
+#else
+    int done = 0;
+#ifdef Py_GIL_DISABLED
+    Py_BEGIN_CRITICAL_SECTION(self);
+#endif
+    if (self->value == expected) {
+        self->value = desired;
+        done = 1;
+    }
+#ifdef Py_GIL_DISABLED
+    Py_END_CRITICAL_SECTION();
+#endif
+    return done;
+#endif
+}
 
-                return TransientVector_persistent(t, NULL);
+// Install desired unconditionally, returning the atom's reference to the
+// value it replaced
+static PyObject *Atom_exchange(Atom *self, PyObject *desired) {
+    PyObject *old;
+#if PDS_ATOM_EPOCHS
+    old = atomic_exchange(ATOM_VALUE(self), desired);
+#else
+#ifdef Py_GIL_DISABLED
+    Py_BEGIN_CRITICAL_SECTION(self);
+#endif
+    old = self->value;
+    self->value = desired;
+#ifdef Py_GIL_DISABLED
+    Py_END_CRITICAL_SECTION();
+#endif
+#endif
+    return old;
+}
+
+// Drop the atom's reference to a value it replaced, once no deref can still
+// be about to take a reference of its own
+static void Atom_retire(Atom *self, PyObject *old) {
+#if PDS_ATOM_EPOCHS
+    if (atomic_load(ATOM_READERS(self, 0)) != 0 || atomic_load(ATOM_READERS(self, 1)) != 0) {
+        PyMutex_Lock(&self->sync_lock);
+        for (int pass = 0; pass < 2; pass++) {
+            int i = atomic_fetch_xor(ATOM_EPOCH(self), 1) & 1;
+            for (int spins = 0; atomic_load(ATOM_READERS(self, i)) != 0; spins++) {
+                if (spins >= 64) pds_yield_thread();
             }
         }
+        PyMutex_Unlock(&self->sync_lock);
     }
+#endif
+    Py_DECREF(old);
+}
 
-    // Multiple arguments or single non-iterable
-    TransientVector *t = (TransientVector *)Vector_transient(EMPTY_VECTOR, NULL);
-    if (!t) return NULL;
+// New reference to the watches dict, or NULL when there are none
+static PyObject *Atom_watches(Atom *self) {
+    PyObject *w;
+#ifdef Py_GIL_DISABLED
+    Py_BEGIN_CRITICAL_SECTION(self);
+#endif
+    w = self->watches;
+    Py_XINCREF(w);
+#ifdef Py_GIL_DISABLED
+    Py_END_CRITICAL_SECTION();
+#endif
+    return w;
+}
+
+// Replace the watches with a copy that maps key to fn (or drops key when fn
+// is NULL), retrying if another thread changed them meanwhile
+static int Atom_update_watches(Atom *self, PyObject *key, PyObject *fn) {
+    for (;;) {
+        PyObject *seen = Atom_watches(self);
+        PyObject *updated = seen ? PyDict_Copy(seen) : PyDict_New();
+        int rc = updated ? 0 : -1;
+        if (rc == 0) {
+            if (fn) {
+                rc = PyDict_SetItem(updated, key, fn);
+            } else if (PyDict_DelItem(updated, key) < 0) {
+                if (PyErr_ExceptionMatches(PyExc_KeyError)) {
+                    PyErr_Clear();
+                } else {
+                    rc = -1;
+                }
+            }
+        }
+        if (rc == 0 && PyDict_GET_SIZE(updated) == 0) Py_CLEAR(updated);
 
-    for (Py_ssize_t i = 0; i < n; i++) {
-        PyObject *item = PyTuple_GET_ITEM(args, i);
-        PyObject *result = TransientVector_conj_mut(t, item);
-        if (!result) {
-            Py_DECREF(t);
-            return NULL;
+        int installed = 0;
+        if (rc == 0) {
+#ifdef Py_GIL_DISABLED
+            Py_BEGIN_CRITICAL_SECTION(self);
+#endif
+            if (self->watches == seen) {
+                PyObject *prev = self->watches;
+                self->watches = updated;
+                updated = prev;
+                installed = 1;
+            }
+#ifdef Py_GIL_DISABLED
+            Py_END_CRITICAL_SECTION();
+#endif
+        }
+        Py_XDECREF(updated);
+        Py_XDECREF(seen);
+        if (rc < 0 || installed) return rc;
+    }
+}
+
+static int Atom_notify(Atom *self, PyObject *old, PyObject *new) {
+    PyObject *watches = Atom_watches(self);
+    if (!watches) return 0;
+    Py_ssize_t pos = 0;
+    PyObject *key, *fn;
+    int rc = 0;
+    while (PyDict_Next(watches, &pos, &key, &fn)) {
+        PyObject *r = PyObject_CallFunctionObjArgs(fn, key, (PyObject *)self, old, new, NULL);
+        if (!r) {
+            rc = -1;
+            break;
         }
-        Py_DECREF(result);
+        Py_DECREF(r);
     }
-
-    return TransientVector_persistent(t, NULL);
+    Py_DECREF(watches);
+    return rc;
 }
 
-static PyObject *pds_set(PyObject *self, PyObject *args) {
-    PyObject *iterable = NULL;
-
-    if (!PyArg_ParseTuple(args, "|O", &iterable)) {
+static PyObject *Atom_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"value", NULL};
+    PyObject *value = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:Atom", kwlist, &value)) {
         return NULL;
     }
+    Atom *self = (Atom *)type->tp_alloc(type, 0);
+    if (!self) return NULL;
+    Py_INCREF(value);
+    self->value = value;
+    return (PyObject *)self;
+}
 
-    if (iterable == NULL) {
-        Py_INCREF(EMPTY_SET);
-        return (PyObject *)EMPTY_SET;
+static int Atom_traverse(Atom *self, visitproc visit, void *arg) {
+    Py_VISIT(self->value);
+    Py_VISIT(self->watches);
+    return 0;
+}
+
+// The value is replaced by None rather than cleared, so a deref from a
+// finalizer running during collection still finds something to return
+static int Atom_clear(Atom *self) {
+    Py_CLEAR(self->watches);
+    if (self->value != Py_None) {
+        PyObject *old = self->value;
+        Py_INCREF(Py_None);
+        self->value = Py_None;
+        Py_DECREF(old);
     }
+    return 0;
+}
 
-    PyObject *iter = PyObject_GetIter(iterable);
-    if (!iter) return NULL;
+static void Atom_dealloc(Atom *self) {
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(self->value);
+    Py_XDECREF(self->watches);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
 
-    // Use transient for efficient building
-    TransientSet *t = PyObject_New(TransientSet, &TransientSetType);
-    if (!t) {
-        Py_DECREF(iter);
-        return NULL;
-    }
+static PyObject *Atom_repr(Atom *self) {
+    int rc = Py_ReprEnter((PyObject *)self);
+    if (rc != 0) return rc > 0 ? PyUnicode_FromString("<Atom ...>") : NULL;
+    PyObject *value = Atom_load(self);
+    PyObject *r = PyUnicode_FromFormat("<Atom %R>", value);
+    Py_DECREF(value);
+    Py_ReprLeave((PyObject *)self);
+    return r;
+}
 
-    t->id = PyObject_New(PyObject, &PdsSentinelType);
-    if (!t->id) {
-        Py_DECREF(t);
-        Py_DECREF(iter);
+static PyObject *Atom_deref(Atom *self, PyObject *Py_UNUSED(ignored)) {
+    return Atom_load(self);
+}
+
+static PyObject *Atom_reset(Atom *self, PyObject *value) {
+    Py_INCREF(value);
+    PyObject *old = Atom_exchange(self, value);
+    int rc = Atom_notify(self, old, value);
+    Atom_retire(self, old);
+    if (rc < 0) return NULL;
+    Py_INCREF(value);
+    return value;
+}
+
+static PyObject *Atom_swap(Atom *self, PyObject *args) {
+    Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    if (nargs < 1) {
+        PyErr_SetString(PyExc_TypeError, "swap expected at least 1 argument (f)");
         return NULL;
     }
+    PyObject *f = PyTuple_GET_ITEM(args, 0);
 
-    t->cnt = 0;
-    t->root = NULL;
+    // f is called with the current value in place of f itself
+    PyObject *small[8];
+    PyObject **stack = small;
+    if (nargs > 8) {
+        stack = PyMem_Malloc(nargs * sizeof(PyObject *));
+        if (!stack) return PyErr_NoMemory();
+    }
+    for (Py_ssize_t i = 1; i < nargs; i++) {
+        stack[i] = PyTuple_GET_ITEM(args, i);
+    }
 
-    PyObject *key;
-    while ((key = PyIter_Next(iter)) != NULL) {
-        PyObject *result = TransientSet_conj_mut(t, key);
-        Py_DECREF(key);
-        if (!result) {
-            Py_DECREF(t);
-            Py_DECREF(iter);
-            return NULL;
+    PyObject *result = NULL;
+    for (;;) {
+        PyObject *old = Atom_load(self);
+        stack[0] = old;
+        PyObject *new = PyObject_Vectorcall(f, stack, nargs, NULL);
+        if (!new) {
+            Py_DECREF(old);
+            break;
         }
-        Py_DECREF(result);
+        Py_INCREF(new);
+        if (Atom_cas(self, old, new)) {
+            int rc = Atom_notify(self, old, new);
+            Atom_retire(self, old);
+            Py_DECREF(old);
+            if (rc < 0) {
+                Py_DECREF(new);
+            } else {
+                result = new;
+            }
+            break;
+        }
+        Py_DECREF(new);
+        Py_DECREF(new);
+        Py_DECREF(old);
     }
-    Py_DECREF(iter);
+    if (stack != small) PyMem_Free(stack);
+    return result;
+}
 
-    if (PyErr_Occurred()) {
-        Py_DECREF(t);
+static PyObject *Atom_compare_and_set(Atom *self, PyObject *args) {
+    PyObject *old, *new;
+    if (!PyArg_ParseTuple(args, "OO:compare_and_set", &old, &new)) {
         return NULL;
     }
-
-    PyObject *result = TransientSet_persistent(t, NULL);
-    Py_DECREF(t);
-    return result;
+    Py_INCREF(new);
+    if (!Atom_cas(self, old, new)) {
+        Py_DECREF(new);
+        Py_RETURN_FALSE;
+    }
+    int rc = Atom_notify(self, old, new);
+    Atom_retire(self, old);
+    if (rc < 0) return NULL;
+    Py_RETURN_TRUE;
 }
 
-static PyObject *pds_hash_map(PyObject *self, PyObject *args) {
-    Py_ssize_t n = PyTuple_Size(args);
-
-    if (n % 2 != 0) {
-        PyErr_SetString(PyExc_ValueError, "hash_map requires an even number of arguments");
+static PyObject *Atom_add_watch(Atom *self, PyObject *args) {
+    PyObject *key, *fn;
+    if (!PyArg_ParseTuple(args, "OO:add_watch", &key, &fn)) {
         return NULL;
     }
-
-    if (n == 0) {
-        Py_INCREF(EMPTY_MAP);
-        return (PyObject *)EMPTY_MAP;
+    if (!PyCallable_Check(fn)) {
+        PyErr_SetString(PyExc_TypeError, "watch must be callable");
+        return NULL;
     }
+    if (Atom_update_watches(self, key, fn) < 0) return NULL;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
 
-    TransientMap *t = (TransientMap *)Map_transient(EMPTY_MAP, NULL);
-    if (!t) return NULL;
+static PyObject *Atom_remove_watch(Atom *self, PyObject *key) {
+    if (Atom_update_watches(self, key, NULL) < 0) return NULL;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
 
-    for (Py_ssize_t i = 0; i < n; i += 2) {
-        PyObject *key = PyTuple_GET_ITEM(args, i);
-        PyObject *val = PyTuple_GET_ITEM(args, i + 1);
+static PyMethodDef Atom_methods[] = {
+    {"deref", (PyCFunction)Atom_deref, METH_NOARGS, "Return the current value"},
+    {"reset", (PyCFunction)Atom_reset, METH_O, "Set the value, returning it"},
+    {"swap", (PyCFunction)Atom_swap, METH_VARARGS,
+     "Set the value to f(current, *args), retrying if another thread changed it first; returns the new value"},
+    {"compare_and_set", (PyCFunction)Atom_compare_and_set, METH_VARARGS,
+     "Set the value to new only if it is still old (compared by identity); returns whether it did"},
+    {"add_watch", (PyCFunction)Atom_add_watch, METH_VARARGS,
+     "Call fn(key, atom, old, new) after every change; returns the atom"},
+    {"remove_watch", (PyCFunction)Atom_remove_watch, METH_O, "Remove the watch added under key; returns the atom"},
+    {"__class_getitem__", (PyCFunction)Generic_class_getitem, METH_O | METH_CLASS,
+     "Return a generic alias for type annotations (e.g., Atom[Map])"},
+    {NULL, NULL, 0, NULL}
+};
 
-        PyObject *kv_args = PyTuple_Pack(2, key, val);
-        if (!kv_args) {
-            Py_DECREF(t);
-            return NULL;
-        }
+static PyTypeObject AtomType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "spork.runtime.pds.Atom",
+    .tp_doc = "Reference to a value shared between threads, read without locking and changed by compare-and-swap",
+    .tp_basicsize = sizeof(Atom),
+    .tp_new = Atom_new,
+    .tp_dealloc = (destructor)Atom_dealloc,
+    .tp_traverse = (traverseproc)Atom_traverse,
+    .tp_clear = (inquiry)Atom_clear,
+    .tp_free = PyObject_GC_Del,
+    .tp_repr = (reprfunc)Atom_repr,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_methods = Atom_methods,
+};
 
-        PyObject *result = TransientMap_assoc_mut(t, kv_args);
-        Py_DECREF(kv_args);
-        if (!result) {
-            Py_DECREF(t);
+// =============================================================================
+// INSTRUMENTATION: stats() AND memory_report()
+// =============================================================================
+
+static int stats_put(PyObject *dict, const char *name, Py_ssize_t value) {
+    PyObject *v = PyLong_FromSsize_t(value);
+    if (!v) return -1;
+    int rc = PyDict_SetItemString(dict, name, v);
+    Py_DECREF(v);
+    return rc;
+}
+
+static PyObject *stats_per_kind(const Py_ssize_t *counts) {
+    PyObject *d = PyDict_New();
+    if (!d) return NULL;
+    for (int k = 0; k < PDS_NODE_KINDS; k++) {
+        if (stats_put(d, PDS_NODE_KIND_NAMES[k], counts[k]) < 0) {
+            Py_DECREF(d);
             return NULL;
         }
-        Py_DECREF(result);
     }
-
-    return TransientMap_persistent(t, NULL);
+    return d;
 }
 
-// =============================================================================
-// FACTORY FUNCTIONS FOR TYPE-SPECIALIZED VECTORS
-// =============================================================================
+/* stats(reset=False) - snapshot of the instrumentation counters */
+static PyObject *pds_stats_fn(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"reset", NULL};
+    int reset = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p:stats", kwlist, &reset)) {
+        return NULL;
+    }
 
-static PyObject *pds_vec_f64(PyObject *self, PyObject *args) {
-    Py_ssize_t n = PyTuple_Size(args);
+    PdsStats snap;
+#if PDS_ENABLE_STATS
+    snap = pds_stats;
+    if (reset) memset(&pds_stats, 0, sizeof(pds_stats));
+#else
+    memset(&snap, 0, sizeof(snap));
+#endif
 
-    if (n == 0) {
-        Py_INCREF(EMPTY_DOUBLE_VECTOR);
-        return (PyObject *)EMPTY_DOUBLE_VECTOR;
+    PyObject *result = PyDict_New();
+    if (!result) return NULL;
+    PyObject *allocs = stats_per_kind(snap.allocs);
+    PyObject *copies = allocs ? stats_per_kind(snap.copies) : NULL;
+    if (!copies ||
+        PyDict_SetItemString(result, "enabled", PDS_ENABLE_STATS ? Py_True : Py_False) < 0 ||
+        PyDict_SetItemString(result, "node_allocs", allocs) < 0 ||
+        PyDict_SetItemString(result, "path_copies", copies) < 0 ||
+        stats_put(result, "collision_nodes_created", snap.collisions) < 0 ||
+        stats_put(result, "flatten_calls", snap.flatten_calls) < 0 ||
+        stats_put(result, "flatten_bytes", snap.flatten_bytes) < 0) {
+        Py_XDECREF(allocs);
+        Py_XDECREF(copies);
+        Py_DECREF(result);
+        return NULL;
     }
+    Py_DECREF(allocs);
+    Py_DECREF(copies);
+    return result;
+}
 
-    // Build using transient for O(1) amortized appends
-    TransientDoubleVector *t = (TransientDoubleVector *)DoubleVector_transient(EMPTY_DOUBLE_VECTOR, NULL);
-    if (!t) return NULL;
+// Freelists reported by freelists(), by type; variable-size nodes have one
+// list per size, reported together. offset is into PdsFreeLists.
+typedef struct {
+    const char *name;
+    size_t offset;
+    int n;
+} PdsFreeListGroup;
+
+static const PdsFreeListGroup PDS_FREELIST_GROUPS[] = {
+    {"VectorNode", offsetof(PdsFreeLists, vector_node), 1},
+    {"DoubleVectorNode", offsetof(PdsFreeLists, double_node), 1},
+    {"IntVectorNode", offsetof(PdsFreeLists, int_node), 1},
+    {"BitmapIndexedNode", offsetof(PdsFreeLists, bin), PDS_BIN_FREELIST_PAIRS + 1},
+    {"ArrayNode", offsetof(PdsFreeLists, array_node), 1},
+    {"ArrayMapNode", offsetof(PdsFreeLists, array_map), PDS_ARRAY_MAP_FREELIST_PAIRS + 1},
+    {"SortedNode", offsetof(PdsFreeLists, sorted_node), 1},
+    {"Cons", offsetof(PdsFreeLists, cons), 1},
+    {"ChunkedSeq", offsetof(PdsFreeLists, chunked_seq), 1},
+    {"Vector", offsetof(PdsFreeLists, vector), 1},
+    {"Map", offsetof(PdsFreeLists, map), 1},
+    {"Set", offsetof(PdsFreeLists, set), 1},
+};
 
-    for (Py_ssize_t i = 0; i < n; i++) {
-        PyObject *item = PyTuple_GET_ITEM(args, i);
-        double val = PyFloat_AsDouble(item);
+#define PDS_FREELIST_GROUP_COUNT ((int)(sizeof(PDS_FREELIST_GROUPS) / sizeof(PDS_FREELIST_GROUPS[0])))
 
-        if (val == -1.0 && PyErr_Occurred()) {
-            Py_DECREF(t);
-            PyErr_Clear();
-            PyErr_Format(PyExc_TypeError,
-                "vec_f64 argument %zd must be a number, got %s",
-                i, Py_TYPE(item)->tp_name);
-            return NULL;
-        }
+/* freelists(reset=False) - size, hits, misses and hit rate of each freelist */
+static PyObject *pds_freelists_fn(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"reset", NULL};
+    int reset = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p:freelists", kwlist, &reset)) {
+        return NULL;
+    }
 
-        // Use raw function to avoid boxing/unboxing overhead
-        if (TransientDoubleVector_conj_mut_raw(t, val) < 0) {
-            Py_DECREF(t);
-            return NULL;
+    PyObject *result = PyDict_New();
+    PyObject *lists = result ? PyDict_New() : NULL;
+    if (!lists ||
+        PyDict_SetItemString(result, "enabled", PDS_FREELISTS ? Py_True : Py_False) < 0 ||
+        stats_put(result, "limit", PDS_FREELISTS ? PDS_SSIZE_LOAD(pds_freelist_limit) : 0) < 0 ||
+        PyDict_SetItemString(result, "lists", lists) < 0) {
+        goto error;
+    }
+
+    for (int g = 0; g < PDS_FREELIST_GROUP_COUNT; g++) {
+        const PdsFreeListGroup *group = &PDS_FREELIST_GROUPS[g];
+        PdsFreeList *fl = pds_freelist_at(group->offset);  // the calling thread's
+        Py_ssize_t size = 0, hits = 0, misses = 0;
+        for (int i = 0; fl && i < group->n; i++) {
+            size += fl[i].size;
+            hits += fl[i].hits;
+            misses += fl[i].misses;
+            if (reset) fl[i].hits = fl[i].misses = 0;
         }
-    }
+        PyObject *rate = PyFloat_FromDouble(hits + misses ? (double)hits / (double)(hits + misses) : 0.0);
+        PyObject *entry = rate ? PyDict_New() : NULL;
+        int rc = !entry ||
+            stats_put(entry, "size", size) < 0 ||
+            stats_put(entry, "hits", hits) < 0 ||
+            stats_put(entry, "misses", misses) < 0 ||
+            PyDict_SetItemString(entry, "hit_rate", rate) < 0 ||
+            PyDict_SetItemString(lists, group->name, entry) < 0;
+        Py_XDECREF(rate);
+        Py_XDECREF(entry);
+        if (rc) goto error;
+    }
+    Py_DECREF(lists);
+    return result;
 
-    return TransientDoubleVector_persistent(t, NULL);
+error:
+    Py_XDECREF(lists);
+    Py_XDECREF(result);
+    return NULL;
 }
 
-static PyObject *pds_vec_i64(PyObject *self, PyObject *args) {
-    Py_ssize_t n = PyTuple_Size(args);
-
-    if (n == 0) {
-        Py_INCREF(EMPTY_LONG_VECTOR);
-        return (PyObject *)EMPTY_LONG_VECTOR;
+/* set_freelist_limit(n) - keep at most n objects per freelist, freeing any
+   beyond that now (on free-threaded builds, other threads' surplus goes on
+   their next create); returns the previous limit */
+static PyObject *pds_set_freelist_limit(PyObject *self, PyObject *arg) {
+    Py_ssize_t limit = PyLong_AsSsize_t(arg);
+    if (limit == -1 && PyErr_Occurred()) return NULL;
+    if (limit < 0) {
+        PyErr_SetString(PyExc_ValueError, "freelist limit must be >= 0");
+        return NULL;
     }
 
-    // Build using transient for O(1) amortized appends
-    TransientIntVector *t = (TransientIntVector *)IntVector_transient(EMPTY_LONG_VECTOR, NULL);
-    if (!t) return NULL;
+    Py_ssize_t previous = PDS_SSIZE_LOAD(pds_freelist_limit);
+    PDS_SSIZE_STORE(pds_freelist_limit, limit);
+    PdsFreeLists *lists = pds_current_freelists();
+    if (lists) pds_freelists_trim(lists, limit);
+    return PyLong_FromSsize_t(previous);
+}
 
-    for (Py_ssize_t i = 0; i < n; i++) {
-        PyObject *item = PyTuple_GET_ITEM(args, i);
-        int64_t val = PyLong_AsLongLong(item);
+// Node walk for memory_report. Nodes are identified by address so that a
+// node shared by several versions is counted once per walk, and a node
+// also reachable from the other versions counts as shared.
+typedef struct {
+    PyObject *seen;    // addresses visited by this walk
+    PyObject *shared;  // addresses reachable from the other versions, or NULL
+    Py_ssize_t nodes;
+    Py_ssize_t bytes;
+    Py_ssize_t shared_nodes;
+    Py_ssize_t shared_bytes;
+    Py_ssize_t collision_nodes;
+    Py_ssize_t collision_entries;
+    int depth;
+} MemoryWalk;
+
+// Record one node; returns 1 on a first visit, 0 if already seen, -1 on error
+static int memory_visit(MemoryWalk *w, const void *node, Py_ssize_t bytes, int depth) {
+    PyObject *addr = PyLong_FromVoidPtr((void *)node);
+    if (!addr) return -1;
+    int seen = PySet_Contains(w->seen, addr);
+    if (seen != 0 || PySet_Add(w->seen, addr) < 0) {
+        Py_DECREF(addr);
+        return seen > 0 ? 0 : -1;
+    }
+    int shared = w->shared ? PySet_Contains(w->shared, addr) : 0;
+    Py_DECREF(addr);
+    if (shared < 0) return -1;
+
+    w->nodes++;
+    w->bytes += bytes;
+    if (shared) {
+        w->shared_nodes++;
+        w->shared_bytes += bytes;
+    }
+    if (depth > w->depth) w->depth = depth;
+    return 1;
+}
+
+static Py_ssize_t memory_object_bytes(PyObject *obj) {
+    return Py_TYPE(obj)->tp_basicsize + Py_SIZE(obj) * Py_TYPE(obj)->tp_itemsize;
+}
+
+static int memory_walk_vector_node(MemoryWalk *w, VectorNode *node, int level, int depth) {
+    Py_ssize_t bytes = sizeof(VectorNode) + (node->sizes ? WIDTH * (Py_ssize_t)sizeof(Py_ssize_t) : 0);
+    int rc = memory_visit(w, node, bytes, depth);
+    if (rc <= 0 || level == 0) return rc;
+    for (int i = 0; i < WIDTH && node->array[i] != NULL; i++) {
+        if (memory_walk_vector_node(w, (VectorNode *)node->array[i], level - BITS, depth + 1) < 0) return -1;
+    }
+    return 0;
+}
 
-        if (val == -1 && PyErr_Occurred()) {
-            Py_DECREF(t);
-            PyErr_Clear();
-            PyErr_Format(PyExc_TypeError,
-                "vec_i64 argument %zd must be an integer, got %s",
-                i, Py_TYPE(item)->tp_name);
-            return NULL;
+// Typed-vector nodes share one layout apart from the leaf element type
+static int memory_walk_typed_node(MemoryWalk *w, void *node, Py_ssize_t node_size, int level, int depth) {
+    int rc = memory_visit(w, node, node_size, depth);
+    if (rc <= 0 || level == 0) return rc;
+    DoubleVectorNode *n = (DoubleVectorNode *)node;
+    for (int i = 0; i < WIDTH; i++) {
+        if ((n->valid_mask & (1u << i)) && n->data.children[i] != NULL &&
+            memory_walk_typed_node(w, n->data.children[i], node_size, level - BITS, depth + 1) < 0) {
+            return -1;
         }
+    }
+    return 0;
+}
 
-        // Use raw function to avoid boxing/unboxing overhead
-        if (TransientIntVector_conj_mut_raw(t, val) < 0) {
-            Py_DECREF(t);
-            return NULL;
+static int memory_walk_map_node(MemoryWalk *w, PyObject *node, int depth) {
+    if (is_array_map(node)) {
+        Py_ssize_t bytes = offsetof(ArrayMapNode, array) + Py_SIZE(node) * (Py_ssize_t)(2 * sizeof(PyObject *) + sizeof(Py_hash_t));
+        return memory_visit(w, node, bytes, depth) < 0 ? -1 : 0;
+    }
+    if (PyObject_TypeCheck(node, &BitmapIndexedNodeType)) {
+        BitmapIndexedNode *bin = (BitmapIndexedNode *)node;
+        Py_ssize_t pairs = Py_SIZE(bin) / 2;
+        Py_ssize_t hash_bytes = pairs * (Py_ssize_t)sizeof(Py_hash_t);
+        int rc = memory_visit(w, node, memory_object_bytes(node) + hash_bytes, depth);
+        if (rc <= 0) return rc;
+        for (Py_ssize_t i = 0; i < Py_SIZE(bin); i += 2) {
+            if (bin->array[i] == NULL && bin->array[i + 1] != NULL &&
+                memory_walk_map_node(w, bin->array[i + 1], depth + 1) < 0) {
+                return -1;
+            }
         }
+        return 0;
     }
-
-    return TransientIntVector_persistent(t, NULL);
+    if (PyObject_TypeCheck(node, &ArrayNodeType)) {
+        ArrayNode *an = (ArrayNode *)node;
+        int rc = memory_visit(w, node, sizeof(ArrayNode), depth);
+        if (rc <= 0) return rc;
+        for (int i = 0; i < WIDTH; i++) {
+            if (an->array[i] != NULL && memory_walk_map_node(w, an->array[i], depth + 1) < 0) return -1;
+        }
+        return 0;
+    }
+    int rc = memory_visit(w, node, memory_object_bytes(node), depth);
+    if (rc > 0) {
+        w->collision_nodes++;
+        w->collision_entries += ((HashCollisionNode *)node)->count;
+    }
+    return rc < 0 ? -1 : 0;
 }
 
-static PyObject *pds_sorted_vec(PyObject *self, PyObject *args, PyObject *kwargs) {
-    static char *kwlist[] = {"", "key", "reverse", NULL};
-    PyObject *iterable = NULL;
-    PyObject *key_fn = Py_None;
-    int reverse = 0;
-
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O$Op", kwlist,
-                                     &iterable, &key_fn, &reverse)) {
-        return NULL;
+static int memory_walk_sorted_node(MemoryWalk *w, SortedNode *node, int depth) {
+    if (node == NULL) return 0;
+    Py_ssize_t bytes = sizeof(SortedNode) + (node->sizes ? SORTED_WIDTH * (Py_ssize_t)sizeof(Py_ssize_t) : 0);
+    int rc = memory_visit(w, node, bytes, depth);
+    if (rc <= 0 || node->leaf) return rc;
+    for (int i = 0; i < node->count; i++) {
+        if (memory_walk_sorted_node(w, (SortedNode *)node->items[i], depth + 1) < 0) return -1;
     }
+    return 0;
+}
 
-    SortedVector *sv = (SortedVector *)SortedVector_new(&SortedVectorType, NULL, NULL);
-    if (!sv) return NULL;
-
-    sv->reverse = reverse;
-    if (key_fn != Py_None) {
-        sv->key_fn = key_fn;
-        Py_INCREF(key_fn);
+static int memory_walk_int_map_node(MemoryWalk *w, IntMapNode *node, int depth) {
+    if (node == NULL) return 0;
+    int rc = memory_visit(w, node, memory_object_bytes((PyObject *)node), depth);
+    if (rc <= 0) return rc;
+    for (int j = 0; j < ctpop(node->nodemap); j++) {
+        if (memory_walk_int_map_node(w, (IntMapNode *)INTMAP_CHILD(node, j), depth + 1) < 0) return -1;
     }
+    return 0;
+}
 
-    if (iterable && iterable != Py_None) {
-        PyObject *iter = PyObject_GetIter(iterable);
-        if (!iter) {
-            Py_DECREF(sv);
-            return NULL;
-        }
-
-        PyObject *item;
-        while ((item = PyIter_Next(iter)) != NULL) {
-            PyObject *new_sv = SortedVector_conj(sv, item);
-            Py_DECREF(item);
-            if (!new_sv) {
-                Py_DECREF(iter);
-                Py_DECREF(sv);
-                return NULL;
-            }
-            Py_DECREF(sv);
-            sv = (SortedVector *)new_sv;
-        }
-        Py_DECREF(iter);
+// Walk coll's nodes; *count gets its length and *extra the bytes of
+// unshareable side allocations (typed-vector tails and flat buffers).
+// Returns -1 with TypeError set for unsupported objects.
+static int memory_walk(MemoryWalk *w, PyObject *coll, Py_ssize_t *count, Py_ssize_t *extra) {
+    *extra = 0;
+    if (PyObject_TypeCheck(coll, &VectorType)) {
+        Vector *v = (Vector *)coll;
+        *count = v->cnt;
+        if (memory_walk_vector_node(w, v->root, v->shift, 1) < 0) return -1;
+        return memory_visit(w, v->tail, memory_object_bytes(v->tail), 0) < 0 ? -1 : 0;
+    }
+    if (PyObject_TypeCheck(coll, &DoubleVectorType)) {
+        DoubleVector *v = (DoubleVector *)coll;
+        *count = v->cnt;
+        *extra = v->tail_cap * (Py_ssize_t)sizeof(double) +
+                 (v->flat_buffer_cache ? v->cnt * (Py_ssize_t)sizeof(double) : 0);
+        return memory_walk_typed_node(w, v->root, sizeof(DoubleVectorNode), v->shift, 1) < 0 ? -1 : 0;
+    }
+    if (PyObject_TypeCheck(coll, &IntVectorType)) {
+        IntVector *v = (IntVector *)coll;
+        *count = v->cnt;
+        *extra = v->tail_cap * (Py_ssize_t)sizeof(int64_t) +
+                 (v->flat_buffer_cache ? v->cnt * (Py_ssize_t)sizeof(int64_t) : 0);
+        return memory_walk_typed_node(w, v->root, sizeof(IntVectorNode), v->shift, 1) < 0 ? -1 : 0;
+    }
+    if (PyObject_TypeCheck(coll, &MapType) || PyObject_TypeCheck(coll, &SetType)) {
+        PyObject *root = PyObject_TypeCheck(coll, &MapType) ? ((Map *)coll)->root : ((Set *)coll)->root;
+        *count = PyObject_TypeCheck(coll, &MapType) ? ((Map *)coll)->cnt : ((Set *)coll)->cnt;
+        return root != NULL ? memory_walk_map_node(w, root, 1) : 0;
+    }
+    if (PyObject_TypeCheck(coll, &SortedVectorType)) {
+        SortedVector *sv = (SortedVector *)coll;
+        *count = sv->cnt;
+        return memory_walk_sorted_node(w, sv->root, 1);
+    }
+    if (PyObject_TypeCheck(coll, &IntMapType) || PyObject_TypeCheck(coll, &IntSetType)) {
+        *count = ((IntMap *)coll)->cnt;
+        return memory_walk_int_map_node(w, ((IntMap *)coll)->root, 1);
+    }
+    PyErr_Format(PyExc_TypeError,
+        "memory_report expects a persistent collection, got %s", Py_TYPE(coll)->tp_name);
+    return -1;
+}
 
-        if (PyErr_Occurred()) {
-            Py_DECREF(sv);
-            return NULL;
-        }
+/* memory_report(coll, *others) - node bytes, depth and sharing of coll */
+static PyObject *pds_memory_report(PyObject *self, PyObject *args) {
+    Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    if (nargs < 1) {
+        PyErr_SetString(PyExc_TypeError, "memory_report expects at least one collection");
+        return NULL;
     }
 
-    return (PyObject *)sv;
+    PyObject *result = NULL;
+    MemoryWalk w = {0};
+    MemoryWalk others = {0};
+    others.seen = PySet_New(NULL);
+    w.seen = PySet_New(NULL);
+    if (!others.seen || !w.seen) goto done;
+
+    Py_ssize_t count, extra;
+    for (Py_ssize_t i = 1; i < nargs; i++) {
+        if (memory_walk(&others, PyTuple_GET_ITEM(args, i), &count, &extra) < 0) goto done;
+    }
+    w.shared = nargs > 1 ? others.seen : NULL;
+    if (memory_walk(&w, PyTuple_GET_ITEM(args, 0), &count, &extra) < 0) goto done;
+
+    result = PyDict_New();
+    if (!result) goto done;
+    if (stats_put(result, "count", count) < 0 ||
+        stats_put(result, "depth", w.depth) < 0 ||
+        stats_put(result, "nodes", w.nodes) < 0 ||
+        stats_put(result, "node_bytes", w.bytes) < 0 ||
+        stats_put(result, "extra_bytes", extra) < 0 ||
+        stats_put(result, "shared_nodes", w.shared_nodes) < 0 ||
+        stats_put(result, "shared_bytes", w.shared_bytes) < 0 ||
+        stats_put(result, "collision_nodes", w.collision_nodes) < 0 ||
+        stats_put(result, "collision_entries", w.collision_entries) < 0) {
+        Py_CLEAR(result);
+    }
+
+done:
+    Py_XDECREF(others.seen);
+    Py_XDECREF(w.seen);
+    return result;
 }
 
 static PyMethodDef pds_methods[] = {
@@ -9717,6 +19913,38 @@ static PyMethodDef pds_methods[] = {
     {"hash_map", pds_hash_map, METH_VARARGS, "Create a persistent map from key-value pairs"},
     {"hash_set", pds_set, METH_VARARGS, "Create a persistent set from an iterable"},
     {"sorted_vec", (PyCFunction)pds_sorted_vec, METH_VARARGS | METH_KEYWORDS, "Create a persistent sorted vector"},
+    {"int_map", (PyCFunction)pds_int_map, METH_VARARGS, "Create a persistent map keyed by int64"},
+    {"int_set", (PyCFunction)pds_int_set, METH_VARARGS, "Create a persistent set of int64"},
+    {"get_in", pds_get_in, METH_VARARGS, "Value at the end of a path of keys, or default"},
+    {"assoc_in", pds_assoc_in, METH_VARARGS, "Set the value at the end of a path of keys"},
+    {"update_in", pds_update_in, METH_VARARGS, "Replace the value at the end of a path of keys with f(value, *args)"},
+    {"dissoc_in", pds_dissoc_in, METH_VARARGS, "Remove the last key of a path from the map it leads to"},
+    {"chunked_seq", pds_chunked_seq, METH_O, "Lazy ChunkedSeq over an iterable of chunks"},
+    {"chunks", pds_chunks, METH_O, "Iterate over the chunks of a Vector or ChunkedSeq as tuples"},
+    {"into", pds_into, METH_VARARGS, "Add every element of a collection, optionally through a transducer, to a Vector, Map or Set"},
+    {"transduce", pds_transduce, METH_VARARGS, "Reduce a collection through a transducer in one pass"},
+    {"eduction", pds_eduction, METH_VARARGS, "Iterable of a collection's elements through a transducer"},
+    {"xf_map", pds_xf_map, METH_O, "Transducer calling f on each element"},
+    {"xf_filter", pds_xf_filter, METH_O, "Transducer keeping the elements pred accepts"},
+    {"xf_take", pds_xf_take, METH_O, "Transducer passing the first n elements"},
+    {"xf_partition", (PyCFunction)pds_xf_partition, METH_VARARGS | METH_KEYWORDS, "Transducer grouping elements into Vectors of n"},
+    {"group_by", pds_group_by, METH_VARARGS, "Map of f(x) to the Vector of elements x that produced it"},
+    {"frequencies", pds_frequencies, METH_O, "Map of each distinct element to its number of occurrences"},
+    {"zipmap", pds_zipmap, METH_VARARGS, "Map of keys to the values at the same positions"},
+    {"diff", pds_diff, METH_VARARGS, "What changed between two versions of a Map, Set or Vector, skipping shared subtrees"},
+    {"register_value_hash", pds_register_value_hash, METH_O, "Trust pickled Map/Set hashes of keys of this type, whose hash follows from its value"},
+    {"_typed_vector", pds_typed_vector, METH_VARARGS, "Pickle reconstructor for DoubleVector and IntVector"},
+    {"_map_from_hashed", pds_map_from_hashed, METH_VARARGS, "Pickle reconstructor for Map, reusing stored key hashes"},
+    {"_set_from_hashed", pds_set_from_hashed, METH_VARARGS, "Pickle reconstructor for Set, reusing stored hashes"},
+    {"dump", pds_dump, METH_VARARGS, "Write a collection to a snapshot file for open(); returns its size"},
+    {"open", pds_open, METH_O, "Load a snapshot written by dump(): pickle.loads over a memory map of the file"},
+    {"json_loads", (PyCFunction)pds_json_loads, METH_VARARGS | METH_KEYWORDS, "Parse JSON straight into Maps and Vectors"},
+    {"json_lines", (PyCFunction)pds_json_lines, METH_VARARGS | METH_KEYWORDS, "Iterate over the documents of newline-delimited JSON"},
+    {"fold", (PyCFunction)pds_fold, METH_VARARGS | METH_KEYWORDS, "Reduce pieces of a collection with reducef and join them with combinef, in parallel on free-threaded builds"},
+    {"stats", (PyCFunction)pds_stats_fn, METH_VARARGS | METH_KEYWORDS, "Snapshot of the instrumentation counters (zeros unless built with PDS_ENABLE_STATS)"},
+    {"freelists", (PyCFunction)pds_freelists_fn, METH_VARARGS | METH_KEYWORDS, "Size, hits and misses of the node and header freelists"},
+    {"set_freelist_limit", pds_set_freelist_limit, METH_O, "Keep at most n objects per freelist; returns the previous limit"},
+    {"memory_report", pds_memory_report, METH_VARARGS, "Node bytes, trie depth and bytes shared with the other given versions"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -9736,6 +19964,8 @@ static int pds_traverse(PyObject *m, visitproc visit, void *arg) {
     Py_VISIT(st->EMPTY_MAP);
     Py_VISIT(st->EMPTY_SET);
     Py_VISIT(st->EMPTY_SORTED_VECTOR);
+    Py_VISIT(st->EMPTY_INT_MAP);
+    Py_VISIT(st->EMPTY_INT_SET);
     Py_VISIT(st->EMPTY_NODE);
     Py_VISIT(st->EMPTY_DOUBLE_NODE);
     Py_VISIT(st->EMPTY_LONG_NODE);
@@ -9757,6 +19987,8 @@ static int pds_clear(PyObject *m) {
     Py_CLEAR(st->EMPTY_MAP);
     Py_CLEAR(st->EMPTY_SET);
     Py_CLEAR(st->EMPTY_SORTED_VECTOR);
+    Py_CLEAR(st->EMPTY_INT_MAP);
+    Py_CLEAR(st->EMPTY_INT_SET);
     Py_CLEAR(st->EMPTY_NODE);
     Py_CLEAR(st->EMPTY_DOUBLE_NODE);
     Py_CLEAR(st->EMPTY_LONG_NODE);
@@ -9769,6 +20001,8 @@ static int pds_clear(PyObject *m) {
     st->EMPTY_MAP = NULL;
     st->EMPTY_SET = NULL;
     st->EMPTY_SORTED_VECTOR = NULL;
+    st->EMPTY_INT_MAP = NULL;
+    st->EMPTY_INT_SET = NULL;
     st->EMPTY_NODE = NULL;
     st->EMPTY_DOUBLE_NODE = NULL;
     st->EMPTY_LONG_NODE = NULL;
@@ -9824,9 +20058,16 @@ static int pds_exec(PyObject *m) {
     if (PyType_Ready(&VectorIteratorType) < 0) return -1;
     if (PyType_Ready(&TransientVectorType) < 0) return -1;
     if (PyType_Ready(&TransientVectorIteratorType) < 0) return -1;
+    if (PyType_Ready(&SeqChunkType) < 0) return -1;
+    if (PyType_Ready(&ChunkedSeqType) < 0) return -1;
+    if (PyType_Ready(&ChunkedSeqIteratorType) < 0) return -1;
+    if (PyType_Ready(&TransducerType) < 0) return -1;
+    if (PyType_Ready(&EductionType) < 0) return -1;
+    if (PyType_Ready(&EductionIteratorType) < 0) return -1;
+    if (PyType_Ready(&AtomType) < 0) return -1;
 
     // Initialize SortedVector types
-    if (PyType_Ready(&RBNodeType) < 0) return -1;
+    if (PyType_Ready(&SortedNodeType) < 0) return -1;
     if (PyType_Ready(&SortedVectorType) < 0) return -1;
     if (PyType_Ready(&SortedVectorIteratorType) < 0) return -1;
     if (PyType_Ready(&TransientSortedVectorType) < 0) return -1;
@@ -9847,12 +20088,24 @@ static int pds_exec(PyObject *m) {
     if (PyType_Ready(&BitmapIndexedNodeIteratorType) < 0) return -1;
     if (PyType_Ready(&ArrayNodeIteratorType) < 0) return -1;
     if (PyType_Ready(&HashCollisionNodeIteratorType) < 0) return -1;
+    if (PyType_Ready(&ArrayMapNodeType) < 0) return -1;
+    if (PyType_Ready(&ArrayMapNodeIteratorType) < 0) return -1;
     if (PyType_Ready(&MapType) < 0) return -1;
     if (PyType_Ready(&TransientMapType) < 0) return -1;
     if (PyType_Ready(&SetType) < 0) return -1;
     if (PyType_Ready(&TransientSetType) < 0) return -1;
     if (PyType_Ready(&SetIteratorType) < 0) return -1;
 
+    // Initialize IntMap and IntSet types
+    if (PyType_Ready(&IntMapNodeType) < 0) return -1;
+    if (PyType_Ready(&IntMapIteratorType) < 0) return -1;
+    if (PyType_Ready(&IntMapType) < 0) return -1;
+    if (PyType_Ready(&IntSetType) < 0) return -1;
+    if (PyType_Ready(&TransientIntMapType) < 0) return -1;
+    if (PyType_Ready(&TransientIntSetType) < 0) return -1;
+
+    if (PyType_Ready(&JsonLinesIteratorType) < 0) return -1;
+
     // Create singletons only once to ensure sub-interpreter safety.
     // If already initialized, reuse the existing global singletons.
     if (_singletons_initialized) {
@@ -9868,6 +20121,8 @@ static int pds_exec(PyObject *m) {
         st->EMPTY_MAP = (PyObject *)EMPTY_MAP;
         st->EMPTY_SET = (PyObject *)EMPTY_SET;
         st->EMPTY_SORTED_VECTOR = (PyObject *)EMPTY_SORTED_VECTOR;
+        st->EMPTY_INT_MAP = (PyObject *)EMPTY_INT_MAP;
+        st->EMPTY_INT_SET = (PyObject *)EMPTY_INT_SET;
     } else {
         // First initialization - create all singletons
 
@@ -9897,7 +20152,7 @@ static int pds_exec(PyObject *m) {
         if (!st->EMPTY_LONG_VECTOR) return -1;
 
         // Create empty bitmap indexed node
-        st->EMPTY_BIN = (PyObject *)BitmapIndexedNode_create(0, NULL, NULL);
+        st->EMPTY_BIN = (PyObject *)BitmapIndexedNode_create(0, 0, NULL);
         if (!st->EMPTY_BIN) return -1;
 
         // Create empty map
@@ -9919,6 +20174,12 @@ static int pds_exec(PyObject *m) {
             sv->reverse = 0;
         }
 
+        // Create empty int map and int set
+        st->EMPTY_INT_MAP = IntMap_create(&IntMapType, NULL, 0);
+        if (!st->EMPTY_INT_MAP) return -1;
+        st->EMPTY_INT_SET = IntMap_create(&IntSetType, NULL, 0);
+        if (!st->EMPTY_INT_SET) return -1;
+
         // Immortalize singletons for Python 3.12+ to prevent refcount contention
         // in multi-threaded code. Immortal objects don't have their refcounts modified.
         PDS_SET_IMMORTAL(st->_MISSING);
@@ -9932,6 +20193,8 @@ static int pds_exec(PyObject *m) {
         PDS_SET_IMMORTAL(st->EMPTY_MAP);
         PDS_SET_IMMORTAL(st->EMPTY_SET);
         PDS_SET_IMMORTAL(st->EMPTY_SORTED_VECTOR);
+        PDS_SET_IMMORTAL(st->EMPTY_INT_MAP);
+        PDS_SET_IMMORTAL(st->EMPTY_INT_SET);
 
         // Update global aliases for backward compatibility with existing code
         // These are set once and never change, ensuring sub-interpreter safety
@@ -9946,6 +20209,8 @@ static int pds_exec(PyObject *m) {
         EMPTY_MAP = (Map *)st->EMPTY_MAP;
         EMPTY_SET = (Set *)st->EMPTY_SET;
         EMPTY_SORTED_VECTOR = (SortedVector *)st->EMPTY_SORTED_VECTOR;
+        EMPTY_INT_MAP = (IntMap *)st->EMPTY_INT_MAP;
+        EMPTY_INT_SET = (IntMap *)st->EMPTY_INT_SET;
 
         // Mark as initialized
         _singletons_initialized = 1;
@@ -9958,6 +20223,30 @@ static int pds_exec(PyObject *m) {
         return -1;
     }
 
+    Py_INCREF(&ChunkedSeqType);
+    if (PyModule_AddObject(m, "ChunkedSeq", (PyObject *)&ChunkedSeqType) < 0) {
+        Py_DECREF(&ChunkedSeqType);
+        return -1;
+    }
+
+    Py_INCREF(&TransducerType);
+    if (PyModule_AddObject(m, "Transducer", (PyObject *)&TransducerType) < 0) {
+        Py_DECREF(&TransducerType);
+        return -1;
+    }
+
+    Py_INCREF(&EductionType);
+    if (PyModule_AddObject(m, "Eduction", (PyObject *)&EductionType) < 0) {
+        Py_DECREF(&EductionType);
+        return -1;
+    }
+
+    Py_INCREF(&AtomType);
+    if (PyModule_AddObject(m, "Atom", (PyObject *)&AtomType) < 0) {
+        Py_DECREF(&AtomType);
+        return -1;
+    }
+
     Py_INCREF(&VectorType);
     if (PyModule_AddObject(m, "Vector", (PyObject *)&VectorType) < 0) {
         Py_DECREF(&VectorType);
@@ -10070,6 +20359,30 @@ static int pds_exec(PyObject *m) {
         return -1;
     }
 
+    Py_INCREF(&IntMapType);
+    if (PyModule_AddObject(m, "IntMap", (PyObject *)&IntMapType) < 0) {
+        Py_DECREF(&IntMapType);
+        return -1;
+    }
+
+    Py_INCREF(&IntSetType);
+    if (PyModule_AddObject(m, "IntSet", (PyObject *)&IntSetType) < 0) {
+        Py_DECREF(&IntSetType);
+        return -1;
+    }
+
+    Py_INCREF(&TransientIntMapType);
+    if (PyModule_AddObject(m, "TransientIntMap", (PyObject *)&TransientIntMapType) < 0) {
+        Py_DECREF(&TransientIntMapType);
+        return -1;
+    }
+
+    Py_INCREF(&TransientIntSetType);
+    if (PyModule_AddObject(m, "TransientIntSet", (PyObject *)&TransientIntSetType) < 0) {
+        Py_DECREF(&TransientIntSetType);
+        return -1;
+    }
+
     // Register types with collections.abc ABCs
     // This enables isinstance() checks for protocol compatibility
     PyObject *collections_abc = PyImport_ImportModule("collections.abc");
@@ -10107,6 +20420,8 @@ static int pds_exec(PyObject *m) {
         if (mapping_abc) {
             result = PyObject_CallMethod(mapping_abc, "register", "O", &MapType);
             Py_XDECREF(result);
+            result = PyObject_CallMethod(mapping_abc, "register", "O", &IntMapType);
+            Py_XDECREF(result);
             Py_DECREF(mapping_abc);
         }
 
@@ -10115,6 +20430,8 @@ static int pds_exec(PyObject *m) {
         if (set_abc) {
             result = PyObject_CallMethod(set_abc, "register", "O", &SetType);
             Py_XDECREF(result);
+            result = PyObject_CallMethod(set_abc, "register", "O", &IntSetType);
+            Py_XDECREF(result);
             Py_DECREF(set_abc);
         }
 
@@ -1,7 +1,8 @@
 """Type stubs for spork.runtime.pds C extension."""
 
-from collections.abc import Iterator
-from typing import Any, Generic, TypeVar
+import os
+from collections.abc import Callable, Iterable, Iterator
+from typing import Any, Generic, TypeVar, overload
 
 T = TypeVar("T")
 K = TypeVar("K")
@@ -27,11 +28,35 @@ class Cons(Generic[T]):
     def conj(self, val: T) -> Cons[T]: ...
 
 # =============================================================================
-# Vector - Persistent vector (bit-partitioned trie)
+# ChunkedSeq - Seq realized a chunk (vector leaf or tuple) at a time
+# =============================================================================
+
+class ChunkedSeq(Generic[T]):
+    first: T
+    rest: ChunkedSeq[T] | None
+    realized: bool
+
+    def __iter__(self) -> Iterator[T]: ...
+    def __len__(self) -> int: ...
+    def __bool__(self) -> bool: ...
+    def __hash__(self) -> int: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __ne__(self, other: object) -> bool: ...
+    def __repr__(self) -> str: ...
+    def __class_getitem__(cls, item: Any) -> Any: ...
+    def __reduce__(self) -> tuple[Any, tuple[tuple[tuple[T, ...]]]]: ...
+    def chunk_first(self) -> tuple[T, ...]: ...
+    def chunk_next(self) -> ChunkedSeq[T] | None: ...
+    def chunks(self) -> Iterator[tuple[T, ...]]: ...
+
+# =============================================================================
+# Vector - Persistent vector (relaxed radix balanced trie; O(log n) slice and concat)
 # =============================================================================
 
 class Vector(Generic[T]):
     def __init__(self, *args: T) -> None: ...
+    @classmethod
+    def from_iterable(cls, iterable: Any) -> Vector[Any]: ...
     def __iter__(self) -> Iterator[T]: ...
     def __len__(self) -> int: ...
     def __getitem__(self, index: int) -> T: ...
@@ -48,11 +73,12 @@ class Vector(Generic[T]):
     def assoc(self, index: int, val: T) -> Vector[T]: ...
     def pop(self) -> Vector[T]: ...
     def transient(self) -> TransientVector[T]: ...
-    def to_seq(self) -> Cons[T]: ...
+    def to_seq(self) -> ChunkedSeq[T] | None: ...
     def copy(self) -> Vector[T]: ...
     def index(self, value: T, start: int = 0, stop: int = ...) -> int: ...
     def count(self, value: T) -> int: ...
     def sort(self, *, key: Any = None, reverse: bool = False) -> Vector[T]: ...
+    def reduce(self, f: Callable[..., Any], init: Any = ...) -> Any: ...
 
 class TransientVector(Generic[T]):
     def __len__(self) -> int: ...
@@ -63,6 +89,7 @@ class TransientVector(Generic[T]):
     def __contains__(self, item: object) -> bool: ...
     def conj_mut(self, val: T) -> TransientVector[T]: ...
     def assoc_mut(self, index: int, val: T) -> TransientVector[T]: ...
+    def update_mut(self, index: int, f: Callable[[T], T]) -> TransientVector[T]: ...
     def pop_mut(self) -> TransientVector[T]: ...
     def persistent(self) -> Vector[T]: ...
     def append(self, val: T) -> TransientVector[T]: ...
@@ -84,9 +111,18 @@ class DoubleVector:
     def __repr__(self) -> str: ...
     def __class_getitem__(cls, item: Any) -> Any: ...
     def __reduce__(self) -> tuple[type, tuple[float, ...]]: ...
+    def __reduce_ex__(self, protocol: int) -> tuple[Any, tuple[Any, ...]]: ...
     def nth(self, index: int, default: float = ...) -> float: ...
     def conj(self, val: float) -> DoubleVector: ...
     def transient(self) -> TransientDoubleVector: ...
+    def reduce(self, f: Callable[..., Any], init: Any = ...) -> Any: ...
+    def sum(self) -> float: ...
+    def mean(self) -> float: ...
+    def min(self) -> float: ...
+    def max(self) -> float: ...
+    def dot(self, other: DoubleVector) -> float: ...
+    def map_scalar(self, op: str, x: float) -> DoubleVector: ...
+    def compare(self, op: str, x: float) -> IntVector: ...
 
 class TransientDoubleVector:
     def __len__(self) -> int: ...
@@ -109,9 +145,18 @@ class IntVector:
     def __repr__(self) -> str: ...
     def __class_getitem__(cls, item: Any) -> Any: ...
     def __reduce__(self) -> tuple[type, tuple[int, ...]]: ...
+    def __reduce_ex__(self, protocol: int) -> tuple[Any, tuple[Any, ...]]: ...
     def nth(self, index: int, default: int = ...) -> int: ...
     def conj(self, val: int) -> IntVector: ...
     def transient(self) -> TransientIntVector: ...
+    def reduce(self, f: Callable[..., Any], init: Any = ...) -> Any: ...
+    def sum(self) -> int: ...
+    def mean(self) -> float: ...
+    def min(self) -> int: ...
+    def max(self) -> int: ...
+    def dot(self, other: IntVector) -> int: ...
+    def map_scalar(self, op: str, x: int) -> IntVector: ...
+    def compare(self, op: str, x: int) -> IntVector: ...
 
 class TransientIntVector:
     def __len__(self) -> int: ...
@@ -125,6 +170,8 @@ class TransientIntVector:
 
 class Map(Generic[K, V]):
     def __init__(self, *args: Any) -> None: ...
+    @classmethod
+    def from_dict(cls, src: Any) -> Map[Any, Any]: ...
     def __iter__(self) -> Iterator[K]: ...
     def __len__(self) -> int: ...
     def __getitem__(self, key: K) -> V: ...
@@ -135,6 +182,7 @@ class Map(Generic[K, V]):
     def __repr__(self) -> str: ...
     def __class_getitem__(cls, item: Any) -> Any: ...
     def __reduce__(self) -> tuple[Any, tuple[Any, ...]]: ...
+    def __reduce_ex__(self, protocol: int) -> tuple[Any, tuple[Any, ...]]: ...
     def get(self, key: K, default: V = ...) -> V: ...
     def assoc(self, key: K, val: V) -> Map[K, V]: ...
     def dissoc(self, key: K) -> Map[K, V]: ...
@@ -144,6 +192,9 @@ class Map(Generic[K, V]):
     def transient(self) -> TransientMap[K, V]: ...
     def to_seq(self) -> Cons[tuple[K, V]]: ...
     def copy(self) -> Map[K, V]: ...
+    def reduce(self, f: Callable[..., Any], init: Any = ...) -> Any: ...
+    def merge_with(self, f: Callable[[V, V], V] | None, other: Map[K, V]) -> Map[K, V]: ...
+    def __or__(self, other: Any) -> Map[K, V]: ...
 
 class TransientMap(Generic[K, V]):
     def __len__(self) -> int: ...
@@ -157,6 +208,8 @@ class TransientMap(Generic[K, V]):
     def values(self) -> Iterator[V]: ...
     def items(self) -> Iterator[tuple[K, V]]: ...
     def assoc_mut(self, key: K, val: V) -> TransientMap[K, V]: ...
+    def assoc_many_mut(self, pairs: Any) -> TransientMap[K, V]: ...
+    def update_mut(self, key: K, f: Callable[[Any], V], default: Any = None) -> TransientMap[K, V]: ...
     def dissoc_mut(self, key: K) -> TransientMap[K, V]: ...
     def persistent(self) -> Map[K, V]: ...
 
@@ -166,6 +219,8 @@ class TransientMap(Generic[K, V]):
 
 class Set(Generic[T]):
     def __init__(self, *args: T) -> None: ...
+    @classmethod
+    def from_iterable(cls, iterable: Any) -> Set[Any]: ...
     def __iter__(self) -> Iterator[T]: ...
     def __len__(self) -> int: ...
     def __contains__(self, item: object) -> bool: ...
@@ -179,11 +234,13 @@ class Set(Generic[T]):
     def __xor__(self, other: Set[T]) -> Set[T]: ...
     def __class_getitem__(cls, item: Any) -> Any: ...
     def __reduce__(self) -> tuple[type, tuple[T, ...]]: ...
+    def __reduce_ex__(self, protocol: int) -> tuple[Any, tuple[Any, ...]]: ...
     def conj(self, val: T) -> Set[T]: ...
     def disj(self, val: T) -> Set[T]: ...
     def transient(self) -> TransientSet[T]: ...
     def to_seq(self) -> Cons[T]: ...
     def copy(self) -> Set[T]: ...
+    def reduce(self, f: Callable[..., Any], init: Any = ...) -> Any: ...
     def isdisjoint(self, other: Any) -> bool: ...
 
 class TransientSet(Generic[T]):
@@ -199,7 +256,7 @@ class TransientSet(Generic[T]):
     def clear(self) -> None: ...
 
 # =============================================================================
-# SortedVector - Persistent sorted vector (Red-Black Tree)
+# SortedVector - Persistent sorted vector (B+tree)
 # =============================================================================
 
 class SortedVector(Generic[T]):
@@ -208,7 +265,7 @@ class SortedVector(Generic[T]):
     ) -> None: ...
     def __iter__(self) -> Iterator[T]: ...
     def __len__(self) -> int: ...
-    def __getitem__(self, index: int) -> T: ...
+    def __getitem__(self, index: int | slice) -> Any: ...
     def __hash__(self) -> int: ...
     def __eq__(self, other: object) -> bool: ...
     def __ne__(self, other: object) -> bool: ...
@@ -224,6 +281,13 @@ class SortedVector(Generic[T]):
     def last(self) -> T | None: ...
     def index_of(self, val: T) -> int: ...
     def rank(self, val: T) -> int: ...
+    def range(
+        self, lo: Any = None, hi: Any = None, *, inclusive: bool | tuple[bool, bool] = (True, False)
+    ) -> SortedVector[T]: ...
+    def subseq(
+        self, lo: Any = None, hi: Any = None, *, inclusive: bool | tuple[bool, bool] = (True, False)
+    ) -> Iterator[T]: ...
+    def merge(self, other: Any) -> SortedVector[T]: ...
     def transient(self) -> TransientSortedVector[T]: ...
 
 class TransientSortedVector(Generic[T]):
@@ -232,6 +296,70 @@ class TransientSortedVector(Generic[T]):
     def disj_mut(self, val: T) -> TransientSortedVector[T]: ...
     def persistent(self) -> SortedVector[T]: ...
 
+# =============================================================================
+# IntMap / IntSet - Persistent int64-keyed map and set (radix trie)
+# =============================================================================
+
+# Keys are stored unboxed, iterate in ascending order and must fit in int64.
+# | keeps the right operand's value for shared keys; & and - keep the left's.
+class IntMap(Generic[V]):
+    def __init__(self, src: Any = None) -> None: ...
+    def __iter__(self) -> Iterator[int]: ...
+    def __len__(self) -> int: ...
+    def __getitem__(self, key: int) -> V: ...
+    def __contains__(self, key: object) -> bool: ...
+    def __hash__(self) -> int: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __ne__(self, other: object) -> bool: ...
+    def __repr__(self) -> str: ...
+    def __or__(self, other: IntMap[V]) -> IntMap[V]: ...
+    def __and__(self, other: IntMap[V]) -> IntMap[V]: ...
+    def __sub__(self, other: IntMap[V]) -> IntMap[V]: ...
+    def __class_getitem__(cls, item: Any) -> Any: ...
+    def __reduce__(self) -> tuple[Any, tuple[tuple[tuple[int, V], ...]]]: ...
+    def get(self, key: int, default: V | None = None) -> V | None: ...
+    def assoc(self, key: int, val: V) -> IntMap[V]: ...
+    def dissoc(self, key: int) -> IntMap[V]: ...
+    def keys(self) -> Iterator[int]: ...
+    def values(self) -> Iterator[V]: ...
+    def items(self) -> Iterator[tuple[int, V]]: ...
+    def transient(self) -> TransientIntMap[V]: ...
+
+class TransientIntMap(Generic[V]):
+    def __len__(self) -> int: ...
+    def __getitem__(self, key: int) -> V: ...
+    def __contains__(self, key: object) -> bool: ...
+    def get(self, key: int, default: V | None = None) -> V | None: ...
+    def assoc_mut(self, key: int, val: V) -> TransientIntMap[V]: ...
+    def dissoc_mut(self, key: int) -> TransientIntMap[V]: ...
+    def persistent(self) -> IntMap[V]: ...
+
+class IntSet:
+    def __init__(self, iterable: Any = None) -> None: ...
+    def __iter__(self) -> Iterator[int]: ...
+    def __len__(self) -> int: ...
+    def __contains__(self, key: object) -> bool: ...
+    def __hash__(self) -> int: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __ne__(self, other: object) -> bool: ...
+    def __repr__(self) -> str: ...
+    def __or__(self, other: IntSet) -> IntSet: ...
+    def __and__(self, other: IntSet) -> IntSet: ...
+    def __sub__(self, other: IntSet) -> IntSet: ...
+    def __xor__(self, other: IntSet) -> IntSet: ...
+    def __class_getitem__(cls, item: Any) -> Any: ...
+    def __reduce__(self) -> tuple[Any, tuple[tuple[int, ...]]]: ...
+    def conj(self, key: int) -> IntSet: ...
+    def disj(self, key: int) -> IntSet: ...
+    def transient(self) -> TransientIntSet: ...
+
+class TransientIntSet:
+    def __len__(self) -> int: ...
+    def __contains__(self, key: object) -> bool: ...
+    def conj_mut(self, key: int) -> TransientIntSet: ...
+    def disj_mut(self, key: int) -> TransientIntSet: ...
+    def persistent(self) -> IntSet: ...
+
 # =============================================================================
 # Empty collection constants
 # =============================================================================
@@ -248,11 +376,115 @@ EMPTY_SORTED_VECTOR: SortedVector[Any]
 # =============================================================================
 
 def cons(first: T, rest: Cons[T] | None = None) -> Cons[T]: ...
+def chunked_seq(chunks: Iterable[Iterable[T]]) -> ChunkedSeq[T]: ...
+def chunks(coll: Vector[T] | ChunkedSeq[T]) -> Iterator[tuple[T, ...]]: ...
 def vec(*args: T) -> Vector[T]: ...
-def vec_f64(*args: float) -> DoubleVector: ...
-def vec_i64(*args: int) -> IntVector: ...
+# A single argument may also be an iterable or a buffer (array.array, NumPy,
+# another typed vector); buffers are copied without boxing each element.
+def vec_f64(*args: Any) -> DoubleVector: ...
+def vec_i64(*args: Any) -> IntVector: ...
 def hash_map(*args: Any) -> Map[Any, Any]: ...
 def hash_set(*args: T) -> Set[T]: ...
 def sorted_vec(
     iterable: Any = None, *, key: Any = None, reverse: bool = False
 ) -> SortedVector[Any]: ...
+def int_map(src: Any = None) -> IntMap[Any]: ...
+def int_set(iterable: Any = None) -> IntSet: ...
+
+# Reduces pieces of about `chunk` elements with reducef, seeding each with
+# combinef(), and joins the results in order with combinef(left, right).
+# Runs on a thread pool on free-threaded builds with the GIL disabled.
+def fold(
+    coll: Any,
+    reducef: Callable[[Any, Any], Any],
+    combinef: Callable[..., Any],
+    chunk: int = 512,
+) -> Any: ...
+
+# Nested paths: one call walks every key of path through Maps, Vectors and
+# their transients, returning coll itself when nothing changes.
+def get_in(coll: Any, path: Any, default: Any = None) -> Any: ...
+def assoc_in(coll: Any, path: Any, val: Any) -> Any: ...
+def update_in(coll: Any, path: Any, f: Callable[..., Any], *args: Any) -> Any: ...
+def dissoc_in(coll: Any, path: Any) -> Any: ...
+def into(to: Vector[Any] | Map[Any, Any] | Set[Any], *args: Any) -> Any: ...
+def group_by(f: Callable[[T], K], coll: Iterable[T]) -> Map[K, Vector[T]]: ...
+def frequencies(coll: Iterable[T]) -> Map[T, int]: ...
+def zipmap(keys: Iterable[K], vals: Iterable[V]) -> Map[K, V]: ...
+
+# What changed from old to new, skipping the subtrees they share. Maps give
+# (removed, added, changed) with changed holding the new values; Vectors give
+# (old's elements past new's end, new's elements past old's end, {index: new
+# value}); Sets give (removed, added).
+@overload
+def diff(old: Map[K, V], new: Map[K, V]) -> tuple[Map[K, V], Map[K, V], Map[K, V]]: ...
+@overload
+def diff(old: Vector[T], new: Vector[T]) -> tuple[Vector[T], Vector[T], Map[int, T]]: ...
+@overload
+def diff(old: Set[T], new: Set[T]) -> tuple[Set[T], Set[T]]: ...
+
+# Transducers: stages run in one native pass over the source. A Transducer
+# called with another composes them, so (comp (map f) (filter p)) works too.
+class Transducer:
+    def __call__(self, other: Transducer) -> Transducer: ...
+    def __repr__(self) -> str: ...
+
+class Eduction(Generic[T]):
+    def __iter__(self) -> Iterator[T]: ...
+    def __repr__(self) -> str: ...
+
+def xf_map(f: Callable[[Any], Any]) -> Transducer: ...
+def xf_filter(pred: Callable[[Any], Any]) -> Transducer: ...
+def xf_take(n: int) -> Transducer: ...
+def xf_partition(n: int, all: bool = False) -> Transducer: ...
+def transduce(xform: Any, f: Callable[[Any, Any], Any], *args: Any) -> Any: ...
+def eduction(xform: Any, coll: Iterable[Any]) -> Eduction[Any]: ...
+
+# A reference shared between threads: deref never locks, swap retries f on
+# the newer value when another thread changed it first, and watches run as
+# fn(key, atom, old, new) after each change.
+class Atom(Generic[T]):
+    def __init__(self, value: T = ...) -> None: ...
+    def deref(self) -> T: ...
+    def reset(self, value: T) -> T: ...
+    def swap(self, f: Callable[..., T], *args: Any) -> T: ...
+    def compare_and_set(self, old: T, new: T) -> bool: ...
+    def add_watch(self, key: Any, fn: Callable[[Any, Atom[T], T, T], Any]) -> Atom[T]: ...
+    def remove_watch(self, key: Any) -> Atom[T]: ...
+    def __repr__(self) -> str: ...
+
+# Trust the hashes stored in pickled Maps and Sets for keys of exactly type
+# cls, whose hash must follow from its value (never from identity); returns cls.
+def register_value_hash(cls: type[T]) -> type[T]: ...
+
+# Pickle reconstructors named by the __reduce_ex__ methods.
+def _typed_vector(code: str, data: Any) -> DoubleVector | IntVector: ...
+def _map_from_hashed(fingerprint: int, hashes: Any, kvs: tuple[Any, ...]) -> Map[Any, Any]: ...
+def _set_from_hashed(fingerprint: int, hashes: Any, keys: tuple[Any, ...]) -> Set[Any]: ...
+
+# Memory-mapped pickles: dump writes coll as a protocol 5 pickle with its
+# out-of-band buffers aligned in the file; open memory-maps the file and
+# pickle.loads it in full. Only DoubleVector/IntVector values stay in the mapping.
+def dump(coll: Any, path: str | os.PathLike[str]) -> int: ...
+def open(path: str | os.PathLike[str]) -> Any: ...
+
+# Native JSON decoding: objects become Maps and arrays Vectors, built in bulk
+# as they close; repeated short keys share one (cached) key object.
+def json_loads(s: str | bytes | bytearray, keywordize_keys: bool = False) -> Any: ...
+def json_lines(source: str | bytes | Iterable[Any], keywordize_keys: bool = False) -> Iterator[Any]: ...
+
+# Instrumentation counters; all zero unless built with PDS_STATS=1.
+def stats(*, reset: bool = False) -> dict[str, Any]: ...
+
+# Size, hits, misses and hit rate of the node and header freelists; "enabled"
+# is False when built with PDS_FREELISTS=0. Free-threaded builds keep one set
+# of lists per thread and report the calling thread's.
+def freelists(*, reset: bool = False) -> dict[str, Any]: ...
+
+# Keep at most n objects per freelist (freeing the rest); returns the old limit.
+# Other threads of a free-threaded build free their surplus as they next allocate.
+def set_freelist_limit(n: int) -> int: ...
+
+# Node bytes, trie depth and collision nodes of coll, plus the nodes and
+# bytes it shares with the other versions given.
+def memory_report(coll: Any, *others: Any) -> dict[str, int]: ...
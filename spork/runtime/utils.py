@@ -19,8 +19,10 @@ from spork.runtime.core import (
     _PROTOCOL_IMPLS,
     _PROTOCOLS,
     add,
+    add_watch,
     assoc,
     assoc_bang,
+    atom,
     bit_and,
     bit_and_not,
     bit_not,
@@ -28,6 +30,7 @@ from spork.runtime.core import (
     bit_shift_left,
     bit_shift_right,
     bit_xor,
+    compare_and_set_bang,
     concat,
     conj,
     conj_bang,
@@ -36,7 +39,9 @@ from spork.runtime.core import (
     cycle,
     dec,
     dedupe,
+    deref,
     disj,
+    diff,
     disj_bang,
     dissoc,
     dissoc_bang,
@@ -46,6 +51,7 @@ from spork.runtime.core import (
     dorun,
     drop,
     drop_while,
+    eduction,
     empty,
     even_q,
     every,
@@ -84,6 +90,8 @@ from spork.runtime.core import (
     reduce,
     reductions,
     register_protocol_impl,
+    remove_watch,
+    reset_bang,
     rest,
     reverse,
     runtime_register_protocol,
@@ -102,9 +110,12 @@ from spork.runtime.core import (
     spork_range,
     spork_repeat,
     sub,
+    swap_bang,
     take,
     take_while,
+    transduce,
     transient,
+    update_bang,
     zero_q,
     zipmap,
 )
@@ -115,23 +126,36 @@ from spork.runtime.pds import (  # pyright: ignore[reportMissingModuleSource]
     EMPTY_SET,
     EMPTY_SORTED_VECTOR,
     EMPTY_VECTOR,
+    Atom,
+    ChunkedSeq,
     Cons,
     DoubleVector,
+    IntMap,
+    IntSet,
     IntVector,
     Map,
     Set,
     SortedVector,
     TransientDoubleVector,
+    TransientIntMap,
+    TransientIntSet,
     TransientIntVector,
     TransientMap,
     TransientSet,
     TransientSortedVector,
     TransientVector,
     Vector,
+    assoc_in,
     cons,
+    dissoc_in,
+    fold,
+    get_in,
     hash_map,
     hash_set,
+    int_map,
+    int_set,
     sorted_vec,
+    update_in,
     vec,
     vec_f64,
     vec_i64,
@@ -508,6 +532,7 @@ def setup_runtime_env(env: dict[str, Any]) -> None:
 
     # Persistent data structures (internal types and transients)
     env.setdefault("Cons", Cons)
+    env.setdefault("ChunkedSeq", ChunkedSeq)
     env.setdefault("TransientVector", TransientVector)
     env.setdefault("TransientDoubleVector", TransientDoubleVector)
     env.setdefault("TransientIntVector", TransientIntVector)
@@ -527,21 +552,45 @@ def setup_runtime_env(env: dict[str, Any]) -> None:
     env.setdefault("hash_map", hash_map)
     env.setdefault("hash_set", hash_set)
     env.setdefault("sorted_vec", sorted_vec)
+    env.setdefault("fold", fold)
+    setboth("get-in", get_in)
+    setboth("assoc-in", assoc_in)
+    setboth("update-in", update_in)
+    setboth("dissoc-in", dissoc_in)
 
     # SortedVector types
     env.setdefault("SortedVector", SortedVector)
     env.setdefault("TransientSortedVector", TransientSortedVector)
     env.setdefault("EMPTY_SORTED_VECTOR", EMPTY_SORTED_VECTOR)
 
+    # IntMap and IntSet types
+    env.setdefault("int_map", int_map)
+    env.setdefault("int_set", int_set)
+    env.setdefault("IntMap", IntMap)
+    env.setdefault("IntSet", IntSet)
+    env.setdefault("TransientIntMap", TransientIntMap)
+    env.setdefault("TransientIntSet", TransientIntSet)
+
     # Transient operations for batch mutations
     env.setdefault("transient", transient)
     setboth("persistent!", persistent_bang)
     setboth("conj!", conj_bang)
     setboth("assoc!", assoc_bang)
     setboth("dissoc!", dissoc_bang)
+    setboth("update!", update_bang)
     setboth("disj!", disj_bang)
     setboth("pop!", pop_bang)
 
+    # Atoms: shared references changed by compare-and-swap
+    env.setdefault("Atom", Atom)
+    env.setdefault("atom", atom)
+    env.setdefault("deref", deref)
+    setboth("swap!", swap_bang)
+    setboth("reset!", reset_bang)
+    setboth("compare-and-set!", compare_and_set_bang)
+    setboth("add-watch", add_watch)
+    setboth("remove-watch", remove_watch)
+
     # Sequence operations (core)
     env.setdefault("first", first)
     env.setdefault("last", last)
@@ -592,7 +641,10 @@ def setup_runtime_env(env: dict[str, Any]) -> None:
 
     # Sequence utilities
     env.setdefault("zipmap", zipmap)
+    env.setdefault("diff", diff)
     env.setdefault("group_by", group_by)
+    env.setdefault("transduce", transduce)
+    env.setdefault("eduction", eduction)
     env.setdefault("frequencies", frequencies)
     env.setdefault("reverse", reverse)
     env.setdefault("sort", sort)
@@ -6,15 +6,24 @@ This bypasses the Spork compiler/interpreter to measure raw data structure perfo
 
 Usage:
     python3 benchmark_pds.py --size 100000 --iter 20
+    python3 benchmark_pds.py --only map,set --json after.json
+    python3 benchmark_pds.py --compare before.json after.json
 """
 
 import argparse
 import array
+import bisect
 import copy
+import datetime
 import gc
+import json
+import platform
 import random
 import sys
+import sysconfig
+import threading
 import time
+import tracemalloc
 from typing import Any, Callable, Dict, List
 
 # Try importing lazy_seq from runtime
@@ -42,12 +51,17 @@ try:
         EMPTY_SET,
         EMPTY_VECTOR,
         DoubleVector,
+        IntMap,
+        IntSet,
         IntVector,
         Map,
         Set,
         TransientVector,
         Vector,
         hash_map,
+        hash_set,
+        set_freelist_limit,
+        sorted_vec,
         vec,
         vec_f64,
         vec_i64,
@@ -61,6 +75,16 @@ except ImportError:
     )
     sys.exit(1)
 
+# Free-threaded builds (PEP 703) run the thread scaling benchmarks in parallel
+FREE_THREADED = bool(sysconfig.get_config_var("Py_GIL_DISABLED")) and not getattr(
+    sys, "_is_gil_enabled", lambda: True
+)()
+THREAD_COUNTS = (1, 2, 4, 8)
+
+# Every measurement, in run order, for --json
+RESULTS: List[Dict[str, Any]] = []
+CURRENT_SECTION = ""
+
 # --- Utilities ---
 
 
@@ -170,6 +194,9 @@ def print_group(title: str, results: list[tuple[str, float]]):
     if not results:
         return
 
+    for name, time_val in results:
+        record(title, name, "seconds", time_val)
+
     # Sort by time (fastest first)
     sorted_results = sorted(results, key=lambda x: x[1])
     baseline_name, baseline_time = sorted_results[0]
@@ -196,6 +223,161 @@ def print_group(title: str, results: list[tuple[str, float]]):
     print()
 
 
+def record(group: str, name: str, metric: str, value: float, **extra: Any):
+    RESULTS.append(
+        {"section": CURRENT_SECTION, "group": group, "name": name, "metric": metric, "value": value, **extra}
+    )
+
+
+def run_threaded(func: Callable, threads: int, iterations: int) -> float:
+    """Wall time for `threads` threads each running func `iterations` times."""
+    func()
+    barrier = threading.Barrier(threads + 1)
+
+    def worker():
+        barrier.wait()
+        for _ in range(iterations):
+            func()
+
+    workers = [threading.Thread(target=worker) for _ in range(threads)]
+    for w in workers:
+        w.start()
+    gc.collect()
+    gc.disable()
+    try:
+        barrier.wait()
+        start = time.perf_counter()
+        for w in workers:
+            w.join()
+        end = time.perf_counter()
+    finally:
+        gc.enable()
+    return end - start
+
+
+def print_scaling(title: str, results: list[tuple[int, float]]):
+    """Print wall times for the same work per thread; speedup is against one thread."""
+    print(f"{Colors.BOLD}--- {title} ---{Colors.ENDC}")
+    base = results[0][1]
+    for threads, wall in results:
+        speedup = threads * base / wall
+        color = Colors.GREEN if speedup >= 0.75 * threads else Colors.YELLOW if speedup > 1.2 else Colors.GRAY
+        label = f"{threads} thread{'s' if threads > 1 else ''}"
+        print(f"  {color}{label:<28} {format_time(wall):>12}  ({speedup:.2f}x throughput){Colors.ENDC}")
+        record(title, label, "seconds", wall, threads=threads, speedup=speedup)
+    print()
+
+
+def measure_peak(func: Callable) -> int:
+    """Peak bytes allocated while func runs and its result is alive.
+
+    The PDS freelists are emptied and kept empty meanwhile, so every node
+    comes from the allocator and is counted like the Python baselines.
+    """
+    gc.collect()
+    limit = set_freelist_limit(0)
+    result = None
+    tracemalloc.start()
+    try:
+        result = func()
+        peak = tracemalloc.get_traced_memory()[1]
+    finally:
+        tracemalloc.stop()
+        set_freelist_limit(limit)
+    del result
+    return peak
+
+
+def check_measure_peak() -> int:
+    """Check that measure_peak counts nodes a warm freelist would have served."""
+    data = list(range(2000))
+    for _ in range(5):
+        Vector.from_iterable(data)
+    limit = set_freelist_limit(0)  # read the current limit
+    set_freelist_limit(limit)
+    peak = measure_peak(lambda: Vector.from_iterable(data))
+    failures = []
+    if not len(data) * 8 < peak < len(data) * 64:
+        failures.append(f"peak of a {len(data)}-element Vector is {peak} bytes")
+    if set_freelist_limit(limit) != limit:
+        failures.append("measure_peak did not restore the freelist limit")
+    for failure in failures:
+        print(f"{Colors.RED}FAIL{Colors.ENDC} {failure}")
+    if not failures:
+        print(f"{Colors.GREEN}measure_peak checks passed{Colors.ENDC}")
+    return 1 if failures else 0
+
+
+def print_memory(title: str, results: list[tuple[str, int]]):
+    print(f"{Colors.BOLD}--- {title} ---{Colors.ENDC}")
+    smallest = min(peak for _, peak in results)
+    for name, peak in sorted(results, key=lambda r: r[1]):
+        ratio = peak / smallest if smallest else 1.0
+        color = Colors.GREEN if ratio <= 1.1 else Colors.YELLOW if ratio <= 1.5 else Colors.ORANGE
+        print(f"  {color}{name:<32} {peak / 1024 / 1024:>9.2f} MB  ({ratio:.2f}x){Colors.ENDC}")
+        record(title, name, "peak_bytes", peak)
+    print()
+
+
+def write_json(path: str, args: argparse.Namespace):
+    doc = {
+        "meta": {
+            "python": sys.version,
+            "implementation": platform.python_implementation(),
+            "platform": platform.platform(),
+            "machine": platform.machine(),
+            "free_threaded": FREE_THREADED,
+            "size": args.size,
+            "iterations": args.iter,
+            "seed": args.seed,
+            "timestamp": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        },
+        "results": RESULTS,
+    }
+    with open(path, "w") as f:
+        json.dump(doc, f, indent=2)
+    print(f"Wrote {len(RESULTS)} results to {path}")
+
+
+def compare_json(base_path: str, new_path: str, threshold: float) -> int:
+    """Print new/base ratios for the measurements both runs share."""
+    with open(base_path) as f:
+        base = json.load(f)
+    with open(new_path) as f:
+        new = json.load(f)
+
+    def key(r):
+        return (r["group"], r["name"], r["metric"])
+
+    for field in ("size", "iterations"):
+        if base["meta"][field] != new["meta"][field]:
+            print(f"{Colors.YELLOW}Warning: {field} differs ({base['meta'][field]} vs {new['meta'][field]}){Colors.ENDC}")
+
+    base_by_key = {key(r): r["value"] for r in base["results"]}
+    regressions = improvements = 0
+    group = None
+    for r in new["results"]:
+        old = base_by_key.get(key(r))
+        if old is None or old == 0:
+            continue
+        if r["group"] != group:
+            group = r["group"]
+            print(f"{Colors.BOLD}--- {group} ---{Colors.ENDC}")
+        ratio = r["value"] / old
+        if ratio > threshold:
+            color, regressions = Colors.RED, regressions + 1
+        elif ratio < 1 / threshold:
+            color, improvements = Colors.GREEN, improvements + 1
+        else:
+            color = Colors.GRAY
+        print(f"  {color}{r['name']:<40} {ratio:>7.2f}x{Colors.ENDC}")
+    print(
+        f"\n{improvements} faster/smaller, {regressions} slower/larger "
+        f"(threshold {threshold:.2f}x, {base['meta']['python'].split()[0]} -> {new['meta']['python'].split()[0]})"
+    )
+    return 1 if regressions else 0
+
+
 # --- Benchmark Implementations ---
 
 
@@ -1244,8 +1426,331 @@ class Benchmarks:
         arr = numpy_from_spork()
         print(f"  {Colors.BLUE}Verification:{Colors.ENDC} Array sum={arr.sum():.2f}")
 
+    # --- Equality and Hashing ---
+
+    def bench_equality_hash(self):
+        vec_copy = Vector.from_iterable(self.data_int)
+        map_copy = Map.from_dict(dict(zip(self.data_str, self.data_int)))
+        set_copy = hash_set(self.data_int)
+        vec_shared = self.spork_vec.assoc(self.N - 1, -1).assoc(self.N - 1, self.N - 1)
+        map_shared = self.spork_map.assoc(self.data_str[0], -1)
+        list_copy = list(self.py_list)
+        dict_copy = dict(self.py_dict)
+
+        def fresh_vec_hash():
+            return hash(Vector.from_iterable(self.data_int))
+
+        def fresh_tuple_hash():
+            return hash(tuple(self.data_int))
+
+        eq_vec = run_benchmark("Vector == copy", lambda: self.spork_vec == vec_copy, self.ITERS)
+        eq_vec_shared = run_benchmark(
+            "Vector == derived", lambda: self.spork_vec == vec_shared, self.ITERS
+        )
+        eq_list = run_benchmark("list == copy", lambda: self.py_list == list_copy, self.ITERS)
+        eq_map = run_benchmark("Map == copy", lambda: self.spork_map == map_copy, self.ITERS)
+        eq_map_shared = run_benchmark(
+            "Map == derived", lambda: self.spork_map == map_shared, self.ITERS
+        )
+        eq_dict = run_benchmark("dict == copy", lambda: self.py_dict == dict_copy, self.ITERS)
+        eq_set = run_benchmark("Set == copy", lambda: self.spork_set == set_copy, self.ITERS)
+
+        print_group(
+            "Equality",
+            [
+                ("Python list == list", eq_list),
+                ("Spork Vector == Vector (copy)", eq_vec),
+                ("Spork Vector == Vector (derived)", eq_vec_shared),
+                ("Python dict == dict", eq_dict),
+                ("Spork Map == Map (copy)", eq_map),
+                ("Spork Map == Map (derived)", eq_map_shared),
+                ("Spork Set == Set (copy)", eq_set),
+            ],
+        )
+
+        tuple_hash = run_benchmark("hash(tuple)", fresh_tuple_hash, self.ITERS)
+        vec_hash = run_benchmark("hash(new Vector)", fresh_vec_hash, self.ITERS)
+        cached_hash = run_benchmark("hash(Vector) cached", lambda: hash(self.spork_vec), self.ITERS)
+
+        print_group(
+            "Hashing",
+            [
+                ("Python tuple(list) + hash", tuple_hash),
+                ("Spork Vector build + hash", vec_hash),
+                ("Spork hash(Vector) (cached)", cached_hash),
+            ],
+        )
+
+    # --- Set Algebra ---
+
+    def bench_set_algebra(self):
+        half = self.N // 2
+        other_py = set(range(half, self.N + half))
+        other_spork = hash_set(range(half, self.N + half))
+        derived = self.spork_set.conj(-1)
+
+        results = [
+            ("Python set | set", run_benchmark("set |", lambda: self.py_set | other_py, self.ITERS)),
+            ("Spork Set | Set", run_benchmark("Set |", lambda: self.spork_set | other_spork, self.ITERS)),
+            ("Spork Set | derived Set", run_benchmark("Set | derived", lambda: self.spork_set | derived, self.ITERS)),
+            ("Python set & set", run_benchmark("set &", lambda: self.py_set & other_py, self.ITERS)),
+            ("Spork Set & Set", run_benchmark("Set &", lambda: self.spork_set & other_spork, self.ITERS)),
+            ("Python set - set", run_benchmark("set -", lambda: self.py_set - other_py, self.ITERS)),
+            ("Spork Set - Set", run_benchmark("Set -", lambda: self.spork_set - other_spork, self.ITERS)),
+        ]
+        print_group("Set Algebra", results)
+
+    # --- Slicing and Concatenation ---
+
+    def bench_vector_slicing(self):
+        lo, hi = self.N // 4, 3 * self.N // 4
+
+        results = [
+            ("Python list[lo:hi]", run_benchmark("list slice", lambda: self.py_list[lo:hi], self.ITERS)),
+            ("Spork Vector[lo:hi]", run_benchmark("Vector slice", lambda: self.spork_vec[lo:hi], self.ITERS)),
+            ("Python list + list", run_benchmark("list +", lambda: self.py_list + self.py_list, self.ITERS)),
+            ("Spork Vector + Vector", run_benchmark("Vector +", lambda: self.spork_vec + self.spork_vec, self.ITERS)),
+            (
+                "Spork slice then nth",
+                run_benchmark("slice nth", lambda: self.spork_vec[lo:hi].nth(hi - lo - 1), self.ITERS),
+            ),
+        ]
+        print_group("Vector Slicing and Concatenation", results)
+
+    # --- SortedVector ---
+
+    def bench_sorted_vector(self):
+        shuffled = list(self.data_int)
+        random.shuffle(shuffled)
+        sv = sorted_vec(shuffled)
+        probes = [random.randint(0, self.N - 1) for _ in range(min(10000, self.N))]
+        width = max(1, self.N // 100)
+
+        def py_sorted():
+            return sorted(shuffled)
+
+        def spork_sorted_vec():
+            return sorted_vec(shuffled)
+
+        def py_bisect_rank():
+            s = 0
+            for p in probes:
+                s += bisect.bisect_left(self.py_list, p)
+            return s
+
+        def spork_rank():
+            s = 0
+            for p in probes:
+                s += sv.rank(p)
+            return s
+
+        def py_range():
+            n = 0
+            for p in probes[:1000]:
+                n += len(self.py_list[bisect.bisect_left(self.py_list, p) : bisect.bisect_left(self.py_list, p + width)])
+            return n
+
+        def spork_range():
+            n = 0
+            for p in probes[:1000]:
+                n += len(sv.range(p, p + width))
+            return n
+
+        print_group(
+            "SortedVector Construction",
+            [
+                ("Python sorted(list)", run_benchmark("sorted", py_sorted, self.ITERS)),
+                ("Spork sorted_vec(list)", run_benchmark("sorted_vec", spork_sorted_vec, self.ITERS)),
+            ],
+        )
+        print_group(
+            "SortedVector rank",
+            [
+                ("Python bisect_left", run_benchmark("bisect", py_bisect_rank, self.ITERS)),
+                ("Spork SortedVector.rank", run_benchmark("rank", spork_rank, self.ITERS)),
+            ],
+        )
+        print_group(
+            "SortedVector range (1000 queries)",
+            [
+                ("Python bisect + slice", run_benchmark("bisect slice", py_range, self.ITERS)),
+                ("Spork SortedVector.range", run_benchmark("range", spork_range, self.ITERS)),
+            ],
+        )
+
+    # --- IntMap / IntSet ---
+
+    def bench_int_collections(self):
+        int_dict = dict(zip(self.data_int, self.data_int))
+        im = IntMap(int_dict)
+        probes = [random.randint(0, self.N - 1) for _ in range(min(10000, self.N))]
+
+        def dict_get():
+            s = 0
+            for p in probes:
+                s += int_dict[p]
+            return s
+
+        def intmap_get():
+            s = 0
+            for p in probes:
+                s += im.get(p)
+            return s
+
+        print_group(
+            "IntMap Construction",
+            [
+                ("Python dict(zip)", run_benchmark("dict", lambda: dict(zip(self.data_int, self.data_int)), self.ITERS)),
+                ("Spork IntMap(dict)", run_benchmark("IntMap", lambda: IntMap(int_dict), self.ITERS)),
+                ("Spork IntSet(list)", run_benchmark("IntSet", lambda: IntSet(self.data_int), self.ITERS)),
+            ],
+        )
+        print_group(
+            "IntMap Lookup",
+            [
+                ("Python dict[k]", run_benchmark("dict get", dict_get, self.ITERS)),
+                ("Spork IntMap.get", run_benchmark("IntMap get", intmap_get, self.ITERS)),
+            ],
+        )
+
+    # --- Typed Vector Buffers ---
+
+    def bench_buffer_export(self):
+        py_array = array.array("d", self.data_float)
+
+        def array_tobytes():
+            return py_array.tobytes()
+
+        def dvec_tobytes():
+            return bytes(memoryview(self.spork_dvec))
+
+        def ivec_tobytes():
+            return bytes(memoryview(self.spork_ivec))
+
+        def dvec_to_array():
+            return array.array("d", memoryview(self.spork_dvec))
+
+        def dvec_from_buffer():
+            return vec_f64(py_array)
+
+        print_group(
+            "Typed Vector Buffer Export",
+            [
+                ("Python array.tobytes()", run_benchmark("array.tobytes", array_tobytes, self.ITERS)),
+                ("Spork bytes(memoryview(DoubleVector))", run_benchmark("dvec bytes", dvec_tobytes, self.ITERS)),
+                ("Spork bytes(memoryview(IntVector))", run_benchmark("ivec bytes", ivec_tobytes, self.ITERS)),
+                ("Spork array('d', DoubleVector)", run_benchmark("dvec array", dvec_to_array, self.ITERS)),
+                ("Spork vec_f64(array) [buffer in]", run_benchmark("vec_f64(array)", dvec_from_buffer, self.ITERS)),
+            ],
+        )
+
+    # --- Multi-threaded Reads ---
+
+    def bench_thread_scaling(self):
+        if not FREE_THREADED:
+            print(f"  {Colors.GRAY}GIL enabled: expect no scaling beyond 1 thread{Colors.ENDC}")
+        probes = [random.randint(0, self.N - 1) for _ in range(min(20000, self.N))]
+        keys = [self.data_str[p] for p in probes]
+
+        def vec_reads():
+            v = self.spork_vec
+            s = 0
+            for p in probes:
+                s += v.nth(p)
+            return s
+
+        def map_reads():
+            m = self.spork_map
+            s = 0
+            for k in keys:
+                s += m.get(k)
+            return s
+
+        def vec_iteration():
+            s = 0
+            for x in self.spork_vec:
+                s += x
+            return s
+
+        for title, fn in [
+            ("Vector.nth", vec_reads),
+            ("Map.get", map_reads),
+            ("Vector iteration", vec_iteration),
+        ]:
+            print_scaling(f"Thread Scaling - {title}", [(n, run_threaded(fn, n, self.ITERS)) for n in THREAD_COUNTS])
+
+    # --- Peak Memory ---
+
+    def bench_peak_memory(self):
+        versions = 100
+        int_dict = dict(zip(self.data_int, self.data_int))
+        str_dict = dict(zip(self.data_str, self.data_int))
+
+        def py_dict_versions():
+            out = [self.py_dict]
+            for i in range(versions):
+                d = dict(out[-1])
+                d[self.data_str[i % self.N]] = -i
+                out.append(d)
+            return out
+
+        def spork_map_versions():
+            out = [self.spork_map]
+            for i in range(versions):
+                out.append(out[-1].assoc(self.data_str[i % self.N], -i))
+            return out
+
+        print_memory(
+            "Peak Memory - Build",
+            [
+                ("Python list", measure_peak(lambda: list(self.data_int))),
+                ("Spork Vector", measure_peak(lambda: Vector.from_iterable(self.data_int))),
+                ("Spork IntVector", measure_peak(lambda: vec_i64(self.data_int))),
+                ("Spork DoubleVector", measure_peak(lambda: vec_f64(self.data_float))),
+                ("Python dict", measure_peak(lambda: dict(str_dict))),
+                ("Spork Map", measure_peak(lambda: Map.from_dict(str_dict))),
+                ("Python set", measure_peak(lambda: set(self.data_int))),
+                ("Spork Set", measure_peak(lambda: hash_set(self.data_int))),
+                ("Spork SortedVector", measure_peak(lambda: sorted_vec(self.data_int))),
+                ("Spork IntMap", measure_peak(lambda: IntMap(int_dict))),
+            ],
+        )
+        print_memory(
+            f"Peak Memory - {versions} Versions, One Key Changed Each",
+            [
+                ("Python dict copies", measure_peak(py_dict_versions)),
+                ("Spork Map.assoc versions", measure_peak(spork_map_versions)),
+            ],
+        )
+
+
+SECTIONS = [
+    (
+        "vector",
+        "VECTOR BENCHMARKS",
+        [
+            "bench_vector_construction",
+            "bench_typed_vector_construction",
+            "bench_vector_access",
+            "bench_vector_pop",
+            "bench_vector_slicing",
+        ],
+    ),
+    ("map", "MAP BENCHMARKS", ["bench_map_construction", "bench_map_lookup", "bench_map_dissoc", "bench_map_iteration"]),
+    ("set", "SET BENCHMARKS", ["bench_set_construction", "bench_set_membership", "bench_set_disj", "bench_set_iteration", "bench_set_algebra"]),
+    ("sorted", "SORTED AND INT-KEYED BENCHMARKS", ["bench_sorted_vector", "bench_int_collections"]),
+    ("sharing", "STRUCTURAL SHARING BENCHMARKS", ["bench_structural_sharing", "bench_multiple_updates"]),
+    ("equality", "EQUALITY AND HASHING BENCHMARKS", ["bench_equality_hash"]),
+    ("utility", "UTILITY BENCHMARKS", ["bench_len", "bench_sequences"]),
+    ("buffers", "TYPED VECTOR BUFFER BENCHMARKS", ["bench_buffer_export"]),
+    ("numpy", "NUMPY INTEROP BENCHMARKS", ["bench_numpy_interop"]),
+    ("threads", "MULTI-THREADED READ BENCHMARKS", ["bench_thread_scaling"]),
+    ("memory", "PEAK MEMORY BENCHMARKS", ["bench_peak_memory"]),
+]
+
 
 def main():
+    global CURRENT_SECTION
     parser = argparse.ArgumentParser(description="Spork PDS Benchmark Suite")
     parser.add_argument(
         "--size", type=int, default=100000, help="Number of elements in collections"
@@ -1253,67 +1758,56 @@ def main():
     parser.add_argument(
         "--iter", type=int, default=50, help="Number of iterations for timing"
     )
+    parser.add_argument(
+        "--only",
+        help="Comma-separated sections to run: " + ", ".join(s[0] for s in SECTIONS),
+    )
+    parser.add_argument("--json", metavar="PATH", help="Also write every result to PATH as JSON")
+    parser.add_argument("--seed", type=int, default=0, help="Random seed for probe indices")
+    parser.add_argument(
+        "--compare",
+        nargs=2,
+        metavar=("BASE", "NEW"),
+        help="Compare two --json result files instead of running",
+    )
+    parser.add_argument(
+        "--threshold", type=float, default=1.10, help="Ratio flagged as a change by --compare"
+    )
+    parser.add_argument(
+        "--check", action="store_true", help="Check the peak memory measurement instead of running"
+    )
     args = parser.parse_args()
 
+    if args.compare:
+        sys.exit(compare_json(args.compare[0], args.compare[1], args.threshold))
+    if args.check:
+        sys.exit(check_measure_peak())
+
+    only = set(args.only.split(",")) if args.only else None
+    if only and not only <= {s[0] for s in SECTIONS}:
+        parser.error(f"unknown section in --only: {', '.join(sorted(only - {s[0] for s in SECTIONS}))}")
+    random.seed(args.seed)
+
     print(f"{Colors.BOLD}Spork PDS Performance Benchmark{Colors.ENDC}")
     print(f"Size: {args.size}, Iterations: {args.iter}")
     print("-" * 60)
 
     b = Benchmarks(args.size, args.iter)
 
-    # Vector benchmarks
-    print(f"\n{Colors.HEADER}{'=' * 60}{Colors.ENDC}")
-    print(f"{Colors.HEADER}  VECTOR BENCHMARKS{Colors.ENDC}")
-    print(f"{Colors.HEADER}{'=' * 60}{Colors.ENDC}\n")
-
-    b.bench_vector_construction()
-    b.bench_typed_vector_construction()
-    b.bench_vector_access()
-    b.bench_vector_pop()
-
-    # Map benchmarks
-    print(f"\n{Colors.HEADER}{'=' * 60}{Colors.ENDC}")
-    print(f"{Colors.HEADER}  MAP BENCHMARKS{Colors.ENDC}")
-    print(f"{Colors.HEADER}{'=' * 60}{Colors.ENDC}\n")
-
-    b.bench_map_construction()
-    b.bench_map_lookup()
-    b.bench_map_dissoc()
-    b.bench_map_iteration()
-
-    # Set benchmarks
-    print(f"\n{Colors.HEADER}{'=' * 60}{Colors.ENDC}")
-    print(f"{Colors.HEADER}  SET BENCHMARKS{Colors.ENDC}")
-    print(f"{Colors.HEADER}{'=' * 60}{Colors.ENDC}\n")
-
-    b.bench_set_construction()
-    b.bench_set_membership()
-    b.bench_set_disj()
-    b.bench_set_iteration()
-
-    # Structural sharing benchmarks
-    print(f"\n{Colors.HEADER}{'=' * 60}{Colors.ENDC}")
-    print(f"{Colors.HEADER}  STRUCTURAL SHARING BENCHMARKS{Colors.ENDC}")
-    print(f"{Colors.HEADER}{'=' * 60}{Colors.ENDC}\n")
-
-    b.bench_structural_sharing()
-    b.bench_multiple_updates()
-
-    # Utility benchmarks
-    print(f"\n{Colors.HEADER}{'=' * 60}{Colors.ENDC}")
-    print(f"{Colors.HEADER}  UTILITY BENCHMARKS{Colors.ENDC}")
-    print(f"{Colors.HEADER}{'=' * 60}{Colors.ENDC}\n")
-
-    b.bench_len()
-    b.bench_sequences()
-
-    # NumPy interop
-    if HAS_NUMPY:
+    for key, title, methods in SECTIONS:
+        if only and key not in only:
+            continue
+        if key == "numpy" and not HAS_NUMPY:
+            continue
+        CURRENT_SECTION = key
         print(f"\n{Colors.HEADER}{'=' * 60}{Colors.ENDC}")
-        print(f"{Colors.HEADER}  NUMPY INTEROP BENCHMARKS{Colors.ENDC}")
+        print(f"{Colors.HEADER}  {title}{Colors.ENDC}")
         print(f"{Colors.HEADER}{'=' * 60}{Colors.ENDC}\n")
+        for method in methods:
+            getattr(b, method)()
 
-        b.bench_numpy_interop()
+    if args.json:
+        write_json(args.json, args)
 
     print(f"\n{Colors.BOLD}Benchmark complete!{Colors.ENDC}")
 